@@ -0,0 +1,222 @@
+/**
+ * @file batteryTest.cpp
+ * @brief Host check of the tag's battery filter and state of charge
+ *        (server/battery.cpp).
+ *
+ * Checked:
+ *
+ * - the trimmed mean drops one low and one high reading (a radio burst
+ *   pulling the rail down), and nothing with fewer than 3 readings;
+ * - the OCV-to-SoC curve: exact at every curve point, 100 % at and above
+ *   the top, 0 % at and below the bottom, and between points within half a
+ *   percent of linear interpolation and never rising as the voltage falls;
+ * - the filter's step response: measurements to the 63 % and 95 % points
+ *   of a 300 mV step up and down, against the 1/16 EMA's 16 and 47, and
+ *   the settled value within 1 mV of the step;
+ * - the reported percentage: changed at most once by 2000 measurements
+ *   with ±10 mV noise, unchanged by a single 150 mV dip, falling in steps
+ *   of at least BATTERY_SOC_HYSTERESIS over a full discharge down to 0 %,
+ *   and rising by BATTERY_SOC_RISE or more;
+ * - the 4-byte record.
+ *
+ * The check exits with status 1 on any fault.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 batteryTest.cpp ../server/battery.cpp -o batteryTest
+ *
+ * Usage:
+ *
+ *     batteryTest
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../server/battery.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief Faults found. */
+static unsigned gFaults = 0;
+
+static void check(bool ok, const char* what) {
+  if (ok) return;
+  gFaults++;
+  printf("  FAULT %s\n", what);
+}
+
+#define CURVE     BATTERY_LIPO_CURVE
+#define CURVE_LEN BATTERY_LIPO_CURVE_LEN
+
+/** @brief Linear interpolation of the curve in floating point. */
+static double referenceSoc(double mv) {
+  if (mv >= CURVE[0].mv) return CURVE[0].percent;
+  for (size_t i = 1; i < CURVE_LEN; i++) {
+    if (mv >= CURVE[i].mv) {
+      double f = (mv - CURVE[i].mv) / (CURVE[i - 1].mv - CURVE[i].mv);
+      return CURVE[i].percent + f * (CURVE[i - 1].percent - CURVE[i].percent);
+    }
+  }
+  return CURVE[CURVE_LEN - 1].percent;
+}
+
+// ============================================================================
+// Checks
+// ============================================================================
+
+static void testTrimmedMean() {
+  unsigned before = gFaults;
+  uint16_t burst[16];
+  for (int i = 0; i < 16; i++) burst[i] = 2000;
+  burst[5] = 1400;  // the rail dips during a radio burst
+  burst[9] = 2003;
+  check(batteryTrimmedMean(burst, 16) == 2000, "dip and high reading dropped");
+  uint16_t two[] = { 1000, 1001 };
+  check(batteryTrimmedMean(two, 2) == 1001, "nothing dropped from 2 readings (rounded up)");
+  uint16_t three[] = { 10, 500, 4000 };
+  check(batteryTrimmedMean(three, 3) == 500, "median of 3");
+  check(batteryTrimmedMean(three, 0) == 0, "no readings");
+  printf("  trimmed mean %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+static void testCurve() {
+  unsigned before = gFaults;
+  for (size_t i = 0; i < CURVE_LEN; i++) {
+    check(batterySocFromMv(CURVE[i].mv, CURVE, CURVE_LEN) == CURVE[i].percent, "curve point");
+  }
+  check(batterySocFromMv(4200, CURVE, CURVE_LEN) == 100, "full at 4.2 V");
+  check(batterySocFromMv(4350, CURVE, CURVE_LEN) == 100, "clamped above the top");
+  check(batterySocFromMv(65535, CURVE, CURVE_LEN) == 100, "clamped at the largest input");
+  check(batterySocFromMv(3300, CURVE, CURVE_LEN) == 0, "empty at 3.3 V");
+  check(batterySocFromMv(2900, CURVE, CURVE_LEN) == 0, "clamped below the bottom");
+  check(batterySocFromMv(0, CURVE, CURVE_LEN) == 0, "clamped at 0 mV");
+  check(batterySocFromMv(3800, CURVE, 0) == 0, "empty curve");
+
+  double worst = 0;
+  uint8_t prev = 100;
+  for (uint32_t mv = 4400; mv >= 3000; mv--) {
+    uint8_t soc = batterySocFromMv((uint16_t)mv, CURVE, CURVE_LEN);
+    double err = fabs(soc - referenceSoc(mv));
+    if (err > worst) worst = err;
+    check(soc <= prev, "falls with the voltage");
+    prev = soc;
+  }
+  check(worst <= 0.5 + 1e-9, "within half a percent of the interpolation");
+  // Midpoints of a few segments
+  check(batterySocFromMv(3775, CURVE, CURVE_LEN) == 45, "3.775 V is 45 %");
+  check(batterySocFromMv(3550, CURVE, CURVE_LEN) == 7, "3.55 V is 7 %");
+  check(batterySocFromMv(4150, CURVE, CURVE_LEN) == 95, "4.15 V is 95 %");
+  printf("  curve: %zu points exact, ends clamped, worst interpolation error %.2f %% %s\n", CURVE_LEN, worst,
+         gFaults == before ? "ok" : "FAIL");
+}
+
+/**
+ * @brief Feed a step and report the measurements to 63 % and 95 % of it.
+ */
+static void stepResponse(uint16_t fromMv, uint16_t toMv) {
+  BatteryState s;
+  batteryStateInit(&s);
+  for (int i = 0; i < 200; i++) batteryStateUpdate(&s, fromMv, CURVE, CURVE_LEN);
+  check(batteryStateMv(&s) == fromMv, "settled before the step");
+
+  double step = (double)toMv - fromMv;
+  int n63 = -1, n95 = -1;
+  for (int n = 1; n <= 400; n++) {
+    batteryStateUpdate(&s, toMv, CURVE, CURVE_LEN);
+    double done = (batteryStateMv(&s) - (double)fromMv) / step;
+    if (n63 < 0 && done >= 0.632) n63 = n;
+    if (n95 < 0 && done >= 0.95) n95 = n;
+  }
+  int settled = abs((int)batteryStateMv(&s) - (int)toMv);
+  printf("  step %u -> %u mV: 63 %% after %d, 95 %% after %d measurements (%d s, %d s), settled %+d mV\n",
+         fromMv, toMv, n63, n95, n63 * BATTERY_PERIOD_MS / 1000, n95 * BATTERY_PERIOD_MS / 1000,
+         (int)batteryStateMv(&s) - (int)toMv);
+  check(n63 >= 15 && n63 <= 17, "63 % after about 16 measurements");
+  check(n95 >= 45 && n95 <= 49, "95 % after about 47 measurements");
+  check(settled <= 1, "settles within 1 mV");
+}
+
+static void testFilter() {
+  unsigned before = gFaults;
+  BatteryState s;
+  batteryStateInit(&s);
+  check(s.percent == BATTERY_SOC_UNKNOWN && batteryStateMv(&s) == 0, "unknown before the first measurement");
+  check(batteryStateUpdate(&s, 3800, CURVE, CURVE_LEN), "first measurement reported");
+  check(batteryStateMv(&s) == 3800 && s.percent == 50, "first measurement taken as is");
+  stepResponse(3700, 4000);
+  stepResponse(4000, 3700);
+  printf("  filter %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+static void testReported() {
+  unsigned before = gFaults;
+  BatteryState s;
+  batteryStateInit(&s);
+
+  // Noise around a steady voltage: the smoothed value still wanders by a
+  // few mV, which may cross one hysteresis step, but never back
+  uint32_t rng = 1;
+  unsigned changes = 0;
+  for (int i = 0; i < 2000; i++) {
+    rng = rng * 1103515245u + 12345u;
+    changes += batteryStateUpdate(&s, (uint16_t)(3800 - 10 + (rng >> 16) % 21), CURVE, CURVE_LEN);
+  }
+  check(changes <= 2, "noise does not flap the report");
+
+  // A buzzer burst pulls one measurement down
+  uint8_t steady = s.percent;
+  bool dipChanged = batteryStateUpdate(&s, 3650, CURVE, CURVE_LEN);
+  for (int i = 0; i < 50; i++) dipChanged |= batteryStateUpdate(&s, 3800, CURVE, CURVE_LEN);
+  check(!dipChanged && s.percent == steady, "a single dip does not change the report");
+
+  // Full discharge, 1 mV per measurement
+  uint8_t prev = s.percent;
+  unsigned falls = 0;
+  bool smallFall = false, rose = false;
+  for (uint16_t mv = 3800; mv >= 3250; mv--) {
+    if (!batteryStateUpdate(&s, mv, CURVE, CURVE_LEN)) continue;
+    if (s.percent > prev) rose = true;
+    if (prev - s.percent < BATTERY_SOC_HYSTERESIS && s.percent != 0) smallFall = true;
+    prev = s.percent;
+    falls++;
+  }
+  for (int i = 0; i < 100; i++) batteryStateUpdate(&s, 3250, CURVE, CURVE_LEN);
+  check(!rose && !smallFall, "falls in steps of at least BATTERY_SOC_HYSTERESIS");
+  check(s.percent == 0, "reaches 0 %");
+
+  // Charging: rises only in steps of BATTERY_SOC_RISE or more
+  prev = s.percent;
+  bool smallRise = false;
+  for (uint16_t mv = 3300; mv <= 4200; mv++) {
+    if (!batteryStateUpdate(&s, mv, CURVE, CURVE_LEN)) continue;
+    if (s.percent - prev < BATTERY_SOC_RISE) smallRise = true;
+    prev = s.percent;
+  }
+  check(!smallRise, "rises in steps of at least BATTERY_SOC_RISE");
+  printf("  reported: %u change(s) under noise, none for a dip, %u steps down to 0 %%, %u %% after charging %s\n",
+         changes - 1, falls, s.percent, gFaults == before ? "ok" : "FAIL");
+
+  uint8_t rec[BATTERY_RECORD_LEN];
+  BatteryState e;
+  batteryStateInit(&e);
+  batteryStateUpdate(&e, 3912, CURVE, CURVE_LEN);
+  check(batteryEncode(&e, rec) == 4 && rec[0] == (3912 & 0xFF) && rec[1] == (3912 >> 8) && rec[2] == e.percent &&
+            rec[3] == 0,
+        "record layout");
+}
+
+int main() {
+  printf("batteryTest: %zu-point LiPo curve, EMA 1/%d, measurement every %d ms\n", CURVE_LEN,
+         1 << BATTERY_EMA_SHIFT, BATTERY_PERIOD_MS);
+  testTrimmedMean();
+  testCurve();
+  testFilter();
+  testReported();
+  if (gFaults) fprintf(stderr, "batteryTest: %u faults\n", gFaults);
+  return gFaults ? 1 : 0;
+}
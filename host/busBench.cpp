@@ -0,0 +1,364 @@
+/**
+ * @file busBench.cpp
+ * @brief Latency and throughput of the tracker's event bus (scanner/eventBus.cpp).
+ *
+ * One or more publisher threads publish sequence-numbered events; each
+ * subscriber is a thread that sleeps on a semaphore given by its notify
+ * hook, like the tracker's loop subscribers. Two runs are made:
+ *
+ * - latency:    paced publishing (one event every `pacingUs`), reporting the
+ *               publish-to-handler latency percentiles per subscriber;
+ * - throughput: publishing in batches of BENCH_BATCH per publisher, each
+ *               batch waiting until every subscriber has caught up, so
+ *               nothing is dropped; reports delivered events per second.
+ *
+ * Every run checks that each subscriber saw each publisher's events in order
+ * without duplicates, and that delivered plus dropped equals published. The
+ * same runs go through a mutex + condition variable + std::deque fan-out
+ * (one queue per subscriber) as a reference.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -pthread -I../scanner busBench.cpp ../scanner/eventBus.cpp -o busBench
+ *
+ * Usage:
+ *
+ *     busBench [subscribers] [publishers] [events] [pacingUs]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eventBus.h"
+
+// ============================================================================
+// Benchmark Topic
+// ============================================================================
+
+/**
+ * @brief Event carrying its publisher and sequence number.
+ */
+struct SeqEvent {
+  uint32_t publisher;  /**< Publisher index. */
+  uint32_t seq;        /**< Sequence number per publisher. */
+  float    value;      /**< Payload, as a distance estimate would carry. */
+};
+
+/** @brief The only topic. */
+#define TOPIC_SEQ 0
+
+template <> struct BusTopic<TOPIC_SEQ> { typedef SeqEvent Type; };
+
+/** @brief Largest number of subscribers or publishers. */
+#define BENCH_MAX 8
+
+/** @brief Ring depth of each subscriber. */
+#define BENCH_DEPTH 256
+
+/** @brief Events per publisher between waits in the throughput run. */
+#define BENCH_BATCH 32
+
+// ============================================================================
+// Results
+// ============================================================================
+
+/**
+ * @brief What one subscriber observed.
+ */
+struct SubResult {
+  std::vector<uint32_t> latencyUs;  /**< Publish-to-handler latencies. */
+  uint32_t nextSeq[BENCH_MAX];      /**< Next expected sequence per publisher. */
+  std::atomic<uint64_t> received;   /**< Events handled. */
+  uint64_t orderErrors;             /**< Events out of order or repeated. */
+};
+
+/**
+ * @brief Account one received event.
+ */
+static void observe(SubResult* r, const SeqEvent& e, uint32_t latencyUs, bool keepLatency) {
+  if (e.seq < r->nextSeq[e.publisher]) r->orderErrors++;
+  r->nextSeq[e.publisher] = e.seq + 1;
+  r->received.store(r->received.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  if (keepLatency) r->latencyUs.push_back(latencyUs);
+}
+
+/**
+ * @brief Percentile of a sorted sample.
+ */
+static uint32_t percentile(const std::vector<uint32_t>& v, double p) {
+  if (v.empty()) return 0;
+  size_t i = (size_t)(p * (double)(v.size() - 1));
+  return v[i];
+}
+
+/**
+ * @brief Print one run's results and check its accounting.
+ *
+ * @return True if no subscriber saw events out of order and every event
+ *         was either delivered or counted as dropped.
+ */
+static bool report(const char* impl, const char* run, const std::vector<SubResult*>& subs,
+                   uint64_t published, const uint64_t* dropped, double seconds, bool latency) {
+  bool ok = true;
+  uint64_t delivered = 0, lost = 0;
+  for (size_t i = 0; i < subs.size(); i++) {
+    SubResult& r = *subs[i];
+    delivered += r.received;
+    lost += dropped[i];
+    if (r.orderErrors || r.received + dropped[i] != published) ok = false;
+    if (latency) {
+      std::sort(r.latencyUs.begin(), r.latencyUs.end());
+      printf("  %-6s %-10s sub %zu: p50 %4u us  p99 %5u us  max %6u us  (%llu events, %llu dropped)\n",
+             impl, run, i, percentile(r.latencyUs, 0.5), percentile(r.latencyUs, 0.99),
+             r.latencyUs.empty() ? 0 : r.latencyUs.back(), (unsigned long long)r.received.load(),
+             (unsigned long long)dropped[i]);
+    }
+  }
+  if (!latency) {
+    printf("  %-6s %-10s %.3f M events/s published, %.3f M/s delivered, %llu dropped\n", impl, run,
+           published / seconds / 1e6, delivered / seconds / 1e6, (unsigned long long)lost);
+  }
+  if (!ok) printf("  %-6s %-10s ACCOUNTING MISMATCH\n", impl, run);
+  return ok;
+}
+
+/**
+ * @brief Throughput pacing: after each batch, wait for every subscriber to
+ *        have received everything published so far.
+ */
+static void waitCaughtUp(const std::vector<SubResult*>& subs, const std::atomic<uint64_t>& published) {
+  uint64_t target = published.load(std::memory_order_acquire);
+  for (SubResult* r : subs) {
+    while (r->received.load(std::memory_order_acquire) < target) std::this_thread::yield();
+  }
+}
+
+/**
+ * @brief Wait until an absolute time, sleeping for most of it.
+ */
+static void waitUntil(std::chrono::steady_clock::time_point t) {
+  auto now = std::chrono::steady_clock::now();
+  if (t - now > std::chrono::microseconds(100)) std::this_thread::sleep_until(t - std::chrono::microseconds(50));
+  while (std::chrono::steady_clock::now() < t) {}
+}
+
+// ============================================================================
+// Event Bus
+// ============================================================================
+
+/**
+ * @brief Subscriber thread context.
+ */
+struct BusCtx {
+  BusSubscriber sub;           /**< Bus subscriber. */
+  BusSlot slots[BENCH_DEPTH];  /**< Its ring. */
+  sem_t wake;                  /**< Given by the notify hook. */
+  SubResult result;            /**< Observations. */
+  bool keepLatency;            /**< Record latencies. */
+};
+
+/** @brief Notify hook: wake the subscriber thread. */
+static void wakeSubscriber(BusSubscriber*, void* ctx) {
+  sem_post(&static_cast<BusCtx*>(ctx)->wake);
+}
+
+/** @brief Handler: check order, record latency. */
+static void onSeq(const BusMsg* msg, void* ctx) {
+  BusCtx* c = static_cast<BusCtx*>(ctx);
+  const SeqEvent* e = busEvent<TOPIC_SEQ>(msg);
+  observe(&c->result, *e, busNowUs() - msg->timeUs, c->keepLatency);
+}
+
+/**
+ * @brief One run through the bus.
+ */
+static bool runBus(const char* run, int nSubs, int nPubs, uint32_t events, uint32_t pacingUs) {
+  std::vector<BusCtx*> ctx(nSubs);
+  std::vector<SubResult*> results(nSubs);
+  BusSubscriber* subs[BENCH_MAX] = {};
+  for (int i = 0; i < nSubs; i++) {
+    ctx[i] = new BusCtx();
+    BusCtx* c = ctx[i];
+    c->sub.name = "bench";
+    c->sub.topics = BUS_TOPIC(TOPIC_SEQ);
+    c->sub.slots = c->slots;
+    c->sub.depth = BENCH_DEPTH;
+    c->keepLatency = pacingUs > 0;
+    sem_init(&c->wake, 0, 0);
+    subs[i] = &c->sub;
+    results[i] = &c->result;
+  }
+  busInit(subs, nSubs);
+  for (int i = 0; i < nSubs; i++) busOnNotify(&ctx[i]->sub, wakeSubscriber, ctx[i]);
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < nSubs; i++) {
+    consumers.emplace_back([&, c = ctx[i]] {
+      while (!stop.load()) {
+        sem_wait(&c->wake);
+        busDrain(&c->sub, onSeq, c);
+      }
+      busDrain(&c->sub, onSeq, c);
+    });
+  }
+
+  std::atomic<uint64_t> published(0);
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> publishers;
+  for (int p = 0; p < nPubs; p++) {
+    publishers.emplace_back([&, p] {
+      auto next = std::chrono::steady_clock::now();
+      for (uint32_t s = 0; s < events; s++) {
+        if (pacingUs) {
+          next += std::chrono::microseconds(pacingUs);
+          waitUntil(next);
+        }
+        busPublish<TOPIC_SEQ>(SeqEvent{ (uint32_t)p, s, 1.0f });
+        published.fetch_add(1, std::memory_order_release);
+        if (!pacingUs && s % BENCH_BATCH == BENCH_BATCH - 1) waitCaughtUp(results, published);
+      }
+    });
+  }
+  for (auto& t : publishers) t.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  stop.store(true);
+  for (int i = 0; i < nSubs; i++) sem_post(&ctx[i]->wake);
+  for (auto& t : consumers) t.join();
+
+  uint64_t dropped[BENCH_MAX];
+  for (int i = 0; i < nSubs; i++) dropped[i] = ctx[i]->sub.dropped.load();
+  bool ok = report("bus", run, results, (uint64_t)events * nPubs, dropped, seconds, pacingUs > 0);
+  for (int i = 0; i < nSubs; i++) {
+    sem_destroy(&ctx[i]->wake);
+    delete ctx[i];
+  }
+  return ok;
+}
+
+// ============================================================================
+// Mutex Reference
+// ============================================================================
+
+/**
+ * @brief Subscriber of the reference fan-out: a locked queue of copies.
+ */
+struct LockedCtx {
+  std::mutex lock;                  /**< Guards queue. */
+  std::condition_variable ready;    /**< Signalled on push. */
+  std::deque<std::pair<SeqEvent, uint32_t>> queue;  /**< Events and publish times. */
+  uint64_t dropped = 0;             /**< Events refused on a full queue. */
+  SubResult result;                 /**< Observations. */
+};
+
+/**
+ * @brief One run through the reference fan-out.
+ */
+static bool runLocked(const char* run, int nSubs, int nPubs, uint32_t events, uint32_t pacingUs) {
+  std::vector<LockedCtx*> ctx(nSubs);
+  std::vector<SubResult*> results(nSubs);
+  for (int i = 0; i < nSubs; i++) {
+    ctx[i] = new LockedCtx();
+    results[i] = &ctx[i]->result;
+  }
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < nSubs; i++) {
+    consumers.emplace_back([&, c = ctx[i]] {
+      std::unique_lock<std::mutex> l(c->lock);
+      for (;;) {
+        c->ready.wait(l, [&] { return !c->queue.empty() || stop.load(); });
+        while (!c->queue.empty()) {
+          std::pair<SeqEvent, uint32_t> item = c->queue.front();
+          c->queue.pop_front();
+          observe(&c->result, item.first, busNowUs() - item.second, pacingUs > 0);
+        }
+        if (stop.load()) break;
+      }
+    });
+  }
+
+  std::atomic<uint64_t> published(0);
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> publishers;
+  for (int p = 0; p < nPubs; p++) {
+    publishers.emplace_back([&, p] {
+      auto next = std::chrono::steady_clock::now();
+      for (uint32_t s = 0; s < events; s++) {
+        if (pacingUs) {
+          next += std::chrono::microseconds(pacingUs);
+          waitUntil(next);
+        }
+        SeqEvent e = { (uint32_t)p, s, 1.0f };
+        uint32_t now = busNowUs();
+        for (LockedCtx* c : ctx) {
+          {
+            std::lock_guard<std::mutex> l(c->lock);
+            if (c->queue.size() >= BENCH_DEPTH) {
+              c->dropped++;
+              continue;
+            }
+            c->queue.emplace_back(e, now);
+          }
+          c->ready.notify_one();
+        }
+        published.fetch_add(1, std::memory_order_release);
+        if (!pacingUs && s % BENCH_BATCH == BENCH_BATCH - 1) waitCaughtUp(results, published);
+      }
+    });
+  }
+  for (auto& t : publishers) t.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  stop.store(true);
+  for (LockedCtx* c : ctx) {
+    std::lock_guard<std::mutex> l(c->lock);
+    c->ready.notify_one();
+  }
+  for (auto& t : consumers) t.join();
+
+  uint64_t dropped[BENCH_MAX];
+  for (int i = 0; i < nSubs; i++) dropped[i] = ctx[i]->dropped;
+  bool ok = report("locked", run, results, (uint64_t)events * nPubs, dropped, seconds, pacingUs > 0);
+  for (LockedCtx* c : ctx) delete c;
+  return ok;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  int nSubs = argc > 1 ? atoi(argv[1]) : 4;
+  int nPubs = argc > 2 ? atoi(argv[2]) : 2;
+  uint32_t events = argc > 3 ? (uint32_t)atoi(argv[3]) : 200000;
+  uint32_t pacingUs = argc > 4 ? (uint32_t)atoi(argv[4]) : 200;
+  if (nSubs < 1 || nSubs > BENCH_MAX || nPubs < 1 || nPubs > BENCH_MAX || events == 0) {
+    fprintf(stderr, "usage: %s [subscribers 1-%d] [publishers 1-%d] [events] [pacingUs]\n",
+            argv[0], BENCH_MAX, BENCH_MAX);
+    return 2;
+  }
+  uint32_t pacedEvents = std::min<uint32_t>(events, 5000);
+
+  printf("%d subscribers, %d publishers, ring depth %d, %u hardware threads\n", nSubs, nPubs,
+         BENCH_DEPTH, std::thread::hardware_concurrency());
+  bool ok = true;
+  printf("latency (%u events per publisher, one every %u us):\n", pacedEvents, pacingUs);
+  ok &= runBus("latency", nSubs, nPubs, pacedEvents, pacingUs ? pacingUs : 200);
+  ok &= runLocked("latency", nSubs, nPubs, pacedEvents, pacingUs ? pacingUs : 200);
+  printf("throughput (%u events per publisher):\n", events);
+  ok &= runBus("throughput", nSubs, nPubs, events, 0);
+  ok &= runLocked("throughput", nSubs, nPubs, events, 0);
+  return ok ? 0 : 1;
+}
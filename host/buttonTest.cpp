@@ -0,0 +1,181 @@
+/**
+ * @file buttonTest.cpp
+ * @brief Replays a recorded button edge trace through the Tracker's debounce
+ *        and gesture state machine (scanner/buttonInput.cpp).
+ *
+ * The replay does what the interrupt glue does on the device: each edge
+ * calls `buttonFsmEdge()` at its time and starts the 1 ms debounce timer if
+ * it is stopped; each timer tick reads the pin and calls `buttonFsmTick()`,
+ * and the timer stops once the state machine asks for no more ticks. The
+ * gestures posted must be exactly the trace's `expect` rows, with the same
+ * names and times. The trace is replayed twice: from its own times, and
+ * shifted so that the 32-bit microsecond counter wraps in the middle of it.
+ *
+ * Reported: edges, raw presses (falling edges, as a debouncer-less reader
+ * would count them), gestures, and the timer ticks the debouncer took.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 buttonTest.cpp ../scanner/buttonInput.cpp -o buttonTest
+ *
+ * Usage:
+ *
+ *     buttonTest [trace.csv]
+ *
+ * The trace defaults to `traces/lostButton.csv` (see its header for the row
+ * layout). The test exits with status 1 if any gesture differs.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../scanner/buttonInput.h"
+
+// ============================================================================
+// Trace
+// ============================================================================
+
+/**
+ * @brief A pin change.
+ */
+struct Edge {
+  uint32_t us;       /**< Time of the change. */
+  bool     pressed;  /**< Level after it (pin low). */
+};
+
+/**
+ * @brief A gesture, expected or posted.
+ */
+struct Gesture {
+  uint32_t    us;    /**< Gesture time. */
+  std::string name;  /**< buttonEventName(). */
+};
+
+/**
+ * @brief Load a trace.
+ *
+ * @return False if the file cannot be read or a row is malformed.
+ */
+static bool loadTrace(const char* path, std::vector<Edge>* edges, std::vector<Gesture>* expect) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[128];
+  unsigned row = 0;
+  bool ok = true;
+  while (fgets(line, sizeof(line), f)) {
+    row++;
+    if (line[0] == '#' || line[0] == '\n') continue;
+    unsigned long us;
+    char value[32];
+    if (sscanf(line, "edge,%lu,%31s", &us, value) == 2) {
+      edges->push_back(Edge{ (uint32_t)us, value[0] == '0' });
+    } else if (sscanf(line, "expect,%lu,%31s", &us, value) == 2) {
+      expect->push_back(Gesture{ (uint32_t)us, value });
+    } else {
+      fprintf(stderr, "%s:%u: bad row\n", path, row);
+      ok = false;
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+static void record(uint8_t, uint8_t event, uint32_t timeUs, void* ctx) {
+  ((std::vector<Gesture>*)ctx)->push_back(Gesture{ timeUs, buttonEventName(event) });
+}
+
+/**
+ * @brief Replay the edges shifted by `offsetUs`, as the interrupts see them.
+ *
+ * @param[out] ticks Debounce timer ticks taken.
+ * @return Gestures posted.
+ */
+static std::vector<Gesture> replay(const std::vector<Edge>& edges, uint32_t offsetUs, uint32_t* ticks) {
+  std::vector<Gesture> out;
+  ButtonFsm fsm;
+  buttonFsmInit(&fsm);
+  bool level = false, running = false;
+  uint64_t nextTick = 0;
+  *ticks = 0;
+
+  size_t i = 0;
+  for (;;) {
+    // Ticks due before the next edge (a tick due at the same time runs first)
+    while (running && (i == edges.size() || nextTick <= edges[i].us)) {
+      (*ticks)++;
+      running = buttonFsmTick(&fsm, level, (uint32_t)nextTick + offsetUs, 0, record, &out);
+      nextTick += BUTTON_TICK_US;
+    }
+    if (i == edges.size()) break;
+    level = edges[i].pressed;
+    buttonFsmEdge(&fsm, edges[i].us + offsetUs);
+    if (!running) {
+      running = true;
+      nextTick = (uint64_t)edges[i].us + BUTTON_TICK_US;
+    }
+    i++;
+  }
+  return out;
+}
+
+/**
+ * @brief Compare posted gestures with the expected ones.
+ *
+ * @return Number of differences.
+ */
+static unsigned compare(const std::vector<Gesture>& got, const std::vector<Gesture>& expect, uint32_t offsetUs) {
+  unsigned wrong = 0;
+  size_t n = got.size() > expect.size() ? got.size() : expect.size();
+  for (size_t k = 0; k < n; k++) {
+    const Gesture* g = k < got.size() ? &got[k] : nullptr;
+    const Gesture* e = k < expect.size() ? &expect[k] : nullptr;
+    if (g && e && g->name == e->name && g->us == e->us + offsetUs) continue;
+    if (wrong++ < 10) {
+      printf("    #%zu expected %s at %u us, got %s at %u us\n", k, e ? e->name.c_str() : "nothing",
+             e ? e->us + offsetUs : 0, g ? g->name.c_str() : "nothing", g ? g->us : 0);
+    }
+  }
+  return wrong;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "traces/lostButton.csv";
+  std::vector<Edge> edges;
+  std::vector<Gesture> expect;
+  if (!loadTrace(path, &edges, &expect)) return 2;
+  if (edges.empty()) {
+    fprintf(stderr, "buttonTest: %s has no edges\n", path);
+    return 2;
+  }
+
+  unsigned falls = 0;
+  for (const Edge& e : edges) falls += e.pressed;
+  uint32_t spanUs = edges.back().us - edges.front().us;
+  printf("buttonTest: %s: %zu edges over %.1f s, %u raw presses, %zu gestures expected\n", path, edges.size(),
+         spanUs / 1e6, falls, expect.size());
+
+  // Shifted so the counter wraps halfway through the trace
+  const uint32_t offsets[] = { 0, 0u - (edges.front().us + spanUs / 2) };
+  unsigned wrong = 0;
+  for (uint32_t offset : offsets) {
+    uint32_t ticks;
+    std::vector<Gesture> got = replay(edges, offset, &ticks);
+    unsigned w = compare(got, expect, offset);
+    printf("  %-18s %zu gestures, %u timer ticks (%.1f ms of %.1f s), %s\n",
+           offset ? "across the wrap:" : "from trace times:", got.size(), ticks, ticks * BUTTON_TICK_US / 1e3,
+           spanUs / 1e6, w ? "WRONG" : "ok");
+    wrong += w;
+  }
+  if (wrong) fprintf(stderr, "buttonTest: %u gestures differ\n", wrong);
+  return wrong ? 1 : 0;
+}
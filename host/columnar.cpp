@@ -0,0 +1,301 @@
+/**
+ * @file columnar.cpp
+ * @brief Writer and mmap reader for the columnar session format.
+ *
+ * On-disk layout details:
+ *
+ *     FileHeader  64 bytes: "ATCOL002", u32 version, zero padding
+ *     block data  per block, per column: values[rows], each array 64-byte aligned
+ *     footer      64-byte aligned:
+ *                   u32 ncols, u32 nblocks
+ *                   ColumnSpec cols[ncols]
+ *                   per block: u64 rows, ColumnChunk chunks[ncols]
+ *     trailer     u64 footerOffset, "ATCOLEND"
+ *
+ * Build into a tool with:
+ *
+ *     g++ -std=c++17 -O2 -c columnar.cpp
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "columnar.h"
+
+// ============================================================================
+// Layout
+// ============================================================================
+
+/** @brief File header magic. */
+static const char HEADER_MAGIC[8] = { 'A', 'T', 'C', 'O', 'L', '0', '0', '2' };
+
+/** @brief Trailer magic. */
+static const char TRAILER_MAGIC[8] = { 'A', 'T', 'C', 'O', 'L', 'E', 'N', 'D' };
+
+/** @brief Format version. */
+#define COLUMNAR_VERSION 1
+
+/** @brief Size of the file header. */
+#define HEADER_LEN 64
+
+/** @brief Size of the trailer. */
+#define TRAILER_LEN 16
+
+/** @brief Alignment of column arrays and the footer. */
+#define COLUMNAR_ALIGN 64
+
+static_assert(sizeof(ColumnSpec) == 32, "ColumnSpec is stored verbatim");
+static_assert(sizeof(ColumnChunk) == 24, "ColumnChunk is stored verbatim");
+
+/**
+ * @brief Size of one footer block entry.
+ */
+static size_t blockEntryLen(uint32_t ncols) {
+  return sizeof(uint64_t) + ncols * sizeof(ColumnChunk);
+}
+
+size_t columnarTypeSize(uint8_t type) {
+  switch (type) {
+    case COL_INT16:   return 2;
+    case COL_INT64:   return 8;
+    case COL_FLOAT32: return 4;
+    case COL_UINT8:   return 1;
+    default:          return 0;
+  }
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+/**
+ * @brief Write bytes, tracking the offset and the error state.
+ */
+static void writeBytes(ColumnarWriter* w, const void* p, size_t n) {
+  if (n == 0 || w->failed) return;
+  if (fwrite(p, 1, n, w->f) != n) w->failed = true;
+  w->offset += n;
+}
+
+/**
+ * @brief Pad the file with zeros up to the next alignment boundary.
+ */
+static void writePad(ColumnarWriter* w) {
+  static const uint8_t zeros[COLUMNAR_ALIGN] = { 0 };
+  size_t pad = (size_t)((COLUMNAR_ALIGN - (w->offset % COLUMNAR_ALIGN)) % COLUMNAR_ALIGN);
+  writeBytes(w, zeros, pad);
+}
+
+/**
+ * @brief Compute min/max of a column array as doubles.
+ */
+static void columnStats(uint8_t type, const uint8_t* data, size_t rows, double* mn, double* mx) {
+  double lo = 0, hi = 0;
+  for (size_t i = 0; i < rows; i++) {
+    double v;
+    switch (type) {
+      case COL_INT16:   v = ((const int16_t*)data)[i]; break;
+      case COL_INT64:   v = (double)((const int64_t*)data)[i]; break;
+      case COL_FLOAT32: v = ((const float*)data)[i]; break;
+      default:          v = data[i]; break;
+    }
+    if (i == 0 || v < lo) lo = v;
+    if (i == 0 || v > hi) hi = v;
+  }
+  *mn = lo;
+  *mx = hi;
+}
+
+/**
+ * @brief Write the pending rows as one block and record its footer entry.
+ */
+static void flushBlock(ColumnarWriter* w) {
+  if (w->buffered == 0) return;
+
+  if (w->nblocks == w->metaCap) {
+    w->metaCap = w->metaCap ? w->metaCap * 2 : 64;
+    w->meta = (uint8_t*)realloc(w->meta, w->metaCap * blockEntryLen(w->ncols));
+  }
+  uint8_t* entry = w->meta + w->nblocks * blockEntryLen(w->ncols);
+  uint64_t rows = w->buffered;
+  memcpy(entry, &rows, sizeof(rows));
+
+  for (uint32_t c = 0; c < w->ncols; c++) {
+    writePad(w);
+    ColumnChunk chunk;
+    chunk.offset = w->offset;
+    columnStats(w->cols[c].type, w->buf[c], w->buffered, &chunk.min, &chunk.max);
+    memcpy(entry + sizeof(uint64_t) + c * sizeof(ColumnChunk), &chunk, sizeof(chunk));
+    writeBytes(w, w->buf[c], w->buffered * columnarTypeSize(w->cols[c].type));
+  }
+  w->nblocks++;
+  w->buffered = 0;
+}
+
+bool columnarWriterOpen(ColumnarWriter* w, const char* path, const ColumnSpec* cols,
+                        uint32_t ncols, uint32_t blockRows) {
+  memset(w, 0, sizeof(*w));
+  if (ncols == 0 || ncols > COLUMNAR_MAX_COLUMNS) return false;
+  for (uint32_t c = 0; c < ncols; c++) {
+    if (columnarTypeSize(cols[c].type) == 0) return false;
+  }
+
+  w->f = fopen(path, "wb");
+  if (!w->f) return false;
+  w->ncols = ncols;
+  memcpy(w->cols, cols, ncols * sizeof(ColumnSpec));
+  w->blockRows = blockRows ? blockRows : COLUMNAR_DEFAULT_BLOCK_ROWS;
+  for (uint32_t c = 0; c < ncols; c++) {
+    w->cols[c].name[COLUMNAR_NAME_LEN - 1] = '\0';
+    w->buf[c] = (uint8_t*)malloc((size_t)w->blockRows * columnarTypeSize(cols[c].type));
+  }
+
+  uint8_t header[HEADER_LEN] = { 0 };
+  uint32_t version = COLUMNAR_VERSION;
+  memcpy(header, HEADER_MAGIC, 8);
+  memcpy(header + 8, &version, 4);
+  writeBytes(w, header, sizeof(header));
+  return !w->failed;
+}
+
+bool columnarWriterAppend(ColumnarWriter* w, size_t rows, const void* const* columns) {
+  size_t done = 0;
+  while (done < rows) {
+    size_t take = w->blockRows - w->buffered;
+    if (take > rows - done) take = rows - done;
+    for (uint32_t c = 0; c < w->ncols; c++) {
+      size_t sz = columnarTypeSize(w->cols[c].type);
+      memcpy(w->buf[c] + w->buffered * sz, (const uint8_t*)columns[c] + done * sz, take * sz);
+    }
+    w->buffered += (uint32_t)take;
+    done += take;
+    if (w->buffered == w->blockRows) flushBlock(w);
+  }
+  return !w->failed;
+}
+
+bool columnarWriterClose(ColumnarWriter* w) {
+  flushBlock(w);
+
+  writePad(w);
+  uint64_t footer = w->offset;
+  writeBytes(w, &w->ncols, 4);
+  writeBytes(w, &w->nblocks, 4);
+  writeBytes(w, w->cols, w->ncols * sizeof(ColumnSpec));
+  writeBytes(w, w->meta, w->nblocks * blockEntryLen(w->ncols));
+  writeBytes(w, &footer, 8);
+  writeBytes(w, TRAILER_MAGIC, 8);
+
+  bool ok = !w->failed;
+  if (fclose(w->f) != 0) ok = false;
+  for (uint32_t c = 0; c < w->ncols; c++) free(w->buf[c]);
+  free(w->meta);
+  memset(w, 0, sizeof(*w));
+  return ok;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+bool columnarReaderOpen(ColumnarReader* r, const char* path) {
+  memset(r, 0, sizeof(*r));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_LEN + TRAILER_LEN) {
+    close(fd);
+    return false;
+  }
+  void* m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) return false;
+
+  r->base = (const uint8_t*)m;
+  r->size = (size_t)st.st_size;
+
+  uint64_t footer;
+  memcpy(&footer, r->base + r->size - TRAILER_LEN, 8);
+  bool ok = memcmp(r->base, HEADER_MAGIC, 8) == 0 &&
+            memcmp(r->base + r->size - 8, TRAILER_MAGIC, 8) == 0 &&
+            footer % COLUMNAR_ALIGN == 0 && footer + 8 <= r->size - TRAILER_LEN;
+  if (ok) {
+    memcpy(&r->ncols, r->base + footer, 4);
+    memcpy(&r->nblocks, r->base + footer + 4, 4);
+    r->cols = (const ColumnSpec*)(r->base + footer + 8);
+    r->blocks = (const uint8_t*)(r->cols + r->ncols);
+    ok = r->ncols > 0 && r->ncols <= COLUMNAR_MAX_COLUMNS &&
+         r->blocks + (size_t)r->nblocks * blockEntryLen(r->ncols) <= r->base + r->size - TRAILER_LEN;
+  }
+  if (!ok) {
+    columnarReaderClose(r);
+    return false;
+  }
+
+  for (uint32_t b = 0; b < r->nblocks; b++) r->rows += columnarBlockRows(r, b);
+  madvise((void*)r->base, r->size, MADV_SEQUENTIAL);
+  return true;
+}
+
+void columnarReaderClose(ColumnarReader* r) {
+  if (r->base) munmap((void*)r->base, r->size);
+  memset(r, 0, sizeof(*r));
+}
+
+int columnarFindColumn(const ColumnarReader* r, const char* name) {
+  for (uint32_t c = 0; c < r->ncols; c++) {
+    if (strncmp(r->cols[c].name, name, COLUMNAR_NAME_LEN) == 0) return (int)c;
+  }
+  return -1;
+}
+
+uint32_t columnarBlockRows(const ColumnarReader* r, uint32_t block) {
+  uint64_t rows;
+  memcpy(&rows, r->blocks + block * blockEntryLen(r->ncols), 8);
+  return (uint32_t)rows;
+}
+
+const ColumnChunk* columnarChunk(const ColumnarReader* r, uint32_t block, uint32_t col) {
+  return (const ColumnChunk*)(r->blocks + block * blockEntryLen(r->ncols) + 8 +
+                              col * sizeof(ColumnChunk));
+}
+
+const void* columnarColumn(const ColumnarReader* r, uint32_t block, uint32_t col) {
+  return r->base + columnarChunk(r, block, col)->offset;
+}
+
+/**
+ * @brief First row in a sorted timestamp array with value >= t.
+ */
+static uint32_t lowerBound(const int64_t* ts, uint32_t n, int64_t t) {
+  uint32_t lo = 0, hi = n;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (ts[mid] < t) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+uint64_t columnarScanTime(const ColumnarReader* r, int64_t t0, int64_t t1,
+                          ColumnarRangeFn fn, void* ctx) {
+  if (r->ncols == 0 || r->cols[0].type != COL_INT64 || t1 < t0) return 0;
+  uint64_t matched = 0;
+  for (uint32_t b = 0; b < r->nblocks; b++) {
+    const ColumnChunk* stats = columnarChunk(r, b, 0);
+    if (stats->max < (double)t0 || stats->min > (double)t1) continue;
+
+    const int64_t* ts = (const int64_t*)columnarColumn(r, b, 0);
+    uint32_t n = columnarBlockRows(r, b);
+    uint32_t begin = lowerBound(ts, n, t0);
+    uint32_t end = t1 == INT64_MAX ? n : lowerBound(ts, n, t1 + 1);
+    if (begin < end) {
+      fn(r, b, begin, end, ctx);
+      matched += end - begin;
+    }
+  }
+  return matched;
+}
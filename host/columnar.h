@@ -0,0 +1,196 @@
+/**
+ * @file columnar.h
+ * @brief Memory-mappable columnar file format for recorded sessions.
+ *
+ * A file is a sequence of row blocks followed by a footer index:
+ *
+ *     +-------------+---------+---------+-----+--------+---------+
+ *     | FileHeader  | block 0 | block 1 | ... | footer | trailer |
+ *     +-------------+---------+---------+-----+--------+---------+
+ *
+ * Each block stores every column as one contiguous, 64-byte aligned array of
+ * fixed-width values. The footer holds the schema and, per block and column,
+ * the data offset and min/max statistics. Readers `mmap` the file, locate the
+ * footer through the trailer and hand out direct pointers into the mapping;
+ * no value is ever parsed or copied.
+ *
+ * By convention column 0 is a non-decreasing `COL_INT64` timestamp, which
+ * lets time-range scans skip whole blocks using their statistics.
+ *
+ * All integers are little-endian.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/** @brief Maximum number of columns in a file. */
+#define COLUMNAR_MAX_COLUMNS 16
+
+/** @brief Maximum column name length including the terminator. */
+#define COLUMNAR_NAME_LEN 24
+
+/** @brief Default number of rows per block. */
+#define COLUMNAR_DEFAULT_BLOCK_ROWS 65536
+
+/**
+ * @brief Column value types.
+ */
+enum ColType : uint8_t {
+  COL_INT16   = 1,  /**< int16_t, e.g. raw IMU register values. */
+  COL_INT64   = 2,  /**< int64_t, e.g. timestamps in ms. */
+  COL_FLOAT32 = 3,  /**< float, e.g. distance or filtered values. */
+  COL_UINT8   = 4,  /**< uint8_t, e.g. flags. */
+};
+
+/**
+ * @brief Column definition, stored verbatim in the footer (32 bytes).
+ */
+struct ColumnSpec {
+  char    name[COLUMNAR_NAME_LEN]; /**< NUL-terminated column name. */
+  uint8_t type;                    /**< ColType. */
+  uint8_t pad[7];                  /**< Reserved, zero. */
+};
+
+/**
+ * @brief Location and statistics of one column within one block (24 bytes).
+ */
+struct ColumnChunk {
+  uint64_t offset;  /**< File offset of the first value. */
+  double   min;     /**< Smallest value in the chunk. */
+  double   max;     /**< Largest value in the chunk. */
+};
+
+/**
+ * @brief Streaming writer state.
+ */
+struct ColumnarWriter {
+  FILE*       f;                                /**< Output file. */
+  uint32_t    ncols;                            /**< Number of columns. */
+  ColumnSpec  cols[COLUMNAR_MAX_COLUMNS];       /**< Schema. */
+  uint32_t    blockRows;                        /**< Rows per full block. */
+  uint32_t    buffered;                         /**< Rows in the pending block. */
+  uint8_t*    buf[COLUMNAR_MAX_COLUMNS];        /**< Pending block, per column. */
+  uint64_t    offset;                           /**< Current file offset. */
+  uint32_t    nblocks;                          /**< Blocks written. */
+  uint32_t    metaCap;                          /**< Capacity of `meta` in blocks. */
+  uint8_t*    meta;                             /**< Footer block entries written so far. */
+  bool        failed;                           /**< An I/O error occurred. */
+};
+
+/**
+ * @brief Read-only view of a mapped file.
+ */
+struct ColumnarReader {
+  const uint8_t*    base;     /**< Start of the mapping. */
+  size_t            size;     /**< Mapping length. */
+  uint32_t          ncols;    /**< Number of columns. */
+  uint32_t          nblocks;  /**< Number of blocks. */
+  const ColumnSpec* cols;     /**< Schema (points into the mapping). */
+  const uint8_t*    blocks;   /**< Footer block entries (points into the mapping). */
+  uint64_t          rows;     /**< Total rows. */
+};
+
+/**
+ * @brief Callback for a contiguous run of rows matched by a time scan.
+ *
+ * @param[in] r     Reader.
+ * @param[in] block Block index.
+ * @param[in] begin First matching row within the block.
+ * @param[in] end   One past the last matching row.
+ * @param[in] ctx   User context.
+ */
+typedef void (*ColumnarRangeFn)(const ColumnarReader* r, uint32_t block,
+                                uint32_t begin, uint32_t end, void* ctx);
+
+/**
+ * @brief Size in bytes of one value of a column type.
+ */
+size_t columnarTypeSize(uint8_t type);
+
+/**
+ * @brief Create a file and start writing.
+ *
+ * @param[out] w         Writer state.
+ * @param[in]  path      Output path.
+ * @param[in]  cols      Schema.
+ * @param[in]  ncols     Number of columns (<= COLUMNAR_MAX_COLUMNS).
+ * @param[in]  blockRows Rows per block (0 selects the default).
+ * @return True on success.
+ */
+bool columnarWriterOpen(ColumnarWriter* w, const char* path, const ColumnSpec* cols,
+                        uint32_t ncols, uint32_t blockRows);
+
+/**
+ * @brief Append rows given as one array per column.
+ *
+ * @param[in,out] w       Writer state.
+ * @param[in]     rows    Number of rows.
+ * @param[in]     columns Array of `ncols` pointers, each to `rows` values of
+ *                        the column's type.
+ * @return True on success.
+ */
+bool columnarWriterAppend(ColumnarWriter* w, size_t rows, const void* const* columns);
+
+/**
+ * @brief Flush the pending block, write the footer and close the file.
+ *
+ * @param[in,out] w Writer state.
+ * @return True if every write succeeded.
+ */
+bool columnarWriterClose(ColumnarWriter* w);
+
+/**
+ * @brief Map a file and validate its footer.
+ *
+ * @param[out] r    Reader state.
+ * @param[in]  path File path.
+ * @return True on success.
+ */
+bool columnarReaderOpen(ColumnarReader* r, const char* path);
+
+/**
+ * @brief Unmap a file.
+ */
+void columnarReaderClose(ColumnarReader* r);
+
+/**
+ * @brief Find a column by name.
+ *
+ * @return Column index, or -1 if absent.
+ */
+int columnarFindColumn(const ColumnarReader* r, const char* name);
+
+/**
+ * @brief Number of rows in a block.
+ */
+uint32_t columnarBlockRows(const ColumnarReader* r, uint32_t block);
+
+/**
+ * @brief Statistics and location of one column chunk.
+ */
+const ColumnChunk* columnarChunk(const ColumnarReader* r, uint32_t block, uint32_t col);
+
+/**
+ * @brief Pointer to a column's values within a block.
+ *
+ * Cast to the column's type; the pointer is 64-byte aligned.
+ */
+const void* columnarColumn(const ColumnarReader* r, uint32_t block, uint32_t col);
+
+/**
+ * @brief Visit the rows whose timestamp (column 0) lies in [t0, t1].
+ *
+ * Blocks are skipped using their min/max statistics; within a candidate
+ * block the boundaries are found by binary search.
+ *
+ * @param[in] r   Reader.
+ * @param[in] t0  Inclusive range start.
+ * @param[in] t1  Inclusive range end.
+ * @param[in] fn  Callback per matching row run.
+ * @param[in] ctx User context.
+ * @return Number of rows matched.
+ */
+uint64_t columnarScanTime(const ColumnarReader* r, int64_t t0, int64_t t1,
+                          ColumnarRangeFn fn, void* ctx);
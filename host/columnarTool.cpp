@@ -0,0 +1,353 @@
+/**
+ * @file columnarTool.cpp
+ * @brief Convert, inspect and scan columnar session files.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 columnarTool.cpp columnar.cpp -o columnarTool
+ *
+ * Usage:
+ *
+ *     columnarTool import <in.csv> <out.col> [blockRows]
+ *     columnarTool info   <file.col>
+ *     columnarTool scan   <file.col> <column> [t0] [t1]
+ *     columnarTool bench  <file.csv> <file.col> <column>
+ *
+ * `import` expects a CSV header of `name:type` fields, type being one of
+ * int16, int64, float or uint8, with the int64 timestamp first, e.g.
+ * `ts:int64,ax:int16,ay:int16,az:int16,rssi:int16,distance:float`.
+ *
+ * `scan` reports count/min/max/mean of one column over the rows whose
+ * timestamp lies in [t0, t1]. `bench` runs the same full-file aggregate
+ * over the CSV (parsing every line) and over the mapped columnar file.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "columnar.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Parse a type name used in CSV headers.
+ *
+ * @return ColType, or 0 if unknown.
+ */
+static uint8_t parseType(const char* s) {
+  if (strcmp(s, "int16") == 0) return COL_INT16;
+  if (strcmp(s, "int64") == 0) return COL_INT64;
+  if (strcmp(s, "float") == 0) return COL_FLOAT32;
+  if (strcmp(s, "uint8") == 0) return COL_UINT8;
+  return 0;
+}
+
+/**
+ * @brief Printable type name.
+ */
+static const char* typeName(uint8_t type) {
+  switch (type) {
+    case COL_INT16:   return "int16";
+    case COL_INT64:   return "int64";
+    case COL_FLOAT32: return "float";
+    case COL_UINT8:   return "uint8";
+    default:          return "?";
+  }
+}
+
+/**
+ * @brief Read value `i` of a column array as a double.
+ */
+static double valueAt(uint8_t type, const void* data, uint32_t i) {
+  switch (type) {
+    case COL_INT16:   return ((const int16_t*)data)[i];
+    case COL_INT64:   return (double)((const int64_t*)data)[i];
+    case COL_FLOAT32: return ((const float*)data)[i];
+    default:          return ((const uint8_t*)data)[i];
+  }
+}
+
+/**
+ * @brief Running aggregate of one column.
+ */
+struct Aggregate {
+  int      col;    /**< Column index. */
+  uint8_t  type;   /**< Column type. */
+  uint64_t count;  /**< Values seen. */
+  double   min;    /**< Smallest value. */
+  double   max;    /**< Largest value. */
+  double   sum;    /**< Sum of values. */
+};
+
+/**
+ * @brief Add one value to an aggregate.
+ */
+static void aggregateAdd(Aggregate* a, double v) {
+  if (a->count == 0 || v < a->min) a->min = v;
+  if (a->count == 0 || v > a->max) a->max = v;
+  a->sum += v;
+  a->count++;
+}
+
+/**
+ * @brief Scan callback: fold a run of rows into the aggregate.
+ */
+static void aggregateRange(const ColumnarReader* r, uint32_t block, uint32_t begin,
+                           uint32_t end, void* ctx) {
+  Aggregate* a = (Aggregate*)ctx;
+  const void* data = columnarColumn(r, block, (uint32_t)a->col);
+  for (uint32_t i = begin; i < end; i++) aggregateAdd(a, valueAt(a->type, data, i));
+}
+
+/**
+ * @brief Print an aggregate.
+ */
+static void aggregatePrint(const Aggregate* a) {
+  printf("count %llu  min %.6g  max %.6g  mean %.6g\n", (unsigned long long)a->count,
+         a->min, a->max, a->count ? a->sum / a->count : 0.0);
+}
+
+/**
+ * @brief Open a file and resolve a column name, reporting errors.
+ */
+static bool openColumn(ColumnarReader* r, const char* path, const char* name, Aggregate* a) {
+  if (!columnarReaderOpen(r, path)) {
+    fprintf(stderr, "%s: not a columnar file\n", path);
+    return false;
+  }
+  memset(a, 0, sizeof(*a));
+  a->col = columnarFindColumn(r, name);
+  if (a->col < 0) {
+    fprintf(stderr, "%s: no column '%s'\n", path, name);
+    columnarReaderClose(r);
+    return false;
+  }
+  a->type = r->cols[a->col].type;
+  return true;
+}
+
+// ============================================================================
+// Commands
+// ============================================================================
+
+/**
+ * @brief Convert a typed CSV file into a columnar file.
+ */
+static int cmdImport(const char* in, const char* out, uint32_t blockRows) {
+  FILE* f = fopen(in, "r");
+  if (!f) {
+    perror(in);
+    return 1;
+  }
+
+  char line[4096];
+  if (!fgets(line, sizeof(line), f)) {
+    fprintf(stderr, "%s: empty\n", in);
+    fclose(f);
+    return 1;
+  }
+  ColumnSpec cols[COLUMNAR_MAX_COLUMNS];
+  memset(cols, 0, sizeof(cols));
+  uint32_t ncols = 0;
+  for (char* tok = strtok(line, ",\r\n"); tok; tok = strtok(nullptr, ",\r\n")) {
+    char* colon = strchr(tok, ':');
+    if (!colon || ncols == COLUMNAR_MAX_COLUMNS) {
+      fprintf(stderr, "%s: bad header field '%s'\n", in, tok);
+      fclose(f);
+      return 1;
+    }
+    *colon = '\0';
+    strncpy(cols[ncols].name, tok, COLUMNAR_NAME_LEN - 1);
+    cols[ncols].type = parseType(colon + 1);
+    ncols++;
+  }
+  if (ncols == 0 || cols[0].type != COL_INT64) {
+    fprintf(stderr, "%s: first column must be an int64 timestamp\n", in);
+    fclose(f);
+    return 1;
+  }
+
+  ColumnarWriter w;
+  if (!columnarWriterOpen(&w, out, cols, ncols, blockRows)) {
+    fprintf(stderr, "%s: cannot create\n", out);
+    fclose(f);
+    return 1;
+  }
+
+  // Stage rows in small per-column batches
+  const size_t BATCH = 4096;
+  std::vector<uint8_t> batch[COLUMNAR_MAX_COLUMNS];
+  const void* ptrs[COLUMNAR_MAX_COLUMNS];
+  for (uint32_t c = 0; c < ncols; c++) batch[c].resize(BATCH * columnarTypeSize(cols[c].type));
+
+  size_t pending = 0;
+  uint64_t rows = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    char* p = line;
+    for (uint32_t c = 0; c < ncols; c++) {
+      uint8_t* dst = &batch[c][pending * columnarTypeSize(cols[c].type)];
+      switch (cols[c].type) {
+        case COL_INT16: { int16_t v = (int16_t)strtol(p, &p, 10); memcpy(dst, &v, 2); break; }
+        case COL_INT64: { int64_t v = strtoll(p, &p, 10);         memcpy(dst, &v, 8); break; }
+        case COL_FLOAT32: { float v = strtof(p, &p);              memcpy(dst, &v, 4); break; }
+        default: *dst = (uint8_t)strtoul(p, &p, 10); break;
+      }
+      if (*p == ',') p++;
+    }
+    if (++pending == BATCH) {
+      for (uint32_t c = 0; c < ncols; c++) ptrs[c] = batch[c].data();
+      ok = columnarWriterAppend(&w, pending, ptrs);
+      rows += pending;
+      pending = 0;
+    }
+  }
+  for (uint32_t c = 0; c < ncols; c++) ptrs[c] = batch[c].data();
+  ok = ok && columnarWriterAppend(&w, pending, ptrs);
+  rows += pending;
+  fclose(f);
+
+  if (!columnarWriterClose(&w) || !ok) {
+    fprintf(stderr, "%s: write failed\n", out);
+    return 1;
+  }
+  printf("%llu rows, %u columns\n", (unsigned long long)rows, ncols);
+  return 0;
+}
+
+/**
+ * @brief Print schema and block statistics.
+ */
+static int cmdInfo(const char* path) {
+  ColumnarReader r;
+  if (!columnarReaderOpen(&r, path)) {
+    fprintf(stderr, "%s: not a columnar file\n", path);
+    return 1;
+  }
+  printf("%llu rows, %u blocks, %zu bytes\n", (unsigned long long)r.rows, r.nblocks, r.size);
+  for (uint32_t c = 0; c < r.ncols; c++) {
+    double mn = 0, mx = 0;
+    for (uint32_t b = 0; b < r.nblocks; b++) {
+      const ColumnChunk* s = columnarChunk(&r, b, c);
+      if (b == 0 || s->min < mn) mn = s->min;
+      if (b == 0 || s->max > mx) mx = s->max;
+    }
+    printf("  %-24s %-6s min %.6g  max %.6g\n", r.cols[c].name, typeName(r.cols[c].type), mn, mx);
+  }
+  columnarReaderClose(&r);
+  return 0;
+}
+
+/**
+ * @brief Aggregate one column over a time range.
+ */
+static int cmdScan(const char* path, const char* name, int64_t t0, int64_t t1) {
+  ColumnarReader r;
+  Aggregate a;
+  if (!openColumn(&r, path, name, &a)) return 1;
+  double start = nowSec();
+  columnarScanTime(&r, t0, t1, aggregateRange, &a);
+  double secs = nowSec() - start;
+  aggregatePrint(&a);
+  printf("%.3f ms\n", secs * 1000);
+  columnarReaderClose(&r);
+  return 0;
+}
+
+/**
+ * @brief Compare a full-file aggregate over CSV against the columnar file.
+ */
+static int cmdBench(const char* csv, const char* path, const char* name) {
+  ColumnarReader r;
+  Aggregate a;
+  if (!openColumn(&r, path, name, &a)) return 1;
+
+  FILE* f = fopen(csv, "r");
+  if (!f) {
+    perror(csv);
+    columnarReaderClose(&r);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  double csvBytes = (double)ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  // CSV: every line must be split and the column converted
+  Aggregate c = a;
+  char line[4096];
+  double start = nowSec();
+  bool header = true;
+  while (fgets(line, sizeof(line), f)) {
+    if (header) {
+      header = false;
+      continue;
+    }
+    char* p = line;
+    for (int i = 0; i < c.col && p; i++) {
+      p = strchr(p, ',');
+      if (p) p++;
+    }
+    if (p) aggregateAdd(&c, strtod(p, nullptr));
+  }
+  double csvSecs = nowSec() - start;
+  fclose(f);
+
+  start = nowSec();
+  columnarScanTime(&r, INT64_MIN, INT64_MAX, aggregateRange, &a);
+  double colSecs = nowSec() - start;
+
+  double colBytes = (double)a.count * columnarTypeSize(a.type);
+  printf("csv      ");
+  aggregatePrint(&c);
+  printf("columnar ");
+  aggregatePrint(&a);
+  printf("csv      %8.1f ms  %8.1f Mrows/s  %8.1f MB/s\n", csvSecs * 1000,
+         c.count / csvSecs / 1e6, csvBytes / csvSecs / 1e6);
+  printf("columnar %8.1f ms  %8.1f Mrows/s  %8.1f MB/s\n", colSecs * 1000,
+         a.count / colSecs / 1e6, colBytes / colSecs / 1e6);
+  columnarReaderClose(&r);
+  return 0;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 4 && strcmp(argv[1], "import") == 0) {
+    return cmdImport(argv[2], argv[3], argc > 4 ? (uint32_t)atoi(argv[4]) : 0);
+  }
+  if (argc >= 3 && strcmp(argv[1], "info") == 0) {
+    return cmdInfo(argv[2]);
+  }
+  if (argc >= 4 && strcmp(argv[1], "scan") == 0) {
+    int64_t t0 = argc > 4 ? strtoll(argv[4], nullptr, 10) : INT64_MIN;
+    int64_t t1 = argc > 5 ? strtoll(argv[5], nullptr, 10) : INT64_MAX;
+    return cmdScan(argv[2], argv[3], t0, t1);
+  }
+  if (argc >= 5 && strcmp(argv[1], "bench") == 0) {
+    return cmdBench(argv[2], argv[3], argv[4]);
+  }
+  fprintf(stderr,
+          "usage: %s import <in.csv> <out.col> [blockRows]\n"
+          "       %s info   <file.col>\n"
+          "       %s scan   <file.col> <column> [t0] [t1]\n"
+          "       %s bench  <file.csv> <file.col> <column>\n",
+          argv[0], argv[0], argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,301 @@
+/**
+ * @file configStress.cpp
+ * @brief Concurrency stress and read cost of the configuration store's
+ *        lock-free reads (scanner/config.cpp, shared with the tag).
+ *
+ * Reader threads call `configRead()` in a loop while writer threads publish
+ * new structs with `configReplace()`. Each published struct carries its
+ * writer, that writer's sequence number and six fields derived from both,
+ * so a reader can tell a consistent snapshot from a torn one (fields of two
+ * writes) and can check that, per writer, it never sees an older write
+ * after a newer one. Reported per run: reads per second, the mean cost of
+ * a read (thread CPU time, so it holds when the threads share cores),
+ * callback re-runs per million reads, and faults.
+ *
+ * Runs, for `seconds` each: readers alone; against one writer publishing
+ * 1000 times a second (far above any real setting change); and against
+ * all writers publishing flat out. The readers of the last run also sample
+ * the published copy without validating it, to show what the retry
+ * guards against (this count is not a fault).
+ *
+ * Before the runs, the cost of reading two fields on one thread is timed
+ * for `configRead()`, a plain global, and a mutex-protected copy.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 -pthread configStress.cpp ../scanner/config.cpp -o configStress
+ *
+ * Usage:
+ *
+ *     configStress [readers] [writers] [seconds]
+ *
+ * Readers default to 4, writers to 2, seconds to 2. The tool exits with
+ * status 1 if any validated snapshot is torn or goes back in time.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../scanner/config.h"
+
+/** @brief Writers told apart by the readers. */
+#define STRESS_MAX_WRITERS 16
+
+/** @brief Reads per timed batch of a reader thread. */
+#define STRESS_BATCH 64
+
+/** @brief Reads timed per single-thread measurement. */
+#define STRESS_TIMED_READS 50000000
+
+// ============================================================================
+// Store Under Test
+// ============================================================================
+
+/**
+ * @brief A 32-byte struct, the size of the tracker's AppConfig.
+ */
+struct StressConfig {
+  int32_t  writer;   /**< Writer that published it. */
+  uint32_t seq;      /**< That writer's sequence number. */
+  uint32_t mix[6];   /**< Derived from writer and seq. */
+};
+
+static StressConfig gBuf[2];
+static ConfigStore gStore = { { &gBuf[0], &gBuf[1] }, sizeof(StressConfig), nullptr, 0, nullptr, "stress", {} };
+
+static uint32_t mixOf(int32_t writer, uint32_t seq, int i) {
+  uint32_t x = (uint32_t)writer * 0x9E3779B1u ^ seq * 0x85EBCA77u ^ (uint32_t)i * 0xC2B2AE3Du;
+  x ^= x >> 15;
+  return x * 0x2C1B3C6Du;
+}
+
+static StressConfig make(int32_t writer, uint32_t seq) {
+  StressConfig c;
+  c.writer = writer;
+  c.seq = seq;
+  for (int i = 0; i < 6; i++) c.mix[i] = mixOf(writer, seq, i);
+  return c;
+}
+
+static bool consistent(const StressConfig& c) {
+  if (c.writer < 0 || c.writer >= STRESS_MAX_WRITERS) return false;
+  for (int i = 0; i < 6; i++) {
+    if (c.mix[i] != mixOf(c.writer, c.seq, i)) return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Keeps the compiler from dropping timed reads. */
+static volatile uint32_t gSink;
+
+// ============================================================================
+// Single-Thread Read Cost
+// ============================================================================
+
+static StressConfig gPlain;
+static std::mutex gPlainLock;
+
+static void timeReads() {
+  const int n = STRESS_TIMED_READS;
+  uint32_t acc = 0;
+
+  double t0 = nowSec();
+  for (int i = 0; i < n; i++) {
+    configRead<StressConfig>(&gStore, [&](const StressConfig& c) { acc += c.seq + c.mix[3]; });
+  }
+  double seqlockNs = (nowSec() - t0) * 1e9 / n;
+
+  t0 = nowSec();
+  for (int i = 0; i < n; i++) {
+    acc += gPlain.seq + gPlain.mix[3];
+    asm volatile("" ::: "memory");  // reload the global every time
+  }
+  double plainNs = (nowSec() - t0) * 1e9 / n;
+
+  t0 = nowSec();
+  for (int i = 0; i < n / 10; i++) {
+    gPlainLock.lock();
+    StressConfig c = gPlain;
+    gPlainLock.unlock();
+    acc += c.seq + c.mix[3];
+  }
+  double mutexNs = (nowSec() - t0) * 1e9 / (n / 10);
+  gSink = acc;
+
+  printf("  read of two fields, one thread: configRead %.2f ns, plain global %.2f ns, mutex + copy %.2f ns\n",
+         seqlockNs, plainNs, mutexNs);
+}
+
+// ============================================================================
+// Stress
+// ============================================================================
+
+/**
+ * @brief What one reader saw.
+ */
+struct ReaderResult {
+  uint64_t reads;       /**< Completed configRead() calls. */
+  uint64_t calls;       /**< Callback runs (reads + re-runs). */
+  uint64_t torn;        /**< Validated snapshots that were inconsistent. */
+  uint64_t backwards;   /**< Snapshots older than one already seen from the same writer. */
+  uint64_t rawReads;    /**< Unvalidated samples taken. */
+  uint64_t rawTorn;     /**< Of which inconsistent. */
+  double   cpuSec;      /**< Thread CPU time spent in the timed reads. */
+};
+
+static std::atomic<bool> gStop;
+
+static double threadCpuSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void reader(ReaderResult* r, bool sampleRaw) {
+  uint32_t lastSeq[STRESS_MAX_WRITERS];
+  bool seen[STRESS_MAX_WRITERS] = {};
+  StressConfig batch[STRESS_BATCH];
+  memset(r, 0, sizeof(*r));
+  while (!gStop.load(std::memory_order_relaxed)) {
+    // Timed: a batch of reads, each copying the struct out as a caller would
+    uint64_t calls = 0;
+    double t0 = threadCpuSec();
+    for (int i = 0; i < STRESS_BATCH; i++) {
+      configRead<StressConfig>(&gStore, [&](const StressConfig& s) {
+        batch[i] = s;
+        calls++;
+      });
+    }
+    r->cpuSec += threadCpuSec() - t0;
+    r->reads += STRESS_BATCH;
+    r->calls += calls;
+
+    // Untimed: check every snapshot of the batch
+    for (const StressConfig& c : batch) {
+      if (!consistent(c)) {
+        r->torn++;
+        continue;
+      }
+      if (seen[c.writer] && c.seq < lastSeq[c.writer]) r->backwards++;
+      seen[c.writer] = true;
+      lastSeq[c.writer] = c.seq;
+    }
+    if (sampleRaw) {
+      // What a reader without the retry would get
+      StressConfig raw;
+      memcpy(&raw, configCurrent(&gStore, configReadBegin(&gStore)), sizeof(raw));
+      r->rawReads++;
+      r->rawTorn += !consistent(raw);
+    }
+  }
+}
+
+static void writer(int id, uint32_t perSecond, uint64_t* writes) {
+  uint32_t seq = 0;
+  double next = nowSec();
+  while (!gStop.load(std::memory_order_relaxed)) {
+    StressConfig c = make(id, ++seq);
+    configReplace(&gStore, &c);
+    if (perSecond) {
+      next += 1.0 / perSecond;
+      double wait = next - nowSec();
+      if (wait > 0) {
+        struct timespec ts = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+        nanosleep(&ts, nullptr);
+      }
+    }
+  }
+  *writes = seq;
+}
+
+/**
+ * @brief One stress run.
+ *
+ * @return Faults found.
+ */
+static uint64_t run(const char* name, int readers, int writers, uint32_t perSecond, double seconds) {
+  StressConfig init = make(0, 0);
+  configInit(&gStore, &init);
+  gStop = false;
+
+  std::vector<ReaderResult> rr(readers);
+  std::vector<uint64_t> ww(writers);
+  std::vector<std::thread> threads;
+  bool sampleRaw = writers > 0 && perSecond == 0;
+  double t0 = nowSec();
+  for (int i = 0; i < readers; i++) threads.emplace_back(reader, &rr[i], sampleRaw);
+  for (int i = 0; i < writers; i++) threads.emplace_back(writer, i, perSecond, &ww[i]);
+  struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+  nanosleep(&ts, nullptr);
+  gStop = true;
+  for (std::thread& t : threads) t.join();
+  double elapsed = nowSec() - t0;
+
+  ReaderResult sum = {};
+  for (const ReaderResult& r : rr) {
+    sum.reads += r.reads;
+    sum.calls += r.calls;
+    sum.torn += r.torn;
+    sum.backwards += r.backwards;
+    sum.rawReads += r.rawReads;
+    sum.rawTorn += r.rawTorn;
+    sum.cpuSec += r.cpuSec;
+  }
+  uint64_t writes = 0;
+  for (uint64_t w : ww) writes += w;
+
+  // Read cost in thread CPU time, so it holds when threads share a core
+  printf("  %-18s %9.0f writes/s  %6.1f M reads/s  %6.2f ns/read  %8.2f re-runs/M  torn %llu  backwards %llu\n",
+         name, writes / elapsed, sum.reads / elapsed / 1e6, sum.cpuSec * 1e9 / sum.reads,
+         sum.reads ? (sum.calls - sum.reads) * 1e6 / sum.reads : 0.0, (unsigned long long)sum.torn,
+         (unsigned long long)sum.backwards);
+  if (sampleRaw) {
+    printf("  %-18s unvalidated samples torn: %llu of %llu\n", "", (unsigned long long)sum.rawTorn,
+           (unsigned long long)sum.rawReads);
+  }
+  return sum.torn + sum.backwards;
+}
+
+int main(int argc, char** argv) {
+  int readers = argc > 1 ? atoi(argv[1]) : 4;
+  int writers = argc > 2 ? atoi(argv[2]) : 2;
+  double seconds = argc > 3 ? atof(argv[3]) : 2;
+  if (readers < 1 || writers < 1 || writers > STRESS_MAX_WRITERS || seconds <= 0) {
+    fprintf(stderr, "usage: configStress [readers] [writers (1..%d)] [seconds]\n", STRESS_MAX_WRITERS);
+    return 2;
+  }
+
+  printf("configStress: %u hardware threads, %d readers, %d writers, %zu-byte struct, %.1f s per run\n",
+         std::thread::hardware_concurrency(), readers, writers, sizeof(StressConfig), seconds);
+  StressConfig init = make(0, 0);
+  configInit(&gStore, &init);
+  gPlain = init;
+  timeReads();
+
+  uint64_t faults = 0;
+  faults += run("no writer:", readers, 0, 0, seconds);
+  faults += run("1 writer, 1 kHz:", readers, 1, 1000, seconds);
+  char name[32];
+  snprintf(name, sizeof(name), "%d writers, flat:", writers);
+  faults += run(name, readers, writers, 0, seconds);
+
+  if (faults) fprintf(stderr, "configStress: %llu faults\n", (unsigned long long)faults);
+  return faults ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file configTool.cpp
+ * @brief Host-side tool to read and change the tracker's runtime configuration.
+ *
+ * Talks to the tracker over its USB-CDC serial port with the export link's
+ * framed CONFIG_GET / CONFIG_SET messages and prints the values the tracker
+ * reports back (see scanner/configTable.h for the keys).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -I../scanner configTool.cpp ../scanner/exportFrame.cpp -o configTool
+ *
+ * Usage:
+ *
+ *     configTool <serial-device> [key=value ...]
+ *
+ * Without assignments the current values are printed. Each assignment is
+ * sent in turn; the tool exits non-zero if any was not accepted.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "exportFrame.h"
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/** @brief Time to wait for the tracker's reply (ms). */
+#define CONFIG_REPLY_MS 2000
+
+/** @brief Status names, indexed by the status byte (ConfigStatus). */
+static const char* const STATUS_NAMES[] = { "ok", "unknown key", "bad value", "rejected" };
+
+// ============================================================================
+// Serial Link
+// ============================================================================
+
+/**
+ * @brief Open a serial device in raw 8N1 mode.
+ *
+ * @param[in] path Device path (e.g. /dev/ttyACM0).
+ * @return File descriptor, or -1 on error.
+ */
+static int openSerial(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+/**
+ * @brief Write a whole buffer.
+ */
+static bool writeAll(int fd, const uint8_t* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n <= 0) return false;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+/**
+ * @brief Monotonic clock in milliseconds.
+ */
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+/**
+ * @brief Send one configuration message and wait for CONFIG_STATE.
+ *
+ * Log text the tracker prints between frames is skipped by the decoder.
+ *
+ * @param[in]  fd     Serial port.
+ * @param[in]  type   CONFIG_GET or CONFIG_SET.
+ * @param[in]  text   Assignment for CONFIG_SET, nullptr for CONFIG_GET.
+ * @param[out] status Status byte of the reply.
+ * @param[out] values Reported "key=value" lines, NUL-terminated.
+ * @return False if no reply arrived in time.
+ */
+static bool exchange(int fd, uint8_t type, const char* text, uint8_t* status,
+                     char values[FRAME_MAX_PAYLOAD]) {
+  size_t textLen = text ? strlen(text) : 0;
+  uint8_t frame[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+  size_t frameLen = frameBuild(type, (const uint8_t*)text, textLen, frame);
+  if (frameLen == 0 || !writeAll(fd, frame, frameLen)) return false;
+
+  FrameDecoder dec;
+  frameDecoderReset(&dec);
+  uint64_t deadline = nowMs() + CONFIG_REPLY_MS;
+  while (nowMs() < deadline) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 100) <= 0) continue;
+    uint8_t buf[512];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    for (ssize_t i = 0; i < n; i++) {
+      uint8_t msg[FRAME_MAX_PAYLOAD];
+      size_t len;
+      if (!frameDecoderPush(&dec, buf[i], msg, &len)) continue;
+      if (msg[0] != CONFIG_STATE || len < 2) continue;
+      *status = msg[1];
+      memcpy(values, msg + 2, len - 2);
+      values[len - 2] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Name of a reply status byte.
+ */
+static const char* statusName(uint8_t status) {
+  return status < sizeof(STATUS_NAMES) / sizeof(STATUS_NAMES[0]) ? STATUS_NAMES[status] : "?";
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <serial-device> [key=value ...]\n", argv[0]);
+    return 2;
+  }
+  int fd = openSerial(argv[1]);
+  if (fd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  uint8_t status = 0;
+  char values[FRAME_MAX_PAYLOAD];
+  int failed = 0;
+  if (argc == 2) {
+    if (!exchange(fd, CONFIG_GET, nullptr, &status, values)) {
+      fprintf(stderr, "no reply from tracker\n");
+      close(fd);
+      return 1;
+    }
+  }
+  for (int i = 2; i < argc; i++) {
+    if (!exchange(fd, CONFIG_SET, argv[i], &status, values)) {
+      fprintf(stderr, "%s: no reply from tracker\n", argv[i]);
+      close(fd);
+      return 1;
+    }
+    printf("%s: %s\n", argv[i], statusName(status));
+    if (status != 0) failed++;
+  }
+  fputs(values, stdout);
+  close(fd);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,371 @@
+/**
+ * @file coroTest.cpp
+ * @brief Virtual-clock test of the Tracker's coroutine runtime
+ *        (scanner/coro.cpp) on its event loop (scanner/eventLoop.cpp).
+ *
+ * The loop is driven as on the device: advance, then sleep for the returned
+ * wait. Cases:
+ *
+ * - the RFID unlock flow of scanner.ino against a fake reader: a card shown
+ *   at an arbitrary time is read at the next 50 ms poll, the buzzer sounds
+ *   for exactly 500 ms and the Tracker unlocks; an unknown card does not
+ *   unlock, and the flow goes back to waiting each time;
+ * - events: a set while nobody waits is latched and consumed by the next
+ *   await, a set while waiting resumes at once, and a posted set (the path
+ *   of other tasks and ISRs) is delivered by the next advance;
+ * - frames: a coroutine that returns, at once or after awaiting, gives its
+ *   frame back, and the pool ends empty;
+ * - the pool: with CORO_FRAME_POOL coroutines waiting, the next one is
+ *   refused without running and counted, and starts once a frame is free;
+ * - frame sizes: each coroutine shape above is started alone and its frame
+ *   size checked against CORO_FRAME_SIZE. This host has 8-byte pointers
+ *   where the device has 4, so the device's frames are smaller still.
+ *
+ * The test exits with status 1 on any fault.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++20 -O2 coroTest.cpp ../scanner/coro.cpp ../scanner/eventLoop.cpp -o coroTest
+ *
+ * Usage:
+ *
+ *     coroTest
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../scanner/coro.h"
+
+/** @brief Poll period and beep length of the RFID flow (scanner.ino). */
+#define RFID_POLL_MS 50
+#define RFID_BEEP_MS 500
+
+// ============================================================================
+// Virtual Clock and Checks
+// ============================================================================
+
+/** @brief Virtual time (ms). */
+static uint32_t gNow = 0;
+
+/** @brief Faults found. */
+static unsigned gFaults = 0;
+
+static void check(bool ok, const char* what) {
+  if (ok) return;
+  gFaults++;
+  printf("  FAULT %s (t=%u)\n", what, gNow);
+}
+
+/** @brief Run the loop until `endMs`, sleeping for each returned wait. */
+static void runUntil(uint32_t endMs) {
+  for (;;) {
+    uint32_t wait = eventLoopAdvance(gNow);
+    if (wait == LOOP_NO_TIMER || gNow + wait > endMs) break;
+    gNow += wait;
+  }
+  gNow = endMs;
+  eventLoopAdvance(gNow);
+}
+
+/** @brief Restart the loop and the runtime, as appLoopTask does. */
+static void reset() {
+  gNow = 0;
+  eventLoopInit(gNow);
+  coroInit();
+}
+
+static uint32_t framesInUse() {
+  CoroStats st;
+  coroGetStats(&st);
+  return st.inUse;
+}
+
+// ============================================================================
+// RFID Flow
+// ============================================================================
+
+/**
+ * @brief Fake reader and actuators seen by the flow.
+ */
+static struct {
+  bool     cardWaiting;   /**< A card is held to the reader. */
+  uint8_t  uid[7];        /**< Its UID. */
+  uint8_t  uidSize;
+  bool     locked;
+  uint32_t toneOnMs;      /**< Time the buzzer started, UINT32_MAX if silent. */
+  uint32_t toneOffMs;     /**< Time it stopped last. */
+  uint32_t readMs;        /**< Time the last card was read. */
+  uint32_t reads;         /**< Cards read. */
+  char     printed[64];   /**< Last UID line. */
+} gRfid;
+
+static const uint8_t AUTHORIZED_UID[] = { 0x04, 0x81, 0x70, 0x0A, 0x9C, 0x14, 0x90 };
+
+static bool cardPresented(void*) {
+  if (!gRfid.locked || !gRfid.cardWaiting) return false;
+  gRfid.cardWaiting = false;
+  gRfid.readMs = gNow;
+  gRfid.reads++;
+  return true;
+}
+
+static bool isAuthorized() {
+  return gRfid.uidSize == sizeof(AUTHORIZED_UID) && memcmp(gRfid.uid, AUTHORIZED_UID, gRfid.uidSize) == 0;
+}
+
+/** @brief Append to the printed UID line, as Serial.print() does. */
+static void printUid(const char* fmt, unsigned value = 0) {
+  if (fmt[0] == 'U') gRfid.printed[0] = '\0';
+  size_t len = strlen(gRfid.printed);
+  snprintf(gRfid.printed + len, sizeof(gRfid.printed) - len, fmt, value);
+}
+
+/**
+ * @brief The flow of scanner.ino, with the reader and buzzer faked.
+ */
+static CoroTask rfidFlow() {
+  for (;;) {
+    co_await coroPoll(cardPresented, nullptr, RFID_POLL_MS);
+
+    printUid("UID:");
+    for (uint8_t i = 0; i < gRfid.uidSize; i++) printUid(" %02X", gRfid.uid[i]);
+
+    if (!isAuthorized()) continue;
+    gRfid.toneOnMs = gNow;
+    co_await coroDelay(RFID_BEEP_MS);
+    gRfid.toneOffMs = gNow;
+    gRfid.locked = false;
+  }
+}
+
+static void showCard(const uint8_t* uid, uint8_t size) {
+  memcpy(gRfid.uid, uid, size);
+  gRfid.uidSize = size;
+  gRfid.cardWaiting = true;
+}
+
+static void testUnlock() {
+  unsigned before = gFaults;
+  reset();
+  memset(&gRfid, 0, sizeof(gRfid));
+  gRfid.locked = true;
+  gRfid.toneOnMs = UINT32_MAX;
+  rfidFlow();
+  check(framesInUse() == 1, "flow waits in its frame");
+
+  // An unknown card is read and printed, but does not unlock
+  static const uint8_t stranger[] = { 0xDE, 0xAD, 0xBE, 0xEF };
+  runUntil(1017);
+  showCard(stranger, sizeof(stranger));
+  runUntil(2000);
+  check(gRfid.reads == 1 && gRfid.readMs >= 1017 && gRfid.readMs < 1017 + RFID_POLL_MS, "unknown card read");
+  check(strcmp(gRfid.printed, "UID: DE AD BE EF") == 0, "unknown card printed");
+  check(gRfid.locked && gRfid.toneOnMs == UINT32_MAX, "unknown card refused");
+
+  // The authorised card: a 500 ms beep from the read, then unlocked
+  uint32_t shown = 3333;
+  runUntil(shown);
+  showCard(AUTHORIZED_UID, sizeof(AUTHORIZED_UID));
+  runUntil(shown + RFID_POLL_MS);
+  check(gRfid.reads == 2 && gRfid.readMs >= shown && gRfid.readMs < shown + RFID_POLL_MS, "card read at next poll");
+  check(gRfid.toneOnMs == gRfid.readMs, "beep starts at the read");
+  check(gRfid.locked, "still locked while beeping");
+  runUntil(gRfid.readMs + RFID_BEEP_MS - 1);
+  check(gRfid.locked && gRfid.toneOffMs == 0, "locked until 500 ms");
+  runUntil(gRfid.readMs + RFID_BEEP_MS);
+  check(!gRfid.locked && gRfid.toneOffMs == gRfid.readMs + RFID_BEEP_MS, "unlocked at 500 ms");
+  printf("  unlock: card at %u ms, read at %u, beep %u ms, unlocked at %u ms\n", shown, gRfid.readMs,
+         gRfid.toneOffMs - gRfid.toneOnMs, gRfid.toneOffMs);
+
+  // Unlocked, a card is ignored; locked again, the flow reads the next one
+  showCard(AUTHORIZED_UID, sizeof(AUTHORIZED_UID));
+  runUntil(gNow + 10 * RFID_POLL_MS);
+  check(gRfid.reads == 2, "no read while unlocked");
+  gRfid.locked = true;
+  runUntil(gNow + RFID_POLL_MS);
+  check(gRfid.reads == 3, "flow waits again after unlocking");
+  check(framesInUse() == 1, "flow keeps one frame");
+  printf("  unlock flow %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+// ============================================================================
+// Events and Frames
+// ============================================================================
+
+/** @brief Values received by `waitEvent`, in order. */
+static uint32_t gGot[8];
+static unsigned gGotCount = 0;
+
+static CoroTask waitEvent(CoroEvent* event, unsigned times) {
+  for (unsigned i = 0; i < times; i++) {
+    uint32_t v = co_await *event;
+    if (gGotCount < 8) gGot[gGotCount++] = v;
+  }
+}
+
+static CoroTask returnAtOnce(bool* ran) {
+  *ran = true;
+  co_return;
+}
+
+static CoroTask delayLoop(unsigned times, uint32_t ms, unsigned* done) {
+  for (unsigned i = 0; i < times; i++) {
+    co_await coroDelay(ms);
+    (*done)++;
+  }
+}
+
+static void testEvents() {
+  unsigned before = gFaults;
+  reset();
+  static CoroEvent event;
+  check(coroEventInit(&event), "event registered");
+  gGotCount = 0;
+
+  // Latched: set before anyone waits, consumed by the first await
+  coroEventSet(&event, 11);
+  waitEvent(&event, 3);
+  check(gGotCount == 1 && gGot[0] == 11, "latched set consumed by the await");
+  check(!event.set, "latch cleared");
+
+  // Set while waiting: resumes at once
+  coroEventSet(&event, 22);
+  check(gGotCount == 2 && gGot[1] == 22, "set resumes the waiter");
+
+  // Posted: delivered by the next advance, not before
+  check(coroEventPost(&event, 33), "post queued");
+  check(gGotCount == 2, "post not delivered before the loop runs");
+  runUntil(gNow + 1);
+  check(gGotCount == 3 && gGot[2] == 33, "post delivered by the loop");
+  check(framesInUse() == 0, "waiter's frame released on return");
+
+  // A posted set with nobody waiting is latched too
+  check(coroEventPostFromISR(&event, 44, nullptr), "ISR post queued");
+  runUntil(gNow + 1);
+  check(event.set && event.value == 44, "posted set latched");
+  waitEvent(&event, 1);
+  check(gGotCount == 4 && gGot[3] == 44, "latched post consumed");
+  printf("  events %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+static void testFrames() {
+  unsigned before = gFaults;
+  reset();
+  bool ran = false;
+  returnAtOnce(&ran);
+  check(ran && framesInUse() == 0, "frame released by a coroutine returning at once");
+
+  unsigned done[3] = { 0, 0, 0 };
+  delayLoop(1, 100, &done[0]);
+  delayLoop(3, 70, &done[1]);
+  delayLoop(2, 1000, &done[2]);
+  check(framesInUse() == 3, "three frames while waiting");
+  runUntil(100);
+  check(done[0] == 1 && framesInUse() == 2, "frame released after the first delay loop");
+  runUntil(210);
+  check(done[1] == 3 && framesInUse() == 1, "frame released after the second");
+  runUntil(2000);
+  check(done[2] == 2 && framesInUse() == 0, "pool empty at the end");
+  CoroStats st;
+  coroGetStats(&st);
+  check(st.peak == 3 && st.failures == 0, "peak and failures");
+  printf("  frames %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+static void testPool() {
+  unsigned before = gFaults;
+  reset();
+  static CoroEvent events[CORO_FRAME_POOL];
+  gGotCount = 0;
+  for (int i = 0; i < CORO_FRAME_POOL; i++) {
+    coroEventInit(&events[i]);
+    waitEvent(&events[i], 1);
+  }
+  check(framesInUse() == CORO_FRAME_POOL, "pool full");
+
+  bool ran = false;
+  returnAtOnce(&ran);
+  CoroStats st;
+  coroGetStats(&st);
+  check(!ran, "refused coroutine does not run");
+  check(st.failures == 1 && st.inUse == CORO_FRAME_POOL, "refusal counted");
+
+  coroEventSet(&events[3], 3);
+  check(framesInUse() == CORO_FRAME_POOL - 1, "frame freed");
+  returnAtOnce(&ran);
+  check(ran, "coroutine starts once a frame is free");
+  for (int i = 0; i < CORO_FRAME_POOL; i++) coroEventSet(&events[i], (uint32_t)i);
+  check(framesInUse() == 0, "pool empty at the end");
+  printf("  pool: coroutine %d refused with %d waiting, started after a release %s\n", CORO_FRAME_POOL + 1,
+         CORO_FRAME_POOL, gFaults == before ? "ok" : "FAIL");
+}
+
+// ============================================================================
+// Frame Sizes
+// ============================================================================
+
+/** @brief Frame size requested by the shape just started. */
+static uint32_t frameOf(void (*start)()) {
+  reset();
+  start();
+  CoroStats st;
+  coroGetStats(&st);
+  return st.largestFrame;
+}
+
+static void startRfid() {
+  gRfid.locked = false;
+  rfidFlow();
+}
+
+static void startDelay() {
+  static unsigned done;
+  delayLoop(1, 10, &done);
+}
+
+static void startEvent() {
+  static CoroEvent event;
+  coroEventInit(&event);
+  waitEvent(&event, 1);
+}
+
+static void startReturn() {
+  static bool ran;
+  returnAtOnce(&ran);
+}
+
+static void testFrameSizes() {
+  static const struct {
+    const char* name;
+    void (*start)();
+  } shapes[] = {
+    { "rfid flow",  startRfid },
+    { "delay loop", startDelay },
+    { "event wait", startEvent },
+    { "no await",   startReturn },
+  };
+  printf("  frame sizes (host, 8-byte pointers) against CORO_FRAME_SIZE %d:\n", CORO_FRAME_SIZE);
+  for (const auto& s : shapes) {
+    uint32_t size = frameOf(s.start);
+    bool fits = size > 0 && size <= CORO_FRAME_SIZE;
+    printf("    %-10s %4u B  %s\n", s.name, size, fits ? "fits" : "TOO LARGE");
+    check(fits, s.name);
+  }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main() {
+  printf("coroTest: pool %d x %d B\n", CORO_FRAME_POOL, CORO_FRAME_SIZE);
+  testUnlock();
+  testEvents();
+  testFrames();
+  testPool();
+  testFrameSizes();
+  if (gFaults) fprintf(stderr, "coroTest: %u faults\n", gFaults);
+  return gFaults ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+/**
+ * @file eventLoopTest.cpp
+ * @brief Virtual-clock test of the Tracker's event loop (scanner/eventLoop.cpp).
+ *
+ * The loop is driven as `eventLoopRun()` drives it on the device: advance,
+ * then sleep for the returned wait. Since the wait is exact for level-0
+ * timers and a lower bound otherwise, every timer must fire during the
+ * advance whose time is its expiry; a callback firing at any other time,
+ * a timer firing twice or not at all, is a fault. Cases:
+ *
+ * - one-shot timers with delays either side of each level boundary (63, 64,
+ *   65 ms, 4095, 4096, 4097 ms, ...) started at tick offsets either side of
+ *   the level's cascade boundary;
+ * - a timer across the 32-bit millisecond wrap;
+ * - the wake-ups `eventLoopAdvance()` asks for with only a higher-level
+ *   timer pending, which must stop at level boundaries (and are counted);
+ * - callbacks that re-arm themselves with delay 0, 1 and 64 (the slot now
+ *   firing), stop a timer due in the same tick, and start another timer;
+ * - a randomised run against a reference model: timers started, restarted
+ *   and stopped from outside and from inside callbacks, periodic and
+ *   one-shot, with delays up to the top level.
+ *
+ * The test exits with status 1 on any fault.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 eventLoopTest.cpp ../scanner/eventLoop.cpp -o eventLoopTest
+ *
+ * Usage:
+ *
+ *     eventLoopTest [randomSteps]
+ *
+ * Random steps default to 200000.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../scanner/eventLoop.h"
+
+/** @brief No fire expected. */
+#define NEVER UINT64_MAX
+
+/** @brief Timers in the randomised run. */
+#define RANDOM_TIMERS 64
+
+// ============================================================================
+// Virtual Clock and Probes
+// ============================================================================
+
+/** @brief Virtual time of the current advance (ms, unwrapped). */
+static uint64_t gNow = 0;
+
+/** @brief Wake-ups the driver slept for. */
+static uint64_t gWakeups = 0;
+
+/** @brief Faults found. */
+static unsigned gFaults = 0;
+
+/** @brief Report a fault; only the first few are printed. */
+static void fault(const char* what, uint64_t expected, uint64_t at) {
+  if (gFaults++ < 10) {
+    printf("  FAULT %s: expected %llu, at %llu\n", what, (unsigned long long)expected, (unsigned long long)at);
+  }
+}
+
+/**
+ * @brief A timer and the fire time the test expects of it.
+ */
+struct Probe {
+  LoopTimer   timer;   /**< Timer under test. */
+  uint64_t    expect;  /**< Next expected fire (unwrapped ms), NEVER if idle. */
+  uint32_t    period;  /**< Reload period. */
+  uint32_t    fires;   /**< Times fired. */
+  const char* name;    /**< Case name. */
+  void (*then)(Probe* p);  /**< Action run from the callback, or nullptr. */
+};
+
+/** @brief Fire time of a timer started now with `delayMs` (0 means the next tick). */
+static uint64_t dueAfter(uint32_t delayMs) {
+  return gNow + (delayMs ? delayMs : 1);
+}
+
+static void probeFired(LoopTimer*, void* ctx) {
+  Probe* p = (Probe*)ctx;
+  p->fires++;
+  if (gNow != p->expect) fault(p->name, p->expect, gNow);
+  p->expect = p->period ? gNow + p->period : NEVER;
+  if (p->then) p->then(p);
+}
+
+/** @brief Start a probe now. */
+static void probeStart(Probe* p, uint32_t delayMs, uint32_t periodMs) {
+  p->period = periodMs;
+  p->expect = dueAfter(delayMs);
+  loopTimerStart(&p->timer, delayMs, periodMs, probeFired, p);
+}
+
+/** @brief Stop a probe now. */
+static void probeStop(Probe* p) {
+  loopTimerStop(&p->timer);
+  p->expect = NEVER;
+}
+
+/**
+ * @brief Sleep-driven loop up to `endMs`: advance, then jump by the wait.
+ */
+static void runUntil(uint64_t endMs) {
+  for (;;) {
+    uint32_t wait = eventLoopAdvance((uint32_t)gNow);
+    if (wait == LOOP_NO_TIMER || gNow + wait > endMs) break;
+    gNow += wait;
+    gWakeups++;
+  }
+  gNow = endMs;
+  eventLoopAdvance((uint32_t)gNow);
+}
+
+/** @brief Check that every probe fired as often as expected and is now idle. */
+static void expectIdle(Probe* probes, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (probes[i].expect != NEVER) fault(probes[i].name, probes[i].expect, gNow);
+  }
+}
+
+/** @brief Restart the loop at unwrapped time `startMs`. */
+static void reset(uint64_t startMs) {
+  gNow = startMs;
+  eventLoopInit((uint32_t)startMs);
+  gWakeups = 0;
+}
+
+// ============================================================================
+// Cases
+// ============================================================================
+
+/**
+ * @brief One-shot timers either side of every level boundary.
+ */
+static void testBoundaries() {
+  static const uint32_t offsets[] = { 0, 1, 62, 63, 64, 4094, 4095, 4096, 262143, 262144 };
+  unsigned before = gFaults, cases = 0;
+  for (uint32_t offset : offsets) {
+    for (int level = 1; level < LOOP_WHEEL_LEVELS; level++) {
+      uint32_t edge = 1u << (6 * level);
+      Probe probes[3] = {};
+      reset(1000000);
+      runUntil(gNow + offset);
+      for (int k = 0; k < 3; k++) {
+        probes[k].name = "boundary";
+        probeStart(&probes[k], edge - 1 + k, 0);
+      }
+      runUntil(gNow + edge + 2);
+      for (Probe& p : probes) {
+        if (p.fires != 1) fault("boundary fired", 1, p.fires);
+      }
+      expectIdle(probes, 3);
+      cases += 3;
+    }
+  }
+  printf("boundaries:  %u timers (delays 2^6l-1..2^6l+1 at %zu tick offsets) %s\n", cases,
+         sizeof(offsets) / sizeof(offsets[0]), gFaults == before ? "ok" : "FAIL");
+}
+
+/**
+ * @brief A periodic timer running across the 32-bit millisecond wrap.
+ */
+static void testWrap() {
+  unsigned before = gFaults;
+  Probe p = {};
+  p.name = "wrap";
+  reset(0xFFFFFFFFull - 5000);
+  probeStart(&p, 1000, 1000);
+  runUntil(gNow + 20000);
+  if (p.fires != 20) fault("wrap fires", 20, p.fires);
+  printf("wrap:        periodic 1000 ms across 2^32 ms, %u fires %s\n", p.fires, gFaults == before ? "ok" : "FAIL");
+}
+
+/**
+ * @brief Wake-ups requested with a single timer pending at each level.
+ */
+static void testWakeups() {
+  unsigned before = gFaults;
+  printf("wake-ups:    delay        wake-ups  (single pending timer)\n");
+  static const uint32_t delays[] = { 50, 4000, 250000, 3600000 };
+  for (uint32_t delay : delays) {
+    Probe p = {};
+    p.name = "wake-up";
+    reset(777);
+    probeStart(&p, delay, 0);
+    runUntil(gNow + delay + 10);
+    if (p.fires != 1) fault("wake-up fires", 1, p.fires);
+    // Level boundaries crossed plus the final level-0 wait
+    uint64_t bound = delay / 64 + 2;
+    if (gWakeups > bound) fault("wake-ups", bound, gWakeups);
+    printf("             %8u ms  %8llu\n", delay, (unsigned long long)gWakeups);
+  }
+  // Nothing pending: the loop must not ask to be woken
+  reset(0);
+  if (eventLoopAdvance(0) != LOOP_NO_TIMER) fault("idle wait", LOOP_NO_TIMER, 0);
+  printf("             idle wait LOOP_NO_TIMER %s\n", gFaults == before ? "ok" : "FAIL");
+}
+
+static Probe gRearm[6];
+
+static void rearmSelf0(Probe* p)   { if (p->fires < 5) probeStart(p, 0, 0); }
+static void rearmSelf1(Probe* p)   { if (p->fires < 5) probeStart(p, 1, 0); }
+static void rearmSelf64(Probe* p)  { if (p->fires < 5) probeStart(p, 64, 0); }
+static void stopAndStart(Probe*) {
+  probeStop(&gRearm[4]);
+  probeStart(&gRearm[5], 0, 0);
+}
+
+/**
+ * @brief Callbacks re-arming, stopping and starting timers.
+ */
+static void testRearm() {
+  unsigned before = gFaults;
+  reset(5000);
+  for (Probe& p : gRearm) p = Probe();
+  const char* names[] = { "rearm 0", "rearm 1", "rearm 64", "stop sibling", "stopped sibling", "started sibling" };
+  void (*thens[])(Probe*) = { rearmSelf0, rearmSelf1, rearmSelf64, stopAndStart, nullptr, nullptr };
+  for (int i = 0; i < 6; i++) {
+    gRearm[i].name = names[i];
+    gRearm[i].then = thens[i];
+  }
+  probeStart(&gRearm[0], 10, 0);
+  probeStart(&gRearm[1], 10, 0);
+  probeStart(&gRearm[2], 10, 0);
+  probeStart(&gRearm[3], 100, 0);
+  probeStart(&gRearm[4], 100, 0);   // same tick as its stopper
+  runUntil(gNow + 1000);
+  const uint32_t want[6] = { 5, 5, 5, 1, 0, 1 };
+  for (int i = 0; i < 6; i++) {
+    if (gRearm[i].fires != want[i]) fault(names[i], want[i], gRearm[i].fires);
+  }
+  expectIdle(gRearm, 6);
+  printf("re-arm:      delay 0/1/64 from the callback, stop and start in the same tick %s\n",
+         gFaults == before ? "ok" : "FAIL");
+}
+
+/** @brief Deterministic xorshift64* stream. */
+static uint64_t gRng = 0x510e527fade682d1ULL;
+static uint64_t next64() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return gRng * 0x2545f4914f6cdd1dULL;
+}
+
+static Probe gRandom[RANDOM_TIMERS];
+
+/** @brief Delay spread over all levels, weighted towards short ones. */
+static uint32_t randomDelay() {
+  int level = (int)(next64() % LOOP_WHEEL_LEVELS);
+  uint32_t span = level == LOOP_WHEEL_LEVELS - 1 ? (1u << 24) : (1u << (6 * (level + 1)));
+  return (uint32_t)(next64() % span);
+}
+
+/** @brief Random action from inside a callback. */
+static void randomThen(Probe* p) {
+  uint64_t r = next64() % 8;
+  Probe* other = &gRandom[next64() % RANDOM_TIMERS];
+  if (r == 0) probeStart(p, randomDelay() % 300, 0);
+  else if (r == 1) probeStop(other);
+  else if (r == 2) probeStart(other, randomDelay() % 5000, next64() % 2 ? 0 : 1 + next64() % 500);
+}
+
+/**
+ * @brief Randomised run against the reference model.
+ */
+static void testRandom(uint32_t steps) {
+  unsigned before = gFaults;
+  reset(0xFFFFFFFFull - 100000);   // also crosses the wrap
+  for (Probe& p : gRandom) {
+    p = Probe();
+    p.name = "random";
+    p.expect = NEVER;
+    p.then = randomThen;
+  }
+  uint64_t fires = 0, ops = 0;
+  for (uint32_t s = 0; s < steps; s++) {
+    uint32_t wait = eventLoopAdvance((uint32_t)gNow);
+    if (next64() % 4 == 0) {
+      Probe* p = &gRandom[next64() % RANDOM_TIMERS];
+      if (next64() % 3 == 0) probeStop(p);
+      else probeStart(p, randomDelay(), next64() % 3 ? 0 : 1 + (uint32_t)(next64() % 2000));
+      ops++;
+      wait = eventLoopAdvance((uint32_t)gNow);
+    }
+    // Sleep for the wait, or wake early to act between timers
+    uint32_t nap = 1 + (uint32_t)(next64() % 3000);
+    gNow += wait == LOOP_NO_TIMER || nap < wait ? nap : wait;
+  }
+  eventLoopAdvance((uint32_t)gNow);
+  for (Probe& p : gRandom) {
+    fires += p.fires;
+    if (p.expect != NEVER && p.expect <= gNow) fault("random missed", p.expect, gNow);
+  }
+  printf("random:      %u steps, %llu external ops, %llu fires, %.1f h virtual %s\n", steps,
+         (unsigned long long)ops, (unsigned long long)fires, (gNow - (0xFFFFFFFFull - 100000)) / 3.6e6,
+         gFaults == before ? "ok" : "FAIL");
+}
+
+int main(int argc, char** argv) {
+  uint32_t steps = argc > 1 ? (uint32_t)atol(argv[1]) : 200000;
+  testBoundaries();
+  testWrap();
+  testWakeups();
+  testRearm();
+  testRandom(steps);
+  if (gFaults) fprintf(stderr, "eventLoopTest: %u faults\n", gFaults);
+  return gFaults ? 1 : 0;
+}
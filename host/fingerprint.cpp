@@ -0,0 +1,383 @@
+/**
+ * @file fingerprint.cpp
+ * @brief Fingerprint storage, brute-force and KD-tree nearest neighbours.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "fingerprint.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief Fingerprints per vector step; columns are padded to a multiple. */
+#define FP_LANES 8
+
+/** @brief Depth of the KD-tree search stack; a balanced tree needs ~log2(n / 8). */
+#define FP_STACK 64
+
+/**
+ * @brief On-disk header, followed by the room column and one RSSI column per
+ *        anchor (12 bytes).
+ */
+struct FpFileHeader {
+  char     magic[4];   /**< "FPDB". */
+  uint16_t version;    /**< 1. */
+  uint8_t  anchors;    /**< Anchors per fingerprint. */
+  uint8_t  pad;        /**< Reserved, zero. */
+  uint32_t count;      /**< Fingerprints. */
+};
+
+/**
+ * @brief k best neighbours so far, nearest first.
+ */
+struct Best {
+  FpNeighbor n[FP_MAX_K];   /**< Neighbours. */
+  size_t     size;          /**< Neighbours held. */
+  size_t     k;             /**< Neighbours wanted. */
+
+  /** @brief Distance a candidate must beat. */
+  int32_t worst() const { return size < k ? INT32_MAX : n[size - 1].dist2; }
+
+  /** @brief Insert a candidate that beats worst(). */
+  void insert(uint32_t id, int32_t dist2) {
+    size_t i = size < k ? size++ : k - 1;
+    while (i > 0 && n[i - 1].dist2 > dist2) {
+      n[i] = n[i - 1];
+      i--;
+    }
+    n[i] = { id, dist2 };
+  }
+};
+
+static void dropIndex(FpDb* db) {
+  free(db->nodes);
+  free(db->points);
+  free(db->ids);
+  db->nodes = nullptr;
+  db->points = nullptr;
+  db->ids = nullptr;
+  db->nodeCount = 0;
+}
+
+/**
+ * @brief Grow the columns to at least `cap` fingerprints (rounded to lanes).
+ */
+static bool reserve(FpDb* db, uint32_t cap) {
+  if (cap <= db->cap) return true;
+  cap = (cap + FP_LANES - 1) / FP_LANES * FP_LANES;
+  for (uint8_t a = 0; a < db->anchors; a++) {
+    int8_t* p = (int8_t*)aligned_alloc(32, (cap + 31) / 32 * 32);
+    if (!p) return false;
+    memcpy(p, db->rssi[a], db->count);
+    memset(p + db->count, FP_FLOOR_DBM, cap - db->count);
+    free(db->rssi[a]);
+    db->rssi[a] = p;
+  }
+  uint16_t* r = (uint16_t*)realloc(db->room, cap * sizeof(uint16_t));
+  if (!r) return false;
+  db->room = r;
+  db->cap = cap;
+  return true;
+}
+
+// ============================================================================
+// Database
+// ============================================================================
+
+bool fpInit(FpDb* db, uint8_t anchors) {
+  memset(db, 0, sizeof(*db));
+  if (anchors == 0 || anchors > FP_MAX_ANCHORS) return false;
+  db->anchors = anchors;
+  return true;
+}
+
+void fpFree(FpDb* db) {
+  dropIndex(db);
+  for (uint8_t a = 0; a < FP_MAX_ANCHORS; a++) free(db->rssi[a]);
+  free(db->room);
+  memset(db, 0, sizeof(*db));
+}
+
+int8_t fpQuantize(float rssi) {
+  if (!(rssi > FP_FLOOR_DBM)) return FP_FLOOR_DBM;  // also NAN
+  if (rssi >= 0.0f) return 0;
+  return (int8_t)lrintf(rssi);
+}
+
+bool fpAdd(FpDb* db, const int8_t* rssi, uint16_t room) {
+  if (db->count == db->cap && !reserve(db, db->cap ? db->cap * 2 : 1024)) return false;
+  if (db->nodes) dropIndex(db);
+  for (uint8_t a = 0; a < db->anchors; a++) db->rssi[a][db->count] = rssi[a];
+  db->room[db->count] = room;
+  db->count++;
+  return true;
+}
+
+bool fpSave(const FpDb* db, const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  FpFileHeader h = { { 'F', 'P', 'D', 'B' }, 1, db->anchors, 0, db->count };
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(db->room, sizeof(uint16_t), db->count, f) == db->count;
+  for (uint8_t a = 0; ok && a < db->anchors; a++) {
+    ok = fwrite(db->rssi[a], 1, db->count, f) == db->count;
+  }
+  return fclose(f) == 0 && ok;
+}
+
+bool fpLoad(FpDb* db, const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  FpFileHeader h;
+  bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, "FPDB", 4) == 0 && h.version == 1 &&
+            fpInit(db, h.anchors) && reserve(db, h.count) &&
+            fread(db->room, sizeof(uint16_t), h.count, f) == h.count;
+  for (uint8_t a = 0; ok && a < h.anchors; a++) {
+    ok = fread(db->rssi[a], 1, h.count, f) == h.count;
+  }
+  fclose(f);
+  if (!ok) {
+    fpFree(db);
+    return false;
+  }
+  db->count = h.count;
+  return true;
+}
+
+// ============================================================================
+// Brute Force
+// ============================================================================
+
+#if defined(__AVX2__)
+
+size_t fpNearestBrute(const FpDb* db, const int8_t* query, size_t k, FpNeighbor* out) {
+  Best best = {};
+  best.k = std::min<size_t>(k, FP_MAX_K);
+  __m256i q[FP_MAX_ANCHORS];
+  for (uint8_t a = 0; a < db->anchors; a++) q[a] = _mm256_set1_epi32(query[a]);
+  for (uint32_t i = 0; i < db->count; i += FP_LANES) {
+    __m256i acc = _mm256_setzero_si256();
+    for (uint8_t a = 0; a < db->anchors; a++) {
+      __m256i v = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(db->rssi[a] + i)));
+      __m256i d = _mm256_sub_epi32(v, q[a]);
+      acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(d, d));
+    }
+    // Only lanes beating the current k-th distance go through the insert
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(best.worst()), acc)));
+    if (db->count - i < FP_LANES) mask &= (1 << (db->count - i)) - 1;
+    while (mask) {
+      int lane = __builtin_ctz(mask);
+      mask &= mask - 1;
+      alignas(32) int32_t d[FP_LANES];
+      _mm256_store_si256((__m256i*)d, acc);
+      if (d[lane] < best.worst()) best.insert(i + lane, d[lane]);
+    }
+  }
+  memcpy(out, best.n, best.size * sizeof(FpNeighbor));
+  return best.size;
+}
+
+const char* fpKernelName(void) { return "avx2"; }
+
+#else
+
+size_t fpNearestBrute(const FpDb* db, const int8_t* query, size_t k, FpNeighbor* out) {
+  Best best = {};
+  best.k = std::min<size_t>(k, FP_MAX_K);
+  for (uint32_t i = 0; i < db->count; i++) {
+    int32_t d2 = 0;
+    for (uint8_t a = 0; a < db->anchors; a++) {
+      int32_t d = db->rssi[a][i] - query[a];
+      d2 += d * d;
+    }
+    if (d2 < best.worst()) best.insert(i, d2);
+  }
+  memcpy(out, best.n, best.size * sizeof(FpNeighbor));
+  return best.size;
+}
+
+const char* fpKernelName(void) { return "scalar"; }
+
+#endif
+
+// ============================================================================
+// KD-Tree
+// ============================================================================
+
+/**
+ * @brief Split [begin, end) of the tree vectors at the median of the anchor
+ *        with the widest range, recursively.
+ */
+static uint32_t buildNode(FpDb* db, uint32_t begin, uint32_t end) {
+  uint32_t self = db->nodeCount++;
+  FpNode& node = db->nodes[self];
+  node.begin = begin;
+  node.end = end;
+  node.dim = FP_LEAF;
+  if (end - begin <= FP_LEAF_SIZE) return self;
+
+  int8_t lo[FP_MAX_ANCHORS], hi[FP_MAX_ANCHORS];
+  memset(lo, 127, sizeof(lo));
+  memset(hi, -128, sizeof(hi));
+  for (uint32_t i = begin; i < end; i++) {
+    for (uint8_t a = 0; a < db->anchors; a++) {
+      lo[a] = std::min(lo[a], db->points[i][a]);
+      hi[a] = std::max(hi[a], db->points[i][a]);
+    }
+  }
+  uint8_t dim = 0;
+  for (uint8_t a = 1; a < db->anchors; a++) {
+    if (hi[a] - lo[a] > hi[dim] - lo[dim]) dim = a;
+  }
+  if (hi[dim] == lo[dim]) return self;  // all equal: keep as a leaf
+
+  // Sort a permutation so points and ids move together
+  uint32_t mid = begin + (end - begin) / 2;
+  uint32_t n = end - begin;
+  uint32_t* perm = (uint32_t*)malloc(n * sizeof(uint32_t));
+  for (uint32_t i = 0; i < n; i++) perm[i] = begin + i;
+  std::nth_element(perm, perm + (mid - begin), perm + n,
+                   [&](uint32_t x, uint32_t y) { return db->points[x][dim] < db->points[y][dim]; });
+  int8_t (*pts)[FP_MAX_ANCHORS] = (int8_t (*)[FP_MAX_ANCHORS])malloc(n * FP_MAX_ANCHORS);
+  uint32_t* ids = (uint32_t*)malloc(n * sizeof(uint32_t));
+  for (uint32_t i = 0; i < n; i++) {
+    memcpy(pts[i], db->points[perm[i]], FP_MAX_ANCHORS);
+    ids[i] = db->ids[perm[i]];
+  }
+  memcpy(db->points + begin, pts, n * FP_MAX_ANCHORS);
+  memcpy(db->ids + begin, ids, n * sizeof(uint32_t));
+  free(perm);
+  free(pts);
+  free(ids);
+
+  // `node` may not be used past here: children are appended after it
+  int8_t split = db->points[mid][dim];
+  buildNode(db, begin, mid);
+  uint32_t right = buildNode(db, mid, end);
+  db->nodes[self].dim = dim;
+  db->nodes[self].split = split;
+  db->nodes[self].right = right;
+  return self;
+}
+
+bool fpBuildIndex(FpDb* db) {
+  dropIndex(db);
+  if (db->count == 0) return true;
+  // Leaves hold at least FP_LEAF_SIZE / 2 vectors, so this bounds the nodes
+  uint32_t maxNodes = 2 * (db->count / (FP_LEAF_SIZE / 2) + 1);
+  db->nodes = (FpNode*)calloc(maxNodes, sizeof(FpNode));
+  db->points = (int8_t (*)[FP_MAX_ANCHORS])calloc(db->count, FP_MAX_ANCHORS);
+  db->ids = (uint32_t*)malloc(db->count * sizeof(uint32_t));
+  if (!db->nodes || !db->points || !db->ids) {
+    dropIndex(db);
+    return false;
+  }
+  for (uint32_t i = 0; i < db->count; i++) {
+    for (uint8_t a = 0; a < db->anchors; a++) db->points[i][a] = db->rssi[a][i];
+    db->ids[i] = i;
+  }
+  buildNode(db, 0, db->count);
+  return true;
+}
+
+size_t fpNearestTree(const FpDb* db, const int8_t* query, size_t k, FpNeighbor* out) {
+  Best best = {};
+  best.k = std::min<size_t>(k, FP_MAX_K);
+  if (!db->nodes) return 0;
+  int8_t q[FP_MAX_ANCHORS] = {};  // unused anchors are 0 in both
+  memcpy(q, query, db->anchors);
+
+  struct Pending {
+    uint32_t node;    /**< Node to visit. */
+    int32_t  bound;   /**< Lower bound of its distances. */
+  } stack[FP_STACK];
+  size_t top = 0;
+  stack[top++] = { 0, 0 };
+  while (top > 0) {
+    Pending p = stack[--top];
+    if (p.bound >= best.worst()) continue;
+    const FpNode* node = &db->nodes[p.node];
+    // Descend to the leaf on the query's side, queueing the far children
+    while (node->dim != FP_LEAF) {
+      int32_t diff = q[node->dim] - node->split;
+      uint32_t left = (uint32_t)(node - db->nodes) + 1;
+      uint32_t nearNode = diff < 0 ? left : node->right;
+      uint32_t farNode = diff < 0 ? node->right : left;
+      int32_t farBound = std::max(p.bound, diff * diff);
+      if (farBound < best.worst() && top < FP_STACK) stack[top++] = { farNode, farBound };
+      node = &db->nodes[nearNode];
+    }
+    for (uint32_t i = node->begin; i < node->end; i++) {
+      int32_t d2 = 0;
+      for (int a = 0; a < FP_MAX_ANCHORS; a++) {
+        int32_t d = db->points[i][a] - q[a];
+        d2 += d * d;
+      }
+      if (d2 < best.worst()) best.insert(db->ids[i], d2);
+    }
+  }
+  memcpy(out, best.n, best.size * sizeof(FpNeighbor));
+  return best.size;
+}
+
+// ============================================================================
+// Classification
+// ============================================================================
+
+FpResult fpVote(const FpDb* db, const FpNeighbor* nbrs, size_t count) {
+  uint16_t rooms[FP_MAX_K];
+  float weights[FP_MAX_K];
+  size_t nrooms = 0;
+  float total = 0.0f;
+  for (size_t i = 0; i < count; i++) {
+    uint16_t room = db->room[nbrs[i].id];
+    float w = 1.0f / (1.0f + nbrs[i].dist2);
+    size_t r = 0;
+    while (r < nrooms && rooms[r] != room) r++;
+    if (r == nrooms) {
+      rooms[nrooms] = room;
+      weights[nrooms++] = 0.0f;
+    }
+    weights[r] += w;
+    total += w;
+  }
+  FpResult res = { 0, 0.0f, count ? nbrs[0].dist2 : INT32_MAX };
+  size_t bestRoom = 0;
+  for (size_t r = 1; r < nrooms; r++) {
+    if (weights[r] > weights[bestRoom]) bestRoom = r;
+  }
+  if (nrooms > 0) {
+    res.room = rooms[bestRoom];
+    res.confidence = weights[bestRoom] / total;
+  }
+  return res;
+}
+
+// ============================================================================
+// Tag State
+// ============================================================================
+
+void fpObserve(FpTagState* s, uint8_t anchor, float rssi, uint64_t timeMs) {
+  if (anchor >= FP_MAX_ANCHORS) return;
+  s->rssi[anchor] = rssi;
+  s->timeMs[anchor] = timeMs;
+}
+
+size_t fpTagVector(const FpTagState* s, uint8_t anchors, uint64_t nowMs, uint32_t staleMs, int8_t* query) {
+  size_t fresh = 0;
+  for (uint8_t a = 0; a < anchors && a < FP_MAX_ANCHORS; a++) {
+    bool ok = s->timeMs[a] != 0 && nowMs - s->timeMs[a] <= staleMs;
+    query[a] = ok ? fpQuantize(s->rssi[a]) : (int8_t)FP_FLOOR_DBM;
+    if (ok) fresh++;
+  }
+  return fresh;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file fingerprint.h
+ * @brief Room classification from the RSSI several fixed trackers (anchors)
+ *        measure, by nearest neighbours in a database of recorded RSSI
+ *        vectors (fingerprints).
+ *
+ * Walls and furniture bend the log-distance path-loss model far enough that
+ * ranges converted with `estimateDistanceMeters()` often place a tag in the
+ * wrong room. A fingerprint instead keeps the smoothed RSSI every anchor
+ * measured at a surveyed spot, the same input the tracker feeds into
+ * `estimateDistanceMeters()`, labelled with the room it was recorded in. A
+ * query vector is classified by a distance-weighted vote of its k nearest
+ * fingerprints (squared Euclidean distance in dB).
+ *
+ * Fingerprints are stored compactly as one int8 column per anchor (whole
+ * dBm, clamped to [FP_FLOOR_DBM, 0]; an anchor that does not hear the tag
+ * records the floor) and a uint16 room column. Two search paths return the
+ * same neighbours:
+ *
+ * - brute force over the columns, 8 fingerprints at a time with AVX2 when
+ *   the compiler targets it (`-mavx2`), one at a time otherwise;
+ * - a KD-tree built over a copy of the vectors (8 bytes each) with leaf
+ *   buckets, searched depth first with pruning on the splitting planes.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Anchors per database at most (a fingerprint packs into 8 bytes). */
+#define FP_MAX_ANCHORS 8
+
+/** @brief Neighbours per query at most. */
+#define FP_MAX_K 32
+
+/** @brief RSSI recorded for an anchor that does not hear the tag (dBm). */
+#define FP_FLOOR_DBM -100
+
+/** @brief Fingerprints per KD-tree leaf at most. */
+#define FP_LEAF_SIZE 16
+
+/**
+ * @brief KD-tree node: a leaf if `dim` is FP_LEAF, otherwise an inner node
+ *        whose left child follows it and whose right child is at `right`.
+ */
+struct FpNode {
+  uint32_t begin;   /**< First vector in tree order. */
+  uint32_t end;     /**< One past the last vector. */
+  uint32_t right;   /**< Index of the right child (inner nodes). */
+  int8_t   split;   /**< Splitting value: left <= split <= right. */
+  uint8_t  dim;     /**< Splitting anchor, or FP_LEAF. */
+  uint8_t  pad[2];  /**< Reserved. */
+};
+
+/** @brief FpNode::dim of a leaf. */
+#define FP_LEAF 0xFF
+
+/**
+ * @brief Fingerprint database and its KD-tree.
+ */
+struct FpDb {
+  uint8_t   anchors;                  /**< Anchors per fingerprint. */
+  uint32_t  count;                    /**< Fingerprints. */
+  uint32_t  cap;                      /**< Allocated fingerprints. */
+  int8_t*   rssi[FP_MAX_ANCHORS];     /**< RSSI per anchor (dBm, 32-byte aligned). */
+  uint16_t* room;                     /**< Room label per fingerprint. */
+  // KD-tree, rebuilt by fpBuildIndex(), dropped by fpAdd()
+  FpNode*   nodes;                    /**< Tree nodes, root first. */
+  uint32_t  nodeCount;                /**< Nodes in use. */
+  int8_t    (*points)[FP_MAX_ANCHORS];/**< Vectors in tree order. */
+  uint32_t* ids;                      /**< Fingerprint of each tree vector. */
+};
+
+/**
+ * @brief One neighbour of a query.
+ */
+struct FpNeighbor {
+  uint32_t id;      /**< Fingerprint index. */
+  int32_t  dist2;   /**< Squared distance (dB^2). */
+};
+
+/**
+ * @brief Room vote of a query.
+ */
+struct FpResult {
+  uint16_t room;         /**< Winning room. */
+  float    confidence;   /**< Its share of the vote weight (0-1). */
+  int32_t  nearest2;     /**< Squared distance to the nearest fingerprint. */
+};
+
+/**
+ * @brief Start an empty database.
+ *
+ * @return False if `anchors` is 0 or above FP_MAX_ANCHORS.
+ */
+bool fpInit(FpDb* db, uint8_t anchors);
+
+/**
+ * @brief Release a database and its index.
+ */
+void fpFree(FpDb* db);
+
+/**
+ * @brief Quantise a smoothed RSSI to the stored form.
+ *
+ * @param[in] rssi Smoothed RSSI (dBm); NAN if the anchor does not hear the tag.
+ */
+int8_t fpQuantize(float rssi);
+
+/**
+ * @brief Append a fingerprint (drops the KD-tree).
+ *
+ * @param[in] rssi Quantised RSSI per anchor (`anchors` values).
+ * @param[in] room Room label.
+ * @return False if memory is exhausted.
+ */
+bool fpAdd(FpDb* db, const int8_t* rssi, uint16_t room);
+
+/**
+ * @brief Write a database as `FPDB` header, room column and RSSI columns.
+ */
+bool fpSave(const FpDb* db, const char* path);
+
+/**
+ * @brief Read a database written by fpSave().
+ */
+bool fpLoad(FpDb* db, const char* path);
+
+/**
+ * @brief Build the KD-tree over the current fingerprints.
+ */
+bool fpBuildIndex(FpDb* db);
+
+/**
+ * @brief k nearest fingerprints by scanning every one.
+ *
+ * @param[in]  query Quantised RSSI per anchor.
+ * @param[in]  k     Neighbours wanted (at most FP_MAX_K).
+ * @param[out] out   Neighbours, nearest first.
+ * @return Number of neighbours found (min(k, count)).
+ */
+size_t fpNearestBrute(const FpDb* db, const int8_t* query, size_t k, FpNeighbor* out);
+
+/**
+ * @brief k nearest fingerprints through the KD-tree (fpBuildIndex() first).
+ *
+ * Same contract as fpNearestBrute(); ties may come out in another order.
+ */
+size_t fpNearestTree(const FpDb* db, const int8_t* query, size_t k, FpNeighbor* out);
+
+/**
+ * @brief Vote a room from neighbours, each weighted by 1 / (1 + dist2).
+ */
+FpResult fpVote(const FpDb* db, const FpNeighbor* nbrs, size_t count);
+
+/**
+ * @brief Name of the brute-force kernel compiled in ("avx2" or "scalar").
+ */
+const char* fpKernelName(void);
+
+/**
+ * @brief Latest smoothed RSSI of one tag at every anchor.
+ */
+struct FpTagState {
+  float    rssi[FP_MAX_ANCHORS];     /**< Smoothed RSSI (dBm). */
+  uint64_t timeMs[FP_MAX_ANCHORS];   /**< Arrival time, 0 if none. */
+};
+
+/**
+ * @brief Store an anchor's smoothed RSSI for a tag, the value the tracker
+ *        passes to `estimateDistanceMeters()`.
+ */
+void fpObserve(FpTagState* s, uint8_t anchor, float rssi, uint64_t timeMs);
+
+/**
+ * @brief Query vector of a tag: anchors silent for more than `staleMs`
+ *        record the floor.
+ *
+ * @param[out] query Quantised RSSI per anchor.
+ * @return Number of anchors with a fresh reading.
+ */
+size_t fpTagVector(const FpTagState* s, uint8_t anchors, uint64_t nowMs, uint32_t staleMs, int8_t* query);
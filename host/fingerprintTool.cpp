@@ -0,0 +1,467 @@
+/**
+ * @file fingerprintTool.cpp
+ * @brief Records RSSI fingerprints from several trackers, classifies the
+ *        room of live tags against them, and benchmarks the k-NN index
+ *        (fingerprint.h).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -mavx2 fingerprintTool.cpp fingerprint.cpp trilat.cpp ../scanner/distance.cpp -o fingerprintTool
+ *
+ * or without `-mavx2` for the scalar brute-force kernel.
+ *
+ * Usage:
+ *
+ *     fingerprintTool record <anchors.txt> <db.fp> <room> [seconds] [tag]
+ *     fingerprintTool classify <anchors.txt> <db.fp> [k]
+ *     fingerprintTool bench [queries]
+ *
+ * The layout file is the one trilatTool reads, one anchor per line as
+ * `name x y device` (the position is not used here). Each tracker prints a
+ * line per estimate, `Tag <n> | Raw RSSI: ... | Smoothed RSSI: <dBm> dBm |
+ * ...`; the smoothed RSSI is the value it passes to
+ * `estimateDistanceMeters()`.
+ *
+ * `record` appends a fingerprint of `tag` (default 0) labelled `room` twice
+ * a second for `seconds` (default 60) while the tag is carried around the
+ * room, creating the database if needed. `classify` prints
+ * `timeMs tag room confidence` after every report, from the k (default 7)
+ * nearest fingerprints.
+ *
+ * `bench` surveys a simulated floor of 40 rooms with walls, builds the index
+ * over 10k and 100k fingerprints and reports build time, query time of the
+ * brute-force scan and the KD-tree, and room accuracy, against locating the
+ * tag by trilateration of `estimateDistanceMeters()` ranges.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "fingerprint.h"
+#include "trilat.h"
+#include "../scanner/distance.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief Readings older than this are left out of a query vector (ms). */
+#define STALE_MS 2000
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Monotonic clock in milliseconds.
+ */
+static uint64_t nowMs() {
+  return (uint64_t)(nowSec() * 1000.0);
+}
+
+/**
+ * @brief Open a serial device in raw 8N1 mode.
+ *
+ * @param[in] path Device path (e.g. /dev/ttyACM0).
+ * @return File descriptor, or -1 on error.
+ */
+static int openSerial(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// ============================================================================
+// Live
+// ============================================================================
+
+/** @brief Tags tracked live at most. */
+#define LIVE_MAX_TAGS 16
+
+/**
+ * @brief One anchor of the layout file and its serial line state.
+ */
+struct AnchorPort {
+  char   name[32];    /**< Anchor name. */
+  char   device[128]; /**< Serial device. */
+  int    fd;          /**< Open port. */
+  char   line[256];   /**< Partial line. */
+  size_t len;         /**< Bytes in `line`. */
+};
+
+/**
+ * @brief Read the layout file and open every anchor's port.
+ *
+ * @return Number of anchors, or -1 on error.
+ */
+static int openLayout(const char* path, AnchorPort* ports, struct pollfd* pfds) {
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+  char buf[256];
+  int n = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    char* hash = strchr(buf, '#');
+    if (hash) *hash = '\0';
+    AnchorPort& p = ports[n];
+    double x, y;
+    if (sscanf(buf, "%31s %lf %lf %127s", p.name, &x, &y, p.device) != 4) continue;
+    if (++n == FP_MAX_ANCHORS) break;
+  }
+  fclose(f);
+  for (int i = 0; i < n; i++) {
+    ports[i].fd = openSerial(ports[i].device);
+    if (ports[i].fd < 0) {
+      fprintf(stderr, "%s: cannot open %s\n", ports[i].name, ports[i].device);
+      return -1;
+    }
+    pfds[i] = { ports[i].fd, POLLIN, 0 };
+  }
+  return n;
+}
+
+/**
+ * @brief Parse a tracker's estimate line.
+ *
+ * @return False if the line is not an estimate.
+ */
+static bool parseReport(const char* line, unsigned* tag, float* rssi) {
+  if (sscanf(line, "Tag %u |", tag) != 1) return false;
+  const char* s = strstr(line, "Smoothed RSSI: ");
+  return s && sscanf(s, "Smoothed RSSI: %f", rssi) == 1;
+}
+
+/**
+ * @brief Called for every report with the tag's updated state.
+ */
+typedef void (*ReportFn)(void* ctx, unsigned tag, const FpTagState* state, uint64_t timeMs);
+
+/**
+ * @brief Feed the anchors' reports into per-tag state until `untilMs`
+ *        (0 = forever).
+ */
+static void pump(AnchorPort* ports, struct pollfd* pfds, int count, uint64_t untilMs,
+                 ReportFn fn, void* ctx) {
+  static FpTagState tags[LIVE_MAX_TAGS];
+  uint64_t t0 = nowMs();
+  while (untilMs == 0 || nowMs() - t0 < untilMs) {
+    if (poll(pfds, (nfds_t)count, 200) <= 0) continue;
+    for (int i = 0; i < count; i++) {
+      if (!(pfds[i].revents & POLLIN)) continue;
+      char buf[512];
+      ssize_t n = read(ports[i].fd, buf, sizeof(buf));
+      if (n <= 0) continue;
+      AnchorPort& p = ports[i];
+      for (ssize_t k = 0; k < n; k++) {
+        char c = buf[k];
+        if (c != '\n') {
+          if (p.len < sizeof(p.line) - 1) p.line[p.len++] = c;
+          continue;
+        }
+        p.line[p.len] = '\0';
+        p.len = 0;
+        unsigned tag;
+        float rssi;
+        if (!parseReport(p.line, &tag, &rssi) || tag >= LIVE_MAX_TAGS) continue;
+        uint64_t t = nowMs() - t0 + 1;  // 0 marks "no reading"
+        fpObserve(&tags[tag], (uint8_t)i, rssi, t);
+        fn(ctx, tag, &tags[tag], t);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Recording session.
+ */
+struct Recording {
+  FpDb*    db;       /**< Database to extend. */
+  unsigned tag;      /**< Tag carried around. */
+  uint16_t room;     /**< Its room. */
+  uint64_t lastMs;   /**< Time of the last fingerprint. */
+  uint32_t added;    /**< Fingerprints added. */
+};
+
+static void onRecordReport(void* ctx, unsigned tag, const FpTagState* state, uint64_t timeMs) {
+  Recording* r = (Recording*)ctx;
+  if (tag != r->tag || timeMs - r->lastMs < 500) return;
+  int8_t v[FP_MAX_ANCHORS];
+  if (fpTagVector(state, r->db->anchors, timeMs, STALE_MS, v) == 0) return;
+  if (!fpAdd(r->db, v, r->room)) return;
+  r->lastMs = timeMs;
+  r->added++;
+}
+
+static int record(const char* layoutPath, const char* dbPath, uint16_t room, uint32_t seconds, unsigned tag) {
+  static AnchorPort ports[FP_MAX_ANCHORS];
+  struct pollfd pfds[FP_MAX_ANCHORS];
+  int count = openLayout(layoutPath, ports, pfds);
+  if (count < 1) {
+    fprintf(stderr, "%s: no usable anchors\n", layoutPath);
+    return 1;
+  }
+  FpDb db;
+  if (!fpLoad(&db, dbPath)) {
+    fpInit(&db, (uint8_t)count);
+  } else if (db.anchors != count) {
+    fprintf(stderr, "%s: recorded with %u anchors, layout has %d\n", dbPath, db.anchors, count);
+    return 1;
+  }
+  Recording r = { &db, tag, room, 0, 0 };
+  fprintf(stderr, "recording tag %u in room %u for %u s (%u fingerprints so far)\n", tag, room, seconds, db.count);
+  pump(ports, pfds, count, (uint64_t)seconds * 1000, onRecordReport, &r);
+  if (!fpSave(&db, dbPath)) {
+    fprintf(stderr, "%s: write failed\n", dbPath);
+    return 1;
+  }
+  fprintf(stderr, "added %u fingerprints, %u in total\n", r.added, db.count);
+  fpFree(&db);
+  return 0;
+}
+
+/**
+ * @brief Classification session.
+ */
+struct Classifying {
+  FpDb*  db;   /**< Indexed database. */
+  size_t k;    /**< Neighbours per vote. */
+};
+
+static void onClassifyReport(void* ctx, unsigned tag, const FpTagState* state, uint64_t timeMs) {
+  Classifying* c = (Classifying*)ctx;
+  int8_t v[FP_MAX_ANCHORS];
+  if (fpTagVector(state, c->db->anchors, timeMs, STALE_MS, v) == 0) return;
+  FpNeighbor nbrs[FP_MAX_K];
+  size_t n = fpNearestTree(c->db, v, c->k, nbrs);
+  if (n == 0) return;
+  FpResult res = fpVote(c->db, nbrs, n);
+  printf("%llu %u %u %.2f\n", (unsigned long long)timeMs, tag, res.room, res.confidence);
+  fflush(stdout);
+}
+
+static int classify(const char* layoutPath, const char* dbPath, size_t k) {
+  FpDb db;
+  if (!fpLoad(&db, dbPath) || !fpBuildIndex(&db)) {
+    fprintf(stderr, "%s: cannot load\n", dbPath);
+    return 1;
+  }
+  static AnchorPort ports[FP_MAX_ANCHORS];
+  struct pollfd pfds[FP_MAX_ANCHORS];
+  int count = openLayout(layoutPath, ports, pfds);
+  if (count != db.anchors) {
+    fprintf(stderr, "%s: database has %u anchors\n", layoutPath, db.anchors);
+    return 1;
+  }
+  fprintf(stderr, "%u fingerprints, k = %zu\n", db.count, k);
+  Classifying c = { &db, k };
+  pump(ports, pfds, count, 0, onClassifyReport, &c);
+  return 0;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/** @brief Floor grid: rooms across and down. */
+#define ROOMS_X 8
+#define ROOMS_Y 5
+
+/** @brief Room size (m). */
+#define ROOM_W 5.0
+#define ROOM_H 4.0
+
+/** @brief Anchors of the simulated floor. */
+#define BENCH_ANCHORS 8
+
+/** @brief Model the tracker assumes. */
+#define TX_POWER -59.0f
+#define N_FACTOR 2.2f
+
+/** @brief Loss per wall between anchor and tag (dB). */
+#define WALL_DB 3.0
+
+/** @brief Noise left on a smoothed RSSI (dB). */
+#define NOISE_DB 2.0
+
+/**
+ * @brief Simulated floor: anchor positions and a fixed offset per room and
+ *        anchor for furniture and doors.
+ */
+struct Floor {
+  double x[BENCH_ANCHORS], y[BENCH_ANCHORS];            /**< Anchor positions. */
+  double offset[ROOMS_X * ROOMS_Y][BENCH_ANCHORS];      /**< Per-room bias (dB). */
+};
+
+static uint16_t roomAt(double x, double y) {
+  int cx = std::min(std::max((int)(x / ROOM_W), 0), ROOMS_X - 1);
+  int cy = std::min(std::max((int)(y / ROOM_H), 0), ROOMS_Y - 1);
+  return (uint16_t)(cy * ROOMS_X + cx);
+}
+
+/**
+ * @brief Smoothed RSSI of a tag at (x, y) at every anchor.
+ */
+static void measure(const Floor& f, double x, double y, std::mt19937& rng, float* rssi) {
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  uint16_t room = roomAt(x, y);
+  for (int a = 0; a < BENCH_ANCHORS; a++) {
+    uint16_t ar = roomAt(f.x[a], f.y[a]);
+    int walls = abs(room % ROOMS_X - ar % ROOMS_X) + abs(room / ROOMS_X - ar / ROOMS_X);
+    double d = std::max(0.5, hypot(x - f.x[a], y - f.y[a]));
+    double v = TX_POWER - 10.0 * N_FACTOR * log10(d) - WALL_DB * walls + f.offset[room][a] + NOISE_DB * gauss(rng);
+    rssi[a] = v < FP_FLOOR_DBM ? NAN : (float)v;  // below sensitivity: not heard
+  }
+}
+
+/**
+ * @brief Room from trilateration of the path-loss ranges.
+ */
+static uint16_t trilatRoom(const Floor& f, const float* rssi) {
+  TrilatAnchor anchors[BENCH_ANCHORS];
+  TrilatRange ranges[BENCH_ANCHORS];
+  size_t n = 0;
+  for (int a = 0; a < BENCH_ANCHORS; a++) {
+    anchors[a] = { f.x[a], f.y[a] };
+    if (isnan(rssi[a])) continue;
+    float d = estimateDistanceMeters(rssi[a], TX_POWER, N_FACTOR);
+    float sd = d * logf(10.0f) / (10.0f * N_FACTOR) * (float)NOISE_DB;
+    ranges[n++] = { (uint8_t)a, d, (double)sd * sd };
+  }
+  TrilatFix fix;
+  if (!trilatSolve(anchors, ranges, n, nullptr, &fix)) return 0xFFFF;
+  return roomAt(fix.x, fix.y);
+}
+
+static int bench(size_t queries) {
+  std::mt19937 rng(11);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_real_distribution<double> ux(0.0, ROOMS_X * ROOM_W), uy(0.0, ROOMS_Y * ROOM_H);
+  Floor f;
+  for (int a = 0; a < BENCH_ANCHORS; a++) {
+    f.x[a] = (a % 4) * 10.0 + 5.0;
+    f.y[a] = a < 4 ? 2.0 : 18.0;
+  }
+  for (int r = 0; r < ROOMS_X * ROOMS_Y; r++) {
+    for (int a = 0; a < BENCH_ANCHORS; a++) f.offset[r][a] = 3.0 * gauss(rng);
+  }
+
+  // Test points, the same for every database size
+  struct Query {
+    int8_t   v[FP_MAX_ANCHORS];
+    uint16_t room;
+  };
+  std::vector<Query> qs(queries);
+  size_t trilatHits = 0, trilatFailed = 0;
+  for (Query& q : qs) {
+    double x = ux(rng), y = uy(rng);
+    float rssi[BENCH_ANCHORS];
+    measure(f, x, y, rng, rssi);
+    for (int a = 0; a < BENCH_ANCHORS; a++) q.v[a] = fpQuantize(rssi[a]);
+    q.room = roomAt(x, y);
+    uint16_t room = trilatRoom(f, rssi);
+    if (room == q.room) trilatHits++;
+    if (room == 0xFFFF) trilatFailed++;
+  }
+  printf("floor %dx%d rooms of %.0fx%.0f m, %d anchors, %.0f dB per wall, %zu queries, kernel %s\n\n",
+         ROOMS_X, ROOMS_Y, ROOM_W, ROOM_H, BENCH_ANCHORS, WALL_DB, queries, fpKernelName());
+  printf("path-loss ranges + trilateration: room accuracy %.1f%%, %.1f%% without a fix\n\n",
+         100.0 * trilatHits / queries, 100.0 * trilatFailed / queries);
+  printf("fingerprints  file KB  build ms  brute us  tree us    nodes  same  acc k=1  acc k=7\n");
+
+  for (uint32_t size : { 10000u, 100000u }) {
+    FpDb db;
+    fpInit(&db, BENCH_ANCHORS);
+    for (uint32_t i = 0; i < size; i++) {
+      double x = ux(rng), y = uy(rng);
+      float rssi[BENCH_ANCHORS];
+      int8_t v[FP_MAX_ANCHORS];
+      measure(f, x, y, rng, rssi);
+      for (int a = 0; a < BENCH_ANCHORS; a++) v[a] = fpQuantize(rssi[a]);
+      fpAdd(&db, v, roomAt(x, y));
+    }
+    fpSave(&db, "/tmp/fingerprintBench.fp");
+    FpDb loaded;
+    fpLoad(&loaded, "/tmp/fingerprintBench.fp");
+    struct stat st;
+    long fileBytes = stat("/tmp/fingerprintBench.fp", &st) == 0 ? (long)st.st_size : 0;
+    fpFree(&db);
+
+    double t = nowSec();
+    fpBuildIndex(&loaded);
+    double buildMs = (nowSec() - t) * 1e3;
+
+    std::vector<FpNeighbor> brute(queries * 7), tree(queries * 7);
+    t = nowSec();
+    for (size_t i = 0; i < queries; i++) fpNearestBrute(&loaded, qs[i].v, 7, &brute[i * 7]);
+    double bruteUs = (nowSec() - t) * 1e6 / queries;
+    t = nowSec();
+    for (size_t i = 0; i < queries; i++) fpNearestTree(&loaded, qs[i].v, 7, &tree[i * 7]);
+    double treeUs = (nowSec() - t) * 1e6 / queries;
+
+    size_t same = 0, hits1 = 0, hits7 = 0;
+    for (size_t i = 0; i < queries; i++) {
+      bool eq = true;
+      for (int j = 0; j < 7; j++) eq = eq && brute[i * 7 + j].dist2 == tree[i * 7 + j].dist2;
+      if (eq) same++;
+      if (fpVote(&loaded, &tree[i * 7], 1).room == qs[i].room) hits1++;
+      if (fpVote(&loaded, &tree[i * 7], 7).room == qs[i].room) hits7++;
+    }
+    printf("%12u %8.0f %9.1f %9.2f %8.2f %8u %5.1f%% %7.1f%% %7.1f%%\n", size, fileBytes / 1024.0,
+           buildMs, bruteUs, treeUs, loaded.nodeCount, 100.0 * same / queries,
+           100.0 * hits1 / queries, 100.0 * hits7 / queries);
+    fpFree(&loaded);
+  }
+  remove("/tmp/fingerprintBench.fp");
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 5 && strcmp(argv[1], "record") == 0) {
+    uint32_t seconds = argc > 5 ? (uint32_t)atoi(argv[5]) : 60;
+    unsigned tag = argc > 6 ? (unsigned)atoi(argv[6]) : 0;
+    return record(argv[2], argv[3], (uint16_t)atoi(argv[4]), seconds, tag);
+  }
+  if (argc >= 4 && strcmp(argv[1], "classify") == 0) {
+    long k = argc > 4 ? atol(argv[4]) : 7;
+    return classify(argv[2], argv[3], (size_t)std::min<long>(std::max<long>(k, 1), FP_MAX_K));
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long queries = argc > 2 ? atol(argv[2]) : 20000;
+    return bench(queries > 0 ? (size_t)queries : 20000);
+  }
+  fprintf(stderr,
+          "usage: fingerprintTool record <anchors.txt> <db.fp> <room> [seconds] [tag]\n"
+          "       fingerprintTool classify <anchors.txt> <db.fp> [k]\n"
+          "       fingerprintTool bench [queries]\n");
+  return 1;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file geofence.cpp
+ * @brief Zone geometry, the uniform grid and per-tag enter/exit tracking.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "geofence.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief Largest zone id (GfTag and the grid store them as uint16_t). */
+#define GF_MAX_ZONES 0xFFFF
+
+/** @brief Cells per grid at most, so a tiny cell size cannot exhaust memory. */
+#define GF_MAX_CELLS (1u << 22)
+
+/**
+ * @brief Grow an array to hold at least `need` items.
+ */
+static bool grow(void** p, uint32_t* cap, uint32_t need, size_t itemSize) {
+  if (need <= *cap) return true;
+  uint32_t n = *cap ? *cap : 64;
+  while (n < need) n *= 2;
+  void* q = realloc(*p, (size_t)n * itemSize);
+  if (!q) return false;
+  *p = q;
+  *cap = n;
+  return true;
+}
+
+/**
+ * @brief Squared distance from a point to a segment.
+ */
+static float segmentDist2(float px, float py, const GfPoint& a, const GfPoint& b) {
+  float dx = b.x - a.x, dy = b.y - a.y;
+  float len2 = dx * dx + dy * dy;
+  float t = len2 > 0.0f ? ((px - a.x) * dx + (py - a.y) * dy) / len2 : 0.0f;
+  t = std::min(std::max(t, 0.0f), 1.0f);
+  float ex = a.x + t * dx - px, ey = a.y + t * dy - py;
+  return ex * ex + ey * ey;
+}
+
+static void dropIndex(GfEngine* e) {
+  free(e->cellStart);
+  free(e->cellZones);
+  e->cellStart = nullptr;
+  e->cellZones = nullptr;
+  e->cols = e->rows = 0;
+}
+
+// ============================================================================
+// Zones
+// ============================================================================
+
+bool gfInit(GfEngine* e, uint32_t tags, float hysteresis) {
+  memset(e, 0, sizeof(*e));
+  e->tags = (GfTag*)calloc(tags ? tags : 1, sizeof(GfTag));
+  if (!e->tags) return false;
+  e->tagCount = tags;
+  e->hysteresis = hysteresis;
+  return true;
+}
+
+void gfFree(GfEngine* e) {
+  dropIndex(e);
+  free(e->zones);
+  free(e->vertices);
+  free(e->tags);
+  memset(e, 0, sizeof(*e));
+}
+
+int gfAddCircle(GfEngine* e, float cx, float cy, float r) {
+  if (e->zoneCount >= GF_MAX_ZONES || !grow((void**)&e->zones, &e->zoneCap, e->zoneCount + 1, sizeof(GfZone))) {
+    return -1;
+  }
+  GfZone& z = e->zones[e->zoneCount];
+  memset(&z, 0, sizeof(z));
+  z.shape = GF_CIRCLE;
+  z.cx = cx;
+  z.cy = cy;
+  z.r = r;
+  z.minX = cx - r;
+  z.minY = cy - r;
+  z.maxX = cx + r;
+  z.maxY = cy + r;
+  return (int)e->zoneCount++;
+}
+
+int gfAddPolygon(GfEngine* e, const GfPoint* points, uint16_t count) {
+  if (count < 3 || e->zoneCount >= GF_MAX_ZONES ||
+      !grow((void**)&e->zones, &e->zoneCap, e->zoneCount + 1, sizeof(GfZone)) ||
+      !grow((void**)&e->vertices, &e->vertexCap, e->vertexCount + count, sizeof(GfPoint))) {
+    return -1;
+  }
+  GfZone& z = e->zones[e->zoneCount];
+  memset(&z, 0, sizeof(z));
+  z.shape = GF_POLYGON;
+  z.vertexCount = count;
+  z.firstVertex = e->vertexCount;
+  memcpy(e->vertices + e->vertexCount, points, count * sizeof(GfPoint));
+  e->vertexCount += count;
+  z.minX = z.maxX = points[0].x;
+  z.minY = z.maxY = points[0].y;
+  for (uint16_t i = 1; i < count; i++) {
+    z.minX = std::min(z.minX, points[i].x);
+    z.maxX = std::max(z.maxX, points[i].x);
+    z.minY = std::min(z.minY, points[i].y);
+    z.maxY = std::max(z.maxY, points[i].y);
+  }
+  return (int)e->zoneCount++;
+}
+
+bool gfContains(const GfEngine* e, uint16_t zone, float x, float y) {
+  const GfZone& z = e->zones[zone];
+  if (x < z.minX || x > z.maxX || y < z.minY || y > z.maxY) return false;
+  if (z.shape == GF_CIRCLE) {
+    float dx = x - z.cx, dy = y - z.cy;
+    return dx * dx + dy * dy <= z.r * z.r;
+  }
+  // Crossing number: count edges crossed by a ray towards +x
+  const GfPoint* v = e->vertices + z.firstVertex;
+  bool inside = false;
+  for (uint16_t i = 0, j = z.vertexCount - 1; i < z.vertexCount; j = i++) {
+    if ((v[i].y > y) != (v[j].y > y) &&
+        x < (v[j].x - v[i].x) * (y - v[i].y) / (v[j].y - v[i].y) + v[i].x) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+float gfOutsideDistance(const GfEngine* e, uint16_t zone, float x, float y) {
+  if (gfContains(e, zone, x, y)) return 0.0f;
+  const GfZone& z = e->zones[zone];
+  if (z.shape == GF_CIRCLE) return hypotf(x - z.cx, y - z.cy) - z.r;
+  const GfPoint* v = e->vertices + z.firstVertex;
+  float best = INFINITY;
+  for (uint16_t i = 0, j = z.vertexCount - 1; i < z.vertexCount; j = i++) {
+    best = std::min(best, segmentDist2(x, y, v[j], v[i]));
+  }
+  return sqrtf(best);
+}
+
+// ============================================================================
+// Grid
+// ============================================================================
+
+/**
+ * @brief Cell range a zone's bounding box covers.
+ */
+static void cellRange(const GfEngine* e, const GfZone& z, uint32_t* c0, uint32_t* r0, uint32_t* c1, uint32_t* r1) {
+  *c0 = (uint32_t)((z.minX - e->originX) / e->cellSize);
+  *r0 = (uint32_t)((z.minY - e->originY) / e->cellSize);
+  *c1 = std::min(e->cols - 1, (uint32_t)((z.maxX - e->originX) / e->cellSize));
+  *r1 = std::min(e->rows - 1, (uint32_t)((z.maxY - e->originY) / e->cellSize));
+}
+
+bool gfBuildIndex(GfEngine* e, float cellSize) {
+  dropIndex(e);
+  if (e->zoneCount == 0 || !(cellSize > 0.0f)) return false;
+  float minX = e->zones[0].minX, minY = e->zones[0].minY;
+  float maxX = e->zones[0].maxX, maxY = e->zones[0].maxY;
+  for (uint32_t i = 1; i < e->zoneCount; i++) {
+    minX = std::min(minX, e->zones[i].minX);
+    minY = std::min(minY, e->zones[i].minY);
+    maxX = std::max(maxX, e->zones[i].maxX);
+    maxY = std::max(maxY, e->zones[i].maxY);
+  }
+  // Coarsen the cells if the area would need too many
+  while ((double)((maxX - minX) / cellSize + 1) * ((maxY - minY) / cellSize + 1) > GF_MAX_CELLS) cellSize *= 2.0f;
+  e->originX = minX;
+  e->originY = minY;
+  e->cellSize = cellSize;
+  e->cols = (uint32_t)((maxX - minX) / cellSize) + 1;
+  e->rows = (uint32_t)((maxY - minY) / cellSize) + 1;
+  uint32_t cells = e->cols * e->rows;
+
+  // Two passes: count per cell, then fill (compressed rows)
+  e->cellStart = (uint32_t*)calloc(cells + 1, sizeof(uint32_t));
+  if (!e->cellStart) {
+    dropIndex(e);
+    return false;
+  }
+  for (uint32_t i = 0; i < e->zoneCount; i++) {
+    uint32_t c0, r0, c1, r1;
+    cellRange(e, e->zones[i], &c0, &r0, &c1, &r1);
+    for (uint32_t r = r0; r <= r1; r++) {
+      for (uint32_t c = c0; c <= c1; c++) e->cellStart[r * e->cols + c + 1]++;
+    }
+  }
+  for (uint32_t c = 0; c < cells; c++) e->cellStart[c + 1] += e->cellStart[c];
+  e->cellZones = (uint16_t*)malloc((e->cellStart[cells] + 1) * sizeof(uint16_t));
+  uint32_t* fill = (uint32_t*)malloc(cells * sizeof(uint32_t));
+  if (!e->cellZones || !fill) {
+    free(fill);
+    dropIndex(e);
+    return false;
+  }
+  memcpy(fill, e->cellStart, cells * sizeof(uint32_t));
+  for (uint32_t i = 0; i < e->zoneCount; i++) {
+    uint32_t c0, r0, c1, r1;
+    cellRange(e, e->zones[i], &c0, &r0, &c1, &r1);
+    for (uint32_t r = r0; r <= r1; r++) {
+      for (uint32_t c = c0; c <= c1; c++) e->cellZones[fill[r * e->cols + c]++] = (uint16_t)i;
+    }
+  }
+  free(fill);
+  return true;
+}
+
+// ============================================================================
+// Tracking
+// ============================================================================
+
+/**
+ * @brief Apply exits, then entries among the candidate zones.
+ */
+static size_t track(GfEngine* e, uint32_t tag, float x, float y, const uint16_t* candidates,
+                    uint32_t candidateCount, bool all, GfEvent* out, size_t max) {
+  if (tag >= e->tagCount) return 0;
+  GfTag& t = e->tags[tag];
+  size_t n = 0;
+
+  // Exits: only the zones the tag is in
+  for (uint8_t i = 0; i < t.insideCount && n < max;) {
+    uint16_t z = t.inside[i];
+    if (gfOutsideDistance(e, z, x, y) <= e->hysteresis) {
+      i++;
+      continue;
+    }
+    out[n++] = { tag, z, false };
+    t.inside[i] = t.inside[--t.insideCount];
+  }
+
+  // Entries: zones listed for the position's cell (or every zone)
+  uint32_t count = all ? e->zoneCount : candidateCount;
+  for (uint32_t k = 0; k < count && n < max && t.insideCount < GF_MAX_INSIDE; k++) {
+    uint16_t z = all ? (uint16_t)k : candidates[k];
+    if (!gfContains(e, z, x, y)) continue;
+    bool known = false;
+    for (uint8_t i = 0; i < t.insideCount; i++) known = known || t.inside[i] == z;
+    if (known) continue;
+    t.inside[t.insideCount++] = z;
+    out[n++] = { tag, z, true };
+  }
+  return n;
+}
+
+size_t gfUpdate(GfEngine* e, uint32_t tag, float x, float y, GfEvent* out, size_t max) {
+  float fx = (x - e->originX) / e->cellSize, fy = (y - e->originY) / e->cellSize;
+  const uint16_t* candidates = nullptr;
+  uint32_t count = 0;
+  if (e->cellStart && fx >= 0.0f && fy >= 0.0f && fx < e->cols && fy < e->rows) {
+    uint32_t cell = (uint32_t)fy * e->cols + (uint32_t)fx;
+    candidates = e->cellZones + e->cellStart[cell];
+    count = e->cellStart[cell + 1] - e->cellStart[cell];
+  }
+  return track(e, tag, x, y, candidates, count, false, out, max);
+}
+
+size_t gfUpdateScan(GfEngine* e, uint32_t tag, float x, float y, GfEvent* out, size_t max) {
+  return track(e, tag, x, y, nullptr, 0, true, out, max);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file geofence.h
+ * @brief Enter/exit alerts for many tags against circle and polygon zones.
+ *
+ * Zones are indexed in a uniform grid: each cell lists the zones whose
+ * bounding box overlaps it. A position update of a tag only tests
+ *
+ * - the zones the tag was inside after its previous update, for exit, and
+ * - the zones listed in the cell of the new position, for entry,
+ *
+ * so its cost depends on how crowded the neighbourhood is, not on the total
+ * number of zones.
+ *
+ * Entry and exit use hysteresis: a tag enters a zone as soon as its position
+ * is inside, and only exits once it is more than `hysteresis` metres outside
+ * the boundary, so position noise near an edge does not raise a stream of
+ * alternating alerts.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Zones a tag can be inside at once; further entries are not reported. */
+#define GF_MAX_INSIDE 8
+
+/**
+ * @brief Zone shapes.
+ */
+enum GfShape : uint8_t {
+  GF_CIRCLE  = 1,   /**< Centre and radius. */
+  GF_POLYGON = 2,   /**< Simple polygon, vertices in order. */
+};
+
+/**
+ * @brief Point on the floor plan (m).
+ */
+struct GfPoint {
+  float x;   /**< East. */
+  float y;   /**< North. */
+};
+
+/**
+ * @brief One zone.
+ */
+struct GfZone {
+  uint8_t  shape;          /**< GfShape. */
+  uint16_t vertexCount;    /**< Polygon vertices. */
+  uint32_t firstVertex;    /**< Index of the first vertex in GfEngine::vertices. */
+  float    cx, cy, r;      /**< Circle centre and radius. */
+  float    minX, minY;     /**< Bounding box. */
+  float    maxX, maxY;     /**< Bounding box. */
+};
+
+/**
+ * @brief Zones a tag is inside after its last update.
+ */
+struct GfTag {
+  uint8_t  insideCount;             /**< Zones in `inside`. */
+  uint16_t inside[GF_MAX_INSIDE];   /**< Zones the tag is inside. */
+};
+
+/**
+ * @brief One alert.
+ */
+struct GfEvent {
+  uint32_t tag;     /**< Tag. */
+  uint16_t zone;    /**< Zone. */
+  bool     enter;   /**< True on entry, false on exit. */
+};
+
+/**
+ * @brief Zones, their grid and the tags' state.
+ */
+struct GfEngine {
+  GfZone*   zones;        /**< Zones, indexed by id. */
+  uint32_t  zoneCount;    /**< Zones in use. */
+  uint32_t  zoneCap;      /**< Allocated zones. */
+  GfPoint*  vertices;     /**< Polygon vertices of all zones. */
+  uint32_t  vertexCount;  /**< Vertices in use. */
+  uint32_t  vertexCap;    /**< Allocated vertices. */
+  GfTag*    tags;         /**< Per-tag state. */
+  uint32_t  tagCount;     /**< Tags. */
+  float     hysteresis;   /**< Exit margin (m). */
+  // Grid, rebuilt by gfBuildIndex()
+  float     originX;      /**< Lower left corner of the grid. */
+  float     originY;      /**< Lower left corner of the grid. */
+  float     cellSize;     /**< Cell edge (m). */
+  uint32_t  cols, rows;   /**< Grid size. */
+  uint32_t* cellStart;    /**< Zones of cell c: cellZones[cellStart[c] .. cellStart[c + 1]). */
+  uint16_t* cellZones;    /**< Zone ids per cell. */
+};
+
+/**
+ * @brief Start an engine with no zones.
+ *
+ * @param[in] tags       Number of tags (ids 0 .. tags - 1).
+ * @param[in] hysteresis Distance outside a zone before an exit (m).
+ * @return False if memory is exhausted.
+ */
+bool gfInit(GfEngine* e, uint32_t tags, float hysteresis);
+
+/**
+ * @brief Release an engine.
+ */
+void gfFree(GfEngine* e);
+
+/**
+ * @brief Add a circle zone.
+ *
+ * @return Zone id, or -1 if memory or ids are exhausted.
+ */
+int gfAddCircle(GfEngine* e, float cx, float cy, float r);
+
+/**
+ * @brief Add a polygon zone (at least 3 vertices, copied).
+ *
+ * @return Zone id, or -1 if memory or ids are exhausted.
+ */
+int gfAddPolygon(GfEngine* e, const GfPoint* points, uint16_t count);
+
+/**
+ * @brief Build the grid over the zones added so far.
+ *
+ * @param[in] cellSize Cell edge (m); about the size of a typical zone.
+ */
+bool gfBuildIndex(GfEngine* e, float cellSize);
+
+/**
+ * @brief Whether a point is inside a zone.
+ */
+bool gfContains(const GfEngine* e, uint16_t zone, float x, float y);
+
+/**
+ * @brief Distance from a point outside a zone to its boundary, 0 inside (m).
+ */
+float gfOutsideDistance(const GfEngine* e, uint16_t zone, float x, float y);
+
+/**
+ * @brief Move a tag and report the zones it entered or left.
+ *
+ * A state change is only applied if its event fits in `out`.
+ *
+ * @param[in]  tag Tag.
+ * @param[in]  x   New position east (m).
+ * @param[in]  y   New position north (m).
+ * @param[out] out Events, exits first.
+ * @param[in]  max Capacity of `out`.
+ * @return Number of events written.
+ */
+size_t gfUpdate(GfEngine* e, uint32_t tag, float x, float y, GfEvent* out, size_t max);
+
+/**
+ * @brief gfUpdate() testing every zone instead of the grid cell, for
+ *        reference.
+ */
+size_t gfUpdateScan(GfEngine* e, uint32_t tag, float x, float y, GfEvent* out, size_t max);
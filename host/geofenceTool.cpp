@@ -0,0 +1,212 @@
+/**
+ * @file geofenceTool.cpp
+ * @brief Throughput and alert benchmark of the geofence engine (geofence.h).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 geofenceTool.cpp geofence.cpp -o geofenceTool
+ *
+ * Usage:
+ *
+ *     geofenceTool bench [tags] [zones] [steps]
+ *
+ * `bench` scatters circle and polygon zones (half each, 2 to 12 m across
+ * their widest) over a 400x400 m site and moves `tags` (default 1000) tags
+ * through it, walking and standing for 30 to 120 s in turn, one noisy
+ * position per tag and second, for `steps` (default 600) seconds. It
+ * reports position updates per second of the grid index at several cell
+ * sizes against testing every zone (default 500), checks that both raise
+ * the same alerts, and counts alerts per tag and hour with and without
+ * hysteresis.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "geofence.h"
+
+// ============================================================================
+// Scenario
+// ============================================================================
+
+/** @brief Site edge (m). */
+#define SITE 400.0
+
+/** @brief Walking speed (m/s). */
+#define SPEED 1.4
+
+/** @brief Standard deviation of the position noise (m). */
+#define NOISE 0.7
+
+/** @brief Events one update can raise at most. */
+#define MAX_EVENTS (2 * GF_MAX_INSIDE)
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Add the same random zones to an engine for a given seed.
+ */
+static void addZones(GfEngine* e, uint32_t zones, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> pos(0.0f, (float)SITE), size(1.0f, 6.0f), unit(0.0f, 1.0f);
+  for (uint32_t i = 0; i < zones; i++) {
+    float cx = pos(rng), cy = pos(rng), r = size(rng);
+    if (i % 2 == 0) {
+      gfAddCircle(e, cx, cy, r);
+      continue;
+    }
+    // Star-shaped polygon: sorted angles, radii between 0.6 r and r
+    GfPoint pts[8];
+    uint16_t n = 3 + (uint16_t)(unit(rng) * 6);
+    float angles[8];
+    for (uint16_t k = 0; k < n; k++) angles[k] = unit(rng) * 2.0f * (float)M_PI;
+    std::sort(angles, angles + n);
+    for (uint16_t k = 0; k < n; k++) {
+      float rr = r * (0.6f + 0.4f * unit(rng));
+      pts[k] = { cx + rr * cosf(angles[k]), cy + rr * sinf(angles[k]) };
+    }
+    gfAddPolygon(e, pts, n);
+  }
+}
+
+/**
+ * @brief Measured positions of every tag at every step, step-major.
+ *
+ * Tags alternate walking and standing still, so some stand near a zone
+ * edge where the position noise alone crosses it.
+ */
+static std::vector<GfPoint> walk(uint32_t tags, uint32_t steps, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+  std::vector<double> x(tags), y(tags), heading(tags);
+  std::vector<int> left(tags);
+  std::vector<bool> moving(tags);
+  for (uint32_t t = 0; t < tags; t++) {
+    x[t] = SITE * uni(rng);
+    y[t] = SITE * uni(rng);
+    heading[t] = 2 * M_PI * uni(rng);
+    moving[t] = uni(rng) < 0.5;
+    left[t] = (int)(120 * uni(rng));
+  }
+  std::vector<GfPoint> out((size_t)tags * steps);
+  for (uint32_t s = 0; s < steps; s++) {
+    for (uint32_t t = 0; t < tags; t++) {
+      if (--left[t] <= 0) {
+        moving[t] = !moving[t];
+        left[t] = (int)(30 + 90 * uni(rng));
+      }
+      if (moving[t]) {
+        heading[t] += 0.4 * gauss(rng);
+        x[t] += SPEED * cos(heading[t]);
+        y[t] += SPEED * sin(heading[t]);
+      }
+      if (x[t] < 0 || x[t] > SITE) { heading[t] = M_PI - heading[t]; x[t] = std::min(std::max(x[t], 0.0), SITE); }
+      if (y[t] < 0 || y[t] > SITE) { heading[t] = -heading[t]; y[t] = std::min(std::max(y[t], 0.0), SITE); }
+      out[(size_t)s * tags + t] = { (float)(x[t] + NOISE * gauss(rng)), (float)(y[t] + NOISE * gauss(rng)) };
+    }
+  }
+  return out;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/**
+ * @brief Outcome of one run over the walk.
+ */
+struct RunResult {
+  double   updatesPerSec;   /**< Throughput. */
+  uint64_t events;          /**< Alerts raised. */
+  uint64_t digest;          /**< Hash of the alert sequence. */
+};
+
+/**
+ * @brief Run the walk through an engine.
+ *
+ * @param[in] cellSize Grid cell (m), or 0 to test every zone.
+ */
+static RunResult run(uint32_t tags, uint32_t zones, uint32_t steps, const std::vector<GfPoint>& pos,
+                     float cellSize, float hysteresis) {
+  GfEngine e;
+  gfInit(&e, tags, hysteresis);
+  addZones(&e, zones, 42);
+  if (cellSize > 0.0f) gfBuildIndex(&e, cellSize);
+  RunResult r = {};
+  GfEvent ev[MAX_EVENTS];
+  double t0 = nowSec();
+  for (uint32_t s = 0; s < steps; s++) {
+    for (uint32_t t = 0; t < tags; t++) {
+      const GfPoint& p = pos[(size_t)s * tags + t];
+      size_t n = cellSize > 0.0f ? gfUpdate(&e, t, p.x, p.y, ev, MAX_EVENTS)
+                                 : gfUpdateScan(&e, t, p.x, p.y, ev, MAX_EVENTS);
+      for (size_t k = 0; k < n; k++) {
+        r.digest = r.digest * 1000003u + ((uint64_t)ev[k].tag << 20) + ((uint64_t)ev[k].zone << 1) + ev[k].enter;
+      }
+      r.events += n;
+    }
+  }
+  r.updatesPerSec = (double)tags * steps / (nowSec() - t0);
+  gfFree(&e);
+  return r;
+}
+
+static int bench(uint32_t tags, uint32_t zones, uint32_t steps) {
+  printf("%u tags, %u zones over %.0fx%.0f m, %u s at %.1f m/s, position noise %.1f m\n\n", tags, zones,
+         SITE, SITE, steps, SPEED, NOISE);
+  std::vector<GfPoint> pos = walk(tags, steps, 7);
+
+  const float HYSTERESIS = 1.5f;
+  RunResult scan = run(tags, zones, steps, pos, 0.0f, HYSTERESIS);
+  printf("index        updates/s  speedup  alerts  same\n");
+  printf("%-12s %9.0f %8s %7llu %5s\n", "every zone", scan.updatesPerSec, "1.0x", (unsigned long long)scan.events, "-");
+  for (float cell : { 5.0f, 10.0f, 20.0f, 50.0f }) {
+    RunResult g = run(tags, zones, steps, pos, cell, HYSTERESIS);
+    char name[32];
+    snprintf(name, sizeof(name), "grid %.0f m", cell);
+    printf("%-12s %9.0f %7.1fx %7llu %5s\n", name, g.updatesPerSec, g.updatesPerSec / scan.updatesPerSec,
+           (unsigned long long)g.events, g.digest == scan.digest && g.events == scan.events ? "yes" : "NO");
+  }
+
+  printf("\nhysteresis m  alerts per tag-hour\n");
+  double hours = steps / 3600.0;
+  for (float h : { 0.0f, 0.5f, 1.5f, 3.0f }) {
+    RunResult g = run(tags, zones, steps, pos, 10.0f, h);
+    printf("%12.1f %20.1f\n", h, g.events / (tags * hours));
+  }
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long tags = argc > 2 ? atol(argv[2]) : 1000;
+    long zones = argc > 3 ? atol(argv[3]) : 500;
+    long steps = argc > 4 ? atol(argv[4]) : 600;
+    if (tags <= 0 || zones <= 0 || zones > 0xFFFF || steps <= 0) {
+      fprintf(stderr, "bench: tags, zones (at most 65535) and steps must be positive\n");
+      return 1;
+    }
+    return bench((uint32_t)tags, (uint32_t)zones, (uint32_t)steps);
+  }
+  fprintf(stderr, "usage: geofenceTool bench [tags] [zones] [steps]\n");
+  return 1;
+}
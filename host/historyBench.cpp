@@ -0,0 +1,241 @@
+/**
+ * @file historyBench.cpp
+ * @brief Encoding density, append cost and range-query cost of the Tracker's
+ *        compressed history store (scanner/history.cpp), and its ordering
+ *        across a reboot.
+ *
+ * Each tag records one distance sample per second (with task jitter) for
+ * `hours` hours: RSSI ranging noise around a slowly drifting distance, and
+ * the tag's movement flag in runs of a few minutes. Reported:
+ *
+ * - bytes per sample in the sealed blocks against a plain 13-byte record
+ *   (64-bit time, float distance, flag), and the encoded bits per sample;
+ * - mean and worst append time (the worst includes sealing a block, a RAM
+ *   copy here instead of a flash erase and write);
+ * - "last N minutes" queries for 1, 10 and 60 minutes, against a query over
+ *   the whole ring.
+ *
+ * Every stored sample must decode to the one appended, in time order. The
+ * store is then reopened as after a reboot: the newest stored timestamp must
+ * be the last sealed one, a sample older than that must be refused, and
+ * history must still come out in time order after new appends. The bench
+ * exits with status 1 if any check fails.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 -DHISTORY_HOST_SLOTS=256 historyBench.cpp ../scanner/history.cpp -o historyBench
+ *
+ * Usage:
+ *
+ *     historyBench [hours]
+ *
+ * Hours default to 24; the ring (HISTORY_HOST_SLOTS blocks) keeps the newest
+ * part when it fills.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "../scanner/history.h"
+
+/** @brief Nominal sample period (ms). */
+#define BENCH_PERIOD_MS 1000
+
+/** @brief Queries timed per window length. */
+#define BENCH_QUERIES 200
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Deterministic xorshift64* stream. */
+static uint64_t gRng = 0x853c49e6748fea9bULL;
+static uint64_t next64() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return gRng * 0x2545f4914f6cdd1dULL;
+}
+
+/** @brief Uniform in [0, 1). */
+static double uniform() {
+  return (next64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** @brief Standard normal (Box-Muller). */
+static double gaussian() {
+  double u = uniform() + 1e-12;
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform());
+}
+
+/** @brief Distance as the store keeps it. */
+static float quantise(float d) {
+  return roundf(d * HISTORY_DISTANCE_SCALE) / HISTORY_DISTANCE_SCALE;
+}
+
+/**
+ * @brief Visitor state checking the stored samples against the appended ones.
+ */
+struct CheckCtx {
+  const std::vector<HistorySample>* expect;  /**< Appended samples of the tag. */
+  size_t   next;                             /**< Next expected index. */
+  uint64_t lastTs;                           /**< Previous visited timestamp. */
+  unsigned wrong;                            /**< Mismatches and order faults. */
+};
+
+static bool checkVisitor(uint8_t, const HistorySample* s, void* p) {
+  CheckCtx* c = (CheckCtx*)p;
+  if (s->tsMs < c->lastTs) c->wrong++;
+  c->lastTs = s->tsMs;
+  if (c->expect) {
+    const HistorySample* e = c->next < c->expect->size() ? &(*c->expect)[c->next] : nullptr;
+    if (!e || e->tsMs != s->tsMs || e->distance != s->distance || e->moving != s->moving) c->wrong++;
+    c->next++;
+  }
+  return true;
+}
+
+static bool countVisitor(uint8_t, const HistorySample*, void*) {
+  return true;
+}
+
+/**
+ * @brief Check a tag's history: the newest appended samples, in order.
+ *
+ * @return Number of faults.
+ */
+static unsigned checkTag(uint8_t tag, const std::vector<HistorySample>& appended) {
+  CheckCtx c = { nullptr, 0, 0, 0 };
+  size_t stored = historyQuery(tag, 0, UINT64_MAX, checkVisitor, &c);
+  if (stored > appended.size()) return c.wrong + 1;
+  CheckCtx v = { &appended, appended.size() - stored, 0, 0 };
+  historyQuery(tag, 0, UINT64_MAX, checkVisitor, &v);
+  return c.wrong + v.wrong;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+int main(int argc, char** argv) {
+  double hours = argc > 1 ? atof(argv[1]) : 24;
+  if (hours <= 0) {
+    fprintf(stderr, "usage: historyBench [hours]\n");
+    return 2;
+  }
+  if (!historyInit()) {
+    fprintf(stderr, "historyBench: store unavailable\n");
+    return 1;
+  }
+
+  const uint64_t start = 1000ULL * 86400;
+  const uint32_t perTag = (uint32_t)(hours * 3600000.0 / BENCH_PERIOD_MS);
+  std::vector<HistorySample> appended[HISTORY_MAX_TAGS];
+  double meters[HISTORY_MAX_TAGS], drift[HISTORY_MAX_TAGS];
+  bool moving[HISTORY_MAX_TAGS];
+  for (int t = 0; t < HISTORY_MAX_TAGS; t++) {
+    meters[t] = 2 + 3 * t;
+    drift[t] = 0;
+    moving[t] = false;
+    appended[t].reserve(perTag);
+  }
+
+  // Record: the tags' samples interleave as the distance task sees them
+  uint64_t ts = start;
+  double appendSec = 0, worstSec = 0;
+  unsigned faults = 0;
+  for (uint32_t i = 0; i < perTag; i++) {
+    ts += BENCH_PERIOD_MS - 20 + next64() % 41;
+    for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) {
+      if (uniform() < 1.0 / 240) moving[t] = !moving[t];
+      drift[t] = moving[t] ? drift[t] * 0.95 + 0.05 * gaussian() * 0.6 : 0;
+      meters[t] += drift[t];
+      if (meters[t] < 0.5) meters[t] = 0.5;
+      if (meters[t] > 30) meters[t] = 30;
+      // 2 dB ranging noise at a path-loss exponent of 2.5
+      float d = (float)(meters[t] * pow(10.0, 2.0 * gaussian() / 25.0));
+      HistorySample s = { ts + t, quantise(d), (uint8_t)moving[t] };
+
+      double t0 = nowSec();
+      bool ok = historyAppend(t, s.tsMs, d, moving[t]);
+      double dt = nowSec() - t0;
+      appendSec += dt;
+      if (dt > worstSec) worstSec = dt;
+      if (!ok) faults++;
+      appended[t].push_back(s);
+    }
+  }
+  uint64_t samples = (uint64_t)perTag * HISTORY_MAX_TAGS;
+  HistoryStats st = historyGetStats();
+
+  printf("historyBench: %u tags, %.1f h at %u ms, %llu samples, ring %u blocks of %u bytes\n", HISTORY_MAX_TAGS,
+         hours, BENCH_PERIOD_MS, (unsigned long long)samples, st.slots, HISTORY_BLOCK_SIZE);
+  double kept = 0;
+  for (int t = 0; t < HISTORY_MAX_TAGS; t++) {
+    CheckCtx c = { nullptr, 0, 0, 0 };
+    kept += historyQuery((uint8_t)t, 0, UINT64_MAX, checkVisitor, &c);
+  }
+  printf("  encoded bits/sample %.2f; stored bytes/sample %.2f (sealed blocks) vs 13 raw, %.1fx\n",
+         (double)st.payloadBits / st.samples, (double)st.sealedBlocks * HISTORY_BLOCK_SIZE / st.samples,
+         13.0 * st.samples / ((double)st.sealedBlocks * HISTORY_BLOCK_SIZE));
+  printf("  append: mean %.0f ns, worst %.1f us (%u blocks sealed); %.1f h kept of %.1f h\n",
+         appendSec * 1e9 / samples, worstSec * 1e6, st.sealedBlocks,
+         kept / HISTORY_MAX_TAGS * BENCH_PERIOD_MS / 3.6e6, hours);
+
+  for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) faults += checkTag(t, appended[t]);
+
+  printf("  window    query us   samples   us/sample\n");
+  static const uint32_t windows[] = { 1, 10, 60, 0 };
+  for (uint32_t minutes : windows) {
+    size_t visited = 0;
+    double t0 = nowSec();
+    for (int q = 0; q < BENCH_QUERIES; q++) {
+      uint8_t tag = (uint8_t)(q % HISTORY_MAX_TAGS);
+      visited += minutes ? historyQueryLast(tag, ts, minutes, countVisitor, nullptr)
+                         : historyQuery(tag, 0, UINT64_MAX, countVisitor, nullptr);
+    }
+    double us = (nowSec() - t0) * 1e6 / BENCH_QUERIES;
+    double perQuery = (double)visited / BENCH_QUERIES;
+    if (minutes) printf("  %4u min  %9.1f  %8.0f  %10.3f\n", minutes, us, perQuery, us / perQuery);
+    else printf("  all ring  %9.1f  %8.0f  %10.3f\n", us, perQuery, us / perQuery);
+  }
+
+  // Reboot: seal the open blocks (a power loss would drop them), then reread
+  // the ring from the block headers
+  for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) historyFlush(t);
+  uint64_t lastTs = 0;
+  for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) {
+    if (appended[t].back().tsMs > lastTs) lastTs = appended[t].back().tsMs;
+  }
+  historyInit();
+  uint64_t latest = historyLatestMs();
+  bool latestOk = latest == lastTs;
+  // A clock restored from a save up to one window old would go backwards
+  bool olderRefused = !historyAppend(0, latest - 60000, 1.0f, false);
+  uint64_t resume = (latest / 1000 + 1) * 1000;
+  for (uint32_t i = 0; i < 600; i++) {
+    for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) {
+      HistorySample s = { resume + (uint64_t)i * BENCH_PERIOD_MS + t, quantise(3.0f), 0 };
+      if (!historyAppend(t, s.tsMs, 3.0f, false)) faults++;
+      appended[t].push_back(s);
+    }
+  }
+  unsigned rebootFaults = 0;
+  for (uint8_t t = 0; t < HISTORY_MAX_TAGS; t++) rebootFaults += checkTag(t, appended[t]);
+  printf("  reboot: newest stored %s, older sample %s, order after resume %s\n", latestOk ? "ok" : "WRONG",
+         olderRefused ? "refused" : "ACCEPTED", rebootFaults ? "WRONG" : "ok");
+  faults += rebootFaults + !latestOk + !olderRefused;
+
+  if (faults) fprintf(stderr, "historyBench: %u faults\n", faults);
+  return faults ? 1 : 0;
+}
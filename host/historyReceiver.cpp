@@ -0,0 +1,548 @@
+/**
+ * @file historyReceiver.cpp
+ * @brief Host-side receiver for the tracker's binary history export.
+ *
+ * Requests a time range of one tag's history over the tracker's USB-CDC
+ * serial port, acknowledges chunks as they arrive, resumes after stalls or
+ * corrupted frames, and writes the result as a memory-mappable columnar
+ * file.
+ *
+ * `bench` runs the tracker's exporter (scanner/historyExport.cpp over the
+ * history store) against this receiver on a simulated link in virtual time,
+ * with no serial port involved. It reports frame build and decode throughput
+ * of the framing (exportFrame.cpp), then transfer time, throughput and
+ * retransmissions at 0, 1 and 5 % frame loss (or the given loss) with the
+ * link running at USB-CDC speed (1 MB/s). Every sample must arrive intact and
+ * in order, including when the first END is lost; the bench exits with
+ * status 1 otherwise.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -I../scanner historyReceiver.cpp columnar.cpp ../scanner/exportFrame.cpp \
+ *         ../scanner/historyExport.cpp ../scanner/history.cpp -o historyReceiver
+ *
+ * Usage:
+ *
+ *     historyReceiver <serial-device> <out-file> [tag] [fromMs] [toMs]
+ *     historyReceiver bench [samples] [lossPercent]
+ *
+ * The output is a columnar file (see columnar.h) with the columns
+ * `ts` (int64 ms since epoch), `distance` (float32 m) and `moving` (uint8).
+ * The bench records `samples` (default 20000) samples into the store.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+
+#include "exportFrame.h"
+#include "historyExport.h"
+#include "history.h"
+#include "columnar.h"
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+/** @brief Silence after which the receiver re-requests from its position (ms). */
+#define RECEIVER_STALL_MS 2000
+
+/** @brief Give up after this many consecutive resume attempts. */
+#define RECEIVER_MAX_RETRIES 10
+
+/** @brief Simulated link rate in bytes per millisecond (USB-CDC full speed). */
+#define BENCH_LINK_BYTES_PER_MS 1000
+
+/** @brief Frames built and decoded for the framing throughput. */
+#define BENCH_FRAMES 20000
+
+// ============================================================================
+// Serial Link
+// ============================================================================
+
+/**
+ * @brief Open a serial device in raw 8N1 mode.
+ *
+ * USB-CDC ignores the baud rate; it is set only for UART bridges.
+ *
+ * @param[in] path Device path (e.g. /dev/ttyACM0).
+ * @return File descriptor, or -1 on error.
+ */
+static int openSerial(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+/**
+ * @brief Write a whole buffer.
+ */
+static bool writeAll(int fd, const uint8_t* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n <= 0) return false;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+/**
+ * @brief Monotonic clock in milliseconds.
+ */
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+/**
+ * @brief Received columns.
+ */
+struct Columns {
+  std::vector<int64_t> ts;        /**< Timestamps (ms since epoch). */
+  std::vector<float>   distance;  /**< Distances (m). */
+  std::vector<uint8_t> moving;    /**< Movement flags. */
+};
+
+/**
+ * @brief Receiver state of one transfer.
+ */
+struct Receiver {
+  uint8_t      tag;        /**< Requested tag. */
+  uint64_t     fromMs;     /**< Requested range start. */
+  uint64_t     toMs;       /**< Requested range end. */
+  Columns      cols;       /**< Samples received so far. */
+  FrameDecoder dec;        /**< Frame decoder. */
+  uint32_t     expected;   /**< Next chunk expected. */
+  uint32_t     badFrames;  /**< Frames dropped by the decoder. */
+  bool         done;       /**< END received with all chunks. */
+  void (*write)(const uint8_t* buf, size_t len, void* ctx);  /**< Link output. */
+  void*        ctx;        /**< Link context. */
+};
+
+/**
+ * @brief Send one message to the tracker.
+ */
+static void sendMsg(Receiver& r, uint8_t type, const uint8_t* body, size_t len) {
+  uint8_t frame[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+  r.write(frame, frameBuild(type, body, len, frame), r.ctx);
+}
+
+/**
+ * @brief Send an export request starting at the first missing chunk.
+ */
+static void sendRequest(Receiver& r) {
+  uint8_t body[21];
+  body[0] = r.tag;
+  putLe(&body[1], r.fromMs, 8);
+  putLe(&body[9], r.toMs, 8);
+  putLe(&body[17], r.expected, 4);
+  sendMsg(r, EXPORT_REQ, body, sizeof(body));
+}
+
+/**
+ * @brief Acknowledge all chunks below the expected one.
+ */
+static void sendAck(Receiver& r) {
+  uint8_t body[4];
+  putLe(body, r.expected, 4);
+  sendMsg(r, EXPORT_ACK, body, sizeof(body));
+}
+
+/**
+ * @brief Start a transfer and send its request.
+ */
+static void receiverStart(Receiver& r, uint8_t tag, uint64_t fromMs, uint64_t toMs,
+                          void (*write)(const uint8_t*, size_t, void*), void* ctx) {
+  r.tag = tag;
+  r.fromMs = fromMs;
+  r.toMs = toMs;
+  r.cols = Columns();
+  frameDecoderReset(&r.dec);
+  r.expected = 0;
+  r.badFrames = 0;
+  r.done = false;
+  r.write = write;
+  r.ctx = ctx;
+  sendRequest(r);
+}
+
+/**
+ * @brief Feed one received byte.
+ *
+ * @return True when a valid message was completed.
+ */
+static bool receiverPush(Receiver& r, uint8_t byte) {
+  uint8_t msg[FRAME_MAX_PAYLOAD];
+  size_t len;
+  if (!frameDecoderPush(&r.dec, byte, msg, &len)) {
+    if (byte == FRAME_DELIM) r.badFrames++;
+    return false;
+  }
+  if (r.done) return true;
+
+  if (msg[0] == EXPORT_DATA && len >= 6) {
+    uint32_t chunk = (uint32_t)getLe(&msg[1], 4);
+    uint8_t count = msg[5];
+    if (chunk == r.expected && len >= 6 + (size_t)count * EXPORT_RECORD_LEN) {
+      const uint8_t* p = &msg[6];
+      for (uint8_t i = 0; i < count; i++, p += EXPORT_RECORD_LEN) {
+        uint32_t bits = (uint32_t)getLe(p + 8, 4);
+        float d;
+        memcpy(&d, &bits, 4);
+        r.cols.ts.push_back((int64_t)getLe(p, 8));
+        r.cols.distance.push_back(d);
+        r.cols.moving.push_back(p[12]);
+      }
+      r.expected++;
+    }
+    // Cumulative ack; also re-acks after duplicates or gaps
+    sendAck(r);
+  } else if (msg[0] == EXPORT_END && len >= 9) {
+    uint32_t chunks = (uint32_t)getLe(&msg[1], 4);
+    if (chunks == r.expected) r.done = true;
+    else sendRequest(r);
+  }
+  return true;
+}
+
+/**
+ * @brief Nudge a stalled transfer.
+ *
+ * The first nudge re-acknowledges (the tracker resends its window, or END
+ * if END was lost); later ones re-request from the first missing chunk, in
+ * case the tracker dropped the transfer (e.g. it rebooted).
+ */
+static void receiverStalled(Receiver& r, int retry) {
+  if (retry == 1) sendAck(r);
+  else sendRequest(r);
+}
+
+// ============================================================================
+// Columnar Output
+// ============================================================================
+
+/**
+ * @brief Write the received columns as a columnar file.
+ */
+static bool writeColumns(const char* path, const Columns& c) {
+  static const ColumnSpec SCHEMA[] = {
+    { "ts",       COL_INT64,   { 0 } },
+    { "distance", COL_FLOAT32, { 0 } },
+    { "moving",   COL_UINT8,   { 0 } },
+  };
+  ColumnarWriter w;
+  if (!columnarWriterOpen(&w, path, SCHEMA, 3, 0)) return false;
+  const void* data[3] = { c.ts.data(), c.distance.data(), c.moving.data() };
+  bool ok = columnarWriterAppend(&w, c.ts.size(), data);
+  return columnarWriterClose(&w) && ok;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/** @brief Monotonic clock in seconds, for timing. */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Deterministic xorshift64* stream. */
+static uint64_t gRng = 0x6a09e667f3bcc909ULL;
+static uint64_t next64() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return gRng * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief One direction of the simulated link: whole frames, rate limited.
+ */
+struct Pipe {
+  std::vector<uint8_t> bytes;      /**< Bytes in flight, oldest first. */
+  size_t   head;                   /**< Bytes already delivered. */
+  uint32_t lossPpm;                /**< Chance of corrupting a frame, per million. */
+  uint32_t dropEnds;               /**< END frames still to drop. */
+  uint64_t wireBytes;              /**< Bytes written. */
+  uint32_t frames;                 /**< Frames written. */
+};
+
+/** @brief Tracker to host and host to tracker. */
+static Pipe gUp, gDown;
+
+/** @brief Virtual clock (ms). */
+static uint32_t gBenchMs;
+
+/** @brief Queue a frame, corrupting one byte at the loss rate. */
+static void pipeWrite(Pipe& p, const uint8_t* buf, size_t len) {
+  p.wireBytes += len;
+  p.frames++;
+  size_t at = p.bytes.size();
+  p.bytes.insert(p.bytes.end(), buf, buf + len);
+  // Frames are COBS-encoded: the type is the second byte when the first is a code
+  bool end = len > 2 && buf[len - 1] == FRAME_DELIM;
+  uint8_t plain[FRAME_MAX_PAYLOAD];
+  if (end && p.dropEnds) {
+    size_t start = buf[0] == FRAME_DELIM ? 1 : 0;
+    size_t n = cobsDecode(buf + start, len - start - 1, plain);
+    if (n > 0 && plain[0] == EXPORT_END) {
+      p.dropEnds--;
+      p.bytes[at + start] ^= 0x55;
+      return;
+    }
+  }
+  if (p.lossPpm && next64() % 1000000 < p.lossPpm) p.bytes[at + next64() % (len - 1)] ^= 0x55;
+}
+
+static size_t benchRead(uint8_t* buf, size_t max) {
+  size_t n = gDown.bytes.size() - gDown.head;
+  if (n > max) n = max;
+  memcpy(buf, &gDown.bytes[gDown.head], n);
+  gDown.head += n;
+  return n;
+}
+
+static void benchWrite(const uint8_t* buf, size_t len) {
+  pipeWrite(gUp, buf, len);
+}
+
+static uint32_t benchMillis() {
+  return gBenchMs;
+}
+
+static void benchHostWrite(const uint8_t* buf, size_t len, void*) {
+  pipeWrite(gDown, buf, len);
+}
+
+/** @brief Exporter side of the simulated link. */
+static const ExportIo BENCH_IO = { benchRead, benchWrite, benchMillis };
+
+/**
+ * @brief Time frame building and decoding of full DATA chunks.
+ */
+static void benchFraming() {
+  uint8_t body[5 + EXPORT_RECORDS_PER_CHUNK * EXPORT_RECORD_LEN];
+  for (uint8_t& b : body) b = (uint8_t)next64();
+  std::vector<uint8_t> stream;
+  uint8_t frame[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+
+  double t0 = nowSec();
+  size_t built = 0;
+  for (int i = 0; i < BENCH_FRAMES; i++) {
+    body[0] = (uint8_t)i;
+    size_t len = frameBuild(EXPORT_DATA, body, sizeof(body), frame);
+    if (i < 1000) stream.insert(stream.end(), frame, frame + len);
+    built += len;
+  }
+  double buildS = nowSec() - t0;
+
+  FrameDecoder dec;
+  frameDecoderReset(&dec);
+  uint8_t msg[FRAME_MAX_PAYLOAD];
+  size_t len, decoded = 0;
+  t0 = nowSec();
+  for (int rep = 0; rep < BENCH_FRAMES / 1000; rep++) {
+    for (uint8_t b : stream) decoded += frameDecoderPush(&dec, b, msg, &len);
+  }
+  double decodeS = nowSec() - t0;
+
+  printf("framing: %u DATA frames of %zu bytes (%zu on the wire, %.1f%% overhead)\n", BENCH_FRAMES,
+         sizeof(body) + 5, built / BENCH_FRAMES, 100.0 * (built / BENCH_FRAMES) / (sizeof(body) + 5) - 100);
+  printf("  build %.0f MB/s, decode %.0f MB/s (%zu frames decoded)\n", built / 1e6 / buildS,
+         stream.size() * (BENCH_FRAMES / 1000) / 1e6 / decodeS, decoded);
+}
+
+/**
+ * @brief Run one transfer on the simulated link.
+ *
+ * @return Number of faults (missing, wrong or reordered samples, no END).
+ */
+static unsigned benchTransfer(const std::vector<HistorySample>& expect, uint32_t lossPpm, uint32_t dropEnds) {
+  gUp = Pipe();
+  gDown = Pipe();
+  gUp.lossPpm = gDown.lossPpm = lossPpm;
+  gUp.dropEnds = dropEnds;
+  gBenchMs = 0;
+  historyExportInit(&BENCH_IO);
+
+  Receiver r;
+  receiverStart(r, 0, 0, UINT64_MAX, benchHostWrite, nullptr);
+  uint32_t lastRx = 0;
+  int retries = 0;
+  double t0 = nowSec();
+  while (!r.done && retries <= RECEIVER_MAX_RETRIES) {
+    historyExportPoll();
+    // Deliver what the link carries in one millisecond
+    size_t budget = BENCH_LINK_BYTES_PER_MS;
+    while (budget > 0 && gUp.head < gUp.bytes.size()) {
+      if (receiverPush(r, gUp.bytes[gUp.head++])) {
+        lastRx = gBenchMs;
+        retries = 0;
+      }
+      budget--;
+    }
+    if (!r.done && gBenchMs - lastRx > RECEIVER_STALL_MS) {
+      receiverStalled(r, ++retries);
+      lastRx = gBenchMs;
+    }
+    gBenchMs++;
+  }
+  double cpuS = nowSec() - t0;
+
+  unsigned faults = r.done ? 0 : 1;
+  if (r.cols.ts.size() != expect.size()) faults++;
+  for (size_t i = 0; i < r.cols.ts.size() && i < expect.size(); i++) {
+    if ((uint64_t)r.cols.ts[i] != expect[i].tsMs || r.cols.distance[i] != expect[i].distance ||
+        r.cols.moving[i] != expect[i].moving) {
+      faults++;
+    }
+  }
+  double secs = gBenchMs / 1000.0;
+  double payload = (double)r.cols.ts.size() * EXPORT_RECORD_LEN;
+  uint32_t chunks = r.expected ? r.expected : 1;
+  printf("  %5.1f%%  %6u  %8.2f  %9.1f  %8.1f%%  %7u  %6u  %7.0f  %s\n", lossPpm / 1e4, dropEnds, secs,
+         secs > 0 ? payload / 1024.0 / secs : 0.0, 100.0 * payload / gUp.wireBytes,
+         gUp.frames > chunks + 1 ? gUp.frames - chunks - 1 : 0, r.badFrames, cpuS * 1e9 / (expect.size() + 1),
+         faults ? "FAIL" : "ok");
+  return faults;
+}
+
+static bool countVisitor(uint8_t, const HistorySample*, void*) {
+  return true;
+}
+
+/**
+ * @brief Bench mode: framing throughput and transfers over a lossy link.
+ */
+static int bench(int argc, char** argv) {
+  uint32_t samples = argc > 2 ? (uint32_t)atol(argv[2]) : 20000;
+  double loss = argc > 3 ? atof(argv[3]) : -1;
+  if (!historyInit()) {
+    fprintf(stderr, "bench: history store unavailable\n");
+    return 1;
+  }
+  std::vector<HistorySample> expect;
+  uint64_t ts = 1000ULL * 86400;
+  for (uint32_t i = 0; i < samples; i++) {
+    ts += 990 + next64() % 21;
+    float d = (float)(next64() % 3000) / 100.0f;
+    bool moving = (i / 120) & 1;
+    if (!historyAppend(0, ts, d, moving)) continue;
+    expect.push_back({ ts, roundf(d * HISTORY_DISTANCE_SCALE) / HISTORY_DISTANCE_SCALE, (uint8_t)moving });
+  }
+  historyFlush(0);
+  // The ring keeps the newest samples when it fills
+  size_t stored = historyQuery(0, 0, UINT64_MAX, countVisitor, nullptr);
+  expect.erase(expect.begin(), expect.end() - stored);
+
+  benchFraming();
+  printf("transfer: %zu samples over a %u KB/s link, window %u, timeout %u ms\n", expect.size(),
+         BENCH_LINK_BYTES_PER_MS * 1000 / 1024, HISTORY_EXPORT_WINDOW, HISTORY_EXPORT_TIMEOUT_MS);
+  printf("   loss  ENDs lost   link s       KB/s  goodput   resent     bad  cpu ns/sample\n");
+  unsigned faults = 0;
+  if (loss >= 0) {
+    faults += benchTransfer(expect, (uint32_t)(loss * 1e4), 0);
+  } else {
+    static const uint32_t lossPpm[] = { 0, 10000, 50000 };
+    for (uint32_t ppm : lossPpm) faults += benchTransfer(expect, ppm, 0);
+  }
+  faults += benchTransfer(expect, 0, 1);
+  if (faults) fprintf(stderr, "bench: %u faults\n", faults);
+  return faults ? 1 : 0;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/** @brief Serial link output of the receiver. */
+static void serialWrite(const uint8_t* buf, size_t len, void* ctx) {
+  writeAll(*(int*)ctx, buf, len);
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) return bench(argc, argv);
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <serial-device> <out-file> [tag] [fromMs] [toMs]\n", argv[0]);
+    fprintf(stderr, "       %s bench [samples] [lossPercent]\n", argv[0]);
+    return 2;
+  }
+  uint8_t tag = argc > 3 ? (uint8_t)atoi(argv[3]) : 0;
+  uint64_t fromMs = argc > 4 ? strtoull(argv[4], nullptr, 10) : 0;
+  uint64_t toMs = argc > 5 ? strtoull(argv[5], nullptr, 10) : UINT64_MAX;
+
+  int fd = openSerial(argv[1]);
+  if (fd < 0) {
+    perror("open");
+    return 1;
+  }
+
+  Receiver r;
+  int retries = 0;
+  uint64_t start = nowMs();
+  uint64_t lastRx = start;
+  receiverStart(r, tag, fromMs, toMs, serialWrite, &fd);
+
+  while (!r.done) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int pr = poll(&pfd, 1, 100);
+    if (pr > 0) {
+      uint8_t buf[4096];
+      ssize_t n = read(fd, buf, sizeof(buf));
+      for (ssize_t i = 0; i < n && !r.done; i++) {
+        if (receiverPush(r, buf[i])) {
+          lastRx = nowMs();
+          retries = 0;
+        }
+      }
+    }
+
+    if (!r.done && nowMs() - lastRx > RECEIVER_STALL_MS) {
+      if (++retries > RECEIVER_MAX_RETRIES) {
+        fprintf(stderr, "tracker not responding, giving up at chunk %u\n", r.expected);
+        break;
+      }
+      fprintf(stderr, "stalled, resuming at chunk %u\n", r.expected);
+      receiverStalled(r, retries);
+      lastRx = nowMs();
+    }
+  }
+  close(fd);
+
+  double secs = (nowMs() - start) / 1000.0;
+  size_t bytes = r.cols.ts.size() * EXPORT_RECORD_LEN;
+  fprintf(stderr, "%zu samples in %u chunks, %.2f s, %.1f KB/s, %u bad frames\n",
+          r.cols.ts.size(), r.expected, secs, secs > 0 ? bytes / 1024.0 / secs : 0.0, r.badFrames);
+
+  if (!writeColumns(argv[2], r.cols)) {
+    perror("write");
+    return 1;
+  }
+  return r.done ? 0 : 1;
+}
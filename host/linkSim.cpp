@@ -0,0 +1,254 @@
+/**
+ * @file linkSim.cpp
+ * @brief Time-to-ready of several tags through the tracker's connection
+ *        manager (scanner/connManager.cpp), against simulated BLE links.
+ *
+ * A discrete-event model stands in for the controller and the tags:
+ *
+ * - connect:   the tag's next advertisement (interval ADV_INTERVAL_MS plus a
+ *              0-10 ms random delay), then the first connection event;
+ * - discovery: DISCOVERY_ROUND_TRIPS ATT request/response pairs;
+ * - subscribe: SUBSCRIBE_ROUND_TRIPS pairs (encryption with a bonded tag and
+ *              the notification descriptor write);
+ *
+ * where each round trip waits for the next connection event of the link
+ * (interval CONN_INTERVAL_MS). Every step fails with probability `failPct`;
+ * half of the failures are reported by the stack, the rest never complete
+ * and run into the manager's timeouts. The manager's scanner-task tick runs
+ * every TICK_MS, and every SCAN_MS a finished scan requests the tags again
+ * (a tag given up after CONN_MAX_ATTEMPTS starts over).
+ *
+ * All tags are requested at time zero (as after one scan). Two pipelines
+ * are compared:
+ *
+ * - sequential: one link in progress at a time, like the former blocking
+ *               connect, discover and subscribe in the scanner task;
+ * - pipelined:  links in discovery or subscription while the next one
+ *               connects (the controller still initiates one at a time).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -DCONN_MAX_LINKS=8 -I../scanner linkSim.cpp ../scanner/connManager.cpp -o linkSim
+ *
+ * Usage:
+ *
+ *     linkSim [trials] [failPct]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <vector>
+#include "connManager.h"
+
+// ============================================================================
+// Model
+// ============================================================================
+
+#define ADV_INTERVAL_MS        35   /**< Tag advertising interval. */
+#define CONN_INTERVAL_MS       30   /**< Connection interval. */
+#define DISCOVERY_ROUND_TRIPS   8   /**< Service, characteristic and descriptor discovery. */
+#define SUBSCRIBE_ROUND_TRIPS   4   /**< Encryption and descriptor write. */
+#define OPEN_FAIL_INTERVALS     6   /**< Intervals until a failed connection is reported. */
+#define TICK_MS                31   /**< Scanner task period. */
+#define SCAN_MS              5000   /**< Scan length; tags without a link are requested again. */
+#define SIM_LIMIT_MS        60000   /**< Give up a trial after this long. */
+
+/**
+ * @brief A completion the simulated stack will report.
+ */
+struct SimEvent {
+  uint32_t timeMs;   /**< When it is reported. */
+  uint8_t  link;     /**< Link index. */
+  LinkStep step;     /**< Completed step. */
+  bool     ok;       /**< Outcome. */
+  uint32_t gen;      /**< Link generation; a close makes pending events stale. */
+  bool operator>(const SimEvent& o) const { return timeMs > o.timeMs; }
+};
+
+/**
+ * @brief Simulated controller and tags.
+ */
+struct Sim {
+  std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+  std::mt19937 rng;
+  uint32_t nowMs;
+  uint32_t gen[CONN_MAX_LINKS];
+  double failProb;
+  int maxConnecting;    /**< Most links seen connecting at once. */
+};
+
+static Sim sim;
+
+static double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(sim.rng); }
+
+/**
+ * @brief Duration of `trips` ATT round trips on an established link.
+ */
+static uint32_t roundTrips(int trips) {
+  double t = uniform() * CONN_INTERVAL_MS;  // wait for the next connection event
+  t += trips * CONN_INTERVAL_MS;
+  return (uint32_t)t;
+}
+
+/**
+ * @brief Schedule the completion of a step, failing it with `failProb`.
+ */
+static bool schedule(uint8_t link, LinkStep step, uint32_t okMs, uint32_t failMs) {
+  bool fail = uniform() < sim.failProb;
+  if (fail && uniform() < 0.5) return true;  // silent failure: the manager times out
+  sim.events.push({ sim.nowMs + (fail ? failMs : okMs), link, step, !fail, sim.gen[link] });
+  return true;
+}
+
+static bool simOpen(uint8_t link, const LinkAddr*, void*) {
+  uint32_t adv = (uint32_t)(uniform() * (ADV_INTERVAL_MS + 10));
+  uint32_t setup = (uint32_t)(CONN_INTERVAL_MS * (1.0 + uniform()));
+  return schedule(link, LINK_STEP_OPENED, adv + setup, adv + OPEN_FAIL_INTERVALS * CONN_INTERVAL_MS);
+}
+
+static bool simDiscover(uint8_t link, void*) {
+  uint32_t t = roundTrips(DISCOVERY_ROUND_TRIPS);
+  return schedule(link, LINK_STEP_DISCOVERED, t, t);
+}
+
+static bool simSubscribe(uint8_t link, void*) {
+  uint32_t t = roundTrips(SUBSCRIBE_ROUND_TRIPS);
+  return schedule(link, LINK_STEP_SUBSCRIBED, t, t);
+}
+
+static void simClose(uint8_t link, const LinkAddr*, void*) {
+  sim.gen[link]++;
+}
+
+static const LinkOps SIM_OPS = { simOpen, simDiscover, simSubscribe, simClose, nullptr };
+
+// ============================================================================
+// Trials
+// ============================================================================
+
+/**
+ * @brief Result of one configuration.
+ */
+struct Result {
+  double meanReadyMs;   /**< Mean request-to-ready time per tag. */
+  double p95ReadyMs;    /**< 95th percentile of it. */
+  double meanAllMs;     /**< Mean time until every tag is ready. */
+  double failures;      /**< Failed steps per trial. */
+  int    unfinished;    /**< Trials where a tag never became ready. */
+  int    maxConnecting; /**< Most simultaneous initiations (must be 1). */
+};
+
+/**
+ * @brief Count links in the connecting state.
+ */
+static int countConnecting(int tags) {
+  int n = 0;
+  for (int i = 0; i < tags; i++) {
+    Link l;
+    if (connManagerGet((uint8_t)i, &l) && l.state == LINK_CONNECTING) n++;
+  }
+  return n;
+}
+
+static Result runTrials(int tags, bool pipelined, int trials, double failProb, uint32_t seed) {
+  std::vector<double> ready;
+  double sumAll = 0.0, sumFail = 0.0;
+  Result r = {};
+  sim.rng.seed(seed);
+  sim.failProb = failProb;
+  sim.maxConnecting = 0;
+
+  for (int t = 0; t < trials; t++) {
+    sim.events = {};
+    sim.nowMs = 0;
+    for (uint32_t& g : sim.gen) g = 0;
+    connManagerInit(&SIM_OPS, nullptr, (uint8_t)tags, pipelined ? (uint8_t)tags : 1);
+
+    uint32_t nextTick = TICK_MS, nextScan = 0;
+    while (connManagerReadyCount() < tags && sim.nowMs < SIM_LIMIT_MS) {
+      if (sim.nowMs >= nextScan) {
+        for (int i = 0; i < tags; i++) {
+          LinkAddr addr = { { 0xc0, 0, 0, 0, 0, (uint8_t)i }, 1 };
+          connManagerRequest((int16_t)i, &addr, sim.nowMs);
+        }
+        nextScan += SCAN_MS;
+      }
+      bool stackFirst = !sim.events.empty() && sim.events.top().timeMs <= nextTick;
+      if (stackFirst) {
+        SimEvent e = sim.events.top();
+        sim.events.pop();
+        sim.nowMs = e.timeMs;
+        if (e.gen != sim.gen[e.link]) continue;
+        connManagerOnStep(e.link, e.step, e.ok, sim.nowMs);
+      } else {
+        sim.nowMs = nextTick;
+        nextTick += TICK_MS;
+        connManagerTick(sim.nowMs);
+      }
+      sim.maxConnecting = std::max(sim.maxConnecting, countConnecting(tags));
+    }
+
+    if (connManagerReadyCount() < tags) r.unfinished++;
+    else sumAll += sim.nowMs;
+    for (int i = 0; i < tags; i++) {
+      Link l;
+      connManagerGet((uint8_t)i, &l);
+      if (l.state == LINK_READY) ready.push_back(l.readyMs);
+    }
+    ConnStats s;
+    connManagerStats(&s);
+    sumFail += s.failures;
+  }
+
+  std::sort(ready.begin(), ready.end());
+  double sum = 0.0;
+  for (double v : ready) sum += v;
+  r.meanReadyMs = ready.empty() ? 0.0 : sum / ready.size();
+  r.p95ReadyMs = ready.empty() ? 0.0 : ready[(size_t)(0.95 * (ready.size() - 1))];
+  int finished = trials - r.unfinished;
+  r.meanAllMs = finished ? sumAll / finished : 0.0;
+  r.failures = sumFail / trials;
+  r.maxConnecting = sim.maxConnecting;
+  return r;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  int trials = argc > 1 ? atoi(argv[1]) : 2000;
+  double failPct = argc > 2 ? atof(argv[2]) : 5.0;
+  if (trials <= 0) {
+    fprintf(stderr, "usage: linkSim [trials] [failPct]\n");
+    return 1;
+  }
+
+  printf("%d trials, %.1f%% step failures, adv %d ms, conn interval %d ms\n\n",
+         trials, failPct, ADV_INTERVAL_MS, CONN_INTERVAL_MS);
+  printf("tags  pipeline     ready mean   ready p95   all ready   fail/trial  initiators\n");
+
+  static const int TAG_COUNTS[] = { 1, 2, 3, 4, 6, 8 };
+  bool ok = true;
+  for (int tags : TAG_COUNTS) {
+    if (tags > CONN_MAX_LINKS) break;
+    for (int p = 0; p < 2; p++) {
+      Result r = runTrials(tags, p == 1, trials, failPct / 100.0, 1234u + tags);
+      printf("%4d  %-10s %9.0f ms %8.0f ms %8.0f ms %11.2f %11d",
+             tags, p ? "pipelined" : "sequential", r.meanReadyMs, r.p95ReadyMs, r.meanAllMs,
+             r.failures, r.maxConnecting);
+      if (r.unfinished) printf("  (%d unfinished)", r.unfinished);
+      printf("\n");
+      if (r.maxConnecting > 1) ok = false;
+    }
+  }
+  if (!ok) {
+    printf("\nFAIL: more than one connection initiated at a time\n");
+    return 1;
+  }
+  return 0;
+}
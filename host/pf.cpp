@@ -0,0 +1,367 @@
+/**
+ * @file pf.cpp
+ * @brief Particle filter kernels and the worker pool.
+ *
+ * The path-loss prediction needs log10(d^2) per particle and anchor; it
+ * comes from a polynomial log2 on the float's mantissa (error below 1e-4,
+ * i.e. under 0.002 dB), the same in the scalar and the AVX2 kernel so both
+ * give the same weights.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pf.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief Lanes of the vector kernel; arrays are padded to a multiple. */
+#define PF_LANES 8
+
+/** @brief Student-t degrees of freedom of the RSSI error. */
+#define PF_DOF 3.0f
+
+/** @brief log10(2), turning log2 into log10. */
+#define PF_LOG10_2 0.30102999566f
+
+/**
+ * @brief Aligned float array with room for the padding lanes.
+ */
+static float* allocFloats(uint32_t count) {
+  size_t bytes = ((count + PF_LANES - 1) / PF_LANES) * PF_LANES * sizeof(float);
+  float* p = (float*)aligned_alloc(32, bytes);
+  if (p) memset(p, 0, bytes);
+  return p;
+}
+
+/**
+ * @brief xoshiro128+ step.
+ */
+static inline uint32_t nextRandom(uint32_t* s) {
+  uint32_t result = s[0] + s[3];
+  uint32_t t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 11) | (s[3] >> 21);
+  return result;
+}
+
+/**
+ * @brief Uniform in [0, 1).
+ */
+static inline float uniform(uint32_t* s) {
+  return (nextRandom(s) >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Approximately standard normal (sum of four uniforms).
+ */
+static inline float gaussian(uint32_t* s) {
+  return (uniform(s) + uniform(s) + uniform(s) + uniform(s) - 2.0f) * 1.7320508f;
+}
+
+/**
+ * @brief Fast log2 of a positive float.
+ */
+static inline float log2Fast(float v) {
+  uint32_t i;
+  memcpy(&i, &v, sizeof(i));
+  float e = (float)((int32_t)(i >> 23) - 127);
+  i = (i & 0x007FFFFF) | 0x3F800000;
+  float m;
+  memcpy(&m, &i, sizeof(m));
+  float p = -0.056570851f;
+  p = p * m + 0.44717955f;
+  p = p * m - 1.4699568f;
+  p = p * m + 2.8212026f;
+  p = p * m - 1.7417939f;
+  return e + p;
+}
+
+/**
+ * @brief Keep a coordinate inside [lo, hi] by reflecting at the edges.
+ */
+static inline float reflect(float v, float lo, float hi) {
+  if (v < lo) v = lo + (lo - v);
+  if (v > hi) v = hi - (v - hi);
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// ============================================================================
+// Filter
+// ============================================================================
+
+bool pfInit(PfFilter* f, uint32_t count, const PfConfig* cfg, uint32_t seed) {
+  memset(f, 0, sizeof(*f));
+  if (count == 0) return false;
+  f->count = count;
+  f->x = allocFloats(count);
+  f->y = allocFloats(count);
+  f->w = allocFloats(count);
+  f->nx = allocFloats(count);
+  f->ny = allocFloats(count);
+  if (!f->x || !f->y || !f->w || !f->nx || !f->ny) {
+    pfFree(f);
+    return false;
+  }
+  // splitmix32 seeding so nearby seeds give unrelated streams
+  for (int k = 0; k < 4; k++) {
+    seed += 0x9E3779B9u;
+    uint32_t z = seed;
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    f->rng[k] = z ^ (z >> 16);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    f->x[i] = cfg->minX + uniform(f->rng) * (cfg->maxX - cfg->minX);
+    f->y[i] = cfg->minY + uniform(f->rng) * (cfg->maxY - cfg->minY);
+    f->w[i] = 1.0f / count;
+  }
+  f->estX = (cfg->minX + cfg->maxX) * 0.5f;
+  f->estY = (cfg->minY + cfg->maxY) * 0.5f;
+  f->ess = (float)count;
+  return true;
+}
+
+void pfFree(PfFilter* f) {
+  free(f->x);
+  free(f->y);
+  free(f->w);
+  free(f->nx);
+  free(f->ny);
+  f->x = f->y = f->w = f->nx = f->ny = nullptr;
+  f->count = 0;
+}
+
+void pfPredict(PfFilter* f, const PfConfig* cfg, float dtSec, bool moving) {
+  float sigma = moving ? cfg->moveSpeed * dtSec : cfg->stillJitter;
+  for (uint32_t i = 0; i < f->count; i++) {
+    f->x[i] = reflect(f->x[i] + sigma * gaussian(f->rng), cfg->minX, cfg->maxX);
+    f->y[i] = reflect(f->y[i] + sigma * gaussian(f->rng), cfg->minY, cfg->maxY);
+  }
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+/**
+ * @brief Fast log2 of eight positive floats.
+ */
+static inline __m256 log2Fast8(__m256 v) {
+  __m256i i = _mm256_castps_si256(v);
+  __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(i, 23), _mm256_set1_epi32(127)));
+  __m256 m = _mm256_castsi256_ps(
+    _mm256_or_si256(_mm256_and_si256(i, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+  __m256 p = _mm256_set1_ps(-0.056570851f);
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(0.44717955f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.4699568f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(2.8212026f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.7417939f));
+  return _mm256_add_ps(e, p);
+}
+
+/**
+ * @brief Multiply the weights by every observation's likelihood, eight
+ *        particles at a time (the arrays are padded to whole lanes).
+ */
+static void weigh(PfFilter* f, const PfConfig* cfg, const PfAnchor* anchors,
+                  const PfObservation* obs, size_t count) {
+  const __m256 h2 = _mm256_set1_ps(cfg->height * cfg->height);
+  const __m256 slope = _mm256_set1_ps(5.0f * cfg->nFactor * PF_LOG10_2);
+  const __m256 k = _mm256_set1_ps(1.0f / (PF_DOF * cfg->sigmaDb * cfg->sigmaDb));
+  const __m256 one = _mm256_set1_ps(1.0f);
+  for (uint32_t i = 0; i < f->count; i += PF_LANES) {
+    __m256 px = _mm256_load_ps(f->x + i);
+    __m256 py = _mm256_load_ps(f->y + i);
+    __m256 w = _mm256_load_ps(f->w + i);
+    for (size_t a = 0; a < count; a++) {
+      const PfAnchor& an = anchors[obs[a].anchor];
+      __m256 dx = _mm256_sub_ps(px, _mm256_set1_ps(an.x));
+      __m256 dy = _mm256_sub_ps(py, _mm256_set1_ps(an.y));
+      __m256 d2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, h2));
+      // expected = tx - 5 n log10(d^2); error = rssi - expected
+      __m256 err = _mm256_add_ps(_mm256_set1_ps(obs[a].rssi - cfg->txPower), _mm256_mul_ps(slope, log2Fast8(d2)));
+      __m256 q = _mm256_div_ps(one, _mm256_fmadd_ps(_mm256_mul_ps(err, err), k, one));
+      w = _mm256_mul_ps(w, _mm256_mul_ps(q, q));
+    }
+    _mm256_store_ps(f->w + i, w);
+  }
+}
+
+const char* pfKernelName(void) { return "avx2"; }
+
+#else
+
+/**
+ * @brief Multiply the weights by every observation's likelihood.
+ */
+static void weigh(PfFilter* f, const PfConfig* cfg, const PfAnchor* anchors,
+                  const PfObservation* obs, size_t count) {
+  const float h2 = cfg->height * cfg->height;
+  const float slope = 5.0f * cfg->nFactor * PF_LOG10_2;
+  const float k = 1.0f / (PF_DOF * cfg->sigmaDb * cfg->sigmaDb);
+  for (uint32_t i = 0; i < f->count; i++) {
+    float w = f->w[i];
+    for (size_t a = 0; a < count; a++) {
+      const PfAnchor& an = anchors[obs[a].anchor];
+      float dx = f->x[i] - an.x, dy = f->y[i] - an.y;
+      float err = obs[a].rssi - cfg->txPower + slope * log2Fast(dx * dx + dy * dy + h2);
+      float q = 1.0f / (1.0f + err * err * k);
+      w *= q * q;
+    }
+    f->w[i] = w;
+  }
+}
+
+const char* pfKernelName(void) { return "scalar"; }
+
+#endif
+
+/**
+ * @brief Systematic resampling into the scratch arrays, then swap.
+ */
+static void resample(PfFilter* f) {
+  uint32_t n = f->count;
+  float step = 1.0f / n;
+  float u = uniform(f->rng) * step;
+  float cum = f->w[0];
+  uint32_t j = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    while (u > cum && j < n - 1) cum += f->w[++j];
+    f->nx[i] = f->x[j];
+    f->ny[i] = f->y[j];
+    u += step;
+  }
+  float* t = f->x; f->x = f->nx; f->nx = t;
+  t = f->y; f->y = f->ny; f->ny = t;
+  for (uint32_t i = 0; i < n; i++) f->w[i] = step;
+  f->resamples++;
+}
+
+void pfUpdate(PfFilter* f, const PfConfig* cfg, const PfAnchor* anchors,
+              const PfObservation* obs, size_t count) {
+  if (count == 0) return;
+  weigh(f, cfg, anchors, obs, count);
+
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < f->count; i++) sum += f->w[i];
+  if (!(sum > 1e-30f)) {
+    // Every particle ruled out (e.g. all underflowed): start over uniformly
+    for (uint32_t i = 0; i < f->count; i++) f->w[i] = 1.0f / f->count;
+    sum = 1.0f;
+  }
+  float inv = 1.0f / sum, sumSq = 0.0f, ex = 0.0f, ey = 0.0f;
+  for (uint32_t i = 0; i < f->count; i++) {
+    float w = f->w[i] * inv;
+    f->w[i] = w;
+    sumSq += w * w;
+    ex += w * f->x[i];
+    ey += w * f->y[i];
+  }
+  f->estX = ex;
+  f->estY = ey;
+  f->ess = 1.0f / sumSq;
+  if (f->ess < 0.5f * f->count) resample(f);
+}
+
+// ============================================================================
+// Pool
+// ============================================================================
+
+/**
+ * @brief Worker threads taking jobs from a shared index.
+ */
+struct PfPool {
+  std::vector<std::thread> workers;    /**< Helper threads. */
+  std::mutex               lock;       /**< Guards the round fields. */
+  std::condition_variable  wake;       /**< New round or stop. */
+  std::condition_variable  done;       /**< A worker finished its round. */
+  uint64_t                 round;      /**< Round counter. */
+  unsigned                 finished;   /**< Workers done with the round. */
+  bool                     stop;       /**< Shut down. */
+  PfJob*                   jobs;       /**< Jobs of the round. */
+  size_t                   count;      /**< Number of jobs. */
+  const PfConfig*          cfg;        /**< Model. */
+  const PfAnchor*          anchors;    /**< Layout. */
+  std::atomic<size_t>      next;       /**< Next job to take. */
+};
+
+/**
+ * @brief Take and run jobs until none are left.
+ */
+static void drain(PfPool* p) {
+  for (;;) {
+    size_t j = p->next.fetch_add(1, std::memory_order_relaxed);
+    if (j >= p->count) return;
+    PfJob& job = p->jobs[j];
+    pfPredict(job.filter, p->cfg, job.dtSec, job.moving);
+    pfUpdate(job.filter, p->cfg, p->anchors, job.obs, job.count);
+  }
+}
+
+static void workerMain(PfPool* p) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> g(p->lock);
+      p->wake.wait(g, [&] { return p->stop || p->round != seen; });
+      if (p->stop) return;
+      seen = p->round;
+    }
+    drain(p);
+    std::lock_guard<std::mutex> g(p->lock);
+    p->finished++;
+    p->done.notify_one();
+  }
+}
+
+PfPool* pfPoolCreate(unsigned threads) {
+  PfPool* p = new PfPool();
+  p->round = 0;
+  p->finished = 0;
+  p->stop = false;
+  p->count = 0;
+  p->next = 0;
+  for (unsigned i = 1; i < threads; i++) p->workers.emplace_back(workerMain, p);
+  return p;
+}
+
+void pfPoolRun(PfPool* p, PfJob* jobs, size_t count, const PfConfig* cfg, const PfAnchor* anchors) {
+  {
+    std::lock_guard<std::mutex> g(p->lock);
+    p->jobs = jobs;
+    p->count = count;
+    p->cfg = cfg;
+    p->anchors = anchors;
+    p->next.store(0, std::memory_order_relaxed);
+    p->finished = 0;
+    p->round++;
+  }
+  p->wake.notify_all();
+  drain(p);
+  std::unique_lock<std::mutex> g(p->lock);
+  p->done.wait(g, [&] { return p->finished == p->workers.size(); });
+}
+
+void pfPoolDestroy(PfPool* p) {
+  {
+    std::lock_guard<std::mutex> g(p->lock);
+    p->stop = true;
+  }
+  p->wake.notify_all();
+  for (std::thread& t : p->workers) t.join();
+  delete p;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file pf.h
+ * @brief Particle filter over tag position from the RSSI several fixed
+ *        trackers (anchors) measure, gated by the tag's movement flag.
+ *
+ * Each filter holds its particles as separate, 32-byte aligned arrays of x,
+ * y and weight (structure of arrays), so the measurement update runs eight
+ * particles at a time with AVX2 when the compiler targets it (`-mavx2 -mfma`),
+ * and one at a time otherwise.
+ *
+ * - predict: a random walk of `moveSpeed` m/s while the tag reports
+ *            movement, only `stillJitter` m per step while it is still;
+ * - update:  for every anchor, a Student-t likelihood (3 degrees of
+ *            freedom) of the measured RSSI around the log-distance path-loss
+ *            prediction; its heavy tail keeps a multipath fade at one anchor
+ *            from wiping out the particles near the true position;
+ * - resample: systematic resampling when the effective sample size drops
+ *            below half the particles.
+ *
+ * Filters are independent, so a pool of worker threads steps many tags at
+ * once, each tag on one thread.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Model parameters shared by the filters of one deployment.
+ */
+struct PfConfig {
+  float txPower;      /**< RSSI at 1 m (dBm). */
+  float nFactor;      /**< Path-loss exponent. */
+  float sigmaDb;      /**< Scale of the RSSI error (dB). */
+  float height;       /**< Height difference between anchors and tags (m). */
+  float moveSpeed;    /**< Random walk speed while moving (m/s). */
+  float stillJitter;  /**< Random walk step while still (m). */
+  float minX, minY;   /**< Area the tags stay in (m). */
+  float maxX, maxY;   /**< Area the tags stay in (m). */
+};
+
+/**
+ * @brief Anchor position (m).
+ */
+struct PfAnchor {
+  float x;   /**< East. */
+  float y;   /**< North. */
+};
+
+/**
+ * @brief One anchor's RSSI of the tag.
+ */
+struct PfObservation {
+  uint8_t anchor;   /**< Anchor index. */
+  float   rssi;     /**< Measured RSSI (dBm). */
+};
+
+/**
+ * @brief One tag's filter.
+ */
+struct PfFilter {
+  uint32_t count;       /**< Particles. */
+  float*   x;           /**< Positions east (aligned). */
+  float*   y;           /**< Positions north (aligned). */
+  float*   w;           /**< Weights, summing to 1 (aligned). */
+  float*   nx;          /**< Resampling scratch (aligned). */
+  float*   ny;          /**< Resampling scratch (aligned). */
+  uint32_t rng[4];      /**< xoshiro128+ state. */
+  float    estX;        /**< Weighted mean east. */
+  float    estY;        /**< Weighted mean north. */
+  float    ess;         /**< Effective sample size after the last update. */
+  uint32_t resamples;   /**< Resampling steps so far. */
+};
+
+/**
+ * @brief Allocate a filter with particles spread uniformly over the area.
+ *
+ * @return False if memory is exhausted or `count` is 0.
+ */
+bool pfInit(PfFilter* f, uint32_t count, const PfConfig* cfg, uint32_t seed);
+
+/**
+ * @brief Release a filter.
+ */
+void pfFree(PfFilter* f);
+
+/**
+ * @brief Move the particles by the motion model.
+ *
+ * @param[in] dtSec  Time since the last step (s).
+ * @param[in] moving Movement flag the tag reported last.
+ */
+void pfPredict(PfFilter* f, const PfConfig* cfg, float dtSec, bool moving);
+
+/**
+ * @brief Weight the particles by a set of anchor observations, update the
+ *        estimate and resample if needed.
+ */
+void pfUpdate(PfFilter* f, const PfConfig* cfg, const PfAnchor* anchors,
+              const PfObservation* obs, size_t count);
+
+/**
+ * @brief Name of the measurement kernel compiled in ("avx2" or "scalar").
+ */
+const char* pfKernelName(void);
+
+/**
+ * @brief One tag's step for the pool.
+ */
+struct PfJob {
+  PfFilter*            filter;   /**< Filter to step. */
+  float                dtSec;    /**< Time since its last step (s). */
+  bool                 moving;   /**< Movement flag. */
+  const PfObservation* obs;      /**< Observations. */
+  size_t               count;    /**< Number of observations. */
+};
+
+struct PfPool;
+
+/**
+ * @brief Start a pool; the calling thread works too, so `threads` - 1
+ *        workers are created.
+ */
+PfPool* pfPoolCreate(unsigned threads);
+
+/**
+ * @brief Predict and update every job's filter; returns when all are done.
+ */
+void pfPoolRun(PfPool* pool, PfJob* jobs, size_t count, const PfConfig* cfg, const PfAnchor* anchors);
+
+/**
+ * @brief Stop and free a pool.
+ */
+void pfPoolDestroy(PfPool* pool);
@@ -0,0 +1,288 @@
+/**
+ * @file pfTool.cpp
+ * @brief Accuracy and throughput benchmark of the particle filter (pf.h).
+ *
+ * Build (Linux/macOS), with the AVX2 kernel:
+ *
+ *     g++ -std=c++17 -O2 -mavx2 -mfma -pthread pfTool.cpp pf.cpp trilat.cpp -o pfTool
+ *
+ * or without `-mavx2 -mfma` for the scalar kernel.
+ *
+ * Usage:
+ *
+ *     pfTool bench [steps] [threads]
+ *
+ * `bench` walks simulated tags through a hall with six anchors. Tags
+ * alternate walking and standing still and report their movement flag; each
+ * anchor measures RSSI with log-normal shadowing and occasional multipath
+ * fades. It reports the position error of the particle filter against
+ * variance-weighted trilateration (trilat.h) on the same measurements, and
+ * of the filter with and without the movement flag (overall and while the
+ * tag stands still), then filter steps per second as the particle count
+ * grows (one tag) and as the tag count grows (1024 particles each) on one
+ * thread and on `threads` (default: all hardware threads).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "pf.h"
+#include "trilat.h"
+
+// ============================================================================
+// Scenario
+// ============================================================================
+
+/** @brief Filter step (s): one round of anchor reports. */
+#define BENCH_DT 0.2f
+
+/** @brief Walking speed (m/s). */
+#define BENCH_SPEED 1.2
+
+/** @brief RSSI shadowing (dB). */
+#define BENCH_SHADOW_DB 4.0
+
+/** @brief Share of reports hit by a multipath fade. */
+#define BENCH_FADE_RATE 0.1
+
+/** @brief Depth of a fade (dB). */
+#define BENCH_FADE_DB 15.0
+
+static const PfAnchor ANCHORS[] = { { 0, 0 }, { 10, 0 }, { 20, 0 }, { 0, 12 }, { 10, 12 }, { 20, 12 } };
+static const size_t ANCHOR_COUNT = sizeof(ANCHORS) / sizeof(ANCHORS[0]);
+
+/**
+ * @brief Tracker defaults and the hall.
+ */
+static PfConfig benchConfig() {
+  PfConfig c;
+  c.txPower = -59.0f;
+  c.nFactor = 2.5f;
+  c.sigmaDb = (float)BENCH_SHADOW_DB;
+  c.height = 1.0f;
+  c.moveSpeed = 1.5f;
+  c.stillJitter = 0.02f;
+  c.minX = 0.0f;
+  c.minY = 0.0f;
+  c.maxX = 20.0f;
+  c.maxY = 12.0f;
+  return c;
+}
+
+/**
+ * @brief One round: true position, movement flag and every anchor's RSSI.
+ */
+struct BenchStep {
+  double        x, y;                   /**< True position. */
+  bool          moving;                 /**< Movement flag reported. */
+  PfObservation obs[ANCHOR_COUNT];      /**< RSSI per anchor. */
+};
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Walk one tag: 10 to 30 s walking, then 5 to 20 s still.
+ */
+static std::vector<BenchStep> simulate(const PfConfig& c, size_t steps, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+  std::vector<BenchStep> out(steps);
+  double x = c.maxX * uni(rng), y = c.maxY * uni(rng), heading = 2 * M_PI * uni(rng);
+  bool moving = true;
+  int left = (int)((10 + 20 * uni(rng)) / BENCH_DT);
+  for (size_t k = 0; k < steps; k++) {
+    if (--left <= 0) {
+      moving = !moving;
+      left = (int)((moving ? 10 + 20 * uni(rng) : 5 + 15 * uni(rng)) / BENCH_DT);
+    }
+    if (moving) {
+      heading += 0.3 * gauss(rng);
+      x += BENCH_SPEED * BENCH_DT * cos(heading);
+      y += BENCH_SPEED * BENCH_DT * sin(heading);
+      if (x < c.minX || x > c.maxX) { heading = M_PI - heading; x = std::min(std::max(x, (double)c.minX), (double)c.maxX); }
+      if (y < c.minY || y > c.maxY) { heading = -heading; y = std::min(std::max(y, (double)c.minY), (double)c.maxY); }
+    }
+    BenchStep& s = out[k];
+    s.x = x;
+    s.y = y;
+    s.moving = moving;
+    for (size_t a = 0; a < ANCHOR_COUNT; a++) {
+      double dx = x - ANCHORS[a].x, dy = y - ANCHORS[a].y;
+      double d = sqrt(dx * dx + dy * dy + c.height * c.height);
+      double rssi = c.txPower - 10.0 * c.nFactor * log10(d) + BENCH_SHADOW_DB * gauss(rng);
+      if (uni(rng) < BENCH_FADE_RATE) rssi -= BENCH_FADE_DB;
+      s.obs[a] = { (uint8_t)a, (float)rssi };
+    }
+  }
+  return out;
+}
+
+// ============================================================================
+// Accuracy
+// ============================================================================
+
+/**
+ * @brief Error statistics of one estimator.
+ */
+struct Errors {
+  std::vector<double> e;   /**< Position errors (m). */
+
+  void add(double ex, double ey) { e.push_back(hypot(ex, ey)); }
+
+  void print(const char* name) {
+    std::sort(e.begin(), e.end());
+    double sumSq = 0.0;
+    for (double v : e) sumSq += v * v;
+    printf("%-22s %8.2f %8.2f %8.2f\n", name, sqrt(sumSq / e.size()), e[e.size() / 2],
+           e[(size_t)(0.9 * (e.size() - 1))]);
+  }
+};
+
+/**
+ * @brief Trilateration range from RSSI, as the tracker computes it.
+ */
+static TrilatRange toRange(const PfConfig& c, const PfObservation& o) {
+  double d = pow(10.0, (c.txPower - o.rssi) / (10.0 * c.nFactor));
+  double h = sqrt(std::max(d * d - c.height * c.height, 0.01));
+  double sd = d * log(10.0) / (10.0 * c.nFactor) * c.sigmaDb;
+  return { o.anchor, h, sd * sd };
+}
+
+static void accuracy(const PfConfig& c, size_t steps) {
+  const size_t WARMUP = 25;  // 5 s for the filter to converge from uniform
+  Errors trilat, pfSmall, pfLarge, pfNoFlag, stillFlag, stillNoFlag;
+  for (uint32_t tag = 0; tag < 8; tag++) {
+    std::vector<BenchStep> walk = simulate(c, steps / 8 + WARMUP, 100 + tag);
+    PfFilter a, b, n;
+    pfInit(&a, 512, &c, tag * 3 + 1);
+    pfInit(&b, 4096, &c, tag * 3 + 2);
+    pfInit(&n, 4096, &c, tag * 3 + 3);
+    TrilatAnchor anchors[ANCHOR_COUNT];
+    for (size_t i = 0; i < ANCHOR_COUNT; i++) anchors[i] = { ANCHORS[i].x, ANCHORS[i].y };
+    TrilatFix prev = {};
+    bool havePrev = false;
+    for (size_t k = 0; k < walk.size(); k++) {
+      const BenchStep& s = walk[k];
+      pfPredict(&a, &c, BENCH_DT, s.moving);
+      pfUpdate(&a, &c, ANCHORS, s.obs, ANCHOR_COUNT);
+      pfPredict(&b, &c, BENCH_DT, s.moving);
+      pfUpdate(&b, &c, ANCHORS, s.obs, ANCHOR_COUNT);
+      pfPredict(&n, &c, BENCH_DT, true);
+      pfUpdate(&n, &c, ANCHORS, s.obs, ANCHOR_COUNT);
+
+      TrilatRange ranges[ANCHOR_COUNT];
+      for (size_t i = 0; i < ANCHOR_COUNT; i++) ranges[i] = toRange(c, s.obs[i]);
+      double start[2] = { prev.x, prev.y };
+      TrilatFix fix;
+      bool ok = trilatSolve(anchors, ranges, ANCHOR_COUNT, havePrev ? start : nullptr, &fix);
+      if (ok) {
+        prev = fix;
+        havePrev = true;
+      }
+      if (k < WARMUP) continue;
+      if (ok) trilat.add(fix.x - s.x, fix.y - s.y);
+      pfSmall.add(a.estX - s.x, a.estY - s.y);
+      pfLarge.add(b.estX - s.x, b.estY - s.y);
+      pfNoFlag.add(n.estX - s.x, n.estY - s.y);
+      if (!s.moving) {
+        stillFlag.add(b.estX - s.x, b.estY - s.y);
+        stillNoFlag.add(n.estX - s.x, n.estY - s.y);
+      }
+    }
+    pfFree(&a);
+    pfFree(&b);
+    pfFree(&n);
+  }
+  printf("estimator                rmse m    p50 m    p90 m\n");
+  trilat.print("trilateration");
+  pfSmall.print("pf 512");
+  pfLarge.print("pf 4096");
+  pfNoFlag.print("pf 4096, no motion");
+  stillFlag.print("  still: pf 4096");
+  stillNoFlag.print("  still: no motion");
+  printf("\n");
+}
+
+// ============================================================================
+// Throughput
+// ============================================================================
+
+/**
+ * @brief Filter steps per second for `tags` tags of `particles` each.
+ */
+static double stepsPerSec(const PfConfig& c, uint32_t particles, size_t tags, unsigned threads,
+                          const std::vector<BenchStep>& walk) {
+  std::vector<PfFilter> filters(tags);
+  for (size_t t = 0; t < tags; t++) pfInit(&filters[t], particles, &c, (uint32_t)t + 1);
+  std::vector<PfJob> jobs(tags);
+  PfPool* pool = pfPoolCreate(threads);
+  // Enough rounds for about 0.3 s of work on one thread at ~1 ns per particle and anchor
+  size_t rounds = std::max<size_t>(20, (size_t)(5e7 / ((double)particles * tags * ANCHOR_COUNT)));
+  rounds = std::min(rounds, walk.size());
+  double t0 = nowSec();
+  for (size_t r = 0; r < rounds; r++) {
+    for (size_t t = 0; t < tags; t++) {
+      const BenchStep& s = walk[(r + t * 7) % walk.size()];
+      jobs[t] = { &filters[t], BENCH_DT, s.moving, s.obs, ANCHOR_COUNT };
+    }
+    pfPoolRun(pool, jobs.data(), tags, &c, ANCHORS);
+  }
+  double elapsed = nowSec() - t0;
+  pfPoolDestroy(pool);
+  for (PfFilter& f : filters) pfFree(&f);
+  return rounds * tags / elapsed;
+}
+
+static void throughput(const PfConfig& c, unsigned threads) {
+  std::vector<BenchStep> walk = simulate(c, 4000, 1);
+  printf("one tag, %zu anchors: particles  steps/s  particle-anchor/ns\n", ANCHOR_COUNT);
+  for (uint32_t p : { 256u, 1024u, 4096u, 16384u, 65536u }) {
+    double s = stepsPerSec(c, p, 1, 1, walk);
+    printf("%38u %8.0f %19.2f\n", p, s, s * p * ANCHOR_COUNT * 1e-9);
+  }
+  printf("\n1024 particles:  tags  steps/s 1 thread  steps/s %u threads\n", threads);
+  for (size_t tags : { 1, 16, 64, 256 }) {
+    double one = stepsPerSec(c, 1024, tags, 1, walk);
+    double many = stepsPerSec(c, 1024, tags, threads, walk);
+    printf("%22zu %17.0f %18.0f\n", tags, one, many);
+  }
+}
+
+static int bench(size_t steps, unsigned threads) {
+  PfConfig c = benchConfig();
+  printf("kernel %s, hall 20x12 m, %zu anchors, shadowing %.0f dB, %.0f%% fades of %.0f dB\n\n",
+         pfKernelName(), ANCHOR_COUNT, BENCH_SHADOW_DB, BENCH_FADE_RATE * 100, BENCH_FADE_DB);
+  accuracy(c, steps);
+  throughput(c, threads);
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long steps = argc > 2 ? atol(argv[2]) : 16000;
+    unsigned threads = argc > 3 ? (unsigned)atoi(argv[3]) : std::thread::hardware_concurrency();
+    return bench(steps > 0 ? (size_t)steps : 16000, threads > 0 ? threads : 1);
+  }
+  fprintf(stderr, "usage: pfTool bench [steps] [threads]\n");
+  return 1;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file powerModel.cpp
+ * @brief Energy model of the tag's power policy over daily usage scenarios.
+ *
+ * Replays a day of movement in 5 ms steps (one IMU period) through the
+ * tag's own power policy (server/powerManager.cpp) and books what the
+ * firmware does into the tag's own energy ledger (server/energy.cpp): CPU
+ * busy time, IMU mode, light-sleep wake-ups, I2C bytes, notifications and
+ * connection events. Four firmware configurations are compared, each with
+ * its own EnergyProfile:
+ *
+ * - baseline:  240 MHz, no sleep, IMU always sampling (the previous firmware)
+ * - dfs:       40-160 MHz frequency scaling, no light sleep
+ * - dfs+sleep: frequency scaling plus automatic light sleep between samples
+ *              and BLE connection events (ENERGY_PROFILE_DEFAULT)
+ * - full:      dfs+sleep plus the still policy (IMU wake-on-motion)
+ *
+ * Edit ENERGY_PROFILE_DEFAULT and the constants below to match measurements
+ * from a real board; the firmware reports its own estimate with the same
+ * profile over the energy characteristic.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -I../server powerModel.cpp ../server/powerManager.cpp ../server/energy.cpp -o powerModel
+ *
+ * Usage:
+ *
+ *     powerModel [batteryMah] [connIntervalMs]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "powerManager.h"
+#include "energy.h"
+
+// ============================================================================
+// Model Constants
+// ============================================================================
+
+/** @brief IMU sampling period (ms). */
+#define SAMPLE_MS 5
+
+static const double I_RUN_240   = 45.0;   /**< CPU running at 240 MHz (mA). */
+static const double I_IDLE_240  = 32.0;   /**< CPU idle (awake) at 240 MHz (mA). */
+static const double I_RUN_MAX   = 35.0;   /**< CPU running at POWER_MAX_MHZ (mA). */
+static const double I_RADIO     = 60.0;   /**< Extra current while the radio is active (mA). */
+
+static const double SAMPLE_RUN_MS  = 0.6;  /**< Work per IMU sample at POWER_MAX_MHZ (ms). */
+static const double RADIO_MS       = 1.2;  /**< Radio time per connection event (ms). */
+
+/** @brief I2C bytes per sample: accelerometer and gyro burst reads. */
+#define SAMPLE_I2C_BYTES 18
+
+/**
+ * @brief Firmware configurations.
+ */
+enum Config { CFG_BASELINE, CFG_DFS, CFG_SLEEP, CFG_FULL, CFG_COUNT };
+
+/** @brief Configuration names. */
+static const char* CONFIG_NAMES[CFG_COUNT] = { "baseline", "dfs", "dfs+sleep", "full" };
+
+/**
+ * @brief Energy profile of a configuration.
+ *
+ * Without light sleep the CPU idles awake, so the floor is the awake idle
+ * current, a connection event costs only its radio time and there is no
+ * wake-up overhead.
+ */
+static EnergyProfile profileFor(Config cfg, double batteryMah) {
+  EnergyProfile p = ENERGY_PROFILE_DEFAULT;
+  p.batteryMah = (float)batteryMah;
+  if (cfg == CFG_BASELINE || cfg == CFG_DFS) {
+    p.floorMa = cfg == CFG_BASELINE ? (float)I_IDLE_240 : ENERGY_AWAKE_FLOOR_MA;
+    p.activeMa[ENERGY_CPU] = (float)((cfg == CFG_BASELINE ? I_RUN_240 : I_RUN_MAX) - p.floorMa);
+    p.eventUc[ENERGY_CONN] = (float)(RADIO_MS * I_RADIO);
+    p.eventUc[ENERGY_WAKEUPS] = 0;
+  }
+  return p;
+}
+
+// ============================================================================
+// Scenarios
+// ============================================================================
+
+/**
+ * @brief A stretch of a day with or without movement.
+ */
+struct Segment {
+  uint32_t minutes;  /**< Duration. */
+  bool     moving;   /**< Tag is being carried. */
+};
+
+/**
+ * @brief A named day of segments, repeated to fill 24 hours.
+ */
+struct Scenario {
+  const char*    name;    /**< Scenario name. */
+  const Segment* segs;    /**< Segments. */
+  size_t         count;   /**< Number of segments. */
+};
+
+static const Segment DESK[] = { { 238, false }, { 2, true } };                  /**< Picked up every 4 h. */
+static const Segment COMMUTE[] = { { 45, true }, { 480, false }, { 45, true }, { 870, false } };
+static const Segment CARRIED[] = { { 50, true }, { 10, false } };                /**< On the move all day. */
+
+static const Scenario SCENARIOS[] = {
+  { "desk",    DESK,    sizeof(DESK) / sizeof(DESK[0]) },
+  { "commute", COMMUTE, sizeof(COMMUTE) / sizeof(COMMUTE[0]) },
+  { "carried", CARRIED, sizeof(CARRIED) / sizeof(CARRIED[0]) },
+};
+
+// ============================================================================
+// Simulation
+// ============================================================================
+
+/**
+ * @brief Replay 24 h of a scenario into an energy ledger and estimate.
+ *
+ * @param[out] est        Estimate at the end of the day.
+ * @param[out] stillShare Share of the day with sampling paused.
+ */
+static void simulate(const Scenario& sc, Config cfg, uint32_t connMs, double batteryMah,
+                     EnergyEstimate* est, double* stillShare) {
+  const uint32_t dayMs = 24u * 3600u * 1000u;
+  const bool sleep = cfg == CFG_SLEEP || cfg == CFG_FULL;
+  const uint32_t runUs = (uint32_t)(1000 * (cfg == CFG_BASELINE ? SAMPLE_RUN_MS * POWER_MAX_MHZ / 240.0
+                                                               : SAMPLE_RUN_MS));
+  const EnergyProfile profile = profileFor(cfg, batteryMah);
+
+  PowerPolicy policy;
+  powerPolicyInit(&policy, 0);
+  EnergyLedger ledger;
+  energyInit(&ledger, 0);
+  energySetLink(&ledger, ENERGY_LINK_CONNECTED, connMs * 1000, 0);
+  energySetActive(&ledger, ENERGY_IMU, true, 0);
+
+  uint64_t stillSteps = 0, steps = 0;
+  size_t seg = 0;
+  uint32_t segEnd = sc.segs[0].minutes * 60000u;
+  bool wasMoving = false;
+
+  for (uint32_t t = 0; t < dayMs; t += SAMPLE_MS, steps++) {
+    while (t >= segEnd) {
+      seg = (seg + 1) % sc.count;
+      segEnd += sc.segs[seg].minutes * 60000u;
+    }
+    bool moving = sc.segs[seg].moving;
+    uint64_t nowUs = (uint64_t)t * 1000;
+
+    if (cfg == CFG_FULL && policy.mode == POWER_STILL && moving) {
+      // Wake-on-motion interrupt
+      powerPolicyWake(&policy, t);
+      energySetActive(&ledger, ENERGY_IMU_WOM, false, nowUs);
+      energySetActive(&ledger, ENERGY_IMU, true, nowUs);
+    }
+    if (cfg == CFG_FULL && policy.mode == POWER_STILL) {
+      // Only connection events wake the CPU
+      stillSteps++;
+      continue;
+    }
+
+    // One IMU sample per step; a notification when movement starts or stops
+    if (sleep) energyCount(&ledger, ENERGY_WAKEUPS, 1);
+    energyAddTime(&ledger, ENERGY_CPU, runUs);
+    energyCount(&ledger, ENERGY_I2C_BYTES, SAMPLE_I2C_BYTES);
+    if (moving != wasMoving) energyCount(&ledger, ENERGY_TX, 1);
+    wasMoving = moving;
+
+    if (cfg == CFG_FULL && powerPolicyUpdate(&policy, moving, t) == POWER_STILL) {
+      energySetActive(&ledger, ENERGY_IMU, false, nowUs);
+      energySetActive(&ledger, ENERGY_IMU_WOM, true, nowUs);
+    }
+  }
+
+  energyEstimate(&ledger, &profile, (uint64_t)dayMs * 1000, est);
+  *stillShare = (double)stillSteps / steps;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  double batteryMah = argc > 1 ? atof(argv[1]) : 500.0;
+  uint32_t connMs = argc > 2 ? (uint32_t)atoi(argv[2]) : 30;
+  if (batteryMah <= 0 || connMs == 0) {
+    fprintf(stderr, "usage: %s [batteryMah] [connIntervalMs]\n", argv[0]);
+    return 2;
+  }
+
+  printf("Battery %.0f mAh, connection interval %u ms, still after %u s\n\n", batteryMah,
+         (unsigned)connMs, (unsigned)(POWER_STILL_AFTER_MS / 1000));
+  printf("%-9s %-10s %9s %9s %9s  %s\n", "scenario", "config", "avg mA", "still", "life",
+         "largest parts");
+  for (const Scenario& sc : SCENARIOS) {
+    for (int c = 0; c < CFG_COUNT; c++) {
+      EnergyEstimate est;
+      double still;
+      simulate(sc, (Config)c, connMs, batteryMah, &est, &still);
+      printf("%-9s %-10s %9.2f %8.0f%% %7.1f d ", sc.name, CONFIG_NAMES[c], est.avgMa, still * 100,
+             batteryMah / est.avgMa / 24);
+
+      // Three largest contributors
+      const size_t parts = sizeof(est.partMah) / sizeof(est.partMah[0]);
+      bool shown[parts] = {};
+      for (int k = 0; k < 3; k++) {
+        size_t best = parts;
+        for (size_t p = 0; p < parts; p++) {
+          if (!shown[p] && (best == parts || est.partMah[p] > est.partMah[best])) best = p;
+        }
+        shown[best] = true;
+        printf(" %s %.0f%%", energyPartName(best), est.partMah[best] * 100 / est.usedMah);
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
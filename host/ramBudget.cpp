@@ -0,0 +1,188 @@
+/**
+ * @file ramBudget.cpp
+ * @brief Link-time RAM report per subsystem from a GNU ld map file.
+ *
+ * Sums the bytes every object file and archive member contributes to the
+ * ESP32-S3 RAM output sections (.dram0.data, .dram0.bss, .noinit and
+ * .iram0.*), grouped by source file for sketch objects and by archive for
+ * libraries. Unlike the boot-time report in staticAlloc.h this also covers
+ * module-level statics such as the RPA cache or the history buffers.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 ramBudget.cpp -o ramBudget
+ *
+ * Usage (the Arduino build directory contains `<sketch>.ino.map`):
+ *
+ *     ramBudget <file.map> [limitBytes]
+ *
+ * With a limit, the exit status is 1 if the sketch objects together use
+ * more RAM than `limitBytes`, which lets CI catch budget regressions.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// Map Parsing
+// ============================================================================
+
+/**
+ * @brief RAM use of one subsystem.
+ */
+struct Usage {
+  uint64_t data = 0;   /**< Initialised data (.dram0.data). */
+  uint64_t bss = 0;    /**< Zeroed data (.dram0.bss, .noinit). */
+  uint64_t iram = 0;   /**< Code and data placed in IRAM. */
+  bool     sketch = false; /**< Object belongs to the sketch itself. */
+};
+
+/**
+ * @brief RAM output section kinds.
+ */
+enum Section { SEC_OTHER, SEC_DATA, SEC_BSS, SEC_IRAM };
+
+/**
+ * @brief Classify an output section name.
+ */
+static Section classify(const char* name) {
+  if (strcmp(name, ".dram0.data") == 0) return SEC_DATA;
+  if (strcmp(name, ".dram0.bss") == 0 || strcmp(name, ".noinit") == 0) return SEC_BSS;
+  if (strncmp(name, ".iram0.", 7) == 0) return SEC_IRAM;
+  return SEC_OTHER;
+}
+
+/**
+ * @brief Reduce an object path to a subsystem name.
+ *
+ * `.../sketch/rpaResolver.cpp.o` becomes `rpaResolver`;
+ * `.../libbt.a(bta_gattc_act.c.o)` becomes `libbt.a`.
+ *
+ * @param[in]  path   Object path from the map file.
+ * @param[out] sketch Set if the object was compiled from the sketch folder.
+ */
+static std::string subsystemOf(const std::string& path, bool* sketch) {
+  std::string p = path;
+  size_t paren = p.find('(');
+  if (paren != std::string::npos) p = p.substr(0, paren);
+  *sketch = paren == std::string::npos && p.find("/sketch/") != std::string::npos;
+
+  size_t slash = p.find_last_of("/\\");
+  if (slash != std::string::npos) p = p.substr(slash + 1);
+  if (paren != std::string::npos) return p;
+
+  // Strip compiler suffixes: name.ino.cpp.o, name.cpp.o, name.c.o
+  size_t dot = p.find('.');
+  return dot == std::string::npos ? p : p.substr(0, dot);
+}
+
+/**
+ * @brief Parse a map file into per-subsystem usage.
+ */
+static bool parseMap(const char* path, std::map<std::string, Usage>* out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[4096];
+  Section current = SEC_OTHER;
+  bool inMemoryMap = false;
+  bool pendingInput = false;
+
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "Linker script and memory map", 28) == 0) {
+      inMemoryMap = true;
+      continue;
+    }
+    if (!inMemoryMap) continue;
+
+    // Output section: starts in column 0 with a dot
+    if (line[0] == '.') {
+      char name[256];
+      if (sscanf(line, "%255s", name) == 1) current = classify(name);
+      pendingInput = false;
+      continue;
+    }
+    if (current == SEC_OTHER || line[0] != ' ') continue;
+
+    // Input section: " .bss.name 0xaddr 0xsize object" or the name alone with
+    // address, size and object on the next line
+    char first[1024], object[2048];
+    unsigned long long addr, size;
+    const char* fields = line;
+    if (!pendingInput) {
+      if (sscanf(line, " %1023s", first) != 1) continue;
+      if (first[0] != '.' && strcmp(first, "COMMON") != 0) continue;
+      fields = strstr(line, first) + strlen(first);
+      if (sscanf(fields, " 0x%llx 0x%llx %2047[^\n]", &addr, &size, object) != 3) {
+        pendingInput = true;
+        continue;
+      }
+    } else {
+      pendingInput = false;
+      if (sscanf(fields, " 0x%llx 0x%llx %2047[^\n]", &addr, &size, object) != 3) continue;
+    }
+    if (size == 0) continue;
+
+    bool sketch;
+    Usage& u = (*out)[subsystemOf(object, &sketch)];
+    u.sketch = u.sketch || sketch;
+    if (current == SEC_DATA) u.data += size;
+    else if (current == SEC_BSS) u.bss += size;
+    else u.iram += size;
+  }
+  fclose(f);
+  return true;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.map> [limitBytes]\n", argv[0]);
+    return 2;
+  }
+  std::map<std::string, Usage> usage;
+  if (!parseMap(argv[1], &usage)) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  std::vector<std::pair<std::string, Usage>> rows(usage.begin(), usage.end());
+  std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+    if (a.second.sketch != b.second.sketch) return a.second.sketch;
+    return a.second.data + a.second.bss > b.second.data + b.second.bss;
+  });
+
+  uint64_t sketchTotal = 0, total = 0;
+  printf("%-28s %9s %9s %9s %9s\n", "subsystem", "data", "bss", "dram", "iram");
+  for (const auto& r : rows) {
+    const Usage& u = r.second;
+    uint64_t dram = u.data + u.bss;
+    if (dram + u.iram == 0) continue;
+    printf("%-28s %9llu %9llu %9llu %9llu%s\n", r.first.c_str(), (unsigned long long)u.data,
+           (unsigned long long)u.bss, (unsigned long long)dram, (unsigned long long)u.iram,
+           u.sketch ? "  *" : "");
+    if (u.sketch) sketchTotal += dram;
+    total += dram;
+  }
+  printf("sketch (*) DRAM %llu B, total DRAM %llu B\n", (unsigned long long)sketchTotal,
+         (unsigned long long)total);
+
+  if (argc > 2) {
+    uint64_t limit = strtoull(argv[2], nullptr, 10);
+    if (sketchTotal > limit) {
+      fprintf(stderr, "sketch DRAM %llu B exceeds budget %llu B\n",
+              (unsigned long long)sketchTotal, (unsigned long long)limit);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,631 @@
+/**
+ * @file arduino.cpp
+ * @brief Arduino-ESP32 core of the host rig: String, Print, Serial, time,
+ *        GPIO with interrupts, ADC, LEDC tones and hardware timers.
+ *
+ * Interrupt handlers run on the device's interrupt thread ("isr"), one at a
+ * time, as on one core of the ESP32. Pins driven from outside the chip (the
+ * scenario's buttons, the IMU interrupt line) change level there as well, so
+ * an edge and its handler are never reordered.
+ */
+
+#include <stdarg.h>
+#include <random>
+#include "Arduino.h"
+#include "driver/gpio.h"
+#include "core.h"
+
+// ============================================================================
+// String
+// ============================================================================
+
+static std::string formatLong(long v, unsigned char base) {
+  if (base == 10) return std::to_string(v);
+  return String((unsigned long)v, base).str();
+}
+
+String::String(int v, unsigned char base) : s_(formatLong(v, base)) {}
+String::String(long v, unsigned char base) : s_(formatLong(v, base)) {}
+String::String(unsigned int v, unsigned char base) : String((unsigned long)v, base) {}
+
+String::String(unsigned long v, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[8 * sizeof(v) + 1];
+  char* p = buf + sizeof(buf);
+  *--p = 0;
+  do {
+    unsigned d = v % base;
+    *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+    v /= base;
+  } while (v);
+  s_ = p;
+}
+
+String::String(double v, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  s_ = buf;
+}
+
+String::String(float v, unsigned int decimals) : String((double)v, decimals) {}
+
+bool String::endsWith(const String& p) const {
+  return p.s_.size() <= s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+}
+
+int String::indexOf(char c, size_t from) const {
+  size_t i = s_.find(c, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+int String::indexOf(const String& p, size_t from) const {
+  size_t i = s_.find(p.s_, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+String String::substring(size_t from, size_t to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= s_.size()) return String();
+  return String(s_.substr(from, to - from));
+}
+
+long String::toInt() const {
+  return strtol(s_.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+  return strtof(s_.c_str(), nullptr);
+}
+
+void String::toLowerCase() {
+  for (char& c : s_) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char& c : s_) c = (char)toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t b = s_.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) {
+    s_.clear();
+    return;
+  }
+  size_t e = s_.find_last_not_of(" \t\r\n");
+  s_ = s_.substr(b, e - b + 1);
+}
+
+// ============================================================================
+// Print
+// ============================================================================
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+  size_t n = 0;
+  while (len--) n += write(*buf++);
+  return n;
+}
+
+size_t Print::printf(const char* fmt, ...) {
+  char small[128];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, (size_t)n);
+
+  std::string big((size_t)n + 1, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&big[0], big.size(), fmt, ap);
+  va_end(ap);
+  return write((const uint8_t*)big.data(), (size_t)n);
+}
+
+size_t Print::print(long v, int base) {
+  if (base == 10) return print(String(v, 10));
+  return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+  return print(String(v, (unsigned char)base));
+}
+
+size_t Print::print(double v, int digits) {
+  if (isnan(v)) return print("nan");
+  if (isinf(v)) return print("inf");
+  return print(String(v, (unsigned int)digits));
+}
+
+// ============================================================================
+// Serial
+// ============================================================================
+
+HardwareSerial Serial;
+
+/** @brief Serial::readBytes() gives up after this long without data (Stream's default). */
+#define RIG_SERIAL_TIMEOUT_MS 1000
+
+int HardwareSerial::available(void) {
+  return (int)rigSerialAvailable(gRigDev);
+}
+
+int HardwareSerial::read(void) {
+  uint8_t c;
+  return rigSerialIn(gRigDev, &c, 1) ? c : -1;
+}
+
+size_t HardwareSerial::readBytes(uint8_t* buf, size_t len) {
+  size_t got = 0;
+  uint64_t deadline = rigNow() + (uint64_t)RIG_SERIAL_TIMEOUT_MS * 1000;
+  while (got < len) {
+    size_t n = rigSerialIn(gRigDev, buf + got, len - got);
+    got += n;
+    if (n) {
+      deadline = rigNow() + (uint64_t)RIG_SERIAL_TIMEOUT_MS * 1000;
+    } else if (rigNow() >= deadline) {
+      break;
+    } else {
+      rigSleepUntil(rigNow() + 1000);
+    }
+  }
+  return got;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+  rigSerialOut(gRigDev, buf, len);
+  return len;
+}
+
+// ============================================================================
+// Time
+// ============================================================================
+
+unsigned long millis(void) {
+  return (unsigned long)(rigNow() / 1000);
+}
+
+unsigned long micros(void) {
+  return (unsigned long)rigNow();
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  rigSleepUntil(rigNow() + us);
+}
+
+void yield(void) {
+  sched_yield();
+}
+
+void rigNotef(const char* fmt, ...) {
+  char buf[160];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  rigNote(gRigDev, buf);
+}
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+#define RIG_PINS 49
+
+/** @brief A level interrupt still asserted fires again after this long (us). */
+#define RIG_LEVEL_REFIRE_US 100
+
+struct Pin {
+  uint8_t mode;
+  uint8_t out;        /**< Level driven by the sketch (OUTPUT). */
+  uint8_t ext;        /**< Level driven from outside; 0xFF if floating. */
+  uint8_t intrMode;   /**< RISING .. ONHIGH, 0 if no handler. */
+  bool    intrOn;     /**< gpio_intr_enable() state. */
+  bool    refirePending;
+  void (*fn)(void);
+  void (*fnArg)(void*);
+  void*   arg;
+};
+
+static Pin gPins[RIG_PINS];
+
+/** @brief Guards the pin table against the sketch's tasks. */
+static pthread_mutex_t gPinLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Level seen on a pin (lock held). */
+static uint8_t pinLevel(const Pin& p) {
+  if (p.mode == OUTPUT) return p.out;
+  if (p.ext != 0xFF) return p.ext;
+  if ((p.mode & PULLUP) == PULLUP) return HIGH;
+  return LOW;
+}
+
+static bool levelActive(const Pin& p, uint8_t level) {
+  return (p.intrMode == ONHIGH && level == HIGH) || (p.intrMode == ONLOW && level == LOW);
+}
+
+static void pinCheckLevel(uint8_t pin);
+
+/** @brief Run a pin's handler (interrupt thread, lock not held). */
+static void pinFire(uint8_t pin) {
+  pthread_mutex_lock(&gPinLock);
+  Pin p = gPins[pin];
+  pthread_mutex_unlock(&gPinLock);
+  if (p.fn) p.fn();
+  if (p.fnArg) p.fnArg(p.arg);
+}
+
+/**
+ * @brief Fire a level interrupt while it stays asserted and enabled (interrupt thread).
+ */
+static void pinCheckLevel(uint8_t pin) {
+  pthread_mutex_lock(&gPinLock);
+  Pin& p = gPins[pin];
+  p.refirePending = false;
+  bool fire = p.intrOn && levelActive(p, pinLevel(p));
+  pthread_mutex_unlock(&gPinLock);
+  if (!fire) return;
+  pinFire(pin);
+
+  pthread_mutex_lock(&gPinLock);
+  if (p.intrOn && levelActive(p, pinLevel(p)) && !p.refirePending) {
+    p.refirePending = true;
+    gIsr.postAt(rigNow() + RIG_LEVEL_REFIRE_US, [pin] { pinCheckLevel(pin); });
+  }
+  pthread_mutex_unlock(&gPinLock);
+}
+
+/** @brief Post a level check unless one is pending (lock held). */
+static void pinPostLevelCheck(uint8_t pin) {
+  Pin& p = gPins[pin];
+  if (p.refirePending) return;
+  p.refirePending = true;
+  gIsr.post([pin] { pinCheckLevel(pin); });
+}
+
+void rigPinDrive(uint8_t pin, uint8_t level) {
+  if (pin >= RIG_PINS) return;
+  pthread_mutex_lock(&gPinLock);
+  Pin& p = gPins[pin];
+  uint8_t before = pinLevel(p);
+  p.ext = level ? HIGH : LOW;
+  uint8_t after = pinLevel(p);
+  bool edge = before != after &&
+              ((p.intrMode == CHANGE) || (p.intrMode == RISING && after == HIGH) ||
+               (p.intrMode == FALLING && after == LOW));
+  bool edgeFire = edge && p.intrOn;
+  if (levelActive(p, after) && p.intrOn) pinPostLevelCheck(pin);
+  pthread_mutex_unlock(&gPinLock);
+  if (edgeFire) pinFire(pin);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= RIG_PINS) return;
+  pthread_mutex_lock(&gPinLock);
+  gPins[pin].mode = mode;
+  pthread_mutex_unlock(&gPinLock);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= RIG_PINS) return;
+  pthread_mutex_lock(&gPinLock);
+  gPins[pin].out = level ? HIGH : LOW;
+  pthread_mutex_unlock(&gPinLock);
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= RIG_PINS) return LOW;
+  pthread_mutex_lock(&gPinLock);
+  int level = pinLevel(gPins[pin]);
+  pthread_mutex_unlock(&gPinLock);
+  return level;
+}
+
+static void attach(uint8_t pin, void (*fn)(void), void (*fnArg)(void*), void* arg, int mode) {
+  if (pin >= RIG_PINS) return;
+  pthread_mutex_lock(&gPinLock);
+  Pin& p = gPins[pin];
+  p.fn = fn;
+  p.fnArg = fnArg;
+  p.arg = arg;
+  p.intrMode = (uint8_t)mode;
+  p.intrOn = true;
+  if (levelActive(p, pinLevel(p))) pinPostLevelCheck(pin);
+  pthread_mutex_unlock(&gPinLock);
+}
+
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode) {
+  attach(pin, fn, nullptr, nullptr, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode) {
+  attach(pin, nullptr, fn, arg, mode);
+}
+
+void detachInterrupt(uint8_t pin) {
+  attach(pin, nullptr, nullptr, nullptr, 0);
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin) {
+  if (pin < 0 || pin >= RIG_PINS) return ESP_ERR_INVALID_ARG;
+  pthread_mutex_lock(&gPinLock);
+  Pin& p = gPins[pin];
+  p.intrOn = true;
+  if (levelActive(p, pinLevel(p))) pinPostLevelCheck((uint8_t)pin);
+  pthread_mutex_unlock(&gPinLock);
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin) {
+  if (pin < 0 || pin >= RIG_PINS) return ESP_ERR_INVALID_ARG;
+  pthread_mutex_lock(&gPinLock);
+  gPins[pin].intrOn = false;
+  pthread_mutex_unlock(&gPinLock);
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+  (void)type;
+  return pin >= 0 && pin < RIG_PINS ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/** @brief Pins float until the sketch or the scenario drives them. */
+static struct PinInit {
+  PinInit() {
+    for (Pin& p : gPins) p.ext = 0xFF;
+  }
+} gPinInit;
+
+// ============================================================================
+// ADC
+// ============================================================================
+
+/** @brief Battery sense input and its divider, as wired on the tag. */
+#define RIG_BATTERY_PIN     1
+#define RIG_BATTERY_DIVIDER 2
+
+/** @brief Full-scale input at 11 dB attenuation (mV). */
+#define RIG_ADC_FULL_MV 3100
+
+static std::minstd_rand gAdcNoise(12345);
+static pthread_mutex_t gAdcLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Input voltage of an ADC pin (mV), with a few mV of noise. */
+static int32_t pinMilliVolts(uint8_t pin) {
+  if (pin != RIG_BATTERY_PIN) return 0;
+  pthread_mutex_lock(&gAdcLock);
+  int noise = (int)(gAdcNoise() % 9) - 4;
+  pthread_mutex_unlock(&gAdcLock);
+  int32_t mv = (int32_t)rigBatteryMv(gRigDev) / RIG_BATTERY_DIVIDER + noise;
+  return mv < 0 ? 0 : (mv > RIG_ADC_FULL_MV ? RIG_ADC_FULL_MV : mv);
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return (uint16_t)(pinMilliVolts(pin) * 4095 / RIG_ADC_FULL_MV);
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+  return (uint32_t)pinMilliVolts(pin);
+}
+
+void analogReadResolution(uint8_t bits) {
+  (void)bits;
+}
+
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t atten) {
+  (void)pin;
+  (void)atten;
+}
+
+// ============================================================================
+// LEDC
+// ============================================================================
+
+/** @brief Tone frequency per pin, so only changes are reported. */
+static uint32_t gTone[RIG_PINS];
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution) {
+  (void)freq;
+  (void)resolution;
+  return pin < RIG_PINS;
+}
+
+bool ledcWrite(uint8_t pin, uint32_t duty) {
+  (void)duty;
+  return pin < RIG_PINS;
+}
+
+uint32_t ledcWriteTone(uint8_t pin, uint32_t freq) {
+  if (pin >= RIG_PINS) return 0;
+  uint32_t was = __atomic_exchange_n(&gTone[pin], freq, __ATOMIC_RELAXED);
+  if (was != freq) {
+    if (freq) {
+      rigNotef("tone pin %u %u Hz", pin, (unsigned)freq);
+    } else {
+      rigNotef("tone pin %u off", pin);
+    }
+  }
+  return freq;
+}
+
+bool ledcDetach(uint8_t pin) {
+  return pin < RIG_PINS;
+}
+
+// ============================================================================
+// Hardware Timers
+// ============================================================================
+
+struct hw_timer_s {
+  uint32_t frequency;
+  uint64_t alarm;       /**< Count of the alarm, 0 if none. */
+  bool     autoreload;
+  bool     running;
+  uint64_t count;       /**< Count when last started or reloaded. */
+  uint64_t sinceUs;     /**< Device time of `count`. */
+  uint32_t gen;         /**< Bumped by every change; stale alarms are dropped. */
+  void (*fn)(void);
+  void (*fnArg)(void*);
+  void*    arg;
+};
+
+/** @brief Guards every hardware timer. */
+static pthread_mutex_t gTimerLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t timerCount(const hw_timer_t* t, uint64_t now) {
+  if (!t->running) return t->count;
+  return t->count + (now - t->sinceUs) * t->frequency / 1000000;
+}
+
+static void timerFire(hw_timer_t* t, uint32_t gen);
+
+/** @brief Queue the next alarm of a running timer (lock held). */
+static void timerArm(hw_timer_t* t) {
+  t->gen++;
+  if (!t->running || t->alarm == 0) return;
+  uint64_t now = rigNow();
+  uint64_t count = timerCount(t, now);
+  if (count >= t->alarm && !t->autoreload) return;
+  uint64_t left = count < t->alarm ? t->alarm - count : 0;
+  uint32_t gen = t->gen;
+  gIsr.postAt(now + left * 1000000 / t->frequency, [t, gen] { timerFire(t, gen); });
+}
+
+static void timerFire(hw_timer_t* t, uint32_t gen) {
+  pthread_mutex_lock(&gTimerLock);
+  if (t->gen != gen || !t->running) {
+    pthread_mutex_unlock(&gTimerLock);
+    return;
+  }
+  if (t->autoreload) {
+    // Reload from the alarm's own time so the period does not drift
+    t->sinceUs += t->alarm * 1000000 / t->frequency;
+    t->count = 0;
+    timerArm(t);
+  } else {
+    t->gen++;
+  }
+  void (*fn)(void) = t->fn;
+  void (*fnArg)(void*) = t->fnArg;
+  void* arg = t->arg;
+  pthread_mutex_unlock(&gTimerLock);
+  if (fn) fn();
+  if (fnArg) fnArg(arg);
+}
+
+hw_timer_t* timerBegin(uint32_t frequency) {
+  if (frequency == 0) return nullptr;
+  hw_timer_t* t = new hw_timer_t();
+  t->frequency = frequency;
+  t->running = true;
+  t->sinceUs = rigNow();
+  return t;
+}
+
+void timerEnd(hw_timer_t* timer) {
+  // Disarmed, not freed: an alarm may still be queued on the interrupt thread
+  timerStop(timer);
+}
+
+void timerStart(hw_timer_t* t) {
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  if (!t->running) {
+    t->running = true;
+    t->sinceUs = rigNow();
+    timerArm(t);
+  }
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+void timerStop(hw_timer_t* t) {
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  if (t->running) {
+    t->count = timerCount(t, rigNow());
+    t->running = false;
+    t->gen++;
+  }
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+void timerRestart(hw_timer_t* t) {
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  t->count = 0;
+  t->sinceUs = rigNow();
+  timerArm(t);
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+uint64_t timerRead(hw_timer_t* t) {
+  if (!t) return 0;
+  pthread_mutex_lock(&gTimerLock);
+  uint64_t count = timerCount(t, rigNow());
+  pthread_mutex_unlock(&gTimerLock);
+  return count;
+}
+
+void timerAttachInterrupt(hw_timer_t* t, void (*fn)(void)) {
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  t->fn = fn;
+  t->fnArg = nullptr;
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+void timerAttachInterruptArg(hw_timer_t* t, void (*fn)(void*), void* arg) {
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  t->fn = nullptr;
+  t->fnArg = fn;
+  t->arg = arg;
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+void timerDetachInterrupt(hw_timer_t* t) {
+  timerAttachInterruptArg(t, nullptr, nullptr);
+}
+
+void timerAlarm(hw_timer_t* t, uint64_t alarmValue, bool autoreload, uint64_t reloadCount) {
+  (void)reloadCount;
+  if (!t) return;
+  pthread_mutex_lock(&gTimerLock);
+  t->alarm = alarmValue;
+  t->autoreload = autoreload;
+  timerArm(t);
+  pthread_mutex_unlock(&gTimerLock);
+}
+
+// ============================================================================
+// Misc
+// ============================================================================
+
+static std::mt19937 gRandom(1);
+static pthread_mutex_t gRandomLock = PTHREAD_MUTEX_INITIALIZER;
+
+long random(long max) {
+  return max > 0 ? random(0, max) : 0;
+}
+
+long random(long min, long max) {
+  if (max <= min) return min;
+  pthread_mutex_lock(&gRandomLock);
+  long v = min + (long)(gRandom() % (uint32_t)(max - min));
+  pthread_mutex_unlock(&gRandomLock);
+  return v;
+}
+
+void randomSeed(unsigned long seed) {
+  pthread_mutex_lock(&gRandomLock);
+  gRandom.seed((uint32_t)seed);
+  pthread_mutex_unlock(&gRandomLock);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
@@ -0,0 +1,1632 @@
+/**
+ * @file ble.cpp
+ * @brief BLE of the host rig: the Arduino BLE library classes and the
+ *        Bluedroid GAP/GATT client calls the sketches use, over the world's
+ *        radio.
+ *
+ * The link carries ATT-shaped PDUs, one opcode byte then little-endian
+ * fields:
+ *
+ *     0x01 error          [req opcode][handle u16][status]
+ *     0x02/0x03 MTU       [mtu u16]
+ *     0x0A/0x0B read      [handle u16] / [value]
+ *     0x12/0x13 write     [handle u16][value] / -
+ *     0x52 write command  [handle u16][value]
+ *     0x1B notification   [handle u16][value]
+ *
+ * Two rig-specific exchanges stand in for procedures the sketches only see
+ * the end of:
+ *
+ *     0xF0/0xF1 discovery [index u16] / [total u16][index u16][entry]
+ *               entry: kind (0 service, 1 characteristic, 2 descriptor),
+ *                      handle u16, end handle / properties / owner u16,
+ *                      UUID length, UUID (Bluedroid byte order)
+ *     0xF2/0xF3 pairing   [auth][init keys][resp keys] /
+ *                         [status][key mask][IRK, MSB first][addr type][identity addr]
+ *
+ * Discovery takes one round trip per attribute, so its cost grows with the
+ * database as on air. Pairing has no key exchange: the bond holds the
+ * peer's IRK and identity address, which is what the scanner needs.
+ *
+ * Every callback (library and Bluedroid) runs on the BLE thread. The GATT
+ * lock guards links, values and bonds, and is never held across a callback.
+ */
+
+#include <deque>
+#include <set>
+#include "Arduino.h"
+#include "BLEDevice.h"
+#include "BLE2902.h"
+#include "core.h"
+
+/** @brief Interface handed out by esp_ble_gattc_app_register(). */
+#define RIG_GATTC_IF 3
+
+/** @brief Supervision timeout reported with a connection (10 ms units). */
+#define RIG_SUPERVISION_10MS 400
+
+enum : uint8_t {
+  ATT_ERROR = 0x01,
+  ATT_MTU_REQ = 0x02,
+  ATT_MTU_RSP = 0x03,
+  ATT_READ_REQ = 0x0A,
+  ATT_READ_RSP = 0x0B,
+  ATT_WRITE_REQ = 0x12,
+  ATT_WRITE_RSP = 0x13,
+  ATT_NOTIFY = 0x1B,
+  ATT_WRITE_CMD = 0x52,
+  RIG_DISC_REQ = 0xF0,
+  RIG_DISC_RSP = 0xF1,
+  RIG_PAIR_REQ = 0xF2,
+  RIG_PAIR_RSP = 0xF3,
+};
+
+enum : uint8_t { ENTRY_SERVICE = 0, ENTRY_CHAR = 1, ENTRY_DESCR = 2 };
+
+/** @brief One attribute of a peer's database, as discovered. */
+struct Entry {
+  uint8_t       kind;
+  uint16_t      handle;
+  uint16_t      aux;   /**< Service end handle, characteristic properties or descriptor owner. */
+  esp_bt_uuid_t uuid;
+};
+
+/** @brief An ATT request waiting for its response (client side). */
+struct Pending {
+  uint8_t  opcode;
+  uint16_t handle;
+  bool     descr;
+};
+
+/** @brief One open link. */
+struct Link {
+  int16_t              id;
+  bool                 central;
+  uint8_t              peer[6];
+  uint8_t              peerType;
+  uint16_t             mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+  uint32_t             intervalUs;
+  bool                 closing = false;   /**< We asked for the close. */
+  bool                 encrypted = false; /**< Pairing completed on this link. */
+  std::deque<Pending>  pending;
+  std::vector<Entry>   db;                /**< Discovered database of the peer. */
+  esp_bt_uuid_t        searchFilter;
+  bool                 searchAll = true;
+  std::set<uint16_t>   notify;            /**< Handles registered for notification. */
+};
+
+// ============================================================================
+// State
+// ============================================================================
+
+static pthread_mutex_t gLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static bool                gInit = false;
+static uint8_t             gPublic[6];
+static uint8_t             gIrk[16];          /**< Ours, most significant byte first. */
+static bool                gPrivacy = false;
+static uint32_t            gRpaSeed = 0;
+static uint16_t            gLocalMtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+static esp_ble_auth_req_t  gAuthReq = ESP_LE_AUTH_NO_BOND;
+static uint8_t             gInitKeys = 0;
+static uint8_t             gRespKeys = 0;
+static gap_event_handler   gGapHandler = nullptr;
+static gattc_event_handler gGattcHandler = nullptr;
+static bool                gGattcRegistered = false;
+
+static BLEServer*      gServer = nullptr;
+static BLEAdvertising* gAdvertising = nullptr;
+static BLEScan*        gScan = nullptr;
+static uint16_t        gNextHandle = 1;
+
+static std::map<int16_t, Link>          gLinks;
+static std::vector<esp_ble_bond_dev_t> gBonds;
+static bool    gConnectPending = false;
+static uint8_t gConnectAddr[6];
+
+/** @brief Generation of the running scan, so a stopped scan's timeout is dropped. */
+static uint32_t gScanGen = 0;
+
+class Lock {
+ public:
+  Lock() { pthread_mutex_lock(&gLock); }
+  ~Lock() { pthread_mutex_unlock(&gLock); }
+};
+
+static void put16(std::string& s, uint16_t v) {
+  s += (char)(v & 0xFF);
+  s += (char)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static Link* linkById(int16_t id) {
+  auto it = gLinks.find(id);
+  return it == gLinks.end() ? nullptr : &it->second;
+}
+
+static Link* linkByPeer(const uint8_t* addr) {
+  for (auto& kv : gLinks) {
+    if (memcmp(kv.second.peer, addr, 6) == 0) return &kv.second;
+  }
+  return nullptr;
+}
+
+static void send(const Link& l, const std::string& pdu) {
+  rigSend(gRigDev, l.id, (const uint8_t*)pdu.data(), pdu.size());
+}
+
+static void gattcEvent(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t* p) {
+  if (gGattcHandler && gGattcRegistered) gGattcHandler(event, RIG_GATTC_IF, p);
+}
+
+static void gapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* p) {
+  if (gGapHandler) gGapHandler(event, p);
+}
+
+// ============================================================================
+// Identifiers
+// ============================================================================
+
+/** @brief Bluetooth base UUID, in Bluedroid's byte order (least significant first). */
+static const uint8_t kBaseUuid[16] = { 0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+                                       0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+static void to128(const esp_bt_uuid_t& u, uint8_t out[16]) {
+  memcpy(out, kBaseUuid, 16);
+  if (u.len == ESP_UUID_LEN_16) {
+    out[12] = (uint8_t)u.uuid.uuid16;
+    out[13] = (uint8_t)(u.uuid.uuid16 >> 8);
+  } else if (u.len == ESP_UUID_LEN_32) {
+    uint32_t v = u.uuid.uuid32;
+    for (int i = 0; i < 4; i++) out[12 + i] = (uint8_t)(v >> (8 * i));
+  } else {
+    memcpy(out, u.uuid.uuid128, 16);
+  }
+}
+
+static bool uuidEqual(const esp_bt_uuid_t& a, const esp_bt_uuid_t& b) {
+  uint8_t x[16], y[16];
+  to128(a, x);
+  to128(b, y);
+  return memcmp(x, y, 16) == 0;
+}
+
+static int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+BLEUUID::BLEUUID() : valid_(false) {
+  memset(&uuid_, 0, sizeof(uuid_));
+}
+
+BLEUUID::BLEUUID(uint16_t uuid16) : valid_(true) {
+  memset(&uuid_, 0, sizeof(uuid_));
+  uuid_.len = ESP_UUID_LEN_16;
+  uuid_.uuid.uuid16 = uuid16;
+}
+
+BLEUUID::BLEUUID(const esp_bt_uuid_t& uuid) : uuid_(uuid), valid_(true) {}
+
+BLEUUID::BLEUUID(const char* text) : BLEUUID() {
+  uint8_t bytes[16];
+  size_t n = 0;
+  for (const char* p = text; p && *p && n < 32; p++) {
+    if (*p == '-') continue;
+    int v = hexNibble(*p);
+    if (v < 0) return;
+    if (n % 2 == 0) bytes[n / 2] = (uint8_t)(v << 4);
+    else bytes[n / 2] |= (uint8_t)v;
+    n++;
+  }
+  if (n == 4) {
+    uuid_.len = ESP_UUID_LEN_16;
+    uuid_.uuid.uuid16 = (uint16_t)(bytes[0] << 8 | bytes[1]);
+  } else if (n == 8) {
+    uuid_.len = ESP_UUID_LEN_32;
+    uuid_.uuid.uuid32 = (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+  } else if (n == 32) {
+    uuid_.len = ESP_UUID_LEN_128;
+    for (int i = 0; i < 16; i++) uuid_.uuid.uuid128[i] = bytes[15 - i];
+  } else {
+    return;
+  }
+  valid_ = true;
+}
+
+bool BLEUUID::equals(const BLEUUID& other) const {
+  if (!valid_ || !other.valid_) return valid_ == other.valid_;
+  return uuidEqual(uuid_, other.uuid_);
+}
+
+String BLEUUID::toString() const {
+  if (!valid_) return String("<NULL>");
+  uint8_t b[16];
+  to128(uuid_, b);
+  char text[37];
+  snprintf(text, sizeof(text), "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x", b[15], b[14],
+           b[13], b[12], b[11], b[10], b[9], b[8], b[7], b[6], b[5], b[4], b[3], b[2], b[1], b[0]);
+  return String(text);
+}
+
+BLEAddress::BLEAddress() : type_(BLE_ADDR_TYPE_PUBLIC) {
+  memset(addr_, 0, sizeof(addr_));
+}
+
+BLEAddress::BLEAddress(const esp_bd_addr_t addr, uint8_t type) : type_(type) {
+  memcpy(addr_, addr, sizeof(addr_));
+}
+
+BLEAddress::BLEAddress(const String& text, uint8_t type) : BLEAddress() {
+  type_ = type;
+  unsigned v[6];
+  if (sscanf(text.c_str(), "%x:%x:%x:%x:%x:%x", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6) {
+    for (int i = 0; i < 6; i++) addr_[i] = (uint8_t)v[i];
+  }
+}
+
+bool BLEAddress::equals(const BLEAddress& other) const {
+  return memcmp(addr_, other.addr_, sizeof(addr_)) == 0;
+}
+
+bool BLEAddress::operator<(const BLEAddress& other) const {
+  return memcmp(addr_, other.addr_, sizeof(addr_)) < 0;
+}
+
+String BLEAddress::toString() const {
+  char text[18];
+  snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", addr_[0], addr_[1], addr_[2], addr_[3], addr_[4],
+           addr_[5]);
+  return String(text);
+}
+
+// ============================================================================
+// GATT Server Database
+// ============================================================================
+
+/**
+ * @brief Access to the library classes' internals for the stack.
+ */
+struct RigGatt {
+  /** @brief GATT property bits of the library's property flags. */
+  static uint8_t gattProps(uint32_t props) {
+    uint8_t p = 0;
+    if (props & BLECharacteristic::PROPERTY_BROADCAST) p |= ESP_GATT_CHAR_PROP_BIT_BROADCAST;
+    if (props & BLECharacteristic::PROPERTY_READ) p |= ESP_GATT_CHAR_PROP_BIT_READ;
+    if (props & BLECharacteristic::PROPERTY_WRITE_NR) p |= ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+    if (props & BLECharacteristic::PROPERTY_WRITE) p |= ESP_GATT_CHAR_PROP_BIT_WRITE;
+    if (props & BLECharacteristic::PROPERTY_NOTIFY) p |= ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+    if (props & BLECharacteristic::PROPERTY_INDICATE) p |= ESP_GATT_CHAR_PROP_BIT_INDICATE;
+    return p;
+  }
+
+  /** @brief The started database, flattened in handle order (lock held). */
+  static std::vector<Entry> entries() {
+    std::vector<Entry> out;
+    if (!gServer) return out;
+    for (BLEService* s : gServer->services_) {
+      if (!s->started_) continue;
+      out.push_back({ ENTRY_SERVICE, s->handle_, s->endHandle_, *s->uuid_.getNative() });
+      for (BLECharacteristic* c : s->chars_) {
+        out.push_back({ ENTRY_CHAR, c->handle_, gattProps(c->props_), *c->uuid_.getNative() });
+        for (BLEDescriptor* d : c->descriptors_) {
+          out.push_back({ ENTRY_DESCR, d->handle_, c->handle_, *d->uuid_.getNative() });
+        }
+      }
+    }
+    return out;
+  }
+
+  static BLECharacteristic* charByHandle(uint16_t handle) {
+    if (!gServer) return nullptr;
+    for (BLEService* s : gServer->services_) {
+      if (!s->started_) continue;
+      for (BLECharacteristic* c : s->chars_) {
+        if (c->handle_ == handle) return c;
+      }
+    }
+    return nullptr;
+  }
+
+  static BLEDescriptor* descrByHandle(uint16_t handle) {
+    if (!gServer) return nullptr;
+    for (BLEService* s : gServer->services_) {
+      if (!s->started_) continue;
+      for (BLECharacteristic* c : s->chars_) {
+        for (BLEDescriptor* d : c->descriptors_) {
+          if (d->handle_ == handle) return d;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  static BLEServerCallbacks* serverCallbacks() { return gServer ? gServer->callbacks_ : nullptr; }
+  static void advertisingStopped() {
+    if (gAdvertising) gAdvertising->running_ = false;
+  }
+  static std::string value(BLECharacteristic* c) { return c->value_; }
+  static void setValue(BLECharacteristic* c, const uint8_t* data, size_t len) { c->value_.assign((const char*)data, len); }
+  static std::string value(BLEDescriptor* d) { return d->value_; }
+  static BLECharacteristicCallbacks* callbacks(BLECharacteristic* c) { return c->callbacks_; }
+  static esp_gatt_perm_t perm(BLECharacteristic* c) { return c->perm_; }
+};
+
+// ============================================================================
+// Server Classes
+// ============================================================================
+
+BLEDescriptor::BLEDescriptor(const char* uuid, uint16_t maxLen) : BLEDescriptor(BLEUUID(uuid), maxLen) {}
+
+BLEDescriptor::BLEDescriptor(BLEUUID uuid, uint16_t maxLen) : uuid_(uuid), maxLen_(maxLen) {}
+
+void BLEDescriptor::setValue(const uint8_t* data, size_t len) {
+  Lock l;
+  value_.assign((const char*)data, len < maxLen_ ? len : maxLen_);
+}
+
+size_t BLEDescriptor::getLength() {
+  Lock l;
+  return value_.size();
+}
+
+String BLEDescriptor::getValue() {
+  Lock l;
+  return String(value_);
+}
+
+BLE2902::BLE2902() : BLEDescriptor(BLEUUID((uint16_t)ESP_GATT_UUID_CHAR_CLIENT_CONFIG), 2) {
+  value_.assign(2, '\0');
+}
+
+bool BLE2902::getNotifications() {
+  Lock l;
+  return !value_.empty() && (value_[0] & 0x01);
+}
+
+bool BLE2902::getIndications() {
+  Lock l;
+  return !value_.empty() && (value_[0] & 0x02);
+}
+
+void BLE2902::setNotifications(bool on) {
+  Lock l;
+  value_.resize(2);
+  value_[0] = (char)(on ? (value_[0] | 0x01) : (value_[0] & ~0x01));
+}
+
+void BLE2902::setIndications(bool on) {
+  Lock l;
+  value_.resize(2);
+  value_[0] = (char)(on ? (value_[0] | 0x02) : (value_[0] & ~0x02));
+}
+
+BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) : uuid_(uuid), props_(properties) {}
+
+void BLECharacteristic::addDescriptor(BLEDescriptor* descriptor) {
+  Lock l;
+  descriptor->chr_ = this;
+  descriptors_.push_back(descriptor);
+}
+
+BLEDescriptor* BLECharacteristic::getDescriptorByUUID(BLEUUID uuid) {
+  Lock l;
+  for (BLEDescriptor* d : descriptors_) {
+    if (d->getUUID().equals(uuid)) return d;
+  }
+  return nullptr;
+}
+
+void BLECharacteristic::setValue(const uint8_t* data, size_t len) {
+  Lock l;
+  value_.assign((const char*)data, len);
+}
+
+String BLECharacteristic::getValue() {
+  Lock l;
+  return String(value_);
+}
+
+size_t BLECharacteristic::getLength() {
+  Lock l;
+  return value_.size();
+}
+
+void BLECharacteristic::notify(bool isNotification) {
+  if (callbacks_) callbacks_->onNotify(this);
+  std::vector<const Link*> peers;
+  std::string pdu;
+  bool enabled = true;
+  {
+    Lock l;
+    for (BLEDescriptor* d : descriptors_) {
+      if (d->uuid_.equals(BLEUUID((uint16_t)ESP_GATT_UUID_CHAR_CLIENT_CONFIG))) {
+        enabled = d->value_.size() >= 1 && (d->value_[0] & (isNotification ? 0x01 : 0x02));
+      }
+    }
+    for (auto& kv : gLinks) {
+      if (!kv.second.central) peers.push_back(&kv.second);
+    }
+    if (enabled) {
+      for (const Link* p : peers) {
+        pdu.assign(1, (char)ATT_NOTIFY);
+        put16(pdu, handle_);
+        pdu.append(value_, 0, p->mtu - 3u);
+        send(*p, pdu);
+      }
+    }
+  }
+  if (!callbacks_) return;
+  if (peers.empty()) {
+    callbacks_->onStatus(this, BLECharacteristicCallbacks::ERROR_NO_CLIENT, 0);
+  } else if (!enabled) {
+    callbacks_->onStatus(this, isNotification ? BLECharacteristicCallbacks::ERROR_NOTIFY_DISABLED
+                                              : BLECharacteristicCallbacks::ERROR_INDICATE_DISABLED, 0);
+  } else {
+    callbacks_->onStatus(this, isNotification ? BLECharacteristicCallbacks::SUCCESS_NOTIFY
+                                              : BLECharacteristicCallbacks::SUCCESS_INDICATE, 0);
+  }
+}
+
+BLECharacteristic* BLEService::createCharacteristic(BLEUUID uuid, uint32_t properties) {
+  BLECharacteristic* c = new BLECharacteristic(uuid, properties);
+  addCharacteristic(c);
+  return c;
+}
+
+void BLEService::addCharacteristic(BLECharacteristic* c) {
+  Lock l;
+  c->service_ = this;
+  chars_.push_back(c);
+}
+
+BLECharacteristic* BLEService::getCharacteristic(BLEUUID uuid) {
+  Lock l;
+  for (BLECharacteristic* c : chars_) {
+    if (c->uuid_.equals(uuid)) return c;
+  }
+  return nullptr;
+}
+
+void BLEService::start() {
+  Lock l;
+  if (started_) return;
+  handle_ = gNextHandle++;
+  for (BLECharacteristic* c : chars_) {
+    gNextHandle++;   // declaration
+    c->handle_ = gNextHandle++;
+    for (BLEDescriptor* d : c->descriptors_) d->handle_ = gNextHandle++;
+  }
+  endHandle_ = (uint16_t)(gNextHandle - 1);
+  started_ = true;
+}
+
+void BLEService::stop() {
+  Lock l;
+  started_ = false;
+}
+
+BLEService* BLEServer::createService(BLEUUID uuid, uint32_t numHandles, uint8_t instId) {
+  (void)numHandles;
+  (void)instId;
+  Lock l;
+  BLEService* s = new BLEService(this, uuid);
+  services_.push_back(s);
+  return s;
+}
+
+BLEService* BLEServer::getServiceByUUID(BLEUUID uuid) {
+  Lock l;
+  for (BLEService* s : services_) {
+    if (s->uuid_.equals(uuid)) return s;
+  }
+  return nullptr;
+}
+
+BLEAdvertising* BLEServer::getAdvertising() {
+  return BLEDevice::getAdvertising();
+}
+
+void BLEServer::startAdvertising() {
+  getAdvertising()->start();
+}
+
+uint32_t BLEServer::getConnectedCount() {
+  Lock l;
+  uint32_t n = 0;
+  for (auto& kv : gLinks) n += !kv.second.central;
+  return n;
+}
+
+void BLEServer::disconnect(uint16_t connId) {
+  {
+    Lock l;
+    Link* link = linkById((int16_t)connId);
+    if (!link) return;
+    link->closing = true;
+  }
+  rigDisconnect(gRigDev, (int16_t)connId);
+}
+
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+  Lock l;
+  Link* link = linkById((int16_t)connId);
+  return link ? link->mtu : 0;
+}
+
+// ============================================================================
+// Advertising
+// ============================================================================
+
+void BLEAdvertisementData::add(uint8_t type, const uint8_t* data, size_t len) {
+  char head[2] = { (char)(len + 1), (char)type };
+  payload_.concat(head, 2);
+  payload_.concat((const char*)data, len);
+}
+
+void BLEAdvertisementData::setFlags(uint8_t flags) {
+  add(0x01, &flags, 1);
+}
+
+void BLEAdvertisementData::setManufacturerData(const String& data) {
+  add(0xFF, (const uint8_t*)data.c_str(), data.length());
+}
+
+void BLEAdvertisementData::setName(const String& name) {
+  add(0x09, (const uint8_t*)name.c_str(), name.length());
+}
+
+void BLEAdvertisementData::setShortName(const String& name) {
+  add(0x08, (const uint8_t*)name.c_str(), name.length());
+}
+
+void BLEAdvertisementData::setCompleteServices(BLEUUID uuid) {
+  const esp_bt_uuid_t* u = uuid.getNative();
+  if (u->len == ESP_UUID_LEN_16) {
+    uint8_t b[2] = { (uint8_t)u->uuid.uuid16, (uint8_t)(u->uuid.uuid16 >> 8) };
+    add(0x03, b, 2);
+  } else if (u->len == ESP_UUID_LEN_128) {
+    add(0x07, u->uuid.uuid128, 16);
+  }
+}
+
+void BLEAdvertisementData::setAppearance(uint16_t appearance) {
+  uint8_t b[2] = { (uint8_t)appearance, (uint8_t)(appearance >> 8) };
+  add(0x19, b, 2);
+}
+
+/** @brief Push the current data and address to the radio (lock held). */
+static void advertiseNow(const String& data, uint16_t minInterval, uint16_t maxInterval, bool newAddress) {
+  static uint8_t addr[6];
+  static uint8_t type = RIG_ADDR_PUBLIC;
+  if (newAddress || type == RIG_ADDR_PUBLIC) {
+    if (gPrivacy) {
+      rigRpa(gIrk, gRpaSeed++, addr);
+      type = RIG_ADDR_RANDOM;
+    } else {
+      memcpy(addr, gPublic, 6);
+      type = RIG_ADDR_PUBLIC;
+    }
+  }
+  uint32_t intervalUs = (uint32_t)(minInterval + maxInterval) / 2 * 625;
+  size_t len = data.length() < 31 ? data.length() : 31;
+  rigAdvertise(gRigDev, addr, type, (const uint8_t*)data.c_str(), len, intervalUs);
+}
+
+void BLEAdvertising::setAdvertisementData(BLEAdvertisementData& data) {
+  Lock l;
+  data_ = data.getPayload();
+  customData_ = true;
+  if (running_) advertiseNow(data_, minInterval_, maxInterval_, false);
+}
+
+void BLEAdvertising::setScanResponseData(BLEAdvertisementData& data) {
+  Lock l;
+  scanResponseData_ = data.getPayload();
+}
+
+void BLEAdvertising::start() {
+  Lock l;
+  if (!customData_) {
+    BLEAdvertisementData d;
+    d.setFlags(0x06);
+    for (BLEUUID& u : services_) d.setCompleteServices(u);
+    data_ = d.getPayload();
+  }
+  running_ = true;
+  advertiseNow(data_, minInterval_, maxInterval_, true);   // a new RPA per advertising set, as Bluedroid
+}
+
+bool BLEAdvertising::stop() {
+  Lock l;
+  running_ = false;
+  rigAdvertiseStop(gRigDev);
+  return true;
+}
+
+// ============================================================================
+// Scanning
+// ============================================================================
+
+void BLEAdvertisedDevice::setReport(const uint8_t addr[6], uint8_t addrType, int rssi, const uint8_t* data,
+                                    size_t len) {
+  address_ = BLEAddress(addr, addrType);
+  addrType_ = (esp_ble_addr_type_t)addrType;
+  rssi_ = rssi;
+  payload_ = String(data, len);
+  for (size_t i = 0; i + 1 < len;) {
+    uint8_t n = data[i];
+    if (n == 0 || i + 1 + n > len) break;
+    uint8_t type = data[i + 1];
+    const uint8_t* v = &data[i + 2];
+    size_t vlen = n - 1;
+    if (type == 0x08 || type == 0x09) {
+      name_ = String(v, vlen);
+    } else if (type == 0xFF) {
+      mfr_ = String(v, vlen);
+      haveMfr_ = true;
+    } else if (type == 0x02 || type == 0x03) {
+      for (size_t k = 0; k + 1 < vlen; k += 2) services_.push_back(BLEUUID((uint16_t)(v[k] | v[k + 1] << 8)));
+    } else if ((type == 0x06 || type == 0x07) && vlen >= 16) {
+      esp_bt_uuid_t u = {};
+      u.len = ESP_UUID_LEN_128;
+      memcpy(u.uuid.uuid128, v, 16);
+      services_.push_back(BLEUUID(u));
+    }
+    i += 1 + n;
+  }
+}
+
+bool BLEAdvertisedDevice::isAdvertisingService(BLEUUID uuid) {
+  for (BLEUUID& u : services_) {
+    if (u.equals(uuid)) return true;
+  }
+  return false;
+}
+
+String BLEAdvertisedDevice::toString() {
+  String s = "Name: " + name_ + ", Address: " + address_.toString();
+  if (haveMfr_) s += ", manufacturer data";
+  return s;
+}
+
+BLEAdvertisedDevice BLEScanResults::getDevice(uint32_t i) {
+  Lock l;
+  for (auto& kv : devices_) {
+    if (i-- == 0) return *kv.second;
+  }
+  return BLEAdvertisedDevice();
+}
+
+void BLEScanResults::dump() {
+  Lock l;
+  Serial.printf(">> Dump scan results:\n");
+  for (auto& kv : devices_) Serial.printf("- %s\n", kv.second->toString().c_str());
+}
+
+void BLEScan::setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* callbacks, bool wantDuplicates,
+                                          bool shouldParse) {
+  (void)shouldParse;
+  callbacks_ = callbacks;
+  wantDuplicates_ = wantDuplicates;
+}
+
+bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool isContinue) {
+  uint32_t gen;
+  {
+    Lock l;
+    if (running_) return false;
+    if (!isContinue) clearResults();
+    running_ = true;
+    completeCb_ = scanCompleteCB;
+    gen = ++gScanGen;
+    rigScan(gRigDev, true, (uint32_t)intervalMs_ * 1000, (uint32_t)windowMs_ * 1000);
+  }
+  if (duration) {
+    gBtu.postAt(rigNow() + (uint64_t)duration * 1000000, [this, gen] {
+      {
+        Lock l;
+        if (gen != gScanGen) return;
+      }
+      onDurationElapsed();
+    });
+  }
+  return true;
+}
+
+BLEScanResults* BLEScan::start(uint32_t duration, bool isContinue) {
+  if (!start(duration, nullptr, isContinue)) return nullptr;
+  while (running_) delay(10);
+  return &results_;
+}
+
+void BLEScan::stop() {
+  Lock l;
+  if (!running_) return;
+  running_ = false;
+  gScanGen++;
+  rigScan(gRigDev, false, 0, 0);
+}
+
+void BLEScan::onDurationElapsed() {
+  void (*cb)(BLEScanResults);
+  BLEScanResults copy;
+  {
+    Lock l;
+    if (!running_) return;
+    running_ = false;
+    gScanGen++;
+    rigScan(gRigDev, false, 0, 0);
+    cb = completeCb_;
+    if (cb) copy = results_;
+  }
+  if (cb) cb(copy);
+}
+
+void BLEScan::onReport(const uint8_t addr[6], uint8_t addrType, int rssi, const uint8_t* data, size_t len) {
+  BLEAdvertisedDevice* dev;
+  {
+    Lock l;
+    if (!running_) return;
+    std::string key = BLEAddress(addr, addrType).toString().str();
+    auto it = results_.devices_.find(key);
+    if (it != results_.devices_.end() && !wantDuplicates_) return;
+    if (it == results_.devices_.end()) {
+      dev = new BLEAdvertisedDevice();
+      results_.devices_[key] = dev;
+    } else {
+      dev = it->second;
+      *dev = BLEAdvertisedDevice();
+    }
+    dev->setReport(addr, addrType, rssi, data, len);
+  }
+  if (callbacks_) callbacks_->onResult(*dev);
+}
+
+void BLEScan::erase(BLEAddress address) {
+  Lock l;
+  auto it = results_.devices_.find(address.toString().str());
+  if (it == results_.devices_.end()) return;
+  delete it->second;
+  results_.devices_.erase(it);
+}
+
+void BLEScan::clearResults() {
+  Lock l;
+  for (auto& kv : results_.devices_) delete kv.second;
+  results_.devices_.clear();
+}
+
+// ============================================================================
+// Security and Device
+// ============================================================================
+
+void BLESecurity::setAuthenticationMode(esp_ble_auth_req_t mode) {
+  gAuthReq = mode;
+}
+
+void BLESecurity::setInitEncryptionKey(uint8_t keys) {
+  gInitKeys = keys;
+}
+
+void BLESecurity::setRespEncryptionKey(uint8_t keys) {
+  gRespKeys = keys;
+}
+
+void BLEDevice::init(const String& name) {
+  Lock l;
+  if (gInit) return;
+  uint8_t pub[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, (uint8_t)gRigDev };
+  memcpy(gPublic, pub, 6);
+  // Identity key of the device: derived from its name, stable across runs
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < name.length(); i++) h = (h ^ (uint8_t)name[i]) * 16777619u;
+  for (int i = 0; i < 16; i++) {
+    h = (h ^ (uint32_t)i) * 16777619u;
+    gIrk[i] = (uint8_t)(h >> 24);
+  }
+  gInit = true;
+}
+
+void BLEDevice::deinit(bool releaseMemory) {
+  (void)releaseMemory;
+  Lock l;
+  gInit = false;
+}
+
+bool BLEDevice::getInitialized() {
+  Lock l;
+  return gInit;
+}
+
+BLEServer* BLEDevice::createServer() {
+  Lock l;
+  if (!gServer) gServer = new BLEServer();
+  return gServer;
+}
+
+BLEScan* BLEDevice::getScan() {
+  Lock l;
+  if (!gScan) gScan = new BLEScan();
+  return gScan;
+}
+
+BLEAdvertising* BLEDevice::getAdvertising() {
+  Lock l;
+  if (!gAdvertising) gAdvertising = new BLEAdvertising();
+  return gAdvertising;
+}
+
+void BLEDevice::startAdvertising() {
+  getAdvertising()->start();
+}
+
+void BLEDevice::stopAdvertising() {
+  getAdvertising()->stop();
+}
+
+BLEAddress BLEDevice::getAddress() {
+  Lock l;
+  return BLEAddress(gPublic);
+}
+
+esp_err_t BLEDevice::setMTU(uint16_t mtu) {
+  return esp_ble_gatt_set_local_mtu(mtu);
+}
+
+uint16_t BLEDevice::getMTU() {
+  Lock l;
+  return gLocalMtu;
+}
+
+void BLEDevice::setEncryptionLevel(esp_ble_sec_act_t level) {
+  (void)level;
+}
+
+void BLEDevice::setCustomGapHandler(gap_event_handler handler) {
+  gGapHandler = handler;
+}
+
+void BLEDevice::setCustomGattcHandler(gattc_event_handler handler) {
+  gGattcHandler = handler;
+}
+
+// ============================================================================
+// Bluedroid GAP
+// ============================================================================
+
+esp_err_t esp_ble_gap_config_local_privacy(bool privacy_enable) {
+  Lock l;
+  gPrivacy = privacy_enable;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_disconnect(esp_bd_addr_t remote_device) {
+  int16_t id;
+  {
+    Lock l;
+    Link* link = linkByPeer(remote_device);
+    if (!link) {
+      if (!gConnectPending || memcmp(gConnectAddr, remote_device, 6) != 0) return ESP_ERR_NOT_FOUND;
+      rigConnectCancel(gRigDev, remote_device);
+      return ESP_OK;
+    }
+    link->closing = true;
+    id = link->id;
+  }
+  rigDisconnect(gRigDev, id);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_read_rssi(esp_bd_addr_t remote_addr) {
+  Lock l;
+  Link* link = linkByPeer(remote_addr);
+  if (!link) return ESP_ERR_NOT_FOUND;
+  return rigReadRssi(gRigDev, link->id) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_ble_set_encryption(esp_bd_addr_t bd_addr, esp_ble_sec_act_t sec_act) {
+  (void)sec_act;
+  Lock l;
+  Link* link = linkByPeer(bd_addr);
+  if (!link) return ESP_ERR_NOT_FOUND;
+  std::string pdu(1, (char)RIG_PAIR_REQ);
+  pdu += (char)gAuthReq;
+  pdu += (char)gInitKeys;
+  pdu += (char)gRespKeys;
+  send(*link, pdu);
+  return ESP_OK;
+}
+
+int esp_ble_get_bond_device_num(void) {
+  Lock l;
+  return (int)gBonds.size();
+}
+
+esp_err_t esp_ble_get_bond_device_list(int* dev_num, esp_ble_bond_dev_t* dev_list) {
+  if (!dev_num || !dev_list) return ESP_ERR_INVALID_ARG;
+  Lock l;
+  int n = (int)gBonds.size() < *dev_num ? (int)gBonds.size() : *dev_num;
+  for (int i = 0; i < n; i++) dev_list[i] = gBonds[i];
+  *dev_num = n;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr) {
+  Lock l;
+  for (auto it = gBonds.begin(); it != gBonds.end(); ++it) {
+    if (memcmp(it->bd_addr, bd_addr, 6) == 0) {
+      gBonds.erase(it);
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+// ============================================================================
+// Bluedroid GATT Client
+// ============================================================================
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu) {
+  if (mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE) return ESP_ERR_INVALID_ARG;
+  Lock l;
+  gLocalMtu = mtu;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_app_register(uint16_t app_id) {
+  gBtu.post([app_id] {
+    gGattcRegistered = true;
+    esp_ble_gattc_cb_param_t p = {};
+    p.reg.status = ESP_GATT_OK;
+    p.reg.app_id = app_id;
+    gattcEvent(ESP_GATTC_REG_EVT, &p);
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_open(esp_gatt_if_t gattc_if, esp_bd_addr_t remote_bda, esp_ble_addr_type_t remote_addr_type,
+                             bool is_direct) {
+  (void)remote_addr_type;
+  (void)is_direct;
+  if (gattc_if != RIG_GATTC_IF) return ESP_ERR_INVALID_ARG;
+  Lock l;
+  if (gConnectPending || !rigConnect(gRigDev, remote_bda)) return ESP_ERR_INVALID_STATE;
+  gConnectPending = true;
+  memcpy(gConnectAddr, remote_bda, 6);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_close(esp_gatt_if_t gattc_if, uint16_t conn_id) {
+  if (gattc_if != RIG_GATTC_IF) return ESP_ERR_INVALID_ARG;
+  {
+    Lock l;
+    Link* link = linkById((int16_t)conn_id);
+    if (!link) return ESP_ERR_NOT_FOUND;
+    link->closing = true;
+  }
+  rigDisconnect(gRigDev, (int16_t)conn_id);
+  return ESP_OK;
+}
+
+/** @brief Send a request that expects a response, remembering it (lock held). */
+static esp_err_t request(uint16_t conn_id, const std::string& pdu, uint16_t handle, bool descr) {
+  Link* link = linkById((int16_t)conn_id);
+  if (!link || !link->central) return ESP_ERR_NOT_FOUND;
+  link->pending.push_back({ (uint8_t)pdu[0], handle, descr });
+  send(*link, pdu);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_send_mtu_req(esp_gatt_if_t gattc_if, uint16_t conn_id) {
+  (void)gattc_if;
+  Lock l;
+  std::string pdu(1, (char)ATT_MTU_REQ);
+  put16(pdu, gLocalMtu);
+  return request(conn_id, pdu, 0, false);
+}
+
+esp_err_t esp_ble_gattc_search_service(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_bt_uuid_t* filter_uuid) {
+  (void)gattc_if;
+  Lock l;
+  Link* link = linkById((int16_t)conn_id);
+  if (!link) return ESP_ERR_NOT_FOUND;
+  link->db.clear();
+  link->searchAll = filter_uuid == nullptr;
+  if (filter_uuid) link->searchFilter = *filter_uuid;
+  std::string pdu(1, (char)RIG_DISC_REQ);
+  put16(pdu, 0);
+  return request(conn_id, pdu, 0, false);
+}
+
+esp_gatt_status_t esp_ble_gattc_get_char_by_uuid(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t start_handle,
+                                                 uint16_t end_handle, esp_bt_uuid_t char_uuid,
+                                                 esp_gattc_char_elem_t* result, uint16_t* count) {
+  (void)gattc_if;
+  if (!result || !count) return ESP_GATT_ILLEGAL_PARAMETER;
+  Lock l;
+  Link* link = linkById((int16_t)conn_id);
+  if (!link) return ESP_GATT_INVALID_HANDLE;
+  uint16_t n = 0;
+  for (const Entry& e : link->db) {
+    if (n >= *count) break;
+    if (e.kind != ENTRY_CHAR || e.handle < start_handle || e.handle > end_handle) continue;
+    if (!uuidEqual(e.uuid, char_uuid)) continue;
+    result[n].char_handle = e.handle;
+    result[n].properties = (esp_gatt_char_prop_t)e.aux;
+    result[n].uuid = e.uuid;
+    n++;
+  }
+  *count = n;
+  return n ? ESP_GATT_OK : ESP_GATT_NOT_FOUND;
+}
+
+esp_gatt_status_t esp_ble_gattc_get_descr_by_char_handle(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                                                         uint16_t char_handle, esp_bt_uuid_t descr_uuid,
+                                                         esp_gattc_descr_elem_t* result, uint16_t* count) {
+  (void)gattc_if;
+  if (!result || !count) return ESP_GATT_ILLEGAL_PARAMETER;
+  Lock l;
+  Link* link = linkById((int16_t)conn_id);
+  if (!link) return ESP_GATT_INVALID_HANDLE;
+  uint16_t n = 0;
+  for (const Entry& e : link->db) {
+    if (n >= *count) break;
+    if (e.kind != ENTRY_DESCR || e.aux != char_handle || !uuidEqual(e.uuid, descr_uuid)) continue;
+    result[n].handle = e.handle;
+    result[n].uuid = e.uuid;
+    n++;
+  }
+  *count = n;
+  return n ? ESP_GATT_OK : ESP_GATT_NOT_FOUND;
+}
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                  esp_gatt_auth_req_t auth_req) {
+  (void)gattc_if;
+  (void)auth_req;
+  Lock l;
+  std::string pdu(1, (char)ATT_READ_REQ);
+  put16(pdu, handle);
+  return request(conn_id, pdu, handle, false);
+}
+
+/** @brief A write with or without response; without, the event follows at once. */
+static esp_err_t write(uint16_t conn_id, uint16_t handle, uint16_t len, const uint8_t* value,
+                       esp_gatt_write_type_t type, bool descr) {
+  Lock l;
+  Link* link = linkById((int16_t)conn_id);
+  if (!link || !link->central) return ESP_ERR_NOT_FOUND;
+  if (len > link->mtu - 3) return ESP_ERR_INVALID_SIZE;
+  bool rsp = type == ESP_GATT_WRITE_TYPE_RSP;
+  std::string pdu(1, (char)(rsp ? ATT_WRITE_REQ : ATT_WRITE_CMD));
+  put16(pdu, handle);
+  pdu.append((const char*)value, len);
+  if (rsp) return request(conn_id, pdu, handle, descr);
+
+  send(*link, pdu);
+  gBtu.post([conn_id, handle, descr] {
+    esp_ble_gattc_cb_param_t p = {};
+    p.write.status = ESP_GATT_OK;
+    p.write.conn_id = conn_id;
+    p.write.handle = handle;
+    gattcEvent(descr ? ESP_GATTC_WRITE_DESCR_EVT : ESP_GATTC_WRITE_CHAR_EVT, &p);
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t* value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req) {
+  (void)gattc_if;
+  (void)auth_req;
+  return write(conn_id, handle, value_len, value, write_type, false);
+}
+
+esp_err_t esp_ble_gattc_write_char_descr(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                         uint16_t value_len, uint8_t* value, esp_gatt_write_type_t write_type,
+                                         esp_gatt_auth_req_t auth_req) {
+  (void)gattc_if;
+  (void)auth_req;
+  return write(conn_id, handle, value_len, value, write_type, true);
+}
+
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t gattc_if, esp_bd_addr_t server_bda, uint16_t handle) {
+  (void)gattc_if;
+  {
+    Lock l;
+    Link* link = linkByPeer(server_bda);
+    if (!link) return ESP_ERR_NOT_FOUND;
+    link->notify.insert(handle);
+  }
+  gBtu.post([handle] {
+    esp_ble_gattc_cb_param_t p = {};
+    p.reg_for_notify.status = ESP_GATT_OK;
+    p.reg_for_notify.handle = handle;
+    gattcEvent(ESP_GATTC_REG_FOR_NOTIFY_EVT, &p);
+  });
+  return ESP_OK;
+}
+
+// ============================================================================
+// Inbox: Links
+// ============================================================================
+
+static void onLinkUp(const RigMsg* m) {
+  esp_gatt_conn_params_t params = { (uint16_t)(m->intervalUs / 1250), 0, RIG_SUPERVISION_10MS };
+  {
+    Lock l;
+    Link& link = gLinks[m->link];
+    link.id = m->link;
+    link.central = m->central;
+    memcpy(link.peer, m->addr, 6);
+    link.peerType = m->addrType;
+    link.intervalUs = m->intervalUs;
+    if (m->central) gConnectPending = false;
+    else RigGatt::advertisingStopped();   // the controller stops advertising on connect
+  }
+
+  if (m->central) {
+    esp_ble_gattc_cb_param_t p = {};
+    p.connect.conn_id = (uint16_t)m->link;
+    p.connect.link_role = 0;
+    memcpy(p.connect.remote_bda, m->addr, 6);
+    p.connect.conn_params = params;
+    gattcEvent(ESP_GATTC_CONNECT_EVT, &p);
+
+    p = {};
+    p.open.status = ESP_GATT_OK;
+    p.open.conn_id = (uint16_t)m->link;
+    memcpy(p.open.remote_bda, m->addr, 6);
+    p.open.mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+    gattcEvent(ESP_GATTC_OPEN_EVT, &p);
+    return;
+  }
+
+  BLEServerCallbacks* cb = RigGatt::serverCallbacks();
+  if (!cb) return;
+  esp_ble_gatts_cb_param_t p = {};
+  p.connect.conn_id = (uint16_t)m->link;
+  p.connect.link_role = 1;
+  memcpy(p.connect.remote_bda, m->addr, 6);
+  p.connect.conn_params = params;
+  cb->onConnect(gServer);
+  cb->onConnect(gServer, &p);
+}
+
+static void onLinkFail(const RigMsg* m) {
+  {
+    Lock l;
+    gConnectPending = false;
+  }
+  esp_ble_gattc_cb_param_t p = {};
+  p.open.status = ESP_GATT_ERROR;
+  p.open.conn_id = 0;
+  memcpy(p.open.remote_bda, m->addr, 6);
+  gattcEvent(ESP_GATTC_OPEN_EVT, &p);
+}
+
+static void onLinkDown(const RigMsg* m) {
+  bool central, closing;
+  uint8_t peer[6];
+  {
+    Lock l;
+    Link* link = linkById(m->link);
+    if (!link) return;
+    central = link->central;
+    closing = link->closing;
+    memcpy(peer, link->peer, 6);
+    gLinks.erase(m->link);
+  }
+  esp_gatt_conn_reason_t reason = closing ? ESP_GATT_CONN_TERMINATE_LOCAL_HOST
+                                          : (m->len ? (esp_gatt_conn_reason_t)m->data[0] : ESP_GATT_CONN_TIMEOUT);
+  if (central) {
+    esp_ble_gattc_cb_param_t p = {};
+    p.disconnect.reason = reason;
+    p.disconnect.conn_id = (uint16_t)m->link;
+    memcpy(p.disconnect.remote_bda, peer, 6);
+    gattcEvent(ESP_GATTC_DISCONNECT_EVT, &p);
+
+    p = {};
+    p.close.status = ESP_GATT_OK;
+    p.close.conn_id = (uint16_t)m->link;
+    memcpy(p.close.remote_bda, peer, 6);
+    p.close.reason = reason;
+    gattcEvent(ESP_GATTC_CLOSE_EVT, &p);
+    return;
+  }
+
+  BLEServerCallbacks* cb = RigGatt::serverCallbacks();
+  if (!cb) return;
+  esp_ble_gatts_cb_param_t p = {};
+  p.disconnect.conn_id = (uint16_t)m->link;
+  memcpy(p.disconnect.remote_bda, peer, 6);
+  p.disconnect.reason = reason;
+  cb->onDisconnect(gServer);
+  cb->onDisconnect(gServer, &p);
+}
+
+// ============================================================================
+// Inbox: Server PDUs
+// ============================================================================
+
+static void sendError(const Link& link, uint8_t opcode, uint16_t handle, uint8_t status) {
+  std::string pdu(1, (char)ATT_ERROR);
+  pdu += (char)opcode;
+  put16(pdu, handle);
+  pdu += (char)status;
+  send(link, pdu);
+}
+
+/** @brief A request from a central, to our server. */
+static void serverPdu(Link& link, const uint8_t* d, size_t len) {
+  uint8_t op = d[0];
+  if (op == ATT_MTU_REQ && len >= 3) {
+    uint16_t mtu;
+    {
+      Lock l;
+      mtu = get16(d + 1) < gLocalMtu ? get16(d + 1) : gLocalMtu;
+      link.mtu = mtu;
+      std::string pdu(1, (char)ATT_MTU_RSP);
+      put16(pdu, gLocalMtu);
+      send(link, pdu);
+    }
+    BLEServerCallbacks* cb = RigGatt::serverCallbacks();
+    if (cb) {
+      esp_ble_gatts_cb_param_t p = {};
+      p.mtu.conn_id = (uint16_t)link.id;
+      p.mtu.mtu = mtu;
+      cb->onMtuChanged(gServer, &p);
+    }
+    return;
+  }
+
+  if (op == RIG_DISC_REQ && len >= 3) {
+    Lock l;
+    std::vector<Entry> db = RigGatt::entries();
+    uint16_t index = get16(d + 1);
+    std::string pdu(1, (char)RIG_DISC_RSP);
+    put16(pdu, (uint16_t)db.size());
+    put16(pdu, index);
+    if (index < db.size()) {
+      const Entry& e = db[index];
+      pdu += (char)e.kind;
+      put16(pdu, e.handle);
+      put16(pdu, e.aux);
+      pdu += (char)e.uuid.len;
+      pdu.append((const char*)&e.uuid.uuid, e.uuid.len);
+    }
+    send(link, pdu);
+    return;
+  }
+
+  if (op == RIG_PAIR_REQ && len >= 4) {
+    Lock l;
+    uint8_t keys = (uint8_t)(d[3] & gRespKeys);
+    std::string pdu(1, (char)RIG_PAIR_RSP);
+    pdu += (char)ESP_BT_STATUS_SUCCESS;
+    pdu += (char)(keys | ESP_BLE_ENC_KEY_MASK);
+    pdu.append((const char*)gIrk, 16);
+    pdu += (char)BLE_ADDR_TYPE_PUBLIC;
+    pdu.append((const char*)gPublic, 6);
+    send(link, pdu);
+    link.encrypted = true;
+    return;
+  }
+
+  if ((op == ATT_READ_REQ || op == ATT_WRITE_REQ || op == ATT_WRITE_CMD) && len >= 3) {
+    uint16_t handle = get16(d + 1);
+    BLECharacteristic* c;
+    BLEDescriptor* descr;
+    {
+      Lock l;
+      c = RigGatt::charByHandle(handle);
+      descr = c ? nullptr : RigGatt::descrByHandle(handle);
+    }
+    if (!c && !descr) {
+      if (op != ATT_WRITE_CMD) sendError(link, op, handle, ESP_GATT_INVALID_HANDLE);
+      return;
+    }
+    // Encrypted permissions: Bluedroid refuses the access until the link is paired
+    if (c) {
+      esp_gatt_perm_t need = op == ATT_READ_REQ
+        ? (esp_gatt_perm_t)(ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_READ_ENC_MITM)
+        : (esp_gatt_perm_t)(ESP_GATT_PERM_WRITE_ENCRYPTED | ESP_GATT_PERM_WRITE_ENC_MITM);
+      Lock l;
+      if ((RigGatt::perm(c) & need) && !link.encrypted) {
+        if (op != ATT_WRITE_CMD) sendError(link, op, handle, ESP_GATT_INSUF_AUTHENTICATION);
+        return;
+      }
+    }
+
+    if (op == ATT_READ_REQ) {
+      std::string value;
+      if (c) {
+        BLECharacteristicCallbacks* cb = RigGatt::callbacks(c);
+        if (cb) {
+          esp_ble_gatts_cb_param_t p = {};
+          p.read.conn_id = (uint16_t)link.id;
+          memcpy(p.read.bda, link.peer, 6);
+          p.read.handle = handle;
+          p.read.need_rsp = true;
+          cb->onRead(c, &p);
+        }
+        Lock l;
+        value = RigGatt::value(c);
+      } else {
+        Lock l;
+        value = RigGatt::value(descr);
+      }
+      Lock l;
+      std::string pdu(1, (char)ATT_READ_RSP);
+      pdu.append(value, 0, link.mtu - 1u);
+      send(link, pdu);
+      return;
+    }
+
+    const uint8_t* value = d + 3;
+    size_t vlen = len - 3;
+    if (c) {
+      {
+        Lock l;
+        RigGatt::setValue(c, value, vlen);
+      }
+      BLECharacteristicCallbacks* cb = RigGatt::callbacks(c);
+      if (cb) {
+        esp_ble_gatts_cb_param_t p = {};
+        p.write.conn_id = (uint16_t)link.id;
+        memcpy(p.write.bda, link.peer, 6);
+        p.write.handle = handle;
+        p.write.need_rsp = op == ATT_WRITE_REQ;
+        p.write.len = (uint16_t)vlen;
+        p.write.value = (uint8_t*)value;
+        cb->onWrite(c, &p);
+      }
+    } else {
+      descr->setValue(value, vlen);
+    }
+    if (op == ATT_WRITE_REQ) {
+      Lock l;
+      send(link, std::string(1, (char)ATT_WRITE_RSP));
+    }
+    return;
+  }
+
+  if (op != ATT_WRITE_CMD && op != ATT_NOTIFY) sendError(link, op, 0, ESP_GATT_INVALID_PDU);
+}
+
+// ============================================================================
+// Inbox: Client PDUs
+// ============================================================================
+
+/** @brief Finish a search: one SEARCH_RES per matching service, then SEARCH_CMPL. */
+static void searchDone(int16_t id) {
+  std::vector<Entry> services;
+  {
+    Lock l;
+    Link* link = linkById(id);
+    if (!link) return;
+    for (const Entry& e : link->db) {
+      if (e.kind == ENTRY_SERVICE && (link->searchAll || uuidEqual(e.uuid, link->searchFilter))) {
+        services.push_back(e);
+      }
+    }
+  }
+  for (const Entry& e : services) {
+    esp_ble_gattc_cb_param_t p = {};
+    p.search_res.conn_id = (uint16_t)id;
+    p.search_res.start_handle = e.handle;
+    p.search_res.end_handle = e.aux;
+    p.search_res.srvc_id.uuid = e.uuid;
+    p.search_res.is_primary = true;
+    gattcEvent(ESP_GATTC_SEARCH_RES_EVT, &p);
+  }
+  esp_ble_gattc_cb_param_t p = {};
+  p.search_cmpl.status = ESP_GATT_OK;
+  p.search_cmpl.conn_id = (uint16_t)id;
+  gattcEvent(ESP_GATTC_SEARCH_CMPL_EVT, &p);
+}
+
+/** @brief A response or notification from a peripheral, to our client. */
+static void clientPdu(Link& link, const uint8_t* d, size_t len) {
+  uint8_t op = d[0];
+  uint16_t conn = (uint16_t)link.id;
+
+  if (op == ATT_NOTIFY && len >= 3) {
+    uint16_t handle = get16(d + 1);
+    {
+      Lock l;
+      if (!link.notify.count(handle)) return;
+    }
+    esp_ble_gattc_cb_param_t p = {};
+    p.notify.conn_id = conn;
+    memcpy(p.notify.remote_bda, link.peer, 6);
+    p.notify.handle = handle;
+    p.notify.value_len = (uint16_t)(len - 3);
+    p.notify.value = (uint8_t*)d + 3;
+    p.notify.is_notify = true;
+    gattcEvent(ESP_GATTC_NOTIFY_EVT, &p);
+    return;
+  }
+
+  if (op == RIG_PAIR_RSP && len >= 26) {
+    esp_ble_bond_dev_t bond = {};
+    memcpy(bond.bd_addr, d + 19, 6);
+    bond.bond_key.key_mask = d[2];
+    for (int i = 0; i < 16; i++) bond.bond_key.pid_key.irk[i] = d[3 + 15 - i];   // stored LSB first
+    bond.bond_key.pid_key.addr_type = (esp_ble_addr_type_t)d[18];
+    memcpy(bond.bond_key.pid_key.static_addr, d + 19, 6);
+    bool ok = d[1] == ESP_BT_STATUS_SUCCESS;
+    if (ok) {
+      Lock l;
+      link.encrypted = true;
+    }
+    if (ok && (gAuthReq & ESP_LE_AUTH_BOND)) {
+      Lock l;
+      bool replaced = false;
+      for (auto& b : gBonds) {
+        if (memcmp(b.bd_addr, bond.bd_addr, 6) == 0) {
+          b = bond;
+          replaced = true;
+        }
+      }
+      if (!replaced) gBonds.push_back(bond);
+    }
+    esp_ble_gap_cb_param_t p = {};
+    memcpy(p.ble_security.auth_cmpl.bd_addr, link.peer, 6);
+    p.ble_security.auth_cmpl.key_present = ok;
+    p.ble_security.auth_cmpl.success = ok;
+    p.ble_security.auth_cmpl.fail_reason = ok ? 0 : d[1];
+    p.ble_security.auth_cmpl.addr_type = (esp_ble_addr_type_t)link.peerType;
+    p.ble_security.auth_cmpl.auth_mode = gAuthReq;
+    gapEvent(ESP_GAP_BLE_AUTH_CMPL_EVT, &p);
+    return;
+  }
+
+  Pending req;
+  {
+    Lock l;
+    if (link.pending.empty()) return;   // unsolicited response
+    req = link.pending.front();
+    link.pending.pop_front();
+  }
+  uint8_t status = ESP_GATT_OK;
+  if (op == ATT_ERROR) status = len >= 5 ? d[4] : (uint8_t)ESP_GATT_ERROR;
+
+  switch (req.opcode) {
+    case ATT_MTU_REQ: {
+      esp_ble_gattc_cb_param_t p = {};
+      p.cfg_mtu.status = (esp_gatt_status_t)status;
+      p.cfg_mtu.conn_id = conn;
+      {
+        Lock l;
+        if (status == ESP_GATT_OK && len >= 3) {
+          uint16_t peer = get16(d + 1);
+          link.mtu = peer < gLocalMtu ? peer : gLocalMtu;
+        }
+        p.cfg_mtu.mtu = link.mtu;
+      }
+      gattcEvent(ESP_GATTC_CFG_MTU_EVT, &p);
+      break;
+    }
+    case RIG_DISC_REQ: {
+      if (status != ESP_GATT_OK || len < 5) {
+        esp_ble_gattc_cb_param_t p = {};
+        p.search_cmpl.status = (esp_gatt_status_t)(status ? status : (uint8_t)ESP_GATT_ERROR);
+        p.search_cmpl.conn_id = conn;
+        gattcEvent(ESP_GATTC_SEARCH_CMPL_EVT, &p);
+        break;
+      }
+      uint16_t total = get16(d + 1);
+      uint16_t index = get16(d + 3);
+      bool more;
+      {
+        Lock l;
+        if (index < total && len >= 11) {
+          Entry e = {};
+          e.kind = d[5];
+          e.handle = get16(d + 6);
+          e.aux = get16(d + 8);
+          e.uuid.len = d[10];
+          if (e.uuid.len <= 16 && len >= 11u + e.uuid.len) memcpy(&e.uuid.uuid, d + 11, e.uuid.len);
+          link.db.push_back(e);
+        }
+        more = index + 1 < total;
+        if (more) {
+          std::string pdu(1, (char)RIG_DISC_REQ);
+          put16(pdu, (uint16_t)(index + 1));
+          request(conn, pdu, 0, false);
+        }
+      }
+      if (!more) searchDone(link.id);
+      break;
+    }
+    case ATT_READ_REQ: {
+      esp_ble_gattc_cb_param_t p = {};
+      p.read.status = (esp_gatt_status_t)status;
+      p.read.conn_id = conn;
+      p.read.handle = req.handle;
+      if (status == ESP_GATT_OK) {
+        p.read.value = (uint8_t*)d + 1;
+        p.read.value_len = (uint16_t)(len - 1);
+      }
+      gattcEvent(req.descr ? ESP_GATTC_READ_DESCR_EVT : ESP_GATTC_READ_CHAR_EVT, &p);
+      break;
+    }
+    case ATT_WRITE_REQ: {
+      esp_ble_gattc_cb_param_t p = {};
+      p.write.status = (esp_gatt_status_t)status;
+      p.write.conn_id = conn;
+      p.write.handle = req.handle;
+      gattcEvent(req.descr ? ESP_GATTC_WRITE_DESCR_EVT : ESP_GATTC_WRITE_CHAR_EVT, &p);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// ============================================================================
+// Inbox
+// ============================================================================
+
+void rigBleInbox(const RigMsg* m) {
+  {
+    Lock l;
+    if (!gInit) return;
+  }
+  switch (m->type) {
+    case RIG_MSG_ADV_REPORT: {
+      BLEScan* scan;
+      {
+        Lock l;
+        scan = gScan;
+      }
+      if (scan) scan->onReport(m->addr, m->addrType, m->rssi, m->data, m->len);
+      break;
+    }
+    case RIG_MSG_LINK_UP:
+      onLinkUp(m);
+      break;
+    case RIG_MSG_LINK_FAIL:
+      onLinkFail(m);
+      break;
+    case RIG_MSG_LINK_DOWN:
+      onLinkDown(m);
+      break;
+    case RIG_MSG_RSSI: {
+      esp_ble_gap_cb_param_t p = {};
+      {
+        Lock l;
+        Link* link = linkById(m->link);
+        if (!link) return;
+        memcpy(p.read_rssi_cmpl.remote_addr, link->peer, 6);
+      }
+      p.read_rssi_cmpl.status = ESP_BT_STATUS_SUCCESS;
+      p.read_rssi_cmpl.rssi = m->rssi;
+      gapEvent(ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT, &p);
+      break;
+    }
+    case RIG_MSG_PDU: {
+      if (m->len == 0) return;
+      Link* link;
+      bool central;
+      {
+        Lock l;
+        link = linkById(m->link);
+        if (!link) return;
+        central = link->central;
+      }
+      // Links are only erased on this thread, so the pointer stays valid
+      if (central) clientPdu(*link, m->data, m->len);
+      else serverPdu(*link, m->data, m->len);
+      break;
+    }
+    default:
+      break;
+  }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file core.h
+ * @brief Internals shared by the files of the host rig's device core.
+ *
+ * The core is compiled into each sketch's shared object, so everything here
+ * exists once per device. Besides the FreeRTOS tasks of the sketch, a device
+ * runs three service threads, each a `RigWorker`:
+ *
+ * - "btu": the BLE host; inbox messages of the radio and every BLE callback
+ *   (Arduino library and Bluedroid events) run here, in order;
+ * - "isr": the interrupt controller; GPIO and hardware-timer handlers, and
+ *   the peripheral simulators that raise interrupt lines;
+ * - "Tmr Svc" and "esp_timer": FreeRTOS software timers and esp_timer
+ *   callbacks.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <functional>
+#include <map>
+#include <vector>
+#include "../world.h"
+
+/** @brief Identifier of this device in the rig. */
+extern int gRigDev;
+
+/** @brief Name of this device (rig console prefix). */
+extern const char* gRigName;
+
+/** @brief Device time (us since the rig started). */
+static inline uint64_t rigNow() { return rigNowUs(); }
+
+/** @brief Sleep until a device time (us). */
+void rigSleepUntil(uint64_t us);
+
+/** @brief Report a formatted line to the rig (actuators, display, notes). */
+void rigNotef(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// ============================================================================
+// Workers
+// ============================================================================
+
+/**
+ * @brief A thread running posted jobs in due-time order.
+ */
+class RigWorker {
+ public:
+  /** @brief Start the thread (idempotent). */
+  void start(const char* name);
+
+  /** @brief Run `fn` as soon as possible, after the jobs already due. */
+  void post(std::function<void()> fn) { postAt(0, std::move(fn)); }
+
+  /** @brief Run `fn` at a device time (us). */
+  void postAt(uint64_t dueUs, std::function<void()> fn);
+
+  /** @brief True on the worker's own thread. */
+  bool onThread() const;
+
+ private:
+  static void* run(void* self);
+
+  struct Job {
+    uint64_t              due;
+    uint64_t              seq;
+    std::function<void()> fn;
+  };
+
+  pthread_mutex_t                  lock_ = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t                   wake_;
+  std::multimap<uint64_t, Job>     jobs_;   /**< By due time; equal times keep post order. */
+  uint64_t                         seq_ = 0;
+  pthread_t                        thread_;
+  bool                             started_ = false;
+  char                             name_[16];
+};
+
+extern RigWorker gBtu;       /**< BLE host thread. */
+extern RigWorker gIsr;       /**< Interrupt thread. */
+extern RigWorker gTmrSvc;    /**< FreeRTOS timer service thread. */
+extern RigWorker gEspTimer;  /**< esp_timer thread. */
+
+// ============================================================================
+// Cross-file Hooks
+// ============================================================================
+
+/** @brief Drive an input pin from outside the chip (scenario, IMU line); interrupt thread. */
+void rigPinDrive(uint8_t pin, uint8_t level);
+
+/** @brief A message of the radio for the BLE host (BLE thread). */
+void rigBleInbox(const RigMsg* msg);
+
+/** @brief A card arrived at the RFID antenna. */
+void rigCardPresent(const uint8_t* uid, size_t len);
+
+/** @brief Start the peripheral simulators (interrupt thread jobs). */
+void rigPeriphBegin(void);
+
+/** @brief Start the ESP-IDF side: heap baseline, data partitions of a partition table CSV (nullptr: none). */
+void rigIdfBegin(const char* partitionsCsv);
+
+/** @brief Start the FreeRTOS scheduler side: timer service, loopTask. */
+void rigRtosBegin(void);
@@ -0,0 +1,134 @@
+/**
+ * @file device.cpp
+ * @brief Boot of a host rig device: service threads and the inbox.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <memory>
+#include "core.h"
+
+int gRigDev = 0;
+const char* gRigName = "esp32";
+
+RigWorker gBtu;
+RigWorker gIsr;
+RigWorker gTmrSvc;
+RigWorker gEspTimer;
+
+// ============================================================================
+// Workers
+// ============================================================================
+
+void RigWorker::start(const char* name) {
+  pthread_mutex_lock(&lock_);
+  if (started_) {
+    pthread_mutex_unlock(&lock_);
+    return;
+  }
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&wake_, &attr);
+  pthread_condattr_destroy(&attr);
+  strncpy(name_, name, sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = '\0';
+  started_ = true;
+  pthread_mutex_unlock(&lock_);
+
+  pthread_create(&thread_, nullptr, run, this);
+  pthread_detach(thread_);
+}
+
+void RigWorker::postAt(uint64_t dueUs, std::function<void()> fn) {
+  pthread_mutex_lock(&lock_);
+  jobs_.emplace(dueUs, Job{ dueUs, seq_++, std::move(fn) });
+  if (started_) pthread_cond_signal(&wake_);
+  pthread_mutex_unlock(&lock_);
+}
+
+bool RigWorker::onThread() const {
+  return started_ && pthread_equal(pthread_self(), thread_);
+}
+
+void* RigWorker::run(void* self) {
+  RigWorker* w = (RigWorker*)self;
+  pthread_setname_np(pthread_self(), w->name_);
+  rigHeapThread(gRigDev);
+  pthread_mutex_lock(&w->lock_);
+  for (;;) {
+    if (w->jobs_.empty()) {
+      pthread_cond_wait(&w->wake_, &w->lock_);
+      continue;
+    }
+    // Device time and CLOCK_MONOTONIC differ by the rig's start; wait on the latter
+    uint64_t now = rigNow();
+    auto it = w->jobs_.begin();
+    if (it->first > now) {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      uint64_t wait = it->first - now;
+      ts.tv_sec += (time_t)(wait / 1000000);
+      ts.tv_nsec += (long)(wait % 1000000) * 1000;
+      if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&w->wake_, &w->lock_, &ts);
+      continue;
+    }
+    std::function<void()> fn = std::move(it->second.fn);
+    w->jobs_.erase(it);
+    pthread_mutex_unlock(&w->lock_);
+    fn();
+    pthread_mutex_lock(&w->lock_);
+  }
+  return nullptr;
+}
+
+// ============================================================================
+// Inbox and Boot
+// ============================================================================
+
+/** @brief Called on the world's thread: copy the message to the thread that owns it. */
+static void inbox(const RigMsg* msg) {
+  if (msg->type == RIG_MSG_GPIO) {
+    uint8_t pin = msg->pin, level = msg->level;
+    gIsr.post([pin, level] { rigPinDrive(pin, level); });
+    return;
+  }
+  if (msg->type == RIG_MSG_CARD) {
+    std::vector<uint8_t> uid(msg->data, msg->data + msg->len);
+    gIsr.post([uid] { rigCardPresent(uid.data(), uid.size()); });
+    return;
+  }
+  // Only the used part of the payload is copied; PDUs are small
+  std::shared_ptr<RigMsg> copy(new RigMsg);
+  memcpy(copy.get(), msg, offsetof(RigMsg, data) + msg->len);
+  gBtu.post([copy] { rigBleInbox(copy.get()); });
+}
+
+/**
+ * @brief Boot the device of this shared object, as the ROM and the Arduino
+ *        core do on reset: partitions, service threads, then setup() and
+ *        loop() on loopTask.
+ *
+ * @param[in] id            Identifier in the rig.
+ * @param[in] name          Console prefix.
+ * @param[in] partitionsCsv Partition table (nullptr: no data partitions).
+ */
+extern "C" void rigDeviceBoot(int id, const char* name, const char* partitionsCsv) {
+  gRigDev = id;
+  gRigName = name;
+  // What the boot allocates belongs to the device; the caller's thread is
+  // handed back to the world at the end
+  rigHeapThread(id);
+  rigIdfBegin(partitionsCsv);
+  rigWorldRegister(id, inbox);
+  gBtu.start("btu");
+  gIsr.start("isr");
+  gEspTimer.start("esp_timer");
+  rigPeriphBegin();
+  rigRtosBegin();
+  rigHeapThread(-1);
+}
@@ -0,0 +1,416 @@
+/**
+ * @file idf.cpp
+ * @brief ESP-IDF services of the host rig: heap figures, flash partitions,
+ *        esp_timer, power management, sleep wake-up sources and the ADC
+ *        oneshot/calibration calls.
+ *
+ * Heap figures are the device's own allocations (the rig's heap accounts,
+ * world.h) against a heap of RIG_HEAP_BYTES. A sanitizer build keeps no
+ * accounts; there the figures come from the process's malloc statistics,
+ * counted from the first device's boot, and each device sees the other's
+ * allocations too.
+ *
+ * Data partitions of the sketch's partition table live in memory, erased
+ * (0xFF); writes can only clear bits, as on NOR flash.
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <vector>
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "core.h"
+
+// ============================================================================
+// Heap
+// ============================================================================
+
+/** @brief Bytes in use when the first device booted (sanitizer builds). */
+static size_t gHeapBaseline = 0;
+static size_t gHeapLowWater = RIG_HEAP_BYTES;
+static pthread_mutex_t gHeapLock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t processUsed(void) {
+  struct mallinfo2 mi = mallinfo2();
+  return mi.uordblks + mi.hblkhd;
+}
+
+/**
+ * @brief Bytes and blocks the device has allocated.
+ */
+static void heapUsed(size_t* bytes, size_t* blocks) {
+  if (rigHeapUsage(gRigDev, bytes, blocks)) return;
+  size_t used = processUsed();
+  *bytes = used > gHeapBaseline ? used - gHeapBaseline : 0;
+  *blocks = mallinfo2().hblks;
+}
+
+static size_t heapFree(void) {
+  size_t mine, blocks;
+  heapUsed(&mine, &blocks);
+  size_t free = mine < RIG_HEAP_BYTES ? RIG_HEAP_BYTES - mine : 0;
+  pthread_mutex_lock(&gHeapLock);
+  if (free < gHeapLowWater) gHeapLowWater = free;
+  pthread_mutex_unlock(&gHeapLock);
+  return free;
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  (void)caps;
+  size_t used, blocks;
+  heapUsed(&used, &blocks);
+  memset(info, 0, sizeof(*info));
+  info->total_free_bytes = heapFree();
+  info->total_allocated_bytes = RIG_HEAP_BYTES - info->total_free_bytes;
+  info->largest_free_block = info->total_free_bytes;
+  info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+  info->allocated_blocks = blocks;
+  info->free_blocks = info->total_free_bytes ? 1 : 0;
+  info->total_blocks = blocks + info->free_blocks;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  return heapFree();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  (void)caps;
+  return heapFree();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  (void)caps;
+  heapFree();
+  pthread_mutex_lock(&gHeapLock);
+  size_t low = gHeapLowWater;
+  pthread_mutex_unlock(&gHeapLock);
+  return low;
+}
+
+// ============================================================================
+// Partitions
+// ============================================================================
+
+struct Partition {
+  esp_partition_t info;
+  uint8_t*        data;   /**< mmap'd, outside the heap figures. */
+};
+
+static std::vector<Partition> gParts;
+
+/** @brief Parse a partition table number (decimal, 0x hex, K/M suffix). */
+static bool parseSize(const char* s, uint32_t* out) {
+  char* end;
+  unsigned long v = strtoul(s, &end, 0);
+  if (end == s) return false;
+  if (*end == 'K' || *end == 'k') v *= 1024;
+  if (*end == 'M' || *end == 'm') v *= 1024 * 1024;
+  *out = (uint32_t)v;
+  return true;
+}
+
+/** @brief Trim spaces in place. */
+static char* trim(char* s) {
+  while (*s == ' ' || *s == '\t') s++;
+  char* e = s + strlen(s);
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '\n')) *--e = 0;
+  return s;
+}
+
+static const struct {
+  const char* name;
+  uint8_t     subtype;
+} kDataSubtypes[] = {
+  { "ota", 0x00 }, { "phy", 0x01 }, { "nvs", 0x02 }, { "coredump", 0x03 },
+  { "nvs_keys", 0x04 }, { "efuse", 0x05 }, { "fat", 0x81 }, { "spiffs", 0x82 },
+};
+
+/**
+ * @brief Load the data partitions of a partition table CSV.
+ */
+static void partitionsLoad(const char* csvPath) {
+  FILE* f = fopen(csvPath, "r");
+  if (!f) {
+    rigNotef("cannot open partition table %s", csvPath);
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char* fields[6] = {};
+    int n = 0;
+    char* p = line;
+    if (*trim(p) == '#' || !*trim(p)) continue;
+    while (n < 6) {
+      fields[n++] = p;
+      char* comma = strchr(p, ',');
+      if (!comma) break;
+      *comma = 0;
+      p = comma + 1;
+    }
+    if (n < 5 || strcmp(trim(fields[1]), "data") != 0) continue;
+
+    Partition part = {};
+    part.info.type = ESP_PARTITION_TYPE_DATA;
+    const char* sub = trim(fields[2]);
+    uint32_t subtype = 0xff;
+    for (const auto& s : kDataSubtypes) {
+      if (strcmp(sub, s.name) == 0) subtype = s.subtype;
+    }
+    if (subtype == 0xff && !parseSize(sub, &subtype)) continue;
+    if (!parseSize(trim(fields[3]), &part.info.address) || !parseSize(trim(fields[4]), &part.info.size)) continue;
+    part.info.subtype = (esp_partition_subtype_t)subtype;
+    part.info.erase_size = 4096;
+    snprintf(part.info.label, sizeof(part.info.label), "%s", trim(fields[0]));
+
+    void* mem = mmap(nullptr, part.info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) continue;
+    part.data = (uint8_t*)mem;
+    memset(part.data, 0xFF, part.info.size);
+    gParts.push_back(part);
+  }
+  fclose(f);
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  for (const Partition& p : gParts) {
+    if (type != ESP_PARTITION_TYPE_ANY && p.info.type != type) continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && p.info.subtype != subtype) continue;
+    if (label && strcmp(label, p.info.label) != 0) continue;
+    return &p.info;
+  }
+  return nullptr;
+}
+
+/** @brief The partition of an info pointer and a checked range of it. */
+static uint8_t* partRange(const esp_partition_t* part, size_t offset, size_t size) {
+  for (Partition& p : gParts) {
+    if (&p.info != part) continue;
+    if (offset > p.info.size || size > p.info.size - offset) return nullptr;
+    return p.data + offset;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+  uint8_t* src = partRange(part, offset, size);
+  if (!src || !dst) return ESP_ERR_INVALID_ARG;
+  memcpy(dst, src, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+  uint8_t* dst = partRange(part, offset, size);
+  if (!dst || !src) return ESP_ERR_INVALID_ARG;
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  for (size_t i = 0; i < size; i++) dst[i] &= s[i];
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+  if (offset % part->erase_size || size % part->erase_size) return ESP_ERR_INVALID_SIZE;
+  uint8_t* dst = partRange(part, offset, size);
+  if (!dst) return ESP_ERR_INVALID_ARG;
+  memset(dst, 0xFF, size);
+  return ESP_OK;
+}
+
+// ============================================================================
+// esp_timer
+// ============================================================================
+
+struct RigEspTimer {
+  esp_timer_create_args_t args;
+  uint64_t                dueUs;
+  uint64_t                periodUs;   /**< 0: one-shot. */
+  uint32_t                gen;
+  bool                    running;
+};
+
+/** @brief Guards every esp_timer. */
+static pthread_mutex_t gEspTimerLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void espTimerFire(RigEspTimer* t, uint32_t gen);
+
+/** @brief Queue the next expiry (lock held). */
+static void espTimerSchedule(RigEspTimer* t) {
+  uint32_t gen = t->gen;
+  gEspTimer.postAt(t->dueUs, [t, gen] { espTimerFire(t, gen); });
+}
+
+static void espTimerFire(RigEspTimer* t, uint32_t gen) {
+  pthread_mutex_lock(&gEspTimerLock);
+  if (t->gen != gen || !t->running) {
+    pthread_mutex_unlock(&gEspTimerLock);
+    return;
+  }
+  if (t->periodUs) {
+    t->dueUs += t->periodUs;
+    uint64_t now = rigNow();
+    if (t->args.skip_unhandled_events && t->dueUs <= now) {
+      // Missed periods are dropped, not run back to back
+      t->dueUs += ((now - t->dueUs) / t->periodUs + 1) * t->periodUs;
+    }
+    espTimerSchedule(t);
+  } else {
+    t->running = false;
+  }
+  esp_timer_cb_t cb = t->args.callback;
+  void* arg = t->args.arg;
+  pthread_mutex_unlock(&gEspTimerLock);
+  cb(arg);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+  RigEspTimer* t = new RigEspTimer();
+  t->args = *args;
+  *out = t;
+  return ESP_OK;
+}
+
+static esp_err_t espTimerStart(esp_timer_handle_t t, uint64_t us, uint64_t periodUs) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  pthread_mutex_lock(&gEspTimerLock);
+  esp_err_t err = ESP_ERR_INVALID_STATE;
+  if (!t->running) {
+    t->running = true;
+    t->gen++;
+    t->periodUs = periodUs;
+    t->dueUs = rigNow() + us;
+    espTimerSchedule(t);
+    err = ESP_OK;
+  }
+  pthread_mutex_unlock(&gEspTimerLock);
+  return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeoutUs) {
+  return espTimerStart(t, timeoutUs, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t periodUs) {
+  if (periodUs == 0) return ESP_ERR_INVALID_ARG;
+  return espTimerStart(t, periodUs, periodUs);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  pthread_mutex_lock(&gEspTimerLock);
+  esp_err_t err = t->running ? ESP_OK : ESP_ERR_INVALID_STATE;
+  t->running = false;
+  t->gen++;
+  pthread_mutex_unlock(&gEspTimerLock);
+  return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+  // Stopped, not freed: an expiry may still be queued on the timer thread
+  if (!t) return ESP_ERR_INVALID_ARG;
+  esp_timer_stop(t);
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void) {
+  return (int64_t)rigNow();
+}
+
+// ============================================================================
+// Power Management and Sleep
+// ============================================================================
+
+struct RigPmLock {
+  esp_pm_lock_type_t type;
+  int                count;
+};
+
+esp_err_t esp_pm_configure(const void* config) {
+  const esp_pm_config_t* cfg = static_cast<const esp_pm_config_t*>(config);
+  if (!cfg || cfg->min_freq_mhz > cfg->max_freq_mhz) return ESP_ERR_INVALID_ARG;
+  // As a build without tickless idle: frequency scaling only
+  if (cfg->light_sleep_enable) return ESP_ERR_NOT_SUPPORTED;
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char* name, esp_pm_lock_handle_t* out) {
+  (void)arg;
+  (void)name;
+  if (!out) return ESP_ERR_INVALID_ARG;
+  *out = new RigPmLock{ type, 0 };
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t lock) {
+  if (!lock) return ESP_ERR_INVALID_ARG;
+  __atomic_add_fetch(&lock->count, 1, __ATOMIC_RELAXED);
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t lock) {
+  if (!lock) return ESP_ERR_INVALID_ARG;
+  if (__atomic_sub_fetch(&lock->count, 1, __ATOMIC_RELAXED) < 0) {
+    __atomic_add_fetch(&lock->count, 1, __ATOMIC_RELAXED);
+    return ESP_ERR_INVALID_STATE;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+  (void)timeUs;
+  return ESP_OK;
+}
+
+// ============================================================================
+// ADC
+// ============================================================================
+
+/** @brief Full-scale input at 12 dB attenuation (mV), matching analogRead(). */
+#define RIG_ADC_FULL_MV 3100
+
+esp_err_t adc_oneshot_io_to_channel(int io, adc_unit_t* unit, adc_channel_t* channel) {
+  // ESP32-S3: GPIO1..10 are ADC1 channels 0..9, GPIO11..20 ADC2 channels 0..9
+  if (io < 1 || io > 20) return ESP_ERR_NOT_FOUND;
+  *unit = io <= 10 ? ADC_UNIT_1 : ADC_UNIT_2;
+  *channel = (io - 1) % 10;
+  return ESP_OK;
+}
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t* config,
+                                               adc_cali_handle_t* out) {
+  if (!config || !out) return ESP_ERR_INVALID_ARG;
+  *out = reinterpret_cast<adc_cali_handle_t>(new int(config->atten));
+  return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int* mv) {
+  if (!handle || !mv) return ESP_ERR_INVALID_ARG;
+  *mv = raw * RIG_ADC_FULL_MV / 4095;
+  return ESP_OK;
+}
+
+// ============================================================================
+// Boot
+// ============================================================================
+
+void rigIdfBegin(const char* partitionsCsv) {
+  pthread_mutex_lock(&gHeapLock);
+  static bool baselined = false;
+  if (!baselined) {
+    gHeapBaseline = processUsed();
+    baselined = true;
+  }
+  pthread_mutex_unlock(&gHeapLock);
+  if (partitionsCsv) partitionsLoad(partitionsCsv);
+}
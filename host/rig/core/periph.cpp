@@ -0,0 +1,462 @@
+/**
+ * @file periph.cpp
+ * @brief Board peripherals of the host rig: the I2C bus with an MPU-6500,
+ *        the LCD, the RC522 reader, SPI and the NVS store.
+ *
+ * The MPU-6500 is simulated at register level, as IMU.cpp drives it: accel
+ * and gyro samples follow the scenario's movement flag (1 g at rest; a
+ * 1.8 Hz gait while moving), and wake-on-motion latches INT_STATUS and
+ * raises the interrupt line when the deviation from 1 g exceeds WOM_THR.
+ * Each I2C transaction takes its bus time at 100 kHz, so calibration and
+ * sampling cost what they cost on the tag.
+ *
+ * The LCD and the RC522 are simulated at driver level.
+ */
+
+#include <math.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Wire.h"
+#include "SPI.h"
+#include "Preferences.h"
+#include "LiquidCrystal_I2C.h"
+#include "MFRC522.h"
+#include "core.h"
+
+/** @brief I2C clock of the bus (Hz). */
+#define RIG_I2C_HZ 100000
+
+// ============================================================================
+// MPU-6500
+// ============================================================================
+
+#define RIG_IMU_ADDR     0x68
+#define RIG_IMU_INT_PIN  4
+
+/** @brief Wake-on-motion comparison period (us), the tag's 15.63 Hz LP ODR. */
+#define RIG_IMU_WOM_US   64000
+
+#define IMU_WOM_THR      0x1F
+#define IMU_INT_PIN_CFG  0x37
+#define IMU_INT_ENABLE   0x38
+#define IMU_INT_STATUS   0x3A
+#define IMU_ACCEL_XOUT_H 0x3B
+#define IMU_PWR_MGMT_1   0x6B
+#define IMU_WHO_AM_I     0x75
+
+/** @brief INT_PIN_CFG: any register read clears the latched status. */
+#define IMU_INT_ANYRD_2CLEAR 0x10
+
+/** @brief INT_ENABLE and INT_STATUS: wake on motion. */
+#define IMU_INT_WOM 0x40
+
+/** @brief PWR_MGMT_1: cycle (low-power accel) mode. */
+#define IMU_CYCLE 0x20
+
+static uint8_t gImuRegs[128];
+static pthread_mutex_t gImuLock = PTHREAD_MUTEX_INITIALIZER;
+static std::minstd_rand gImuNoise(4242);
+
+/** @brief Noise of one axis (g or deg/s scale). */
+static float imuNoise(float amplitude) {
+  return amplitude * ((float)(gImuNoise() % 2001) / 1000.0f - 1.0f);
+}
+
+/**
+ * @brief Accel (g) and gyro (deg/s) at a device time (lock held).
+ */
+static void imuSample(uint64_t us, float accel[3], float gyro[3]) {
+  float t = (float)us / 1e6f;
+  if (rigMoving(gRigDev)) {
+    float w = 2.0f * (float)M_PI * 1.8f * t;
+    accel[0] = 0.15f * sinf(w * 0.5f);
+    accel[1] = 0.15f * cosf(w * 0.5f);
+    accel[2] = 1.0f + 0.55f * sinf(w);
+    gyro[0] = 40.0f * sinf(w);
+    gyro[1] = 25.0f * cosf(w);
+    gyro[2] = 10.0f * sinf(w * 0.5f);
+  } else {
+    accel[0] = accel[1] = 0.0f;
+    accel[2] = 1.0f;
+    gyro[0] = gyro[1] = gyro[2] = 0.0f;
+  }
+  for (int i = 0; i < 3; i++) {
+    accel[i] += imuNoise(0.01f);
+    gyro[i] += imuNoise(0.2f);
+  }
+}
+
+static void putBe16(uint8_t* p, float v) {
+  long x = lroundf(v);
+  x = x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+  p[0] = (uint8_t)((uint16_t)x >> 8);
+  p[1] = (uint8_t)x;
+}
+
+/** @brief Refresh the output registers (lock held). */
+static void imuLatchSample(void) {
+  float a[3], g[3];
+  imuSample(rigNow(), a, g);
+  for (int i = 0; i < 3; i++) {
+    putBe16(&gImuRegs[IMU_ACCEL_XOUT_H + 2 * i], a[i] * 16384.0f);
+    putBe16(&gImuRegs[IMU_ACCEL_XOUT_H + 8 + 2 * i], g[i] * 131.0f);
+  }
+  putBe16(&gImuRegs[IMU_ACCEL_XOUT_H + 6], (30.0f - 21.0f) * 333.87f);
+}
+
+/** @brief Clear the latched status and release the line (lock held). */
+static void imuClearLatch(void) {
+  if (!(gImuRegs[IMU_INT_STATUS] & IMU_INT_WOM)) return;
+  gImuRegs[IMU_INT_STATUS] = 0;
+  gIsr.post([] { rigPinDrive(RIG_IMU_INT_PIN, LOW); });
+}
+
+/**
+ * @brief Wake-on-motion comparator, every RIG_IMU_WOM_US (interrupt thread).
+ */
+static void imuWomTick(uint64_t due) {
+  pthread_mutex_lock(&gImuLock);
+  bool armed = (gImuRegs[IMU_PWR_MGMT_1] & IMU_CYCLE) && (gImuRegs[IMU_INT_ENABLE] & IMU_INT_WOM);
+  bool raise = false;
+  if (armed && !(gImuRegs[IMU_INT_STATUS] & IMU_INT_WOM)) {
+    float a[3], g[3];
+    imuSample(rigNow(), a, g);
+    float thr = gImuRegs[IMU_WOM_THR] * 0.004f;   // 4 mg per LSB
+    float dev = fmaxf(fmaxf(fabsf(a[0]), fabsf(a[1])), fabsf(a[2] - 1.0f));
+    if (dev > thr) {
+      gImuRegs[IMU_INT_STATUS] |= IMU_INT_WOM;
+      raise = true;
+    }
+  }
+  pthread_mutex_unlock(&gImuLock);
+  if (raise) rigPinDrive(RIG_IMU_INT_PIN, HIGH);
+  gIsr.postAt(due + RIG_IMU_WOM_US, [due] { imuWomTick(due + RIG_IMU_WOM_US); });
+}
+
+static void imuReset(void) {
+  memset(gImuRegs, 0, sizeof(gImuRegs));
+  gImuRegs[IMU_PWR_MGMT_1] = 0x40;   // sleep
+  gImuRegs[IMU_WHO_AM_I] = 0x70;
+}
+
+/** @brief A register write transaction: start register, then data. */
+static void imuWrite(const uint8_t* data, size_t len) {
+  if (len < 1) return;
+  pthread_mutex_lock(&gImuLock);
+  uint8_t reg = data[0];
+  for (size_t i = 1; i < len; i++, reg++) {
+    reg &= 0x7F;
+    if (reg == IMU_PWR_MGMT_1 && (data[i] & 0x80)) {
+      imuReset();
+      continue;
+    }
+    if (reg == IMU_INT_STATUS || reg == IMU_WHO_AM_I) continue;   // read-only
+    gImuRegs[reg] = data[i];
+  }
+  pthread_mutex_unlock(&gImuLock);
+}
+
+/** @brief A read from the register pointer left by the last write. */
+static void imuRead(uint8_t reg, uint8_t* out, size_t len) {
+  pthread_mutex_lock(&gImuLock);
+  if (reg <= IMU_ACCEL_XOUT_H + 13 && reg + len > IMU_ACCEL_XOUT_H) imuLatchSample();
+  for (size_t i = 0; i < len; i++) out[i] = gImuRegs[(reg + i) & 0x7F];
+  bool clear = (gImuRegs[IMU_INT_PIN_CFG] & IMU_INT_ANYRD_2CLEAR) ||
+               (reg <= IMU_INT_STATUS && reg + len > IMU_INT_STATUS);
+  if (clear) imuClearLatch();
+  pthread_mutex_unlock(&gImuLock);
+}
+
+// ============================================================================
+// I2C
+// ============================================================================
+
+TwoWire Wire;
+
+/** @brief Register pointer of the IMU, set by the last write. */
+static uint8_t gImuPointer = 0;
+
+/** @brief Hold the bus for a transaction of `bytes` data bytes plus the address. */
+static void busTime(size_t bytes) {
+  delayMicroseconds((uint32_t)((bytes + 1) * 9 * 1000000ull / RIG_I2C_HZ));
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddr_ = address;
+  txLen_ = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen_ >= sizeof(txBuf_)) return 0;
+  txBuf_[txLen_++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  busTime(txLen_);
+  if (txAddr_ != RIG_IMU_ADDR) return 2;   // address NACK
+  if (txLen_ >= 1) gImuPointer = txBuf_[0];
+  imuWrite(txBuf_, txLen_);
+  return 0;
+}
+
+size_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+  (void)sendStop;
+  rxLen_ = rxPos_ = 0;
+  if (quantity <= 0) return 0;
+  size_t n = (size_t)quantity < sizeof(rxBuf_) ? (size_t)quantity : sizeof(rxBuf_);
+  busTime(n);
+  if (address != RIG_IMU_ADDR) return 0;
+  imuRead(gImuPointer, rxBuf_, n);
+  gImuPointer = (uint8_t)(gImuPointer + n);
+  rxLen_ = n;
+  return n;
+}
+
+// ============================================================================
+// SPI
+// ============================================================================
+
+SPIClass SPI;
+
+// ============================================================================
+// Preferences
+// ============================================================================
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+static std::map<std::string, Namespace> gNvs;
+static pthread_mutex_t gNvsLock = PTHREAD_MUTEX_INITIALIZER;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  if (!name || ns_) return false;
+  pthread_mutex_lock(&gNvsLock);
+  auto it = gNvs.find(name);
+  if (it == gNvs.end() && !readOnly) it = gNvs.emplace(name, Namespace()).first;
+  ns_ = it == gNvs.end() ? nullptr : &it->second;
+  pthread_mutex_unlock(&gNvsLock);
+  readOnly_ = readOnly;
+  return ns_ != nullptr;
+}
+
+void Preferences::end(void) {
+  ns_ = nullptr;
+}
+
+bool Preferences::clear(void) {
+  if (!ns_ || readOnly_) return false;
+  pthread_mutex_lock(&gNvsLock);
+  static_cast<Namespace*>(ns_)->clear();
+  pthread_mutex_unlock(&gNvsLock);
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!ns_ || readOnly_ || !key) return false;
+  pthread_mutex_lock(&gNvsLock);
+  bool ok = static_cast<Namespace*>(ns_)->erase(key) > 0;
+  pthread_mutex_unlock(&gNvsLock);
+  return ok;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!ns_ || !key) return false;
+  pthread_mutex_lock(&gNvsLock);
+  bool ok = static_cast<Namespace*>(ns_)->count(key) > 0;
+  pthread_mutex_unlock(&gNvsLock);
+  return ok;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!ns_ || readOnly_ || !key || (!value && len)) return 0;
+  pthread_mutex_lock(&gNvsLock);
+  const uint8_t* p = static_cast<const uint8_t*>(value);
+  (*static_cast<Namespace*>(ns_))[key].assign(p, p + len);
+  pthread_mutex_unlock(&gNvsLock);
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!ns_ || !key) return 0;
+  pthread_mutex_lock(&gNvsLock);
+  Namespace& ns = *static_cast<Namespace*>(ns_);
+  auto it = ns.find(key);
+  size_t len = it == ns.end() ? 0 : it->second.size();
+  pthread_mutex_unlock(&gNvsLock);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (!ns_ || !key || !buf) return 0;
+  pthread_mutex_lock(&gNvsLock);
+  Namespace& ns = *static_cast<Namespace*>(ns_);
+  auto it = ns.find(key);
+  size_t len = 0;
+  if (it != ns.end() && it->second.size() <= maxLen) {
+    len = it->second.size();
+    memcpy(buf, it->second.data(), len);
+  }
+  pthread_mutex_unlock(&gNvsLock);
+  return len;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t v;
+  if (getBytesLength(key) != sizeof(v)) return defaultValue;
+  return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+// ============================================================================
+// LCD
+// ============================================================================
+
+/** @brief Guards the display contents against the deferred report. */
+static pthread_mutex_t gLcdLock = PTHREAD_MUTEX_INITIALIZER;
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows)
+    : addr_(addr), cols_(cols > 20 ? 20 : cols), rows_(rows > 4 ? 4 : rows) {
+  memset(text_, ' ', sizeof(text_));
+  for (auto& row : text_) row[20] = 0;
+}
+
+void LiquidCrystal_I2C::init(void) {
+  clear();
+}
+
+void LiquidCrystal_I2C::clear(void) {
+  pthread_mutex_lock(&gLcdLock);
+  for (auto& row : text_) memset(row, ' ', 20);
+  col_ = row_ = 0;
+  pthread_mutex_unlock(&gLcdLock);
+  busTime(4);
+  changed();
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  col_ = col;
+  row_ = row < rows_ ? row : rows_ - 1;
+}
+
+void LiquidCrystal_I2C::backlight(void) {
+  light_ = true;
+  changed();
+}
+
+void LiquidCrystal_I2C::noBacklight(void) {
+  light_ = false;
+  changed();
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+  busTime(4);   // one character: four nibble writes through the expander
+  pthread_mutex_lock(&gLcdLock);
+  if (col_ < cols_) text_[row_][col_] = (char)c;
+  col_++;
+  pthread_mutex_unlock(&gLcdLock);
+  changed();
+  return 1;
+}
+
+/**
+ * @brief Report the display, at most every RIG_LCD_NOTE_MS; later changes
+ *        within the gap are reported together at its end.
+ */
+void LiquidCrystal_I2C::changed(void) {
+  pthread_mutex_lock(&gLcdLock);
+  if (flushPending_) {
+    pthread_mutex_unlock(&gLcdLock);
+    return;
+  }
+  flushPending_ = true;
+  uint32_t now = millis();
+  uint32_t at = now - notedMs_ >= RIG_LCD_NOTE_MS ? now : notedMs_ + RIG_LCD_NOTE_MS;
+  pthread_mutex_unlock(&gLcdLock);
+
+  // Reported from the interrupt thread after the current print completes
+  gIsr.postAt((uint64_t)at * 1000 + 2000, [this] {
+    char rows[4][21];
+    pthread_mutex_lock(&gLcdLock);
+    flushPending_ = false;
+    notedMs_ = millis();
+    memcpy(rows, text_, sizeof(rows));
+    bool light = light_;
+    pthread_mutex_unlock(&gLcdLock);
+    for (auto& row : rows) row[cols_] = 0;
+    rigNotef("lcd%s |%s|%s|", light ? "" : " (dark)", rows[0], rows_ > 1 ? rows[1] : "");
+  });
+}
+
+// ============================================================================
+// RC522
+// ============================================================================
+
+static uint8_t gCardUid[10];
+static uint8_t gCardLen = 0;   /**< 0: no card waiting. */
+static pthread_mutex_t gCardLock = PTHREAD_MUTEX_INITIALIZER;
+
+void rigCardPresent(const uint8_t* uid, size_t len) {
+  pthread_mutex_lock(&gCardLock);
+  gCardLen = (uint8_t)(len < sizeof(gCardUid) ? len : sizeof(gCardUid));
+  memcpy(gCardUid, uid, gCardLen);
+  pthread_mutex_unlock(&gCardLock);
+}
+
+void MFRC522::PCD_Init(void) {
+  ready_ = true;
+}
+
+void MFRC522::PCD_Reset(void) {
+  ready_ = false;
+  delay(50);   // oscillator start-up
+}
+
+void MFRC522::PCD_DumpVersionToSerial(void) {
+  Serial.println(ready_ ? "Firmware Version: 0x92 = v2.0" : "WARNING: Communication failure, is the MFRC522 properly connected?");
+}
+
+bool MFRC522::PICC_IsNewCardPresent(void) {
+  if (!ready_) return false;
+  pthread_mutex_lock(&gCardLock);
+  bool present = gCardLen > 0;
+  pthread_mutex_unlock(&gCardLock);
+  return present;
+}
+
+bool MFRC522::PICC_ReadCardSerial(void) {
+  pthread_mutex_lock(&gCardLock);
+  bool ok = gCardLen > 0;
+  if (ok) {
+    uid.size = gCardLen;
+    memcpy(uid.uidByte, gCardUid, gCardLen);
+    uid.sak = 0x00;   // MIFARE Ultralight
+    gCardLen = 0;     // read once, then halted
+  }
+  pthread_mutex_unlock(&gCardLock);
+  return ok;
+}
+
+// ============================================================================
+// Boot
+// ============================================================================
+
+void rigPeriphBegin(void) {
+  pthread_mutex_lock(&gImuLock);
+  imuReset();
+  pthread_mutex_unlock(&gImuLock);
+  uint64_t due = rigNow() + RIG_IMU_WOM_US;
+  gIsr.postAt(due, [due] { imuWomTick(due); });
+}
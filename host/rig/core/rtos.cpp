@@ -0,0 +1,542 @@
+/**
+ * @file rtos.cpp
+ * @brief FreeRTOS API of the host rig's device core, on POSIX threads.
+ *
+ * A subset of the FreeRTOS POSIX port's behaviour, enough for the sketches:
+ *
+ * - tasks are threads, created running; they are not preempted by priority
+ *   and may run truly in parallel (the ESP32 has two cores, the host more);
+ * - the tick is 1 ms of the rig clock; `xTaskDelayUntil` sleeps to the next
+ *   deadline and reports a missed one, as the task plan expects;
+ * - queues and semaphores block with timeouts on condition variables, and
+ *   the ISR variants never block;
+ * - software timers run on the "Tmr Svc" thread, reloading from the
+ *   deadline (no drift).
+ *
+ * Control blocks are placed in the caller's static storage when one is
+ * given, so the static RAM budget of the sketches still holds.
+ */
+
+#include <new>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "core.h"
+
+/** @brief Host stack of every task; the requested depth only sizes the ESP32 stack. */
+#ifndef RIG_TASK_STACK
+#define RIG_TASK_STACK (512 * 1024)
+#endif
+
+// ============================================================================
+// Clock
+// ============================================================================
+
+void rigSleepUntil(uint64_t us) {
+  for (;;) {
+    uint64_t now = rigNow();
+    if (now >= us) return;
+    uint64_t left = us - now;
+    struct timespec ts = { (time_t)(left / 1000000), (long)(left % 1000000) * 1000 };
+    nanosleep(&ts, nullptr);
+  }
+}
+
+/** @brief Absolute CLOCK_MONOTONIC time `ticks` from now, for timed waits. */
+static struct timespec deadlineIn(TickType_t ticks) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)pdTICKS_TO_MS(ticks) * 1000000ull;
+  ts.tv_sec += (time_t)(ns / 1000000000ull);
+  ts.tv_nsec = (long)(ns % 1000000000ull);
+  return ts;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(rigNow() / (1000000 / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR(void) {
+  return xTaskGetTickCount();
+}
+
+// ============================================================================
+// Tasks
+// ============================================================================
+
+struct RigTask {
+  pthread_t      thread;
+  TaskFunction_t fn;
+  void*          param;
+  UBaseType_t    prio;
+  BaseType_t     core;
+  uint32_t       stackDepth;
+  bool           dynamic;
+  char           name[16];
+};
+static_assert(sizeof(RigTask) <= sizeof(StaticTask_t), "StaticTask_t too small for RigTask");
+
+/** @brief Task of the calling thread (nullptr on service threads). */
+static thread_local RigTask* tCurrent = nullptr;
+
+static void* taskMain(void* arg) {
+  RigTask* t = static_cast<RigTask*>(arg);
+  tCurrent = t;
+  rigHeapThread(gRigDev);
+  pthread_setname_np(pthread_self(), t->name);
+  t->fn(t->param);
+  // A FreeRTOS task must not return; report it and end the thread
+  rigNotef("task %s returned", t->name);
+  return nullptr;
+}
+
+static TaskHandle_t taskStart(RigTask* t, TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                              UBaseType_t prio, BaseType_t core) {
+  t->fn = fn;
+  t->param = param;
+  t->prio = prio;
+  t->core = core;
+  t->stackDepth = stackDepth;
+  snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, RIG_TASK_STACK);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int err = pthread_create(&t->thread, &attr, taskMain, t);
+  pthread_attr_destroy(&attr);
+  return err == 0 ? t : nullptr;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                                           UBaseType_t prio, StackType_t* stack, StaticTask_t* tcb,
+                                           BaseType_t core) {
+  (void)stack;
+  if (!tcb) return nullptr;
+  RigTask* t = new (tcb) RigTask();
+  t->dynamic = false;
+  return taskStart(t, fn, name, stackDepth, param, prio, core);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t prio, TaskHandle_t* created, BaseType_t core) {
+  RigTask* t = new RigTask();
+  t->dynamic = true;
+  TaskHandle_t h = taskStart(t, fn, name, stackDepth, param, prio, core);
+  if (!h) delete t;
+  if (created) *created = h;
+  return h ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param, UBaseType_t prio,
+                       TaskHandle_t* created) {
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, param, prio, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Only self-deletion is supported: a host thread cannot be stopped from outside
+  if (task && task != tCurrent) {
+    rigNotef("vTaskDelete(%s) from another task is not supported", task->name);
+    return;
+  }
+  pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    sched_yield();
+    return;
+  }
+  rigSleepUntil(rigNow() + (uint64_t)pdTICKS_TO_MS(ticks) * 1000);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+  TickType_t now = xTaskGetTickCount();
+  TickType_t target = *previousWake + increment;
+  // Due unless the deadline has passed (wrap-safe, as in FreeRTOS)
+  bool due = (TickType_t)(now - *previousWake) < increment;
+  *previousWake = target;
+  if (!due) return pdFALSE;
+  uint64_t base = rigNow() / 1000;
+  rigSleepUntil((base + (TickType_t)(target - now)) * 1000);
+  return pdTRUE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return tCurrent;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+  if (!task) task = tCurrent;
+  return task ? task->name : "";
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+  if (!task) task = tCurrent;
+  return task ? task->prio : 0;
+}
+
+BaseType_t xPortGetCoreID(void) {
+  return tCurrent && tCurrent->core != tskNO_AFFINITY ? tCurrent->core : 0;
+}
+
+// ============================================================================
+// Queues
+// ============================================================================
+
+struct RigQueue {
+  pthread_mutex_t lock;
+  pthread_cond_t  notEmpty;
+  pthread_cond_t  notFull;
+  uint8_t*        storage;    /**< LEN items, nullptr for semaphores. */
+  UBaseType_t     length;
+  UBaseType_t     itemSize;
+  UBaseType_t     head;
+  UBaseType_t     count;
+  bool            dynamic;
+};
+static_assert(sizeof(RigQueue) <= sizeof(StaticQueue_t), "StaticQueue_t too small for RigQueue");
+
+static RigQueue* queueInit(RigQueue* q, UBaseType_t length, UBaseType_t itemSize, uint8_t* storage) {
+  pthread_condattr_t ca;
+  pthread_condattr_init(&ca);
+  pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+  pthread_mutex_init(&q->lock, nullptr);
+  pthread_cond_init(&q->notEmpty, &ca);
+  pthread_cond_init(&q->notFull, &ca);
+  pthread_condattr_destroy(&ca);
+  q->storage = itemSize ? storage : nullptr;
+  q->length = length;
+  q->itemSize = itemSize;
+  q->head = 0;
+  q->count = 0;
+  return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* cb) {
+  if (!cb || length == 0 || (itemSize && !storage)) return nullptr;
+  RigQueue* q = new (cb) RigQueue();
+  q->dynamic = false;
+  return queueInit(q, length, itemSize, storage);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  if (length == 0) return nullptr;
+  RigQueue* q = new RigQueue();
+  q->dynamic = true;
+  return queueInit(q, length, itemSize, itemSize ? new uint8_t[(size_t)length * itemSize] : nullptr);
+}
+
+void vQueueDelete(QueueHandle_t q) {
+  if (!q) return;
+  pthread_cond_destroy(&q->notEmpty);
+  pthread_cond_destroy(&q->notFull);
+  pthread_mutex_destroy(&q->lock);
+  if (q->dynamic) {
+    delete[] q->storage;
+    delete q;
+  }
+}
+
+/**
+ * @brief Wait on a condition until `ready` or the timeout (lock held).
+ */
+template <typename Ready>
+static bool queueWait(QueueHandle_t q, pthread_cond_t* cond, TickType_t wait, Ready ready) {
+  if (ready()) return true;
+  if (wait == 0) return false;
+  if (wait == portMAX_DELAY) {
+    while (!ready()) pthread_cond_wait(cond, &q->lock);
+    return true;
+  }
+  struct timespec until = deadlineIn(wait);
+  while (!ready()) {
+    if (pthread_cond_timedwait(cond, &q->lock, &until) == ETIMEDOUT) return ready();
+  }
+  return true;
+}
+
+static BaseType_t queuePut(QueueHandle_t q, const void* item, TickType_t wait, bool front, bool overwrite) {
+  if (!q) return errQUEUE_FULL;
+  pthread_mutex_lock(&q->lock);
+  if (overwrite && q->count == q->length) {
+    q->count--;   // a mailbox: replace the item
+  }
+  if (!queueWait(q, &q->notFull, wait, [q] { return q->count < q->length; })) {
+    pthread_mutex_unlock(&q->lock);
+    return errQUEUE_FULL;
+  }
+  if (q->itemSize) {
+    UBaseType_t slot;
+    if (front) {
+      q->head = (q->head + q->length - 1) % q->length;
+      slot = q->head;
+    } else {
+      slot = (q->head + q->count) % q->length;
+    }
+    memcpy(q->storage + (size_t)slot * q->itemSize, item, q->itemSize);
+  }
+  q->count++;
+  pthread_cond_signal(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+  return pdPASS;
+}
+
+static BaseType_t queueGet(QueueHandle_t q, void* item, TickType_t wait, bool remove) {
+  if (!q) return pdFALSE;
+  pthread_mutex_lock(&q->lock);
+  if (!queueWait(q, &q->notEmpty, wait, [q] { return q->count > 0; })) {
+    pthread_mutex_unlock(&q->lock);
+    return pdFALSE;
+  }
+  if (q->itemSize && item) memcpy(item, q->storage + (size_t)q->head * q->itemSize, q->itemSize);
+  if (remove) {
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_signal(&q->notFull);
+  } else {
+    pthread_cond_signal(&q->notEmpty);   // the item stays: let another waiter see it
+  }
+  pthread_mutex_unlock(&q->lock);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) {
+  return queuePut(q, item, wait, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t wait) {
+  return queuePut(q, item, wait, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item) {
+  return queuePut(q, item, 0, false, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) {
+  return queueGet(q, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t wait) {
+  return queueGet(q, item, wait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  if (!q) return pdFAIL;
+  pthread_mutex_lock(&q->lock);
+  q->head = 0;
+  q->count = 0;
+  pthread_cond_broadcast(&q->notFull);
+  pthread_mutex_unlock(&q->lock);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  if (!q) return 0;
+  pthread_mutex_lock(&q->lock);
+  UBaseType_t n = q->count;
+  pthread_mutex_unlock(&q->lock);
+  return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+  if (!q) return 0;
+  pthread_mutex_lock(&q->lock);
+  UBaseType_t n = q->length - q->count;
+  pthread_mutex_unlock(&q->lock);
+  return n;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return queuePut(q, item, 0, false, false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t q, void* item, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return queueGet(q, item, 0, true);
+}
+
+// ============================================================================
+// Semaphores
+// ============================================================================
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* cb) {
+  return xQueueCreateStatic(1, 0, nullptr, cb);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+  SemaphoreHandle_t s = xQueueCreate(max, 0);
+  if (s) s->count = initial < max ? initial : max;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* cb) {
+  SemaphoreHandle_t s = xQueueCreateStatic(1, 0, nullptr, cb);
+  if (s) s->count = 1;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  SemaphoreHandle_t s = xQueueCreate(1, 0);
+  if (s) s->count = 1;
+  return s;
+}
+
+// ============================================================================
+// Software Timers
+// ============================================================================
+
+struct RigTimer {
+  TimerCallbackFunction_t cb;
+  void*                   id;
+  uint64_t                dueUs;
+  uint32_t                gen;       /**< Bumped by every command; stale expiries are dropped. */
+  TickType_t              period;
+  bool                    autoReload;
+  bool                    active;
+  bool                    dynamic;
+  char                    name[16];
+};
+static_assert(sizeof(RigTimer) <= sizeof(StaticTimer_t), "StaticTimer_t too small for RigTimer");
+
+/** @brief Guards every timer's state. */
+static pthread_mutex_t gTimerLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void timerExpire(RigTimer* t, uint32_t gen);
+
+/** @brief Schedule the next expiry (lock held). */
+static void timerSchedule(RigTimer* t) {
+  uint32_t gen = t->gen;
+  gTmrSvc.postAt(t->dueUs, [t, gen] { timerExpire(t, gen); });
+}
+
+static void timerExpire(RigTimer* t, uint32_t gen) {
+  pthread_mutex_lock(&gTimerLock);
+  if (t->gen != gen || !t->active) {
+    pthread_mutex_unlock(&gTimerLock);
+    return;
+  }
+  if (t->autoReload) {
+    t->dueUs += (uint64_t)pdTICKS_TO_MS(t->period) * 1000;
+    timerSchedule(t);
+  } else {
+    t->active = false;
+  }
+  pthread_mutex_unlock(&gTimerLock);
+  t->cb(t);
+}
+
+static TimerHandle_t timerInit(RigTimer* t, const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                               TimerCallbackFunction_t cb) {
+  t->cb = cb;
+  t->id = id;
+  t->period = period ? period : 1;
+  t->autoReload = autoReload != pdFALSE;
+  t->active = false;
+  t->gen = 0;
+  snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+  return t;
+}
+
+TimerHandle_t xTimerCreateStatic(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                                 TimerCallbackFunction_t cb, StaticTimer_t* buffer) {
+  if (!buffer || !cb) return nullptr;
+  RigTimer* t = new (buffer) RigTimer();
+  t->dynamic = false;
+  return timerInit(t, name, period, autoReload, id, cb);
+}
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                           TimerCallbackFunction_t cb) {
+  if (!cb) return nullptr;
+  RigTimer* t = new RigTimer();
+  t->dynamic = true;
+  return timerInit(t, name, period, autoReload, id, cb);
+}
+
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t wait) {
+  (void)wait;
+  if (!t) return pdFAIL;
+  pthread_mutex_lock(&gTimerLock);
+  t->gen++;
+  t->active = true;
+  t->dueUs = rigNow() + (uint64_t)pdTICKS_TO_MS(t->period) * 1000;
+  timerSchedule(t);
+  pthread_mutex_unlock(&gTimerLock);
+  return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t t, TickType_t wait) {
+  return xTimerStart(t, wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t wait) {
+  (void)wait;
+  if (!t) return pdFAIL;
+  pthread_mutex_lock(&gTimerLock);
+  t->gen++;
+  t->active = false;
+  pthread_mutex_unlock(&gTimerLock);
+  return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t wait) {
+  if (!t) return pdFAIL;
+  pthread_mutex_lock(&gTimerLock);
+  t->period = period ? period : 1;
+  pthread_mutex_unlock(&gTimerLock);
+  return xTimerStart(t, wait);   // as in FreeRTOS, changing the period starts the timer
+}
+
+BaseType_t xTimerDelete(TimerHandle_t t, TickType_t wait) {
+  // Stopped, not freed: an expiry may still be queued on the service thread
+  return xTimerStop(t, wait);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t t) {
+  if (!t) return pdFALSE;
+  pthread_mutex_lock(&gTimerLock);
+  bool active = t->active;
+  pthread_mutex_unlock(&gTimerLock);
+  return active ? pdTRUE : pdFALSE;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t t) {
+  return t ? t->id : nullptr;
+}
+
+const char* pcTimerGetName(TimerHandle_t t) {
+  return t ? t->name : "";
+}
+
+// ============================================================================
+// Scheduler
+// ============================================================================
+
+void setup(void);
+void loop(void);
+
+/** @brief The Arduino loop task: setup() once, then loop() forever. */
+static void loopTask(void*) {
+  setup();
+  for (;;) loop();
+}
+
+/** @brief Storage of the loop task. */
+static StaticTask_t gLoopTcb;
+
+void rigRtosBegin(void) {
+  gTmrSvc.start("Tmr Svc");
+  xTaskCreateStaticPinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, &gLoopTcb, 1);
+}
@@ -0,0 +1,221 @@
+/**
+ * @file heap.cpp
+ * @brief Per-device heap accounting of the host rig.
+ *
+ * The rig executable replaces malloc and its relatives with thin wrappers
+ * over glibc's allocator that put a small header in front of each block,
+ * naming the account charged for it: the device whose thread allocated it,
+ * or the world. A block stays charged to that account until it is freed,
+ * whichever thread frees it. The cores charge their threads to their device
+ * (rigHeapThread()), so each device's heap figures count its own
+ * allocations only, as on a board, where the process-wide malloc statistics
+ * would mix both sketches, the world and the C library.
+ *
+ * Sanitizers bring their own allocator: in a sanitizer build the wrappers
+ * are left out and rigHeapUsage() reports that no figures are available.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "world.h"
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+
+void rigHeapThread(int dev) {
+  (void)dev;
+}
+
+bool rigHeapUsage(int dev, size_t* bytes, size_t* blocks) {
+  (void)dev;
+  (void)bytes;
+  (void)blocks;
+  return false;
+}
+
+#else
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t align, size_t size);
+void  __libc_free(void* p);
+}
+
+/** @brief Marks a header written by these wrappers. */
+#define HEAP_MAGIC 0x4847
+
+/** @brief Account of everything not charged to a device. */
+#define HEAP_WORLD RIG_MAX_DEVICES
+
+/**
+ * @brief Header in front of each block.
+ */
+struct BlockHeader {
+  uint16_t magic;   /**< HEAP_MAGIC. */
+  uint16_t owner;   /**< Account charged. */
+  uint32_t offset;  /**< Bytes from the start of glibc's block to the caller's. */
+  uint64_t size;    /**< Size asked for. */
+};
+static_assert(sizeof(BlockHeader) == 16, "the header keeps malloc's 16-byte alignment");
+
+/**
+ * @brief Live allocations of one account.
+ */
+struct HeapAccount {
+  std::atomic<size_t> bytes;
+  std::atomic<size_t> blocks;
+};
+
+static HeapAccount gAccounts[RIG_MAX_DEVICES + 1];
+
+/** @brief Account charged for the calling thread's allocations. */
+static thread_local uint16_t tOwner = HEAP_WORLD;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static BlockHeader* headerOf(void* p) {
+  return (BlockHeader*)p - 1;
+}
+
+/**
+ * @brief Allocate `size` bytes aligned to `align` (a power of two).
+ */
+static void* allocate(size_t align, size_t size) {
+  size_t pad = align <= sizeof(BlockHeader) ? sizeof(BlockHeader) : align;
+  if (size > SIZE_MAX - pad) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  uint8_t* base = (uint8_t*)(pad == sizeof(BlockHeader) ? __libc_malloc(size + pad)
+                                                        : __libc_memalign(align, size + pad));
+  if (!base) return nullptr;
+  BlockHeader* h = headerOf(base + pad);
+  h->magic = HEAP_MAGIC;
+  h->owner = tOwner;
+  h->offset = (uint32_t)pad;
+  h->size = size;
+  gAccounts[h->owner].bytes += size;
+  gAccounts[h->owner].blocks++;
+  return base + pad;
+}
+
+static bool isPowerOfTwo(size_t n) {
+  return n && !(n & (n - 1));
+}
+
+// ============================================================================
+// Allocator
+// ============================================================================
+
+extern "C" {
+
+void* malloc(size_t size) noexcept {
+  return allocate(0, size);
+}
+
+void free(void* p) noexcept {
+  if (!p) return;
+  BlockHeader* h = headerOf(p);
+  if (h->magic != HEAP_MAGIC) {
+    // Not one of ours (allocated before the wrappers were bound)
+    __libc_free(p);
+    return;
+  }
+  gAccounts[h->owner].bytes -= h->size;
+  gAccounts[h->owner].blocks--;
+  h->magic = 0;
+  __libc_free((uint8_t*)p - h->offset);
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+  size_t total;
+  if (__builtin_mul_overflow(n, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  void* p = allocate(0, total);
+  if (p) memset(p, 0, total);
+  return p;
+}
+
+void* realloc(void* p, size_t size) noexcept {
+  if (!p) return allocate(0, size);
+  if (size == 0) {
+    free(p);
+    return nullptr;
+  }
+  BlockHeader* h = headerOf(p);
+  if (h->magic != HEAP_MAGIC) return __libc_realloc(p, size);
+  if (h->offset != sizeof(BlockHeader) || size > SIZE_MAX - sizeof(BlockHeader)) {
+    // An aligned block, or a size glibc would refuse: move it by hand
+    void* q = allocate(0, size);
+    if (!q) return nullptr;
+    memcpy(q, p, h->size < size ? h->size : size);
+    free(p);
+    return q;
+  }
+  // The block stays charged to the account that allocated it
+  uint16_t owner = h->owner;
+  size_t old = h->size;
+  h = (BlockHeader*)__libc_realloc(h, size + sizeof(BlockHeader));
+  if (!h) return nullptr;
+  h->size = size;
+  gAccounts[owner].bytes += size;
+  gAccounts[owner].bytes -= old;
+  return h + 1;
+}
+
+void* memalign(size_t align, size_t size) noexcept {
+  if (!isPowerOfTwo(align)) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  return allocate(align, size);
+}
+
+void* aligned_alloc(size_t align, size_t size) noexcept {
+  return memalign(align, size);
+}
+
+int posix_memalign(void** out, size_t align, size_t size) noexcept {
+  if (!isPowerOfTwo(align) || align % sizeof(void*)) return EINVAL;
+  void* p = allocate(align, size);
+  if (!p) return ENOMEM;
+  *out = p;
+  return 0;
+}
+
+void* valloc(size_t size) noexcept {
+  return allocate(4096, size);
+}
+
+void* pvalloc(size_t size) noexcept {
+  return allocate(4096, (size + 4095) & ~(size_t)4095);
+}
+
+size_t malloc_usable_size(void* p) noexcept {
+  return p ? headerOf(p)->size : 0;
+}
+
+}  // extern "C"
+
+// ============================================================================
+// Accounts
+// ============================================================================
+
+void rigHeapThread(int dev) {
+  tOwner = dev >= 0 && dev < RIG_MAX_DEVICES ? (uint16_t)dev : HEAP_WORLD;
+}
+
+bool rigHeapUsage(int dev, size_t* bytes, size_t* blocks) {
+  const HeapAccount& a = gAccounts[dev >= 0 && dev < RIG_MAX_DEVICES ? dev : HEAP_WORLD];
+  if (bytes) *bytes = a.bytes;
+  if (blocks) *blocks = a.blocks;
+  return true;
+}
+
+#endif
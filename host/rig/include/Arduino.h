@@ -0,0 +1,153 @@
+/**
+ * @file Arduino.h
+ * @brief Arduino-ESP32 core API of the host rig.
+ *
+ * Every sketch of the rig is linked with its own device core (host/rig/core),
+ * so globals such as Serial, the pins and the timers are per device, as on
+ * the boards. Interrupt handlers (GPIO, hardware timers) run one at a time
+ * on the device's interrupt thread; pins driven by the scenario (buttons,
+ * the IMU interrupt line) change there too.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "WString.h"
+#include "Print.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define ARDUINO_ISR_ATTR
+#define IRAM_ATTR
+
+#define PI         3.1415926535897932384626433832795
+#define HALF_PI    1.5707963267948966192313216916398
+#define TWO_PI     6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// ============================================================================
+// Time
+// ============================================================================
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+#define LOW  0x0
+#define HIGH 0x1
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+#define ONLOW   0x04
+#define ONHIGH  0x05
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// ============================================================================
+// ADC
+// ============================================================================
+
+typedef enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db } adc_attenuation_t;
+
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t atten);
+
+// ============================================================================
+// LEDC (PWM and tones)
+// ============================================================================
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool ledcWrite(uint8_t pin, uint32_t duty);
+uint32_t ledcWriteTone(uint8_t pin, uint32_t freq);
+bool ledcDetach(uint8_t pin);
+
+// ============================================================================
+// Hardware Timers
+// ============================================================================
+
+struct hw_timer_s;
+typedef struct hw_timer_s hw_timer_t;
+
+hw_timer_t* timerBegin(uint32_t frequency);
+void timerEnd(hw_timer_t* timer);
+void timerStart(hw_timer_t* timer);
+void timerStop(hw_timer_t* timer);
+void timerRestart(hw_timer_t* timer);
+uint64_t timerRead(hw_timer_t* timer);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void));
+void timerAttachInterruptArg(hw_timer_t* timer, void (*fn)(void*), void* arg);
+void timerDetachInterrupt(hw_timer_t* timer);
+void timerAlarm(hw_timer_t* timer, uint64_t alarmValue, bool autoreload, uint64_t reloadCount);
+
+// ============================================================================
+// Serial
+// ============================================================================
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end(void) {}
+  int available(void);
+  int read(void);
+  size_t readBytes(uint8_t* buf, size_t len);
+  size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+  void setTimeout(unsigned long ms) { (void)ms; }
+  void flush(void) {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// ============================================================================
+// Misc
+// ============================================================================
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+void setup(void);
+void loop(void);
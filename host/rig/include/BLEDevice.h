@@ -0,0 +1,413 @@
+/**
+ * @file BLEDevice.h
+ * @brief Arduino-ESP32 BLE library of the host rig (Bluedroid flavour).
+ *
+ * The classes the sketches use, with the library's signatures and callback
+ * order, over the rig's radio (world.h) instead of a controller:
+ *
+ * - BLEServer keeps a GATT database (a service declaration, then for every
+ *   characteristic a declaration, a value and its descriptors) and answers
+ *   the peer's ATT requests on the device's BLE thread;
+ * - BLEAdvertising advertises the configured data from the device's public
+ *   address, or from a resolvable private address once
+ *   esp_ble_gap_config_local_privacy() is on;
+ * - BLEScan collects the advertisements heard during a scan, by address,
+ *   and calls the completion callback on the BLE thread.
+ *
+ * The other headers of the library (BLEServer.h, BLEScan.h, ...) include
+ * this one. Scan intervals and windows are in milliseconds, as in the
+ * library.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "WString.h"
+#include "esp_bt_defs.h"
+#include "esp_gatt_defs.h"
+#include "esp_gattc_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gap_ble_api.h"
+
+class BLEServer;
+class BLEService;
+class BLECharacteristic;
+class BLEScan;
+class BLEAdvertising;
+
+typedef void (*gap_event_handler)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+typedef void (*gattc_event_handler)(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                    esp_ble_gattc_cb_param_t* param);
+
+// ============================================================================
+// Identifiers
+// ============================================================================
+
+class BLEUUID {
+ public:
+  BLEUUID();
+  BLEUUID(const char* text);
+  BLEUUID(const String& text) : BLEUUID(text.c_str()) {}
+  BLEUUID(uint16_t uuid16);
+  BLEUUID(const esp_bt_uuid_t& uuid);
+
+  esp_bt_uuid_t* getNative() { return &uuid_; }
+  const esp_bt_uuid_t* getNative() const { return &uuid_; }
+  uint8_t bitSize() const { return valid_ ? (uint8_t)(uuid_.len * 8) : 0; }
+  bool equals(const BLEUUID& other) const;
+  bool operator==(const BLEUUID& other) const { return equals(other); }
+  bool operator!=(const BLEUUID& other) const { return !equals(other); }
+  String toString() const;
+
+ private:
+  esp_bt_uuid_t uuid_;
+  bool          valid_;
+};
+
+class BLEAddress {
+ public:
+  BLEAddress();
+  BLEAddress(const esp_bd_addr_t addr, uint8_t type = BLE_ADDR_TYPE_PUBLIC);
+  BLEAddress(const String& text, uint8_t type = BLE_ADDR_TYPE_PUBLIC);
+
+  esp_bd_addr_t* getNative() { return &addr_; }
+  uint8_t getType() const { return type_; }
+  bool equals(const BLEAddress& other) const;
+  bool operator==(const BLEAddress& other) const { return equals(other); }
+  bool operator<(const BLEAddress& other) const;
+  String toString() const;
+
+ private:
+  esp_bd_addr_t addr_;
+  uint8_t       type_;
+};
+
+// ============================================================================
+// Server
+// ============================================================================
+
+class BLEDescriptor {
+ public:
+  BLEDescriptor(const char* uuid, uint16_t maxLen = 100);
+  BLEDescriptor(BLEUUID uuid, uint16_t maxLen = 100);
+  virtual ~BLEDescriptor() {}
+
+  uint16_t getHandle() const { return handle_; }
+  BLEUUID getUUID() const { return uuid_; }
+  void setValue(const uint8_t* data, size_t len);
+  void setValue(const String& value) { setValue((const uint8_t*)value.c_str(), value.length()); }
+  size_t getLength();
+  String getValue();
+
+ protected:
+  friend class BLEService;
+  friend class BLECharacteristic;
+  friend struct RigGatt;
+  BLEUUID           uuid_;
+  uint16_t          handle_ = 0;
+  uint16_t          maxLen_;
+  std::string       value_;
+  BLECharacteristic* chr_ = nullptr;
+};
+
+/**
+ * @brief Client characteristic configuration descriptor.
+ */
+class BLE2902 : public BLEDescriptor {
+ public:
+  BLE2902();
+  bool getNotifications();
+  bool getIndications();
+  void setNotifications(bool on);
+  void setIndications(bool on);
+};
+
+class BLECharacteristicCallbacks {
+ public:
+  enum Status { SUCCESS_INDICATE, SUCCESS_NOTIFY, ERROR_INDICATE_DISABLED, ERROR_NOTIFY_DISABLED,
+                ERROR_GATT, ERROR_NO_CLIENT, ERROR_INDICATE_TIMEOUT, ERROR_INDICATE_FAILURE };
+
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic* c, esp_ble_gatts_cb_param_t* param) { (void)param; onRead(c); }
+  virtual void onRead(BLECharacteristic* c) { (void)c; }
+  virtual void onWrite(BLECharacteristic* c, esp_ble_gatts_cb_param_t* param) { (void)param; onWrite(c); }
+  virtual void onWrite(BLECharacteristic* c) { (void)c; }
+  virtual void onNotify(BLECharacteristic* c) { (void)c; }
+  virtual void onStatus(BLECharacteristic* c, Status s, uint32_t code) { (void)c; (void)s; (void)code; }
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ      = 1 << 0;
+  static const uint32_t PROPERTY_WRITE     = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY    = 1 << 2;
+  static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+  static const uint32_t PROPERTY_INDICATE  = 1 << 4;
+  static const uint32_t PROPERTY_WRITE_NR  = 1 << 5;
+
+  BLECharacteristic(const char* uuid, uint32_t properties = 0) : BLECharacteristic(BLEUUID(uuid), properties) {}
+  BLECharacteristic(BLEUUID uuid, uint32_t properties = 0);
+  virtual ~BLECharacteristic() {}
+
+  void addDescriptor(BLEDescriptor* descriptor);
+  BLEDescriptor* getDescriptorByUUID(const char* uuid) { return getDescriptorByUUID(BLEUUID(uuid)); }
+  BLEDescriptor* getDescriptorByUUID(BLEUUID uuid);
+  BLEUUID getUUID() const { return uuid_; }
+  uint16_t getHandle() const { return handle_; }
+  uint32_t getProperties() const { return props_; }
+  BLEService* getService() const { return service_; }
+
+  void setCallbacks(BLECharacteristicCallbacks* callbacks) { callbacks_ = callbacks; }
+  void setAccessPermissions(esp_gatt_perm_t perm) { perm_ = perm; }
+  void setValue(const uint8_t* data, size_t len);
+  void setValue(const String& value) { setValue((const uint8_t*)value.c_str(), value.length()); }
+  void setValue(const char* value) { setValue((const uint8_t*)value, strlen(value)); }
+  void setValue(uint16_t& data16) { setValue((const uint8_t*)&data16, sizeof(data16)); }
+  void setValue(uint32_t& data32) { setValue((const uint8_t*)&data32, sizeof(data32)); }
+  void setValue(int& data32) { setValue((const uint8_t*)&data32, sizeof(data32)); }
+  void setValue(float& data) { setValue((const uint8_t*)&data, sizeof(data)); }
+  String getValue();
+  size_t getLength();
+
+  void notify(bool isNotification = true);
+  void indicate() { notify(false); }
+
+ private:
+  friend class BLEService;
+  friend struct RigGatt;
+  BLEUUID                     uuid_;
+  uint32_t                    props_;
+  esp_gatt_perm_t             perm_ = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE;
+  uint16_t                    handle_ = 0;   /**< Value handle. */
+  std::string                 value_;
+  BLECharacteristicCallbacks* callbacks_ = nullptr;
+  BLEService*                 service_ = nullptr;
+  std::vector<BLEDescriptor*> descriptors_;
+};
+
+class BLEService {
+ public:
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties) {
+    return createCharacteristic(BLEUUID(uuid), properties);
+  }
+  BLECharacteristic* createCharacteristic(BLEUUID uuid, uint32_t properties);
+  void addCharacteristic(BLECharacteristic* c);
+  BLECharacteristic* getCharacteristic(const char* uuid) { return getCharacteristic(BLEUUID(uuid)); }
+  BLECharacteristic* getCharacteristic(BLEUUID uuid);
+  BLEUUID getUUID() const { return uuid_; }
+  uint16_t getHandle() const { return handle_; }
+  BLEServer* getServer() const { return server_; }
+  void start();
+  void stop();
+
+ private:
+  friend class BLEServer;
+  friend struct RigGatt;
+  BLEService(BLEServer* server, BLEUUID uuid) : server_(server), uuid_(uuid) {}
+  BLEServer*                      server_;
+  BLEUUID                         uuid_;
+  uint16_t                        handle_ = 0;
+  uint16_t                        endHandle_ = 0;
+  bool                            started_ = false;
+  std::vector<BLECharacteristic*> chars_;
+};
+
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* server) { (void)server; }
+  virtual void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) { (void)server; (void)param; }
+  virtual void onDisconnect(BLEServer* server) { (void)server; }
+  virtual void onDisconnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) { (void)server; (void)param; }
+  virtual void onMtuChanged(BLEServer* server, esp_ble_gatts_cb_param_t* param) { (void)server; (void)param; }
+};
+
+class BLEServer {
+ public:
+  BLEService* createService(const char* uuid) { return createService(BLEUUID(uuid)); }
+  BLEService* createService(BLEUUID uuid, uint32_t numHandles = 15, uint8_t instId = 0);
+  BLEService* getServiceByUUID(const char* uuid) { return getServiceByUUID(BLEUUID(uuid)); }
+  BLEService* getServiceByUUID(BLEUUID uuid);
+  BLEAdvertising* getAdvertising();
+  void setCallbacks(BLEServerCallbacks* callbacks) { callbacks_ = callbacks; }
+  void startAdvertising();
+  uint32_t getConnectedCount();
+  void disconnect(uint16_t connId);
+  uint16_t getPeerMTU(uint16_t connId);
+
+ private:
+  friend class BLEDevice;
+  friend struct RigGatt;
+  BLEServer() {}
+  BLEServerCallbacks*      callbacks_ = nullptr;
+  std::vector<BLEService*> services_;
+};
+
+// ============================================================================
+// Advertising
+// ============================================================================
+
+class BLEAdvertisementData {
+ public:
+  void setFlags(uint8_t flags);
+  void setManufacturerData(const String& data);
+  void setName(const String& name);
+  void setShortName(const String& name);
+  void setCompleteServices(BLEUUID uuid);
+  void setAppearance(uint16_t appearance);
+  void addData(const String& data) { payload_ += data; }
+  void addData(const char* data, size_t len) { payload_.concat(data, len); }
+  String getPayload() const { return payload_; }
+
+ private:
+  void add(uint8_t type, const uint8_t* data, size_t len);
+  String payload_;
+};
+
+class BLEAdvertising {
+ public:
+  void addServiceUUID(BLEUUID uuid) { services_.push_back(uuid); }
+  void addServiceUUID(const char* uuid) { addServiceUUID(BLEUUID(uuid)); }
+  void setAdvertisementData(BLEAdvertisementData& data);
+  void setScanResponseData(BLEAdvertisementData& data);
+  void setScanResponse(bool on) { scanResponse_ = on; }
+  void setMinInterval(uint16_t units) { minInterval_ = units; }
+  void setMaxInterval(uint16_t units) { maxInterval_ = units; }
+  void setMinPreferred(uint16_t units) { (void)units; }
+  void setMaxPreferred(uint16_t units) { (void)units; }
+  void setAppearance(uint16_t appearance) { (void)appearance; }
+  void start();
+  bool stop();
+
+ private:
+  friend struct RigGatt;
+  std::vector<BLEUUID> services_;
+  String               data_;
+  String               scanResponseData_;
+  bool                 customData_ = false;
+  bool                 scanResponse_ = true;
+  bool                 running_ = false;
+  uint16_t             minInterval_ = 0x20;   /**< 0.625 ms units (20 ms). */
+  uint16_t             maxInterval_ = 0x40;   /**< 0.625 ms units (40 ms). */
+};
+
+// ============================================================================
+// Scanning
+// ============================================================================
+
+class BLEAdvertisedDevice {
+ public:
+  BLEAddress getAddress() { return address_; }
+  esp_ble_addr_type_t getAddressType() { return addrType_; }
+  int getRSSI() { return rssi_; }
+  bool haveRSSI() { return true; }
+  bool haveName() { return !name_.isEmpty(); }
+  String getName() { return name_; }
+  bool haveManufacturerData() { return haveMfr_; }
+  String getManufacturerData() { return mfr_; }
+  bool haveServiceUUID() { return !services_.empty(); }
+  BLEUUID getServiceUUID() { return services_.empty() ? BLEUUID() : services_[0]; }
+  bool isAdvertisingService(BLEUUID uuid);
+  uint8_t* getPayload() { return (uint8_t*)payload_.c_str(); }
+  size_t getPayloadLength() { return payload_.length(); }
+  String toString();
+
+  /** @brief Fill from an advertising report (rig core). */
+  void setReport(const uint8_t addr[6], uint8_t addrType, int rssi, const uint8_t* data, size_t len);
+
+ private:
+  BLEAddress           address_;
+  esp_ble_addr_type_t  addrType_ = BLE_ADDR_TYPE_PUBLIC;
+  int                  rssi_ = 0;
+  String               name_;
+  String               mfr_;
+  bool                 haveMfr_ = false;
+  std::vector<BLEUUID> services_;
+  String               payload_;
+};
+
+class BLEAdvertisedDeviceCallbacks {
+ public:
+  virtual ~BLEAdvertisedDeviceCallbacks() {}
+  virtual void onResult(BLEAdvertisedDevice device) = 0;
+};
+
+class BLEScanResults {
+ public:
+  int getCount() { return (int)devices_.size(); }
+  BLEAdvertisedDevice getDevice(uint32_t i);
+  void dump();
+
+ private:
+  friend class BLEScan;
+  std::map<std::string, BLEAdvertisedDevice*> devices_;   /**< By address text, as in the library. */
+};
+
+class BLEScan {
+ public:
+  void setActiveScan(bool active) { active_ = active; }
+  void setInterval(uint16_t intervalMs) { intervalMs_ = intervalMs; }
+  void setWindow(uint16_t windowMs) { windowMs_ = windowMs; }
+  void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* callbacks, bool wantDuplicates = false,
+                                    bool shouldParse = true);
+  bool start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool isContinue = false);
+  BLEScanResults* start(uint32_t duration, bool isContinue = false);
+  void stop();
+  void erase(BLEAddress address);
+  BLEScanResults* getResults() { return &results_; }
+  void clearResults();
+
+  /** @brief An advertising report arrived (rig core, BLE thread). */
+  void onReport(const uint8_t addr[6], uint8_t addrType, int rssi, const uint8_t* data, size_t len);
+  /** @brief The scan duration elapsed (rig core, BLE thread). */
+  void onDurationElapsed();
+
+ private:
+  friend class BLEDevice;
+  BLEScan() {}
+  BLEAdvertisedDeviceCallbacks* callbacks_ = nullptr;
+  void (*completeCb_)(BLEScanResults) = nullptr;
+  bool           active_ = false;
+  bool           wantDuplicates_ = false;
+  volatile bool  running_ = false;
+  uint16_t       intervalMs_ = 100;
+  uint16_t       windowMs_ = 100;
+  BLEScanResults results_;
+};
+
+// ============================================================================
+// Security and Device
+// ============================================================================
+
+class BLESecurity {
+ public:
+  void setAuthenticationMode(esp_ble_auth_req_t mode);
+  void setCapability(esp_ble_io_cap_t cap) { (void)cap; }
+  void setInitEncryptionKey(uint8_t keys);
+  void setRespEncryptionKey(uint8_t keys);
+  void setKeySize(uint8_t size = 16) { (void)size; }
+  void setStaticPIN(uint32_t pin) { (void)pin; }
+};
+
+class BLEDevice {
+ public:
+  static void init(const String& name);
+  static void deinit(bool releaseMemory = false);
+  static bool getInitialized();
+  static BLEServer* createServer();
+  static BLEScan* getScan();
+  static BLEAdvertising* getAdvertising();
+  static void startAdvertising();
+  static void stopAdvertising();
+  static BLEAddress getAddress();
+  static esp_err_t setMTU(uint16_t mtu);
+  static uint16_t getMTU();
+  static void setEncryptionLevel(esp_ble_sec_act_t level);
+  static void setCustomGapHandler(gap_event_handler handler);
+  static void setCustomGattcHandler(gattc_event_handler handler);
+  static void setPower(int powerLevel) { (void)powerLevel; }
+};
@@ -0,0 +1,7 @@
+/**
+ * @file BLEServer.h
+ * @brief Part of the host rig's BLE library; everything is in BLEDevice.h.
+ */
+
+#pragma once
+#include "BLEDevice.h"
@@ -0,0 +1,40 @@
+/**
+ * @file LiquidCrystal_I2C.h
+ * @brief HD44780 character LCD behind a PCF8574 backpack, on the host rig.
+ *
+ * Keeps the display contents; each change is reported to the rig as the
+ * two rows of text (at most every RIG_LCD_NOTE_MS).
+ */
+
+#pragma once
+#include <stdint.h>
+#include "Print.h"
+
+/** @brief Shortest gap between two reported LCD frames (ms). */
+#ifndef RIG_LCD_NOTE_MS
+#define RIG_LCD_NOTE_MS 500
+#endif
+
+class LiquidCrystal_I2C : public Print {
+ public:
+  LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows);
+  void init(void);
+  void begin(void) { init(); }
+  void clear(void);
+  void home(void) { setCursor(0, 0); }
+  void setCursor(uint8_t col, uint8_t row);
+  void backlight(void);
+  void noBacklight(void);
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  void changed(void);
+
+  uint8_t  addr_, cols_, rows_;
+  uint8_t  col_ = 0, row_ = 0;
+  bool     light_ = false;
+  uint32_t notedMs_ = 0;
+  bool     flushPending_ = false;
+  char     text_[4][21];
+};
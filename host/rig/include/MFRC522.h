@@ -0,0 +1,34 @@
+/**
+ * @file MFRC522.h
+ * @brief RC522 RFID reader driver of the host rig.
+ *
+ * Cards come from the rig scenario: a presented card is read once by
+ * PICC_IsNewCardPresent() and PICC_ReadCardSerial(), like a card held
+ * to the reader and then halted.
+ */
+
+#pragma once
+#include <stdint.h>
+
+class MFRC522 {
+ public:
+  typedef struct {
+    uint8_t size;
+    uint8_t uidByte[10];
+    uint8_t sak;
+  } Uid;
+
+  Uid uid;
+
+  MFRC522(uint8_t ssPin, uint8_t rstPin) : ss_(ssPin), rst_(rstPin) { uid.size = 0; uid.sak = 0; }
+  void PCD_Init(void);
+  void PCD_Reset(void);
+  void PCD_DumpVersionToSerial(void);
+  bool PICC_IsNewCardPresent(void);
+  bool PICC_ReadCardSerial(void);
+  uint8_t PICC_HaltA(void) { return 0; }
+
+ private:
+  uint8_t ss_, rst_;
+  bool    ready_ = false;
+};
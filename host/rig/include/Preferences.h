@@ -0,0 +1,30 @@
+/**
+ * @file Preferences.h
+ * @brief Arduino NVS key-value store of the host rig.
+ *
+ * Namespaces live in the device core's memory for the life of the rig; a
+ * namespace opened read-only must already exist, as with NVS.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false);
+  void end(void);
+  bool clear(void);
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putUInt(const char* key, uint32_t value);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+ private:
+  void* ns_ = nullptr;
+  bool  readOnly_ = false;
+};
@@ -0,0 +1,23 @@
+/**
+ * @file SPI.h
+ * @brief Arduino SPI bus of the host rig.
+ *
+ * Only bus setup is modelled; the RC522 on it is simulated at the level of
+ * its driver (MFRC522.h).
+ */
+
+#pragma once
+#include <stdint.h>
+
+class SPIClass {
+ public:
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+    sck_ = sck; miso_ = miso; mosi_ = mosi; ss_ = ss;
+  }
+  void end(void) {}
+
+ private:
+  int8_t sck_ = -1, miso_ = -1, mosi_ = -1, ss_ = -1;
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,68 @@
+/**
+ * @file WString.h
+ * @brief Arduino String of the host rig, over std::string.
+ *
+ * Holds binary data as the ESP32 core's String does (the BLE classes return
+ * characteristic values and manufacturer data in it).
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class String {
+ public:
+  String(const char* s = "") : s_(s ? s : "") {}
+  String(const char* s, size_t len) : s_(s, len) {}
+  String(const uint8_t* s, size_t len) : s_((const char*)s, len) {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned int v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+  explicit String(float v, unsigned int decimals = 2);
+  explicit String(double v, unsigned int decimals = 2);
+
+  const char* c_str() const { return s_.c_str(); }
+  size_t length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(size_t n) { s_.reserve(n); return true; }
+  char operator[](size_t i) const { return i < s_.size() ? s_[i] : 0; }
+  char& operator[](size_t i) { return s_[i]; }
+  char charAt(size_t i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o ? o : ""; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  bool concat(const String& o) { s_ += o.s_; return true; }
+  bool concat(const char* o, size_t len) { s_.append(o, len); return true; }
+
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  bool operator<(const String& o) const { return s_ < o.s_; }
+  bool equals(const String& o) const { return s_ == o.s_; }
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const;
+  int indexOf(char c, size_t from = 0) const;
+  int indexOf(const String& p, size_t from = 0) const;
+  String substring(size_t from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(size_t from, size_t to) const;
+  long toInt() const;
+  float toFloat() const;
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  const std::string& str() const { return s_; }
+
+ private:
+  std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
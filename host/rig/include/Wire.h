@@ -0,0 +1,43 @@
+/**
+ * @file Wire.h
+ * @brief Arduino I2C master of the host rig.
+ *
+ * Transactions go to the simulated devices of the board (see
+ * core/periph.cpp): the MPU-6500 at 0x68 on the tag, the LCD backpack at
+ * 0x27 on the tracker. An address nobody answers gives a NACK (2).
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Bytes of one transaction, as the ESP32 core's I2C buffer. */
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire {
+ public:
+  bool begin(void) { return true; }
+  bool begin(int sda, int scl, uint32_t frequency = 0) { (void)sda; (void)scl; (void)frequency; return true; }
+  bool setClock(uint32_t frequency) { (void)frequency; return true; }
+  bool end(void) { return true; }
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  uint8_t endTransmission(bool sendStop = true);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t* data, size_t len);
+  size_t requestFrom(int address, int quantity, int sendStop = 1);
+  int available(void) { return (int)(rxLen_ - rxPos_); }
+  int read(void) { return rxPos_ < rxLen_ ? rxBuf_[rxPos_++] : -1; }
+  int peek(void) { return rxPos_ < rxLen_ ? rxBuf_[rxPos_] : -1; }
+
+ private:
+  uint8_t txAddr_ = 0;
+  size_t  txLen_ = 0;
+  size_t  rxLen_ = 0;
+  size_t  rxPos_ = 0;
+  uint8_t txBuf_[I2C_BUFFER_LENGTH];
+  uint8_t rxBuf_[I2C_BUFFER_LENGTH];
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,33 @@
+/**
+ * @file gpio.h
+ * @brief GPIO driver calls of the host rig.
+ *
+ * Interrupt masking applies to the handler attached with attachInterrupt();
+ * a level-triggered pin fires again on unmasking while it holds its level.
+ */
+
+#pragma once
+#include "../esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+  GPIO_INTR_DISABLE    = 0,
+  GPIO_INTR_POSEDGE    = 1,
+  GPIO_INTR_NEGEDGE    = 2,
+  GPIO_INTR_ANYEDGE    = 3,
+  GPIO_INTR_LOW_LEVEL  = 4,
+  GPIO_INTR_HIGH_LEVEL = 5,
+} gpio_int_type_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t gpio_intr_enable(gpio_num_t pin);
+esp_err_t gpio_intr_disable(gpio_num_t pin);
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,31 @@
+/**
+ * @file adc_cali_scheme.h
+ * @brief ADC calibration of the host rig: the curve-fitting scheme of the
+ *        ESP32-S3, an ideal converter over 0-3100 mV.
+ */
+
+#pragma once
+#include "adc_oneshot.h"
+
+#define ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED 1
+
+typedef struct RigAdcCali* adc_cali_handle_t;
+
+typedef struct {
+  adc_unit_t     unit_id;
+  adc_channel_t  chan;
+  adc_atten_t    atten;
+  adc_bitwidth_t bitwidth;
+} adc_cali_curve_fitting_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t* config,
+                                               adc_cali_handle_t* out);
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int* mv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file adc_oneshot.h
+ * @brief ADC pin mapping of the host rig (ESP32-S3: GPIO 1-10 are ADC1).
+ */
+
+#pragma once
+#include "../esp_err.h"
+
+typedef enum { ADC_UNIT_1 = 0, ADC_UNIT_2 = 1 } adc_unit_t;
+typedef int adc_channel_t;
+typedef enum { ADC_ATTEN_DB_0 = 0, ADC_ATTEN_DB_2_5 = 1, ADC_ATTEN_DB_6 = 2, ADC_ATTEN_DB_12 = 3 } adc_atten_t;
+typedef enum { ADC_BITWIDTH_DEFAULT = 0, ADC_BITWIDTH_12 = 12 } adc_bitwidth_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t adc_oneshot_io_to_channel(int io, adc_unit_t* unit, adc_channel_t* channel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file esp_bt_defs.h
+ * @brief Bluedroid common definitions (host rig subset).
+ *
+ * Addresses are most significant byte first, as Bluedroid stores them;
+ * 128-bit UUIDs and keys are least significant byte first.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+typedef uint8_t esp_bt_octet16_t[16];
+typedef uint8_t esp_bt_octet8_t[8];
+
+typedef enum {
+  BLE_ADDR_TYPE_PUBLIC     = 0x00,
+  BLE_ADDR_TYPE_RANDOM     = 0x01,
+  BLE_ADDR_TYPE_RPA_PUBLIC = 0x02,
+  BLE_ADDR_TYPE_RPA_RANDOM = 0x03,
+} esp_ble_addr_type_t;
+
+typedef enum {
+  ESP_BT_STATUS_SUCCESS = 0,
+  ESP_BT_STATUS_FAIL,
+  ESP_BT_STATUS_NOT_READY,
+  ESP_BT_STATUS_NOMEM,
+  ESP_BT_STATUS_BUSY,
+  ESP_BT_STATUS_DONE,
+  ESP_BT_STATUS_UNSUPPORTED,
+  ESP_BT_STATUS_PARM_INVALID,
+  ESP_BT_STATUS_UNHANDLED,
+  ESP_BT_STATUS_AUTH_FAILURE,
+  ESP_BT_STATUS_RMT_DEV_DOWN,
+  ESP_BT_STATUS_AUTH_REJECTED,
+  ESP_BT_STATUS_TIMEOUT = 0x0d,
+} esp_bt_status_t;
+
+#define ESP_UUID_LEN_16  2
+#define ESP_UUID_LEN_32  4
+#define ESP_UUID_LEN_128 16
+
+typedef struct {
+  uint16_t len;
+  union {
+    uint16_t uuid16;
+    uint32_t uuid32;
+    uint8_t  uuid128[ESP_UUID_LEN_128];
+  } uuid;
+} __attribute__((packed)) esp_bt_uuid_t;
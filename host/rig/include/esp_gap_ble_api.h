@@ -0,0 +1,117 @@
+/**
+ * @file esp_gap_ble_api.h
+ * @brief Bluedroid GAP and security API (host rig subset).
+ *
+ * Bonding runs over the rig's link in one request and response (no key
+ * generation): the responder hands out its identity resolving key and
+ * identity address if both sides ask for the ID key. Bonds live in the
+ * device core's memory for the life of the rig.
+ */
+
+#pragma once
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+typedef enum {
+  ESP_GAP_BLE_SCAN_RESULT_EVT         = 3,
+  ESP_GAP_BLE_SCAN_START_COMPLETE_EVT = 7,
+  ESP_GAP_BLE_AUTH_CMPL_EVT           = 8,
+  ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT  = 18,
+  ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT  = 23,
+} esp_gap_ble_cb_event_t;
+
+typedef uint8_t esp_ble_auth_req_t;
+#define ESP_LE_AUTH_NO_BOND     0x00
+#define ESP_LE_AUTH_BOND        0x01
+#define ESP_LE_AUTH_REQ_MITM    (1 << 2)
+#define ESP_LE_AUTH_REQ_SC_ONLY (1 << 3)
+#define ESP_LE_AUTH_REQ_SC_BOND (ESP_LE_AUTH_BOND | ESP_LE_AUTH_REQ_SC_ONLY)
+
+typedef uint8_t esp_ble_io_cap_t;
+#define ESP_IO_CAP_OUT    0
+#define ESP_IO_CAP_IO     1
+#define ESP_IO_CAP_IN     2
+#define ESP_IO_CAP_NONE   3
+#define ESP_IO_CAP_KBDISP 4
+
+typedef uint8_t esp_ble_key_mask_t;
+#define ESP_BLE_ENC_KEY_MASK  (1 << 0)
+#define ESP_BLE_ID_KEY_MASK   (1 << 1)
+#define ESP_BLE_CSR_KEY_MASK  (1 << 2)
+#define ESP_BLE_LINK_KEY_MASK (1 << 3)
+
+typedef enum {
+  ESP_BLE_SEC_ENCRYPT = 1,
+  ESP_BLE_SEC_ENCRYPT_NO_MITM,
+  ESP_BLE_SEC_ENCRYPT_MITM,
+} esp_ble_sec_act_t;
+
+typedef struct {
+  esp_bt_octet16_t ltk;
+  esp_bt_octet8_t  rand;
+  uint16_t         ediv;
+  uint8_t          sec_level;
+  uint8_t          key_size;
+} esp_ble_penc_keys_t;
+
+typedef struct {
+  esp_bt_octet16_t    irk;          /**< Least significant byte first. */
+  esp_ble_addr_type_t addr_type;
+  esp_bd_addr_t       static_addr;
+} esp_ble_pid_keys_t;
+
+typedef struct {
+  esp_ble_key_mask_t  key_mask;
+  esp_ble_penc_keys_t penc_key;
+  esp_ble_pid_keys_t  pid_key;
+} esp_ble_bond_key_info_t;
+
+typedef struct {
+  esp_bd_addr_t           bd_addr;
+  esp_ble_bond_key_info_t bond_key;
+} esp_ble_bond_dev_t;
+
+typedef struct {
+  esp_bd_addr_t       bd_addr;
+  bool                key_present;
+  uint8_t             key_type;
+  bool                success;
+  uint8_t             fail_reason;
+  esp_ble_addr_type_t addr_type;
+  esp_ble_auth_req_t  auth_mode;
+} esp_ble_auth_cmpl_t;
+
+typedef union {
+  struct ble_read_rssi_cmpl_evt_param {
+    esp_bt_status_t status;
+    int8_t          rssi;
+    esp_bd_addr_t   remote_addr;
+  } read_rssi_cmpl;
+  struct ble_scan_start_cmpl_evt_param {
+    esp_bt_status_t status;
+  } scan_start_cmpl;
+  struct ble_scan_stop_cmpl_evt_param {
+    esp_bt_status_t status;
+  } scan_stop_cmpl;
+  struct ble_security_evt_param {
+    esp_ble_auth_cmpl_t auth_cmpl;
+  } ble_security;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_ble_gap_config_local_privacy(bool privacy_enable);
+esp_err_t esp_ble_gap_disconnect(esp_bd_addr_t remote_device);
+esp_err_t esp_ble_gap_read_rssi(esp_bd_addr_t remote_addr);
+esp_err_t esp_ble_set_encryption(esp_bd_addr_t bd_addr, esp_ble_sec_act_t sec_act);
+int esp_ble_get_bond_device_num(void);
+esp_err_t esp_ble_get_bond_device_list(int* dev_num, esp_ble_bond_dev_t* dev_list);
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr);
+
+#ifdef __cplusplus
+}
+#endif
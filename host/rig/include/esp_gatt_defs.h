@@ -0,0 +1,87 @@
+/**
+ * @file esp_gatt_defs.h
+ * @brief Bluedroid GATT definitions (host rig subset).
+ */
+
+#pragma once
+#include "esp_bt_defs.h"
+
+typedef uint8_t esp_gatt_if_t;
+#define ESP_GATT_IF_NONE 0xff
+
+typedef enum {
+  ESP_GATT_OK                = 0x00,
+  ESP_GATT_INVALID_HANDLE    = 0x01,
+  ESP_GATT_READ_NOT_PERMIT   = 0x02,
+  ESP_GATT_WRITE_NOT_PERMIT  = 0x03,
+  ESP_GATT_INVALID_PDU       = 0x04,
+  ESP_GATT_INSUF_AUTHENTICATION = 0x05,
+  ESP_GATT_NOT_FOUND         = 0x0a,
+  ESP_GATT_INVALID_ATTR_LEN  = 0x0d,
+  ESP_GATT_INSUF_ENCRYPTION  = 0x0f,
+  ESP_GATT_NO_RESOURCES      = 0x80,
+  ESP_GATT_INTERNAL_ERROR    = 0x81,
+  ESP_GATT_WRONG_STATE       = 0x82,
+  ESP_GATT_BUSY              = 0x84,
+  ESP_GATT_ERROR             = 0x85,
+  ESP_GATT_ILLEGAL_PARAMETER = 0x87,
+  ESP_GATT_INVALID_CFG       = 0x8b,
+} esp_gatt_status_t;
+
+typedef enum {
+  ESP_GATT_CONN_UNKNOWN              = 0,
+  ESP_GATT_CONN_TIMEOUT              = 0x08,
+  ESP_GATT_CONN_TERMINATE_PEER_USER  = 0x13,
+  ESP_GATT_CONN_TERMINATE_LOCAL_HOST = 0x16,
+  ESP_GATT_CONN_FAIL_ESTABLISH       = 0x3e,
+} esp_gatt_conn_reason_t;
+
+typedef enum {
+  ESP_GATT_WRITE_TYPE_NO_RSP = 1,
+  ESP_GATT_WRITE_TYPE_RSP,
+} esp_gatt_write_type_t;
+
+typedef enum {
+  ESP_GATT_AUTH_REQ_NONE = 0,
+  ESP_GATT_AUTH_REQ_NO_MITM,
+  ESP_GATT_AUTH_REQ_MITM,
+} esp_gatt_auth_req_t;
+
+typedef uint8_t esp_gatt_char_prop_t;
+#define ESP_GATT_CHAR_PROP_BIT_BROADCAST (1 << 0)
+#define ESP_GATT_CHAR_PROP_BIT_READ      (1 << 1)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR  (1 << 2)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE     (1 << 3)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY    (1 << 4)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE  (1 << 5)
+
+typedef uint16_t esp_gatt_perm_t;
+#define ESP_GATT_PERM_READ            (1 << 0)
+#define ESP_GATT_PERM_READ_ENCRYPTED  (1 << 1)
+#define ESP_GATT_PERM_READ_ENC_MITM   (1 << 2)
+#define ESP_GATT_PERM_WRITE           (1 << 4)
+#define ESP_GATT_PERM_WRITE_ENCRYPTED (1 << 5)
+#define ESP_GATT_PERM_WRITE_ENC_MITM  (1 << 6)
+
+#define ESP_GATT_UUID_PRI_SERVICE        0x2800
+#define ESP_GATT_UUID_CHAR_DECLARE       0x2803
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG 0x2902
+
+#define ESP_GATT_MAX_MTU_SIZE 517
+#define ESP_GATT_DEF_BLE_MTU_SIZE 23
+
+typedef struct {
+  esp_bt_uuid_t uuid;
+  uint8_t       inst_id;
+} __attribute__((packed)) esp_gatt_id_t;
+
+typedef struct {
+  esp_gatt_id_t id;
+  bool          is_primary;
+} __attribute__((packed)) esp_gatt_srvc_id_t;
+
+typedef struct {
+  uint16_t interval;   /**< Connection interval (1.25 ms units). */
+  uint16_t latency;    /**< Peripheral latency (events). */
+  uint16_t timeout;    /**< Supervision timeout (10 ms units). */
+} esp_gatt_conn_params_t;
@@ -0,0 +1,144 @@
+/**
+ * @file esp_gattc_api.h
+ * @brief Bluedroid GATT client API (host rig subset).
+ *
+ * Procedures complete in the events of the application's callback, on the
+ * device's BLE thread, after the PDUs have crossed the rig's link at its
+ * connection events.
+ */
+
+#pragma once
+#include "esp_err.h"
+#include "esp_gatt_defs.h"
+
+typedef enum {
+  ESP_GATTC_REG_EVT            = 0,
+  ESP_GATTC_UNREG_EVT          = 1,
+  ESP_GATTC_OPEN_EVT           = 2,
+  ESP_GATTC_READ_CHAR_EVT      = 3,
+  ESP_GATTC_WRITE_CHAR_EVT     = 4,
+  ESP_GATTC_CLOSE_EVT          = 5,
+  ESP_GATTC_SEARCH_CMPL_EVT    = 6,
+  ESP_GATTC_SEARCH_RES_EVT     = 7,
+  ESP_GATTC_READ_DESCR_EVT     = 8,
+  ESP_GATTC_WRITE_DESCR_EVT    = 9,
+  ESP_GATTC_NOTIFY_EVT         = 10,
+  ESP_GATTC_CFG_MTU_EVT        = 18,
+  ESP_GATTC_REG_FOR_NOTIFY_EVT = 38,
+  ESP_GATTC_CONNECT_EVT        = 40,
+  ESP_GATTC_DISCONNECT_EVT     = 41,
+} esp_gattc_cb_event_t;
+
+typedef union {
+  struct gattc_reg_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          app_id;
+  } reg;
+  struct gattc_open_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          conn_id;
+    esp_bd_addr_t     remote_bda;
+    uint16_t          mtu;
+  } open;
+  struct gattc_close_evt_param {
+    esp_gatt_status_t      status;
+    uint16_t               conn_id;
+    esp_bd_addr_t          remote_bda;
+    esp_gatt_conn_reason_t reason;
+  } close;
+  struct gattc_cfg_mtu_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          conn_id;
+    uint16_t          mtu;
+  } cfg_mtu;
+  struct gattc_search_cmpl_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          conn_id;
+  } search_cmpl;
+  struct gattc_search_res_evt_param {
+    uint16_t      conn_id;
+    uint16_t      start_handle;
+    uint16_t      end_handle;
+    esp_gatt_id_t srvc_id;
+    bool          is_primary;
+  } search_res;
+  struct gattc_read_char_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          conn_id;
+    uint16_t          handle;
+    uint8_t*          value;
+    uint16_t          value_len;
+  } read;
+  struct gattc_write_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          conn_id;
+    uint16_t          handle;
+    uint16_t          offset;
+  } write;
+  struct gattc_notify_evt_param {
+    uint16_t      conn_id;
+    esp_bd_addr_t remote_bda;
+    uint16_t      handle;
+    uint16_t      value_len;
+    uint8_t*      value;
+    bool          is_notify;
+  } notify;
+  struct gattc_reg_for_notify_evt_param {
+    esp_gatt_status_t status;
+    uint16_t          handle;
+  } reg_for_notify;
+  struct gattc_connect_evt_param {
+    uint16_t               conn_id;
+    uint8_t                link_role;
+    esp_bd_addr_t          remote_bda;
+    esp_gatt_conn_params_t conn_params;
+  } connect;
+  struct gattc_disconnect_evt_param {
+    esp_gatt_conn_reason_t reason;
+    uint16_t               conn_id;
+    esp_bd_addr_t          remote_bda;
+  } disconnect;
+} esp_ble_gattc_cb_param_t;
+
+typedef void (*esp_gattc_cb_t)(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* param);
+
+typedef struct {
+  uint16_t             char_handle;
+  esp_gatt_char_prop_t properties;
+  esp_bt_uuid_t        uuid;
+} esp_gattc_char_elem_t;
+
+typedef struct {
+  uint16_t      handle;
+  esp_bt_uuid_t uuid;
+} esp_gattc_descr_elem_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_ble_gattc_app_register(uint16_t app_id);
+esp_err_t esp_ble_gattc_open(esp_gatt_if_t gattc_if, esp_bd_addr_t remote_bda, esp_ble_addr_type_t remote_addr_type,
+                             bool is_direct);
+esp_err_t esp_ble_gattc_close(esp_gatt_if_t gattc_if, uint16_t conn_id);
+esp_err_t esp_ble_gattc_send_mtu_req(esp_gatt_if_t gattc_if, uint16_t conn_id);
+esp_err_t esp_ble_gattc_search_service(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_bt_uuid_t* filter_uuid);
+esp_gatt_status_t esp_ble_gattc_get_char_by_uuid(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t start_handle,
+                                                 uint16_t end_handle, esp_bt_uuid_t char_uuid,
+                                                 esp_gattc_char_elem_t* result, uint16_t* count);
+esp_gatt_status_t esp_ble_gattc_get_descr_by_char_handle(esp_gatt_if_t gattc_if, uint16_t conn_id,
+                                                         uint16_t char_handle, esp_bt_uuid_t descr_uuid,
+                                                         esp_gattc_descr_elem_t* result, uint16_t* count);
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                  esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t* value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_write_char_descr(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                         uint16_t value_len, uint8_t* value, esp_gatt_write_type_t write_type,
+                                         esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t gattc_if, esp_bd_addr_t server_bda, uint16_t handle);
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu);
+
+#ifdef __cplusplus
+}
+#endif
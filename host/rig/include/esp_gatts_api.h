@@ -0,0 +1,48 @@
+/**
+ * @file esp_gatts_api.h
+ * @brief Bluedroid GATT server event parameters (host rig subset).
+ *
+ * The rig's BLEServer passes these to the server and characteristic
+ * callbacks, as the Arduino library does.
+ */
+
+#pragma once
+#include "esp_gatt_defs.h"
+
+typedef union {
+  struct gatts_connect_evt_param {
+    uint16_t               conn_id;
+    uint8_t                link_role;
+    esp_bd_addr_t          remote_bda;
+    esp_gatt_conn_params_t conn_params;
+  } connect;
+  struct gatts_disconnect_evt_param {
+    uint16_t               conn_id;
+    esp_bd_addr_t          remote_bda;
+    esp_gatt_conn_reason_t reason;
+  } disconnect;
+  struct gatts_mtu_evt_param {
+    uint16_t conn_id;
+    uint16_t mtu;
+  } mtu;
+  struct gatts_read_evt_param {
+    uint16_t      conn_id;
+    uint32_t      trans_id;
+    esp_bd_addr_t bda;
+    uint16_t      handle;
+    uint16_t      offset;
+    bool          is_long;
+    bool          need_rsp;
+  } read;
+  struct gatts_write_evt_param {
+    uint16_t      conn_id;
+    uint32_t      trans_id;
+    esp_bd_addr_t bda;
+    uint16_t      handle;
+    uint16_t      offset;
+    bool          need_rsp;
+    bool          is_prep;
+    uint16_t      len;
+    uint8_t*      value;
+  } write;
+} esp_ble_gatts_cb_param_t;
@@ -0,0 +1,45 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Heap statistics of the host rig.
+ *
+ * Figures come from the C library's allocator (mallinfo2) measured against
+ * a nominal ESP32-S3 internal heap (RIG_HEAP_BYTES), so growth and leaks
+ * show as they would on the device; the largest free block is the free
+ * space, as the host heap does not fragment the same way.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Nominal internal heap after the Bluedroid stack is up (bytes). */
+#ifndef RIG_HEAP_BYTES
+#define RIG_HEAP_BYTES (280 * 1024)
+#endif
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @file esp_pm.h
+ * @brief Power management of the host rig.
+ *
+ * Like an Arduino-core build without tickless idle: frequency scaling is
+ * accepted, automatic light sleep is refused with ESP_ERR_NOT_SUPPORTED.
+ * Locks only count their holders.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct {
+  int  max_freq_mhz;
+  int  min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_t;
+
+typedef enum {
+  ESP_PM_CPU_FREQ_MAX = 0,
+  ESP_PM_APB_FREQ_MAX = 1,
+  ESP_PM_NO_LIGHT_SLEEP = 2,
+} esp_pm_lock_type_t;
+
+typedef struct RigPmLock* esp_pm_lock_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_pm_configure(const void* config);
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char* name, esp_pm_lock_handle_t* out);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t lock);
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t lock);
+
+#ifdef __cplusplus
+}
+#endif
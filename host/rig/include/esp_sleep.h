@@ -0,0 +1,19 @@
+/**
+ * @file esp_sleep.h
+ * @brief Sleep wake-up sources of the host rig (recorded; the rig never sleeps).
+ */
+
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+
+#ifdef __cplusplus
+}
+#endif
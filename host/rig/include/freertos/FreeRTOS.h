@@ -0,0 +1,84 @@
+/**
+ * @file FreeRTOS.h
+ * @brief FreeRTOS types and port macros of the host rig (ESP-IDF flavour).
+ *
+ * Tasks are POSIX threads and run concurrently, like tasks on the two cores
+ * of the ESP32; priorities and core affinity are recorded but not enforced
+ * by the host scheduler. Ticks are milliseconds (configTICK_RATE_HZ 1000),
+ * stack depths are given in bytes as in ESP-IDF, and a critical section is
+ * a recursive lock shared with the device's interrupt thread.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// ============================================================================
+// Types
+// ============================================================================
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+typedef uint8_t      StackType_t;
+
+#define pdTRUE  ((BaseType_t)1)
+#define pdFALSE ((BaseType_t)0)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define errQUEUE_FULL  ((BaseType_t)0)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(t)   ((uint32_t)(((uint64_t)(t) * 1000) / configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY     ((BaseType_t)0x7FFFFFFF)
+#define tskIDLE_PRIORITY   ((UBaseType_t)0)
+#define configMAX_PRIORITIES 25
+#define portNUM_PROCESSORS 2
+
+/** @brief Control block storage of the statically created objects. */
+typedef struct { alignas(16) uint8_t opaque[128]; } StaticTask_t;
+typedef struct { alignas(16) uint8_t opaque[192]; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct { alignas(16) uint8_t opaque[96]; } StaticTimer_t;
+
+struct RigTask;
+struct RigQueue;
+struct RigTimer;
+typedef RigTask*  TaskHandle_t;
+typedef RigQueue* QueueHandle_t;
+typedef RigQueue* SemaphoreHandle_t;
+typedef RigTimer* TimerHandle_t;
+
+typedef void (*TaskFunction_t)(void*);
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+// ============================================================================
+// Critical Sections
+// ============================================================================
+
+/** @brief ESP-IDF spinlock: a recursive lock, nestable like the original. */
+typedef struct { pthread_mutex_t lock; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+static inline void vPortEnterCritical(portMUX_TYPE* mux) { pthread_mutex_lock(&mux->lock); }
+static inline void vPortExitCritical(portMUX_TYPE* mux)  { pthread_mutex_unlock(&mux->lock); }
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
+#define taskENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define taskEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+
+/** @brief Interrupt handlers run on their own thread: nothing to yield. */
+#define portYIELD_FROM_ISR(...)     ((void)0)
+#define portYIELD()                 sched_yield()
+
+#include <sched.h>
@@ -0,0 +1,39 @@
+/**
+ * @file queue.h
+ * @brief FreeRTOS queue API of the host rig.
+ *
+ * A queue is a ring of fixed-size items guarded by a mutex, with one
+ * condition variable per direction. The ISR variants never block and
+ * report no woken task (interrupt handlers run on their own thread).
+ */
+
+#pragma once
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage,
+                                 StaticQueue_t* cb);
+void vQueueDelete(QueueHandle_t q);
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item);
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait);
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t wait);
+BaseType_t xQueueReset(QueueHandle_t q);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q);
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t q, void* item, BaseType_t* woken);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xQueueSendToBack(q, item, wait) xQueueSend((q), (item), (wait))
+#define xQueueSendToBackFromISR(q, item, woken) xQueueSendFromISR((q), (item), (woken))
@@ -0,0 +1,32 @@
+/**
+ * @file semphr.h
+ * @brief FreeRTOS semaphore API of the host rig.
+ *
+ * As in FreeRTOS, a semaphore is a queue of zero-size items: give sends,
+ * take receives. A mutex is created given and, unlike the original, has no
+ * priority inheritance (priorities are not enforced).
+ */
+
+#pragma once
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* cb);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xSemaphoreTake(s, wait)          xQueueReceive((s), NULL, (wait))
+#define xSemaphoreGive(s)                xQueueSend((s), NULL, 0)
+#define xSemaphoreGiveFromISR(s, woken)  xQueueSendFromISR((s), NULL, (woken))
+#define xSemaphoreTakeFromISR(s, woken)  xQueueReceiveFromISR((s), NULL, (woken))
+#define uxSemaphoreGetCount(s)           uxQueueMessagesWaiting(s)
+#define vSemaphoreDelete(s)              vQueueDelete(s)
@@ -0,0 +1,32 @@
+/**
+ * @file timers.h
+ * @brief FreeRTOS software timer API of the host rig.
+ *
+ * Callbacks run on the device's timer service thread, one at a time, in
+ * expiry order. Commands take effect immediately (there is no command
+ * queue), so the wait arguments are ignored.
+ */
+
+#pragma once
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                           TimerCallbackFunction_t cb);
+TimerHandle_t xTimerCreateStatic(const char* name, TickType_t period, UBaseType_t autoReload, void* id,
+                                 TimerCallbackFunction_t cb, StaticTimer_t* buffer);
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerReset(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t wait);
+BaseType_t xTimerDelete(TimerHandle_t t, TickType_t wait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t t);
+void* pvTimerGetTimerID(TimerHandle_t t);
+const char* pcTimerGetName(TimerHandle_t t);
+
+#ifdef __cplusplus
+}
+#endif
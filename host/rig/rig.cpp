@@ -0,0 +1,241 @@
+/**
+ * @file rig.cpp
+ * @brief Host rig: the Tracker and the tag sketches, unmodified, as two
+ *        devices in one Linux process, talking over a simulated radio.
+ *
+ * Each sketch is built into a shared object together with its own copy of
+ * the device core (`core/`: Arduino, ESP-IDF, FreeRTOS and BLE shims over
+ * pthreads), so the two devices keep separate globals as on two boards. The
+ * rig loads both, boots them, and plays a scenario against them through the
+ * world (world.h). Everything runs in real time on ordinary threads, so the
+ * process can be profiled with perf and built with sanitizers.
+ *
+ * Build (Linux, from the repository root):
+ *
+ *     CORE=$(find host/rig/core -name '*.cpp')
+ *     FLAGS="-std=gnu++20 -O1 -g -fPIC -shared -Wl,-Bsymbolic -DARDUINO=10819 -DCONFIG_BLUEDROID_ENABLED \
+ *            -Ihost/rig/include"
+ *     g++ $FLAGS -Iscanner -x c++ scanner/scanner.ino -x none $(find scanner -name '*.cpp') $CORE -o scanner.so -lpthread
+ *     g++ $FLAGS -Iserver -x c++ server/server.ino -x none $(find server -name '*.cpp') $CORE -o server.so -lpthread
+ *     g++ -std=c++17 -O1 -g -rdynamic host/rig/rig.cpp host/rig/world.cpp host/rig/heap.cpp \
+ *         scanner/rpaResolver.cpp -o rig -ldl -lpthread
+ *
+ * The sketches need C++20 (the Tracker's coroutines), as the ESP32 core
+ * builds them. Add `-fsanitize=thread` (or `address,undefined`) to all three commands for
+ * a sanitizer build, and `-fno-omit-frame-pointer` for `perf record -g`.
+ *
+ * Usage:
+ *
+ *     rig [-c cycles] ./scanner.so ./server.so [seconds] [partitions.csv]
+ *
+ * Console lines of both devices are printed with their time and name; lines
+ * marked `*` are actuator and display notes (buzzer tones, LCD rows). The
+ * scenario, for `seconds` (default 90) of real time:
+ *
+ * - the tag starts 1 m from the Tracker and, once linked, walks out to 12 m
+ *   (10-35 s), rests (35-45 s) and walks back (45-65 s);
+ * - a card is presented to the Tracker's reader at 3 s;
+ * - the Tracker's lost button (GPIO 42) is pressed at 20 s, the reset button
+ *   (GPIO 41) at 50 s.
+ *
+ * With `-c`, the scenario is instead `cycles` connect/disconnect cycles:
+ * the tag starts 1 m away and, from 10 s on, every CYCLE_S seconds leaves
+ * range for CYCLE_OUT_S seconds (the link is lost by supervision timeout)
+ * and comes back (the Tracker reconnects). The rig runs until the last
+ * cycle ends (`seconds` is ignored) and collects the `HEAP disconnect`
+ * lines of both sketches, whose figures are each device's own allocations
+ * (heap.cpp). After CYCLE_WARMUP cycles, which may still allocate lazily,
+ * every disconnect must find the device's heap exactly as the previous one
+ * did; the rig prints the figures and exits with status 1 on any growth or
+ * if a device reported fewer than CYCLE_WARMUP + 2 disconnects. Sanitizer
+ * builds keep no per-device accounts and only print the figures.
+ *
+ * `partitions.csv` (default `scanner/partitions.csv`) gives the Tracker its
+ * data partitions. The world's counters are printed at the end.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <atomic>
+#include <string>
+#include "world.h"
+
+#define DEV_SCANNER 0
+#define DEV_SERVER  1
+
+#define PIN_LOST  42
+#define PIN_RESET 41
+
+/** @brief Cycles scenario: period, time out of range and warm-up cycles. */
+#define CYCLE_S      16
+#define CYCLE_OUT_S  6
+#define CYCLE_WARMUP 2
+
+/** @brief Most disconnects recorded per device. */
+#define CYCLE_MAX 256
+
+typedef void (*BootFn)(int id, const char* name, const char* partitionsCsv);
+
+static bool boot(const char* path, int id, const char* name, const char* partitionsCsv) {
+  void* so = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!so) {
+    fprintf(stderr, "rig: %s\n", dlerror());
+    return false;
+  }
+  BootFn fn = (BootFn)dlsym(so, "rigDeviceBoot");
+  if (!fn) {
+    fprintf(stderr, "rig: %s: no rigDeviceBoot\n", path);
+    return false;
+  }
+  fn(id, name, partitionsCsv);
+  return true;
+}
+
+/** @brief Distance of the tag from the Tracker at scenario time `t` (s). */
+static float tagDistance(float t) {
+  if (t < 10) return 1;
+  if (t < 35) return 1 + (t - 10) * 11 / 25;
+  if (t < 45) return 12;
+  if (t < 65) return 12 - (t - 45) * 11 / 20;
+  return 1;
+}
+
+/** @brief Distance of the tag in the cycles scenario. */
+static float cycleDistance(float t) {
+  if (t < 10) return 1;
+  return fmodf(t - 10, CYCLE_S) < CYCLE_OUT_S ? 300 : 1;
+}
+
+/**
+ * @brief Heap figures of a device's `HEAP disconnect` lines.
+ */
+struct Disconnects {
+  unsigned long used[CYCLE_MAX];
+  unsigned long blocks[CYCLE_MAX];
+  std::atomic<unsigned> count;
+};
+
+static Disconnects gDisconnects[RIG_MAX_DEVICES];
+
+static void onLine(int dev, const char* text, size_t len) {
+  static const char kPrefix[] = "HEAP disconnect";
+  if (len < sizeof(kPrefix) - 1 || memcmp(text, kPrefix, sizeof(kPrefix) - 1) != 0) return;
+  std::string line(text, len);
+  const char* used = strstr(line.c_str(), " used=");
+  const char* blocks = strstr(line.c_str(), " blocks=");
+  Disconnects& d = gDisconnects[dev];
+  unsigned n = d.count;
+  if (!used || !blocks || n >= CYCLE_MAX) return;
+  d.used[n] = strtoul(used + 6, nullptr, 10);
+  d.blocks[n] = strtoul(blocks + 8, nullptr, 10);
+  d.count = n + 1;
+}
+
+/**
+ * @brief Print a device's disconnect figures and check them after warm-up.
+ *
+ * @return False on growth, or too few disconnects to tell.
+ */
+static bool checkDisconnects(int dev, const char* name, bool accounted) {
+  const Disconnects& d = gDisconnects[dev];
+  unsigned n = d.count;
+  printf("rig: %s heap at disconnect (used/blocks):", name);
+  for (unsigned i = 0; i < n; i++) printf(" %lu/%lu", d.used[i], d.blocks[i]);
+  printf("\n");
+  if (!accounted) {
+    printf("rig: %s: process-wide figures, not checked\n", name);
+    return true;
+  }
+  if (n < CYCLE_WARMUP + 2) {
+    printf("rig: %s: %u disconnects, need %u\n", name, n, CYCLE_WARMUP + 2);
+    return false;
+  }
+  long net = (long)d.used[n - 1] - (long)d.used[CYCLE_WARMUP];
+  long netBlocks = (long)d.blocks[n - 1] - (long)d.blocks[CYCLE_WARMUP];
+  bool flat = true;
+  for (unsigned i = CYCLE_WARMUP + 1; i < n; i++) {
+    if (d.used[i] != d.used[i - 1] || d.blocks[i] != d.blocks[i - 1]) flat = false;
+  }
+  printf("rig: %s: net %+ld bytes, %+ld blocks over %u cycles after warm-up%s\n", name, net, netBlocks,
+         n - 1 - CYCLE_WARMUP, flat ? "" : ": GROWTH");
+  return flat;
+}
+
+static void press(int dev, uint8_t pin, uint32_t ms) {
+  rigWorldPin(dev, pin, 0);   // buttons pull up, active low
+  usleep(ms * 1000);
+  rigWorldPin(dev, pin, 1);
+}
+
+int main(int argc, char** argv) {
+  unsigned cycles = 0;
+  if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+    cycles = (unsigned)atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc < 3) {
+    fprintf(stderr, "usage: rig [-c cycles] <scanner.so> <server.so> [seconds] [partitions.csv]\n");
+    return 2;
+  }
+  unsigned seconds = argc > 3 ? (unsigned)atoi(argv[3]) : 90;
+  const char* csv = argc > 4 ? argv[4] : "scanner/partitions.csv";
+  if (cycles) {
+    seconds = 10 + cycles * CYCLE_S;
+    rigWorldOnLine(onLine);
+  }
+
+  rigWorldStart(1);
+  rigWorldPlace(DEV_SCANNER, 0);
+  rigWorldPlace(DEV_SERVER, 1);
+  if (!boot(argv[1], DEV_SCANNER, "scanner", csv)) return 1;
+  if (!boot(argv[2], DEV_SERVER, "server", nullptr)) return 1;
+
+  static const uint8_t card[] = { 0x04, 0x81, 0x70, 0x0A, 0x9C, 0x14, 0x90 };
+  bool cardDone = false, lostDone = false, resetDone = false;
+  uint64_t start = rigNowUs();
+  for (;;) {
+    float t = (rigNowUs() - start) / 1e6f;
+    if (t >= seconds) break;
+    if (cycles) {
+      rigWorldPlace(DEV_SERVER, cycleDistance(t));
+      usleep(10000);
+      continue;
+    }
+    float d = tagDistance(t);
+    rigWorldPlace(DEV_SERVER, d);
+    rigWorldSetMoving(DEV_SERVER, t >= 10 && t < 65 && !(t >= 35 && t < 45));
+    if (!cardDone && t >= 3) {
+      rigWorldCard(DEV_SCANNER, card, sizeof(card));
+      cardDone = true;
+    }
+    if (!lostDone && t >= 20) {
+      press(DEV_SCANNER, PIN_LOST, 200);
+      lostDone = true;
+    }
+    if (!resetDone && t >= 50) {
+      press(DEV_SCANNER, PIN_RESET, 200);
+      resetDone = true;
+    }
+    usleep(10000);
+  }
+
+  RigWorldStats s = rigWorldStats();
+  printf("rig: %u s: adv events %u, reports %u, links up %u, lost %u, connect fails %u, pdus %u, "
+         "rssi reads %u, notes %u\n",
+         seconds, s.advSent, s.advHeard, s.linksUp, s.linksLost, s.connectFails, s.pdus, s.rssiReads, s.notes);
+  int status = 0;
+  if (cycles) {
+    bool accounted = rigHeapUsage(DEV_SCANNER, nullptr, nullptr);
+    bool ok = checkDisconnects(DEV_SCANNER, "scanner", accounted);
+    ok = checkDisconnects(DEV_SERVER, "server", accounted) && ok;
+    status = ok ? 0 : 1;
+  }
+  fflush(stdout);
+  _exit(status);   // the sketches' tasks never return
+}
@@ -0,0 +1,561 @@
+/**
+ * @file world.cpp
+ * @brief The host rig's world: clock, consoles, air, links and environment
+ *        shared by the devices (world.h).
+ *
+ * One thread steps the world every millisecond. Messages for the devices are
+ * collected under the world lock and delivered to the inboxes after it is
+ * released, so a core may call back into the world from any of its threads.
+ *
+ * Radio model, as in rssiSim and linkSim: RSSI = -52 - 25 log10(d) plus
+ * N(0, 2 dB), heard down to -95 dBm; advertising events every interval plus
+ * a 0-10 ms advDelay; a connection forms at the target's next advertising
+ * event and carries up to 4 PDUs per direction per 30 ms connection event;
+ * a link whose RSSI stays below the sensitivity for 4 s is lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "world.h"
+#include "../../scanner/rpaResolver.h"
+
+#define TICK_US              1000
+#define ADV_DELAY_MAX_US     10000
+#define CONN_INTERVAL_US     30000
+#define CONN_TIMEOUT_US      30000000
+#define SUPERVISION_US       4000000
+#define PDUS_PER_EVENT       4
+#define RSSI_AT_1M           -52.0f
+#define PATH_LOSS_SLOPE      25.0f
+#define RSSI_SIGMA           2.0f
+#define SENSITIVITY_DBM      -95
+
+/** @brief Battery of a device at the start (mV) and its drain (mV per hour). */
+#define BATTERY_START_MV     3950
+#define BATTERY_DRAIN_MV_H   20
+
+struct Device {
+  RigInbox           inbox = nullptr;
+  std::string        line;          /**< Console output not yet terminated. */
+  std::deque<uint8_t> serialIn;
+  float              x = 0;
+  bool               moving = false;
+
+  bool     advOn = false;
+  uint8_t  advAddr[6];
+  uint8_t  advType = RIG_ADDR_PUBLIC;
+  uint8_t  advData[31];
+  size_t   advLen = 0;
+  uint32_t advIntervalUs = 0;
+  uint64_t advNextUs = 0;
+
+  bool     scanOn = false;
+  uint32_t scanIntervalUs = 0;
+  uint32_t scanWindowUs = 0;
+  uint64_t scanStartUs = 0;
+
+  bool     connecting = false;
+  uint8_t  connectAddr[6];
+  uint64_t connectDeadlineUs = 0;
+};
+
+struct Link {
+  int      dev[2];          /**< Central, peripheral. */
+  uint8_t  addr[2][6];      /**< Address each end knows the other by. */
+  uint8_t  addrType[2];
+  std::deque<std::string> out[2];   /**< PDUs from each end. */
+  bool     rssiReq = false;
+  uint64_t nextEventUs;
+  uint64_t weakSinceUs = 0;
+  int      closedBy = -1;   /**< End that asked for the close. */
+};
+
+struct Delivery {
+  int    dev;
+  RigMsg msg;
+};
+
+static pthread_mutex_t gWorld = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gStdout = PTHREAD_MUTEX_INITIALIZER;
+static std::atomic<RigLineHook> gLineHook{ nullptr };
+static Device gDevs[RIG_MAX_DEVICES];
+static std::map<int16_t, Link> gLinks;
+static int16_t gNextLink = 1;
+static uint64_t gRng = 0x9e3779b97f4a7c15ull;
+static RigWorldStats gStats;
+
+static uint64_t monoUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static const uint64_t gStartUs = monoUs();
+
+static const char* const kNames[RIG_MAX_DEVICES] = { "scanner", "server", "dev2", "dev3" };
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/** @brief xorshift64*, under the world lock. */
+static uint32_t rnd() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return (uint32_t)((gRng * 2685821657736338717ull) >> 32);
+}
+
+static float gauss() {
+  float u1 = (rnd() + 1.0f) / 4294967296.0f;
+  float u2 = rnd() / 4294967296.0f;
+  return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+static int rssiBetween(int a, int b) {
+  float d = fabsf(gDevs[a].x - gDevs[b].x);
+  if (d < 0.1f) d = 0.1f;
+  float rssi = RSSI_AT_1M - PATH_LOSS_SLOPE * log10f(d) + RSSI_SIGMA * gauss();
+  if (rssi > -20) rssi = -20;
+  if (rssi < -127) rssi = -127;
+  return (int)lroundf(rssi);
+}
+
+static bool valid(int dev) {
+  return dev >= 0 && dev < RIG_MAX_DEVICES;
+}
+
+static RigMsg blank(RigMsgType type) {
+  RigMsg m;
+  memset(&m, 0, offsetof(RigMsg, data));
+  m.type = type;
+  return m;
+}
+
+static void deliver(std::vector<Delivery>& out) {
+  for (Delivery& d : out) {
+    RigInbox inbox;
+    pthread_mutex_lock(&gWorld);
+    inbox = gDevs[d.dev].inbox;
+    pthread_mutex_unlock(&gWorld);
+    if (inbox) inbox(&d.msg);
+  }
+  out.clear();
+}
+
+// ============================================================================
+// Clock and Consoles
+// ============================================================================
+
+uint64_t rigNowUs(void) {
+  return monoUs() - gStartUs;
+}
+
+void rigWorldRegister(int dev, RigInbox inbox) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  gDevs[dev].inbox = inbox;
+  pthread_mutex_unlock(&gWorld);
+}
+
+static void printLine(int dev, const char* mark, const char* text, size_t len) {
+  uint64_t now = rigNowUs();
+  pthread_mutex_lock(&gStdout);
+  printf("%4u.%03u [%s]%s %.*s\n", (unsigned)(now / 1000000), (unsigned)(now / 1000 % 1000), kNames[dev], mark,
+         (int)len, text);
+  fflush(stdout);
+  pthread_mutex_unlock(&gStdout);
+  RigLineHook hook = gLineHook;
+  if (hook && !*mark) hook(dev, text, len);
+}
+
+void rigSerialOut(int dev, const uint8_t* data, size_t len) {
+  if (!valid(dev)) return;
+  std::vector<std::string> lines;
+  pthread_mutex_lock(&gWorld);
+  std::string& line = gDevs[dev].line;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == '\n') {
+      lines.push_back(line);
+      line.clear();
+    } else if (data[i] != '\r') {
+      line += (char)data[i];
+    }
+  }
+  pthread_mutex_unlock(&gWorld);
+  for (const std::string& l : lines) printLine(dev, "", l.data(), l.size());
+}
+
+size_t rigSerialAvailable(int dev) {
+  if (!valid(dev)) return 0;
+  pthread_mutex_lock(&gWorld);
+  size_t n = gDevs[dev].serialIn.size();
+  pthread_mutex_unlock(&gWorld);
+  return n;
+}
+
+size_t rigSerialIn(int dev, uint8_t* buf, size_t max) {
+  if (!valid(dev)) return 0;
+  pthread_mutex_lock(&gWorld);
+  std::deque<uint8_t>& in = gDevs[dev].serialIn;
+  size_t n = 0;
+  while (n < max && !in.empty()) {
+    buf[n++] = in.front();
+    in.pop_front();
+  }
+  pthread_mutex_unlock(&gWorld);
+  return n;
+}
+
+void rigNote(int dev, const char* text) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  gStats.notes++;
+  pthread_mutex_unlock(&gWorld);
+  printLine(dev, " *", text, strlen(text));
+}
+
+// ============================================================================
+// Radio
+// ============================================================================
+
+void rigAdvertise(int dev, const uint8_t addr[6], uint8_t addrType, const uint8_t* data, size_t len,
+                  uint32_t intervalUs) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  Device& d = gDevs[dev];
+  if (!d.advOn) d.advNextUs = rigNowUs() + rnd() % ADV_DELAY_MAX_US;
+  d.advOn = true;
+  memcpy(d.advAddr, addr, 6);
+  d.advType = addrType;
+  d.advLen = len < sizeof(d.advData) ? len : sizeof(d.advData);
+  memcpy(d.advData, data, d.advLen);
+  d.advIntervalUs = intervalUs < 20000 ? 20000 : intervalUs;
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigRpa(const uint8_t irk[16], uint32_t seed, uint8_t addr[6]) {
+  uint32_t h = (seed + 1) * 2654435761u;
+  h ^= h >> 15;
+  uint8_t prand[3] = { (uint8_t)(0x40 | ((h >> 16) & 0x3F)), (uint8_t)(h >> 8), (uint8_t)h };
+  uint8_t hash[3];
+  rpaHash(irk, prand, hash);
+  memcpy(addr, prand, 3);
+  memcpy(addr + 3, hash, 3);
+}
+
+void rigAdvertiseStop(int dev) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  gDevs[dev].advOn = false;
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigScan(int dev, bool on, uint32_t intervalUs, uint32_t windowUs) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  Device& d = gDevs[dev];
+  d.scanOn = on;
+  d.scanIntervalUs = intervalUs ? intervalUs : 100000;
+  d.scanWindowUs = windowUs < d.scanIntervalUs ? windowUs : d.scanIntervalUs;
+  d.scanStartUs = rigNowUs();
+  pthread_mutex_unlock(&gWorld);
+}
+
+bool rigConnect(int dev, const uint8_t addr[6]) {
+  if (!valid(dev)) return false;
+  pthread_mutex_lock(&gWorld);
+  Device& d = gDevs[dev];
+  bool ok = !d.connecting;
+  if (ok) {
+    d.connecting = true;
+    memcpy(d.connectAddr, addr, 6);
+    d.connectDeadlineUs = rigNowUs() + CONN_TIMEOUT_US;
+  }
+  pthread_mutex_unlock(&gWorld);
+  return ok;
+}
+
+void rigConnectCancel(int dev, const uint8_t addr[6]) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  Device& d = gDevs[dev];
+  if (d.connecting && memcmp(d.connectAddr, addr, 6) == 0) d.connectDeadlineUs = 0;   // fails at the next step
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigDisconnect(int dev, int16_t link) {
+  pthread_mutex_lock(&gWorld);
+  auto it = gLinks.find(link);
+  if (it != gLinks.end() && it->second.closedBy < 0) {
+    it->second.closedBy = it->second.dev[0] == dev ? 0 : 1;
+  }
+  pthread_mutex_unlock(&gWorld);
+}
+
+bool rigSend(int dev, int16_t link, const uint8_t* pdu, size_t len) {
+  if (len > RIG_MSG_DATA) return false;
+  pthread_mutex_lock(&gWorld);
+  auto it = gLinks.find(link);
+  bool ok = it != gLinks.end() && it->second.closedBy < 0;
+  if (ok) it->second.out[it->second.dev[0] == dev ? 0 : 1].push_back(std::string((const char*)pdu, len));
+  pthread_mutex_unlock(&gWorld);
+  return ok;
+}
+
+bool rigReadRssi(int dev, int16_t link) {
+  pthread_mutex_lock(&gWorld);
+  auto it = gLinks.find(link);
+  bool ok = it != gLinks.end() && it->second.dev[0] == dev;
+  if (ok) it->second.rssiReq = true;
+  pthread_mutex_unlock(&gWorld);
+  return ok;
+}
+
+// ============================================================================
+// Environment
+// ============================================================================
+
+bool rigMoving(int dev) {
+  if (!valid(dev)) return false;
+  pthread_mutex_lock(&gWorld);
+  bool moving = gDevs[dev].moving;
+  pthread_mutex_unlock(&gWorld);
+  return moving;
+}
+
+uint16_t rigBatteryMv(int dev) {
+  (void)dev;
+  return (uint16_t)(BATTERY_START_MV - rigNowUs() * BATTERY_DRAIN_MV_H / 3600000000ull);
+}
+
+// ============================================================================
+// Stepping
+// ============================================================================
+
+/** @brief One advertising event of `a` (world lock held). */
+static void advertisingEvent(int a, uint64_t now, std::vector<Delivery>& out) {
+  Device& adv = gDevs[a];
+  gStats.advSent++;
+  for (int s = 0; s < RIG_MAX_DEVICES; s++) {
+    Device& d = gDevs[s];
+    if (s == a || !d.inbox) continue;
+    int rssi = rssiBetween(a, s);
+    if (rssi < SENSITIVITY_DBM) continue;
+
+    if (d.connecting && memcmp(d.connectAddr, adv.advAddr, 6) == 0) {
+      int16_t id = gNextLink++;
+      Link& l = gLinks[id];
+      l.dev[0] = s;
+      l.dev[1] = a;
+      memcpy(l.addr[0], adv.advAddr, 6);
+      l.addrType[0] = adv.advType;
+      memset(l.addr[1], 0, 6);
+      l.addr[1][5] = (uint8_t)s;
+      l.addr[1][0] = 0x24;
+      l.addrType[1] = RIG_ADDR_PUBLIC;
+      l.nextEventUs = now + CONN_INTERVAL_US;
+      d.connecting = false;
+      adv.advOn = false;
+      gStats.linksUp++;
+      for (int end = 0; end < 2; end++) {
+        Delivery dv{ l.dev[end], blank(RIG_MSG_LINK_UP) };
+        dv.msg.link = id;
+        dv.msg.central = end == 0;
+        memcpy(dv.msg.addr, l.addr[end], 6);
+        dv.msg.addrType = l.addrType[end];
+        dv.msg.intervalUs = CONN_INTERVAL_US;
+        out.push_back(dv);
+      }
+      return;
+    }
+
+    if (!d.scanOn) continue;
+    if ((now - d.scanStartUs) % d.scanIntervalUs >= d.scanWindowUs) continue;
+    Delivery dv{ s, blank(RIG_MSG_ADV_REPORT) };
+    memcpy(dv.msg.addr, adv.advAddr, 6);
+    dv.msg.addrType = adv.advType;
+    dv.msg.rssi = (int8_t)rssi;
+    dv.msg.len = (uint16_t)adv.advLen;
+    memcpy(dv.msg.data, adv.advData, adv.advLen);
+    out.push_back(dv);
+    gStats.advHeard++;
+  }
+}
+
+/** @brief Close a link at both ends (world lock held). */
+static void linkDown(int16_t id, Link& l, uint8_t reason, std::vector<Delivery>& out) {
+  for (int end = 0; end < 2; end++) {
+    Delivery dv{ l.dev[end], blank(RIG_MSG_LINK_DOWN) };
+    dv.msg.link = id;
+    memcpy(dv.msg.addr, l.addr[end], 6);
+    dv.msg.len = 1;
+    dv.msg.data[0] = l.closedBy < 0 ? reason : (l.closedBy == end ? 0x16 : 0x13);
+    out.push_back(dv);
+  }
+}
+
+/** @brief One connection event of a link; false once it is closed (world lock held). */
+static bool connectionEvent(int16_t id, Link& l, uint64_t now, std::vector<Delivery>& out) {
+  if (l.closedBy >= 0) {
+    linkDown(id, l, 0, out);
+    return false;
+  }
+  int rssi = rssiBetween(l.dev[0], l.dev[1]);
+  if (rssi >= SENSITIVITY_DBM) {
+    l.weakSinceUs = 0;
+  } else {
+    if (!l.weakSinceUs) l.weakSinceUs = now;
+    if (now - l.weakSinceUs >= SUPERVISION_US) {
+      gStats.linksLost++;
+      linkDown(id, l, 0x08, out);
+      return false;
+    }
+    return true;   // nothing crosses this event
+  }
+
+  for (int from = 0; from < 2; from++) {
+    for (int n = 0; n < PDUS_PER_EVENT && !l.out[from].empty(); n++) {
+      const std::string& pdu = l.out[from].front();
+      Delivery dv{ l.dev[1 - from], blank(RIG_MSG_PDU) };
+      dv.msg.link = id;
+      memcpy(dv.msg.addr, l.addr[1 - from], 6);
+      dv.msg.len = (uint16_t)pdu.size();
+      memcpy(dv.msg.data, pdu.data(), pdu.size());
+      out.push_back(dv);
+      l.out[from].pop_front();
+      gStats.pdus++;
+    }
+  }
+  if (l.rssiReq) {
+    l.rssiReq = false;
+    Delivery dv{ l.dev[0], blank(RIG_MSG_RSSI) };
+    dv.msg.link = id;
+    memcpy(dv.msg.addr, l.addr[0], 6);
+    dv.msg.rssi = (int8_t)rssi;
+    out.push_back(dv);
+    gStats.rssiReads++;
+  }
+  return true;
+}
+
+static void step(uint64_t now, std::vector<Delivery>& out) {
+  for (int a = 0; a < RIG_MAX_DEVICES; a++) {
+    Device& d = gDevs[a];
+    if (d.advOn && now >= d.advNextUs) {
+      d.advNextUs = now + d.advIntervalUs + rnd() % ADV_DELAY_MAX_US;
+      advertisingEvent(a, now, out);
+    }
+    if (d.connecting && now >= d.connectDeadlineUs) {
+      d.connecting = false;
+      gStats.connectFails++;
+      Delivery dv{ a, blank(RIG_MSG_LINK_FAIL) };
+      memcpy(dv.msg.addr, d.connectAddr, 6);
+      out.push_back(dv);
+    }
+  }
+  for (auto it = gLinks.begin(); it != gLinks.end();) {
+    Link& l = it->second;
+    if (now < l.nextEventUs) {
+      ++it;
+      continue;
+    }
+    l.nextEventUs += CONN_INTERVAL_US;
+    if (connectionEvent(it->first, l, now, out)) ++it;
+    else it = gLinks.erase(it);
+  }
+}
+
+static void* worldThread(void* arg) {
+  (void)arg;
+  pthread_setname_np(pthread_self(), "world");
+  std::vector<Delivery> out;
+  uint64_t next = rigNowUs();
+  for (;;) {
+    next += TICK_US;
+    uint64_t now = rigNowUs();
+    if (next > now) {
+      struct timespec ts = { 0, (long)(next - now) * 1000 };
+      nanosleep(&ts, nullptr);
+    } else if (now - next > 100 * TICK_US) {
+      next = now;   // fell behind (debugger, sanitizer): do not replay the gap
+    }
+    pthread_mutex_lock(&gWorld);
+    step(rigNowUs(), out);
+    pthread_mutex_unlock(&gWorld);
+    deliver(out);
+  }
+  return nullptr;
+}
+
+// ============================================================================
+// Rig Control
+// ============================================================================
+
+void rigWorldStart(uint32_t seed) {
+  pthread_mutex_lock(&gWorld);
+  gRng ^= (uint64_t)seed * 0x2545F4914F6CDD1Dull;
+  if (!gRng) gRng = 1;
+  pthread_mutex_unlock(&gWorld);
+  pthread_t t;
+  pthread_create(&t, nullptr, worldThread, nullptr);
+  pthread_detach(t);
+}
+
+void rigWorldPlace(int dev, float x) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  gDevs[dev].x = x;
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigWorldSetMoving(int dev, bool moving) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  gDevs[dev].moving = moving;
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigWorldPin(int dev, uint8_t pin, uint8_t level) {
+  if (!valid(dev)) return;
+  std::vector<Delivery> out(1, Delivery{ dev, blank(RIG_MSG_GPIO) });
+  out[0].msg.pin = pin;
+  out[0].msg.level = level;
+  deliver(out);
+}
+
+void rigWorldCard(int dev, const uint8_t* uid, size_t len) {
+  if (!valid(dev) || len > 10) return;
+  std::vector<Delivery> out(1, Delivery{ dev, blank(RIG_MSG_CARD) });
+  out[0].msg.len = (uint16_t)len;
+  memcpy(out[0].msg.data, uid, len);
+  deliver(out);
+}
+
+void rigWorldSerialIn(int dev, const char* line) {
+  if (!valid(dev)) return;
+  pthread_mutex_lock(&gWorld);
+  for (const char* p = line; *p; p++) gDevs[dev].serialIn.push_back((uint8_t)*p);
+  gDevs[dev].serialIn.push_back('\n');
+  pthread_mutex_unlock(&gWorld);
+}
+
+void rigWorldOnLine(RigLineHook hook) {
+  gLineHook = hook;
+}
+
+RigWorldStats rigWorldStats(void) {
+  pthread_mutex_lock(&gWorld);
+  RigWorldStats s = gStats;
+  pthread_mutex_unlock(&gWorld);
+  return s;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file world.h
+ * @brief What the devices of the host rig share: the clock, the radio, the
+ *        serial consoles and the scripted environment.
+ *
+ * Each sketch is built with its own copy of the device core (the Arduino,
+ * ESP-IDF, FreeRTOS and BLE shims in `core/`), as on the boards; the cores
+ * only meet here. The world is linked into the rig executable and called
+ * by the cores through these functions:
+ *
+ * - the air delivers advertisements to scanning devices at the advertiser's
+ *   interval plus advDelay, while the scanner's window is open and the RSSI
+ *   is above the sensitivity;
+ * - a link carries opaque PDUs between two devices, each delivered at one of
+ *   the link's connection events;
+ * - the scenario moves the tag, presents cards and presses buttons.
+ *
+ * Everything a device receives arrives in its inbox (`RigInbox`), called
+ * from the world's thread; the core queues it for its BLE or interrupt
+ * thread and returns.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Devices in one rig. */
+#define RIG_MAX_DEVICES 4
+
+/** @brief Largest payload of one message (a PDU, an advertisement or a UID). */
+#define RIG_MSG_DATA 512
+
+/** @brief Address types, as Bluedroid numbers them. */
+#define RIG_ADDR_PUBLIC 0
+#define RIG_ADDR_RANDOM 1
+
+// ============================================================================
+// Messages
+// ============================================================================
+
+/**
+ * @brief What arrived in a device's inbox.
+ */
+enum RigMsgType : uint8_t {
+  RIG_MSG_ADV_REPORT = 0,   /**< An advertisement was heard (scanning devices). */
+  RIG_MSG_LINK_UP    = 1,   /**< A link opened (both ends). */
+  RIG_MSG_LINK_FAIL  = 2,   /**< A connection attempt failed or was cancelled (initiator). */
+  RIG_MSG_LINK_DOWN  = 3,   /**< A link closed (both ends). */
+  RIG_MSG_PDU        = 4,   /**< A PDU from the peer of a link. */
+  RIG_MSG_RSSI       = 5,   /**< Result of an RSSI read (initiator). */
+  RIG_MSG_GPIO       = 6,   /**< An input pin changed level. */
+  RIG_MSG_CARD       = 7,   /**< A card was presented to the RFID reader. */
+};
+
+/**
+ * @brief One inbox message.
+ */
+struct RigMsg {
+  RigMsgType type;
+  uint8_t    addr[6];     /**< Peer or advertiser address, most significant byte first. */
+  uint8_t    addrType;    /**< RIG_ADDR_PUBLIC or RIG_ADDR_RANDOM. */
+  int8_t     rssi;        /**< ADV_REPORT and RSSI (dBm). */
+  bool       central;     /**< LINK_UP: this end initiated the link. */
+  int16_t    link;        /**< Link of LINK_*, PDU and RSSI messages. */
+  uint32_t   intervalUs;  /**< LINK_UP: connection interval. */
+  uint8_t    pin;         /**< GPIO: pin number. */
+  uint8_t    level;       /**< GPIO: new level. */
+  uint16_t   len;         /**< Bytes in `data`. */
+  uint8_t    data[RIG_MSG_DATA];   /**< Advertisement, PDU or card UID. */
+};
+
+/**
+ * @brief A device's inbox (called from the world's thread).
+ */
+typedef void (*RigInbox)(const RigMsg* msg);
+
+// ============================================================================
+// Clock and Consoles
+// ============================================================================
+
+/**
+ * @brief Microseconds since the rig started, shared by all devices.
+ */
+uint64_t rigNowUs(void);
+
+/**
+ * @brief Connect a device's inbox; called once by its core at boot.
+ */
+void rigWorldRegister(int dev, RigInbox inbox);
+
+/**
+ * @brief Bytes a device wrote to its serial port.
+ */
+void rigSerialOut(int dev, const uint8_t* data, size_t len);
+
+/**
+ * @brief Bytes waiting on a device's serial port.
+ */
+size_t rigSerialAvailable(int dev);
+
+/**
+ * @brief Read from a device's serial port without blocking.
+ */
+size_t rigSerialIn(int dev, uint8_t* buf, size_t max);
+
+/**
+ * @brief Report an actuator or display change ("buzzer 1000 Hz", LCD rows).
+ */
+void rigNote(int dev, const char* text);
+
+// ============================================================================
+// Radio
+// ============================================================================
+
+/**
+ * @brief Start (or update) advertising.
+ *
+ * @param[in] addr       Address to advertise from, most significant byte first.
+ * @param[in] addrType   RIG_ADDR_PUBLIC or RIG_ADDR_RANDOM.
+ * @param[in] data       Advertising data (AD structures).
+ * @param[in] len        Its length (at most 31).
+ * @param[in] intervalUs Advertising interval, before advDelay.
+ */
+void rigAdvertise(int dev, const uint8_t addr[6], uint8_t addrType, const uint8_t* data, size_t len,
+                  uint32_t intervalUs);
+
+/**
+ * @brief A resolvable private address for an identity resolving key.
+ *
+ * @param[in]  irk  IRK, most significant byte first.
+ * @param[in]  seed Picks the random part.
+ * @param[out] addr Address, most significant byte first.
+ */
+void rigRpa(const uint8_t irk[16], uint32_t seed, uint8_t addr[6]);
+
+/**
+ * @brief Stop advertising.
+ */
+void rigAdvertiseStop(int dev);
+
+/**
+ * @brief Start or stop scanning with a window and interval (us).
+ */
+void rigScan(int dev, bool on, uint32_t intervalUs, uint32_t windowUs);
+
+/**
+ * @brief Connect to the device advertising from `addr`.
+ *
+ * Completes with LINK_UP at both ends, or LINK_FAIL at the initiator if
+ * nobody connectable advertises from the address within the timeout.
+ *
+ * @return False if a connection attempt is already pending.
+ */
+bool rigConnect(int dev, const uint8_t addr[6]);
+
+/**
+ * @brief Cancel a pending connection attempt (LINK_FAIL follows).
+ */
+void rigConnectCancel(int dev, const uint8_t addr[6]);
+
+/**
+ * @brief Close a link (LINK_DOWN at both ends).
+ */
+void rigDisconnect(int dev, int16_t link);
+
+/**
+ * @brief Queue a PDU to the peer of a link, for its next connection event.
+ *
+ * @return False if the link is not open.
+ */
+bool rigSend(int dev, int16_t link, const uint8_t* pdu, size_t len);
+
+/**
+ * @brief Read the RSSI of a link (RSSI message at the next connection event).
+ */
+bool rigReadRssi(int dev, int16_t link);
+
+// ============================================================================
+// Heap (heap.cpp)
+// ============================================================================
+
+/**
+ * @brief Charge the calling thread's allocations to a device (-1: the world).
+ *
+ * A block stays charged to the account of the thread that allocated it
+ * until it is freed, by whichever thread.
+ */
+void rigHeapThread(int dev);
+
+/**
+ * @brief Bytes and blocks allocated for a device and not yet freed.
+ *
+ * @return False in a sanitizer build, which keeps no accounts.
+ */
+bool rigHeapUsage(int dev, size_t* bytes, size_t* blocks);
+
+// ============================================================================
+// Environment
+// ============================================================================
+
+/**
+ * @brief Whether the scenario is moving the device (for its IMU).
+ */
+bool rigMoving(int dev);
+
+/**
+ * @brief Cell voltage of the device's battery (mV).
+ */
+uint16_t rigBatteryMv(int dev);
+
+// ============================================================================
+// Rig Control (rig.cpp)
+// ============================================================================
+
+/**
+ * @brief Start the world's thread (air, links, consoles).
+ */
+void rigWorldStart(uint32_t seed);
+
+/**
+ * @brief Place a device on the rig's line (m); RSSI follows the distance.
+ */
+void rigWorldPlace(int dev, float x);
+
+/**
+ * @brief Mark a device as moving or still (its IMU follows).
+ */
+void rigWorldSetMoving(int dev, bool moving);
+
+/**
+ * @brief Drive an input pin of a device from outside.
+ */
+void rigWorldPin(int dev, uint8_t pin, uint8_t level);
+
+/**
+ * @brief Present a card to a device's RFID reader.
+ */
+void rigWorldCard(int dev, const uint8_t* uid, size_t len);
+
+/**
+ * @brief Type a line on a device's serial port.
+ */
+void rigWorldSerialIn(int dev, const char* line);
+
+/**
+ * @brief Console line of a device (without the line break).
+ */
+typedef void (*RigLineHook)(int dev, const char* text, size_t len);
+
+/**
+ * @brief Also pass every console line to a hook (nullptr: none).
+ *
+ * The hook runs on the device's thread, after the line is printed.
+ */
+void rigWorldOnLine(RigLineHook hook);
+
+/**
+ * @brief Counters of the world since the start.
+ */
+struct RigWorldStats {
+  uint32_t advSent;       /**< Advertising events. */
+  uint32_t advHeard;      /**< Advertising reports delivered. */
+  uint32_t linksUp;       /**< Links opened. */
+  uint32_t linksLost;     /**< Links closed by supervision timeout. */
+  uint32_t connectFails;  /**< Connection attempts failed or cancelled. */
+  uint32_t pdus;          /**< PDUs carried. */
+  uint32_t rssiReads;     /**< RSSI reads answered. */
+  uint32_t notes;         /**< Actuator and display notes. */
+};
+
+RigWorldStats rigWorldStats(void);
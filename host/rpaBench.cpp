@@ -0,0 +1,232 @@
+/**
+ * @file rpaBench.cpp
+ * @brief Per-advertisement cost of resolving private addresses with the
+ *        tracker's RPA resolver (scanner/rpaResolver.cpp) at 10, 100 and
+ *        1000 bonded IRKs.
+ *
+ * The stream replays what `isOwnedTag()` sees over two hours of back-to-back
+ * 5 s scans, one call per address per scan (the BLE library keeps one result
+ * per address):
+ *
+ * - up to 8 bonded tags in range, each rotating its RPA every 15 minutes;
+ * - every tenth scan, one other bonded tag passing by with a fresh RPA;
+ * - 30 phones advertising from RPAs of their own, which match no IRK and
+ *   also rotate every 15 minutes.
+ *
+ * For each IRK count the stream goes through the resolver (address cache,
+ * hit-ordered IRKs, precomputed key schedules) and, for the first
+ * BENCH_NAIVE advertisements, through a resolver without any of these that
+ * expands each IRK and computes `ah` per advertisement, as a stack does
+ * without a resolving list. Reported per advertisement: time, AES blocks
+ * and, for the resolver, the cache hit rate and the cost of a cold miss (a
+ * phone's new address, tried against every IRK).
+ *
+ * Every owned address must resolve to its tag and every phone's must not,
+ * and registering a tag's key again must keep its address cached; the
+ * bench exits with status 1 otherwise.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 -DRPA_MAX_IRKS=1024 rpaBench.cpp ../scanner/rpaResolver.cpp -o rpaBench
+ *
+ * Usage:
+ *
+ *     rpaBench [irkCounts...]
+ *
+ * IRK counts default to 10 100 1000 (at most RPA_MAX_IRKS).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "../scanner/rpaResolver.h"
+
+/** @brief Scans replayed (two hours of 5 s scans). */
+#define BENCH_SCANS 1440
+
+/** @brief Scans between RPA rotations (15 minutes). */
+#define BENCH_ROTATE 180
+
+/** @brief Bonded tags in range at most. */
+#define BENCH_NEAR 8
+
+/** @brief Phones in range, advertising unresolvable RPAs. */
+#define BENCH_PHONES 30
+
+/** @brief Advertisements replayed through the naive resolver. */
+#define BENCH_NAIVE 2000
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Deterministic xorshift64* stream. */
+static uint64_t gRng = 0x2545f4914f6cdd1dULL;
+static uint64_t next64() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return gRng * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief One advertisement and the answer expected.
+ */
+struct Adv {
+  uint8_t addr[6];  /**< Address, most significant byte first. */
+  int16_t id;       /**< Expected identifier, -1 for a phone. */
+  bool    cold;     /**< First sighting of a phone's address. */
+};
+
+/**
+ * @brief Make a resolvable private address; with `irk` it resolves to it.
+ */
+static void makeRpa(const uint8_t* irk, uint8_t addr[6]) {
+  uint64_t r = next64();
+  addr[0] = (uint8_t)(0x40 | ((r >> 16) & 0x3F));
+  addr[1] = (uint8_t)(r >> 8);
+  addr[2] = (uint8_t)r;
+  if (irk) {
+    rpaHash(irk, addr, &addr[3]);
+  } else {
+    addr[3] = (uint8_t)(r >> 24);
+    addr[4] = (uint8_t)(r >> 32);
+    addr[5] = (uint8_t)(r >> 40);
+  }
+}
+
+/**
+ * @brief Build the advertisement stream for `count` bonded tags.
+ */
+static std::vector<Adv> makeStream(const std::vector<uint8_t>& irks, size_t count) {
+  size_t near = count < BENCH_NEAR ? count : BENCH_NEAR;
+  std::vector<size_t> nearTag(near);
+  for (size_t t = 0; t < near; t++) nearTag[t] = (size_t)(next64() % count);
+  std::vector<Adv> nearAdv(near), phoneAdv(BENCH_PHONES);
+
+  std::vector<Adv> stream;
+  for (uint32_t scan = 0; scan < BENCH_SCANS; scan++) {
+    for (size_t t = 0; t < near; t++) {
+      // Each device rotates on its own phase
+      if ((scan + t * 23) % BENCH_ROTATE == 0 || scan == 0) {
+        makeRpa(&irks[nearTag[t] * 16], nearAdv[t].addr);
+        nearAdv[t].id = (int16_t)nearTag[t];
+      }
+      stream.push_back(nearAdv[t]);
+    }
+    if (scan % 10 == 5) {
+      Adv a;
+      a.id = (int16_t)(next64() % count);
+      a.cold = false;
+      makeRpa(&irks[a.id * 16], a.addr);
+      stream.push_back(a);
+    }
+    for (size_t p = 0; p < BENCH_PHONES; p++) {
+      Adv& a = phoneAdv[p];
+      a.cold = (scan + p * 7) % BENCH_ROTATE == 0 || scan == 0;
+      if (a.cold) {
+        makeRpa(nullptr, a.addr);
+        a.id = -1;
+      }
+      stream.push_back(a);
+    }
+  }
+  for (Adv& a : stream) {
+    if (a.id >= 0) a.cold = false;
+  }
+  return stream;
+}
+
+/**
+ * @brief Resolve without cache, ordering or key schedules.
+ */
+static int16_t naiveResolve(const std::vector<uint8_t>& irks, size_t count, const uint8_t addr[6]) {
+  for (size_t i = 0; i < count; i++) {
+    uint8_t hash[3];
+    rpaHash(&irks[i * 16], addr, hash);
+    if (memcmp(hash, &addr[3], 3) == 0) return (int16_t)i;
+  }
+  return -1;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/**
+ * @brief Bench one IRK count; returns the number of wrong answers.
+ */
+static unsigned benchCount(size_t count) {
+  std::vector<uint8_t> irks(count * 16);
+  for (uint8_t& b : irks) b = (uint8_t)next64();
+  std::vector<Adv> stream = makeStream(irks, count);
+
+  rpaClear();
+  for (size_t i = 0; i < count; i++) rpaAddIrk(&irks[i * 16], (int16_t)i);
+
+  unsigned wrong = 0, colds = 0;
+  double coldSec = 0;
+  double t0 = nowSec();
+  for (const Adv& a : stream) {
+    double c0 = a.cold ? nowSec() : 0;
+    int16_t id = rpaResolve(a.addr);
+    if (a.cold) {
+      coldSec += nowSec() - c0;
+      colds++;
+    }
+    if (id != a.id) wrong++;
+  }
+  double resolverNs = (nowSec() - t0) * 1e9 / stream.size();
+  RpaStats st = rpaGetStats();
+
+  // A tag bonding again re-registers its key; its address must stay cached
+  const Adv& last = stream[stream.size() - BENCH_PHONES - 1];
+  rpaAddIrk(&irks[last.id * 16], last.id);
+  if (rpaResolve(last.addr) != last.id || rpaGetStats().aesOps != st.aesOps) wrong++;
+
+  size_t naiveCount = stream.size() < BENCH_NAIVE ? stream.size() : BENCH_NAIVE;
+  uint64_t naiveAes = 0;
+  t0 = nowSec();
+  for (size_t i = 0; i < naiveCount; i++) {
+    int16_t id = naiveResolve(irks, count, stream[i].addr);
+    naiveAes += id < 0 ? count : (size_t)id + 1;
+    if (id != stream[i].id) wrong++;
+  }
+  double naiveNs = (nowSec() - t0) * 1e9 / naiveCount;
+
+  printf("%5zu  %7zu  %9.0f  %8.2f  %6.1f%%  %9.1f  %10.0f  %9.1f  %8.0fx  %u\n", count, stream.size(),
+         resolverNs, (double)st.aesOps / stream.size(), 100.0 * st.cacheHits / st.lookups,
+         colds ? coldSec * 1e6 / colds : 0.0, naiveNs, (double)naiveAes / naiveCount, naiveNs / resolverNs,
+         wrong);
+  return wrong;
+}
+
+int main(int argc, char** argv) {
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; i++) counts.push_back((size_t)atol(argv[i]));
+  if (counts.empty()) counts = { 10, 100, 1000 };
+
+  printf("rpaBench: %u scans, %u near tags, %u phones, naive over the first %u advertisements\n", BENCH_SCANS,
+         BENCH_NEAR, BENCH_PHONES, BENCH_NAIVE);
+  printf(" IRKs     advs  ns/adv    aes/adv   cached   cold us  naive ns  naive aes  speedup  wrong\n");
+  unsigned wrong = 0;
+  for (size_t count : counts) {
+    if (count == 0 || count > RPA_MAX_IRKS) {
+      fprintf(stderr, "rpaBench: %zu IRKs out of range (1..%d)\n", count, RPA_MAX_IRKS);
+      return 2;
+    }
+    wrong += benchCount(count);
+  }
+  if (wrong) fprintf(stderr, "rpaBench: %u wrong answers\n", wrong);
+  return wrong ? 1 : 0;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file rssiSim.cpp
+ * @brief Achieved RSSI sample rate per tag of the tracker's RSSI scheduler
+ *        (scanner/rssiSched.cpp) as the number of connected tags grows.
+ *
+ * A discrete-event model stands in for the host stack and the controller:
+ * reads are HCI commands handled one at a time, each answered after
+ * HCI_MIN_MS to HCI_MAX_MS (host task hand-off plus the controller round
+ * trip). The scanner task ticks every TICK_MS. About a quarter of the tags
+ * (none with a single tag) sit at the alert edge and want the fast period,
+ * the others the base period.
+ *
+ * Three strategies are compared:
+ *
+ * - blocking: every base period, a blocking read of each tag in turn (the
+ *             former single-tag loop extended to several tags); the task
+ *             is stalled for the whole round;
+ * - sched x1: the scheduler with one read outstanding at a time;
+ * - sched xN: the scheduler starting up to RSSI_BATCH reads per tick.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -DRSSI_MAX_TAGS=16 -I../scanner rssiSim.cpp ../scanner/rssiSched.cpp -o rssiSim
+ *
+ * Usage:
+ *
+ *     rssiSim [seconds] [baseMs] [fastMs]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <vector>
+#include "rssiSched.h"
+
+// ============================================================================
+// Model
+// ============================================================================
+
+#define TICK_MS     31   /**< Scanner task period. */
+#define HCI_MIN_MS   2   /**< Fastest read turnaround. */
+#define HCI_MAX_MS   8   /**< Slowest read turnaround. */
+#define RSSI_BATCH   3   /**< Reads per tick of the batched scheduler (the tracker's setting). */
+
+/**
+ * @brief A read result the simulated stack will report.
+ */
+struct SimResult {
+  uint32_t timeMs;   /**< When it is reported. */
+  int16_t  tag;      /**< Tag read. */
+  bool operator>(const SimResult& o) const { return timeMs > o.timeMs; }
+};
+
+/**
+ * @brief Simulated stack: a queue of pending results and the HCI command slot.
+ */
+struct Sim {
+  std::priority_queue<SimResult, std::vector<SimResult>, std::greater<SimResult>> results;
+  std::mt19937 rng;
+  uint32_t nowMs;
+  uint32_t hciFreeMs;   /**< Time the controller finishes the queued commands. */
+};
+
+static Sim sim;
+
+/**
+ * @brief Turnaround of one HCI read, queued behind earlier commands.
+ */
+static uint32_t hciComplete(uint32_t startMs) {
+  uint32_t latency = std::uniform_int_distribution<uint32_t>(HCI_MIN_MS, HCI_MAX_MS)(sim.rng);
+  uint32_t begin = std::max(startMs, sim.hciFreeMs);
+  sim.hciFreeMs = begin + latency;
+  return sim.hciFreeMs;
+}
+
+static bool simRead(int16_t tag, void*) {
+  sim.results.push({ hciComplete(sim.nowMs), tag });
+  return true;
+}
+
+// ============================================================================
+// Runs
+// ============================================================================
+
+/**
+ * @brief Per-zone outcome of one run.
+ */
+struct Result {
+  double steadyHz;    /**< Mean rate of the steady tags (-1 if none). */
+  double fastHz;      /**< Mean rate of the edge tags (-1 if none). */
+  uint32_t maxGapMs;  /**< Longest gap between two samples of any tag. */
+  uint32_t stallMs;   /**< Longest scanner task stall in one tick. */
+};
+
+static int fastTags(int tags) { return (tags + 2) / 4; }
+
+/**
+ * @brief Per-tag rate from first and last sample.
+ */
+static double rateOf(uint32_t samples, uint32_t firstMs, uint32_t lastMs) {
+  if (samples < 2 || lastMs == firstMs) return 0.0;
+  return (samples - 1) * 1000.0 / (lastMs - firstMs);
+}
+
+/**
+ * @brief Add a tag's rate to its zone's mean.
+ */
+static void addRate(Result* r, int i, int tags, double hz) {
+  int nFast = fastTags(tags);
+  if (i < nFast) r->fastHz += hz / nFast;
+  else r->steadyHz += hz / (tags - nFast);
+}
+
+/**
+ * @brief Empty zones are reported as -1.
+ */
+static void markEmpty(Result* r, int tags) {
+  int nFast = fastTags(tags);
+  if (nFast == 0) r->fastHz = -1.0;
+  if (nFast == tags) r->steadyHz = -1.0;
+}
+
+/**
+ * @brief The blocking loop: all tags read in turn every base period.
+ */
+static Result runBlocking(int tags, uint32_t durationMs, uint32_t baseMs) {
+  Result r = {};
+  std::vector<uint32_t> samples(tags, 0), first(tags, 0), last(tags, 0);
+  sim.hciFreeMs = 0;
+  uint32_t roundMs = 0;
+  for (uint32_t tick = 0; tick < durationMs; tick += TICK_MS) {
+    if (tick - roundMs < baseMs && tick != 0) continue;
+    roundMs = tick;
+    uint32_t now = tick;
+    for (int i = 0; i < tags; i++) {
+      now = hciComplete(now);  // the task waits for each answer
+      if (samples[i] == 0) first[i] = now;
+      else r.maxGapMs = std::max(r.maxGapMs, now - last[i]);
+      last[i] = now;
+      samples[i]++;
+    }
+    r.stallMs = std::max(r.stallMs, now - tick);
+  }
+  for (int i = 0; i < tags; i++) addRate(&r, i, tags, rateOf(samples[i], first[i], last[i]));
+  markEmpty(&r, tags);
+  return r;
+}
+
+/**
+ * @brief The scheduler with `batch` reads outstanding at most.
+ */
+static Result runSched(int tags, uint32_t durationMs, uint32_t baseMs, uint32_t fastMs, uint8_t batch) {
+  Result r = {};
+  sim.results = {};
+  sim.nowMs = 0;
+  sim.hciFreeMs = 0;
+  rssiSchedInit(simRead, nullptr, batch);
+  rssiSchedSetPeriods(baseMs, fastMs);
+  int nFast = fastTags(tags);
+  for (int i = 0; i < tags; i++) {
+    rssiSchedAdd((int16_t)i, 0);
+    if (i < nFast) rssiSchedSetZone((int16_t)i, RSSI_ZONE_EDGE);
+  }
+
+  uint32_t nextTick = 0;
+  while (nextTick < durationMs) {
+    if (!sim.results.empty() && sim.results.top().timeMs <= nextTick) {
+      SimResult e = sim.results.top();
+      sim.results.pop();
+      sim.nowMs = e.timeMs;
+      rssiSchedOnResult(e.tag, true, sim.nowMs);
+    } else {
+      sim.nowMs = nextTick;
+      nextTick += TICK_MS;
+      rssiSchedTick(sim.nowMs);
+    }
+  }
+
+  for (int i = 0; i < tags; i++) {
+    RssiTagStats s;
+    rssiSchedStats((int16_t)i, &s);
+    addRate(&r, i, tags, rateOf(s.samples, s.firstMs, s.lastMs));
+    r.maxGapMs = std::max(r.maxGapMs, s.maxGapMs);
+  }
+  markEmpty(&r, tags);
+  return r;
+}
+
+static void print(int tags, const char* mode, const Result& r) {
+  char steady[16] = "        -", fast[16] = "        -";
+  if (r.steadyHz >= 0.0) snprintf(steady, sizeof(steady), "%9.2f", r.steadyHz);
+  if (r.fastHz >= 0.0) snprintf(fast, sizeof(fast), "%9.2f", r.fastHz);
+  printf("%4d  %-9s %s %s %9u ms %7u ms\n", tags, mode, steady, fast, (unsigned)r.maxGapMs, (unsigned)r.stallMs);
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 60;
+  uint32_t baseMs = argc > 2 ? (uint32_t)atoi(argv[2]) : 200;
+  uint32_t fastMs = argc > 3 ? (uint32_t)atoi(argv[3]) : 100;
+  if (seconds == 0 || baseMs == 0 || fastMs == 0) {
+    fprintf(stderr, "usage: rssiSim [seconds] [baseMs] [fastMs]\n");
+    return 1;
+  }
+
+  printf("%u s, targets %.2f Hz steady / %.2f Hz edge, tick %d ms, HCI %d-%d ms\n\n",
+         (unsigned)seconds, 1000.0 / baseMs, 1000.0 / fastMs, TICK_MS, HCI_MIN_MS, HCI_MAX_MS);
+  printf("tags  mode      steady Hz   edge Hz   max gap    stall\n");
+
+  static const int TAG_COUNTS[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+  for (int tags : TAG_COUNTS) {
+    if (tags > RSSI_MAX_TAGS) break;
+    sim.rng.seed(99u + tags);
+    print(tags, "blocking", runBlocking(tags, seconds * 1000, baseMs));
+    print(tags, "sched x1", runSched(tags, seconds * 1000, baseMs, fastMs, 1));
+    char name[16];
+    snprintf(name, sizeof(name), "sched x%d", RSSI_BATCH);
+    print(tags, name, runSched(tags, seconds * 1000, baseMs, fastMs, RSSI_BATCH));
+  }
+  return 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file scanLoad.cpp
+ * @brief Load test of the tracker's scan path against a growing population
+ *        of advertising devices (tagPop.h).
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 scanLoad.cpp tagPop.cpp ../scanner/tagIndex.cpp ../scanner/rollingId.cpp \
+ *         ../scanner/rpaResolver.cpp -o scanLoad
+ *
+ * Usage:
+ *
+ *     scanLoad bench [seconds] [seed]
+ *
+ * `bench` puts the tracker among 8 owned tags (2 carried and 3 wandering,
+ * bonded and advertising from resolvable private addresses, and 3 not yet
+ * bonded commuting in and out of range) and a growing crowd of phones,
+ * beacons and other owners' tags, and runs back-to-back 5 s scans for
+ * `seconds` (default 1800) of simulated time. The scan path is replayed as
+ * the sketch runs it:
+ *
+ * - each received advertisement goes through the BLE library's result
+ *   handler, which keeps the first advertisement of each address in a map
+ *   keyed by the address string;
+ * - at the end of the scan every result goes through `isOwnedTag()`: the
+ *   RPA resolver, then the rolling identifier index.
+ *
+ * It reports the air (PDUs received and lost to collisions), the host CPU
+ * time of the handler per advertisement and of the result pass per scan,
+ * their share of the scan time, the heap held by the results at the end of a
+ * scan, the share of owned tags within nominal range identified in each scan,
+ * the delay from a commuting tag entering that range to its identification,
+ * and a digest of the received stream: the same seed gives the same digest.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <malloc.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tagPop.h"
+#include "../scanner/tagIndex.h"
+#include "../scanner/rpaResolver.h"
+
+// ============================================================================
+// Scenario
+// ============================================================================
+
+/** @brief Owned tags: bonded carried, bonded wandering, unbonded commuting. */
+#define CARRIED   2
+#define WANDERING 3
+#define COMMUTING 3
+#define OWNED     (CARRIED + WANDERING + COMMUTING)
+
+/** @brief Scan duration of the sketch (s). */
+#define SCAN_S 5
+
+/** @brief Shared-epoch time at the start of the run. */
+#define EPOCH_START 1700000000u
+
+/** @brief Radio: the scanner's path-loss defaults, 4 dB shadowing, -95 dBm sensitivity. */
+static const TagPopConfig RADIO = {
+  2.5f,      // nFactor
+  4.0f,      // shadowDb
+  3.0f,      // ricianK
+  -95.0f,    // sensitivityDbm
+  40.0f,     // areaHalf
+  80 * 625,  // scanInterval default (0.625 ms units)
+  40 * 625,  // scanWindow default
+  EPOCH_START,
+  0,         // seed, per run
+};
+
+/** @brief RSSI of owned tags at 1 m (the scanner's txPower default). */
+#define TAG_TX_POWER -52.0f
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Device groups for a crowd of `others` foreign devices.
+ *
+ * Owned tags come first, so device i < OWNED is owned tag i.
+ */
+static std::vector<TagPopGroup> population(uint32_t others) {
+  uint32_t phones = others / 2, beacons = others / 4, trackers = others - phones - beacons;
+  return {
+    { CARRIED,   true,  true,  PAYLOAD_ROLLING, 35000,   35000,   TAG_TX_POWER, SCRIPT_CARRIED },
+    { WANDERING, true,  true,  PAYLOAD_ROLLING, 35000,   35000,   TAG_TX_POWER, SCRIPT_WANDER },
+    { COMMUTING, true,  false, PAYLOAD_ROLLING, 35000,   35000,   TAG_TX_POWER, SCRIPT_COMMUTE },
+    { phones,    false, true,  PAYLOAD_VENDOR,  200000,  1000000, -55.0f,       SCRIPT_WANDER },
+    { beacons,   false, false, PAYLOAD_VENDOR,  100000,  1000000, -59.0f,       SCRIPT_STILL },
+    { trackers,  false, true,  PAYLOAD_ROLLING, 500000,  2000000, -56.0f,       SCRIPT_WANDER },
+  };
+}
+
+// ============================================================================
+// Scan Path
+// ============================================================================
+
+/**
+ * @brief One scan result, as the BLE library keeps it.
+ */
+struct ScanEntry {
+  uint8_t     addr[6];   /**< Address, most significant byte first. */
+  int8_t      rssi;      /**< RSSI of the first advertisement. */
+  std::string mfr;       /**< Manufacturer data. */
+  uint32_t    device;    /**< Sender (for scoring only). */
+};
+
+/** @brief Results of the running scan, keyed by address string. */
+typedef std::map<std::string, ScanEntry*> ScanResults;
+
+/**
+ * @brief Result handler: keep the first advertisement of each address.
+ */
+static void onResult(ScanResults& results, const TagPopAdv& a) {
+  char text[18];
+  snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", a.addr[0], a.addr[1], a.addr[2], a.addr[3],
+           a.addr[4], a.addr[5]);
+  std::string key(text);
+  if (results.count(key)) return;
+  ScanEntry* e = new ScanEntry;
+  memcpy(e->addr, a.addr, 6);
+  e->rssi = a.rssi;
+  e->mfr.assign((const char*)a.mfr, a.mfrLen);
+  e->device = a.device;
+  results[key] = e;
+}
+
+/**
+ * @brief `isOwnedTag()` of the sketch, without the log lines.
+ */
+static int16_t isOwnedTag(const ScanEntry& e, uint32_t epochSeconds) {
+  int16_t bond = rpaResolve(e.addr);
+  if (bond >= 0) return bond;
+  if (e.mfr.empty()) return -1;
+  tagIndexRefresh(epochSeconds);
+  TagMatch m = tagIndexIdentify((const uint8_t*)e.mfr.data(), e.mfr.size());
+  return m.tag;
+}
+
+static void onAir(const TagPopAdv* adv, void* ctx) {
+  ((std::vector<TagPopAdv>*)ctx)->push_back(*adv);
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/**
+ * @brief Outcome of one population size.
+ */
+struct LoadResult {
+  double   receivedPerScan;   /**< Advertisements received per scan. */
+  double   collidedShare;     /**< Audible in-window PDUs lost to collisions. */
+  double   nsPerAdv;          /**< Result handler, per advertisement. */
+  double   usPerScan;         /**< Result pass and release, per scan. */
+  double   cpuShare;          /**< Handler and result pass over the scan time. */
+  double   resultsPerScan;    /**< Unique addresses per scan. */
+  double   peakKiB;           /**< Heap held by the results at a scan end. */
+  double   aesPerScan;        /**< Resolver AES operations per scan. */
+  double   detected;          /**< Owned tags in range identified, per scan. */
+  double   delayS;            /**< Commuter entering range to identification. */
+  uint64_t falseMatches;      /**< Foreign devices identified as owned. */
+  uint64_t digest;            /**< Hash of the received stream. */
+};
+
+static LoadResult runLoad(uint32_t others, uint32_t seconds, uint64_t seed) {
+  static OwnedTag tags[OWNED];
+  uint8_t keys[OWNED][ROLLING_KEY_LEN];
+  for (int t = 0; t < OWNED; t++) {
+    for (int k = 0; k < ROLLING_KEY_LEN; k++) tags[t].key[k] = keys[t][k] = (uint8_t)(17 * t + 31 * k + 5);
+    tags[t].name = "tag";
+  }
+  std::vector<TagPopGroup> groups = population(others);
+  TagPopConfig cfg = RADIO;
+  cfg.seed = seed;
+  TagPop* pop = tagPopCreate(&cfg, groups.data(), groups.size(), keys);
+  if (!pop) {
+    fprintf(stderr, "bench: out of memory\n");
+    exit(1);
+  }
+
+  tagIndexInit(tags, OWNED, EPOCH_START);
+  rpaClear();
+  for (uint32_t t = 0; t < CARRIED + WANDERING; t++) {
+    uint8_t irk[16];
+    if (tagPopIrk(pop, t, irk)) rpaAddIrk(irk, (int16_t)t);
+  }
+  // Nominal range: the mean RSSI reaches the sensitivity
+  float range = powf(10.0f, (TAG_TX_POWER - cfg.sensitivityDbm) / (10.0f * cfg.nFactor));
+
+  LoadResult r = {};
+  std::vector<TagPopAdv> air;
+  ScanResults results;
+  double handlerS = 0, passS = 0, peak = 0;
+  uint64_t advs = 0, uniques = 0, inRange = 0, found = 0, delays = 0;
+  double delaySum = 0;
+  int64_t enteredScan[OWNED];
+  bool wasInRange[OWNED];
+  for (int t = 0; t < OWNED; t++) {
+    enteredScan[t] = -1;
+    wasInRange[t] = true;   // only entries seen during the run count
+  }
+  uint32_t scans = seconds / SCAN_S;
+  uint32_t aesStart = rpaGetStats().aesOps;
+
+  for (uint32_t s = 0; s < scans; s++) {
+    air.clear();
+    tagPopRun(pop, (uint64_t)(s + 1) * SCAN_S * 1000000, onAir, &air);
+    for (const TagPopAdv& a : air) {
+      r.digest = r.digest * 1000003u + a.timeUs * 31 + a.device * 7 + (uint8_t)a.rssi + a.addr[5];
+    }
+    advs += air.size();
+
+    size_t heapBase = mallinfo2().uordblks;
+    double t0 = nowSec();
+    for (const TagPopAdv& a : air) onResult(results, a);
+    double t1 = nowSec();
+    size_t heap = mallinfo2().uordblks;
+    if (heap > heapBase && heap - heapBase > peak) peak = heap - heapBase;
+    uniques += results.size();
+
+    // Scan complete: the result pass, then clearResults()
+    double t2 = nowSec();
+    uint32_t epoch = EPOCH_START + (s + 1) * SCAN_S;
+    bool identified[OWNED] = {};
+    for (auto& kv : results) {
+      int16_t tag = isOwnedTag(*kv.second, epoch);
+      if (tag < 0) continue;
+      if (tag < OWNED && kv.second->device == (uint32_t)tag) identified[tag] = true;
+      else r.falseMatches++;
+    }
+    for (auto& kv : results) delete kv.second;
+    results.clear();
+    double t3 = nowSec();
+    handlerS += t1 - t0;
+    passS += t3 - t2;
+
+    for (int t = 0; t < OWNED; t++) {
+      float meters;
+      tagPopOwned(pop, t, &meters);
+      bool in = meters <= range;
+      if (in) {
+        inRange++;
+        found += identified[t];
+      }
+      if (in && !wasInRange[t]) enteredScan[t] = s;
+      if (enteredScan[t] >= 0 && identified[t]) {
+        delaySum += (s - enteredScan[t] + 1) * SCAN_S;
+        delays++;
+        enteredScan[t] = -1;
+      }
+      if (!in) enteredScan[t] = -1;
+      wasInRange[t] = in;
+    }
+  }
+
+  TagPopStats st = tagPopStats(pop);
+  uint64_t audible = st.collided + st.received;
+  r.receivedPerScan = (double)advs / scans;
+  r.collidedShare = audible ? (double)st.collided / audible : 0.0;
+  r.nsPerAdv = advs ? handlerS * 1e9 / advs : 0.0;
+  r.usPerScan = passS * 1e6 / scans;
+  r.cpuShare = (handlerS + passS) / ((double)scans * SCAN_S);
+  r.resultsPerScan = (double)uniques / scans;
+  r.peakKiB = peak / 1024.0;
+  r.aesPerScan = (double)(rpaGetStats().aesOps - aesStart) / scans;
+  r.detected = inRange ? (double)found / inRange : 0.0;
+  r.delayS = delays ? delaySum / delays : 0.0;
+  tagPopDestroy(pop);
+  return r;
+}
+
+static int bench(uint32_t seconds, uint64_t seed) {
+  printf("%u owned tags among a crowd, %u s of %d s scans, interval %u ms window %u ms, seed %llu\n\n", OWNED,
+         seconds, SCAN_S, RADIO.scanIntervalUs / 1000, RADIO.scanWindowUs / 1000, (unsigned long long)seed);
+  printf("devices  adv/scan  collided  ns/adv  us/scan    cpu  results    KiB  aes/scan  detected  delay s  false  digest\n");
+  for (uint32_t devices : { 20u, 50u, 100u, 200u, 500u, 1000u }) {
+    LoadResult r = runLoad(devices - OWNED, seconds, seed);
+    printf("%7u %9.0f %8.1f%% %7.0f %8.0f %5.3f%% %8.0f %6.1f %9.0f %8.1f%% %8.1f %6llu  %016llx\n", devices,
+           r.receivedPerScan, 100.0 * r.collidedShare, r.nsPerAdv, r.usPerScan, 100.0 * r.cpuShare,
+           r.resultsPerScan, r.peakKiB, r.aesPerScan, 100.0 * r.detected, r.delayS,
+           (unsigned long long)r.falseMatches, (unsigned long long)r.digest);
+  }
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long seconds = argc > 2 ? atol(argv[2]) : 1800;
+    unsigned long long seed = argc > 3 ? strtoull(argv[3], nullptr, 0) : 1;
+    if (seconds < SCAN_S) {
+      fprintf(stderr, "bench: seconds must cover at least one %d s scan\n", SCAN_S);
+      return 1;
+    }
+    return bench((uint32_t)seconds, seed);
+  }
+  fprintf(stderr, "usage: scanLoad bench [seconds] [seed]\n");
+  return 1;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file schedAnalysis.cpp
+ * @brief Worst-case response time analysis of a sketch's task table.
+ *
+ * Reads the `X(fn, core, prio, stackBytes, periodMs, wcetUs)` rows of a
+ * `taskTable.h` (both the application and the system tables) and runs
+ * classic fixed-priority response time analysis per core:
+ *
+ *     R = C + sum over higher-or-equal priority tasks j on the core of
+ *         ceil(R / T_j) * C_j
+ *
+ * iterated to a fixed point. Tasks of equal priority are counted as
+ * interfering because FreeRTOS time-slices them. The deadline is the period
+ * (or minimum inter-arrival time); rows with period 0 are background tasks
+ * and are listed but not analysed. Blocking on shared resources is not
+ * modelled, so keep critical sections short relative to the reported slack.
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 schedAnalysis.cpp -o schedAnalysis
+ *
+ * Usage:
+ *
+ *     schedAnalysis <taskTable.h> [more tables...]
+ *
+ * The exit status is 1 if any analysed task can miss its deadline.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// Table Parsing
+// ============================================================================
+
+/**
+ * @brief One row of a task table.
+ */
+struct Task {
+  std::string name;        /**< Task function name. */
+  int         core = 0;    /**< Core, 0 (PRO_CORE) or 1 (APP_CORE). */
+  int         prio = 0;    /**< FreeRTOS priority. */
+  uint32_t    stack = 0;   /**< Stack bytes (0 for system tasks). */
+  uint32_t    periodMs = 0; /**< Period or minimum inter-arrival, 0 for background. */
+  uint32_t    wcetUs = 0;  /**< Execution budget per release. */
+  uint64_t    respUs = 0;  /**< Computed worst-case response time. */
+  bool        ok = true;   /**< Response time within the deadline. */
+};
+
+/**
+ * @brief Trim spaces and tabs from both ends.
+ */
+static std::string trim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t");
+  size_t b = s.find_last_not_of(" \t");
+  return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+/**
+ * @brief Resolve a core column (PRO_CORE, APP_CORE or a number).
+ */
+static int parseCore(const std::string& s) {
+  if (s == "PRO_CORE") return 0;
+  if (s == "APP_CORE") return 1;
+  return atoi(s.c_str());
+}
+
+/**
+ * @brief Append every `X(...)` row of a table header to `out`.
+ */
+static bool parseTable(const char* path, std::vector<Task>* out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    std::string s = trim(line);
+    if (s.compare(0, 2, "X(") != 0) continue;
+    size_t close = s.find(')');
+    if (close == std::string::npos) continue;
+
+    std::vector<std::string> cols;
+    std::string body = s.substr(2, close - 2);
+    size_t start = 0;
+    for (;;) {
+      size_t comma = body.find(',', start);
+      cols.push_back(trim(body.substr(start, comma == std::string::npos ? std::string::npos : comma - start)));
+      if (comma == std::string::npos) break;
+      start = comma + 1;
+    }
+    if (cols.size() != 6) {
+      fprintf(stderr, "%s: skipping malformed row: %s\n", path, s.c_str());
+      continue;
+    }
+
+    Task t;
+    t.name = cols[0];
+    t.core = parseCore(cols[1]);
+    t.prio = atoi(cols[2].c_str());
+    t.stack = (uint32_t)strtoul(cols[3].c_str(), nullptr, 0);
+    t.periodMs = (uint32_t)strtoul(cols[4].c_str(), nullptr, 0);
+    t.wcetUs = (uint32_t)strtoul(cols[5].c_str(), nullptr, 0);
+    out->push_back(t);
+  }
+  fclose(f);
+  return true;
+}
+
+// ============================================================================
+// Analysis
+// ============================================================================
+
+/**
+ * @brief Compute the worst-case response time of `tasks[i]`.
+ *
+ * Stops as soon as the response time exceeds the deadline.
+ */
+static void responseTime(std::vector<Task>& tasks, size_t i) {
+  Task& t = tasks[i];
+  uint64_t deadline = (uint64_t)t.periodMs * 1000;
+  uint64_t r = t.wcetUs, prev = 0;
+  while (r != prev && r <= deadline) {
+    prev = r;
+    r = t.wcetUs;
+    for (size_t j = 0; j < tasks.size(); j++) {
+      const Task& o = tasks[j];
+      if (j == i || o.core != t.core || o.prio < t.prio || o.periodMs == 0) continue;
+      uint64_t period = (uint64_t)o.periodMs * 1000;
+      r += (prev + period - 1) / period * o.wcetUs;
+    }
+  }
+  t.respUs = r;
+  t.ok = r <= deadline;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <taskTable.h> [more tables...]\n", argv[0]);
+    return 2;
+  }
+  std::vector<Task> tasks;
+  for (int a = 1; a < argc; a++) {
+    if (!parseTable(argv[a], &tasks)) {
+      perror(argv[a]);
+      return 1;
+    }
+  }
+  if (tasks.empty()) {
+    fprintf(stderr, "no task rows found\n");
+    return 1;
+  }
+
+  for (size_t i = 0; i < tasks.size(); i++) {
+    if (tasks[i].periodMs) responseTime(tasks, i);
+  }
+  std::stable_sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) {
+    return a.core != b.core ? a.core < b.core : a.prio > b.prio;
+  });
+
+  bool allOk = true;
+  int core = -1;
+  for (const Task& t : tasks) {
+    if (t.core != core) {
+      core = t.core;
+      double util = 0;
+      for (const Task& o : tasks) {
+        if (o.core == core && o.periodMs) util += o.wcetUs / (o.periodMs * 1000.0);
+      }
+      printf("%score %d (utilisation %.1f%%)\n", core ? "\n" : "", core, util * 100);
+      printf("  %-16s %4s %7s %9s %9s %9s %9s\n", "task", "prio", "stack", "period", "wcet",
+             "response", "slack");
+    }
+    if (!t.periodMs) {
+      printf("  %-16s %4d %7u %9s %7u us %9s %9s  background\n", t.name.c_str(), t.prio,
+             t.stack, "-", t.wcetUs, "-", "-");
+      continue;
+    }
+    uint64_t deadline = (uint64_t)t.periodMs * 1000;
+    if (t.ok) {
+      printf("  %-16s %4d %7u %6u ms %7u us %6.2f ms %6.2f ms\n", t.name.c_str(), t.prio, t.stack,
+             t.periodMs, t.wcetUs, t.respUs / 1000.0, (deadline - t.respUs) / 1000.0);
+    } else {
+      printf("  %-16s %4d %7u %6u ms %7u us %9s %9s  MISS\n", t.name.c_str(), t.prio, t.stack,
+             t.periodMs, t.wcetUs, "> period", "-");
+      allOk = false;
+    }
+  }
+  printf("\n%s\n", allOk ? "schedulable" : "NOT schedulable");
+  return allOk ? 0 : 1;
+}
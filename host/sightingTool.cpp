@@ -0,0 +1,293 @@
+/**
+ * @file sightingTool.cpp
+ * @brief Local find-my-style backend over the sighting store (sightings.h).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 -DTAG_INDEX_MAX_TAGS=4096 sightingTool.cpp sightings.cpp ../scanner/tagIndex.cpp ../scanner/rollingId.cpp -o sightingTool
+ *
+ * Usage:
+ *
+ *     sightingTool serve <tags.txt>
+ *     sightingTool bench [sightings] [tags]
+ *
+ * `serve` loads the owned tags, one per line as `name key` (32 hex digits,
+ * the key the tag derives its rolling identifier from; `#` starts a
+ * comment), and reads commands from stdin, one per line:
+ *
+ *     S <timeMs> <gateway> <id> <rssi>      store a sighting (id in hex)
+ *     L <tag>                               last seen: `timeMs gateway rssi heard`
+ *     H <tag> <fromMs> <toMs>               history: `timeMs gateway rssi count` lines
+ *     C <mergeBeforeMs> <bucketMs> <dropBeforeMs>   compact
+ *
+ * Gateways (trackers or anything running their scan logic) feed it through
+ * a pipe or socket; `timeMs` is wall-clock time in ms since the epoch the
+ * tags rotate their identifiers on.
+ *
+ * `bench` simulates gateways reporting `sightings` (default 5M) sightings of
+ * `tags` (default 2000) tags over one day, some late, some from unknown
+ * tags, and reports ingest rate, memory per sighting and query latency
+ * before and after compacting everything older than an hour into
+ * one-minute buckets.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "sightings.h"
+#include "../scanner/rollingId.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Wall-clock time in milliseconds since the Unix epoch.
+ */
+static int64_t wallMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Serve
+// ============================================================================
+
+/**
+ * @brief Read the owned tags file.
+ *
+ * @return Number of tags, or -1 on error.
+ */
+static int loadTags(const char* path, OwnedTag* tags, char (*names)[32], int max) {
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+  char buf[256];
+  int n = 0;
+  while (n < max && fgets(buf, sizeof(buf), f)) {
+    char* hash = strchr(buf, '#');
+    if (hash) *hash = '\0';
+    char hex[64];
+    if (sscanf(buf, "%31s %63s", names[n], hex) != 2 || strlen(hex) != 2 * ROLLING_KEY_LEN) continue;
+    for (int i = 0; i < ROLLING_KEY_LEN; i++) {
+      unsigned byte;
+      sscanf(hex + 2 * i, "%2x", &byte);
+      tags[n].key[i] = (uint8_t)byte;
+    }
+    tags[n].name = names[n];
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+static int serve(const char* tagsPath) {
+  static OwnedTag tags[TAG_INDEX_MAX_TAGS];
+  static char names[TAG_INDEX_MAX_TAGS][32];
+  int count = loadTags(tagsPath, tags, names, TAG_INDEX_MAX_TAGS);
+  if (count <= 0) {
+    fprintf(stderr, "%s: no tags\n", tagsPath);
+    return 1;
+  }
+  SightingStore store;
+  if (!sightInit(&store, tags, (uint32_t)count, wallMs())) return 1;
+  fprintf(stderr, "%d tags\n", count);
+
+  static SightingRecord history[4096];
+  char line[256];
+  while (fgets(line, sizeof(line), stdin)) {
+    long long t, a, b, c;
+    unsigned gateway, tag;
+    int rssi;
+    char id[32];
+    if (sscanf(line, "S %lld %u %31s %d", &t, &gateway, id, &rssi) == 4) {
+      SightingReport r = { strtoull(id, nullptr, 16), t, (uint8_t)gateway, (int8_t)rssi };
+      sightIngest(&store, &r);
+    } else if (sscanf(line, "L %u", &tag) == 1) {
+      LastSeen ls;
+      if (sightLastSeen(&store, (uint16_t)tag, &ls)) {
+        printf("%lld %u %d %u\n", (long long)ls.timeMs, ls.anchor, ls.rssi, ls.heard);
+      } else {
+        printf("-\n");
+      }
+    } else if (sscanf(line, "H %u %lld %lld", &tag, &a, &b) == 3) {
+      size_t n = sightHistory(&store, (uint16_t)tag, a, b, history, 4096);
+      for (size_t i = 0; i < n; i++) {
+        printf("%lld %u %d %u\n", (long long)history[i].timeMs, history[i].anchor, history[i].rssi,
+               history[i].count);
+      }
+      printf(".\n");
+    } else if (sscanf(line, "C %lld %lld %lld", &a, &b, &c) == 3) {
+      printf("%s %u records\n", sightCompact(&store, a, b, c) ? "ok" : "failed", store.records);
+    }
+    fflush(stdout);
+  }
+  sightFree(&store);
+  return 0;
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/** @brief Gateways of the simulated site. */
+#define BENCH_GATEWAYS 64
+
+/** @brief Simulated span (ms). */
+#define BENCH_SPAN_MS (24LL * 3600 * 1000)
+
+/** @brief Start of the simulation (ms since the shared epoch). */
+#define BENCH_START_MS 1700000000000LL
+
+/**
+ * @brief A tag's identifier cache and where it is.
+ */
+struct SimTag {
+  uint32_t window;   /**< Window of `id`. */
+  uint64_t id;       /**< Identifier for `window`. */
+  uint8_t  home;     /**< Gateway nearest to it. */
+};
+
+/**
+ * @brief Generate the reports gateways send, in arrival order.
+ *
+ * Each advertisement is heard by 1 to 3 gateways around the tag; 10% of
+ * reports arrive up to 3 s late, 2% come from tags that are not owned.
+ */
+static std::vector<SightingReport> simulate(const OwnedTag* tags, uint32_t tagCount, size_t sightings) {
+  std::mt19937_64 rng(5);
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+  std::vector<SimTag> sim(tagCount);
+  for (uint32_t t = 0; t < tagCount; t++) sim[t] = { UINT32_MAX, 0, (uint8_t)(rng() % BENCH_GATEWAYS) };
+  std::vector<SightingReport> out;
+  out.reserve(sightings);
+  double step = (double)BENCH_SPAN_MS / sightings * 2.0;  // ~2 reports per advertisement
+  double t = BENCH_START_MS;
+  while (out.size() < sightings) {
+    t += step * uni(rng) * 2.0;
+    int64_t ms = (int64_t)t;
+    if (uni(rng) < 0.02) {
+      out.push_back({ rng(), ms, (uint8_t)(rng() % BENCH_GATEWAYS), (int8_t)(-60 - rng() % 30) });
+      continue;
+    }
+    uint32_t tag = (uint32_t)(rng() % tagCount);
+    SimTag& s = sim[tag];
+    if (uni(rng) < 0.001) s.home = (uint8_t)(rng() % BENCH_GATEWAYS);  // carried elsewhere
+    uint32_t window = rollingWindow((uint32_t)(ms / 1000));
+    if (window != s.window) {
+      s.window = window;
+      s.id = rollingIdFor(tags[tag].key, window);
+    }
+    int heard = 1 + (int)(rng() % 3);
+    for (int k = 0; k < heard && out.size() < sightings; k++) {
+      uint8_t gw = (uint8_t)((s.home + k) % BENCH_GATEWAYS);
+      int64_t at = uni(rng) < 0.1 ? ms - (int64_t)(uni(rng) * 3000) : ms;
+      out.push_back({ s.id, at, gw, (int8_t)(-55 - 8 * k - rng() % 10) });
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Mean latency of last-seen and one-hour history queries (us).
+ */
+static void queryLatency(const SightingStore* s, uint32_t tagCount, double* lastUs, double* histUs, double* histRows) {
+  std::mt19937 rng(9);
+  const int LAST_QUERIES = 1000000, HIST_QUERIES = 20000;
+  volatile int64_t sink = 0;
+  double t = nowSec();
+  for (int i = 0; i < LAST_QUERIES; i++) {
+    LastSeen ls;
+    if (sightLastSeen(s, (uint16_t)(rng() % tagCount), &ls)) sink = sink + ls.timeMs;
+  }
+  *lastUs = (nowSec() - t) * 1e6 / LAST_QUERIES;
+
+  static SightingRecord buf[65536];
+  size_t rows = 0;
+  t = nowSec();
+  for (int i = 0; i < HIST_QUERIES; i++) {
+    int64_t from = BENCH_START_MS + (int64_t)(rng() % (BENCH_SPAN_MS - 3600000));
+    rows += sightHistory(s, (uint16_t)(rng() % tagCount), from, from + 3600000, buf, 65536);
+  }
+  *histUs = (nowSec() - t) * 1e6 / HIST_QUERIES;
+  *histRows = (double)rows / HIST_QUERIES;
+}
+
+static int bench(size_t sightings, uint32_t tagCount) {
+  std::vector<OwnedTag> tags(tagCount);
+  std::mt19937 rng(3);
+  for (OwnedTag& t : tags) {
+    t.name = "tag";
+    for (int i = 0; i < ROLLING_KEY_LEN; i++) t.key[i] = (uint8_t)rng();
+  }
+  printf("%zu reports from %d gateways about %u tags over 24 h\n", sightings, BENCH_GATEWAYS, tagCount);
+  double t = nowSec();
+  std::vector<SightingReport> reports = simulate(tags.data(), tagCount, sightings);
+  printf("generated in %.1f s\n\n", nowSec() - t);
+
+  SightingStore store;
+  if (!sightInit(&store, tags.data(), tagCount, BENCH_START_MS)) {
+    fprintf(stderr, "bench: at most %d tags (TAG_INDEX_MAX_TAGS)\n", TAG_INDEX_MAX_TAGS);
+    return 1;
+  }
+  t = nowSec();
+  for (const SightingReport& r : reports) sightIngest(&store, &r);
+  double ingestSec = nowSec() - t;
+  printf("ingest        %.2f M reports/s, %llu stored, %llu unresolved, %llu late\n",
+         sightings / ingestSec / 1e6, (unsigned long long)store.stats.ingested,
+         (unsigned long long)store.stats.unresolved, (unsigned long long)store.stats.late);
+  printf("memory        %.1f MB, %.1f bytes per sighting\n\n", sightMemory(&store) / 1e6,
+         (double)sightMemory(&store) / store.stats.ingested);
+
+  double lastUs, histUs, histRows;
+  queryLatency(&store, tagCount, &lastUs, &histUs, &histRows);
+  printf("              records  last seen us  history 1 h us  rows\n");
+  printf("raw          %8u %13.3f %15.2f %5.0f\n", store.records, lastUs, histUs, histRows);
+
+  t = nowSec();
+  int64_t end = BENCH_START_MS + BENCH_SPAN_MS;
+  sightCompact(&store, end - 3600000, 60000, BENCH_START_MS);
+  double compactSec = nowSec() - t;
+  queryLatency(&store, tagCount, &lastUs, &histUs, &histRows);
+  printf("compacted    %8u %13.3f %15.2f %5.0f\n\n", store.records, lastUs, histUs, histRows);
+  printf("compaction    %.2f s, %.1f MB after\n", compactSec, sightMemory(&store) / 1e6);
+  sightFree(&store);
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "serve") == 0) return serve(argv[2]);
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long sightings = argc > 2 ? atol(argv[2]) : 5000000;
+    long tags = argc > 3 ? atol(argv[3]) : 2000;
+    if (sightings <= 0 || tags <= 0) {
+      fprintf(stderr, "bench: sightings and tags must be positive\n");
+      return 1;
+    }
+    return bench((size_t)sightings, (uint32_t)tags);
+  }
+  fprintf(stderr,
+          "usage: sightingTool serve <tags.txt>\n"
+          "       sightingTool bench [sightings] [tags]\n");
+  return 1;
+}
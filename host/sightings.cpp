@@ -0,0 +1,274 @@
+/**
+ * @file sightings.cpp
+ * @brief Sighting log, per-tag time indexes and compaction.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "sightings.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Record by number.
+ */
+static inline SightingRecord& recordAt(SightingRecord** chunks, uint32_t seq) {
+  return chunks[seq / SIGHT_CHUNK_RECORDS][seq % SIGHT_CHUNK_RECORDS];
+}
+
+/**
+ * @brief Log under construction (used by ingest and compaction).
+ */
+struct Log {
+  SightingRecord** chunks;       /**< Chunks. */
+  uint32_t         chunkCount;   /**< Chunks in use. */
+  uint32_t         chunkCap;     /**< Allocated chunk pointers. */
+  uint32_t         records;      /**< Records. */
+};
+
+/**
+ * @brief Append a record to a log.
+ *
+ * @return Its record number, or UINT32_MAX if memory is exhausted.
+ */
+static uint32_t logAppend(Log* log, const SightingRecord& r) {
+  if (log->records == UINT32_MAX) return UINT32_MAX;
+  if (log->records == log->chunkCount * SIGHT_CHUNK_RECORDS) {
+    if (log->chunkCount == log->chunkCap) {
+      uint32_t cap = log->chunkCap ? log->chunkCap * 2 : 16;
+      SightingRecord** p = (SightingRecord**)realloc(log->chunks, cap * sizeof(SightingRecord*));
+      if (!p) return UINT32_MAX;
+      log->chunks = p;
+      log->chunkCap = cap;
+    }
+    SightingRecord* c = (SightingRecord*)malloc(SIGHT_CHUNK_RECORDS * sizeof(SightingRecord));
+    if (!c) return UINT32_MAX;
+    log->chunks[log->chunkCount++] = c;
+  }
+  uint32_t seq = log->records++;
+  recordAt(log->chunks, seq) = r;
+  return seq;
+}
+
+static void logFree(Log* log) {
+  for (uint32_t i = 0; i < log->chunkCount; i++) free(log->chunks[i]);
+  free(log->chunks);
+  memset(log, 0, sizeof(*log));
+}
+
+/**
+ * @brief Make room for one more index entry.
+ */
+static bool indexReserve(SightTagIndex* idx) {
+  if (idx->count < idx->cap) return true;
+  uint32_t cap = idx->cap ? idx->cap * 2 : 64;
+  uint32_t* p = (uint32_t*)realloc(idx->seq, cap * sizeof(uint32_t));
+  if (!p) return false;
+  idx->seq = p;
+  idx->cap = cap;
+  return true;
+}
+
+// ============================================================================
+// Store
+// ============================================================================
+
+bool sightInit(SightingStore* s, const OwnedTag* tags, uint32_t count, int64_t nowMs) {
+  memset(s, 0, sizeof(*s));
+  if (count == 0 || count > TAG_INDEX_MAX_TAGS) return false;
+  s->tags = (SightTagIndex*)calloc(count, sizeof(SightTagIndex));
+  if (!s->tags) return false;
+  s->tagCount = count;
+  s->newestMs = nowMs;
+  tagIndexInit(tags, count, (uint32_t)(nowMs / 1000));
+  return true;
+}
+
+void sightFree(SightingStore* s) {
+  Log log = { s->chunks, s->chunkCount, s->chunkCap, s->records };
+  logFree(&log);
+  for (uint32_t t = 0; t < s->tagCount; t++) free(s->tags[t].seq);
+  free(s->tags);
+  memset(s, 0, sizeof(*s));
+}
+
+bool sightIngest(SightingStore* s, const SightingReport* r) {
+  // The identifier index only moves forward, with the newest report
+  if (r->timeMs > s->newestMs) {
+    s->newestMs = r->timeMs;
+    tagIndexRefresh((uint32_t)(r->timeMs / 1000));
+  }
+  TagMatch m = tagIndexLookup(r->ephemeralId);
+  if (m.tag < 0 || (uint32_t)m.tag >= s->tagCount) {
+    s->stats.unresolved++;
+    return false;
+  }
+  SightTagIndex& idx = s->tags[m.tag];
+  if (!indexReserve(&idx)) return false;
+
+  Log log = { s->chunks, s->chunkCount, s->chunkCap, s->records };
+  SightingRecord rec = { r->timeMs, (uint16_t)m.tag, r->anchor, r->rssi, 1 };
+  uint32_t seq = logAppend(&log, rec);
+  s->chunks = log.chunks;
+  s->chunkCount = log.chunkCount;
+  s->chunkCap = log.chunkCap;
+  if (seq == UINT32_MAX) return false;
+  s->records = log.records;
+
+  // Keep the index in time order; late reports move back a few entries
+  uint32_t pos = idx.count;
+  while (pos > 0 && recordAt(s->chunks, idx.seq[pos - 1]).timeMs > r->timeMs) {
+    idx.seq[pos] = idx.seq[pos - 1];
+    pos--;
+  }
+  idx.seq[pos] = seq;
+  if (pos != idx.count) s->stats.late++;
+  idx.count++;
+  s->stats.ingested++;
+  return true;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+bool sightLastSeen(const SightingStore* s, uint16_t tag, LastSeen* out) {
+  if (tag >= s->tagCount || s->tags[tag].count == 0) return false;
+  const SightTagIndex& idx = s->tags[tag];
+  const SightingRecord& newest = recordAt(s->chunks, idx.seq[idx.count - 1]);
+  out->timeMs = newest.timeMs;
+  out->anchor = newest.anchor;
+  out->rssi = newest.rssi;
+  out->heard = 0;
+  for (uint32_t i = idx.count; i-- > 0;) {
+    const SightingRecord& r = recordAt(s->chunks, idx.seq[i]);
+    if (r.timeMs < newest.timeMs - SIGHT_PLACE_WINDOW_MS) break;
+    if (r.rssi > out->rssi) {
+      out->rssi = r.rssi;
+      out->anchor = r.anchor;
+    }
+    if (out->heard < 255) out->heard++;
+  }
+  return true;
+}
+
+size_t sightHistory(const SightingStore* s, uint16_t tag, int64_t fromMs, int64_t toMs,
+                    SightingRecord* out, size_t max) {
+  if (tag >= s->tagCount) return 0;
+  const SightTagIndex& idx = s->tags[tag];
+  // First entry not older than fromMs
+  uint32_t lo = 0, hi = idx.count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (recordAt(s->chunks, idx.seq[mid]).timeMs < fromMs) lo = mid + 1;
+    else hi = mid;
+  }
+  size_t n = 0;
+  for (uint32_t i = lo; i < idx.count && n < max; i++) {
+    const SightingRecord& r = recordAt(s->chunks, idx.seq[i]);
+    if (r.timeMs > toMs) break;
+    out[n++] = r;
+  }
+  return n;
+}
+
+size_t sightMemory(const SightingStore* s) {
+  size_t bytes = (size_t)s->chunkCount * SIGHT_CHUNK_RECORDS * sizeof(SightingRecord) +
+                 s->chunkCap * sizeof(SightingRecord*) + s->tagCount * sizeof(SightTagIndex);
+  for (uint32_t t = 0; t < s->tagCount; t++) bytes += (size_t)s->tags[t].cap * sizeof(uint32_t);
+  return bytes;
+}
+
+// ============================================================================
+// Compaction
+// ============================================================================
+
+/**
+ * @brief Merge state of one gateway within the current bucket.
+ */
+struct Bucket {
+  bool     used;    /**< Heard in this bucket. */
+  int8_t   rssi;    /**< Strongest RSSI. */
+  uint32_t count;   /**< Sightings merged. */
+};
+
+bool sightCompact(SightingStore* s, int64_t mergeBeforeMs, int64_t bucketMs, int64_t dropBeforeMs) {
+  if (bucketMs <= 0) return false;
+  Log log = {};
+  SightTagIndex* tags = (SightTagIndex*)calloc(s->tagCount, sizeof(SightTagIndex));
+  bool ok = tags != nullptr;
+  SightStats stats = s->stats;
+  Bucket buckets[256] = {};
+  uint8_t touched[256];
+
+  for (uint32_t t = 0; ok && t < s->tagCount; t++) {
+    const SightTagIndex& src = s->tags[t];
+    SightTagIndex& dst = tags[t];
+    int64_t bucket = INT64_MIN;
+    int ntouched = 0;
+    // Emit the merged records of the current bucket, in gateway order
+    auto flush = [&]() {
+      std::sort(touched, touched + ntouched);
+      for (int k = 0; ok && k < ntouched; k++) {
+        Bucket& b = buckets[touched[k]];
+        SightingRecord r = { bucket * bucketMs, (uint16_t)t, touched[k], b.rssi, b.count };
+        uint32_t seq = logAppend(&log, r);
+        ok = seq != UINT32_MAX && indexReserve(&dst);
+        if (ok) dst.seq[dst.count++] = seq;
+        stats.merged--;  // counts the records saved, not those read
+        b.used = false;
+      }
+      ntouched = 0;
+    };
+    for (uint32_t i = 0; ok && i < src.count; i++) {
+      const SightingRecord& r = recordAt(s->chunks, src.seq[i]);
+      if (r.timeMs < dropBeforeMs) {
+        stats.dropped += r.count;
+        continue;
+      }
+      if (r.timeMs < mergeBeforeMs) {
+        // Floor division, so buckets before the epoch work too
+        int64_t b = r.timeMs / bucketMs - (r.timeMs % bucketMs < 0);
+        if (b != bucket) {
+          flush();
+          bucket = b;
+        }
+        Bucket& acc = buckets[r.anchor];
+        if (!acc.used) {
+          acc = { true, r.rssi, 0 };
+          touched[ntouched++] = r.anchor;
+        }
+        if (r.rssi > acc.rssi) acc.rssi = r.rssi;
+        acc.count += r.count;
+        stats.merged++;
+        continue;
+      }
+      flush();
+      uint32_t seq = logAppend(&log, r);
+      ok = seq != UINT32_MAX && indexReserve(&dst);
+      if (ok) dst.seq[dst.count++] = seq;
+    }
+    if (ok) flush();
+  }
+
+  if (!ok) {
+    logFree(&log);
+    for (uint32_t t = 0; tags && t < s->tagCount; t++) free(tags[t].seq);
+    free(tags);
+    return false;
+  }
+  Log old = { s->chunks, s->chunkCount, s->chunkCap, s->records };
+  logFree(&old);
+  for (uint32_t t = 0; t < s->tagCount; t++) free(s->tags[t].seq);
+  free(s->tags);
+  s->chunks = log.chunks;
+  s->chunkCount = log.chunkCount;
+  s->chunkCap = log.chunkCap;
+  s->records = log.records;
+  s->tags = tags;
+  s->stats = stats;
+  return true;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file sightings.h
+ * @brief Store of tag sightings reported by many gateways, answering "last
+ *        seen where and when" for every tag.
+ *
+ * A gateway runs the tracker's scan logic and reports each advertisement it
+ * hears as (ephemeral identifier, gateway, RSSI, time). The store resolves
+ * the identifier to an owned tag with the tracker's own rolling identifier
+ * index (`scanner/tagIndex.h`, kept at the newest report time so one lagging
+ * gateway cannot rewind it), then
+ *
+ * - appends the sighting to a log of fixed-size chunks (16 bytes each);
+ * - appends its record number to the tag's time index, moving it back past
+ *   the few newer entries when a gateway reports late.
+ *
+ * "Last seen" walks the tail of one tag's index: the time is that of the
+ * newest sighting, the place the gateway that heard the tag loudest within
+ * SIGHT_PLACE_WINDOW_MS of it. History queries binary-search the index.
+ *
+ * Compaction rewrites the log tag by tag: sightings older than a horizon are
+ * merged into one record per gateway and time bucket (keeping the strongest
+ * RSSI and the number of sightings merged), and sightings older than the
+ * retention limit are dropped.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "../scanner/tagIndex.h"
+
+/** @brief Records per log chunk (1 MiB). */
+#define SIGHT_CHUNK_RECORDS 65536
+
+/** @brief Sightings this close to a tag's newest one vote for its place (ms). */
+#define SIGHT_PLACE_WINDOW_MS 2000
+
+/**
+ * @brief One report from a gateway.
+ */
+struct SightingReport {
+  uint64_t ephemeralId;   /**< Rolling identifier advertised by the tag. */
+  int64_t  timeMs;        /**< Time heard (ms since the shared epoch). */
+  uint8_t  anchor;        /**< Gateway that heard it. */
+  int8_t   rssi;          /**< RSSI (dBm). */
+};
+
+/**
+ * @brief One stored sighting, or a merged bucket of them (16 bytes).
+ */
+struct SightingRecord {
+  int64_t  timeMs;   /**< Time heard (ms since the shared epoch). */
+  uint16_t tag;      /**< Owned tag. */
+  uint8_t  anchor;   /**< Gateway. */
+  int8_t   rssi;     /**< RSSI, the strongest when merged (dBm). */
+  uint32_t count;    /**< Sightings merged into this record. */
+};
+
+/**
+ * @brief Record numbers of one tag, oldest first.
+ */
+struct SightTagIndex {
+  uint32_t* seq;     /**< Record numbers. */
+  uint32_t  count;   /**< Entries. */
+  uint32_t  cap;     /**< Allocated entries. */
+};
+
+/**
+ * @brief Ingest counters.
+ */
+struct SightStats {
+  uint64_t ingested;     /**< Sightings stored. */
+  uint64_t unresolved;   /**< Reports whose identifier matched no tag. */
+  uint64_t late;         /**< Sightings stored behind a newer one of the same tag. */
+  uint64_t merged;       /**< Records removed by merging in compaction. */
+  uint64_t dropped;      /**< Sightings dropped by compaction. */
+};
+
+/**
+ * @brief The store.
+ */
+struct SightingStore {
+  SightingRecord** chunks;       /**< Log chunks. */
+  uint32_t         chunkCount;   /**< Chunks in use. */
+  uint32_t         chunkCap;     /**< Allocated chunk pointers. */
+  uint32_t         records;      /**< Records in the log. */
+  SightTagIndex*   tags;         /**< Time index per tag. */
+  uint32_t         tagCount;     /**< Owned tags. */
+  int64_t          newestMs;     /**< Newest report time, drives the identifier index. */
+  SightStats       stats;        /**< Counters. */
+};
+
+/**
+ * @brief Where and when a tag was last heard.
+ */
+struct LastSeen {
+  int64_t timeMs;   /**< Newest sighting. */
+  uint8_t anchor;   /**< Loudest gateway around that time. */
+  int8_t  rssi;     /**< Its RSSI (dBm). */
+  uint8_t heard;    /**< Sightings around that time (at most 255). */
+};
+
+/**
+ * @brief Start an empty store for a set of owned tags.
+ *
+ * @param[in] tags  Owned tag table (must outlive the store).
+ * @param[in] count Number of tags (at most TAG_INDEX_MAX_TAGS).
+ * @param[in] nowMs Current time (ms since the shared epoch).
+ * @return False if memory is exhausted or there are too many tags.
+ */
+bool sightInit(SightingStore* s, const OwnedTag* tags, uint32_t count, int64_t nowMs);
+
+/**
+ * @brief Release a store.
+ */
+void sightFree(SightingStore* s);
+
+/**
+ * @brief Resolve and store one report.
+ *
+ * @return False if the identifier matches no tag or memory is exhausted.
+ */
+bool sightIngest(SightingStore* s, const SightingReport* r);
+
+/**
+ * @brief Where and when a tag was last heard.
+ *
+ * @return False if the tag has no sightings.
+ */
+bool sightLastSeen(const SightingStore* s, uint16_t tag, LastSeen* out);
+
+/**
+ * @brief A tag's sightings in [fromMs, toMs], oldest first.
+ *
+ * @param[out] out Records.
+ * @param[in]  max Capacity of `out`.
+ * @return Number of records written.
+ */
+size_t sightHistory(const SightingStore* s, uint16_t tag, int64_t fromMs, int64_t toMs,
+                    SightingRecord* out, size_t max);
+
+/**
+ * @brief Compact old sightings.
+ *
+ * @param[in] mergeBeforeMs Sightings older than this are merged per gateway
+ *                          and bucket.
+ * @param[in] bucketMs      Bucket length for merging.
+ * @param[in] dropBeforeMs  Sightings older than this are dropped.
+ * @return False if memory is exhausted (the store is left unchanged).
+ */
+bool sightCompact(SightingStore* s, int64_t mergeBeforeMs, int64_t bucketMs, int64_t dropBeforeMs);
+
+/**
+ * @brief Bytes held by the log and the indexes.
+ */
+size_t sightMemory(const SightingStore* s);
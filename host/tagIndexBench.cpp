@@ -0,0 +1,172 @@
+/**
+ * @file tagIndexBench.cpp
+ * @brief Build time and lookup throughput of the tracker's rolling identifier
+ *        index (scanner/tagIndex.cpp) as the number of owned tags grows.
+ *
+ * For each tag count the bench loads random keys and reports:
+ *
+ * - the full build (three windows of identifiers) and the one-window
+ *   advance the tracker does every 15 minutes;
+ * - lookups per second for a mix of owned identifiers of the previous,
+ *   current and next window and of unknown identifiers;
+ * - the same sightings identified without the index, by computing every
+ *   tag's identifiers for the three windows until one matches.
+ *
+ * Every owned identifier must come back with its tag and window skew and
+ * every unknown one must miss; the bench exits with status 1 otherwise.
+ *
+ * Build (Linux):
+ *
+ *     g++ -std=c++17 -O2 -DTAG_INDEX_MAX_TAGS=4096 tagIndexBench.cpp ../scanner/tagIndex.cpp \
+ *         ../scanner/rollingId.cpp -o tagIndexBench
+ *
+ * Usage:
+ *
+ *     tagIndexBench [maxTags]
+ *
+ * Tag counts run from 16 in steps of four up to `maxTags` (default and
+ * upper bound TAG_INDEX_MAX_TAGS).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "../scanner/tagIndex.h"
+
+/** @brief Lookups timed per tag count. */
+#define BENCH_LOOKUPS 2000000
+
+/** @brief Sightings identified without the index per tag count. */
+#define BENCH_LINEAR 2000
+
+/** @brief Window advances timed per tag count. */
+#define BENCH_ADVANCES 32
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** @brief Results folded in so the timed loops are not optimised away. */
+static volatile uint64_t gSink;
+
+/** @brief Deterministic xorshift64* stream. */
+static uint64_t gRng = 0x9e3779b97f4a7c15ULL;
+static uint64_t next64() {
+  gRng ^= gRng >> 12;
+  gRng ^= gRng << 25;
+  gRng ^= gRng >> 27;
+  return gRng * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief A sighting to identify and the answer expected.
+ */
+struct Sighting {
+  uint64_t id;    /**< Advertised identifier. */
+  int16_t  tag;   /**< Expected tag, -1 for an unknown identifier. */
+  int8_t   skew;  /**< Expected window skew. */
+};
+
+/**
+ * @brief Identify a sighting by evaluating the PRF per tag and window.
+ */
+static TagMatch linearIdentify(const std::vector<OwnedTag>& tags, uint32_t window, uint64_t id) {
+  for (size_t t = 0; t < tags.size(); t++) {
+    for (int8_t skew = -1; skew <= 1; skew++) {
+      if (rollingIdFor(tags[t].key, window + skew) == id) return TagMatch{ (int16_t)t, skew };
+    }
+  }
+  return TagMatch{ -1, 0 };
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/**
+ * @brief Bench one tag count; returns the number of wrong answers.
+ */
+static unsigned benchCount(size_t count) {
+  std::vector<OwnedTag> tags(count);
+  for (OwnedTag& t : tags) {
+    t.name = "tag";
+    for (int b = 0; b < ROLLING_KEY_LEN; b++) t.key[b] = (uint8_t)next64();
+  }
+
+  const uint32_t start = 1000 * ROLLING_PERIOD_S;
+  double t0 = nowSec();
+  tagIndexInit(tags.data(), count, start);
+  double buildMs = (nowSec() - t0) * 1e3;
+
+  t0 = nowSec();
+  for (uint32_t a = 1; a <= BENCH_ADVANCES; a++) tagIndexRefresh(start + a * ROLLING_PERIOD_S);
+  double advanceMs = (nowSec() - t0) * 1e3 / BENCH_ADVANCES;
+  uint32_t epoch = start + BENCH_ADVANCES * ROLLING_PERIOD_S;
+  uint32_t window = rollingWindow(epoch);
+
+  // Half owned identifiers spread over the three windows, half unknown
+  std::vector<Sighting> sightings(4096);
+  for (Sighting& s : sightings) {
+    if (next64() & 1) {
+      s.tag = (int16_t)(next64() % count);
+      s.skew = (int8_t)(next64() % 3) - 1;
+      s.id = rollingIdFor(tags[s.tag].key, window + s.skew);
+    } else {
+      s.tag = -1;
+      s.skew = 0;
+      s.id = next64();
+    }
+  }
+
+  unsigned wrong = 0;
+  for (const Sighting& s : sightings) {
+    TagMatch m = tagIndexLookup(s.id);
+    if (m.tag != s.tag || (s.tag >= 0 && m.skew != s.skew)) wrong++;
+  }
+
+  uint64_t sink = 0;  // keeps the timed loops
+  t0 = nowSec();
+  for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+    TagMatch m = tagIndexLookup(sightings[i & (sightings.size() - 1)].id);
+    sink += (uint16_t)m.tag;
+  }
+  double lookupNs = (nowSec() - t0) * 1e9 / BENCH_LOOKUPS;
+
+  t0 = nowSec();
+  for (uint32_t i = 0; i < BENCH_LINEAR; i++) {
+    const Sighting& s = sightings[i & (sightings.size() - 1)];
+    TagMatch m = linearIdentify(tags, window, s.id);
+    sink += (uint16_t)m.tag;
+    if (m.tag != s.tag) wrong++;
+  }
+  double linearUs = (nowSec() - t0) * 1e6 / BENCH_LINEAR;
+
+  printf("%6zu  %10.3f  %10.3f  %10.1f  %10.2f  %12.1f  %8.0fx  %u\n", count, buildMs, advanceMs, lookupNs,
+         1e3 / lookupNs, linearUs, linearUs * 1e3 / lookupNs, wrong);
+  gSink += sink;
+  return wrong;
+}
+
+int main(int argc, char** argv) {
+  size_t maxTags = argc > 1 ? (size_t)atol(argv[1]) : TAG_INDEX_MAX_TAGS;
+  if (maxTags > TAG_INDEX_MAX_TAGS) maxTags = TAG_INDEX_MAX_TAGS;
+
+  printf("tagIndexBench: %u lookups (half owned, half unknown), %u linear sightings per count\n",
+         BENCH_LOOKUPS, BENCH_LINEAR);
+  printf("  tags    build ms  advance ms   lookup ns  Mlookup/s  linear us/sight  speedup  wrong\n");
+  unsigned wrong = 0;
+  size_t last = 0;
+  for (size_t count = 16; count <= maxTags; count *= 4) wrong += benchCount(last = count);
+  if (last != maxTags) wrong += benchCount(maxTags);
+  if (wrong) fprintf(stderr, "tagIndexBench: %u wrong answers\n", wrong);
+  return wrong ? 1 : 0;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file tagPop.cpp
+ * @brief Advertising, movement, radio and scanner reception of a synthetic
+ *        device population.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include "tagPop.h"
+#include "../scanner/rpaResolver.h"
+
+// ============================================================================
+// Model Constants
+// ============================================================================
+
+/** @brief Walking speed of wandering and commuting devices (m/s). */
+#define WALK_SPEED 1.2f
+
+/** @brief Shadowing decorrelation time of moving and still devices (s). */
+#define SHADOW_TAU_MOVING 10.0f
+#define SHADOW_TAU_STILL  60.0f
+
+/** @brief Commuters walk out this far past the area edge before turning back. */
+#define COMMUTE_REACH 1.5f
+
+// ============================================================================
+// Random Numbers
+// ============================================================================
+
+/**
+ * @brief splitmix64 generator: one stream drives the whole simulation.
+ */
+struct Rng {
+  uint64_t s;
+
+  uint64_t next() {
+    uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  /** @brief Uniform in [0, 1). */
+  float uniform() { return (next() >> 40) * (1.0f / 16777216.0f); }
+
+  /** @brief Uniform integer in [lo, hi]. */
+  uint32_t range(uint32_t lo, uint32_t hi) { return lo + (uint32_t)(next() % ((uint64_t)hi - lo + 1)); }
+
+  /** @brief Standard normal (Box-Muller). */
+  float gauss() {
+    float u = uniform(), v = uniform();
+    return sqrtf(-2.0f * logf(u + 1e-12f)) * cosf(6.2831853f * v);
+  }
+
+  void fill(uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; i++) p[i] = (uint8_t)next();
+  }
+};
+
+// ============================================================================
+// State
+// ============================================================================
+
+/**
+ * @brief One device.
+ */
+struct Device {
+  uint64_t   lastUs;       /**< Time of the last movement and shadowing update. */
+  uint32_t   intervalUs;   /**< Advertising interval. */
+  float      txPower;      /**< RSSI at 1 m (dBm). */
+  float      x, y;         /**< Position relative to the tracker (m). */
+  float      heading;      /**< Walking direction (rad), or the commute bearing. */
+  float      phase;        /**< Commute or carry phase (0-1). */
+  float      shadow;       /**< Current shadowing (dB). */
+  TagScript  script;       /**< Movement. */
+  TagPayload payload;      /**< Manufacturer data. */
+  bool       owned;        /**< Owned tag. */
+  bool       rpa;          /**< Resolvable private addresses. */
+  uint8_t    battery;      /**< Battery byte of rolling payloads (%). */
+  uint8_t    addr[6];      /**< Current address, most significant byte first. */
+  uint32_t   addrSlot;     /**< Rotation slot of the current address. */
+  uint32_t   addrOffsetS;  /**< Offset of this device's address rotation (s). */
+  uint8_t    key[ROLLING_KEY_LEN];   /**< Rolling identifier key (owned: shared key). */
+  uint8_t    irk[16];      /**< Identity resolving key. */
+  uint8_t    mfr[ROLLING_MFR_BATTERY_LEN];   /**< Current manufacturer data. */
+  uint8_t    mfrLen;       /**< Its length. */
+  uint32_t   mfrWindow;    /**< Rolling window of the current payload. */
+};
+
+/**
+ * @brief One PDU on the air, waiting for the collision check.
+ */
+struct Pdu {
+  TagPopAdv adv;        /**< What the scanner gets if it is received. */
+  bool      weak;       /**< Below the sensitivity: neither heard nor interfering. */
+  bool      collided;   /**< Overlapped another audible PDU on the channel. */
+};
+
+/**
+ * @brief Next advertising event of a device, ordered by time then device.
+ */
+struct Event {
+  uint64_t timeUs;
+  uint32_t device;
+  bool operator>(const Event& o) const {
+    return timeUs != o.timeUs ? timeUs > o.timeUs : device > o.device;
+  }
+};
+
+struct TagPop {
+  TagPopConfig        cfg;
+  std::vector<Device> devices;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+  std::vector<Pdu>    pending;    /**< PDUs not yet checked, in generation order. */
+  TagPopStats         stats;
+  Rng                 rng;
+};
+
+// ============================================================================
+// Devices
+// ============================================================================
+
+static float distanceOf(const Device& d) {
+  return sqrtf(d.x * d.x + d.y * d.y);
+}
+
+/**
+ * @brief Move a device and evolve its shadowing up to `nowUs`.
+ */
+static void advance(TagPop* pop, Device& d, uint64_t nowUs) {
+  float dt = (nowUs - d.lastUs) * 1e-6f;
+  d.lastUs = nowUs;
+  float half = pop->cfg.areaHalf;
+  switch (d.script) {
+    case SCRIPT_STILL:
+      break;
+    case SCRIPT_WANDER:
+      d.heading += 0.3f * sqrtf(dt) * pop->rng.gauss();
+      d.x += WALK_SPEED * dt * cosf(d.heading);
+      d.y += WALK_SPEED * dt * sinf(d.heading);
+      if (d.x < -half || d.x > half) { d.heading = (float)M_PI - d.heading; d.x = std::min(std::max(d.x, -half), half); }
+      if (d.y < -half || d.y > half) { d.heading = -d.heading; d.y = std::min(std::max(d.y, -half), half); }
+      break;
+    case SCRIPT_COMMUTE: {
+      // Out from 1 m to COMMUTE_REACH * half and back along one bearing
+      float reach = COMMUTE_REACH * half - 1.0f;
+      d.phase = fmodf(d.phase + WALK_SPEED * dt / (2.0f * reach), 1.0f);
+      float r = 1.0f + reach * (d.phase < 0.5f ? 2.0f * d.phase : 2.0f - 2.0f * d.phase);
+      d.x = r * cosf(d.heading);
+      d.y = r * sinf(d.heading);
+      break;
+    }
+    case SCRIPT_CARRIED: {
+      // Swinging between 1 and 2 m from the tracker every 20 s
+      d.phase = fmodf(d.phase + dt / 20.0f, 1.0f);
+      float r = 1.5f + 0.5f * sinf(6.2831853f * d.phase);
+      d.heading += 0.2f * sqrtf(dt) * pop->rng.gauss();
+      d.x = r * cosf(d.heading);
+      d.y = r * sinf(d.heading);
+      break;
+    }
+  }
+  float tau = d.script == SCRIPT_STILL ? SHADOW_TAU_STILL : SHADOW_TAU_MOVING;
+  float rho = expf(-dt / tau);
+  d.shadow = rho * d.shadow + sqrtf(1.0f - rho * rho) * pop->cfg.shadowDb * pop->rng.gauss();
+}
+
+/**
+ * @brief Bring a device's address and payload up to date.
+ *
+ * Addresses change once per rotation period, at an offset of the device's
+ * own; rolling payloads change at the shared window boundaries.
+ */
+static void refreshIdentity(TagPop* pop, Device& d, uint64_t nowUs) {
+  uint32_t epoch = pop->cfg.epochSeconds + (uint32_t)(nowUs / 1000000);
+  uint32_t slot = (epoch + d.addrOffsetS) / ROLLING_PERIOD_S;
+  if (d.rpa && slot != d.addrSlot) {
+    d.addrSlot = slot;
+    uint8_t prand[3];
+    pop->rng.fill(prand, 3);
+    prand[0] = (prand[0] & 0x3F) | 0x40;
+    memcpy(d.addr, prand, 3);
+    rpaHash(d.irk, prand, &d.addr[3]);
+  }
+  if (d.payload == PAYLOAD_ROLLING) {
+    uint32_t window = rollingWindow(epoch);
+    if (window != d.mfrWindow || d.mfrLen == 0) {
+      d.mfrWindow = window;
+      rollingEncodeMfr(rollingIdFor(d.key, window), d.mfr);
+      d.mfr[ROLLING_MFR_LEN] = d.battery;
+      d.mfrLen = ROLLING_MFR_BATTERY_LEN;
+    }
+  }
+}
+
+// ============================================================================
+// Population
+// ============================================================================
+
+TagPop* tagPopCreate(const TagPopConfig* cfg, const TagPopGroup* groups, size_t count,
+                     const uint8_t (*keys)[ROLLING_KEY_LEN]) {
+  TagPop* pop = new (std::nothrow) TagPop();
+  if (!pop) return nullptr;
+  pop->cfg = *cfg;
+  pop->rng.s = cfg->seed;
+  size_t owned = 0;
+  for (size_t g = 0; g < count; g++) {
+    const TagPopGroup& grp = groups[g];
+    for (uint32_t i = 0; i < grp.count; i++) {
+      Device d = {};
+      Rng& rng = pop->rng;
+      d.intervalUs = rng.range(grp.intervalMinUs, std::max(grp.intervalMinUs, grp.intervalMaxUs));
+      d.txPower = grp.txPower;
+      d.script = grp.script;
+      d.owned = grp.owned;
+      d.rpa = grp.rpa;
+      d.payload = grp.owned ? PAYLOAD_ROLLING : grp.payload;
+      d.battery = (uint8_t)rng.range(20, 100);
+      d.heading = 6.2831853f * rng.uniform();
+      d.phase = rng.uniform();
+      d.shadow = cfg->shadowDb * rng.gauss();
+      d.x = (2.0f * rng.uniform() - 1.0f) * cfg->areaHalf;
+      d.y = (2.0f * rng.uniform() - 1.0f) * cfg->areaHalf;
+      if (grp.owned) memcpy(d.key, keys[owned++], ROLLING_KEY_LEN);
+      else rng.fill(d.key, ROLLING_KEY_LEN);
+      rng.fill(d.irk, sizeof(d.irk));
+      d.addrOffsetS = rng.range(0, ROLLING_PERIOD_S - 1);
+      d.addrSlot = UINT32_MAX;
+      if (!d.rpa) {
+        rng.fill(d.addr, 6);
+        d.addr[0] |= 0xC0;   // static random address
+      }
+      if (d.payload == PAYLOAD_VENDOR) {
+        d.mfr[0] = 0x4C;     // another company's identifier, little endian
+        d.mfr[1] = 0x00;
+        rng.fill(&d.mfr[2], ROLLING_MFR_BATTERY_LEN - 2);
+        d.mfrLen = ROLLING_MFR_BATTERY_LEN;
+      }
+      uint32_t index = (uint32_t)pop->devices.size();
+      pop->devices.push_back(d);
+      pop->events.push({ rng.range(0, d.intervalUs), index });
+    }
+  }
+  return pop;
+}
+
+void tagPopDestroy(TagPop* pop) {
+  delete pop;
+}
+
+uint32_t tagPopDevices(const TagPop* pop) {
+  return (uint32_t)pop->devices.size();
+}
+
+bool tagPopOwned(const TagPop* pop, uint32_t device, float* meters) {
+  if (device >= pop->devices.size()) return false;
+  const Device& d = pop->devices[device];
+  if (meters) *meters = distanceOf(d);
+  return d.owned;
+}
+
+bool tagPopIrk(const TagPop* pop, uint32_t device, uint8_t irk[16]) {
+  if (device >= pop->devices.size() || !pop->devices[device].rpa) return false;
+  memcpy(irk, pop->devices[device].irk, 16);
+  return true;
+}
+
+TagPopStats tagPopStats(const TagPop* pop) {
+  return pop->stats;
+}
+
+// ============================================================================
+// Air
+// ============================================================================
+
+/**
+ * @brief Whether the scanner listens to a whole PDU.
+ */
+static bool listening(const TagPopConfig& cfg, uint64_t timeUs, uint8_t channel) {
+  uint64_t k = timeUs / cfg.scanIntervalUs;
+  uint64_t offset = timeUs - k * cfg.scanIntervalUs;
+  return channel == 37 + k % 3 && offset + TAGPOP_AIR_US <= cfg.scanWindowUs;
+}
+
+/**
+ * @brief Send one advertising event: a PDU on each primary channel.
+ */
+static void sendEvent(TagPop* pop, uint32_t index, uint64_t nowUs) {
+  Device& d = pop->devices[index];
+  advance(pop, d, nowUs);
+  refreshIdentity(pop, d, nowUs);
+  float meters = std::max(distanceOf(d), 0.1f);
+  float mean = d.txPower - 10.0f * pop->cfg.nFactor * log10f(meters) + d.shadow;
+  float k = pop->cfg.ricianK;
+  float los = sqrtf(k / (k + 1.0f)), scatter = sqrtf(0.5f / (k + 1.0f));
+  pop->stats.events++;
+  for (uint8_t c = 0; c < 3; c++) {
+    // Rician fast fading, independent per channel
+    float re = los + scatter * pop->rng.gauss(), im = scatter * pop->rng.gauss();
+    float rssi = mean + 10.0f * log10f(re * re + im * im + 1e-12f);
+    Pdu p = {};
+    p.adv.timeUs = nowUs + (uint64_t)c * TAGPOP_CHANNEL_GAP_US;
+    p.adv.device = index;
+    p.adv.channel = (uint8_t)(37 + c);
+    p.adv.rssi = (int8_t)std::min(std::max(lrintf(rssi), -127L), 20L);
+    memcpy(p.adv.addr, d.addr, 6);
+    memcpy(p.adv.mfr, d.mfr, d.mfrLen);
+    p.adv.mfrLen = d.mfrLen;
+    p.adv.owned = d.owned;
+    p.adv.meters = meters;
+    p.weak = rssi < pop->cfg.sensitivityDbm;
+    pop->pending.push_back(p);
+  }
+  pop->stats.pdus += 3;
+  uint64_t next = nowUs + d.intervalUs + pop->rng.range(0, TAGPOP_ADV_DELAY_US);
+  pop->events.push({ next, index });
+}
+
+void tagPopRun(TagPop* pop, uint64_t untilUs, TagPopFn fn, void* ctx) {
+  while (!pop->events.empty() && pop->events.top().timeUs < untilUs) {
+    Event e = pop->events.top();
+    pop->events.pop();
+    sendEvent(pop, e.device, e.timeUs);
+  }
+
+  // Every PDU starting before untilUs exists now, so any PDU ending by then
+  // has met all the PDUs it can overlap
+  std::vector<Pdu>& p = pop->pending;
+  std::stable_sort(p.begin(), p.end(), [](const Pdu& a, const Pdu& b) { return a.adv.timeUs < b.adv.timeUs; });
+  size_t last[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+  for (size_t i = 0; i < p.size(); i++) {
+    if (p[i].weak) continue;
+    size_t& prev = last[p[i].adv.channel - 37];
+    // Equal air times: overlapping any earlier PDU means overlapping the latest
+    if (prev != SIZE_MAX && p[i].adv.timeUs < p[prev].adv.timeUs + TAGPOP_AIR_US) {
+      p[i].collided = true;
+      p[prev].collided = true;
+    }
+    prev = i;
+  }
+
+  size_t done = 0;
+  while (done < p.size() && p[done].adv.timeUs + TAGPOP_AIR_US <= untilUs) {
+    const Pdu& q = p[done++];
+    if (!listening(pop->cfg, q.adv.timeUs, q.adv.channel)) pop->stats.offWindow++;
+    else if (q.collided) pop->stats.collided++;
+    else if (q.weak) pop->stats.weak++;
+    else {
+      pop->stats.received++;
+      fn(&q.adv, ctx);
+    }
+  }
+  // Held PDUs keep their collision marks; the next call re-checks them
+  p.erase(p.begin(), p.begin() + done);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file tagPop.h
+ * @brief Synthetic population of advertising devices around one tracker, to
+ *        load the tracker's scan path.
+ *
+ * Devices are described in groups (owned tags, phones, beacons): each has an
+ * advertising interval range, a transmit power, an address type and a
+ * movement script. The simulation runs on the air, in microseconds:
+ *
+ * - every advertising event goes out on channels 37, 38 and 39,
+ *   TAGPOP_CHANNEL_GAP_US apart, after the interval plus the 0-10 ms random
+ *   advDelay of the specification;
+ * - the scanner listens on one channel per scan interval, for the scan
+ *   window, rotating 37, 38, 39;
+ * - two PDUs on the same channel that overlap in time are both lost (no
+ *   capture);
+ * - the RSSI follows the log-distance path-loss model with slowly varying
+ *   log-normal shadowing per device and Rician fast fading per packet;
+ *   packets below the sensitivity are lost.
+ *
+ * Owned tags advertise the rolling identifier of the current window in
+ * their manufacturer data (`scanner/rollingId.h`) with a battery byte, like
+ * the tag sketch; other devices carry another tracker's identifier or
+ * another vendor's data, from a static or resolvable private address that
+ * changes with each rotation period. Everything derives from one seed, so a
+ * run is repeatable.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "../scanner/rollingId.h"
+
+/** @brief Air time of one advertising PDU of the tag's size at 1M PHY (us). */
+#define TAGPOP_AIR_US 272
+
+/** @brief Gap between the channels of one advertising event (us). */
+#define TAGPOP_CHANNEL_GAP_US 400
+
+/** @brief Upper bound of the random advDelay added to every interval (us). */
+#define TAGPOP_ADV_DELAY_US 10000
+
+/**
+ * @brief How a device moves relative to the tracker.
+ */
+enum TagScript : uint8_t {
+  SCRIPT_STILL   = 0,   /**< Fixed position. */
+  SCRIPT_WANDER  = 1,   /**< Random walk at walking pace inside the area. */
+  SCRIPT_COMMUTE = 2,   /**< Walks straight out of range and back, repeatedly. */
+  SCRIPT_CARRIED = 3,   /**< Stays 1-2 m from the tracker (carried by its user). */
+};
+
+/**
+ * @brief What a device carries in its manufacturer data.
+ */
+enum TagPayload : uint8_t {
+  PAYLOAD_NONE    = 0,   /**< No manufacturer data. */
+  PAYLOAD_ROLLING = 1,   /**< Rolling identifier and battery (owned, or another owner's tag). */
+  PAYLOAD_VENDOR  = 2,   /**< Another company's data of the same length. */
+};
+
+/**
+ * @brief One group of devices.
+ */
+struct TagPopGroup {
+  uint32_t   count;          /**< Devices. */
+  bool       owned;          /**< Owned tags (keys from the owned tag table). */
+  bool       rpa;            /**< Resolvable private addresses instead of static ones. */
+  TagPayload payload;        /**< Manufacturer data (owned tags always roll). */
+  uint32_t   intervalMinUs;  /**< Advertising interval range (us); each device picks one. */
+  uint32_t   intervalMaxUs;  /**< Advertising interval range (us). */
+  float      txPower;        /**< RSSI at 1 m (dBm). */
+  TagScript  script;         /**< Movement. */
+};
+
+/**
+ * @brief Radio and scanner parameters.
+ */
+struct TagPopConfig {
+  float    nFactor;         /**< Path-loss exponent. */
+  float    shadowDb;        /**< Shadowing standard deviation (dB). */
+  float    ricianK;         /**< Rician K factor of the fast fading (0 = Rayleigh). */
+  float    sensitivityDbm;  /**< Weakest packet received (dBm). */
+  float    areaHalf;        /**< Devices stay in a square this far from the tracker (m). */
+  uint32_t scanIntervalUs;  /**< Scan interval (us). */
+  uint32_t scanWindowUs;    /**< Scan window (us, <= interval). */
+  uint32_t epochSeconds;    /**< Shared-epoch time at simulation time 0. */
+  uint64_t seed;            /**< Seed of every random choice. */
+};
+
+/**
+ * @brief One received advertisement.
+ */
+struct TagPopAdv {
+  uint64_t timeUs;                          /**< Start of the PDU. */
+  uint32_t device;                          /**< Device index, in group order. */
+  uint8_t  channel;                         /**< 37, 38 or 39. */
+  int8_t   rssi;                            /**< RSSI (dBm). */
+  uint8_t  addr[6];                         /**< Address, most significant byte first. */
+  uint8_t  mfr[ROLLING_MFR_BATTERY_LEN];    /**< Manufacturer data. */
+  uint8_t  mfrLen;                          /**< Its length (0 = none). */
+  bool     owned;                           /**< From an owned tag. */
+  float    meters;                          /**< True distance at that time. */
+};
+
+/**
+ * @brief Air counters.
+ */
+struct TagPopStats {
+  uint64_t events;      /**< Advertising events. */
+  uint64_t pdus;        /**< PDUs sent (3 per event). */
+  uint64_t offWindow;   /**< PDUs the scanner was not listening to. */
+  uint64_t collided;    /**< PDUs lost to an overlapping PDU on the channel. */
+  uint64_t weak;        /**< PDUs below the sensitivity. */
+  uint64_t received;    /**< PDUs delivered. */
+};
+
+struct TagPop;
+
+/**
+ * @brief Called for every received advertisement, in time order.
+ */
+typedef void (*TagPopFn)(const TagPopAdv* adv, void* ctx);
+
+/**
+ * @brief Create a population.
+ *
+ * @param[in] cfg    Radio and scanner parameters (copied).
+ * @param[in] groups Device groups (copied).
+ * @param[in] count  Number of groups.
+ * @param[in] keys   Keys of the owned tags, one per owned device in group
+ *                   order (copied).
+ * @return The population, or nullptr if memory is exhausted.
+ */
+TagPop* tagPopCreate(const TagPopConfig* cfg, const TagPopGroup* groups, size_t count,
+                     const uint8_t (*keys)[ROLLING_KEY_LEN]);
+
+/**
+ * @brief Release a population.
+ */
+void tagPopDestroy(TagPop* pop);
+
+/**
+ * @brief Run the air up to `untilUs` and deliver what the scanner received.
+ *
+ * PDUs that may still overlap one sent after `untilUs` are held for the
+ * next call.
+ */
+void tagPopRun(TagPop* pop, uint64_t untilUs, TagPopFn fn, void* ctx);
+
+/**
+ * @brief Number of devices.
+ */
+uint32_t tagPopDevices(const TagPop* pop);
+
+/**
+ * @brief Whether a device is an owned tag, and its true distance at the
+ *        time of its last advertising event (m).
+ */
+bool tagPopOwned(const TagPop* pop, uint32_t device, float* meters);
+
+/**
+ * @brief Identity resolving key of a device (most significant byte first),
+ *        to bond owned tags with the resolver.
+ *
+ * @return False if the device does not use resolvable private addresses.
+ */
+bool tagPopIrk(const TagPop* pop, uint32_t device, uint8_t irk[16]);
+
+/**
+ * @brief Air counters so far.
+ */
+TagPopStats tagPopStats(const TagPop* pop);
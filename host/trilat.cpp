@@ -0,0 +1,162 @@
+/**
+ * @file trilat.cpp
+ * @brief Weighted Gauss-Newton trilateration and the anchor report service.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "trilat.h"
+
+// ============================================================================
+// Solver
+// ============================================================================
+
+/**
+ * @brief Weighted squared residual sum at a position.
+ */
+static double cost(const TrilatAnchor* anchors, const TrilatRange* ranges, const double* w,
+                   size_t count, double x, double y) {
+  double c = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const TrilatAnchor& a = anchors[ranges[i].anchor];
+    double r = hypot(x - a.x, y - a.y) - ranges[i].meters;
+    c += w[i] * r * r;
+  }
+  return c;
+}
+
+bool trilatSolve(const TrilatAnchor* anchors, const TrilatRange* ranges, size_t count,
+                 const double* start, TrilatFix* fix) {
+  if (count < 3 || count > TRILAT_MAX_ANCHORS) return false;
+
+  double w[TRILAT_MAX_ANCHORS];
+  for (size_t i = 0; i < count; i++) {
+    w[i] = 1.0 / (ranges[i].variance > TRILAT_VAR_FLOOR ? ranges[i].variance : TRILAT_VAR_FLOOR);
+  }
+
+  double x, y;
+  if (start) {
+    x = start[0];
+    y = start[1];
+  } else {
+    // Centroid weighted towards the anchors that see the tag close
+    double sw = 0.0;
+    x = y = 0.0;
+    for (size_t i = 0; i < count; i++) {
+      const TrilatAnchor& a = anchors[ranges[i].anchor];
+      double k = 1.0 / (ranges[i].meters + 0.5);
+      x += k * a.x;
+      y += k * a.y;
+      sw += k;
+    }
+    x /= sw;
+    y /= sw;
+  }
+
+  double c = cost(anchors, ranges, w, count, x, y);
+  double hxx = 0.0, hxy = 0.0, hyy = 0.0;
+  uint8_t it = 0;
+  while (it < TRILAT_MAX_ITERATIONS) {
+    it++;
+    // Normal equations J^T W J d = -J^T W r
+    double gx = 0.0, gy = 0.0;
+    hxx = hxy = hyy = 0.0;
+    for (size_t i = 0; i < count; i++) {
+      const TrilatAnchor& a = anchors[ranges[i].anchor];
+      double dx = x - a.x, dy = y - a.y;
+      double dist = hypot(dx, dy);
+      if (dist < 1e-9) dist = 1e-9;
+      double jx = dx / dist, jy = dy / dist;
+      double r = dist - ranges[i].meters;
+      gx += w[i] * jx * r;
+      gy += w[i] * jy * r;
+      hxx += w[i] * jx * jx;
+      hxy += w[i] * jx * jy;
+      hyy += w[i] * jy * jy;
+    }
+    double det = hxx * hyy - hxy * hxy;
+    if (fabs(det) < 1e-12 * (hxx + hyy) * (hxx + hyy)) return false;  // anchors in a line
+    double sx = -(hyy * gx - hxy * gy) / det;
+    double sy = -(hxx * gy - hxy * gx) / det;
+
+    // Halve the step until it does not increase the cost
+    double nx = x + sx, ny = y + sy, nc = cost(anchors, ranges, w, count, nx, ny);
+    for (int h = 0; h < 8 && nc > c; h++) {
+      sx *= 0.5;
+      sy *= 0.5;
+      nx = x + sx;
+      ny = y + sy;
+      nc = cost(anchors, ranges, w, count, nx, ny);
+    }
+    if (nc > c) break;
+    x = nx;
+    y = ny;
+    c = nc;
+    if (hypot(sx, sy) < TRILAT_STEP_EPS) break;
+  }
+
+  double det = hxx * hyy - hxy * hxy;
+  double sumSq = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const TrilatAnchor& a = anchors[ranges[i].anchor];
+    double r = hypot(x - a.x, y - a.y) - ranges[i].meters;
+    sumSq += r * r;
+  }
+  fix->x = x;
+  fix->y = y;
+  fix->rms = sqrt(sumSq / count);
+  fix->covXX = hyy / det;
+  fix->covXY = -hxy / det;
+  fix->covYY = hxx / det;
+  fix->anchors = (uint8_t)count;
+  fix->iterations = it;
+  return true;
+}
+
+// ============================================================================
+// Service
+// ============================================================================
+
+bool trilatInit(TrilatService* s, const TrilatAnchor* anchors, size_t count, uint32_t alignMs) {
+  if (count > TRILAT_MAX_ANCHORS) return false;
+  memset(s, 0, sizeof(*s));
+  memcpy(s->anchors, anchors, count * sizeof(TrilatAnchor));
+  s->anchorCount = (uint8_t)count;
+  s->alignMs = alignMs;
+  return true;
+}
+
+bool trilatIngest(TrilatService* s, uint8_t anchor, uint8_t tag, uint64_t timeMs,
+                  double meters, double variance) {
+  if (anchor >= s->anchorCount || tag >= TRILAT_MAX_TAGS) return false;
+  TrilatReport& r = s->reports[tag][anchor];
+  r.meters = meters;
+  r.variance = variance;
+  r.timeMs = timeMs;
+  return true;
+}
+
+bool trilatUpdate(TrilatService* s, uint8_t tag, uint64_t nowMs, TrilatFix* fix) {
+  if (tag >= TRILAT_MAX_TAGS) return false;
+  TrilatRange ranges[TRILAT_MAX_ANCHORS];
+  size_t count = 0;
+  for (uint8_t a = 0; a < s->anchorCount; a++) {
+    const TrilatReport& r = s->reports[tag][a];
+    if (r.timeMs == 0 || nowMs - r.timeMs > s->alignMs) continue;
+    ranges[count].anchor = a;
+    ranges[count].meters = r.meters;
+    ranges[count].variance = r.variance;
+    count++;
+  }
+
+  // Warm start from a fix no older than the alignment window
+  const TrilatFix& prev = s->last[tag];
+  bool warm = prev.timeMs != 0 && nowMs - prev.timeMs <= s->alignMs;
+  double start[2] = { prev.x, prev.y };
+  if (!trilatSolve(s->anchors, ranges, count, warm ? start : nullptr, fix)) return false;
+  fix->timeMs = nowMs;
+  s->last[tag] = *fix;
+  s->solves++;
+  if (warm) s->warmStarts++;
+  return true;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file trilat.h
+ * @brief Tag position from the distances several fixed trackers (anchors)
+ *        report for it.
+ *
+ * Each anchor sits at a known position on the floor plan and reports, per
+ * tag, a distance estimate with its variance (the tracker's
+ * `distanceVariance()`). A fix is the weighted nonlinear least-squares
+ * position
+ *
+ * \f[
+ *   \hat p = \arg\min_p \sum_i \frac{(\lVert p - a_i \rVert - d_i)^2}{\sigma_i^2}
+ * \f]
+ *
+ * found by Gauss-Newton iterations on the 2x2 normal equations, halving the
+ * step whenever it would increase the cost. The service keeps the latest
+ * report of every anchor per tag, solves from those reported within an
+ * alignment window, and starts from the tag's previous fix when it is
+ * recent (warm start), otherwise from the weighted centroid of the anchors.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Anchors per service at most. */
+#define TRILAT_MAX_ANCHORS 16
+
+/** @brief Tags per service at most. */
+#define TRILAT_MAX_TAGS 16
+
+/** @brief Gauss-Newton iterations at most. */
+#define TRILAT_MAX_ITERATIONS 20
+
+/** @brief Iterations stop once a step is shorter than this (m). */
+#define TRILAT_STEP_EPS 1e-3
+
+/** @brief Smallest variance used as a weight (m^2), so one anchor cannot dominate. */
+#define TRILAT_VAR_FLOOR 0.01
+
+/**
+ * @brief Anchor position (m).
+ */
+struct TrilatAnchor {
+  double x;   /**< East. */
+  double y;   /**< North. */
+};
+
+/**
+ * @brief One anchor's distance to the tag.
+ */
+struct TrilatRange {
+  uint8_t anchor;     /**< Anchor index. */
+  double  meters;     /**< Estimated distance. */
+  double  variance;   /**< Its variance (m^2). */
+};
+
+/**
+ * @brief Result of a solve.
+ */
+struct TrilatFix {
+  double   x;            /**< Position east (m). */
+  double   y;            /**< Position north (m). */
+  double   rms;          /**< Root mean square range residual (m). */
+  double   covXX;        /**< Position covariance (m^2), from the weights. */
+  double   covXY;        /**< Position covariance (m^2). */
+  double   covYY;        /**< Position covariance (m^2). */
+  uint8_t  anchors;      /**< Ranges used. */
+  uint8_t  iterations;   /**< Gauss-Newton iterations run. */
+  uint64_t timeMs;       /**< Time of the fix. */
+};
+
+/**
+ * @brief Solve one position.
+ *
+ * @param[in]  anchors Anchor positions, indexed by TrilatRange::anchor.
+ * @param[in]  ranges  Distances (at least 3).
+ * @param[in]  count   Number of ranges.
+ * @param[in]  start   Initial position {x, y}, or nullptr for the weighted
+ *                     centroid of the anchors.
+ * @param[out] fix     Position and quality.
+ * @return False with fewer than 3 ranges or a degenerate geometry.
+ */
+bool trilatSolve(const TrilatAnchor* anchors, const TrilatRange* ranges, size_t count,
+                 const double* start, TrilatFix* fix);
+
+/**
+ * @brief Latest report of one anchor for one tag.
+ */
+struct TrilatReport {
+  double   meters;     /**< Distance. */
+  double   variance;   /**< Variance (m^2). */
+  uint64_t timeMs;     /**< Arrival time, 0 if none. */
+};
+
+/**
+ * @brief Time-aligning service over a fixed anchor layout.
+ */
+struct TrilatService {
+  TrilatAnchor anchors[TRILAT_MAX_ANCHORS];                    /**< Layout. */
+  uint8_t      anchorCount;                                    /**< Anchors in the layout. */
+  uint32_t     alignMs;                                        /**< Reports older than this are ignored. */
+  TrilatReport reports[TRILAT_MAX_TAGS][TRILAT_MAX_ANCHORS];   /**< Latest reports per tag. */
+  TrilatFix    last[TRILAT_MAX_TAGS];                          /**< Latest fix per tag (timeMs 0 = none). */
+  uint32_t     solves;                                         /**< Successful solves. */
+  uint32_t     warmStarts;                                     /**< Solves started from the previous fix. */
+};
+
+/**
+ * @brief Reset a service.
+ *
+ * @param[out] s       Service.
+ * @param[in]  anchors Layout (copied).
+ * @param[in]  count   Number of anchors (at most TRILAT_MAX_ANCHORS).
+ * @param[in]  alignMs Reports older than this at solve time are left out (ms).
+ * @return False if there are too many anchors.
+ */
+bool trilatInit(TrilatService* s, const TrilatAnchor* anchors, size_t count, uint32_t alignMs);
+
+/**
+ * @brief Store an anchor's report for a tag.
+ *
+ * @return False if the anchor or the tag is out of range.
+ */
+bool trilatIngest(TrilatService* s, uint8_t anchor, uint8_t tag, uint64_t timeMs,
+                  double meters, double variance);
+
+/**
+ * @brief Solve a tag's position from its aligned reports.
+ *
+ * @param[in]  s     Service.
+ * @param[in]  tag   Tag.
+ * @param[in]  nowMs Time of the fix; reports older than `alignMs` are left out.
+ * @param[out] fix   The fix, also kept as the tag's warm start.
+ * @return False with fewer than 3 aligned reports or no solution.
+ */
+bool trilatUpdate(TrilatService* s, uint8_t tag, uint64_t nowMs, TrilatFix* fix);
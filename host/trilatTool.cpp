@@ -0,0 +1,356 @@
+/**
+ * @file trilatTool.cpp
+ * @brief Tag positions from several trackers at fixed positions (anchors).
+ *
+ * Build (Linux/macOS):
+ *
+ *     g++ -std=c++17 -O2 trilatTool.cpp trilat.cpp -o trilatTool
+ *
+ * Usage:
+ *
+ *     trilatTool serve <anchors.txt> [alignMs]
+ *     trilatTool bench [fixes]
+ *
+ * `serve` opens the serial port of every anchor listed in the layout file,
+ * one anchor per line as `name x y device` (metres; `#` starts a comment).
+ * Each tracker prints a line per distance estimate,
+ * `Tag <n> | ... | Distance: <m> m | Var: <v> m2`; reports are timestamped
+ * on arrival, and after each one the tag's position is solved from the
+ * reports of the last `alignMs` (default 600) and printed as
+ * `timeMs tag x y rms anchors iterations`.
+ *
+ * `bench` solves simulated walks through three anchor layouts with
+ * log-normal range noise (each anchor with its own RSSI noise) and reports
+ * solves per second, iterations, and the position error for unweighted
+ * and weighted solves, each started cold or from the previous fix.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "trilat.h"
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Monotonic clock in seconds.
+ */
+static double nowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Monotonic clock in milliseconds.
+ */
+static uint64_t nowMs() {
+  return (uint64_t)(nowSec() * 1000.0);
+}
+
+/**
+ * @brief Open a serial device in raw 8N1 mode.
+ *
+ * @param[in] path Device path (e.g. /dev/ttyACM0).
+ * @return File descriptor, or -1 on error.
+ */
+static int openSerial(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// ============================================================================
+// Serve
+// ============================================================================
+
+/**
+ * @brief One anchor of the layout file and its serial line state.
+ */
+struct AnchorPort {
+  char   name[32];    /**< Anchor name. */
+  char   device[128]; /**< Serial device. */
+  int    fd;          /**< Open port. */
+  char   line[256];   /**< Partial line. */
+  size_t len;         /**< Bytes in `line`. */
+};
+
+/**
+ * @brief Read the layout file.
+ *
+ * @return Number of anchors, or -1 on error.
+ */
+static int loadLayout(const char* path, TrilatAnchor* anchors, AnchorPort* ports) {
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+  char buf[256];
+  int n = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    char* hash = strchr(buf, '#');
+    if (hash) *hash = '\0';
+    AnchorPort& p = ports[n];
+    if (sscanf(buf, "%31s %lf %lf %127s", p.name, &anchors[n].x, &anchors[n].y, p.device) != 4) continue;
+    if (++n == TRILAT_MAX_ANCHORS) break;
+  }
+  fclose(f);
+  return n;
+}
+
+/**
+ * @brief Parse a tracker's distance line.
+ *
+ * @return False if the line is not a distance report.
+ */
+static bool parseReport(const char* line, unsigned* tag, double* meters, double* variance) {
+  if (sscanf(line, "Tag %u |", tag) != 1) return false;
+  const char* d = strstr(line, "Distance: ");
+  const char* v = strstr(line, "Var: ");
+  if (!d || !v) return false;
+  return sscanf(d, "Distance: %lf", meters) == 1 && sscanf(v, "Var: %lf", variance) == 1;
+}
+
+static int serve(const char* layoutPath, uint32_t alignMs) {
+  static AnchorPort ports[TRILAT_MAX_ANCHORS];
+  TrilatAnchor anchors[TRILAT_MAX_ANCHORS];
+  int count = loadLayout(layoutPath, anchors, ports);
+  if (count < 3) {
+    fprintf(stderr, "%s: need at least 3 anchors\n", layoutPath);
+    return 1;
+  }
+  static TrilatService svc;
+  trilatInit(&svc, anchors, (size_t)count, alignMs);
+
+  struct pollfd pfds[TRILAT_MAX_ANCHORS];
+  for (int i = 0; i < count; i++) {
+    ports[i].fd = openSerial(ports[i].device);
+    if (ports[i].fd < 0) {
+      fprintf(stderr, "%s: cannot open %s\n", ports[i].name, ports[i].device);
+      return 1;
+    }
+    pfds[i] = { ports[i].fd, POLLIN, 0 };
+    fprintf(stderr, "anchor %d: %s at (%.2f, %.2f) on %s\n", i, ports[i].name, anchors[i].x,
+            anchors[i].y, ports[i].device);
+  }
+
+  uint64_t t0 = nowMs();
+  for (;;) {
+    if (poll(pfds, (nfds_t)count, 1000) <= 0) continue;
+    for (int i = 0; i < count; i++) {
+      if (!(pfds[i].revents & POLLIN)) continue;
+      char buf[512];
+      ssize_t n = read(ports[i].fd, buf, sizeof(buf));
+      if (n <= 0) continue;
+      AnchorPort& p = ports[i];
+      for (ssize_t k = 0; k < n; k++) {
+        char c = buf[k];
+        if (c != '\n') {
+          if (p.len < sizeof(p.line) - 1) p.line[p.len++] = c;
+          continue;
+        }
+        p.line[p.len] = '\0';
+        p.len = 0;
+        unsigned tag;
+        double meters, variance;
+        if (!parseReport(p.line, &tag, &meters, &variance)) continue;
+        uint64_t t = nowMs() - t0 + 1;  // 0 marks "no report"
+        if (!trilatIngest(&svc, (uint8_t)i, (uint8_t)tag, t, meters, variance)) continue;
+        TrilatFix fix;
+        if (trilatUpdate(&svc, (uint8_t)tag, t, &fix)) {
+          printf("%llu %u %.2f %.2f %.2f %u %u\n", (unsigned long long)t, tag, fix.x, fix.y, fix.rms,
+                 fix.anchors, fix.iterations);
+          fflush(stdout);
+        }
+      }
+    }
+  }
+}
+
+// ============================================================================
+// Bench
+// ============================================================================
+
+/** @brief Path-loss exponent of the simulated ranges. */
+#define BENCH_N 2.5
+
+/** @brief Tag step per round of anchor reports (m): walking pace at 5 rounds per second. */
+#define BENCH_STEP 0.3
+
+/**
+ * @brief A simulated anchor layout.
+ */
+struct Layout {
+  const char*               name;      /**< Label. */
+  std::vector<TrilatAnchor> anchors;   /**< Positions. */
+  double                    w, h;      /**< Area the tag walks in. */
+};
+
+/**
+ * @brief One simulated fix: true position and the ranges reported.
+ */
+struct BenchFix {
+  double      x, y;                            /**< True position. */
+  TrilatRange ranges[TRILAT_MAX_ANCHORS];      /**< Noisy ranges. */
+};
+
+static std::vector<Layout> layouts() {
+  std::vector<Layout> l;
+  l.push_back({ "room 4", { { 0, 0 }, { 8, 0 }, { 8, 6 }, { 0, 6 } }, 8, 6 });
+  l.push_back({ "hall 6", { { 0, 0 }, { 12, 0 }, { 24, 0 }, { 0, 8 }, { 12, 8 }, { 24, 8 } }, 24, 8 });
+  Layout ring = { "ring 8", {}, 24, 24 };
+  for (int i = 0; i < 8; i++) {
+    double a = i * M_PI / 4;
+    ring.anchors.push_back({ 12 + 12 * cos(a), 12 + 12 * sin(a) });
+  }
+  l.push_back(ring);
+  return l;
+}
+
+/**
+ * @brief Walk a tag through a layout and record the noisy ranges.
+ *
+ * Anchors report in turn, as they do to `serve`: each fix brings one fresh
+ * range and reuses the latest range of every other anchor. Anchor i has an
+ * RSSI noise of RSSI_SIGMA[i % 4] dB; the reported variance follows the
+ * tracker's first-order model.
+ */
+static std::vector<BenchFix> simulate(const Layout& l, size_t fixes, uint32_t seed) {
+  static const double RSSI_SIGMA[] = { 1.5, 2.0, 3.0, 4.0 };
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+  std::vector<BenchFix> out(fixes);
+  size_t n = l.anchors.size();
+  double x = l.w / 2, y = l.h / 2, heading = angle(rng);
+  TrilatRange latest[TRILAT_MAX_ANCHORS];
+  for (size_t k = 0; k < fixes + n; k++) {
+    heading += 0.3 * gauss(rng) / n;
+    x += BENCH_STEP / n * cos(heading);
+    y += BENCH_STEP / n * sin(heading);
+    if (x < 0 || x > l.w) { heading = M_PI - heading; x = std::min(std::max(x, 0.0), l.w); }
+    if (y < 0 || y > l.h) { heading = -heading; y = std::min(std::max(y, 0.0), l.h); }
+    size_t i = k % n;
+    double sigma = RSSI_SIGMA[i % 4];
+    double d = std::max(0.1, hypot(x - l.anchors[i].x, y - l.anchors[i].y));
+    double meas = d * pow(10.0, sigma * gauss(rng) / (10.0 * BENCH_N));
+    double sd = meas * log(10.0) / (10.0 * BENCH_N) * sigma;
+    latest[i] = { (uint8_t)i, meas, sd * sd };
+    if (k < n) continue;  // until every anchor has reported
+    BenchFix& f = out[k - n];
+    f.x = x;
+    f.y = y;
+    memcpy(f.ranges, latest, n * sizeof(TrilatRange));
+  }
+  return out;
+}
+
+/**
+ * @brief Outcome of one solver setting over a walk.
+ */
+struct BenchResult {
+  double solvesPerSec;  /**< Throughput. */
+  double iterations;    /**< Mean Gauss-Newton iterations. */
+  double rmse;          /**< Root mean square position error (m). */
+  double p90;           /**< 90th percentile position error (m). */
+  size_t failed;        /**< Solves that returned false. */
+};
+
+static BenchResult runBench(const Layout& l, const std::vector<BenchFix>& walk, bool weighted, bool warm) {
+  size_t n = l.anchors.size();
+  std::vector<BenchFix> input = walk;
+  if (!weighted) {
+    for (BenchFix& f : input) {
+      for (size_t i = 0; i < n; i++) f.ranges[i].variance = 1.0;
+    }
+  }
+  std::vector<TrilatFix> fixes(input.size());
+  std::vector<bool> ok(input.size());
+  double t = nowSec();
+  const TrilatFix* prev = nullptr;
+  for (size_t k = 0; k < input.size(); k++) {
+    double start[2];
+    if (warm && prev) {
+      start[0] = prev->x;
+      start[1] = prev->y;
+    }
+    ok[k] = trilatSolve(l.anchors.data(), input[k].ranges, n, warm && prev ? start : nullptr, &fixes[k]);
+    prev = ok[k] ? &fixes[k] : nullptr;
+  }
+  t = nowSec() - t;
+
+  BenchResult r = {};
+  std::vector<double> err;
+  double sumSq = 0.0, iters = 0.0;
+  for (size_t k = 0; k < input.size(); k++) {
+    if (!ok[k]) {
+      r.failed++;
+      continue;
+    }
+    double e = hypot(fixes[k].x - walk[k].x, fixes[k].y - walk[k].y);
+    err.push_back(e);
+    sumSq += e * e;
+    iters += fixes[k].iterations;
+  }
+  std::sort(err.begin(), err.end());
+  r.solvesPerSec = input.size() / t;
+  r.iterations = err.empty() ? 0.0 : iters / err.size();
+  r.rmse = err.empty() ? 0.0 : sqrt(sumSq / err.size());
+  r.p90 = err.empty() ? 0.0 : err[(size_t)(0.9 * (err.size() - 1))];
+  return r;
+}
+
+static int bench(size_t fixes) {
+  printf("%zu fixes per layout, RSSI noise 1.5/2/3/4 dB by anchor, n = %.1f\n\n", fixes, BENCH_N);
+  printf("layout   weights     start   solves/s    iters   rmse m    p90 m  failed\n");
+  uint32_t seed = 7;
+  for (const Layout& l : layouts()) {
+    std::vector<BenchFix> walk = simulate(l, fixes, seed++);
+    for (int mode = 0; mode < 3; mode++) {
+      bool weighted = mode > 0, warm = mode == 2;
+      BenchResult r = runBench(l, walk, weighted, warm);
+      printf("%-8s %-10s %-6s %10.0f %8.2f %8.2f %8.2f %7zu\n", l.name, weighted ? "variance" : "equal",
+             warm ? "warm" : "cold", r.solvesPerSec, r.iterations, r.rmse, r.p90, r.failed);
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+// Entry Point
+// ============================================================================
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "serve") == 0) {
+    return serve(argv[2], argc > 3 ? (uint32_t)atoi(argv[3]) : 600);
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    long fixes = argc > 2 ? atol(argv[2]) : 200000;
+    return bench(fixes > 0 ? (size_t)fixes : 200000);
+  }
+  fprintf(stderr,
+          "usage: trilatTool serve <anchors.txt> [alignMs]\n"
+          "       trilatTool bench [fixes]\n");
+  return 1;
+}
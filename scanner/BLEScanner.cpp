@@ -1,52 +1,64 @@
 /**
  * @file BLEScanner.cpp
- * @brief Implementation of BLE client connection, button write, and IMU notification handling.
+ * @brief Bluedroid GATT client glue for the connection manager.
  *
  * This module provides functionality to:
- * - Connect to a BLE peripheral.
+ * - Connect to several BLE peripherals without blocking (connManager.h).
  * - Discover and validate required services and characteristics.
  * - Subscribe to IMU characteristic notifications.
- * - Write button state values to a remote BLE characteristic.
+ * - Write button state values to the connected peripherals.
+ * - Set the tags' clocks to the shared epoch counter.
+ * - Read the RSSI of a link.
  *
- * It uses FreeRTOS for inter-task communication via queues and the ESP32 Arduino BLE stack.
+ * The module registers its own GATT client application and receives the
+ * stack's GATT client and GAP events through BLEDevice's custom handlers.
+ * Each op of the connection manager starts one procedure and returns; the
+ * matching event reports its completion. Links are found by connection id,
+ * or while connecting by address (the controller initiates one connection
+ * at a time, so at most one link is connecting).
  */
 
 // ---- FREERTOS ----
+#include <atomic>
 #include <Arduino.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 // ---- BLE CLIENT ----
-#include <BLEDevice.h>    ///< ESP32 Arduino core 3.x uses NimBLE backend
+#include <BLEDevice.h>
 #include <BLEUtils.h>
-#include <BLEClient.h>
 #include <BLEScan.h>
 
+#if !defined(CONFIG_BLUEDROID_ENABLED)
+#error "BLEScanner needs the Bluedroid host (the Arduino core's default BLE stack)"
+#endif
+
+#include "esp_gattc_api.h"
+#include "esp_gap_ble_api.h"
 #include "BLEScanner.h"
+#include "epochClock.h"
 
 // ============================================================================
-// Module Globals
+// Configuration
 // ============================================================================
 
-/**
- * @brief Indicates whether the client is connected to a BLE peripheral.
- */
-volatile bool connected = false;
+/** @brief GATT client application id of the tag links. */
+#define LINK_APP_ID 0x5a
 
-/**
- * @brief Pointer to the active BLE client instance.
- */
-BLEClient* client = nullptr;
+/** @brief MTU requested on every link; the peer may accept or ignore it. */
+#define LINK_MTU 185
 
-/**
- * @brief Remote characteristic pointer for the button characteristic.
- */
-BLERemoteCharacteristic* btnRemoteChar = nullptr;
+/** @brief Marks a link without a connection. */
+#define CONN_ID_NONE 0xFFFF
+
+// ============================================================================
+// Module Globals
+// ============================================================================
 
 /**
- * @brief Remote characteristic pointer for the IMU characteristic.
+ * @brief Indicates whether at least one tag link is ready.
  */
-BLERemoteCharacteristic* imuRemoteChar = nullptr;
+std::atomic<bool> connected{ false };
 
 /**
  * @brief UUID for the BLE service (must be set by the application).
@@ -64,153 +76,374 @@ BLEUUID btnUUID;
 BLEUUID imuUUID;
 
 /**
- * @brief FreeRTOS queue for IMU notifications.
- *
- * The queue length must be 1 because `xQueueOverwrite` is used to always keep
- * the most recent IMU flag (0 or 1).
+ * @brief UUID for the clock characteristic (must be set by the application).
  */
-static QueueHandle_t gIMUQ = nullptr;
+BLEUUID clockUUID;
 
 /**
- * @brief Set the IMU notification queue.
+ * @brief Stack side of a link.
  *
- * @param[in] q Queue handle that will receive IMU notification flags (0 or 1).
+ * Written by the op that starts a procedure before it starts, and by the
+ * stack callback that completes it. The callbacks look links up by
+ * `connId`, `tag` and `ready` while the scanner task changes them, so those
+ * are atomic.
  */
-void setIMUQueue(QueueHandle_t q) { gIMUQ = q; }
+struct DevLink {
+  esp_bd_addr_t bda;         /**< Peer address (as reported on connect). */
+  std::atomic<uint16_t> connId;  /**< Connection id, CONN_ID_NONE if not connected. */
+  uint16_t svcStart;         /**< Service handle range start. */
+  uint16_t svcEnd;           /**< Service handle range end, 0 if not found. */
+  uint16_t btnHandle;        /**< Button characteristic value handle. */
+  uint16_t imuHandle;        /**< IMU characteristic value handle. */
+  uint16_t cccdHandle;       /**< IMU client configuration descriptor handle. */
+  uint16_t clockHandle;      /**< Clock characteristic value handle, 0 if absent. */
+  bool     btnNoRsp;         /**< Button accepts write without response. */
+  std::atomic<int16_t> tag;      /**< Tag of the link, -1 if idle. */
+  std::atomic<bool> ready;       /**< Link is ready. */
+};
+
+static DevLink gDev[CONN_MAX_LINKS];                      /**< Stack state per link. */
+static std::atomic<esp_gatt_if_t> gGattcIf{ ESP_GATT_IF_NONE }; /**< Our GATT client interface (set by the BLE stack). */
+static ImuHandler gImuHandler = nullptr;                  /**< IMU notification handler. */
+static RssiHandler gRssiHandler = nullptr;                /**< RSSI result handler. */
+static LinkHandler gLinkHandler = nullptr;                /**< Link progress handler. */
+
+void setIMUHandler(ImuHandler fn) { gImuHandler = fn; }
+void setRssiHandler(RssiHandler fn) { gRssiHandler = fn; }
+void setLinkHandler(LinkHandler fn) { gLinkHandler = fn; }
 
 // ============================================================================
-// Notification Callback
+// Link Lookup
 // ============================================================================
 
 /**
- * @brief Callback for IMU characteristic notifications.
- *
- * This function processes incoming notification data, looks for a '0' or '1'
- * character in the payload, and writes the corresponding value into the IMU queue.
- *
- * @param[in] rc       Pointer to the remote characteristic (unused).
- * @param[in] pData    Pointer to the notification payload data.
- * @param[in] length   Length of the notification payload.
- * @param[in] isNotify Indicates if this is a notification (unused).
+ * @brief Link of a connection id, or -1.
  */
-static void onImuNotify(BLERemoteCharacteristic* /*rc*/, uint8_t* pData, size_t length, bool /*isNotify*/) {
-  if (!gIMUQ || length == 0) return;
-
-  Serial.write(pData, length);
-  Serial.println();
+static int linkByConn(uint16_t connId) {
+  for (int i = 0; i < CONN_MAX_LINKS; i++) {
+    if (gDev[i].connId == connId) return i;
+  }
+  return -1;
+}
 
-  // Find the first '0' or '1' in the payload
-  uint8_t imuFlag = 0;
-  bool found = false;
-  for (size_t i = 0; i < length; ++i) {
-    if (pData[i] == '0') { imuFlag = 0; found = true; break; }
-    if (pData[i] == '1') { imuFlag = 1; found = true; break; }
+/**
+ * @brief Link of a peer address, or -1.
+ */
+static int linkByAddr(const uint8_t* bda) {
+  for (int i = 0; i < CONN_MAX_LINKS; i++) {
+    if (gDev[i].tag >= 0 && memcmp(gDev[i].bda, bda, sizeof(esp_bd_addr_t)) == 0) return i;
   }
-  if (!found) return;  // ignore unexpected chars
+  return -1;
+}
 
-  // Always overwrite: queue length must be 1
-  xQueueOverwrite(gIMUQ, &imuFlag);
+/**
+ * @brief The link currently connecting, or -1.
+ */
+static int linkConnecting() {
+  for (uint8_t i = 0; i < CONN_MAX_LINKS; i++) {
+    Link l;
+    if (connManagerGet(i, &l) && l.state == LINK_CONNECTING) return i;
+  }
+  return -1;
 }
 
 // ============================================================================
-// Button Write
+// Connection Manager Ops
 // ============================================================================
 
+/** @brief Start a direct connection. */
+static bool opOpen(uint8_t link, const LinkAddr* addr, void*) {
+  DevLink& d = gDev[link];
+  memcpy(d.bda, addr->bda, sizeof(esp_bd_addr_t));
+  d.connId = CONN_ID_NONE;
+  return esp_ble_gattc_open(gGattcIf, d.bda, (esp_ble_addr_type_t)addr->type, true) == ESP_OK;
+}
+
+/** @brief Start the service search. */
+static bool opDiscover(uint8_t link, void*) {
+  DevLink& d = gDev[link];
+  d.svcStart = d.svcEnd = 0;
+  d.btnHandle = d.imuHandle = d.cccdHandle = d.clockHandle = 0;
+  return esp_ble_gattc_search_service(gGattcIf, d.connId, svcUUID.getNative()) == ESP_OK;
+}
+
+/** @brief Register for IMU notifications and enable them on the peer. */
+static bool opSubscribe(uint8_t link, void*) {
+  DevLink& d = gDev[link];
+  if (esp_ble_gattc_register_for_notify(gGattcIf, d.bda, d.imuHandle) != ESP_OK) return false;
+  uint8_t enable[2] = { 0x01, 0x00 };
+  return esp_ble_gattc_write_char_descr(gGattcIf, d.connId, d.cccdHandle, sizeof(enable), enable,
+                                        ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
 /**
- * @brief Write the button state to the remote BLE characteristic.
+ * @brief Close a connection, or cancel a pending one.
  *
- * Attempts to send the button state (pressed or released) as a single byte (0 or 1)
- * to the remote characteristic. Prefers "write without response" if available,
- * otherwise falls back to "write with response".
- *
- * @param[in] pressed True if button is pressed, false if released.
- * @return True if the value was successfully written, false otherwise.
+ * A pending connection is cancelled by the address it was opened with: the
+ * manager's address may since have moved on to the tag's next RPA.
  */
-bool writeBtnState(bool pressed) {
-  if (!connected || !client || !btnRemoteChar) return false;
-
-  const uint8_t value = pressed ? 1 : 0;
-
-  // Prefer fast, fire-and-forget if allowed; fallback to with-response.
-  if (btnRemoteChar->canWriteNoResponse()) {
-    btnRemoteChar->writeValue((uint8_t*)&value, 1, /*noResp=*/true);
-    return true;
-  }
-  if (btnRemoteChar->canWrite()) {
-    btnRemoteChar->writeValue((uint8_t*)&value, 1, /*noResp=*/false);
-    return true;
+static void opClose(uint8_t link, const LinkAddr*, void*) {
+  DevLink& d = gDev[link];
+  uint16_t connId = d.connId;
+  d.connId = CONN_ID_NONE;  // the manager has already accounted for the close
+  if (connId != CONN_ID_NONE) {
+    esp_ble_gattc_close(gGattcIf, connId);
+  } else {
+    esp_ble_gap_disconnect(d.bda);
   }
-  return false; // not writeable
 }
 
+/** @brief Track tags and readiness, then pass progress on. */
+static void opProgress(uint8_t link, const Link* state, void*) {
+  gDev[link].tag = state->state == LINK_IDLE ? -1 : state->tag;
+  gDev[link].ready = state->state == LINK_READY;
+  connected.store(connManagerReadyCount() > 0, std::memory_order_relaxed);
+  if (gLinkHandler) gLinkHandler(link, state);
+}
+
+/** @brief Connection manager ops backed by the GATT client. */
+static const LinkOps LINK_OPS = { opOpen, opDiscover, opSubscribe, opClose, opProgress };
+
 // ============================================================================
-// Connect, Discover, Validate, Subscribe
+// Discovery
 // ============================================================================
 
 /**
- * @brief Connect to a BLE peripheral and subscribe to IMU notifications.
- *
- * This function performs the following steps:
- * - Creates a BLE client and attempts to connect to the specified peripheral.
- * - Requests a larger MTU (may or may not be honored by peer).
- * - Discovers the configured service, button, and IMU characteristics.
- * - Validates that the button characteristic supports write/write-no-response.
- * - Validates that the IMU characteristic supports notify.
- * - Subscribes to IMU notifications.
+ * @brief Look up and validate the characteristics in the found service.
  *
- * @param[in] addr BLE address of the peripheral to connect to.
- * @return True if connection and subscription succeed, false otherwise.
+ * The button characteristic must be writeable (with or without response);
+ * the IMU characteristic must support notify and have a client
+ * configuration descriptor. The clock characteristic is optional.
  */
-bool connectToPeripheral(BLEAddress addr) {
-  client = BLEDevice::createClient();
-  BLEDevice::setMTU(185); // request larger MTU; peer may accept/ignore
-
-  Serial.print("Connecting to: ");
-  Serial.println(addr.toString().c_str());
-
-  if (!client->connect(addr)) {
-    Serial.println("Connection failed.");
-    return false;
-  }
-
-  BLERemoteService* service = client->getService(svcUUID);
-  if (!service) {
-    Serial.println("Service not found.");
-    client->disconnect();
-    return false;
-  }
-
-  // ---- Button char: must be WRITE or WRITE_NO_RESPONSE ----
-  btnRemoteChar = service->getCharacteristic(btnUUID);
-  if (!btnRemoteChar) {
+static bool resolveCharacteristics(DevLink& d) {
+  esp_gattc_char_elem_t ch;
+  uint16_t count = 1;
+  if (esp_ble_gattc_get_char_by_uuid(gGattcIf, d.connId, d.svcStart, d.svcEnd, *btnUUID.getNative(),
+                                     &ch, &count) != ESP_GATT_OK || count == 0) {
     Serial.println("Button characteristic not found.");
-    client->disconnect();
     return false;
   }
-  if (!(btnRemoteChar->canWrite() || btnRemoteChar->canWriteNoResponse())) {
+  if (!(ch.properties & (ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR))) {
     Serial.println("Button characteristic is not writeable.");
-    client->disconnect();
     return false;
   }
+  d.btnHandle = ch.char_handle;
+  d.btnNoRsp = ch.properties & ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
 
-  // ---- IMU char: must support NOTIFY ----
-  imuRemoteChar = service->getCharacteristic(imuUUID);
-  if (!imuRemoteChar) {
+  count = 1;
+  if (esp_ble_gattc_get_char_by_uuid(gGattcIf, d.connId, d.svcStart, d.svcEnd, *imuUUID.getNative(),
+                                     &ch, &count) != ESP_GATT_OK || count == 0) {
     Serial.println("IMU characteristic not found.");
-    client->disconnect();
     return false;
   }
-  if (!imuRemoteChar->canNotify()) {
+  if (!(ch.properties & ESP_GATT_CHAR_PROP_BIT_NOTIFY)) {
     Serial.println("IMU characteristic does not support notify.");
-    client->disconnect();
     return false;
   }
+  d.imuHandle = ch.char_handle;
 
-  // Subscribe to IMU notifications
-  imuRemoteChar->registerForNotify(onImuNotify);
+  esp_gattc_descr_elem_t descr;
+  esp_bt_uuid_t cccd = {};
+  cccd.len = ESP_UUID_LEN_16;
+  cccd.uuid.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+  count = 1;
+  if (esp_ble_gattc_get_descr_by_char_handle(gGattcIf, d.connId, d.imuHandle, cccd, &descr, &count) != ESP_GATT_OK ||
+      count == 0) {
+    Serial.println("IMU characteristic has no client configuration.");
+    return false;
+  }
+  d.cccdHandle = descr.handle;
 
-  connected = true;
-  Serial.printf("Connected. Button write mode: %s. Subscribed to IMU.\n",
-                btnRemoteChar->canWriteNoResponse() ? "WriteWithoutResponse" : "WriteWithResponse");
+  count = 1;
+  if (esp_ble_gattc_get_char_by_uuid(gGattcIf, d.connId, d.svcStart, d.svcEnd, *clockUUID.getNative(),
+                                     &ch, &count) == ESP_GATT_OK && count > 0 &&
+      (ch.properties & ESP_GATT_CHAR_PROP_BIT_WRITE)) {
+    d.clockHandle = ch.char_handle;
+  }
   return true;
 }
+
+// ============================================================================
+// Stack Callbacks
+// ============================================================================
+
+/**
+ * @brief IMU notification: find the first '0' or '1' in the payload.
+ */
+static void onImuNotify(DevLink& d, const uint8_t* pData, size_t length) {
+  if (!gImuHandler || length == 0) return;
+
+  Serial.write(pData, length);
+  Serial.println();
+
+  uint8_t imuFlag = 0;
+  bool found = false;
+  for (size_t i = 0; i < length; ++i) {
+    if (pData[i] == '0') { imuFlag = 0; found = true; break; }
+    if (pData[i] == '1') { imuFlag = 1; found = true; break; }
+  }
+  if (!found) return;  // ignore unexpected chars
+
+  gImuHandler(d.tag, imuFlag);
+}
+
+/**
+ * @brief GATT client events of our application.
+ */
+static void onGattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t* p) {
+  if (event == ESP_GATTC_REG_EVT) {
+    if (p->reg.app_id == LINK_APP_ID && p->reg.status == ESP_GATT_OK) gGattcIf.store(gattcIf, std::memory_order_release);
+    return;
+  }
+  if (gattcIf != gGattcIf) return;
+  uint32_t now = millis();
+
+  switch (event) {
+    case ESP_GATTC_OPEN_EVT: {
+      int link = linkByAddr(p->open.remote_bda);
+      if (link < 0 || gDev[link].connId != CONN_ID_NONE) link = linkConnecting();
+      if (link < 0) {
+        // Late success after the attempt was abandoned
+        if (p->open.status == ESP_GATT_OK) esp_ble_gattc_close(gGattcIf, p->open.conn_id);
+        break;
+      }
+      bool ok = p->open.status == ESP_GATT_OK;
+      if (ok) {
+        DevLink& d = gDev[link];
+        memcpy(d.bda, p->open.remote_bda, sizeof(esp_bd_addr_t));
+        d.connId = p->open.conn_id;
+        esp_ble_set_encryption(d.bda, ESP_BLE_SEC_ENCRYPT);  // bond, so the tag's IRK is stored
+        esp_ble_gattc_send_mtu_req(gGattcIf, d.connId);
+      }
+      connManagerOnStep((uint8_t)link, LINK_STEP_OPENED, ok, now);
+      break;
+    }
+    case ESP_GATTC_SEARCH_RES_EVT: {
+      int link = linkByConn(p->search_res.conn_id);
+      if (link < 0) break;
+      gDev[link].svcStart = p->search_res.start_handle;
+      gDev[link].svcEnd = p->search_res.end_handle;
+      break;
+    }
+    case ESP_GATTC_SEARCH_CMPL_EVT: {
+      int link = linkByConn(p->search_cmpl.conn_id);
+      if (link < 0) break;
+      DevLink& d = gDev[link];
+      bool ok = p->search_cmpl.status == ESP_GATT_OK && d.svcEnd != 0;
+      if (!ok) Serial.println("Service not found.");
+      ok = ok && resolveCharacteristics(d);
+      connManagerOnStep((uint8_t)link, LINK_STEP_DISCOVERED, ok, now);
+      break;
+    }
+    case ESP_GATTC_WRITE_DESCR_EVT: {
+      int link = linkByConn(p->write.conn_id);
+      if (link < 0 || p->write.handle != gDev[link].cccdHandle) break;
+      connManagerOnStep((uint8_t)link, LINK_STEP_SUBSCRIBED, p->write.status == ESP_GATT_OK, now);
+      break;
+    }
+    case ESP_GATTC_NOTIFY_EVT: {
+      int link = linkByConn(p->notify.conn_id);
+      if (link < 0 || p->notify.handle != gDev[link].imuHandle) break;
+      onImuNotify(gDev[link], p->notify.value, p->notify.value_len);
+      break;
+    }
+    case ESP_GATTC_DISCONNECT_EVT: {
+      int link = linkByConn(p->disconnect.conn_id);
+      if (link < 0) break;
+      gDev[link].connId = CONN_ID_NONE;
+      connManagerOnStep((uint8_t)link, LINK_STEP_CLOSED, true, now);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief GAP events: RSSI read results.
+ */
+static void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* p) {
+  if (event != ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT) return;
+  if (p->read_rssi_cmpl.status != ESP_BT_STATUS_SUCCESS) return;
+  int link = linkByAddr(p->read_rssi_cmpl.remote_addr);
+  if (link < 0 || !gRssiHandler) return;
+  gRssiHandler(gDev[link].tag, p->read_rssi_cmpl.rssi);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool bleLinksBegin(uint8_t maxLinks) {
+  for (DevLink& d : gDev) {
+    d.connId = CONN_ID_NONE;
+    d.tag = -1;
+    d.ready = false;
+  }
+  connManagerInit(&LINK_OPS, nullptr, maxLinks, maxLinks);
+  BLEDevice::setCustomGattcHandler(onGattcEvent);
+  BLEDevice::setCustomGapHandler(onGapEvent);
+  esp_ble_gatt_set_local_mtu(LINK_MTU);
+  if (esp_ble_gattc_app_register(LINK_APP_ID) != ESP_OK) return false;
+  for (int i = 0; i < 100 && gGattcIf.load(std::memory_order_acquire) == ESP_GATT_IF_NONE; i++) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (gGattcIf.load(std::memory_order_acquire) == ESP_GATT_IF_NONE) {
+    Serial.println("GATT client registration failed.");
+    return false;
+  }
+  return true;
+}
+
+bool bleLinkRequest(int16_t tag, BLEAddress addr, esp_ble_addr_type_t type) {
+  LinkAddr la;
+  memcpy(la.bda, addr.getNative(), sizeof(la.bda));
+  la.type = (uint8_t)type;
+  return connManagerRequest(tag, &la, millis());
+}
+
+void bleLinksTick(void) {
+  connManagerTick(millis());
+}
+
+bool bleLinkReadRssi(int16_t tag) {
+  int link = connManagerFind(tag);
+  if (link < 0 || !gDev[link].ready) return false;
+  return esp_ble_gap_read_rssi(gDev[link].bda) == ESP_OK;
+}
+
+bool bleLinkWriteClock(int16_t tag, uint32_t seconds) {
+  int link = connManagerFind(tag);
+  if (link < 0 || !gDev[link].ready || gDev[link].clockHandle == 0) return false;
+  uint8_t value[EPOCH_CLOCK_LEN];
+  epochClockEncode(seconds, value);
+  return esp_ble_gattc_write_char(gGattcIf, gDev[link].connId, gDev[link].clockHandle, sizeof(value), value,
+                                  ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
+// ============================================================================
+// Button Write
+// ============================================================================
+
+/**
+ * @brief Write the button state to every ready link.
+ *
+ * Sends the button state (pressed or released) as a single byte (0 or 1).
+ * Uses "write without response" where the tag allows it, otherwise
+ * "write with response".
+ *
+ * @param[in] pressed True if button is pressed, false if released.
+ * @return True if the value was sent to at least one tag.
+ */
+bool writeBtnState(bool pressed) {
+  uint8_t value = pressed ? 1 : 0;
+  bool sent = false;
+  for (DevLink& d : gDev) {
+    if (!d.ready || d.connId == CONN_ID_NONE) continue;
+    esp_gatt_write_type_t type = d.btnNoRsp ? ESP_GATT_WRITE_TYPE_NO_RSP : ESP_GATT_WRITE_TYPE_RSP;
+    if (esp_ble_gattc_write_char(gGattcIf, d.connId, d.btnHandle, 1, &value, type, ESP_GATT_AUTH_REQ_NONE) == ESP_OK) {
+      sent = true;
+    }
+  }
+  return sent;
+}
@@ -1,42 +1,29 @@
 /**
  * @file BLEScanner.h
- * @brief BLE client interface for connecting to a peripheral, handling button writes,
- *        and subscribing to IMU notifications.
+ * @brief BLE client links to several tags: asynchronous connect and discovery,
+ *        button and clock writes, IMU notifications and RSSI reads.
  *
- * This module provides the necessary global variables and function declarations
- * to manage BLE client connections, discover services and characteristics, and
- * handle communication with a remote BLE peripheral.
+ * Links are driven by the connection manager (connManager.h) through the
+ * Bluedroid GATT client API: every procedure is started without blocking
+ * and completes in the stack's callbacks, so the scanner task keeps
+ * scanning and sampling RSSI while tags connect.
  */
 
 #pragma once
+#include <atomic>
 #include <Arduino.h>
 #include <BLEDevice.h>
-#include "freertos/FreeRTOS.h"   
-#include "freertos/queue.h"     
+#include "freertos/FreeRTOS.h"
+#include "connManager.h"
 
 // ============================================================================
 // Global Variables
 // ============================================================================
 
 /**
- * @brief Indicates whether the BLE client is currently connected to a peripheral.
+ * @brief Indicates whether at least one tag link is ready.
  */
-extern volatile bool connected;
-
-/**
- * @brief Pointer to the active BLE client instance.
- */
-extern BLEClient* client;
-
-/**
- * @brief Remote characteristic pointer for the button service.
- */
-extern BLERemoteCharacteristic* btnRemoteChar;
-
-/**
- * @brief Remote characteristic pointer for the IMU service.
- */
-extern BLERemoteCharacteristic* imuRemoteChar;
+extern std::atomic<bool> connected;
 
 /**
  * @brief UUID for the target BLE service.
@@ -59,37 +46,99 @@ extern BLEUUID btnUUID;
  */
 extern BLEUUID imuUUID;
 
+/**
+ * @brief UUID for the clock characteristic (epochClock.h).
+ *
+ * Must be set from the main application. Tags without it are linked as
+ * before, but their clock cannot be set.
+ */
+extern BLEUUID clockUUID;
+
+/**
+ * @brief Receives the movement flag (0 or 1) of each IMU notification.
+ *
+ * Runs in the BLE stack's callback context; keep it short.
+ */
+typedef void (*ImuHandler)(int16_t tag, uint8_t moving);
+
+/**
+ * @brief Receives the result of an RSSI read (BLE stack context).
+ */
+typedef void (*RssiHandler)(int16_t tag, int rssi);
+
+/**
+ * @brief Receives every link state change (BLE stack or scanner task context).
+ */
+typedef void (*LinkHandler)(uint8_t link, const Link* state);
+
 // ============================================================================
 // Functions
 // ============================================================================
 
 /**
- * @brief Provide a FreeRTOS queue for IMU notifications.
+ * @brief Set the handler for IMU notifications.
  *
- * This queue is used to receive IMU status updates (e.g., motion detected as 0/1).
+ * @param[in] fn Handler called with each movement flag.
+ */
+void setIMUHandler(ImuHandler fn);
+
+/**
+ * @brief Set the handler for RSSI read results.
+ */
+void setRssiHandler(RssiHandler fn);
+
+/**
+ * @brief Set the handler for link progress.
+ */
+void setLinkHandler(LinkHandler fn);
+
+/**
+ * @brief Register the GATT client and start the connection manager.
+ *
+ * Call once after `BLEDevice::init()`.
  *
- * @param[in] q Queue handle to store IMU notification values.
+ * @param[in] maxLinks Tags connected at most (clamped to CONN_MAX_LINKS).
+ * @return False if the GATT client application cannot be registered.
  */
-void setIMUQueue(QueueHandle_t q);
+bool bleLinksBegin(uint8_t maxLinks);
 
 /**
- * @brief Write a button state (pressed or released) to the remote button characteristic.
+ * @brief Ask for a link to a sighted tag (non-blocking).
  *
- * Sends a single byte (0 or 1) to the peripheral.
+ * @param[in] tag  Tag identifier (history slot).
+ * @param[in] addr Address the tag advertised from.
+ * @param[in] type Address type from the advertisement.
+ * @return False if all links are taken.
+ */
+bool bleLinkRequest(int16_t tag, BLEAddress addr, esp_ble_addr_type_t type);
+
+/**
+ * @brief Run link timeouts and retries; call periodically from the scanner task.
+ */
+void bleLinksTick(void);
+
+/**
+ * @brief Start an RSSI read on a tag's link; the result goes to the RSSI handler.
  *
- * @param[in] pressed Boolean indicating button state (true = pressed, false = released).
- * @return True if the write was successful, false otherwise.
+ * @return False if the tag has no ready link or the read cannot be started.
  */
-bool writeBtnState(bool pressed);
+bool bleLinkReadRssi(int16_t tag);
 
 /**
- * @brief Connect to a BLE peripheral, discover services/characteristics,
- *        and subscribe to IMU notifications.
+ * @brief Write the shared epoch counter to a tag's clock characteristic.
  *
- * Handles the connection process including validation of the required
- * service UUIDs and subscription setup.
+ * @param[in] tag     Tag identifier.
+ * @param[in] seconds Seconds since the shared epoch.
+ * @return False if the tag has no ready link or no clock characteristic.
+ */
+bool bleLinkWriteClock(int16_t tag, uint32_t seconds);
+
+/**
+ * @brief Write a button state (pressed or released) to every connected tag.
+ *
+ * Sends a single byte (0 or 1) to each peripheral's button characteristic.
  *
- * @param[in] addr BLE address of the peripheral to connect to.
- * @return True if connection and subscription succeed, false otherwise.
+ * @param[in] pressed Boolean indicating button state (true = pressed, false = released).
+ * @return True if the value was sent to at least one tag.
  */
-bool connectToPeripheral(BLEAddress addr); 
+bool writeBtnState(bool pressed);
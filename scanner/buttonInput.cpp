@@ -0,0 +1,163 @@
+/**
+ * @file buttonInput.cpp
+ * @brief Debounce state machine and the GPIO/timer interrupt glue.
+ */
+
+#include "buttonInput.h"
+#include "eventLoop.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define BUTTON_ISR_ATTR ARDUINO_ISR_ATTR
+#else
+#define BUTTON_ISR_ATTR
+#endif
+
+// ============================================================================
+// State Machine
+// ============================================================================
+
+void buttonFsmInit(ButtonFsm* fsm) {
+  *fsm = ButtonFsm{};
+}
+
+void BUTTON_ISR_ATTR buttonFsmEdge(ButtonFsm* fsm, uint32_t timeUs) {
+  // A quiet gap that the timer has not yet seen still ends the previous burst
+  if (!fsm->bouncing || timeUs - fsm->lastEdgeUs >= BUTTON_DEBOUNCE_US) fsm->firstEdgeUs = timeUs;
+  fsm->lastEdgeUs = timeUs;
+  fsm->bouncing = true;
+}
+
+bool BUTTON_ISR_ATTR buttonFsmTick(ButtonFsm* fsm, bool level, uint32_t nowUs, uint8_t button,
+                                   ButtonEmitFn emit, void* ctx) {
+  // A level change without a recorded edge (e.g. an edge lost while the
+  // interrupt was masked) is debounced like any other
+  if (!fsm->bouncing && level != fsm->pressed) buttonFsmEdge(fsm, nowUs);
+
+  if (fsm->bouncing && nowUs - fsm->lastEdgeUs >= BUTTON_DEBOUNCE_US) {
+    fsm->bouncing = false;
+    if (level && !fsm->pressed) {
+      fsm->pressed = true;
+      fsm->longSent = false;
+      fsm->pressUs = fsm->firstEdgeUs;
+      emit(button, BUTTON_PRESS, fsm->pressUs, ctx);
+      if (fsm->canDouble && fsm->pressUs - fsm->releaseUs <= BUTTON_DOUBLE_US) {
+        emit(button, BUTTON_DOUBLE_PRESS, fsm->pressUs, ctx);
+        fsm->canDouble = false;  // a third press starts a new pair
+      } else {
+        fsm->canDouble = true;
+      }
+    } else if (!level && fsm->pressed) {
+      fsm->pressed = false;
+      fsm->releaseUs = fsm->firstEdgeUs;
+      if (fsm->longSent) fsm->canDouble = false;
+    }
+  }
+
+  if (fsm->pressed && !fsm->longSent && nowUs - fsm->pressUs >= BUTTON_LONG_US) {
+    fsm->longSent = true;
+    emit(button, BUTTON_LONG_PRESS, fsm->pressUs + BUTTON_LONG_US, ctx);
+  }
+
+  return fsm->bouncing || (fsm->pressed && !fsm->longSent);
+}
+
+const char* buttonEventName(uint8_t event) {
+  switch (event) {
+    case BUTTON_PRESS:        return "press";
+    case BUTTON_LONG_PRESS:   return "long-press";
+    case BUTTON_DOUBLE_PRESS: return "double-press";
+    default:                  return "?";
+  }
+}
+
+#ifdef ARDUINO
+
+// ============================================================================
+// Interrupt Glue
+// ============================================================================
+
+/** @brief GPIO per button. */
+static uint8_t gPins[BUTTON_MAX];
+
+/** @brief State machine per button. */
+static ButtonFsm gFsm[BUTTON_MAX];
+
+/** @brief Number of watched buttons. */
+static size_t gCount = 0;
+
+/** @brief Debounce timer (1 MHz, BUTTON_TICK_US alarm). */
+static hw_timer_t* gTimer = nullptr;
+
+/** @brief True while the debounce timer runs. */
+static volatile bool gTimerRunning = false;
+
+/** @brief Serialises the GPIO and timer interrupts. */
+static portMUX_TYPE gMux = portMUX_INITIALIZER_UNLOCKED;
+
+/** @brief Set by `postGesture` when a posted event woke a higher priority task. */
+static int gWoken = 0;
+
+/**
+ * @brief Post a gesture to the event loop (from the timer interrupt).
+ */
+static void BUTTON_ISR_ATTR postGesture(uint8_t button, uint8_t event, uint32_t timeUs, void*) {
+  LoopEvent e = { BUTTON_LOOP_EVENT, button, 0, event, timeUs };
+  int woken = 0;
+  eventLoopPostFromISR(&e, &woken);
+  gWoken |= woken;
+}
+
+/**
+ * @brief Debounce timer interrupt: advance every button, stop when all settle.
+ */
+static void BUTTON_ISR_ATTR onDebounceTick() {
+  uint32_t now = (uint32_t)micros();
+  bool busy = false;
+  gWoken = 0;
+  portENTER_CRITICAL_ISR(&gMux);
+  for (size_t i = 0; i < gCount; i++) {
+    busy |= buttonFsmTick(&gFsm[i], digitalRead(gPins[i]) == LOW, now, (uint8_t)i, postGesture, nullptr);
+  }
+  if (!busy) {
+    timerStop(gTimer);
+    gTimerRunning = false;
+  }
+  portEXIT_CRITICAL_ISR(&gMux);
+  if (gWoken) portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief GPIO edge interrupt: record the edge and make sure the timer runs.
+ */
+static void BUTTON_ISR_ATTR onEdge(void* arg) {
+  uint32_t now = (uint32_t)micros();
+  portENTER_CRITICAL_ISR(&gMux);
+  buttonFsmEdge(&gFsm[(size_t)arg], now);
+  if (!gTimerRunning) {
+    gTimerRunning = true;
+    timerRestart(gTimer);
+    timerStart(gTimer);
+  }
+  portEXIT_CRITICAL_ISR(&gMux);
+}
+
+bool buttonInputBegin(const uint8_t* pins, size_t count) {
+  if (count > BUTTON_MAX) return false;
+  gTimer = timerBegin(1000000);
+  if (!gTimer) return false;
+  timerStop(gTimer);
+  timerAttachInterrupt(gTimer, onDebounceTick);
+  timerAlarm(gTimer, BUTTON_TICK_US, true, 0);
+
+  gCount = count;
+  for (size_t i = 0; i < count; i++) {
+    gPins[i] = pins[i];
+    buttonFsmInit(&gFsm[i]);
+    pinMode(pins[i], INPUT_PULLUP);
+    attachInterruptArg(pins[i], onEdge, (void*)i, CHANGE);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file buttonInput.h
+ * @brief Interrupt-driven push buttons with timer debouncing and gestures.
+ *
+ * Every edge on a button pin raises a GPIO interrupt that only records its
+ * time and starts a 1 ms hardware timer. The timer interrupt runs one
+ * debounce state machine per button: a new level is accepted once the pin
+ * has been quiet for BUTTON_DEBOUNCE_US, and the resulting press is stamped
+ * with the time of the first edge of the bounce burst. The timer stops again
+ * when every button is settled, so an idle button costs nothing.
+ *
+ * Gestures are posted to the event loop as BUTTON_LOOP_EVENT events
+ * (`arg` = button index, `value` = ButtonEvent, `timeUs` = gesture time):
+ * - BUTTON_PRESS        on every debounced press
+ * - BUTTON_LONG_PRESS   once a press has been held for BUTTON_LONG_US
+ * - BUTTON_DOUBLE_PRESS on a press starting within BUTTON_DOUBLE_US of the
+ *                       previous short press's release (after its PRESS)
+ *
+ * The state machine itself is plain code and runs on the host against
+ * recorded edge sequences.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Quiet time after the last edge before a level is accepted (µs). */
+#ifndef BUTTON_DEBOUNCE_US
+#define BUTTON_DEBOUNCE_US 10000
+#endif
+
+/** @brief Hold time that makes a press a long press (µs). */
+#ifndef BUTTON_LONG_US
+#define BUTTON_LONG_US 800000
+#endif
+
+/** @brief Largest release-to-press gap of a double press (µs). */
+#ifndef BUTTON_DOUBLE_US
+#define BUTTON_DOUBLE_US 350000
+#endif
+
+/** @brief Debounce timer period (µs). */
+#define BUTTON_TICK_US 1000
+
+/** @brief Number of buttons the input subsystem can watch. */
+#define BUTTON_MAX 4
+
+/** @brief Loop event type carrying button gestures. */
+#define BUTTON_LOOP_EVENT 0
+
+/**
+ * @brief Button gestures.
+ */
+enum ButtonEvent : uint8_t {
+  BUTTON_PRESS = 0,
+  BUTTON_LONG_PRESS,
+  BUTTON_DOUBLE_PRESS,
+};
+
+/**
+ * @brief Debounce and gesture state of one button.
+ */
+struct ButtonFsm {
+  uint32_t firstEdgeUs;  /**< First edge of the current bounce burst. */
+  uint32_t lastEdgeUs;   /**< Most recent edge. */
+  uint32_t pressUs;      /**< Start of the current or last press. */
+  uint32_t releaseUs;    /**< End of the last press. */
+  bool     pressed;      /**< Debounced level. */
+  bool     bouncing;     /**< Edges seen since the level was last accepted. */
+  bool     longSent;     /**< Current press already reported as long. */
+  bool     canDouble;    /**< Last press was short and can start a double press. */
+};
+
+/**
+ * @brief Gesture callback.
+ *
+ * @param[in] button Button index.
+ * @param[in] event  ButtonEvent.
+ * @param[in] timeUs Time of the gesture.
+ * @param[in] ctx    Callback context.
+ */
+typedef void (*ButtonEmitFn)(uint8_t button, uint8_t event, uint32_t timeUs, void* ctx);
+
+/**
+ * @brief Reset a button to released and settled.
+ */
+void buttonFsmInit(ButtonFsm* fsm);
+
+/**
+ * @brief Record an edge (called from the GPIO interrupt).
+ */
+void buttonFsmEdge(ButtonFsm* fsm, uint32_t timeUs);
+
+/**
+ * @brief Advance the state machine (called from the debounce timer).
+ *
+ * @param[in,out] fsm     Button state.
+ * @param[in]     level   Current pin level, true when pressed.
+ * @param[in]     nowUs   Current time.
+ * @param[in]     button  Button index passed to `emit`.
+ * @param[in]     emit    Gesture callback.
+ * @param[in]     ctx     Callback context.
+ * @return True while the button still needs timer ticks.
+ */
+bool buttonFsmTick(ButtonFsm* fsm, bool level, uint32_t nowUs, uint8_t button,
+                   ButtonEmitFn emit, void* ctx);
+
+/**
+ * @brief Human-readable gesture name.
+ */
+const char* buttonEventName(uint8_t event);
+
+/**
+ * @brief Watch active-low buttons (with internal pull-ups) and post their
+ *        gestures to the event loop (device only).
+ *
+ * @param[in] pins  GPIO per button index.
+ * @param[in] count Number of buttons (at most BUTTON_MAX).
+ * @return False if the timer could not be started or `count` is too large.
+ */
+bool buttonInputBegin(const uint8_t* pins, size_t count);
@@ -0,0 +1,249 @@
+/**
+ * @file config.cpp
+ * @brief Configuration store updates, parsing and persistence.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "config.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#include "freertos/FreeRTOS.h"
+#else
+#include <mutex>
+#endif
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#ifdef ARDUINO
+/** @brief Serialises writers (all stores). */
+static portMUX_TYPE gWriteMux = portMUX_INITIALIZER_UNLOCKED;
+static void writeLock()   { portENTER_CRITICAL(&gWriteMux); }
+static void writeUnlock() { portEXIT_CRITICAL(&gWriteMux); }
+#else
+/** @brief Serialises writers (all stores). */
+static std::mutex gWriteLock;
+static void writeLock()   { gWriteLock.lock(); }
+static void writeUnlock() { gWriteLock.unlock(); }
+#endif
+
+/**
+ * @brief Value of a field in a struct, as float.
+ */
+static float fieldGet(const ConfigField& f, const void* cfg) {
+  const uint8_t* p = static_cast<const uint8_t*>(cfg) + f.offset;
+  if (f.type == CONFIG_FLOAT) {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  int32_t v;
+  memcpy(&v, p, sizeof(v));
+  return (float)v;
+}
+
+/**
+ * @brief Value of an integer field in a struct.
+ */
+static int32_t fieldGetInt(const ConfigField& f, const void* cfg) {
+  int32_t v;
+  memcpy(&v, static_cast<const uint8_t*>(cfg) + f.offset, sizeof(v));
+  return v;
+}
+
+/**
+ * @brief True if every field is within range and the cross-field check passes.
+ */
+static bool valid(const ConfigStore* s, const void* cfg) {
+  for (size_t i = 0; i < s->count; i++) {
+    float v = fieldGet(s->fields[i], cfg);
+    if (!(v >= s->fields[i].min && v <= s->fields[i].max)) return false;
+  }
+  return !s->check || s->check(cfg);
+}
+
+/**
+ * @brief Publish a complete struct: write the unused copy, then flip.
+ *
+ * Call with the write lock held.
+ */
+static void publish(ConfigStore* s, const void* cfg) {
+  uint32_t seq = s->seq.load(std::memory_order_relaxed);
+  s->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(s->buf[((seq >> 1) + 1) & 1], cfg, s->size);
+  s->seq.store(seq + 2, std::memory_order_release);
+}
+
+// ============================================================================
+// Store
+// ============================================================================
+
+void configInit(ConfigStore* store, const void* defaults) {
+  writeLock();
+  memcpy(store->buf[0], defaults, store->size);
+  memcpy(store->buf[1], defaults, store->size);
+  store->seq.store(0, std::memory_order_release);
+  writeUnlock();
+}
+
+int configFind(const ConfigStore* store, const char* key) {
+  for (size_t i = 0; i < store->count; i++) {
+    if (strcmp(store->fields[i].key, key) == 0) return (int)i;
+  }
+  return -1;
+}
+
+ConfigStatus configSet(ConfigStore* store, const char* key, const char* text) {
+  int idx = configFind(store, key);
+  if (idx < 0) return CONFIG_UNKNOWN_KEY;
+  const ConfigField& f = store->fields[idx];
+
+  char* end;
+  float fv = 0;
+  int32_t iv = 0;
+  if (f.type == CONFIG_FLOAT) {
+    fv = strtof(text, &end);
+  } else {
+    iv = (int32_t)strtol(text, &end, 0);
+    fv = (float)iv;
+  }
+  while (isspace((unsigned char)*end)) end++;
+  if (end == text || *end != '\0' || !(fv >= f.min && fv <= f.max)) return CONFIG_BAD_VALUE;
+
+  uint8_t next[CONFIG_MAX_SIZE];
+  ConfigStatus status = CONFIG_OK;
+  writeLock();
+  memcpy(next, configCurrent(store, store->seq.load(std::memory_order_relaxed)), store->size);
+  if (f.type == CONFIG_FLOAT) {
+    memcpy(next + f.offset, &fv, sizeof(fv));
+  } else {
+    memcpy(next + f.offset, &iv, sizeof(iv));
+  }
+  if (store->check && !store->check(next)) {
+    status = CONFIG_REJECTED;
+  } else {
+    publish(store, next);
+  }
+  writeUnlock();
+  return status;
+}
+
+ConfigStatus configReplace(ConfigStore* store, const void* cfg) {
+  if (!valid(store, cfg)) return CONFIG_REJECTED;
+  writeLock();
+  publish(store, cfg);
+  writeUnlock();
+  return CONFIG_OK;
+}
+
+ConfigStatus configApply(ConfigStore* store, const char* assignment) {
+  char key[32];
+  const char* eq = strchr(assignment, '=');
+  if (!eq) return CONFIG_BAD_VALUE;
+  while (isspace((unsigned char)*assignment)) assignment++;
+  size_t len = (size_t)(eq - assignment);
+  while (len > 0 && isspace((unsigned char)assignment[len - 1])) len--;
+  if (len == 0 || len >= sizeof(key)) return CONFIG_UNKNOWN_KEY;
+  memcpy(key, assignment, len);
+  key[len] = '\0';
+  const char* value = eq + 1;
+  while (isspace((unsigned char)*value)) value++;
+  return configSet(store, key, value);
+}
+
+const char* configStatusName(ConfigStatus status) {
+  switch (status) {
+    case CONFIG_OK:          return "ok";
+    case CONFIG_UNKNOWN_KEY: return "unknown key";
+    case CONFIG_BAD_VALUE:   return "bad value";
+    case CONFIG_REJECTED:    return "rejected";
+  }
+  return "?";
+}
+
+size_t configFormat(const ConfigStore* store, char* out, size_t size) {
+  if (size == 0) return 0;
+  uint8_t cfg[CONFIG_MAX_SIZE];
+  uint32_t seq;
+  do {
+    seq = configReadBegin(store);
+    memcpy(cfg, configCurrent(store, seq), store->size);
+  } while (configReadRetry(store, seq));
+
+  size_t n = 0;
+  out[0] = '\0';
+  for (size_t i = 0; i < store->count && n < size; i++) {
+    const ConfigField& f = store->fields[i];
+    int w = f.type == CONFIG_FLOAT
+              ? snprintf(out + n, size - n, "%s=%g\n", f.key, fieldGet(f, cfg))
+              : snprintf(out + n, size - n, "%s=%ld\n", f.key, (long)fieldGetInt(f, cfg));
+    if (w < 0) break;
+    n += (size_t)w;
+  }
+  return n < size ? n : size - 1;
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+#ifdef ARDUINO
+
+/**
+ * @brief FNV-1a over the field layout; a persisted copy with another layout is ignored.
+ */
+static uint32_t layoutHash(const ConfigStore* s) {
+  uint32_t h = 2166136261u;
+  auto mix = [&h](const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+  };
+  for (size_t i = 0; i < s->count; i++) {
+    const ConfigField& f = s->fields[i];
+    mix(f.key, strlen(f.key));
+    mix(&f.type, sizeof(f.type));
+    mix(&f.offset, sizeof(f.offset));
+  }
+  mix(&s->size, sizeof(s->size));
+  return h;
+}
+
+bool configLoad(ConfigStore* store) {
+  Preferences prefs;
+  if (!prefs.begin(store->nvsName, true)) return false;
+  uint8_t cfg[CONFIG_MAX_SIZE];
+  bool ok = prefs.getUInt("layout", 0) == layoutHash(store) &&
+            prefs.getBytesLength("values") == store->size &&
+            prefs.getBytes("values", cfg, store->size) == store->size;
+  prefs.end();
+  return ok && configReplace(store, cfg) == CONFIG_OK;
+}
+
+bool configSave(const ConfigStore* store) {
+  uint8_t cfg[CONFIG_MAX_SIZE];
+  uint32_t seq;
+  do {
+    seq = configReadBegin(store);
+    memcpy(cfg, configCurrent(store, seq), store->size);
+  } while (configReadRetry(store, seq));
+
+  Preferences prefs;
+  if (!prefs.begin(store->nvsName, false)) return false;
+  bool ok = prefs.putBytes("values", cfg, store->size) == store->size &&
+            prefs.putUInt("layout", layoutHash(store)) == sizeof(uint32_t);
+  prefs.end();
+  return ok;
+}
+
+#else
+
+bool configLoad(ConfigStore*) { return false; }
+bool configSave(const ConfigStore*) { return false; }
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * @file configTable.h
+ * @brief Runtime-adjustable parameters of the tracker (see config.h).
+ *
+ * Values are changed with CONFIG_SET messages on the serial link
+ * (host/configTool) and persisted in the "scanner" NVS namespace. Scan
+ * timing takes effect at the next scan; the distance parameters and the
+ * alert threshold at the next RSSI sample; the RSSI periods at the next
+ * scanner task period.
+ */
+
+#pragma once
+#include "config.h"
+
+/** @brief Parameters: X(type, name, default, min, max, help) */
+#define CONFIG_TABLE(X) \
+  X(float,   txPower,      -52.0f, -100.0f,     0.0f, "RSSI at 1 m (dBm)") \
+  X(float,   nFactor,        2.5f,    1.0f,     6.0f, "path-loss exponent") \
+  X(float,   rssiAlpha,      0.2f,   0.01f,     1.0f, "RSSI smoothing weight") \
+  X(int32_t, scanInterval,     80,       4,    16384, "scan interval (0.625 ms units)") \
+  X(int32_t, scanWindow,       40,       4,    16384, "scan window (0.625 ms units, <= interval)") \
+  X(float,   alertDistance,  10.0f,   0.0f,   100.0f, "distance alert threshold (m, 0 = off)") \
+  X(int32_t, rssiPeriod,       200,      20,    10000, "RSSI sample period per tag (ms)") \
+  X(int32_t, rssiFastPeriod,   100,      20,    10000, "RSSI sample period near the tracker or the alert edge (ms)")
+
+/** @brief The tracker's configuration struct. */
+struct AppConfig {
+#define X(type, name, def, lo, hi, help) type name;
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief The tracker's configuration store, defined in scanner.ino. */
+extern ConfigStore appConfig;
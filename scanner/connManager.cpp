@@ -0,0 +1,339 @@
+/**
+ * @file connManager.cpp
+ * @brief Link state machine, scheduling of the initiator, timeouts and retries.
+ *
+ * Every entry point updates the links under the lock and collects what has
+ * to happen next (stack requests and progress reports) as actions, which
+ * run after the lock is released. A request the stack refuses at once is
+ * fed back as a failed step.
+ */
+
+#include <string.h>
+#include "connManager.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#else
+#include <mutex>
+#endif
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+#ifdef ARDUINO
+/** @brief Guards the links and counters. */
+static portMUX_TYPE gMux = portMUX_INITIALIZER_UNLOCKED;
+static void lock()   { portENTER_CRITICAL(&gMux); }
+static void unlock() { portEXIT_CRITICAL(&gMux); }
+#else
+/** @brief Guards the links and counters. */
+static std::mutex gLock;
+static void lock()   { gLock.lock(); }
+static void unlock() { gLock.unlock(); }
+#endif
+
+static Link gLinks[CONN_MAX_LINKS];   /**< Link table. */
+static uint8_t gMaxLinks = 0;         /**< Links in use at most. */
+static uint8_t gMaxBusy = 1;          /**< Links in progress at most. */
+static const LinkOps* gOps = nullptr; /**< Stack interface. */
+static void* gCtx = nullptr;          /**< Op context. */
+static ConnStats gStats;              /**< Counters. */
+
+// ============================================================================
+// Actions
+// ============================================================================
+
+/**
+ * @brief Work deferred until the lock is released.
+ */
+enum ActionKind : uint8_t { ACT_OPEN, ACT_DISCOVER, ACT_SUBSCRIBE, ACT_CLOSE, ACT_PROGRESS };
+
+/**
+ * @brief One deferred action.
+ */
+struct Action {
+  ActionKind kind;   /**< What to do. */
+  uint8_t    link;   /**< Link index. */
+  Link       state;  /**< Link as of the action (address, progress snapshot). */
+};
+
+/** @brief Upper bound of actions one entry point can produce. */
+#define MAX_ACTIONS (4 * CONN_MAX_LINKS + 4)
+
+/**
+ * @brief Actions collected under the lock.
+ */
+struct Actions {
+  Action  items[MAX_ACTIONS];  /**< Pending actions, in order. */
+  uint8_t count;               /**< Number of pending actions. */
+};
+
+/**
+ * @brief Queue an action with a snapshot of the link.
+ */
+static void push(Actions* a, ActionKind kind, uint8_t i) {
+  if (a->count >= MAX_ACTIONS) return;
+  a->items[a->count].kind = kind;
+  a->items[a->count].link = i;
+  a->items[a->count].state = gLinks[i];
+  a->count++;
+}
+
+/**
+ * @brief Run the collected actions (lock released).
+ */
+static void run(const Actions* a, uint32_t nowMs) {
+  for (uint8_t k = 0; k < a->count; k++) {
+    const Action& act = a->items[k];
+    switch (act.kind) {
+      case ACT_OPEN:
+        if (!gOps->open(act.link, &act.state.addr, gCtx)) {
+          connManagerOnStep(act.link, LINK_STEP_OPENED, false, nowMs);
+        }
+        break;
+      case ACT_DISCOVER:
+        if (!gOps->discover(act.link, gCtx)) {
+          connManagerOnStep(act.link, LINK_STEP_DISCOVERED, false, nowMs);
+        }
+        break;
+      case ACT_SUBSCRIBE:
+        if (!gOps->subscribe(act.link, gCtx)) {
+          connManagerOnStep(act.link, LINK_STEP_SUBSCRIBED, false, nowMs);
+        }
+        break;
+      case ACT_CLOSE:
+        gOps->close(act.link, &act.state.addr, gCtx);
+        break;
+      case ACT_PROGRESS:
+        if (gOps->progress) gOps->progress(act.link, &act.state, gCtx);
+        break;
+    }
+  }
+}
+
+// ============================================================================
+// State Machine
+// ============================================================================
+
+/**
+ * @brief Enter a state and report it.
+ */
+static void enter(uint8_t i, LinkState state, uint32_t nowMs, Actions* a) {
+  gLinks[i].state = state;
+  gLinks[i].stateMs = nowMs;
+  push(a, ACT_PROGRESS, i);
+}
+
+/**
+ * @brief True for the states between connecting and ready.
+ */
+static bool busy(LinkState s) {
+  return s == LINK_CONNECTING || s == LINK_DISCOVERING || s == LINK_SUBSCRIBING;
+}
+
+/**
+ * @brief A step failed: close if needed, then back off or give up.
+ */
+static void fail(uint8_t i, bool close, uint32_t nowMs, Actions* a) {
+  Link& l = gLinks[i];
+  gStats.failures++;
+  if (close) push(a, ACT_CLOSE, i);
+  if (++l.attempts >= CONN_MAX_ATTEMPTS) {
+    enter(i, LINK_IDLE, nowMs, a);
+    l.tag = -1;
+    return;
+  }
+  l.retryMs = nowMs + (CONN_RETRY_BASE_MS << (l.attempts - 1));
+  enter(i, LINK_BACKOFF, nowMs, a);
+}
+
+/**
+ * @brief Start the oldest waiting link if the initiator and a busy slot are free.
+ */
+static void schedule(uint32_t nowMs, Actions* a) {
+  uint8_t inProgress = 0;
+  for (uint8_t i = 0; i < gMaxLinks; i++) {
+    if (gLinks[i].state == LINK_CONNECTING) return;
+    if (busy(gLinks[i].state)) inProgress++;
+  }
+  if (inProgress >= gMaxBusy) return;
+
+  int next = -1;
+  for (uint8_t i = 0; i < gMaxLinks; i++) {
+    if (gLinks[i].state != LINK_WAITING) continue;
+    if (next < 0 || (int32_t)(gLinks[i].stateMs - gLinks[next].stateMs) < 0) next = i;
+  }
+  if (next < 0) return;
+  gStats.opens++;
+  enter((uint8_t)next, LINK_CONNECTING, nowMs, a);
+  push(a, ACT_OPEN, (uint8_t)next);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void connManagerInit(const LinkOps* ops, void* ctx, uint8_t maxLinks, uint8_t maxBusy) {
+  lock();
+  memset(gLinks, 0, sizeof(gLinks));
+  for (Link& l : gLinks) l.tag = -1;
+  memset(&gStats, 0, sizeof(gStats));
+  gOps = ops;
+  gCtx = ctx;
+  gMaxLinks = maxLinks < CONN_MAX_LINKS ? maxLinks : CONN_MAX_LINKS;
+  gMaxBusy = maxBusy ? maxBusy : 1;
+  unlock();
+}
+
+bool connManagerRequest(int16_t tag, const LinkAddr* addr, uint32_t nowMs) {
+  Actions a;
+  a.count = 0;
+  lock();
+  int slot = -1;
+  for (uint8_t i = 0; i < gMaxLinks; i++) {
+    if (gLinks[i].state != LINK_IDLE && gLinks[i].tag == tag) {
+      gLinks[i].addr = *addr;
+      unlock();
+      return true;
+    }
+    if (slot < 0 && gLinks[i].state == LINK_IDLE) slot = i;
+  }
+  if (slot < 0) {
+    unlock();
+    return false;
+  }
+  Link& l = gLinks[slot];
+  l.addr = *addr;
+  l.tag = tag;
+  l.attempts = 0;
+  l.requestMs = nowMs;
+  gStats.requests++;
+  enter((uint8_t)slot, LINK_WAITING, nowMs, &a);
+  schedule(nowMs, &a);
+  unlock();
+  run(&a, nowMs);
+  return true;
+}
+
+void connManagerOnStep(uint8_t link, LinkStep step, bool ok, uint32_t nowMs) {
+  if (link >= gMaxLinks) return;
+  Actions a;
+  a.count = 0;
+  lock();
+  Link& l = gLinks[link];
+  switch (step) {
+    case LINK_STEP_OPENED:
+      if (l.state != LINK_CONNECTING) {
+        if (ok) push(&a, ACT_CLOSE, link);  // late success after a timeout
+      } else if (ok) {
+        enter(link, LINK_DISCOVERING, nowMs, &a);
+        push(&a, ACT_DISCOVER, link);
+      } else {
+        fail(link, false, nowMs, &a);
+      }
+      break;
+    case LINK_STEP_DISCOVERED:
+      if (l.state != LINK_DISCOVERING) break;
+      if (ok) {
+        enter(link, LINK_SUBSCRIBING, nowMs, &a);
+        push(&a, ACT_SUBSCRIBE, link);
+      } else {
+        fail(link, true, nowMs, &a);
+      }
+      break;
+    case LINK_STEP_SUBSCRIBED:
+      if (l.state != LINK_SUBSCRIBING) break;
+      if (ok) {
+        l.attempts = 0;
+        l.readyMs = nowMs - l.requestMs;
+        gStats.ready++;
+        gStats.sumReadyMs += l.readyMs;
+        if (l.readyMs > gStats.maxReadyMs) gStats.maxReadyMs = l.readyMs;
+        enter(link, LINK_READY, nowMs, &a);
+      } else {
+        fail(link, true, nowMs, &a);
+      }
+      break;
+    case LINK_STEP_CLOSED:
+      if (l.state == LINK_READY) {
+        gStats.lost++;
+        l.attempts = 0;
+        l.requestMs = nowMs;
+        enter(link, LINK_WAITING, nowMs, &a);
+      } else if (busy(l.state)) {
+        fail(link, false, nowMs, &a);
+      }
+      break;
+  }
+  schedule(nowMs, &a);
+  unlock();
+  run(&a, nowMs);
+}
+
+void connManagerTick(uint32_t nowMs) {
+  Actions a;
+  a.count = 0;
+  lock();
+  for (uint8_t i = 0; i < gMaxLinks; i++) {
+    Link& l = gLinks[i];
+    uint32_t age = nowMs - l.stateMs;
+    if (l.state == LINK_CONNECTING && age >= CONN_OPEN_TIMEOUT_MS) {
+      fail(i, true, nowMs, &a);
+    } else if ((l.state == LINK_DISCOVERING || l.state == LINK_SUBSCRIBING) && age >= CONN_STEP_TIMEOUT_MS) {
+      fail(i, true, nowMs, &a);
+    } else if (l.state == LINK_BACKOFF && (int32_t)(nowMs - l.retryMs) >= 0) {
+      enter(i, LINK_WAITING, nowMs, &a);
+    }
+  }
+  schedule(nowMs, &a);
+  unlock();
+  run(&a, nowMs);
+}
+
+bool connManagerGet(uint8_t link, Link* out) {
+  if (link >= gMaxLinks) return false;
+  lock();
+  *out = gLinks[link];
+  unlock();
+  return true;
+}
+
+int connManagerFind(int16_t tag) {
+  int found = -1;
+  lock();
+  for (uint8_t i = 0; i < gMaxLinks && found < 0; i++) {
+    if (gLinks[i].state != LINK_IDLE && gLinks[i].tag == tag) found = i;
+  }
+  unlock();
+  return found;
+}
+
+uint8_t connManagerReadyCount(void) {
+  uint8_t n = 0;
+  lock();
+  for (uint8_t i = 0; i < gMaxLinks; i++) {
+    if (gLinks[i].state == LINK_READY) n++;
+  }
+  unlock();
+  return n;
+}
+
+void connManagerStats(ConnStats* out) {
+  lock();
+  *out = gStats;
+  unlock();
+}
+
+const char* linkStateName(LinkState state) {
+  switch (state) {
+    case LINK_IDLE:        return "idle";
+    case LINK_WAITING:     return "waiting";
+    case LINK_CONNECTING:  return "connecting";
+    case LINK_DISCOVERING: return "discovering";
+    case LINK_SUBSCRIBING: return "subscribing";
+    case LINK_READY:       return "ready";
+    case LINK_BACKOFF:     return "backoff";
+  }
+  return "?";
+}
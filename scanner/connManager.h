@@ -0,0 +1,172 @@
+/**
+ * @file connManager.h
+ * @brief Asynchronous connection manager for several tags at once.
+ *
+ * Each link walks through connect, service discovery and notification
+ * subscription as a state machine advanced by completion callbacks of the
+ * BLE stack, so no task blocks on a GATT procedure. The controller can
+ * initiate only one connection at a time; while one link connects, links
+ * that are already connected run their discovery and subscription
+ * concurrently, up to `maxBusy` links in progress and `maxLinks` links in
+ * total (the controller's connection limit).
+ *
+ * Failed or timed-out steps close the link and retry it after an
+ * exponential backoff; a tag sighted again refreshes the address to use
+ * (private addresses rotate). A link that disconnects after it was ready
+ * reconnects at once.
+ *
+ * The manager knows nothing about the stack: requests go out through
+ * LinkOps and completions come back through `connManagerOnStep()`. Time is
+ * passed in explicitly, so the same code runs against a simulated link on
+ * the host.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Most links the manager can hold (the controller's default limit). */
+#ifndef CONN_MAX_LINKS
+#define CONN_MAX_LINKS 3
+#endif
+
+/** @brief Time allowed for a connection to be established (ms). */
+#define CONN_OPEN_TIMEOUT_MS 5000
+
+/** @brief Time allowed for discovery or subscription (ms). */
+#define CONN_STEP_TIMEOUT_MS 3000
+
+/** @brief First retry delay; doubles with each failed attempt (ms). */
+#define CONN_RETRY_BASE_MS 250
+
+/** @brief Attempts before a link is given up until the tag is sighted again. */
+#define CONN_MAX_ATTEMPTS 4
+
+/**
+ * @brief Link states.
+ */
+enum LinkState : uint8_t {
+  LINK_IDLE = 0,      /**< Slot free. */
+  LINK_WAITING,       /**< Requested; waiting for the initiator or a busy slot. */
+  LINK_CONNECTING,    /**< Connection being established. */
+  LINK_DISCOVERING,   /**< Looking up the service and characteristics. */
+  LINK_SUBSCRIBING,   /**< Enabling notifications. */
+  LINK_READY,         /**< Connected, discovered and subscribed. */
+  LINK_BACKOFF,       /**< Waiting to retry after a failure. */
+};
+
+/**
+ * @brief Completed stack procedures, reported with `connManagerOnStep()`.
+ */
+enum LinkStep : uint8_t {
+  LINK_STEP_OPENED = 0,   /**< Connection attempt finished. */
+  LINK_STEP_DISCOVERED,   /**< Service and characteristics found (or not). */
+  LINK_STEP_SUBSCRIBED,   /**< Notifications enabled (or refused). */
+  LINK_STEP_CLOSED,       /**< Link lost or closed. */
+};
+
+/**
+ * @brief Peer address.
+ */
+struct LinkAddr {
+  uint8_t bda[6];   /**< Address, as the stack stores it. */
+  uint8_t type;     /**< Address type (public, random, ...). */
+};
+
+/**
+ * @brief One link.
+ */
+struct Link {
+  LinkAddr  addr;        /**< Address to connect to. */
+  int16_t   tag;         /**< Tag the link belongs to, -1 if idle. */
+  LinkState state;       /**< Current state. */
+  uint8_t   attempts;    /**< Failed attempts since the last success. */
+  uint32_t  stateMs;     /**< Time the current state was entered. */
+  uint32_t  requestMs;   /**< Time the current (re)connection was requested. */
+  uint32_t  retryMs;     /**< Time a backoff ends. */
+  uint32_t  readyMs;     /**< Request-to-ready time of the last success. */
+};
+
+/**
+ * @brief Stack interface. Calls are made outside the manager's lock and
+ *        must not block; each started procedure is reported back with
+ *        `connManagerOnStep()`. A false return counts as a failed step.
+ */
+struct LinkOps {
+  bool (*open)(uint8_t link, const LinkAddr* addr, void* ctx);       /**< Start connecting. */
+  bool (*discover)(uint8_t link, void* ctx);                         /**< Start discovery. */
+  bool (*subscribe)(uint8_t link, void* ctx);                        /**< Enable notifications. */
+  void (*close)(uint8_t link, const LinkAddr* addr, void* ctx);      /**< Disconnect or cancel. */
+  void (*progress)(uint8_t link, const Link* state, void* ctx);      /**< State changed (may be nullptr). */
+};
+
+/**
+ * @brief Counters since `connManagerInit()`.
+ */
+struct ConnStats {
+  uint32_t requests;   /**< Links requested for new tags. */
+  uint32_t opens;      /**< Connection attempts started. */
+  uint32_t failures;   /**< Failed or timed-out steps. */
+  uint32_t ready;      /**< Links that became ready. */
+  uint32_t lost;       /**< Ready links that disconnected. */
+  uint32_t maxReadyMs; /**< Longest request-to-ready time. */
+  uint64_t sumReadyMs; /**< Sum of request-to-ready times. */
+};
+
+/**
+ * @brief Reset the manager.
+ *
+ * @param[in] ops      Stack interface (must outlive the manager).
+ * @param[in] ctx      Context passed to every op.
+ * @param[in] maxLinks Links at most (clamped to CONN_MAX_LINKS).
+ * @param[in] maxBusy  Links at most between connecting and ready; 1 makes
+ *                     the pipeline sequential.
+ */
+void connManagerInit(const LinkOps* ops, void* ctx, uint8_t maxLinks, uint8_t maxBusy);
+
+/**
+ * @brief Ask for a link to a sighted tag.
+ *
+ * A tag that already has a link only refreshes its address (used on the
+ * next attempt); a tag given up after CONN_MAX_ATTEMPTS starts over.
+ *
+ * @return False if all links are taken.
+ */
+bool connManagerRequest(int16_t tag, const LinkAddr* addr, uint32_t nowMs);
+
+/**
+ * @brief Report a completed procedure (from the stack's callbacks).
+ */
+void connManagerOnStep(uint8_t link, LinkStep step, bool ok, uint32_t nowMs);
+
+/**
+ * @brief Run timeouts and retries; call every few tens of milliseconds.
+ */
+void connManagerTick(uint32_t nowMs);
+
+/**
+ * @brief Copy of a link's state.
+ *
+ * @return False if `link` is out of range.
+ */
+bool connManagerGet(uint8_t link, Link* out);
+
+/**
+ * @brief Link of a tag, or -1.
+ */
+int connManagerFind(int16_t tag);
+
+/**
+ * @brief Number of ready links.
+ */
+uint8_t connManagerReadyCount(void);
+
+/**
+ * @brief Copy of the counters.
+ */
+void connManagerStats(ConnStats* out);
+
+/**
+ * @brief Name of a state.
+ */
+const char* linkStateName(LinkState state);
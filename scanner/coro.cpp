@@ -0,0 +1,111 @@
+/**
+ * @file coro.cpp
+ * @brief Frame pool and event registry for the coroutine runtime.
+ */
+
+#include <string.h>
+#include "coro.h"
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/**
+ * @brief One frame block, aligned for any coroutine frame.
+ */
+struct alignas(16) FrameBlock {
+  uint8_t bytes[CORO_FRAME_SIZE];  /**< Frame storage. */
+};
+
+/** @brief Frame pool. */
+static FrameBlock gFrames[CORO_FRAME_POOL];
+
+/** @brief Bit `i` set while block `i` is allocated. */
+static uint32_t gUsedMask = 0;
+
+static_assert(CORO_FRAME_POOL <= 32, "the frame pool bitmap holds 32 blocks");
+
+/** @brief Pool statistics. */
+static CoroStats gStats;
+
+/** @brief Events that can be woken through the event queue. */
+static CoroEvent* gEvents[CORO_MAX_EVENTS];
+
+/** @brief Registered events. */
+static uint8_t gEventCount = 0;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Loop handler for posted event wake-ups.
+ */
+static void onCoroLoopEvent(const LoopEvent* e, void*) {
+  if (e->arg < gEventCount) coroEventSet(gEvents[e->arg], e->value);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void* coroFrameAlloc(size_t size) noexcept {
+  if (size > gStats.largestFrame) gStats.largestFrame = (uint32_t)size;
+  if (size <= CORO_FRAME_SIZE) {
+    for (uint32_t i = 0; i < CORO_FRAME_POOL; i++) {
+      if (gUsedMask & (1u << i)) continue;
+      gUsedMask |= 1u << i;
+      if (++gStats.inUse > gStats.peak) gStats.peak = gStats.inUse;
+      return gFrames[i].bytes;
+    }
+  }
+  gStats.failures++;
+  return nullptr;
+}
+
+void coroFrameFree(void* frame) noexcept {
+  uint32_t i = (uint32_t)((FrameBlock*)frame - gFrames);
+  if (i >= CORO_FRAME_POOL || !(gUsedMask & (1u << i))) return;
+  gUsedMask &= ~(1u << i);
+  gStats.inUse--;
+}
+
+void coroInit(void) {
+  gUsedMask = 0;
+  memset(&gStats, 0, sizeof(gStats));
+  gEventCount = 0;
+  eventLoopOn(CORO_LOOP_EVENT, onCoroLoopEvent, nullptr);
+}
+
+void coroGetStats(CoroStats* out) {
+  *out = gStats;
+}
+
+bool coroEventInit(CoroEvent* event) {
+  if (gEventCount >= CORO_MAX_EVENTS) return false;
+  *event = CoroEvent{};
+  event->id = gEventCount;
+  gEvents[gEventCount++] = event;
+  return true;
+}
+
+void coroEventSet(CoroEvent* event, uint32_t value) {
+  event->value = value;
+  std::coroutine_handle<> h = event->waiter;
+  if (!h) {
+    event->set = true;
+    return;
+  }
+  event->waiter = nullptr;
+  h.resume();
+}
+
+bool coroEventPost(const CoroEvent* event, uint32_t value) {
+  LoopEvent e = { CORO_LOOP_EVENT, event->id, 0, value, 0 };
+  return eventLoopPost(&e);
+}
+
+bool coroEventPostFromISR(const CoroEvent* event, uint32_t value, int* woken) {
+  LoopEvent e = { CORO_LOOP_EVENT, event->id, 0, value, 0 };
+  return eventLoopPostFromISR(&e, woken);
+}
@@ -0,0 +1,246 @@
+/**
+ * @file coro.h
+ * @brief Stackless C++20 coroutines scheduled on the event loop.
+ *
+ * A flow such as "wait for a card, check it, beep for 500 ms, unlock" is
+ * written as one sequential `CoroTask` function. Every `co_await` suspends
+ * the coroutine and returns to the event loop, so many flows share the loop
+ * task's stack; each costs only its frame, which is taken from a fixed pool
+ * (CORO_FRAME_POOL blocks of CORO_FRAME_SIZE bytes) instead of the heap.
+ *
+ * Awaitables:
+ * - `coroDelay(ms)`             resume after a delay (a LoopTimer in the frame)
+ * - `coroPoll(fn, ctx, ms)`     resume once `fn(ctx)` returns true, checked every `ms`
+ * - `coroReceive(q, item, ms)`  resume with an item from a FreeRTOS queue (device)
+ * - `co_await event`            resume when a CoroEvent is set, e.g. by a BLE
+ *                               callback or a GPIO interrupt
+ *
+ * Coroutines must be started and resumed on the loop task. Other tasks and
+ * ISRs wake them with `coroEventPost` / `coroEventPostFromISR`, which go
+ * through the loop's event queue.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <coroutine>
+#include "eventLoop.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#endif
+
+/** @brief Size of one frame block; larger coroutines fail to start. */
+#ifndef CORO_FRAME_SIZE
+#define CORO_FRAME_SIZE 192
+#endif
+
+/** @brief Number of frame blocks, i.e. coroutines alive at once. */
+#ifndef CORO_FRAME_POOL
+#define CORO_FRAME_POOL 8
+#endif
+
+/** @brief Number of CoroEvents that can be woken through the event queue. */
+#define CORO_MAX_EVENTS 8
+
+/** @brief Loop event type reserved for waking coroutines. */
+#define CORO_LOOP_EVENT (LOOP_EVENT_TYPES - 1)
+
+/**
+ * @brief Frame pool statistics.
+ */
+struct CoroStats {
+  uint32_t inUse;          /**< Frames currently allocated. */
+  uint32_t peak;           /**< Most frames allocated at once. */
+  uint32_t largestFrame;   /**< Largest frame requested (bytes). */
+  uint32_t failures;       /**< Coroutines that could not start. */
+};
+
+/**
+ * @brief Allocate a frame block (nullptr if none fits).
+ */
+void* coroFrameAlloc(size_t size) noexcept;
+
+/**
+ * @brief Return a frame block to the pool.
+ */
+void coroFrameFree(void* frame) noexcept;
+
+/**
+ * @brief Reset the frame pool and event registry and hook into the event loop.
+ *
+ * Call after `eventLoopInit()` on the loop task, before starting coroutines.
+ */
+void coroInit(void);
+
+/**
+ * @brief Read frame pool statistics.
+ */
+void coroGetStats(CoroStats* out);
+
+// ============================================================================
+// Task Type
+// ============================================================================
+
+/**
+ * @brief Return type of a fire-and-forget coroutine.
+ *
+ * Calling the coroutine runs it until its first suspension; its frame is
+ * released when it returns.
+ */
+struct CoroTask {
+  struct promise_type {
+    CoroTask get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept {}
+
+    static void* operator new(size_t size) noexcept { return coroFrameAlloc(size); }
+    static void operator delete(void* frame) noexcept { coroFrameFree(frame); }
+    static CoroTask get_return_object_on_allocation_failure() noexcept { return {}; }
+  };
+};
+
+// ============================================================================
+// Awaitables
+// ============================================================================
+
+/**
+ * @brief Awaiter that resumes after a delay.
+ */
+struct CoroDelay {
+  uint32_t                ms;        /**< Delay. */
+  LoopTimer               timer{};   /**< Wake-up timer. */
+  std::coroutine_handle<> handle{};  /**< Suspended coroutine. */
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) noexcept {
+    handle = h;
+    loopTimerStart(&timer, ms, 0, wake, this);
+  }
+  void await_resume() const noexcept {}
+
+  static void wake(LoopTimer*, void* ctx) { ((CoroDelay*)ctx)->handle.resume(); }
+};
+
+/**
+ * @brief Suspend the calling coroutine for `ms` milliseconds.
+ */
+inline CoroDelay coroDelay(uint32_t ms) { return CoroDelay{ms}; }
+
+/** @brief Condition checked by `coroPoll`. */
+typedef bool (*CoroPollFn)(void* ctx);
+
+/**
+ * @brief Awaiter that resumes once a condition holds.
+ */
+struct CoroPoll {
+  CoroPollFn              fn;        /**< Condition. */
+  void*                   ctx;       /**< Condition context. */
+  uint32_t                periodMs;  /**< Check interval. */
+  LoopTimer               timer{};   /**< Check timer. */
+  std::coroutine_handle<> handle{};  /**< Suspended coroutine. */
+
+  bool await_ready() const noexcept { return fn(ctx); }
+  void await_suspend(std::coroutine_handle<> h) noexcept {
+    handle = h;
+    loopTimerStart(&timer, periodMs, periodMs, check, this);
+  }
+  void await_resume() const noexcept {}
+
+  static void check(LoopTimer* t, void* ctx) {
+    CoroPoll* p = (CoroPoll*)ctx;
+    if (!p->fn(p->ctx)) return;
+    loopTimerStop(t);  // the frame holding the timer may end in resume()
+    p->handle.resume();
+  }
+};
+
+/**
+ * @brief Suspend until `fn(ctx)` returns true, checking every `periodMs`.
+ */
+inline CoroPoll coroPoll(CoroPollFn fn, void* ctx, uint32_t periodMs) {
+  return CoroPoll{fn, ctx, periodMs};
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Awaiter that resumes with an item received from a FreeRTOS queue.
+ */
+struct CoroReceive {
+  QueueHandle_t           queue;     /**< Source queue. */
+  void*                   item;      /**< Destination of the item. */
+  uint32_t                periodMs;  /**< Check interval. */
+  LoopTimer               timer{};   /**< Check timer. */
+  std::coroutine_handle<> handle{};  /**< Suspended coroutine. */
+
+  bool await_ready() noexcept { return xQueueReceive(queue, item, 0) == pdTRUE; }
+  void await_suspend(std::coroutine_handle<> h) noexcept {
+    handle = h;
+    loopTimerStart(&timer, periodMs, periodMs, check, this);
+  }
+  void await_resume() const noexcept {}
+
+  static void check(LoopTimer* t, void* ctx) {
+    CoroReceive* r = (CoroReceive*)ctx;
+    if (xQueueReceive(r->queue, r->item, 0) != pdTRUE) return;
+    loopTimerStop(t);
+    r->handle.resume();
+  }
+};
+
+/**
+ * @brief Suspend until an item can be received from `queue` into `item`.
+ */
+inline CoroReceive coroReceive(QueueHandle_t queue, void* item, uint32_t periodMs) {
+  return CoroReceive{queue, item, periodMs};
+}
+#endif
+
+/**
+ * @brief A one-waiter event carrying a 32-bit value.
+ *
+ * `co_await event` returns the value passed to `coroEventSet`. A set that
+ * happens while nobody waits is latched and consumed by the next await.
+ * Place events statically and register them once with `coroEventInit`.
+ */
+struct CoroEvent {
+  std::coroutine_handle<> waiter{};  /**< Suspended coroutine, if any. */
+  uint32_t                value = 0; /**< Last value set. */
+  bool                    set = false; /**< Set while nobody waited. */
+  uint8_t                 id = 0;    /**< Registry index for posted wake-ups. */
+
+  bool await_ready() noexcept {
+    if (!set) return false;
+    set = false;
+    return true;
+  }
+  void await_suspend(std::coroutine_handle<> h) noexcept { waiter = h; }
+  uint32_t await_resume() const noexcept { return value; }
+};
+
+/**
+ * @brief Register an event so other tasks and ISRs can post to it.
+ *
+ * @return False if the registry is full.
+ */
+bool coroEventInit(CoroEvent* event);
+
+/**
+ * @brief Set an event from the loop task, resuming its waiter immediately.
+ */
+void coroEventSet(CoroEvent* event, uint32_t value);
+
+/**
+ * @brief Set an event from another task (delivered on the loop task).
+ */
+bool coroEventPost(const CoroEvent* event, uint32_t value);
+
+/**
+ * @brief Set an event from an interrupt handler (delivered on the loop task).
+ *
+ * @param[out] woken Set if a higher priority task was woken (may be nullptr).
+ */
+bool coroEventPostFromISR(const CoroEvent* event, uint32_t value, int* woken);
@@ -37,24 +37,6 @@ bool hasAvg = false;
  */
 float rssiAvg = 0.0f;
 
-/**
- * @brief Transmitter power at 1 meter (in dBm).
- *
- * This value should be tuned based on calibration measurements.
- */
-float txPower = -52.0f;   // tune later
-
-/**
- * @brief Path-loss exponent (environmental factor).
- *
- * Typical values:
- * - ~2.0 in free space
- * - 2.7–4.0 in indoor/obstructed environments
- *
- * Should be tuned experimentally for best accuracy.
- */
-float nFactor = 2.5f;     // tune later
-
 // ============================================================================
 // Functions
 // ============================================================================
@@ -62,13 +44,13 @@ float nFactor = 2.5f;     // tune later
 /**
  * @brief Updates the running average of the received signal strength indicator (RSSI).
  *
- * Applies exponential smoothing with a fixed factor \f$\alpha = 0.2\f$.
- * This reduces noise in instantaneous RSSI readings.
+ * Applies exponential smoothing with factor \f$\alpha\f$ (0.2 by default,
+ * see configTable.h). This reduces noise in instantaneous RSSI readings.
  *
- * @param[in] rssi Current measured RSSI value (in dBm).
+ * @param[in] rssi  Current measured RSSI value (in dBm).
+ * @param[in] alpha Weight of the new reading.
  */
-void updateRssiAvg(int rssi) {
-  const float alpha = 0.2f;
+void updateRssiAvg(int rssi, float alpha) {
   if (!hasAvg) {
     rssiAvg = rssi;
     hasAvg = true;
@@ -77,6 +59,45 @@ void updateRssiAvg(int rssi) {
   }
 }
 
+/**
+ * @brief Updates the running RSSI average of one tag.
+ *
+ * Same smoothing as `updateRssiAvg()`, on caller-owned state, and tracks
+ * the variance of the readings with the same weight.
+ *
+ * @param[in,out] avg   Average to update.
+ * @param[in]     rssi  Current measured RSSI value (in dBm).
+ * @param[in]     alpha Weight of the new reading.
+ * @return The updated average.
+ */
+float rssiAverageUpdate(RssiAverage* avg, int rssi, float alpha) {
+  if (!avg->has) {
+    avg->value = rssi;
+    avg->var = 0.0f;
+    avg->has = true;
+  } else {
+    float diff = rssi - avg->value;
+    avg->value += alpha * diff;
+    avg->var = (1.0f - alpha) * (avg->var + alpha * diff * diff);
+  }
+  return avg->value;
+}
+
+/**
+ * @brief Carries the smoothed RSSI variance through the path-loss model.
+ *
+ * @param[in] meters  Estimated distance.
+ * @param[in] n       Path-loss exponent.
+ * @param[in] rssiVar Variance of the raw readings.
+ * @param[in] alpha   Smoothing weight of the average.
+ * @return Distance variance (m^2).
+ */
+float distanceVariance(float meters, float n, float rssiVar, float alpha) {
+  float smoothedVar = rssiVar * alpha / (2.0f - alpha);
+  float slope = meters * logf(10.0f) / (10.0f * n);
+  return slope * slope * smoothedVar;
+}
+
 /**
  * @brief Estimates the distance (in meters) from RSSI using the log-distance path loss model.
  *
@@ -2,8 +2,9 @@
  * @file distance.h
  * @brief Functions and variables for RSSI averaging and distance estimation.
  *
- * Provides global parameters and helper functions for smoothing RSSI values
- * and estimating distance based on the log-distance path loss model.
+ * Provides helper functions for smoothing RSSI values and estimating distance
+ * based on the log-distance path loss model. The reference power, path-loss
+ * exponent and smoothing weight are runtime parameters (configTable.h).
  */
 
 #pragma once
@@ -20,32 +21,49 @@ extern bool hasAvg;
 extern float rssiAvg;
 
 /**
- * @brief Reference transmit power (measured RSSI at 1 meter distance).
+ * @brief Update the exponential moving average of the RSSI.
+ *
+ * Uses an exponential smoothing factor to stabilize the RSSI reading
+ * against sudden fluctuations.
  *
- * Typically determined through calibration, defaulting around -59 dBm
- * for many BLE devices.
+ * @param[in] rssi  Latest RSSI reading (in dBm).
+ * @param[in] alpha Weight of the new reading (0-1).
+ */
+void updateRssiAvg(int rssi, float alpha);
+
+/**
+ * @brief Exponential moving average of one tag's RSSI.
  */
-extern float txPower;
+struct RssiAverage {
+  bool  has;    /**< An average has been started. */
+  float value;  /**< Smoothed RSSI (dBm). */
+  float var;    /**< Exponentially weighted variance of the raw readings (dB^2). */
+};
 
 /**
- * @brief Path-loss exponent (environmental factor).
+ * @brief Update a tag's RSSI average, like `updateRssiAvg()`.
  *
- * Represents how quickly the signal attenuates with distance.
- * Common values:
- * - Free space: ~2.0
- * - Indoor: 2.7 – 4.0
+ * @param[in,out] avg   Average to update.
+ * @param[in]     rssi  Latest RSSI reading (in dBm).
+ * @param[in]     alpha Weight of the new reading (0-1).
+ * @return The updated average.
  */
-extern float nFactor;
+float rssiAverageUpdate(RssiAverage* avg, int rssi, float alpha);
 
 /**
- * @brief Update the exponential moving average of the RSSI.
+ * @brief Variance of a distance estimated from a smoothed RSSI.
  *
- * Uses an exponential smoothing factor to stabilize the RSSI reading
- * against sudden fluctuations.
+ * The smoothed RSSI has variance `rssiVar * alpha / (2 - alpha)`; it is
+ * carried through the path-loss model to first order,
+ * \f$\sigma_d = d \ln 10 / (10 n) \cdot \sigma_{rssi}\f$.
  *
- * @param[in] rssi Latest RSSI reading (in dBm).
+ * @param[in] meters  Estimated distance.
+ * @param[in] n       Path-loss exponent.
+ * @param[in] rssiVar Variance of the raw readings (RssiAverage::var).
+ * @param[in] alpha   Smoothing weight the average uses.
+ * @return Distance variance (m^2).
  */
-void updateRssiAvg(int rssi);
+float distanceVariance(float meters, float n, float rssiVar, float alpha);
 
 /**
  * @brief Estimate distance from RSSI using the log-distance path loss model.
@@ -59,8 +77,9 @@ void updateRssiAvg(int rssi);
  * \f]
  *
  * @param[in] rssi   Current RSSI reading (dBm).
- * @param[in] txPower Reference RSSI at 1 meter (dBm).
- * @param[in] n       Path-loss exponent.
+ * @param[in] txPower Reference RSSI at 1 meter (dBm), typically around
+ *                    -59 dBm; determined by calibration.
+ * @param[in] n       Path-loss exponent: ~2.0 in free space, 2.7-4.0 indoors.
  * @return Estimated distance in meters.
  */
 float estimateDistanceMeters(float rssi, float txPower, float n);
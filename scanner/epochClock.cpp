@@ -0,0 +1,111 @@
+/**
+ * @file epochClock.cpp
+ * @brief Shared epoch counter: uptime plus an offset, saved to NVS.
+ *
+ * The counter is `uptime + offset`. Setting it only changes the offset,
+ * a single atomic word, so readers on other tasks never see a torn value.
+ *
+ * @note This file is shared verbatim between the server (tag) and scanner
+ *       (tracker) sketches. Keep both copies in sync.
+ */
+
+#include <atomic>
+#include "epochClock.h"
+#include "rollingId.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#include "esp_timer.h"
+#else
+#include <time.h>
+#endif
+
+// ============================================================================
+// Module State
+// ============================================================================
+
+static std::atomic<int32_t>  gOffsetS{ 0 };       /**< Counter minus uptime (s). */
+static std::atomic<uint32_t> gSavedS{ 0 };        /**< Counter at the last save. */
+static const char*           gNvsName = nullptr;  /**< NVS namespace, nullptr before begin. */
+
+/** @brief Milliseconds since boot. */
+static uint64_t uptimeMs() {
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time() / 1000;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/** @brief Write the counter to NVS. */
+static bool save(uint32_t seconds) {
+  gSavedS.store(seconds, std::memory_order_relaxed);
+#ifdef ARDUINO
+  if (!gNvsName) return false;
+  Preferences prefs;
+  if (!prefs.begin(gNvsName, false)) return false;
+  bool ok = prefs.putUInt("epoch", seconds) == sizeof(uint32_t);
+  prefs.end();
+  return ok;
+#else
+  return false;
+#endif
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool epochClockBegin(const char* nvsName) {
+  gNvsName = nvsName;
+  uint32_t saved = 0;
+#ifdef ARDUINO
+  Preferences prefs;
+  if (prefs.begin(nvsName, true)) {
+    saved = prefs.getUInt("epoch", 0);
+    prefs.end();
+  }
+#endif
+  gOffsetS.store((int32_t)(saved - (uint32_t)(uptimeMs() / 1000)), std::memory_order_relaxed);
+  gSavedS.store(saved, std::memory_order_relaxed);
+  return saved != 0;
+}
+
+uint32_t epochClockNow(void) {
+  return (uint32_t)(uptimeMs() / 1000) + (uint32_t)gOffsetS.load(std::memory_order_relaxed);
+}
+
+uint64_t epochClockNowMs(void) {
+  return (uint64_t)((int64_t)uptimeMs() + (int64_t)gOffsetS.load(std::memory_order_relaxed) * 1000);
+}
+
+void epochClockSet(uint32_t seconds) {
+  gOffsetS.store((int32_t)(seconds - (uint32_t)(uptimeMs() / 1000)), std::memory_order_relaxed);
+  save(seconds);
+}
+
+bool epochClockAtLeast(uint32_t seconds) {
+  if ((int32_t)(epochClockNow() - seconds) >= 0) return false;
+  gOffsetS.store((int32_t)(seconds - (uint32_t)(uptimeMs() / 1000)), std::memory_order_relaxed);
+  return true;
+}
+
+bool epochClockSave(void) {
+  uint32_t now = epochClockNow();
+  if (now - gSavedS.load(std::memory_order_relaxed) < ROLLING_PERIOD_S) return false;
+  return save(now);
+}
+
+void epochClockEncode(uint32_t seconds, uint8_t out[EPOCH_CLOCK_LEN]) {
+  for (int i = 0; i < EPOCH_CLOCK_LEN; i++) out[i] = (uint8_t)(seconds >> (8 * i));
+}
+
+bool epochClockDecode(const uint8_t* data, size_t len, uint32_t* seconds) {
+  if (len != EPOCH_CLOCK_LEN) return false;
+  uint32_t s = 0;
+  for (int i = 0; i < EPOCH_CLOCK_LEN; i++) s |= (uint32_t)data[i] << (8 * i);
+  *seconds = s;
+  return true;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file epochClock.h
+ * @brief Shared time base of the rolling identifiers, kept across reboots.
+ *
+ * Neither board has a real-time clock or network time, so "seconds since
+ * the shared epoch" is a counter the devices agree on rather than wall-clock
+ * time. The counter runs from esp_timer while powered and is saved to NVS
+ * once per rolling window, so after a reset it continues from the last saved
+ * second instead of restarting at 0.
+ *
+ * The Tracker is the reference: it writes its counter to each tag's clock
+ * characteristic every time the tag's link becomes ready. A tag that was
+ * powered off for a long time advertises identifiers the Tracker no longer
+ * expects, but a bonded tag is still found by its resolvable private address
+ * and is re-synchronised on that link. A tag that was never linked is
+ * recognised only while both counters are within one window of each other,
+ * e.g. when both were first powered up together.
+ *
+ * @note This file is shared verbatim between the server (tag) and scanner
+ *       (tracker) sketches. Keep both copies in sync.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Length of the counter on the clock characteristic (little-endian seconds). */
+#define EPOCH_CLOCK_LEN 4
+
+/**
+ * @brief Restore the counter saved in NVS.
+ *
+ * @param[in] nvsName NVS namespace (at most 15 characters).
+ * @return False if nothing was saved yet; the counter then starts at 0.
+ */
+bool epochClockBegin(const char* nvsName);
+
+/**
+ * @brief Seconds since the shared epoch.
+ */
+uint32_t epochClockNow(void);
+
+/**
+ * @brief Milliseconds since the shared epoch.
+ */
+uint64_t epochClockNowMs(void);
+
+/**
+ * @brief Set the counter and save it (tag: written by the Tracker).
+ *
+ * @param[in] seconds Seconds since the shared epoch.
+ */
+void epochClockSet(uint32_t seconds);
+
+/**
+ * @brief Move the counter forward to at least `seconds`; never moves it back.
+ *
+ * @param[in] seconds Lower bound in seconds since the shared epoch.
+ * @return True if the counter was moved.
+ */
+bool epochClockAtLeast(uint32_t seconds);
+
+/**
+ * @brief Save the counter if it moved on by a rolling window since the last save.
+ *
+ * Call periodically from a task; it writes NVS at most once per window.
+ *
+ * @return True if the counter was written.
+ */
+bool epochClockSave(void);
+
+/**
+ * @brief Encode the counter for the clock characteristic.
+ *
+ * @param[in]  seconds Seconds since the shared epoch.
+ * @param[out] out     EPOCH_CLOCK_LEN bytes.
+ */
+void epochClockEncode(uint32_t seconds, uint8_t out[EPOCH_CLOCK_LEN]);
+
+/**
+ * @brief Decode a clock characteristic value.
+ *
+ * @param[in]  data    Value bytes.
+ * @param[in]  len     Value length.
+ * @param[out] seconds Decoded counter.
+ * @return False if the value is not EPOCH_CLOCK_LEN bytes long.
+ */
+bool epochClockDecode(const uint8_t* data, size_t len, uint32_t* seconds);
@@ -0,0 +1,132 @@
+/**
+ * @file eventBus.cpp
+ * @brief Topic fan-out and the per-subscriber rings.
+ *
+ * The rings follow the bounded MPMC queue by D. Vyukov, reduced to one
+ * consumer: a publisher claims a position by advancing `head` with a CAS
+ * once the slot's sequence shows it free, fills the slot, and publishes it
+ * by setting the sequence to `pos + 1`. The consumer releases the slot for
+ * the next lap by setting it to `pos + depth`.
+ */
+
+#include <string.h>
+#include "eventBus.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/** @brief Subscribers of each topic. */
+static BusSubscriber* gFanout[BUS_MAX_TOPICS][BUS_MAX_SUBSCRIBERS];
+
+/** @brief Number of subscribers of each topic. */
+static uint8_t gFanoutLen[BUS_MAX_TOPICS];
+
+// ============================================================================
+// Ring
+// ============================================================================
+
+/**
+ * @brief Copy an event into a subscriber's ring.
+ *
+ * @return False if the ring is full.
+ */
+static bool ringPush(BusSubscriber* s, uint8_t topic, const void* event, size_t len, uint32_t nowUs) {
+  const uint32_t mask = s->depth - 1;
+  uint32_t pos = s->head.load(std::memory_order_relaxed);
+  BusSlot* slot;
+  for (;;) {
+    slot = &s->slots[pos & mask];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (s->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      s->dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = s->head.load(std::memory_order_relaxed);
+    }
+  }
+  slot->msg.topic = topic;
+  slot->msg.len = (uint8_t)len;
+  slot->msg.timeUs = nowUs;
+  memcpy(slot->msg.data, event, len);
+  slot->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+// ============================================================================
+// Bus
+// ============================================================================
+
+bool busInit(BusSubscriber* const* subs, size_t count) {
+  memset(gFanoutLen, 0, sizeof(gFanoutLen));
+  if (count > BUS_MAX_SUBSCRIBERS) return false;
+  for (size_t i = 0; i < count; i++) {
+    BusSubscriber* s = subs[i];
+    if (s->depth == 0 || (s->depth & (s->depth - 1)) != 0) return false;
+    for (uint32_t p = 0; p < s->depth; p++) s->slots[p].seq.store(p, std::memory_order_relaxed);
+    s->head.store(0, std::memory_order_relaxed);
+    s->tail = 0;
+    s->dropped.store(0, std::memory_order_relaxed);
+    s->pending.store(false, std::memory_order_relaxed);
+    for (uint8_t t = 0; t < BUS_MAX_TOPICS; t++) {
+      if (s->topics & BUS_TOPIC(t)) gFanout[t][gFanoutLen[t]++] = s;
+    }
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  return true;
+}
+
+void busOnNotify(BusSubscriber* sub, BusNotify fn, void* ctx) {
+  sub->notifyCtx = ctx;
+  sub->notify = fn;
+}
+
+size_t busPublishRaw(uint8_t topic, const void* event, size_t len) {
+  if (topic >= BUS_MAX_TOPICS || len > BUS_EVENT_MAX) return 0;
+  uint32_t nowUs = busNowUs();
+  size_t delivered = 0;
+  for (uint8_t i = 0; i < gFanoutLen[topic]; i++) {
+    BusSubscriber* s = gFanout[topic][i];
+    if (!ringPush(s, topic, event, len, nowUs)) continue;
+    delivered++;
+    if (s->notify && !s->pending.exchange(true, std::memory_order_acq_rel)) {
+      s->notify(s, s->notifyCtx);
+    }
+  }
+  return delivered;
+}
+
+size_t busDrain(BusSubscriber* sub, BusHandler fn, void* ctx) {
+  const uint32_t mask = sub->depth - 1;
+  // Clear first: a publish racing with the drain notifies again. The
+  // exchange also makes every slot filled before the last notify visible.
+  sub->pending.exchange(false, std::memory_order_acq_rel);
+  size_t n = 0;
+  for (;;) {
+    BusSlot* slot = &sub->slots[sub->tail & mask];
+    if (slot->seq.load(std::memory_order_acquire) != sub->tail + 1) break;
+    fn(&slot->msg, ctx);
+    slot->seq.store(sub->tail + sub->depth, std::memory_order_release);
+    sub->tail++;
+    n++;
+  }
+  return n;
+}
+
+uint32_t busNowUs(void) {
+#ifdef ARDUINO
+  return (uint32_t)micros();
+#else
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
@@ -0,0 +1,157 @@
+/**
+ * @file eventBus.h
+ * @brief Typed publish/subscribe bus with a fixed ring per subscriber.
+ *
+ * A sketch declares its topics and subscribers in `topicTable.h`:
+ * - `TOPIC_TABLE(X)` rows `X(id, type)` bind each topic id to a POD event
+ *   type, so `busPublish<TOPIC_X>(event)` only compiles with the right type;
+ * - `SUBSCRIBER_TABLE(X)` rows `X(name, depth, topics)` give each consumer
+ *   a ring of `depth` slots (a power of two) and the mask of topics it takes.
+ *
+ * Publishing copies the event once into the ring of every subscriber of the
+ * topic; consumers are handed a pointer to the slot, so delivery makes no
+ * further copy. Rings are bounded multi-producer / single-consumer queues
+ * with a sequence number per slot: publishers take no lock and never block,
+ * and an event for a full ring is dropped and counted for that subscriber
+ * only, so a slow consumer cannot stall the others.
+ *
+ * A subscriber may register a notify hook, called by the publisher when the
+ * subscriber goes from idle to pending (e.g. to post a loop event or give a
+ * task notification); subscribers without one are polled.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <type_traits>
+
+/** @brief Largest event payload (bytes). */
+#define BUS_EVENT_MAX 16
+
+/** @brief Number of topics a bus can carry. */
+#define BUS_MAX_TOPICS 16
+
+/** @brief Number of subscribers a bus can serve. */
+#define BUS_MAX_SUBSCRIBERS 8
+
+/** @brief Subscription mask bit of a topic. */
+#define BUS_TOPIC(id) (1u << (id))
+
+/**
+ * @brief A delivered event.
+ */
+struct BusMsg {
+  uint8_t  topic;     /**< Topic id. */
+  uint8_t  len;       /**< Payload length. */
+  uint16_t reserved;
+  uint32_t timeUs;    /**< Publish time (microseconds, wraps). */
+  alignas(8) uint8_t data[BUS_EVENT_MAX]; /**< Event, as published. */
+};
+
+/**
+ * @brief One ring slot: the message and its sequence number.
+ *
+ * `seq == pos` means free for the publisher at position `pos`;
+ * `seq == pos + 1` means filled and ready for the consumer.
+ */
+struct BusSlot {
+  std::atomic<uint32_t> seq;  /**< Slot state, see above. */
+  BusMsg msg;                 /**< Event stored in place. */
+};
+
+struct BusSubscriber;
+
+/**
+ * @brief Notify hook, run in the publisher's context.
+ */
+typedef void (*BusNotify)(BusSubscriber* sub, void* ctx);
+
+/**
+ * @brief Message handler, run by the consumer.
+ *
+ * `msg` points into the ring and is valid until the handler returns.
+ */
+typedef void (*BusHandler)(const BusMsg* msg, void* ctx);
+
+/**
+ * @brief A subscriber and its ring. Placed by the caller (usually `static`).
+ */
+struct BusSubscriber {
+  const char* name;                  /**< Name, for reports. */
+  uint32_t    topics;                /**< Subscribed topics (BUS_TOPIC mask). */
+  BusSlot*    slots;                 /**< Ring storage. */
+  uint32_t    depth;                 /**< Ring slots, a power of two. */
+  std::atomic<uint32_t> head;        /**< Next position to publish to. */
+  uint32_t    tail;                  /**< Next position to consume (consumer only). */
+  std::atomic<uint32_t> dropped;     /**< Events lost on a full ring. */
+  std::atomic<bool>     pending;     /**< Notify hook fired and not yet drained. */
+  BusNotify   notify;                /**< Notify hook, or nullptr. */
+  void*       notifyCtx;             /**< Notify hook context. */
+};
+
+/**
+ * @brief Binds a topic id to its event type; specialised by `topicTable.h`.
+ */
+template <uint8_t Topic> struct BusTopic;
+
+/**
+ * @brief Reset the bus and attach subscribers.
+ *
+ * @param[in] subs  Subscribers (at most BUS_MAX_SUBSCRIBERS).
+ * @param[in] count Number of subscribers.
+ * @return False if there are too many subscribers or a depth is not a power of two.
+ */
+bool busInit(BusSubscriber* const* subs, size_t count);
+
+/**
+ * @brief Register a subscriber's notify hook (before publishing starts).
+ */
+void busOnNotify(BusSubscriber* sub, BusNotify fn, void* ctx);
+
+/**
+ * @brief Publish an untyped event; prefer `busPublish<Topic>()`.
+ *
+ * Safe from any task (not from ISRs when a notify hook may block).
+ *
+ * @return Number of subscribers that received it.
+ */
+size_t busPublishRaw(uint8_t topic, const void* event, size_t len);
+
+/**
+ * @brief Publish an event of the topic's declared type.
+ */
+template <uint8_t Topic>
+inline size_t busPublish(const typename BusTopic<Topic>::Type& event) {
+  typedef typename BusTopic<Topic>::Type T;
+  static_assert(Topic < BUS_MAX_TOPICS, "topic id out of range");
+  static_assert(sizeof(T) <= BUS_EVENT_MAX, "event exceeds BUS_EVENT_MAX");
+  static_assert(std::is_trivially_copyable<T>::value, "events must be POD");
+  return busPublishRaw(Topic, &event, sizeof(T));
+}
+
+/**
+ * @brief The event in a message if it belongs to `Topic`, else nullptr.
+ */
+template <uint8_t Topic>
+inline const typename BusTopic<Topic>::Type* busEvent(const BusMsg* msg) {
+  typedef typename BusTopic<Topic>::Type T;
+  return msg->topic == Topic ? reinterpret_cast<const T*>(msg->data) : nullptr;
+}
+
+/**
+ * @brief Hand every pending message of a subscriber to `fn`, oldest first.
+ *
+ * Call from the subscriber's single consumer only.
+ *
+ * @param[in,out] sub Subscriber.
+ * @param[in]     fn  Handler.
+ * @param[in]     ctx Handler context.
+ * @return Messages handled.
+ */
+size_t busDrain(BusSubscriber* sub, BusHandler fn, void* ctx);
+
+/**
+ * @brief Microsecond clock used to stamp messages.
+ */
+uint32_t busNowUs(void);
@@ -0,0 +1,288 @@
+/**
+ * @file eventLoop.cpp
+ * @brief Implementation of the timer wheel and event queue.
+ *
+ * `gNow` is the next tick (ms) still to be processed, so "now" is `gNow - 1`.
+ * A timer with expiry `e` lives at the lowest level `l` with
+ * `e - gNow < 64^(l+1)`, in slot `(e >> 6l) & 63`. Whenever the low `6l` bits of `gNow` are zero, the
+ * level-`l` slot for `gNow` is emptied and its timers are re-inserted, which
+ * moves them to lower levels. Slots are singly linked lists with a back
+ * pointer (`pprev`) per timer, so any timer can be unlinked in O(1).
+ */
+
+#include <atomic>
+#include <string.h>
+#include "eventLoop.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#else
+#include <mutex>
+#endif
+
+/** @brief Bits of the expiry time consumed per level. */
+#define WHEEL_BITS 6
+
+/** @brief Slots per level. */
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+
+/** @brief Largest delay representable by the wheel; longer ones are re-cascaded. */
+#define WHEEL_SPAN ((1u << (WHEEL_BITS * LOOP_WHEEL_LEVELS)) - 1)
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/** @brief Timer wheel, one list head per slot. */
+static LoopTimer* gWheel[LOOP_WHEEL_LEVELS][WHEEL_SLOTS];
+
+/** @brief Next tick to process; the current time is `gNow - 1`. */
+static uint32_t gNow = 0;
+
+/**
+ * @brief Registered event handler.
+ */
+struct Handler {
+  LoopEventFn fn;   /**< Callback, nullptr if none. */
+  void*       ctx;  /**< Callback context. */
+};
+
+/** @brief Handlers indexed by event type. */
+static Handler gHandlers[LOOP_EVENT_TYPES];
+
+/** @brief Events dropped on a full queue. */
+static std::atomic<uint32_t> gDropped{ 0 };
+
+#ifdef ARDUINO
+
+/** @brief Queue control block. */
+static StaticQueue_t gQueueCb;
+
+/** @brief Queue storage. */
+static uint8_t gQueueStorage[LOOP_QUEUE_LEN * sizeof(LoopEvent)];
+
+/** @brief Event queue, fed from tasks and ISRs. */
+static QueueHandle_t gQueue = nullptr;
+
+#else
+
+/** @brief Host event ring. */
+static LoopEvent gRing[LOOP_QUEUE_LEN];
+
+/** @brief Ring read and write counters. */
+static uint32_t gHead = 0, gTail = 0;
+
+/** @brief Serialises host posters with the loop. */
+static std::mutex gRingLock;
+
+#endif
+
+// ============================================================================
+// Wheel
+// ============================================================================
+
+/**
+ * @brief Link a timer into the slot matching its expiry.
+ */
+static void wheelInsert(LoopTimer* t) {
+  if ((int32_t)(t->expires - gNow) < 0) t->expires = gNow;
+  uint32_t delta = t->expires - gNow;
+  uint32_t e = delta > WHEEL_SPAN ? gNow + WHEEL_SPAN : t->expires;
+  if (delta > WHEEL_SPAN) delta = WHEEL_SPAN;
+
+  int level = 0;
+  while (level < LOOP_WHEEL_LEVELS - 1 && delta >= (1u << (WHEEL_BITS * (level + 1)))) level++;
+  LoopTimer** head = &gWheel[level][(e >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+
+  t->next = *head;
+  if (t->next) t->next->pprev = &t->next;
+  t->pprev = head;
+  *head = t;
+}
+
+/**
+ * @brief Unlink a timer from whatever list it is on.
+ */
+static void wheelUnlink(LoopTimer* t) {
+  if (!t->pprev) return;
+  *t->pprev = t->next;
+  if (t->next) t->next->pprev = t->pprev;
+  t->next = nullptr;
+  t->pprev = nullptr;
+}
+
+/**
+ * @brief Re-insert every timer of one slot (moves them to lower levels).
+ */
+static void cascade(int level) {
+  LoopTimer** head = &gWheel[level][(gNow >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+  LoopTimer* t = *head;
+  *head = nullptr;
+  while (t) {
+    LoopTimer* next = t->next;
+    t->next = nullptr;
+    t->pprev = nullptr;
+    wheelInsert(t);
+    t = next;
+  }
+}
+
+/**
+ * @brief Process tick `gNow`: cascade, fire the level-0 slot, advance `gNow`.
+ *
+ * `gNow` is advanced before the callbacks run, so timers they start are
+ * measured from the tick being processed and never land in the slot that is
+ * currently firing.
+ */
+static void runTick() {
+  // Cascade from the highest level whose boundary this tick crosses
+  int top = 0;
+  while (top < LOOP_WHEEL_LEVELS - 1 && (gNow & ((1u << (WHEEL_BITS * (top + 1))) - 1)) == 0) top++;
+  for (int level = top; level >= 1; level--) cascade(level);
+
+  // Move the due slot onto a local list so callbacks may freely re-arm timers
+  LoopTimer* due = gWheel[0][gNow & (WHEEL_SLOTS - 1)];
+  gWheel[0][gNow & (WHEEL_SLOTS - 1)] = nullptr;
+  if (due) due->pprev = &due;
+  gNow++;
+
+  while (due) {
+    LoopTimer* t = due;
+    wheelUnlink(t);
+    if (t->period) {
+      t->expires += t->period;
+      wheelInsert(t);
+    }
+    t->fn(t, t->ctx);
+  }
+}
+
+/**
+ * @brief Milliseconds until the loop next has work: a due level-0 slot or a
+ *        level boundary at which pending higher-level timers cascade.
+ */
+static uint32_t nextDue() {
+  bool higher = false;
+  for (int level = 1; level < LOOP_WHEEL_LEVELS && !higher; level++) {
+    for (uint32_t s = 0; s < WHEEL_SLOTS && !higher; s++) higher = gWheel[level][s] != nullptr;
+  }
+  for (uint32_t i = 0; i < WHEEL_SLOTS; i++) {
+    uint32_t tick = gNow + i;
+    if (gWheel[0][tick & (WHEEL_SLOTS - 1)]) return i + 1;
+    if (higher && (tick & (WHEEL_SLOTS - 1)) == 0) return i + 1;
+  }
+  return LOOP_NO_TIMER;
+}
+
+// ============================================================================
+// Events
+// ============================================================================
+
+/**
+ * @brief Take one queued event without blocking.
+ */
+static bool takeEvent(LoopEvent* e) {
+#ifdef ARDUINO
+  return xQueueReceive(gQueue, e, 0) == pdTRUE;
+#else
+  std::lock_guard<std::mutex> guard(gRingLock);
+  if (gHead == gTail) return false;
+  *e = gRing[gHead++ % LOOP_QUEUE_LEN];
+  return true;
+#endif
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void eventLoopInit(uint32_t nowMs) {
+  memset(gWheel, 0, sizeof(gWheel));
+  memset(gHandlers, 0, sizeof(gHandlers));
+  gNow = nowMs + 1;
+  gDropped.store(0, std::memory_order_relaxed);
+#ifdef ARDUINO
+  if (!gQueue) gQueue = xQueueCreateStatic(LOOP_QUEUE_LEN, sizeof(LoopEvent), gQueueStorage, &gQueueCb);
+  xQueueReset(gQueue);
+#else
+  gHead = gTail = 0;
+#endif
+}
+
+void loopTimerStart(LoopTimer* timer, uint32_t delayMs, uint32_t periodMs, LoopTimerFn fn, void* ctx) {
+  wheelUnlink(timer);
+  timer->expires = gNow - 1 + delayMs;
+  timer->period = periodMs;
+  timer->fn = fn;
+  timer->ctx = ctx;
+  wheelInsert(timer);
+}
+
+void loopTimerStop(LoopTimer* timer) {
+  wheelUnlink(timer);
+}
+
+bool loopTimerActive(const LoopTimer* timer) {
+  return timer->pprev != nullptr;
+}
+
+void eventLoopOn(uint8_t type, LoopEventFn fn, void* ctx) {
+  if (type >= LOOP_EVENT_TYPES) return;
+  gHandlers[type].fn = fn;
+  gHandlers[type].ctx = ctx;
+}
+
+bool eventLoopPost(const LoopEvent* event) {
+#ifdef ARDUINO
+  if (gQueue && xQueueSend(gQueue, event, 0) == pdTRUE) return true;
+#else
+  std::lock_guard<std::mutex> guard(gRingLock);
+  if (gTail - gHead < LOOP_QUEUE_LEN) {
+    gRing[gTail++ % LOOP_QUEUE_LEN] = *event;
+    return true;
+  }
+#endif
+  gDropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool eventLoopPostFromISR(const LoopEvent* event, int* woken) {
+#ifdef ARDUINO
+  BaseType_t w = pdFALSE;
+  bool ok = gQueue && xQueueSendFromISR(gQueue, event, &w) == pdTRUE;
+  if (!ok) gDropped.fetch_add(1, std::memory_order_relaxed);
+  if (woken) *woken = w;
+  return ok;
+#else
+  if (woken) *woken = 0;
+  return eventLoopPost(event);
+#endif
+}
+
+uint32_t eventLoopAdvance(uint32_t nowMs) {
+  LoopEvent e;
+  while (takeEvent(&e)) {
+    if (e.type < LOOP_EVENT_TYPES && gHandlers[e.type].fn) {
+      gHandlers[e.type].fn(&e, gHandlers[e.type].ctx);
+    }
+  }
+  while ((int32_t)(nowMs - gNow) >= 0) runTick();
+  return nextDue();
+}
+
+uint32_t eventLoopDropped(void) {
+  return gDropped.load(std::memory_order_relaxed);
+}
+
+#ifdef ARDUINO
+void eventLoopRun(void) {
+  for (;;) {
+    uint32_t wait = eventLoopAdvance(millis());
+    LoopEvent e;
+    // Peek so the event is dispatched by the next advance, in order
+    xQueuePeek(gQueue, &e, wait == LOOP_NO_TIMER ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+  }
+}
+#endif
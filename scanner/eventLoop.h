@@ -0,0 +1,141 @@
+/**
+ * @file eventLoop.h
+ * @brief Single-task executor with a hierarchical timer wheel and an event queue.
+ *
+ * Lightweight periodic activities (button polling, UI refresh, RFID checks)
+ * run as timer callbacks on one task instead of each owning a task and a
+ * stack. Other tasks and ISRs hand work to the loop by posting small events.
+ *
+ * Timers live in a hashed, hierarchical wheel of LOOP_WHEEL_LEVELS levels of
+ * 64 slots with 1 ms resolution: level 0 covers the next 64 ms, level 1 the
+ * next 4 s, and so on; timers cascade down a level as their expiry nears.
+ * Starting, stopping and firing a timer are O(1).
+ *
+ * Time is passed in explicitly, so the loop runs on the host against a
+ * virtual clock; on the device `eventLoopRun()` drives it from `millis()`.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Number of wheel levels (6 bits of the expiry time each). */
+#define LOOP_WHEEL_LEVELS 5
+
+/** @brief Capacity of the event queue. */
+#ifndef LOOP_QUEUE_LEN
+#define LOOP_QUEUE_LEN 16
+#endif
+
+/** @brief Number of distinct event types that can have a handler. */
+#define LOOP_EVENT_TYPES 16
+
+/** @brief Returned by `eventLoopAdvance` when no timer is pending. */
+#define LOOP_NO_TIMER UINT32_MAX
+
+struct LoopTimer;
+
+/**
+ * @brief Timer callback, run on the loop task.
+ *
+ * The callback may start or stop any timer, including its own.
+ */
+typedef void (*LoopTimerFn)(LoopTimer* timer, void* ctx);
+
+/**
+ * @brief A timer. Owned and placed by the caller (usually `static`).
+ */
+struct LoopTimer {
+  LoopTimer*  next;      /**< Next timer in the slot. */
+  LoopTimer** pprev;     /**< Link pointing at this timer, nullptr if idle. */
+  uint32_t    expires;   /**< Expiry time in ms. */
+  uint32_t    period;    /**< Reload period in ms, 0 for one-shot. */
+  LoopTimerFn fn;        /**< Callback. */
+  void*       ctx;       /**< Callback context. */
+};
+
+/**
+ * @brief A small event passed to the loop by value.
+ */
+struct LoopEvent {
+  uint8_t  type;    /**< Event type, < LOOP_EVENT_TYPES. */
+  uint8_t  arg;     /**< Type-specific small argument. */
+  uint16_t reserved;
+  uint32_t value;   /**< Type-specific value. */
+  uint32_t timeUs;  /**< Time the event was raised, in microseconds. */
+};
+
+/**
+ * @brief Event handler, run on the loop task.
+ */
+typedef void (*LoopEventFn)(const LoopEvent* event, void* ctx);
+
+/**
+ * @brief Reset the loop: clear all timers, handlers and queued events.
+ *
+ * @param[in] nowMs Current time.
+ */
+void eventLoopInit(uint32_t nowMs);
+
+/**
+ * @brief Start (or restart) a timer.
+ *
+ * @param[in,out] timer    Timer storage.
+ * @param[in]     delayMs  Time until the first expiry (0 fires on the next tick).
+ * @param[in]     periodMs Reload period, 0 for a one-shot timer.
+ * @param[in]     fn       Callback.
+ * @param[in]     ctx      Callback context.
+ */
+void loopTimerStart(LoopTimer* timer, uint32_t delayMs, uint32_t periodMs, LoopTimerFn fn, void* ctx);
+
+/**
+ * @brief Stop a timer. Stopping an idle timer is harmless.
+ */
+void loopTimerStop(LoopTimer* timer);
+
+/**
+ * @brief Check whether a timer is pending.
+ */
+bool loopTimerActive(const LoopTimer* timer);
+
+/**
+ * @brief Register the handler for an event type (replaces any previous one).
+ */
+void eventLoopOn(uint8_t type, LoopEventFn fn, void* ctx);
+
+/**
+ * @brief Queue an event from task context.
+ *
+ * @return False if the queue is full and the event was dropped.
+ */
+bool eventLoopPost(const LoopEvent* event);
+
+/**
+ * @brief Queue an event from an interrupt handler (device only).
+ *
+ * @param[in]  event Event.
+ * @param[out] woken Set if a higher priority task was woken (may be nullptr).
+ * @return False if the queue is full and the event was dropped.
+ */
+bool eventLoopPostFromISR(const LoopEvent* event, int* woken);
+
+/**
+ * @brief Dispatch queued events, then run every timer due at or before `nowMs`.
+ *
+ * @param[in] nowMs Current time.
+ * @return Milliseconds until the next timer may be due (a lower bound when
+ *         it lies beyond level 0), or LOOP_NO_TIMER.
+ */
+uint32_t eventLoopAdvance(uint32_t nowMs);
+
+/**
+ * @brief Number of events dropped because the queue was full.
+ */
+uint32_t eventLoopDropped(void);
+
+/**
+ * @brief Run the loop forever on the calling task (device only).
+ *
+ * Sleeps on the event queue until the next timer is due or an event arrives.
+ */
+void eventLoopRun(void);
@@ -0,0 +1,124 @@
+/**
+ * @file exportFrame.cpp
+ * @brief Implementation of COBS framing and CRC-32 for the export protocol.
+ */
+
+#include <string.h>
+#include "exportFrame.h"
+
+// ============================================================================
+// CRC-32
+// ============================================================================
+
+/**
+ * @brief Lazily built lookup table for the reflected 0xEDB88320 polynomial.
+ */
+static const uint32_t* crcTable() {
+  static uint32_t table[256];
+  static bool built = false;
+  if (!built) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+      table[i] = c;
+    }
+    built = true;
+  }
+  return table;
+}
+
+uint32_t crc32Update(const uint8_t* data, size_t len, uint32_t crc) {
+  const uint32_t* table = crcTable();
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// ============================================================================
+// COBS
+// ============================================================================
+
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t codePos = 0;
+  size_t o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[codePos] = code;
+      codePos = o++;
+      code = 1;
+    } else {
+      out[o++] = in[i];
+      if (++code == 0xFF) {
+        out[codePos] = code;
+        codePos = o++;
+        code = 1;
+      }
+    }
+  }
+  out[codePos] = code;
+  return o;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t i = 0, o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) return 0;
+    for (uint8_t k = 1; k < code; k++) out[o++] = in[i++];
+    if (code != 0xFF && i < len) out[o++] = 0;
+  }
+  return o;
+}
+
+// ============================================================================
+// Frames
+// ============================================================================
+
+void putLe(uint8_t* p, uint64_t v, int n) {
+  for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+uint64_t getLe(const uint8_t* p, int n) {
+  uint64_t v = 0;
+  for (int i = n - 1; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+size_t frameBuild(uint8_t type, const uint8_t* body, size_t bodyLen, uint8_t* out) {
+  uint8_t raw[FRAME_MAX_PAYLOAD];
+  if (1 + bodyLen + 4 > FRAME_MAX_PAYLOAD) return 0;
+  raw[0] = type;
+  if (bodyLen) memcpy(&raw[1], body, bodyLen);
+  putLe(&raw[1 + bodyLen], crc32Update(raw, 1 + bodyLen, 0), 4);
+  size_t n = cobsEncode(raw, 1 + bodyLen + 4, out);
+  out[n++] = FRAME_DELIM;
+  return n;
+}
+
+void frameDecoderReset(FrameDecoder* d) {
+  d->len = 0;
+  d->overflow = false;
+}
+
+bool frameDecoderPush(FrameDecoder* d, uint8_t byte, uint8_t payload[FRAME_MAX_PAYLOAD], size_t* len) {
+  if (byte != FRAME_DELIM) {
+    if (d->len < sizeof(d->buf)) d->buf[d->len++] = byte;
+    else d->overflow = true;
+    return false;
+  }
+
+  bool ok = false;
+  if (!d->overflow && d->len > 0) {
+    uint8_t raw[sizeof(d->buf)];
+    size_t n = cobsDecode(d->buf, d->len, raw);
+    if (n >= 5 && n <= FRAME_MAX_PAYLOAD &&
+        crc32Update(raw, n - 4, 0) == (uint32_t)getLe(&raw[n - 4], 4)) {
+      memcpy(payload, raw, n - 4);
+      *len = n - 4;
+      ok = true;
+    }
+  }
+  frameDecoderReset(d);
+  return ok;
+}
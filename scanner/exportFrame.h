@@ -0,0 +1,133 @@
+/**
+ * @file exportFrame.h
+ * @brief COBS/CRC32 framing and message layout of the history export protocol.
+ *
+ * Every message is `type | body | crc32` (CRC little-endian, over type and
+ * body), COBS-encoded and terminated by a single 0x00 byte. COBS guarantees
+ * the payload contains no zero bytes, so a receiver can always resynchronise
+ * on the next delimiter after corruption or interleaved log text.
+ *
+ * Messages (all integers little-endian):
+ * - `EXPORT_REQ`  host -> tracker: tag u8, fromMs u64, toMs u64, startChunk u32
+ * - `EXPORT_ACK`  host -> tracker: nextChunk u32 (all earlier chunks received)
+ * - `EXPORT_ABORT` host -> tracker: no body
+ * - `EXPORT_DATA` tracker -> host: chunk u32, count u8, then `count` records of
+ *                 tsMs u64, distance f32, moving u8
+ * - `EXPORT_END`  tracker -> host: chunks u32, samples u32
+ * - `CONFIG_GET`  host -> tracker: no body
+ * - `CONFIG_SET`  host -> tracker: "key=value" text
+ * - `CONFIG_STATE` tracker -> host: status u8 (ConfigStatus of the last
+ *                 set, 0 for a get), then the configuration as "key=value"
+ *                 lines
+ *
+ * This header is shared with the host receiver in `host/`.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Frame delimiter. */
+#define FRAME_DELIM 0x00
+
+/** @brief Largest unencoded message (type + body + CRC). */
+#define FRAME_MAX_PAYLOAD 600
+
+/** @brief Worst-case COBS-encoded size of a payload of `n` bytes, delimiter included. */
+#define FRAME_ENCODED_MAX(n) ((n) + ((n) / 254) + 2)
+
+/** @brief Size of one exported record on the wire. */
+#define EXPORT_RECORD_LEN 13
+
+/** @brief Records per DATA chunk. */
+#define EXPORT_RECORDS_PER_CHUNK 40
+
+/**
+ * @brief Export message types.
+ */
+enum ExportMsg : uint8_t {
+  EXPORT_REQ   = 0x01,
+  EXPORT_ACK   = 0x02,
+  EXPORT_ABORT = 0x03,
+  CONFIG_GET   = 0x04,
+  CONFIG_SET   = 0x05,
+  EXPORT_DATA  = 0x81,
+  EXPORT_END   = 0x82,
+  CONFIG_STATE = 0x83,
+};
+
+/**
+ * @brief Incremental frame decoder state.
+ */
+struct FrameDecoder {
+  uint8_t buf[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)]; /**< Encoded bytes of the current frame. */
+  size_t  len;                                       /**< Bytes buffered so far. */
+  bool    overflow;                                  /**< Current frame exceeded the buffer. */
+};
+
+/**
+ * @brief Compute the CRC-32 (IEEE 802.3, reflected) of a buffer.
+ *
+ * @param[in] data Bytes to checksum.
+ * @param[in] len  Number of bytes.
+ * @param[in] crc  Running CRC from a previous call, or 0 to start.
+ * @return Updated CRC.
+ */
+uint32_t crc32Update(const uint8_t* data, size_t len, uint32_t crc);
+
+/**
+ * @brief COBS-encode a buffer (no delimiter appended).
+ *
+ * @param[in]  in  Input bytes.
+ * @param[in]  len Input length.
+ * @param[out] out Output buffer of at least FRAME_ENCODED_MAX(len) bytes.
+ * @return Encoded length.
+ */
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out);
+
+/**
+ * @brief COBS-decode a buffer (delimiter excluded).
+ *
+ * @param[in]  in  Encoded bytes.
+ * @param[in]  len Encoded length.
+ * @param[out] out Output buffer of at least `len` bytes.
+ * @return Decoded length, or 0 if the encoding is malformed.
+ */
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out);
+
+/**
+ * @brief Build a complete wire frame: append CRC, COBS-encode, add delimiter.
+ *
+ * @param[in]  type    Message type.
+ * @param[in]  body    Message body.
+ * @param[in]  bodyLen Body length (type + body + 4 must fit FRAME_MAX_PAYLOAD).
+ * @param[out] out     Output buffer of FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD) bytes.
+ * @return Frame length on the wire, or 0 if the body is too long.
+ */
+size_t frameBuild(uint8_t type, const uint8_t* body, size_t bodyLen, uint8_t* out);
+
+/**
+ * @brief Reset a frame decoder.
+ */
+void frameDecoderReset(FrameDecoder* d);
+
+/**
+ * @brief Feed one received byte into the decoder.
+ *
+ * @param[in,out] d       Decoder state.
+ * @param[in]     byte    Received byte.
+ * @param[out]    payload Decoded, CRC-checked `type | body` on completion.
+ * @param[out]    len     Length of `payload` (CRC stripped).
+ * @return True when a valid frame has been completed.
+ */
+bool frameDecoderPush(FrameDecoder* d, uint8_t byte, uint8_t payload[FRAME_MAX_PAYLOAD], size_t* len);
+
+/**
+ * @brief Store a little-endian integer of `n` bytes.
+ */
+void putLe(uint8_t* p, uint64_t v, int n);
+
+/**
+ * @brief Load a little-endian integer of `n` bytes.
+ */
+uint64_t getLe(const uint8_t* p, int n);
@@ -0,0 +1,159 @@
+/**
+ * @file heapTelemetry.cpp
+ * @brief Implementation of heap snapshots and the per-point growth check.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "heapTelemetry.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_heap_caps.h"
+#endif
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/**
+ * @brief Snapshot history of one lifecycle point.
+ */
+struct PointHistory {
+  HeapSnapshot last;                       /**< Most recent snapshot. */
+  uint32_t     used[HEAP_TREND_WINDOW];    /**< Allocated bytes, ring. */
+  uint32_t     count;                      /**< Snapshots taken. */
+};
+
+/** @brief History per lifecycle point. */
+static PointHistory gPoints[HEAP_POINT_COUNT];
+
+/** @brief Active heap reader. */
+static HeapReader gReader = nullptr;
+
+/** @brief Printable point names, indexed by HeapPoint. */
+static const char* const POINT_NAMES[HEAP_POINT_COUNT] = {
+  "boot", "scan-start", "scan-stop", "connect", "disconnect"
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#ifdef ARDUINO
+/**
+ * @brief Read the default-capability heap of the ESP32.
+ */
+static void platformReader(HeapSnapshot* out) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  out->ms = millis();
+  out->freeBytes = (uint32_t)info.total_free_bytes;
+  out->largestBlock = (uint32_t)info.largest_free_block;
+  out->minFree = (uint32_t)info.minimum_free_bytes;
+  out->usedBytes = (uint32_t)info.total_allocated_bytes;
+  out->allocBlocks = (uint32_t)info.allocated_blocks;
+}
+#endif
+
+/**
+ * @brief Store a little-endian 32-bit value.
+ */
+static void put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Growth check over the window of one point.
+ */
+static bool isGrowing(const PointHistory& h) {
+  if (h.count < HEAP_TREND_WINDOW) return false;
+  uint32_t oldest = h.count % HEAP_TREND_WINDOW;
+  uint32_t prev = h.used[oldest];
+  uint32_t rises = 0;
+  for (uint32_t i = 1; i < HEAP_TREND_WINDOW; i++) {
+    uint32_t v = h.used[(oldest + i) % HEAP_TREND_WINDOW];
+    if (v < prev) return false;
+    if (v > prev) rises++;
+    prev = v;
+  }
+  // A one-off allocation (e.g. the first BLE client) rises once; a leak
+  // rises on most cycles
+  return rises >= HEAP_TREND_WINDOW / 2 && prev - h.used[oldest] > HEAP_TREND_SLACK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void heapTelemetryInit(HeapReader reader) {
+  memset(gPoints, 0, sizeof(gPoints));
+#ifdef ARDUINO
+  gReader = reader ? reader : platformReader;
+#else
+  gReader = reader;
+#endif
+}
+
+const HeapSnapshot* heapTelemetrySnapshot(HeapPoint point) {
+  if (point >= HEAP_POINT_COUNT || !gReader) return nullptr;
+  PointHistory& h = gPoints[point];
+  HeapSnapshot s;
+  memset(&s, 0, sizeof(s));
+  gReader(&s);
+  s.point = point;
+
+  h.used[h.count % HEAP_TREND_WINDOW] = s.usedBytes;
+  h.count++;
+  s.growing = isGrowing(h);
+  h.last = s;
+  return &h.last;
+}
+
+const HeapSnapshot* heapTelemetryLast(HeapPoint point) {
+  if (point >= HEAP_POINT_COUNT || gPoints[point].count == 0) return nullptr;
+  return &gPoints[point].last;
+}
+
+bool heapTelemetryLeakSuspected(void) {
+  for (int p = 0; p < HEAP_POINT_COUNT; p++) {
+    if (gPoints[p].count && gPoints[p].last.growing) return true;
+  }
+  return false;
+}
+
+const char* heapPointName(uint8_t point) {
+  return point < HEAP_POINT_COUNT ? POINT_NAMES[point] : "?";
+}
+
+int heapTelemetryFormat(const HeapSnapshot* s, char* buf, size_t size) {
+  unsigned frag = s->freeBytes ? 100 - (unsigned)((uint64_t)s->largestBlock * 100 / s->freeBytes) : 0;
+  return snprintf(buf, size, "HEAP %-10s t=%lu free=%lu largest=%lu frag=%u%% min=%lu used=%lu blocks=%lu%s",
+                  heapPointName(s->point), (unsigned long)s->ms, (unsigned long)s->freeBytes,
+                  (unsigned long)s->largestBlock, frag, (unsigned long)s->minFree,
+                  (unsigned long)s->usedBytes, (unsigned long)s->allocBlocks,
+                  s->growing ? " LEAK?" : "");
+}
+
+size_t heapTelemetryEncode(uint8_t* out) {
+  size_t len = 0;
+  for (int p = 0; p < HEAP_POINT_COUNT; p++) {
+    if (gPoints[p].count == 0) continue;
+    const HeapSnapshot& s = gPoints[p].last;
+    uint8_t* r = out + len;
+    r[0] = s.point;
+    r[1] = s.growing ? 1 : 0;
+    r[2] = r[3] = 0;
+    put32(r + 4, s.ms);
+    put32(r + 8, s.freeBytes);
+    put32(r + 12, s.largestBlock);
+    put32(r + 16, s.minFree);
+    put32(r + 20, s.usedBytes);
+    put32(r + 24, s.allocBlocks);
+    len += HEAP_RECORD_LEN;
+  }
+  return len;
+}
@@ -0,0 +1,600 @@
+/**
+ * @file history.cpp
+ * @brief Implementation of the compressed history store.
+ *
+ * Block layout (HISTORY_BLOCK_SIZE bytes):
+ *
+ *     +--------------+------------------------------+ ... +----------------+
+ *     | BlockHeader  | bit stream (time, distance)  | --> | <-- runs[]     |
+ *     +--------------+------------------------------+ ... +----------------+
+ *
+ * Bit stream, per sample:
+ * - timestamp delta-of-delta \f$D\f$:
+ *   `0` if \f$D = 0\f$; `10`+7 bits, `110`+9 bits, `1110`+12 bits for
+ *   increasingly wide biased ranges; otherwise `1111`+32 bits.
+ * - distance XOR against the previous value's IEEE-754 bits:
+ *   `0` if identical; `10` + the meaningful bits when they fit the previous
+ *   leading/trailing-zero window; otherwise `11` + 5-bit leading zero count +
+ *   5-bit (length - 1) + meaningful bits.
+ *
+ * Movement runs are 16-bit words (bit 15 = state, bits 0..14 = run length)
+ * stored from the end of the block towards the bit stream.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "history.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#else
+#include <mutex>
+#endif
+
+// ============================================================================
+// Layout
+// ============================================================================
+
+/** @brief Block header magic ("HST1"). */
+#define HISTORY_MAGIC 0x31545348UL
+
+/** @brief Upper bound on ring slots tracked by the RAM index. */
+#ifndef HISTORY_MAX_SLOTS
+#define HISTORY_MAX_SLOTS 512
+#endif
+
+/** @brief Worst-case encoded size of one sample in bits (36 time + 44 value). */
+#define SAMPLE_MAX_BITS 80
+
+/** @brief Longest movement run representable in one run word. */
+#define RUN_MAX 0x7FFF
+
+/**
+ * @brief Header at the start of every block.
+ */
+struct BlockHeader {
+  uint32_t magic;     /**< HISTORY_MAGIC when the block is valid. */
+  uint32_t seq;       /**< Global write sequence number (ring order). */
+  uint64_t firstTs;   /**< Timestamp of the first sample (ms). */
+  uint32_t spanMs;    /**< Last timestamp minus first timestamp. */
+  uint16_t count;     /**< Number of samples in the block. */
+  uint16_t bitLen;    /**< Bits used in the stream. */
+  uint16_t runCount;  /**< Number of movement runs. */
+  uint8_t  tag;       /**< Tag the block belongs to. */
+  uint8_t  pad[5];    /**< Reserved, zero. */
+};
+
+static_assert(sizeof(BlockHeader) == 32, "BlockHeader layout must stay stable on flash");
+
+/** @brief Byte capacity shared by the bit stream and the run words. */
+#define BLOCK_PAYLOAD (HISTORY_BLOCK_SIZE - sizeof(BlockHeader))
+
+/**
+ * @brief Encoder state of a tag's open block.
+ */
+struct OpenBlock {
+  uint8_t  buf[HISTORY_BLOCK_SIZE]; /**< Block image, header included. */
+  bool     active;                  /**< True once the first sample is stored. */
+  uint64_t prevTs;                  /**< Previous timestamp. */
+  int64_t  prevDelta;               /**< Previous timestamp delta. */
+  uint32_t prevBits;                /**< Previous distance bit pattern. */
+  uint8_t  prevLead;                /**< Leading zeros of the stored XOR window. */
+  uint8_t  prevTrail;               /**< Trailing zeros of the stored XOR window. */
+};
+
+/**
+ * @brief RAM index entry for one sealed ring slot.
+ */
+struct SlotIndex {
+  uint32_t seq;      /**< Sequence number, 0 when the slot is empty. */
+  uint8_t  tag;      /**< Tag of the block. */
+  uint64_t firstTs;  /**< First timestamp in the block. */
+  uint64_t lastTs;   /**< Last timestamp in the block. */
+};
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/** @brief Open blocks, one per tag. */
+static OpenBlock gOpen[HISTORY_MAX_TAGS];
+
+/** @brief Block-level time index of the flash ring. */
+static SlotIndex gIndex[HISTORY_MAX_SLOTS];
+
+/** @brief Number of slots in the ring. */
+static uint32_t gSlots = 0;
+
+/** @brief Next slot to be written. */
+static uint32_t gNextSlot = 0;
+
+/** @brief Next sequence number. */
+static uint32_t gSeq = 1;
+
+/** @brief Last timestamp sealed per tag. */
+static uint64_t gSealedTs[HISTORY_MAX_TAGS];
+
+/** @brief Scratch buffer for reading sealed blocks. */
+static uint8_t gScratch[HISTORY_BLOCK_SIZE];
+
+/** @brief Store statistics. */
+static HistoryStats gStats = { 0, 0, 0, 0 };
+
+// ============================================================================
+// Flash Ring Backend
+// ============================================================================
+
+#ifdef ARDUINO
+/** @brief The `history` data partition. */
+static const esp_partition_t* gPart = nullptr;
+
+/** @brief Mutex serialising appends and queries. */
+static SemaphoreHandle_t gLock = nullptr;
+
+static void lock()   { xSemaphoreTake(gLock, portMAX_DELAY); }
+static void unlock() { xSemaphoreGive(gLock); }
+
+static bool flashOpen() {
+  if (!gLock) gLock = xSemaphoreCreateMutex();
+  gPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "history");
+  if (!gPart) return false;
+  gSlots = gPart->size / HISTORY_BLOCK_SIZE;
+  if (gSlots > HISTORY_MAX_SLOTS) gSlots = HISTORY_MAX_SLOTS;
+  return true;
+}
+
+static void flashRead(uint32_t slot, size_t len, uint8_t* out) {
+  esp_partition_read(gPart, slot * HISTORY_BLOCK_SIZE, out, len);
+}
+
+static void flashWrite(uint32_t slot, const uint8_t* data) {
+  esp_partition_erase_range(gPart, slot * HISTORY_BLOCK_SIZE, HISTORY_BLOCK_SIZE);
+  esp_partition_write(gPart, slot * HISTORY_BLOCK_SIZE, data, HISTORY_BLOCK_SIZE);
+}
+#else
+/** @brief RAM stand-in for the flash partition on host builds. */
+static uint8_t gFlash[HISTORY_HOST_SLOTS * HISTORY_BLOCK_SIZE];
+
+/** @brief Mutex serialising appends and queries. */
+static std::mutex gLock;
+
+static void lock()   { gLock.lock(); }
+static void unlock() { gLock.unlock(); }
+
+static bool flashOpen() {
+  gSlots = HISTORY_HOST_SLOTS < HISTORY_MAX_SLOTS ? HISTORY_HOST_SLOTS : HISTORY_MAX_SLOTS;
+  return true;
+}
+
+static void flashRead(uint32_t slot, size_t len, uint8_t* out) {
+  memcpy(out, &gFlash[slot * HISTORY_BLOCK_SIZE], len);
+}
+
+static void flashWrite(uint32_t slot, const uint8_t* data) {
+  memcpy(&gFlash[slot * HISTORY_BLOCK_SIZE], data, HISTORY_BLOCK_SIZE);
+}
+#endif
+
+// ============================================================================
+// Bit Stream
+// ============================================================================
+
+/**
+ * @brief Append up to 32 bits, most significant first.
+ *
+ * @param[in,out] stream Stream bytes (must be zero-initialised).
+ * @param[in,out] pos    Bit position, advanced by `n`.
+ * @param[in]     value  Bits to write (low `n` bits used).
+ * @param[in]     n      Number of bits (0..32).
+ */
+static void writeBits(uint8_t* stream, uint32_t* pos, uint32_t value, int n) {
+  while (n > 0) {
+    int room = 8 - (int)(*pos & 7);
+    int take = n < room ? n : room;
+    uint32_t chunk = (value >> (n - take)) & ((1u << take) - 1);
+    stream[*pos >> 3] |= (uint8_t)(chunk << (room - take));
+    *pos += take;
+    n -= take;
+  }
+}
+
+/**
+ * @brief Read up to 32 bits, most significant first.
+ *
+ * @param[in]     stream Stream bytes.
+ * @param[in,out] pos    Bit position, advanced by `n`.
+ * @param[in]     n      Number of bits (0..32).
+ * @return Bits read, right-aligned.
+ */
+static uint32_t readBits(const uint8_t* stream, uint32_t* pos, int n) {
+  uint32_t v = 0;
+  while (n > 0) {
+    int avail = 8 - (int)(*pos & 7);
+    int take = n < avail ? n : avail;
+    uint32_t byte = stream[*pos >> 3];
+    v = (v << take) | ((byte >> (avail - take)) & ((1u << take) - 1));
+    *pos += take;
+    n -= take;
+  }
+  return v;
+}
+
+/** @brief Count leading zeros of a non-zero 32-bit word. */
+static inline int clz32(uint32_t x) { return __builtin_clz(x); }
+
+/** @brief Count trailing zeros of a non-zero 32-bit word. */
+static inline int ctz32(uint32_t x) { return __builtin_ctz(x); }
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+/**
+ * @brief Encode a timestamp delta-of-delta.
+ */
+static void encodeDod(uint8_t* stream, uint32_t* pos, int64_t dod) {
+  if (dod == 0) {
+    writeBits(stream, pos, 0x0, 1);
+  } else if (dod >= -63 && dod <= 64) {
+    writeBits(stream, pos, 0x2, 2);
+    writeBits(stream, pos, (uint32_t)(dod + 63), 7);
+  } else if (dod >= -255 && dod <= 256) {
+    writeBits(stream, pos, 0x6, 3);
+    writeBits(stream, pos, (uint32_t)(dod + 255), 9);
+  } else if (dod >= -2047 && dod <= 2048) {
+    writeBits(stream, pos, 0xE, 4);
+    writeBits(stream, pos, (uint32_t)(dod + 2047), 12);
+  } else {
+    writeBits(stream, pos, 0xF, 4);
+    writeBits(stream, pos, (uint32_t)(int32_t)dod, 32);
+  }
+}
+
+/**
+ * @brief Decode a timestamp delta-of-delta.
+ */
+static int64_t decodeDod(const uint8_t* stream, uint32_t* pos) {
+  if (readBits(stream, pos, 1) == 0) return 0;
+  if (readBits(stream, pos, 1) == 0) return (int64_t)readBits(stream, pos, 7) - 63;
+  if (readBits(stream, pos, 1) == 0) return (int64_t)readBits(stream, pos, 9) - 255;
+  if (readBits(stream, pos, 1) == 0) return (int64_t)readBits(stream, pos, 12) - 2047;
+  return (int64_t)(int32_t)readBits(stream, pos, 32);
+}
+
+/**
+ * @brief Encode a distance bit pattern against the previous one.
+ */
+static void encodeXor(OpenBlock& ob, uint8_t* stream, uint32_t* pos, uint32_t bits) {
+  uint32_t x = bits ^ ob.prevBits;
+  ob.prevBits = bits;
+  if (x == 0) {
+    writeBits(stream, pos, 0x0, 1);
+    return;
+  }
+  int lead = clz32(x);
+  int trail = ctz32(x);
+  if (lead > 31) lead = 31;
+
+  if (ob.prevTrail != 0xFF && lead >= ob.prevLead && trail >= ob.prevTrail) {
+    int len = 32 - ob.prevLead - ob.prevTrail;
+    writeBits(stream, pos, 0x2, 2);
+    writeBits(stream, pos, x >> ob.prevTrail, len);
+  } else {
+    int len = 32 - lead - trail;
+    writeBits(stream, pos, 0x3, 2);
+    writeBits(stream, pos, (uint32_t)lead, 5);
+    writeBits(stream, pos, (uint32_t)(len - 1), 5);
+    writeBits(stream, pos, x >> trail, len);
+    ob.prevLead = (uint8_t)lead;
+    ob.prevTrail = (uint8_t)trail;
+  }
+}
+
+/**
+ * @brief Access a run word by index (runs grow down from the block end).
+ */
+static inline uint8_t* runAt(uint8_t* block, uint16_t i) {
+  return &block[HISTORY_BLOCK_SIZE - 2 * (i + 1)];
+}
+
+/**
+ * @brief Seal a tag's open block into the next ring slot.
+ */
+static void sealBlock(uint8_t tag) {
+  OpenBlock& ob = gOpen[tag];
+  if (!ob.active || gSlots == 0) return;
+
+  BlockHeader* h = (BlockHeader*)ob.buf;
+  h->seq = gSeq++;
+
+  // The erase wipes whatever block lived in this slot
+  uint32_t slot = gNextSlot;
+  flashWrite(slot, ob.buf);
+  gIndex[slot].seq = h->seq;
+  gIndex[slot].tag = tag;
+  gIndex[slot].firstTs = h->firstTs;
+  gIndex[slot].lastTs = h->firstTs + h->spanMs;
+  gSealedTs[tag] = gIndex[slot].lastTs;
+  gNextSlot = (gNextSlot + 1) % gSlots;
+
+  gStats.sealedBlocks++;
+  ob.active = false;
+}
+
+/**
+ * @brief Start a new block with its first sample.
+ */
+static void startBlock(uint8_t tag, uint64_t tsMs, uint32_t bits, bool moving) {
+  OpenBlock& ob = gOpen[tag];
+  memset(ob.buf, 0, sizeof(ob.buf));
+  BlockHeader* h = (BlockHeader*)ob.buf;
+  h->magic = HISTORY_MAGIC;
+  h->firstTs = tsMs;
+  h->tag = tag;
+  h->count = 1;
+  h->runCount = 1;
+
+  uint32_t pos = 0;
+  writeBits(ob.buf + sizeof(BlockHeader), &pos, bits, 32);
+  h->bitLen = (uint16_t)pos;
+
+  uint16_t run = (uint16_t)((moving ? 0x8000 : 0) | 1);
+  memcpy(runAt(ob.buf, 0), &run, 2);
+
+  ob.active = true;
+  ob.prevTs = tsMs;
+  ob.prevDelta = 0;
+  ob.prevBits = bits;
+  ob.prevLead = 0;
+  ob.prevTrail = 0xFF;
+  gStats.payloadBits += 32;
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+/**
+ * @brief Decode a block image, visiting samples within a time range.
+ *
+ * @param[out] stop Set when the visitor asked to stop.
+ * @return Number of samples visited.
+ */
+static size_t decodeBlock(const uint8_t* block, uint64_t fromMs, uint64_t toMs,
+                          HistoryVisitor fn, void* ctx, bool* stop) {
+  const BlockHeader* h = (const BlockHeader*)block;
+  const uint8_t* stream = block + sizeof(BlockHeader);
+  size_t visited = 0;
+
+  uint32_t pos = 0;
+  uint64_t ts = h->firstTs;
+  int64_t delta = 0;
+  uint32_t bits = readBits(stream, &pos, 32);
+  uint8_t lead = 0, trail = 0;
+
+  uint16_t runIdx = 0;
+  uint16_t runWord;
+  memcpy(&runWord, runAt((uint8_t*)block, 0), 2);
+  uint16_t runLeft = runWord & RUN_MAX;
+
+  for (uint16_t i = 0; i < h->count; i++) {
+    if (i > 0) {
+      delta += decodeDod(stream, &pos);
+      ts += (uint64_t)delta;
+      if (readBits(stream, &pos, 1) != 0) {
+        if (readBits(stream, &pos, 1) != 0) {
+          lead = (uint8_t)readBits(stream, &pos, 5);
+          int len = (int)readBits(stream, &pos, 5) + 1;
+          trail = (uint8_t)(32 - lead - len);
+        }
+        int len = 32 - lead - trail;
+        bits ^= readBits(stream, &pos, len) << trail;
+      }
+      if (runLeft == 0 && runIdx + 1 < h->runCount) {
+        runIdx++;
+        memcpy(&runWord, runAt((uint8_t*)block, runIdx), 2);
+        runLeft = runWord & RUN_MAX;
+      }
+    }
+    runLeft--;
+
+    if (ts > toMs) break;
+    if (ts >= fromMs) {
+      HistorySample s;
+      s.tsMs = ts;
+      memcpy(&s.distance, &bits, 4);
+      s.moving = (runWord & 0x8000) ? 1 : 0;
+      visited++;
+      if (!fn(h->tag, &s, ctx)) {
+        *stop = true;
+        break;
+      }
+    }
+  }
+  return visited;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool historyInit(void) {
+  if (!flashOpen()) return false;
+
+  lock();
+  uint32_t maxSeq = 0;
+  gNextSlot = 0;
+  memset(gSealedTs, 0, sizeof(gSealedTs));
+  for (uint32_t slot = 0; slot < gSlots; slot++) {
+    BlockHeader h;
+    flashRead(slot, sizeof(h), (uint8_t*)&h);
+    if (h.magic != HISTORY_MAGIC || h.tag >= HISTORY_MAX_TAGS) {
+      gIndex[slot].seq = 0;
+      continue;
+    }
+    gIndex[slot].seq = h.seq;
+    gIndex[slot].tag = h.tag;
+    gIndex[slot].firstTs = h.firstTs;
+    gIndex[slot].lastTs = h.firstTs + h.spanMs;
+    if (gIndex[slot].lastTs > gSealedTs[h.tag]) gSealedTs[h.tag] = gIndex[slot].lastTs;
+    if (h.seq >= maxSeq) {
+      maxSeq = h.seq;
+      gNextSlot = (slot + 1) % gSlots;
+    }
+  }
+  gSeq = maxSeq + 1;
+  for (int t = 0; t < HISTORY_MAX_TAGS; t++) gOpen[t].active = false;
+  gStats.slots = gSlots;
+  unlock();
+  return true;
+}
+
+uint64_t historyLatestMs(void) {
+  if (gSlots == 0) return 0;
+  uint64_t latest = 0;
+  lock();
+  for (int t = 0; t < HISTORY_MAX_TAGS; t++) {
+    if (gSealedTs[t] > latest) latest = gSealedTs[t];
+  }
+  unlock();
+  return latest;
+}
+
+bool historyAppend(uint8_t tag, uint64_t tsMs, float distance, bool moving) {
+  if (tag >= HISTORY_MAX_TAGS || gSlots == 0) return false;
+
+  float q = roundf(distance * HISTORY_DISTANCE_SCALE) / HISTORY_DISTANCE_SCALE;
+  uint32_t bits;
+  memcpy(&bits, &q, 4);
+
+  lock();
+  OpenBlock& ob = gOpen[tag];
+  if ((ob.active && tsMs < ob.prevTs) || tsMs < gSealedTs[tag]) {
+    unlock();
+    return false;
+  }
+
+  if (ob.active) {
+    BlockHeader* h = (BlockHeader*)ob.buf;
+    uint64_t delta = tsMs - ob.prevTs;
+    bool newRun = false;
+    uint16_t runWord;
+    memcpy(&runWord, runAt(ob.buf, h->runCount - 1), 2);
+    if (((runWord & 0x8000) != 0) != moving || (runWord & RUN_MAX) == RUN_MAX) newRun = true;
+
+    size_t runBytes = 2u * (h->runCount + (newRun ? 1 : 0));
+    bool full = (uint32_t)(h->bitLen + SAMPLE_MAX_BITS) > (BLOCK_PAYLOAD - runBytes) * 8;
+    bool spanOverflow = (tsMs - h->firstTs) > UINT32_MAX || delta > INT32_MAX / 2;
+
+    if (full || spanOverflow || h->count == UINT16_MAX) {
+      sealBlock(tag);
+    } else {
+      uint8_t* stream = ob.buf + sizeof(BlockHeader);
+      uint32_t pos = h->bitLen;
+      encodeDod(stream, &pos, (int64_t)delta - ob.prevDelta);
+      encodeXor(ob, stream, &pos, bits);
+      gStats.payloadBits += pos - h->bitLen;
+      h->bitLen = (uint16_t)pos;
+
+      if (newRun) {
+        runWord = (uint16_t)((moving ? 0x8000 : 0) | 1);
+        h->runCount++;
+        gStats.payloadBits += 16;
+      } else {
+        runWord++;
+      }
+      memcpy(runAt(ob.buf, h->runCount - 1), &runWord, 2);
+
+      h->count++;
+      h->spanMs = (uint32_t)(tsMs - h->firstTs);
+      ob.prevDelta = (int64_t)delta;
+      ob.prevTs = tsMs;
+      gStats.samples++;
+      unlock();
+      return true;
+    }
+  }
+
+  startBlock(tag, tsMs, bits, moving);
+  gStats.payloadBits += 16;
+  gStats.samples++;
+  unlock();
+  return true;
+}
+
+void historyFlush(uint8_t tag) {
+  if (tag >= HISTORY_MAX_TAGS) return;
+  lock();
+  sealBlock(tag);
+  unlock();
+}
+
+size_t historyQuery(uint8_t tag, uint64_t fromMs, uint64_t toMs, HistoryVisitor fn, void* ctx) {
+  if (tag >= HISTORY_MAX_TAGS || gSlots == 0) return 0;
+  size_t visited = 0;
+  bool stop = false;
+
+  lock();
+  // Walk the ring from the oldest slot so samples come out in time order
+  for (uint32_t i = 0; i < gSlots && !stop; i++) {
+    uint32_t slot = (gNextSlot + i) % gSlots;
+    const SlotIndex& e = gIndex[slot];
+    if (e.seq == 0 || e.tag != tag) continue;
+    if (e.lastTs < fromMs || e.firstTs > toMs) continue;
+    flashRead(slot, HISTORY_BLOCK_SIZE, gScratch);
+    visited += decodeBlock(gScratch, fromMs, toMs, fn, ctx, &stop);
+  }
+
+  const OpenBlock& ob = gOpen[tag];
+  if (ob.active && !stop) {
+    const BlockHeader* h = (const BlockHeader*)ob.buf;
+    if (h->firstTs + h->spanMs >= fromMs && h->firstTs <= toMs) {
+      visited += decodeBlock(ob.buf, fromMs, toMs, fn, ctx, &stop);
+    }
+  }
+  unlock();
+  return visited;
+}
+
+size_t historyQueryLast(uint8_t tag, uint64_t nowMs, uint32_t minutes, HistoryVisitor fn, void* ctx) {
+  uint64_t span = (uint64_t)minutes * 60000ULL;
+  uint64_t from = nowMs > span ? nowMs - span : 0;
+  return historyQuery(tag, from, nowMs, fn, ctx);
+}
+
+/**
+ * @brief Visitor state for historyRead().
+ */
+struct ReadCtx {
+  HistorySample* out;   /**< Destination array. */
+  size_t         max;   /**< Capacity of `out`. */
+  size_t         n;     /**< Samples copied. */
+  uint32_t       skip;  /**< Leading matches still to skip. */
+};
+
+/**
+ * @brief Copy visited samples until the destination is full.
+ */
+static bool readVisitor(uint8_t /*tag*/, const HistorySample* s, void* p) {
+  ReadCtx* c = (ReadCtx*)p;
+  if (c->skip > 0) {
+    c->skip--;
+    return true;
+  }
+  c->out[c->n++] = *s;
+  return c->n < c->max;
+}
+
+size_t historyRead(uint8_t tag, uint64_t fromMs, uint64_t toMs, uint32_t skip,
+                   HistorySample* out, size_t max) {
+  if (max == 0) return 0;
+  ReadCtx c = { out, max, 0, skip };
+  historyQuery(tag, fromMs, toMs, readVisitor, &c);
+  return c.n;
+}
+
+HistoryStats historyGetStats(void) {
+  return gStats;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file history.h
+ * @brief Compressed per-tag time-series store for distance and movement.
+ *
+ * Samples are packed into fixed-size blocks:
+ * - timestamps with Gorilla delta-of-delta encoding,
+ * - distance with Gorilla XOR float encoding,
+ * - movement state as run-length pairs growing from the end of the block.
+ *
+ * Sealed blocks are written to a flash ring (the `history` data partition).
+ * A RAM index of each block's tag and time span serves range queries without
+ * touching blocks that cannot contain matching samples.
+ *
+ * Queries walk the ring in write order, so timestamps must keep increasing
+ * across reboots: start the clock after historyLatestMs() before appending.
+ * Open blocks live in RAM; a reset or power loss drops up to one open block
+ * per tag (the samples since its last seal).
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Size of one history block; equal to the flash erase sector. */
+#define HISTORY_BLOCK_SIZE 4096
+
+/** @brief Number of tags that can record concurrently (one open block each). */
+#ifndef HISTORY_MAX_TAGS
+#define HISTORY_MAX_TAGS 2
+#endif
+
+/**
+ * @brief Number of blocks in the ring when no flash partition is available
+ *        (host builds). On the device the ring spans the whole partition.
+ */
+#ifndef HISTORY_HOST_SLOTS
+#define HISTORY_HOST_SLOTS 64
+#endif
+
+/**
+ * @brief Distance quantisation step as a power of two (1/128 m).
+ *
+ * Rounding to a binary fraction leaves the low mantissa bits zero, which the
+ * XOR encoder stores for free. The step is far below RSSI ranging accuracy.
+ */
+#define HISTORY_DISTANCE_SCALE 128.0f
+
+/**
+ * @brief One decoded history sample.
+ */
+struct HistorySample {
+  uint64_t tsMs;      /**< Timestamp in milliseconds since the epoch. */
+  float    distance;  /**< Estimated distance in meters (quantised). */
+  uint8_t  moving;    /**< Movement flag reported by the tag (0 or 1). */
+};
+
+/**
+ * @brief Store statistics.
+ */
+struct HistoryStats {
+  uint32_t samples;       /**< Samples appended since boot. */
+  uint32_t sealedBlocks;  /**< Blocks written to flash since boot. */
+  uint32_t payloadBits;   /**< Encoded bits for the appended samples. */
+  uint32_t slots;         /**< Blocks in the flash ring. */
+};
+
+/**
+ * @brief Callback invoked for every sample matched by a query.
+ *
+ * @param[in] tag Tag the sample belongs to.
+ * @param[in] s   Decoded sample.
+ * @param[in] ctx User context passed to historyQuery().
+ * @return True to continue, false to stop the query early.
+ */
+typedef bool (*HistoryVisitor)(uint8_t tag, const HistorySample* s, void* ctx);
+
+/**
+ * @brief Open the flash ring and rebuild the block index from block headers.
+ *
+ * @return True if the store is usable, false if no flash ring was found.
+ */
+bool historyInit(void);
+
+/**
+ * @brief Newest timestamp in the flash ring.
+ *
+ * @return Last timestamp of the newest sealed block, 0 if the ring is empty.
+ */
+uint64_t historyLatestMs(void);
+
+/**
+ * @brief Append one sample for a tag.
+ *
+ * Timestamps must be non-decreasing per tag, including against the tag's
+ * sealed blocks. When the open block is full it is sealed to flash and a new
+ * one is started.
+ *
+ * @param[in] tag      Tag index (< HISTORY_MAX_TAGS).
+ * @param[in] tsMs     Sample time in milliseconds since the epoch.
+ * @param[in] distance Distance estimate in meters.
+ * @param[in] moving   Movement flag.
+ * @return True if the sample was stored, false if it is older than the
+ *         tag's newest stored sample.
+ */
+bool historyAppend(uint8_t tag, uint64_t tsMs, float distance, bool moving);
+
+/**
+ * @brief Seal a tag's open block to flash even if it is not full.
+ *
+ * @param[in] tag Tag index.
+ */
+void historyFlush(uint8_t tag);
+
+/**
+ * @brief Visit all samples of a tag within a time range, oldest first.
+ *
+ * @param[in] tag    Tag index.
+ * @param[in] fromMs Inclusive range start.
+ * @param[in] toMs   Inclusive range end.
+ * @param[in] fn     Visitor called for each sample.
+ * @param[in] ctx    User context forwarded to the visitor.
+ * @return Number of samples visited.
+ */
+size_t historyQuery(uint8_t tag, uint64_t fromMs, uint64_t toMs, HistoryVisitor fn, void* ctx);
+
+/**
+ * @brief Visit the last `minutes` of history of a tag.
+ *
+ * @param[in] tag     Tag index.
+ * @param[in] nowMs   Current time in milliseconds since the epoch.
+ * @param[in] minutes Window length.
+ * @param[in] fn      Visitor called for each sample.
+ * @param[in] ctx     User context forwarded to the visitor.
+ * @return Number of samples visited.
+ */
+size_t historyQueryLast(uint8_t tag, uint64_t nowMs, uint32_t minutes, HistoryVisitor fn, void* ctx);
+
+/**
+ * @brief Copy samples of a tag within a time range into an array.
+ *
+ * Intended for incremental readers: resume with `fromMs` set to the last
+ * timestamp returned and `skip` set to the number of samples already
+ * consumed at exactly that timestamp.
+ *
+ * @param[in]  tag    Tag index.
+ * @param[in]  fromMs Inclusive range start.
+ * @param[in]  toMs   Inclusive range end.
+ * @param[in]  skip   Number of leading matches to skip.
+ * @param[out] out    Destination array.
+ * @param[in]  max    Capacity of `out`.
+ * @return Number of samples copied.
+ */
+size_t historyRead(uint8_t tag, uint64_t fromMs, uint64_t toMs, uint32_t skip,
+                   HistorySample* out, size_t max);
+
+/**
+ * @brief Read the store statistics.
+ */
+HistoryStats historyGetStats(void);
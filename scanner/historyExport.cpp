@@ -0,0 +1,239 @@
+/**
+ * @file historyExport.cpp
+ * @brief Implementation of the windowed, resumable history exporter.
+ *
+ * Chunk `k` of a request always contains matches `k * R .. k * R + R - 1` of
+ * the requested range (R = EXPORT_RECORDS_PER_CHUNK), so a resumed request
+ * produces byte-identical chunks. The read position is kept as a
+ * `(timestamp, skip)` cursor into the history store, which only requires
+ * decoding blocks from the cursor onward for each new chunk.
+ */
+
+#include <string.h>
+#include "historyExport.h"
+#include "exportFrame.h"
+#include "history.h"
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/**
+ * @brief A sent but not yet acknowledged chunk.
+ */
+struct InFlight {
+  uint8_t frame[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)]; /**< Encoded frame. */
+  size_t  len;                                         /**< Frame length. */
+};
+
+/** @brief Byte link. */
+static const ExportIo* gIo = nullptr;
+
+/** @brief Receive-side frame decoder. */
+static FrameDecoder gRx;
+
+/** @brief Handler for other message types. */
+static ExportHandler gOther = nullptr;
+
+/** @brief Unacknowledged chunks, slot = chunk % HISTORY_EXPORT_WINDOW. */
+static InFlight gWindow[HISTORY_EXPORT_WINDOW];
+
+/**
+ * @brief Transfer state.
+ */
+static struct {
+  bool     active;       /**< A request is being served. */
+  bool     ended;        /**< The last transfer finished with END. */
+  bool     produced;     /**< The last chunk has been built. */
+  uint8_t  tag;          /**< Requested tag. */
+  uint64_t toMs;         /**< Requested range end. */
+  uint64_t cursorTs;     /**< Read cursor timestamp. */
+  uint32_t cursorSkip;   /**< Matches at or after cursorTs already consumed. */
+  uint32_t nextChunk;    /**< Next chunk number to build. */
+  uint32_t acked;        /**< All chunks below this are acknowledged. */
+  uint32_t lastCount;    /**< Records in the most recent chunk. */
+  uint32_t lastSendMs;   /**< Time of the last (re)transmission. */
+  uint8_t  dupAcks;      /**< Repeated acks for the current `acked` value. */
+} gTx;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Build, remember and send the next DATA chunk.
+ *
+ * @return False if the range is exhausted and nothing was sent.
+ */
+static bool sendNextChunk() {
+  HistorySample samples[EXPORT_RECORDS_PER_CHUNK];
+  size_t n = historyRead(gTx.tag, gTx.cursorTs, gTx.toMs, gTx.cursorSkip,
+                         samples, EXPORT_RECORDS_PER_CHUNK);
+  if (n < EXPORT_RECORDS_PER_CHUNK) gTx.produced = true;
+  if (n == 0) return false;
+
+  // Advance the cursor past the samples just read
+  uint64_t lastTs = samples[n - 1].tsMs;
+  uint32_t atLast = 0;
+  for (size_t i = n; i > 0 && samples[i - 1].tsMs == lastTs; i--) atLast++;
+  gTx.cursorSkip = (lastTs == gTx.cursorTs ? gTx.cursorSkip : 0) + atLast;
+  gTx.cursorTs = lastTs;
+
+  uint8_t body[5 + EXPORT_RECORDS_PER_CHUNK * EXPORT_RECORD_LEN];
+  putLe(&body[0], gTx.nextChunk, 4);
+  body[4] = (uint8_t)n;
+  uint8_t* p = &body[5];
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits;
+    memcpy(&bits, &samples[i].distance, 4);
+    putLe(p, samples[i].tsMs, 8);
+    putLe(p + 8, bits, 4);
+    p[12] = samples[i].moving;
+    p += EXPORT_RECORD_LEN;
+  }
+
+  InFlight& slot = gWindow[gTx.nextChunk % HISTORY_EXPORT_WINDOW];
+  slot.len = frameBuild(EXPORT_DATA, body, (size_t)(p - body), slot.frame);
+  gIo->write(slot.frame, slot.len);
+
+  gTx.nextChunk++;
+  gTx.lastCount = (uint32_t)n;
+  gTx.lastSendMs = gIo->millis();
+  return true;
+}
+
+/**
+ * @brief Resend every unacknowledged chunk (go-back-N).
+ */
+static void resendWindow() {
+  for (uint32_t c = gTx.acked; c < gTx.nextChunk; c++) {
+    const InFlight& slot = gWindow[c % HISTORY_EXPORT_WINDOW];
+    gIo->write(slot.frame, slot.len);
+  }
+  gTx.lastSendMs = gIo->millis();
+}
+
+/**
+ * @brief Send the END message closing a transfer.
+ */
+static void sendEnd() {
+  uint8_t body[8];
+  uint32_t samples = gTx.nextChunk == 0 ? 0
+                   : (gTx.nextChunk - 1) * EXPORT_RECORDS_PER_CHUNK + gTx.lastCount;
+  putLe(&body[0], gTx.nextChunk, 4);
+  putLe(&body[4], samples, 4);
+  uint8_t frame[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+  size_t len = frameBuild(EXPORT_END, body, sizeof(body), frame);
+  gIo->write(frame, len);
+}
+
+/**
+ * @brief Handle one decoded host message.
+ */
+static void handleMessage(const uint8_t* msg, size_t len) {
+  switch (msg[0]) {
+    case EXPORT_REQ: {
+      if (len < 1 + 1 + 8 + 8 + 4) return;
+      uint32_t start = (uint32_t)getLe(&msg[18], 4);
+      gTx.active = true;
+      gTx.ended = false;
+      gTx.produced = false;
+      gTx.tag = msg[1];
+      gTx.cursorTs = getLe(&msg[2], 8);
+      gTx.toMs = getLe(&msg[10], 8);
+      gTx.cursorSkip = start * EXPORT_RECORDS_PER_CHUNK;
+      gTx.nextChunk = start;
+      gTx.acked = start;
+      gTx.lastCount = EXPORT_RECORDS_PER_CHUNK;
+      gTx.dupAcks = 0;
+      break;
+    }
+    case EXPORT_ACK: {
+      if (len < 5) return;
+      uint32_t next = (uint32_t)getLe(&msg[1], 4);
+      if (!gTx.active) {
+        // The host acknowledges the final chunk again: END was lost
+        if (gTx.ended && next == gTx.nextChunk) sendEnd();
+        return;
+      }
+      if (next > gTx.nextChunk) next = gTx.nextChunk;
+      if (next > gTx.acked) {
+        gTx.acked = next;
+        gTx.dupAcks = 0;
+        gTx.lastSendMs = gIo->millis();
+      } else if (next == gTx.acked && gTx.acked < gTx.nextChunk && ++gTx.dupAcks == 2) {
+        // The host keeps receiving later chunks: go back now instead of
+        // waiting for the timeout
+        resendWindow();
+      }
+      break;
+    }
+    case EXPORT_ABORT:
+      gTx.active = false;
+      gTx.ended = false;
+      break;
+    default:
+      if (gOther) gOther(msg, len);
+      break;
+  }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void historyExportInit(const ExportIo* io) {
+  gIo = io;
+  frameDecoderReset(&gRx);
+  memset(&gTx, 0, sizeof(gTx));
+}
+
+void historyExportPoll(void) {
+  if (!gIo) return;
+
+  uint8_t rx[64];
+  size_t n;
+  while ((n = gIo->read(rx, sizeof(rx))) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      uint8_t msg[FRAME_MAX_PAYLOAD];
+      size_t len;
+      if (frameDecoderPush(&gRx, rx[i], msg, &len)) handleMessage(msg, len);
+    }
+  }
+  if (!gTx.active) return;
+
+  // Fill the window
+  while (!gTx.produced && gTx.nextChunk - gTx.acked < HISTORY_EXPORT_WINDOW) {
+    if (!sendNextChunk()) break;
+  }
+
+  if (gTx.produced && gTx.acked == gTx.nextChunk) {
+    sendEnd();
+    gTx.active = false;
+    gTx.ended = true;
+    return;
+  }
+
+  // Go-back-N retransmission of everything still unacknowledged
+  if (gTx.acked < gTx.nextChunk && gIo->millis() - gTx.lastSendMs > HISTORY_EXPORT_TIMEOUT_MS) {
+    resendWindow();
+  }
+}
+
+bool historyExportActive(void) {
+  return gTx.active;
+}
+
+void historyExportOnMessage(ExportHandler handler) {
+  gOther = handler;
+}
+
+bool historyExportSend(uint8_t type, const uint8_t* body, size_t len) {
+  if (!gIo) return false;
+  uint8_t frame[1 + FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+  frame[0] = FRAME_DELIM;  // ends any log text printed since the last frame
+  size_t n = frameBuild(type, body, len, frame + 1);
+  if (n == 0) return false;
+  gIo->write(frame, 1 + n);
+  return true;
+}
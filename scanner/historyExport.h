@@ -0,0 +1,77 @@
+/**
+ * @file historyExport.h
+ * @brief Streams stored history to a host over a byte link (USB-CDC serial).
+ *
+ * The exporter answers an `EXPORT_REQ` by streaming the requested range as
+ * numbered `EXPORT_DATA` chunks (see exportFrame.h). At most
+ * HISTORY_EXPORT_WINDOW chunks are in flight; the host acknowledges
+ * cumulatively; a repeated acknowledgement, or no acknowledgement within
+ * HISTORY_EXPORT_TIMEOUT_MS, makes the tracker resend every unacknowledged
+ * chunk. A broken transfer is resumed by a new request whose `startChunk`
+ * is the first chunk the host is missing. If the closing END is lost, the
+ * host acknowledges the final chunk again and the tracker resends END.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Maximum number of unacknowledged chunks in flight. */
+#define HISTORY_EXPORT_WINDOW 8
+
+/** @brief Retransmission timeout in milliseconds. */
+#define HISTORY_EXPORT_TIMEOUT_MS 500
+
+/**
+ * @brief Byte link used by the exporter.
+ */
+struct ExportIo {
+  size_t   (*read)(uint8_t* buf, size_t max);        /**< Non-blocking read, returns bytes read. */
+  void     (*write)(const uint8_t* buf, size_t len); /**< Write all bytes. */
+  uint32_t (*millis)(void);                          /**< Monotonic millisecond clock. */
+};
+
+/**
+ * @brief Handler for host messages the exporter does not handle itself.
+ *
+ * @param[in] msg Decoded `type | body`.
+ * @param[in] len Length of `msg`.
+ */
+typedef void (*ExportHandler)(const uint8_t* msg, size_t len);
+
+/**
+ * @brief Bind the exporter to a byte link.
+ *
+ * @param[in] io Link callbacks (must outlive the exporter).
+ */
+void historyExportInit(const ExportIo* io);
+
+/**
+ * @brief Service the link: parse requests, send chunks, handle timeouts.
+ *
+ * Call periodically from a low-priority task.
+ */
+void historyExportPoll(void);
+
+/**
+ * @brief Check whether a transfer is in progress.
+ */
+bool historyExportActive(void);
+
+/**
+ * @brief Route other message types (e.g. configuration) to a handler.
+ *
+ * The handler runs inside `historyExportPoll()`.
+ */
+void historyExportOnMessage(ExportHandler handler);
+
+/**
+ * @brief Send one framed message on the exporter's link.
+ *
+ * Call from the task that polls the exporter, so frames never interleave.
+ * The frame is preceded by a delimiter so log text printed on the same
+ * port since the last frame does not corrupt it.
+ *
+ * @return False if the body does not fit a frame or no link is bound.
+ */
+bool historyExportSend(uint8_t type, const uint8_t* body, size_t len);
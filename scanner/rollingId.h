@@ -0,0 +1,87 @@
+/**
+ * @file rollingId.h
+ * @brief Time-rotating ephemeral identifiers derived from a shared tag key.
+ *
+ * The tag no longer advertises a fixed service UUID. Instead it advertises a
+ * short identifier computed as a keyed PRF (SipHash-2-4) over the current time
+ * window. Only holders of the tag key can link two identifiers together.
+ *
+ * @note This file is shared verbatim between the server (tag) and scanner
+ *       (tracker) sketches. Keep both copies in sync.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Length of the shared tag key in bytes. */
+#define ROLLING_KEY_LEN 16
+
+/** @brief Length of the advertised ephemeral identifier in bytes. */
+#define ROLLING_ID_LEN 8
+
+/** @brief Rotation period of the identifier in seconds (15 minutes). */
+#define ROLLING_PERIOD_S 900
+
+/**
+ * @brief Bluetooth SIG company identifier used in the manufacturer data field.
+ *
+ * 0xFFFF is reserved for internal testing and never assigned to a vendor.
+ */
+#define ROLLING_COMPANY_ID 0xFFFF
+
+/** @brief Total manufacturer data length: company ID followed by the identifier. */
+#define ROLLING_MFR_LEN (2 + ROLLING_ID_LEN)
+
+/**
+ * @brief Manufacturer data length when the tag appends its battery level.
+ *
+ * The byte after the identifier is the state of charge in percent, 0xFF if
+ * not yet known. Decoders accept payloads with or without it.
+ */
+#define ROLLING_MFR_BATTERY_LEN (ROLLING_MFR_LEN + 1)
+
+/**
+ * @brief Compute SipHash-2-4 of a message.
+ *
+ * @param[in] key  16-byte secret key.
+ * @param[in] data Message bytes.
+ * @param[in] len  Message length in bytes.
+ * @return 64-bit keyed hash.
+ */
+uint64_t siphash24(const uint8_t key[ROLLING_KEY_LEN], const uint8_t* data, size_t len);
+
+/**
+ * @brief Map an epoch time to its rotation window index.
+ *
+ * @param[in] epochSeconds Seconds since the shared epoch.
+ * @return Window index (epochSeconds / ROLLING_PERIOD_S).
+ */
+uint32_t rollingWindow(uint32_t epochSeconds);
+
+/**
+ * @brief Derive the ephemeral identifier of a tag for a given window.
+ *
+ * @param[in] key    16-byte tag key.
+ * @param[in] window Rotation window index.
+ * @return 64-bit identifier (advertised little-endian).
+ */
+uint64_t rollingIdFor(const uint8_t key[ROLLING_KEY_LEN], uint32_t window);
+
+/**
+ * @brief Encode an identifier into manufacturer data (company ID + ID bytes).
+ *
+ * @param[in]  id  Identifier returned by rollingIdFor().
+ * @param[out] out Buffer of at least ROLLING_MFR_LEN bytes.
+ */
+void rollingEncodeMfr(uint64_t id, uint8_t out[ROLLING_MFR_LEN]);
+
+/**
+ * @brief Decode an identifier from manufacturer data.
+ *
+ * @param[in]  mfr Manufacturer data bytes as received in an advertisement.
+ * @param[in]  len Length of the manufacturer data.
+ * @param[out] id  Decoded identifier.
+ * @return True if the payload carries a rolling identifier, false otherwise.
+ */
+bool rollingDecodeMfr(const uint8_t* mfr, size_t len, uint64_t* id);
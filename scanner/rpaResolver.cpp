@@ -0,0 +1,293 @@
+/**
+ * @file rpaResolver.cpp
+ * @brief Implementation of cached, prioritised RPA resolution.
+ *
+ * A resolvable private address is laid out (most significant byte first) as
+ * `prand[3] || hash[3]` where the top two bits of prand are 0b01. It belongs
+ * to an IRK \f$k\f$ when \f$ah(k, prand) = hash\f$.
+ *
+ * AES-128 is implemented here in portable C so the resolver behaves
+ * identically on the host; only encryption is needed. Key schedules are
+ * expanded when an IRK is registered, so a resolution pass is a tight loop of
+ * ten-round block encryptions over consecutive schedules.
+ */
+
+#include <string.h>
+#include "rpaResolver.h"
+
+// ============================================================================
+// AES-128 (encrypt only)
+// ============================================================================
+
+/** @brief AES forward S-box. */
+static const uint8_t SBOX[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/** @brief Size of an expanded AES-128 key schedule in bytes. */
+#define AES_SCHEDULE_LEN 176
+
+/**
+ * @brief Multiply by x in GF(2^8).
+ */
+static inline uint8_t xtime(uint8_t b) {
+  return (uint8_t)((b << 1) ^ ((b & 0x80) ? 0x1b : 0x00));
+}
+
+/**
+ * @brief Expand a 128-bit key into the 11 round keys.
+ *
+ * @param[in]  key 16-byte key.
+ * @param[out] rk  176-byte round key schedule.
+ */
+static void aesExpandKey(const uint8_t key[16], uint8_t rk[AES_SCHEDULE_LEN]) {
+  memcpy(rk, key, 16);
+  uint8_t rcon = 0x01;
+  for (int i = 16; i < AES_SCHEDULE_LEN; i += 4) {
+    uint8_t t0 = rk[i - 4], t1 = rk[i - 3], t2 = rk[i - 2], t3 = rk[i - 1];
+    if (i % 16 == 0) {
+      uint8_t tmp = t0;
+      t0 = SBOX[t1] ^ rcon;
+      t1 = SBOX[t2];
+      t2 = SBOX[t3];
+      t3 = SBOX[tmp];
+      rcon = xtime(rcon);
+    }
+    rk[i + 0] = rk[i - 16] ^ t0;
+    rk[i + 1] = rk[i - 15] ^ t1;
+    rk[i + 2] = rk[i - 14] ^ t2;
+    rk[i + 3] = rk[i - 13] ^ t3;
+  }
+}
+
+/**
+ * @brief Encrypt one block in place with an expanded key schedule.
+ *
+ * @param[in]     rk    176-byte round key schedule.
+ * @param[in,out] state 16-byte block.
+ */
+static void aesEncryptBlock(const uint8_t rk[AES_SCHEDULE_LEN], uint8_t state[16]) {
+  for (int i = 0; i < 16; i++) state[i] ^= rk[i];
+
+  for (int round = 1; round <= 10; round++) {
+    // SubBytes + ShiftRows
+    uint8_t s[16];
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        s[4 * c + r] = SBOX[state[4 * ((c + r) & 3) + r]];
+      }
+    }
+    // MixColumns (skipped in the final round)
+    if (round != 10) {
+      for (int c = 0; c < 4; c++) {
+        uint8_t* col = &s[4 * c];
+        uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+        col[0] = a0 ^ all ^ xtime(a0 ^ a1);
+        col[1] = a1 ^ all ^ xtime(a1 ^ a2);
+        col[2] = a2 ^ all ^ xtime(a2 ^ a3);
+        col[3] = a3 ^ all ^ xtime(a3 ^ a0);
+      }
+    }
+    // AddRoundKey
+    const uint8_t* k = rk + 16 * round;
+    for (int i = 0; i < 16; i++) state[i] = s[i] ^ k[i];
+  }
+}
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/**
+ * @brief A registered IRK with its precomputed key schedule.
+ */
+struct IrkEntry {
+  uint8_t schedule[AES_SCHEDULE_LEN]; /**< Expanded AES key. */
+  int16_t id;                         /**< Application identifier. */
+};
+
+/**
+ * @brief One resolved-address cache entry.
+ */
+struct CacheEntry {
+  uint64_t addr;   /**< 48-bit address, bit 63 set when the entry is valid. */
+  int16_t  id;     /**< Resolved identifier, or -1 for a cached miss. */
+  uint32_t stamp;  /**< Last use, for LRU replacement within a set. */
+};
+
+/** @brief Associativity of the address cache. */
+#define RPA_CACHE_WAYS 4
+
+/** @brief Number of sets in the address cache. */
+#define RPA_CACHE_SETS (RPA_CACHE_SIZE / RPA_CACHE_WAYS)
+
+/** @brief Valid marker for cache entries. */
+#define CACHE_VALID (1ULL << 63)
+
+/** @brief Registered IRKs in registration order. */
+static IrkEntry gIrks[RPA_MAX_IRKS];
+
+/** @brief Number of registered IRKs. */
+static size_t gIrkCount = 0;
+
+/** @brief IRK indices ordered by most recent hit (front = most recent). */
+static uint16_t gOrder[RPA_MAX_IRKS];
+
+/** @brief Set-associative cache of resolved addresses. */
+static CacheEntry gCache[RPA_CACHE_SETS][RPA_CACHE_WAYS];
+
+/** @brief Monotonic counter used as the LRU clock. */
+static uint32_t gClock = 0;
+
+/** @brief Resolver statistics. */
+static RpaStats gStats = { 0, 0, 0 };
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Pack a 6-byte address into an integer key.
+ */
+static uint64_t packAddr(const uint8_t addr[6]) {
+  uint64_t v = 0;
+  for (int i = 0; i < 6; i++) v = (v << 8) | addr[i];
+  return v;
+}
+
+/**
+ * @brief Pick the cache set for an address.
+ *
+ * The low 24 bits of an RPA are an AES output and therefore well mixed.
+ */
+static inline size_t cacheSet(uint64_t key) {
+  return (size_t)(key & (RPA_CACHE_SETS - 1));
+}
+
+/**
+ * @brief Store a resolution result, evicting the least recently used way.
+ */
+static void cacheStore(uint64_t key, int16_t id) {
+  CacheEntry* set = gCache[cacheSet(key)];
+  CacheEntry* victim = &set[0];
+  for (int w = 0; w < RPA_CACHE_WAYS; w++) {
+    if (!(set[w].addr & CACHE_VALID)) { victim = &set[w]; break; }
+    if (set[w].stamp < victim->stamp) victim = &set[w];
+  }
+  victim->addr = key | CACHE_VALID;
+  victim->id = id;
+  victim->stamp = ++gClock;
+}
+
+/**
+ * @brief Move the IRK at position `pos` of the priority order to the front.
+ */
+static void promote(size_t pos) {
+  uint16_t idx = gOrder[pos];
+  memmove(&gOrder[1], &gOrder[0], pos * sizeof(gOrder[0]));
+  gOrder[0] = idx;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void rpaClear(void) {
+  gIrkCount = 0;
+  memset(gCache, 0, sizeof(gCache));
+  gClock = 0;
+  memset(&gStats, 0, sizeof(gStats));
+}
+
+bool rpaAddIrk(const uint8_t irk[16], int16_t id) {
+  uint8_t schedule[AES_SCHEDULE_LEN];
+  aesExpandKey(irk, schedule);
+  size_t i = 0;
+  while (i < gIrkCount && gIrks[i].id != id) i++;
+  if (i < gIrkCount) {
+    if (memcmp(gIrks[i].schedule, schedule, AES_SCHEDULE_LEN) == 0) return true;
+  } else {
+    if (gIrkCount >= RPA_MAX_IRKS) return false;
+    gOrder[gIrkCount] = (uint16_t)gIrkCount;
+    gIrkCount++;
+  }
+  memcpy(gIrks[i].schedule, schedule, AES_SCHEDULE_LEN);
+  gIrks[i].id = id;
+  // Cached misses may now resolve to the new key, and addresses resolved
+  // to a replaced key no longer do; other resolved addresses stay cached
+  for (size_t set = 0; set < RPA_CACHE_SETS; set++) {
+    for (int w = 0; w < RPA_CACHE_WAYS; w++) {
+      CacheEntry& c = gCache[set][w];
+      if (c.id == -1 || c.id == id) c.addr = 0;
+    }
+  }
+  return true;
+}
+
+bool rpaIsResolvable(const uint8_t addr[6]) {
+  return (addr[0] & 0xC0) == 0x40;
+}
+
+void rpaHash(const uint8_t irk[16], const uint8_t prand[3], uint8_t hash[3]) {
+  uint8_t rk[AES_SCHEDULE_LEN];
+  uint8_t block[16] = { 0 };
+  aesExpandKey(irk, rk);
+  memcpy(&block[13], prand, 3);
+  aesEncryptBlock(rk, block);
+  memcpy(hash, &block[13], 3);
+}
+
+int16_t rpaResolve(const uint8_t addr[6]) {
+  if (!rpaIsResolvable(addr)) return -1;
+  gStats.lookups++;
+
+  const uint64_t key = packAddr(addr);
+  CacheEntry* set = gCache[cacheSet(key)];
+  for (int w = 0; w < RPA_CACHE_WAYS; w++) {
+    if (set[w].addr == (key | CACHE_VALID)) {
+      set[w].stamp = ++gClock;
+      gStats.cacheHits++;
+      return set[w].id;
+    }
+  }
+
+  // Cold miss: one block encryption per IRK in hit order; only the schedule varies
+  uint8_t plain[16] = { 0 };
+  memcpy(&plain[13], &addr[0], 3);
+
+  for (size_t pos = 0; pos < gIrkCount; pos++) {
+    const IrkEntry& e = gIrks[gOrder[pos]];
+    uint8_t block[16];
+    memcpy(block, plain, 16);
+    aesEncryptBlock(e.schedule, block);
+    gStats.aesOps++;
+    if (block[13] == addr[3] && block[14] == addr[4] && block[15] == addr[5]) {
+      promote(pos);
+      cacheStore(key, e.id);
+      return e.id;
+    }
+  }
+
+  cacheStore(key, -1);
+  return -1;
+}
+
+RpaStats rpaGetStats(void) {
+  return gStats;
+}
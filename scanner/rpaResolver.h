@@ -0,0 +1,102 @@
+/**
+ * @file rpaResolver.h
+ * @brief Resolvable private address (RPA) resolution against bonded IRKs.
+ *
+ * With privacy enabled a bonded tag advertises from a resolvable private
+ * address that changes periodically. Resolving it costs one AES-128
+ * operation per stored identity resolving key (IRK) tried. This module
+ * keeps repeat sightings cheap on the scan hot path by:
+ * - caching recently resolved (and recently rejected) addresses, so an
+ *   address seen in an earlier scan costs no AES,
+ * - keeping IRKs ordered by last hit so active tags are tried first,
+ * - precomputing each IRK's AES key schedule once, so trying an IRK costs
+ *   only the block encryption.
+ *
+ * The cost is near constant only for cached addresses. An address that
+ * matches no IRK (a phone's new RPA) is tried against every IRK on its
+ * first sighting, since the hash can only be checked by encrypting with
+ * each key; that cold miss grows linearly with the IRK count (about
+ * 0.5 us per IRK on a desktop, see host/rpaBench).
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of IRKs the resolver can hold.
+ *
+ * Each IRK costs 176 bytes of expanded key schedule.
+ */
+#ifndef RPA_MAX_IRKS
+#define RPA_MAX_IRKS 16
+#endif
+
+/**
+ * @brief Number of entries in the resolved-address cache (power of two).
+ */
+#ifndef RPA_CACHE_SIZE
+#define RPA_CACHE_SIZE 128
+#endif
+
+/**
+ * @brief Resolver statistics.
+ */
+struct RpaStats {
+  uint32_t lookups;    /**< Calls to rpaResolve() with a resolvable address. */
+  uint32_t cacheHits;  /**< Lookups answered from the address cache. */
+  uint32_t aesOps;     /**< AES block encryptions performed. */
+};
+
+/**
+ * @brief Remove all IRKs and clear the cache.
+ */
+void rpaClear(void);
+
+/**
+ * @brief Register an identity resolving key, or replace the key of an
+ *        identifier already registered.
+ *
+ * The hit order and the addresses cached for other identifiers are kept;
+ * only cached misses (and, on a replaced key, that identifier's addresses)
+ * are dropped. Registering the same key again changes nothing.
+ *
+ * @param[in] irk 16-byte IRK, most significant byte first (as exchanged
+ *                during pairing).
+ * @param[in] id  Application identifier returned when this IRK matches.
+ * @return True if the key was stored, false if the table is full.
+ */
+bool rpaAddIrk(const uint8_t irk[16], int16_t id);
+
+/**
+ * @brief Check whether a BLE address is a resolvable private address.
+ *
+ * @param[in] addr 6-byte address, most significant byte first.
+ * @return True if the two most significant bits are 0b01.
+ */
+bool rpaIsResolvable(const uint8_t addr[6]);
+
+/**
+ * @brief Resolve an address to a registered IRK.
+ *
+ * @param[in] addr 6-byte address, most significant byte first.
+ * @return Identifier passed to rpaAddIrk(), or -1 if no IRK matches or the
+ *         address is not resolvable.
+ */
+int16_t rpaResolve(const uint8_t addr[6]);
+
+/**
+ * @brief Compute the BLE `ah` random address hash function.
+ *
+ * \f$ah(k, r) = e(k, 0^{104} \| r) \bmod 2^{24}\f$
+ *
+ * @param[in]  irk   16-byte IRK, most significant byte first.
+ * @param[in]  prand 3-byte prand, most significant byte first.
+ * @param[out] hash  3-byte hash, most significant byte first.
+ */
+void rpaHash(const uint8_t irk[16], const uint8_t prand[3], uint8_t hash[3]);
+
+/**
+ * @brief Read the resolver statistics.
+ */
+RpaStats rpaGetStats(void);
@@ -0,0 +1,222 @@
+/**
+ * @file rssiSched.cpp
+ * @brief Zone-based RSSI sampling schedule with batched reads.
+ *
+ * Each tag has a due time that advances by its period whenever a read is
+ * started, so the long-run rate follows the target even when ticks are
+ * coarser than the period. A tag more than one period behind restarts from
+ * the current time rather than catching up in a burst.
+ */
+
+#include <string.h>
+#include "rssiSched.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#else
+#include <mutex>
+#endif
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+#ifdef ARDUINO
+/** @brief Guards the tag table. */
+static portMUX_TYPE gMux = portMUX_INITIALIZER_UNLOCKED;
+static void lock()   { portENTER_CRITICAL(&gMux); }
+static void unlock() { portEXIT_CRITICAL(&gMux); }
+#else
+/** @brief Guards the tag table. */
+static std::mutex gLock;
+static void lock()   { gLock.lock(); }
+static void unlock() { gLock.unlock(); }
+#endif
+
+/**
+ * @brief One scheduled tag.
+ */
+struct SchedTag {
+  int16_t      tag;        /**< Tag, -1 if the slot is free. */
+  RssiZone     zone;       /**< Current zone. */
+  bool         inflight;   /**< A read is outstanding. */
+  uint32_t     dueMs;      /**< Next read due. */
+  uint32_t     issuedMs;   /**< Time the latest read was started. */
+  RssiTagStats stats;      /**< Counters. */
+};
+
+static SchedTag gTags[RSSI_MAX_TAGS];   /**< Tag table. */
+static RssiReadFn gRead = nullptr;      /**< Read callback. */
+static void* gCtx = nullptr;            /**< Read context. */
+static uint8_t gMaxInflight = 1;        /**< Outstanding reads at most. */
+static uint32_t gBaseMs = 200;          /**< Steady zone period. */
+static uint32_t gFastMs = 100;          /**< Near and edge zone period. */
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Slot of a tag, or -1.
+ */
+static int find(int16_t tag) {
+  for (int i = 0; i < RSSI_MAX_TAGS; i++) {
+    if (gTags[i].tag == tag) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Target period of a slot.
+ */
+static uint32_t periodOf(const SchedTag& t) {
+  return t.zone == RSSI_ZONE_STEADY ? gBaseMs : gFastMs;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void rssiSchedInit(RssiReadFn read, void* ctx, uint8_t maxInflight) {
+  lock();
+  memset(gTags, 0, sizeof(gTags));
+  for (SchedTag& t : gTags) t.tag = -1;
+  gRead = read;
+  gCtx = ctx;
+  gMaxInflight = maxInflight ? maxInflight : 1;
+  unlock();
+}
+
+void rssiSchedSetPeriods(uint32_t baseMs, uint32_t fastMs) {
+  lock();
+  gBaseMs = baseMs ? baseMs : 1;
+  gFastMs = fastMs ? fastMs : 1;
+  unlock();
+}
+
+bool rssiSchedAdd(int16_t tag, uint32_t nowMs) {
+  lock();
+  if (find(tag) >= 0) {
+    unlock();
+    return true;
+  }
+  int slot = find(-1);
+  if (slot >= 0) {
+    SchedTag& t = gTags[slot];
+    memset(&t, 0, sizeof(t));
+    t.tag = tag;
+    t.zone = RSSI_ZONE_STEADY;
+    t.dueMs = nowMs;
+    t.issuedMs = nowMs;
+  }
+  unlock();
+  return slot >= 0;
+}
+
+void rssiSchedRemove(int16_t tag) {
+  if (tag < 0) return;
+  lock();
+  int slot = find(tag);
+  if (slot >= 0) gTags[slot].tag = -1;
+  unlock();
+}
+
+void rssiSchedSetZone(int16_t tag, RssiZone zone) {
+  lock();
+  int slot = find(tag);
+  if (slot >= 0 && gTags[slot].zone != zone) {
+    SchedTag& t = gTags[slot];
+    t.zone = zone;
+    // Re-base on the latest read so a faster period applies to the next one
+    uint32_t due = t.issuedMs + periodOf(t);
+    if ((int32_t)(due - t.dueMs) < 0 || zone == RSSI_ZONE_STEADY) t.dueMs = due;
+  }
+  unlock();
+}
+
+RssiZone rssiZoneOf(float meters, float alertMeters) {
+  if (meters < RSSI_NEAR_METERS) return RSSI_ZONE_NEAR;
+  if (alertMeters > 0.0f) {
+    float band = alertMeters * RSSI_EDGE_BAND;
+    if (meters > alertMeters - band && meters < alertMeters + band) return RSSI_ZONE_EDGE;
+  }
+  return RSSI_ZONE_STEADY;
+}
+
+void rssiSchedOnResult(int16_t tag, bool ok, uint32_t nowMs) {
+  lock();
+  int slot = find(tag);
+  if (slot >= 0 && gTags[slot].inflight) {
+    SchedTag& t = gTags[slot];
+    t.inflight = false;
+    if (!ok) {
+      t.stats.failures++;
+    } else {
+      if (t.stats.samples == 0) {
+        t.stats.firstMs = nowMs;
+      } else if (nowMs - t.stats.lastMs > t.stats.maxGapMs) {
+        t.stats.maxGapMs = nowMs - t.stats.lastMs;
+      }
+      t.stats.samples++;
+      t.stats.lastMs = nowMs;
+    }
+  }
+  unlock();
+}
+
+uint8_t rssiSchedTick(uint32_t nowMs) {
+  int16_t batch[RSSI_MAX_TAGS];
+  uint8_t count = 0;
+
+  lock();
+  uint8_t inflight = 0;
+  for (SchedTag& t : gTags) {
+    if (t.tag < 0 || !t.inflight) continue;
+    if (nowMs - t.issuedMs >= RSSI_READ_TIMEOUT_MS) {
+      t.inflight = false;
+      t.stats.timeouts++;
+    } else {
+      inflight++;
+    }
+  }
+
+  // Pick the due tags, most overdue relative to their period first
+  while (inflight + count < gMaxInflight) {
+    int best = -1;
+    float bestLate = 0.0f;
+    for (int i = 0; i < RSSI_MAX_TAGS; i++) {
+      SchedTag& t = gTags[i];
+      if (t.tag < 0 || t.inflight) continue;
+      int32_t late = (int32_t)(nowMs - t.dueMs);
+      if (late < 0) continue;
+      float rel = (float)late / (float)periodOf(t);
+      if (best < 0 || rel > bestLate) {
+        best = i;
+        bestLate = rel;
+      }
+    }
+    if (best < 0) break;
+    SchedTag& t = gTags[best];
+    uint32_t period = periodOf(t);
+    t.inflight = true;
+    t.issuedMs = nowMs;
+    t.dueMs += period;
+    if ((int32_t)(nowMs - t.dueMs) >= (int32_t)period) t.dueMs = nowMs;  // too far behind: no burst
+    t.stats.issued++;
+    batch[count++] = t.tag;
+  }
+  unlock();
+
+  for (uint8_t k = 0; k < count; k++) {
+    if (!gRead || !gRead(batch[k], gCtx)) rssiSchedOnResult(batch[k], false, nowMs);
+  }
+  return count;
+}
+
+bool rssiSchedStats(int16_t tag, RssiTagStats* out) {
+  lock();
+  int slot = find(tag);
+  if (slot >= 0) *out = gTags[slot].stats;
+  unlock();
+  return slot >= 0;
+}
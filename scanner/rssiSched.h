@@ -0,0 +1,124 @@
+/**
+ * @file rssiSched.h
+ * @brief RSSI sampling schedule across several tag links.
+ *
+ * Each ready tag is sampled at a target period that depends on its zone:
+ * tags close to the tracker, or near the distance alert threshold where a
+ * lost/found transition is about to happen, get the fast period; the rest
+ * the base period. Every tick the scheduler starts reads for the tags that
+ * are due, most overdue (relative to their period) first, up to
+ * `maxInflight` outstanding reads at once. Starting them back to back in
+ * one tick lets the host stack queue the HCI commands to the controller
+ * together instead of one per task period; a read that gets no answer is
+ * dropped after RSSI_READ_TIMEOUT_MS. When more reads are wanted than the
+ * batch allows, the most overdue tags still go first, so fast-zone tags
+ * keep the larger share.
+ *
+ * The scheduler knows nothing about the stack: reads go out through a
+ * callback and results come back through `rssiSchedOnResult()`. Time is
+ * passed in explicitly, so the same code runs on the host.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Tags scheduled at most. */
+#ifndef RSSI_MAX_TAGS
+#define RSSI_MAX_TAGS 8
+#endif
+
+/** @brief Time after which an unanswered read is dropped (ms). */
+#define RSSI_READ_TIMEOUT_MS 500
+
+/** @brief Below this distance a tag is in the near zone (m). */
+#define RSSI_NEAR_METERS 2.0f
+
+/** @brief Half-width of the alert edge zone, as a fraction of the alert distance. */
+#define RSSI_EDGE_BAND 0.25f
+
+/**
+ * @brief Sampling zones.
+ */
+enum RssiZone : uint8_t {
+  RSSI_ZONE_STEADY = 0,   /**< Base period. */
+  RSSI_ZONE_NEAR,         /**< Close to the tracker: fast period. */
+  RSSI_ZONE_EDGE,         /**< Near the alert threshold: fast period. */
+};
+
+/**
+ * @brief Starts an RSSI read of a tag; returns false if it cannot be started.
+ *        Called outside the scheduler's lock; must not block.
+ */
+typedef bool (*RssiReadFn)(int16_t tag, void* ctx);
+
+/**
+ * @brief Counters of one tag since it was added.
+ */
+struct RssiTagStats {
+  uint32_t issued;        /**< Reads started. */
+  uint32_t samples;       /**< Results received. */
+  uint32_t failures;      /**< Reads refused or failed. */
+  uint32_t timeouts;      /**< Reads that got no answer. */
+  uint32_t maxGapMs;      /**< Longest time between two samples. */
+  uint32_t firstMs;       /**< Time of the first sample. */
+  uint32_t lastMs;        /**< Time of the latest sample. */
+};
+
+/**
+ * @brief Reset the scheduler.
+ *
+ * @param[in] read        Read callback.
+ * @param[in] ctx         Context passed to it.
+ * @param[in] maxInflight Reads outstanding at most (1 = one at a time).
+ */
+void rssiSchedInit(RssiReadFn read, void* ctx, uint8_t maxInflight);
+
+/**
+ * @brief Set the target periods (ms) of the steady and the fast zones.
+ */
+void rssiSchedSetPeriods(uint32_t baseMs, uint32_t fastMs);
+
+/**
+ * @brief Start sampling a tag (steady zone, due at once).
+ *
+ * @return False if the table is full; true if added or already present.
+ */
+bool rssiSchedAdd(int16_t tag, uint32_t nowMs);
+
+/**
+ * @brief Stop sampling a tag.
+ */
+void rssiSchedRemove(int16_t tag);
+
+/**
+ * @brief Move a tag to another zone; a faster zone takes effect at once.
+ */
+void rssiSchedSetZone(int16_t tag, RssiZone zone);
+
+/**
+ * @brief Zone of a distance estimate.
+ *
+ * @param[in] meters      Estimated distance.
+ * @param[in] alertMeters Alert threshold (0 = no alert, no edge zone).
+ */
+RssiZone rssiZoneOf(float meters, float alertMeters);
+
+/**
+ * @brief Report the result of a read (from the stack's callback).
+ */
+void rssiSchedOnResult(int16_t tag, bool ok, uint32_t nowMs);
+
+/**
+ * @brief Drop timed-out reads and start the due ones; call every task period.
+ *
+ * @return Number of reads started.
+ */
+uint8_t rssiSchedTick(uint32_t nowMs);
+
+/**
+ * @brief Copy of a tag's counters.
+ *
+ * @return False if the tag is not scheduled.
+ */
+bool rssiSchedStats(int16_t tag, RssiTagStats* out);
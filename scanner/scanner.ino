@@ -3,13 +3,21 @@
  * @brief ESP32 BLE Central with RFID and LCD UI.
  * @details
  * This sketch implements an ESP32 BLE central device that:
- * - Scans and connects to a BLE peripheral (with Button + IMU characteristics)
+ * - Scans for owned tags and keeps links to several of them (with Button + IMU
+ *   characteristics), connecting and discovering without blocking
+ * - Takes its distance and scan parameters from a runtime configuration
+ *   store (configTable.h), adjustable over the serial link
+ * - Samples the RSSI of every linked tag, faster for tags that are near or
+ *   about to cross the alert distance (rssiSched.h)
  * - Estimates distance from RSSI using a path-loss model
  * - Displays IMU movement state and distance on an I2C LCD
- * - Uses FreeRTOS tasks for concurrency (scanner, distance calc, UI, button, RFID, reset)
+ * - Fans movement and distance events out to the UI, logging, alerting and
+ *   history recording over a typed event bus (topicTable.h)
+ * - Uses FreeRTOS tasks for concurrency (scanner, distance calc, history export) and
+ *   one event-loop task for the UI, buttons and RFID, pinned per taskTable.h
  * - Integrates RC522 RFID for access control, requiring authorized UID
  *
- * @note Uses ESP32 Arduino Core 3.x (NimBLE backend).
+ * @note Uses ESP32 Arduino Core 3.x (Bluedroid backend).
  * @author
  * George Evans Daenuwy & Rasya Fawwaz
  * @date 2025-08-21
@@ -18,6 +26,8 @@
 // ==============================================
 // Includes
 // ==============================================
+#include <atomic>
+
 // FREERTOS
 #include <Arduino.h>
 #include "freertos/FreeRTOS.h"
@@ -25,19 +35,35 @@
 #include "freertos/queue.h"   
 
 // BLE CLIENT
-#include <BLEDevice.h>    /**< BLE core (ESP32 Arduino core 3.x uses NimBLE backend) */
+#include <BLEDevice.h>    /**< BLE core (Bluedroid backend) */
 #include <BLEUtils.h>
-#include <BLEClient.h>
 #include <BLEScan.h>
+#include <BLESecurity.h>
 
 #include <LiquidCrystal_I2C.h> /**< I2C LCD library */
 #include <Wire.h>              /**< I2C bus */
 #include <SPI.h>               /**< SPI bus */
 #include <MFRC522.h>           /**< RFID RC522 driver */
+#include <Preferences.h>       /**< NVS: which owned tag each bond belongs to */
 
 // ---- HELPER FUNCTIONS -----
-#include "BLEScanner.h"        /**< Custom BLE scanning logic */
+#include "BLEScanner.h"        /**< Tag links: connect, discover, notify, RSSI */
+#include "rssiSched.h"         /**< RSSI sampling schedule across tag links */
 #include "distance.h"          /**< Distance estimation from RSSI */
+#include "tagIndex.h"          /**< Rolling identifier lookup for owned tags */
+#include "rpaResolver.h"       /**< Resolvable private address resolution */
+#include "history.h"           /**< Compressed distance/movement history */
+#include "historyExport.h"     /**< Binary history export over serial */
+#include "exportFrame.h"       /**< Export frame types (config messages) */
+#include "staticAlloc.h"       /**< Static task/queue placement and RAM budget */
+#include "heapTelemetry.h"     /**< Heap snapshots and leak detection */
+#include "eventLoop.h"         /**< Timer wheel executor for light activities */
+#include "coro.h"              /**< Coroutines for sequential flows on the event loop */
+#include "taskTable.h"         /**< Core, priority and timing of every task */
+#include "buttonInput.h"       /**< Interrupt-driven, debounced buttons */
+#include "configTable.h"       /**< Runtime parameters with lock-free reads */
+#include "topicTable.h"        /**< Event bus topics and subscribers */
+#include "epochClock.h"        /**< Shared time base of the rolling identifiers */
 
 // ==============================================
 // UUIDs (must match peripheral)
@@ -45,6 +71,7 @@
 #define SERVICE_UUID "275dc6e0-dff5-4b56-9af0-584a5768a02a"  /**< Service UUID */
 #define BUTTON_CHAR_UUID "b51bd845-2910-4f84-b062-d297ed286b1f" /**< Button characteristic UUID */
 #define IMU_CHAR_UUID "0679c389-0d92-4604-aac4-664c43a51934"   /**< IMU characteristic UUID */
+#define CLOCK_CHAR_UUID "9a1f4c2e-6b7d-4e38-a5c0-3d2e8f71b607" /**< Clock characteristic UUID */
 
 // ==============================================
 // Macros / Pin Definitions
@@ -58,6 +85,29 @@
 #define PIN_SS   14   /**< RC522 chip select (SDA/SS) */
 #define PIN_RST  10   /**< RC522 reset */
 
+/** @brief Button indexes, as reported in BUTTON_LOOP_EVENT events */
+enum AppButton : uint8_t { BTN_LOST = 0, BTN_RESET = 1 };
+
+/** @brief Loop event type asking the loop to drain a bus subscriber */
+#define BUS_LOOP_EVENT 1
+
+/** @brief The distance alert re-arms below this fraction of the threshold */
+#define ALERT_REARM 0.8f
+
+/** @brief RSSI reads started back to back at most */
+#define RSSI_READ_BATCH 3
+
+/** @brief RSSI samples buffered for the distance task */
+#define RSSI_QUEUE_DEPTH 8
+
+/** @brief How often the task plan counters are printed (ms) */
+#define TASK_REPORT_MS 60000
+
+/** @brief Upper bound for statically placed FreeRTOS objects (bytes) */
+#ifndef STATIC_RAM_BUDGET
+#define STATIC_RAM_BUDGET (48 * 1024)
+#endif
+
 // ==============================================
 // Function Prototypes
 // ==============================================
@@ -65,35 +115,117 @@
 void BLEScannerTask(void *pvParameters);
 /** @brief Task to compute distance from RSSI */
 void distanceTask(void *pvParameters);
-/** @brief Task to update LCD UI */
-void UITask(void *pvParameters);
-/** @brief Task to handle button input */
-void buttonTask(void *pvParameters);
-/** @brief Task to handle RFID scanning and authorization */
-void RFIDTask(void *pvParameters);
-/** @brief Task to reset RFID and lock system */
-void resetButtonTask(void *pvParameters);
+/** @brief Event-loop task running the UI, buttons and RFID lock */
+void appLoopTask(void *pvParameters);
+/** @brief Task to serve binary history export requests over serial */
+void exportTask(void *pvParameters);
 
 // ==============================================
-// Global Task Handles
+// Global Queue Handles
 // ==============================================
-static TaskHandle_t TaskHandle_BLEScanner    = nullptr; /**< Handle for BLE scanner task */
-TaskHandle_t UITaskHandle;    /**< Handle for UI task */
-TaskHandle_t ButtonTaskHandle;/**< Handle for button task */
-TaskHandle_t RFIDTaskHandle;  /**< Handle for RFID task */
+QueueHandle_t RSSIQ;  /**< Queue for RSSI samples (RssiSample) */
+
+/**
+ * @brief One RSSI reading of a tag.
+ */
+struct RssiSample {
+  int16_t tag;   /**< Owned tag index. */
+  int16_t rssi;  /**< RSSI (dBm). */
+};
 
 // ==============================================
-// Global Queue Handles
+// Static Storage
 // ==============================================
-QueueHandle_t IMUQ;   /**< Queue for IMU moving flag */
-QueueHandle_t RSSIQ;  /**< Queue for RSSI values */
-QueueHandle_t disQ;   /**< Queue for distance values */
-QueueSetHandle_t uiSet = nullptr; /**< Queue set for UI multiplexing */
+/** @brief Task stacks and TCBs, one per task table row */
+#define X(fn, core, prio, stack, period, wcet) static TaskSlot<stack> fn##Slot;
+TASK_TABLE(X)
+#undef X
+
+/** @brief Task table rows */
+enum TaskId {
+#define X(fn, core, prio, stack, period, wcet) TASK_##fn,
+  TASK_TABLE(X)
+#undef X
+  TASK_COUNT
+};
+
+/** @brief Task plan, in table order */
+static constexpr TaskSpec TASK_PLAN[] = {
+#define X(fn, core, prio, stack, period, wcet) { #fn, core, prio, stack, period, wcet },
+  TASK_TABLE(X)
+#undef X
+};
+
+static TaskStats taskStats[TASK_COUNT];       /**< Deadline and execution counters */
+static QueueSlot<RSSI_QUEUE_DEPTH, sizeof(RssiSample)> rssiQSlot; /**< RSSIQ storage */
+
+/** @brief Event bus rings and subscribers, one per subscriber table row */
+#define X(name, depth, topics) \
+  static BusSlot name##Slots[depth]; \
+  static BusSubscriber name = { #name, topics, name##Slots, depth, 0, 0, 0, false, nullptr, nullptr };
+SUBSCRIBER_TABLE(X)
+#undef X
+
+/** @brief All subscribers, in table order */
+static BusSubscriber* const BUS_SUBSCRIBERS[] = {
+#define X(name, depth, topics) &name,
+  SUBSCRIBER_TABLE(X)
+#undef X
+};
+
+/** @brief The two copies of the configuration */
+static AppConfig configCopies[2];
+static_assert(sizeof(AppConfig) <= CONFIG_MAX_SIZE, "configuration exceeds CONFIG_MAX_SIZE");
+
+/** @brief Factory defaults from the configuration table */
+static const AppConfig CONFIG_DEFAULTS = {
+#define X(type, name, def, lo, hi, help) def,
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief Field descriptors from the configuration table */
+static const ConfigField CONFIG_FIELDS[] = {
+#define X(type, name, def, lo, hi, help) \
+  { #name, ConfigTypeOf<type>::value, offsetof(AppConfig, name), lo, hi, help },
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief Cross-field checks: the scan window must fit the interval; the fast RSSI period is the shorter one */
+static bool configCheck(const void* cfg) {
+  const AppConfig* c = static_cast<const AppConfig*>(cfg);
+  return c->scanWindow <= c->scanInterval && c->rssiFastPeriod <= c->rssiPeriod;
+}
+
+ConfigStore appConfig = {
+  { &configCopies[0], &configCopies[1] }, sizeof(AppConfig),
+  CONFIG_FIELDS, sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]), configCheck, "scanner", 0
+};
+
+/** @brief Statically placed objects, reported per subsystem at boot */
+static constexpr MemRegion MEM_BUDGET[] = {
+#define X(fn, core, prio, stack, period, wcet) { "tasks", #fn, sizeof(fn##Slot) },
+  TASK_TABLE(X)
+#undef X
+  { "ble",     "BLESecurity",      sizeof(BLESecurity) },
+  { "ble",     "RSSIQ",            sizeof(rssiQSlot) },
+#define X(name, depth, topics) { "bus", #name, sizeof(name##Slots) + sizeof(name) },
+  SUBSCRIBER_TABLE(X)
+#undef X
+  { "config",  "appConfig",        sizeof(configCopies) },
+  { "ui",      "coroFrames",       CORO_FRAME_POOL * CORO_FRAME_SIZE },
+  { "ui",      "LiquidCrystal_I2C", sizeof(LiquidCrystal_I2C) },
+  { "ui",      "MFRC522",          sizeof(MFRC522) },
+};
+static_assert(memBudgetTotal(MEM_BUDGET, sizeof(MEM_BUDGET) / sizeof(MEM_BUDGET[0])) <= STATIC_RAM_BUDGET,
+              "statically placed objects exceed STATIC_RAM_BUDGET");
 
 // ==============================================
 // Global Variables
 // ==============================================
-uint32_t startTime; /**< Timer for RSSI sampling */
+std::atomic<uint8_t> currentTag{ 0 }; /**< Owned tag index of the tag shown on the LCD */
+static std::atomic<uint8_t> tagMoving[HISTORY_MAX_TAGS]; /**< Latest movement flag per tag */
 
 // Peripheral Objects
 LiquidCrystal_I2C lcd(0x27, 16, 2); /**< I2C LCD (16x2) */
@@ -102,183 +234,470 @@ MFRC522 rfid(PIN_SS, PIN_RST);      /**< RFID reader instance */
 /** @brief Authorized UID for RFID access */
 byte AUTH_UID[] = { 0x04, 0x81, 0x70, 0x0A, 0x9C, 0x14, 0x90 };
 
+/**
+ * @brief Tags owned by this tracker and their rolling identifier keys.
+ *
+ * Each key must match `TAG_KEY` flashed into the corresponding tag. The
+ * index in this table identifies the tag everywhere: history slot, links,
+ * RSSI sampling, movement and alerts. A bonded tag resolved by its private
+ * address is mapped back to the same index.
+ */
+static const OwnedTag OWNED_TAGS[] = {
+  { "tag-1", { 0x3a, 0x91, 0x5c, 0x07, 0xe2, 0x4f, 0xb8, 0x16,
+               0xd0, 0x6b, 0x29, 0xf4, 0x83, 0x1e, 0xa5, 0x72 } },
+};
+
+/** @brief Number of owned tags */
+static constexpr size_t OWNED_COUNT = sizeof(OWNED_TAGS) / sizeof(OWNED_TAGS[0]);
+
+static_assert(OWNED_COUNT <= HISTORY_MAX_TAGS, "more owned tags than HISTORY_MAX_TAGS history slots");
+static_assert(OWNED_COUNT <= TAG_INDEX_MAX_TAGS, "more owned tags than TAG_INDEX_MAX_TAGS");
+
+/** @brief Bond list buffer (scanner task only) */
+#if defined(CONFIG_BLUEDROID_ENABLED)
+static esp_ble_bond_dev_t bondList[RPA_MAX_IRKS];
+#endif
+
 // ==============================================
-// Tasks
+// Helpers
 // ==============================================
 
+/** @brief Non-blocking serial read for the history exporter. */
+static size_t exportRead(uint8_t* buf, size_t max) {
+  size_t avail = Serial.available();
+  return avail ? Serial.readBytes(buf, avail < max ? avail : max) : 0;
+}
+
+/** @brief Serial write for the history exporter. */
+static void exportWrite(const uint8_t* buf, size_t len) {
+  Serial.write(buf, len);
+}
+
+/** @brief Millisecond clock for the history exporter. */
+static uint32_t exportMillis() {
+  return millis();
+}
+
+/** @brief Serial link used by the history exporter. */
+static const ExportIo EXPORT_IO = { exportRead, exportWrite, exportMillis };
+
 /**
- * @brief BLE scanner task.
- * - Initializes BLE central
- * - Scans for peripherals advertising the target service UUID
- * - Connects and auto-reconnects if disconnected
- * - Periodically reads RSSI and sends to RSSI queue
+ * @brief Configuration messages arriving on the export link.
+ *
+ * CONFIG_SET applies and persists one "key=value"; both it and CONFIG_GET
+ * are answered with CONFIG_STATE carrying the status and all values.
  */
-void BLEScannerTask(void *pvParameters) {
-  uint8_t btnState = 0;
-  BLEDevice::init("ESP32-UART-Central");
+static void onConfigMessage(const uint8_t* msg, size_t len) {
+  if (msg[0] != CONFIG_GET && msg[0] != CONFIG_SET) return;
+  ConfigStatus status = CONFIG_OK;
+  if (msg[0] == CONFIG_SET) {
+    char text[64];
+    size_t n = len - 1 < sizeof(text) - 1 ? len - 1 : sizeof(text) - 1;
+    memcpy(text, msg + 1, n);
+    text[n] = '\0';
+    status = configApply(&appConfig, text);
+    if (status == CONFIG_OK && !configSave(&appConfig)) Serial.println("Config: NVS save failed");
+  }
+  uint8_t body[1 + 256];
+  body[0] = status;
+  size_t n = configFormat(&appConfig, (char*)body + 1, sizeof(body) - 1);
+  historyExportSend(CONFIG_STATE, body, 1 + n);
+}
 
-  // Configure scanner
-  BLEScan* scan = BLEDevice::getScan();
-  scan->setActiveScan(true);
-  scan->setInterval(80);
-  scan->setWindow(40);
+/**
+ * @brief Apply the configured scan interval and window.
+ */
+static void applyScanConfig(BLEScan* scan) {
+  int32_t interval, window;
+  configRead<AppConfig>(&appConfig, [&](const AppConfig& c) {
+    interval = c.scanInterval;
+    window = c.scanWindow;
+  });
+  scan->setInterval(interval);
+  scan->setWindow(window);
+}
 
-  setIMUQueue(IMUQ);
+#if defined(CONFIG_BLUEDROID_ENABLED)
+/**
+ * @brief NVS key of a bond: its identity address as 12 hex digits.
+ */
+static void bondKey(const esp_ble_bond_dev_t& bond, char key[13]) {
+  for (int i = 0; i < 6; i++) snprintf(key + 2 * i, 3, "%02x", bond.bd_addr[i]);
+}
 
-  Serial.println("Scanning for peripheral advertising the service...");
+/**
+ * @brief IRK of a bond, most significant byte first.
+ *
+ * Bluedroid stores IRKs least significant byte first; the resolver expects
+ * the most significant byte first.
+ */
+static void bondIrk(const esp_ble_bond_dev_t& bond, uint8_t irk[16]) {
+  for (int b = 0; b < 16; b++) irk[b] = bond.bond_key.pid_key.irk[15 - b];
+}
+#endif
 
-  while (!connected) {
-    BLEScanResults* results = scan->start(5, false);
-    for (int i = 0; i < results->getCount() && !connected; i++) {
-      BLEAdvertisedDevice d = results->getDevice(i);
-      if (d.haveServiceUUID() && d.isAdvertisingService(svcUUID)) {
-        connected = connectToPeripheral(d.getAddress());
-      }
+/**
+ * @brief Record which owned tag the bond of a newly ready link belongs to,
+ *        and register its IRK with the RPA resolver.
+ *
+ * The link's bond is the one whose identity address the link connected to,
+ * or whose IRK resolves the private address it connected to. The owned tag
+ * index is kept in NVS next to the bond, so it survives a reboot. Only this
+ * IRK is added (or replaced), so the resolver keeps its cache, hit order
+ * and statistics across links.
+ *
+ * @param[in] tag  Owned tag index of the link.
+ * @param[in] link Link index.
+ */
+static void rememberBond(int16_t tag, uint8_t link) {
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  Link l;
+  if (tag < 0 || (size_t)tag >= OWNED_COUNT || !connManagerGet(link, &l)) return;
+  int count = RPA_MAX_IRKS;
+  if (esp_ble_get_bond_device_list(&count, bondList) != ESP_OK) return;
+  for (int i = 0; i < count; i++) {
+    const esp_ble_bond_dev_t& bond = bondList[i];
+    if (!(bond.bond_key.key_mask & ESP_BLE_ID_KEY_MASK)) continue;
+    bool match = memcmp(bond.bd_addr, l.addr.bda, sizeof(esp_bd_addr_t)) == 0;
+    if (!match && rpaIsResolvable(l.addr.bda)) {
+      uint8_t irk[16], hash[3];
+      bondIrk(bond, irk);
+      rpaHash(irk, l.addr.bda, hash);
+      match = memcmp(hash, &l.addr.bda[3], 3) == 0;
     }
-    if (!connected) Serial.println("Not found yet. Rescanning...");
+    if (!match) continue;
+    char key[13];
+    bondKey(bond, key);
+    Preferences prefs;
+    if (!prefs.begin("bonds", false)) return;
+    if (prefs.getUInt(key, OWNED_COUNT) != (uint32_t)tag) prefs.putUInt(key, (uint32_t)tag);
+    prefs.end();
+    uint8_t irk[16];
+    bondIrk(bond, irk);
+    if (!rpaAddIrk(irk, tag)) Serial.println("IRK table full.");
+    return;
   }
+#endif
+}
 
-  startTime = millis();
-  while(1){
-    if (connected && client && !client->isConnected()) {
-      Serial.println("Disconnected. Rescanning...");
-      connected = false;
-      btnRemoteChar = nullptr;
-      imuRemoteChar = nullptr;
-      client->disconnect();
-
-      BLEScan* scan = BLEDevice::getScan();
-      while (!connected) {
-        BLEScanResults* results = scan->start(5, false);
-        for (int i = 0; i < results->getCount() && !connected; i++) {
-          BLEAdvertisedDevice d = results->getDevice(i);
-          if (d.haveServiceUUID() && d.isAdvertisingService(svcUUID)) {
-            connected = connectToPeripheral(d.getAddress());
-          }
-        }
-        if (!connected) Serial.println("Still searching...");
+/**
+ * @brief Load the IRKs of all bonded owned tags into the RPA resolver at boot.
+ *
+ * The resolver identifier is the owned tag index recorded by rememberBond();
+ * bonds not recorded as one of ours are skipped.
+ */
+static void loadBondedIrks() {
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  int count = RPA_MAX_IRKS;
+  rpaClear();
+  if (esp_ble_get_bond_device_list(&count, bondList) != ESP_OK) return;
+  Preferences prefs;
+  bool known = prefs.begin("bonds", true);
+  int loaded = 0;
+  for (int i = 0; i < count; i++) {
+    const esp_ble_bond_dev_t& bond = bondList[i];
+    if (!known || !(bond.bond_key.key_mask & ESP_BLE_ID_KEY_MASK)) continue;
+    char key[13];
+    bondKey(bond, key);
+    uint32_t tag = prefs.getUInt(key, OWNED_COUNT);
+    if (tag >= OWNED_COUNT) continue;
+    uint8_t irk[16];
+    bondIrk(bond, irk);
+    if (rpaAddIrk(irk, (int16_t)tag)) loaded++;
+  }
+  if (known) prefs.end();
+  Serial.printf("Loaded %d IRK(s) of %d bond(s).\n", loaded, count);
+#endif
+}
+
+/**
+ * @brief Record a heap snapshot at a lifecycle point and report it over serial.
+ *
+ * Connect and disconnect snapshots are always printed; scan snapshots only
+ * when growth is flagged, since scans repeat every few seconds.
+ */
+static void heapCheckpoint(HeapPoint point) {
+  const HeapSnapshot* s = heapTelemetrySnapshot(point);
+  if (!s) return;
+  if ((point == HEAP_SCAN_START || point == HEAP_SCAN_STOP) && !s->growing) return;
+  char line[160];
+  heapTelemetryFormat(s, line, sizeof(line));
+  Serial.println(line);
+}
+
+/**
+ * @brief Check whether an advertisement comes from an owned tag.
+ *
+ * A tag is recognised either by a resolvable private address matching a
+ * bonded IRK (answered from the resolver cache on repeat sightings), or by
+ * the rolling identifier carried in its manufacturer data. The tag index
+ * must have been refreshed for the current window.
+ *
+ * @param[in] d Advertised device from a scan result.
+ * @return Owned tag index, or -1 if the advertisement is not from an owned tag.
+ */
+static int16_t isOwnedTag(BLEAdvertisedDevice& d) {
+  BLEAddress addr = d.getAddress();
+  int16_t tag = rpaResolve((const uint8_t*)addr.getNative());
+  if (tag >= 0 || !d.haveManufacturerData()) return tag;
+  String mfr = d.getManufacturerData();
+  return tagIndexIdentify((const uint8_t*)mfr.c_str(), mfr.length()).tag;
+}
+
+/**
+ * @brief Publish the movement flag of each IMU notification.
+ */
+static void onImuFlag(int16_t tag, uint8_t moving) {
+  if (tag < 0 || (size_t)tag >= OWNED_COUNT) return;
+  tagMoving[tag].store(moving, std::memory_order_relaxed);
+  busPublish<TOPIC_MOVING>(MovingEvent{ (uint8_t)tag, moving });
+}
+
+/**
+ * @brief Start an RSSI read for the scheduler.
+ */
+static bool rssiRead(int16_t tag, void*) {
+  return bleLinkReadRssi(tag);
+}
+
+/**
+ * @brief Complete the scheduled read and pass the sample to the distance task.
+ */
+static void onRssi(int16_t tag, int rssi) {
+  rssiSchedOnResult(tag, true, millis());
+  RssiSample s = { tag, (int16_t)rssi };
+  xQueueSend(RSSIQ, &s, 0);
+}
+
+/**
+ * @brief Publish each link state change.
+ */
+static void onLinkProgress(uint8_t link, const Link* l) {
+  busPublish<TOPIC_LINK>(LinkEvent{ l->tag, link, l->state, l->readyMs });
+}
+
+/** @brief Links to keep: one per owned tag, up to the controller's limit */
+static const uint8_t TAG_LINKS = OWNED_COUNT < CONN_MAX_LINKS ? OWNED_COUNT : CONN_MAX_LINKS;
+
+/**
+ * @brief Set by the scan-complete callback, handled in the scanner task.
+ *
+ * The BLE stack fills the result list before it calls the callback; the
+ * release store and the task's acquire exchange make those inserts visible
+ * to `handleScanResults()`, which only reads the list after taking the flag.
+ */
+static std::atomic<bool> scanDone{ false };
+
+/** @brief A background scan is running (scanner task only) */
+static bool scanning = false;
+
+/**
+ * @brief Scan-complete callback (BLE stack context).
+ */
+static void onScanComplete(BLEScanResults) {
+  scanDone.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Start a scan in the background; a refused start is retried on the next period.
+ */
+static void startScan(BLEScan* scan) {
+  applyScanConfig(scan);
+  heapCheckpoint(HEAP_SCAN_START);
+  scanning = scan->start(5, onScanComplete, false);
+}
+
+/**
+ * @brief Ask for a link to every owned tag in the finished scan.
+ *
+ * A tag is logged only when it comes into or goes out of range (neither
+ * advertising nor linked), not on every scan.
+ */
+static void handleScanResults(BLEScan* scan) {
+  static bool inRange[OWNED_COUNT] = {};
+  bool seen[OWNED_COUNT] = {};
+  scanning = false;
+  heapCheckpoint(HEAP_SCAN_STOP);
+  tagIndexRefresh(epochClockNow()); // once per scan; rebuilds only on a window rollover
+  BLEScanResults* results = scan->getResults();
+  for (int i = 0; i < results->getCount(); i++) {
+    BLEAdvertisedDevice d = results->getDevice(i);
+    int16_t tag = isOwnedTag(d);
+    if (tag < 0) continue;
+    seen[tag] = true;
+    if (!inRange[tag]) {
+      Serial.printf("Owned tag %s in range at %s", OWNED_TAGS[tag].name, d.getAddress().toString().c_str());
+      String mfr = d.haveManufacturerData() ? d.getManufacturerData() : String();
+      if (mfr.length() >= ROLLING_MFR_BATTERY_LEN && (uint8_t)mfr[ROLLING_MFR_LEN] <= 100) {
+        Serial.printf(", battery %u%%", (uint8_t)mfr[ROLLING_MFR_LEN]);
       }
+      Serial.println();
     }
-    if (connected && client && client->isConnected() && (millis() - startTime > 200)) {
-      startTime = millis();
-      int rssi = client->getRssi();
-      xQueueOverwrite(RSSIQ, &rssi);
+    if (!bleLinkRequest(tag, d.getAddress(), d.getAddressType())) {
+      Serial.println("No free link for the tag.");
     }
-    vTaskDelay(pdMS_TO_TICKS(31));
   }
+  for (size_t t = 0; t < OWNED_COUNT; t++) {
+    bool present = seen[t] || connManagerFind((int16_t)t) >= 0; // a linked tag stops advertising
+    if (inRange[t] && !present) Serial.printf("Owned tag %s out of range\n", OWNED_TAGS[t].name);
+    inRange[t] = present;
+  }
+  scan->clearResults(); // release the result list before the next scan
 }
 
 /**
- * @brief Distance estimation task.
- * - Consumes RSSI values
- * - Smooths RSSI
- * - Converts to distance estimate
- * - Sends result to distance queue
+ * @brief Scanner subscriber: sample the RSSI of ready tags, snapshot the
+ *        heap as links come and go, pick up the IRK of a tag bonded on a
+ *        new link and set its clock to ours, so its rolling identifiers stay
+ *        within the index's window. The LCD follows a new tag while its tag
+ *        has no link.
  */
-void distanceTask(void *pvParameters) {
-  int rssi = 0;
-  while(1){
-    if (xQueueReceive(RSSIQ, &rssi, portMAX_DELAY) == pdTRUE) {
-      updateRssiAvg(rssi);
-      float distance = estimateDistanceMeters(rssiAvg, txPower, nFactor);
-      Serial.printf("Raw RSSI: %d dBm | Smoothed RSSI: %.2f dBm | Distance: %.2f m\n", rssi, rssiAvg, distance);
-      xQueueOverwrite(disQ, &distance);
+static void onScannerMsg(const BusMsg* msg, void*) {
+  static uint8_t last[CONN_MAX_LINKS] = {};
+  const LinkEvent* e = busEvent<TOPIC_LINK>(msg);
+  if (!e || e->link >= CONN_MAX_LINKS) return;
+  if (e->state == LINK_READY) {
+    heapCheckpoint(HEAP_CONNECT);
+    rememberBond(e->tag, e->link);
+    if (!bleLinkWriteClock(e->tag, epochClockNow())) Serial.println("Tag clock not set.");
+    rssiSchedAdd(e->tag, millis());
+    if (connManagerFind(currentTag.load(std::memory_order_relaxed)) < 0) {
+      currentTag.store((uint8_t)e->tag, std::memory_order_relaxed);
     }
+  } else if (last[e->link] == LINK_READY) {
+    heapCheckpoint(HEAP_DISCONNECT);
+    rssiSchedRemove(e->tag);
   }
-  vTaskDelay(pdMS_TO_TICKS(20));
+  last[e->link] = e->state;
 }
 
 /**
- * @brief UI task.
- * - Displays distance and movement state on LCD
- * - Consumes from IMUQ and distance queue
+ * @brief History recorder: store each distance estimate.
+ *
+ * The sample is timestamped with the publish time, not the (later) drain.
  */
-void UITask(void *pvParameters) {
-  lcd.init();
-  lcd.backlight();
-  lcd.clear();
-  uint8_t movingFlag;
-  float distance;
-  vTaskSuspend(NULL);
-  for (;;) {
-     xQueueSetMemberHandle member =
-        xQueueSelectFromSet(uiSet, portMAX_DELAY);
-
-     if (member == IMUQ) {
-      uint8_t movingFlag;
-      if (xQueueReceive(IMUQ, &movingFlag, 0) == pdTRUE) {
-        lcd.setCursor(0, 1);
-        if (movingFlag) {
-          lcd.print("moving!     ");
-          Serial.println("device is moving!");
-        } else {
-          lcd.print("not moving  ");
-          Serial.println("Device is not moving");
-        }
-      }
-    } else if (member == disQ) {
-      float distance;
-      if (xQueueReceive(disQ, &distance, 0) == pdTRUE) {
-        lcd.setCursor(0, 0);
-        lcd.print("distance: ");
-        lcd.print(distance, 2);
-        lcd.print(" m   ");
-        Serial.printf("distance %.2f\n", distance);
-      }
+static void onHistoryMsg(const BusMsg* msg, void*) {
+  const DistanceEvent* e = busEvent<TOPIC_DISTANCE>(msg);
+  if (!e) return;
+  uint64_t ageMs = (uint32_t)(busNowUs() - msg->timeUs) / 1000;
+  historyAppend(e->tag, epochClockNowMs() - ageMs, e->meters, e->moving);
+}
+
+// ==============================================
+// Tasks
+// ==============================================
+
+/**
+ * @brief BLE scanner task.
+ * - Initializes BLE central and the tag links
+ * - Scans in the background for owned tags (rolling identifier or bonded
+ *   address) while any of them has no ready link
+ * - Hands sighted tags to the connection manager, which connects, discovers
+ *   and reconnects without blocking this task
+ * - Snapshots the heap around scans, connects and disconnects
+ * - Reads the RSSI of ready tags on the scheduler's plan and sends it to the RSSI queue
+ * - Publishes the tags' IMU notifications on the event bus
+ */
+void BLEScannerTask(void *pvParameters) {
+  (void)pvParameters;
+  BLEDevice::init("ESP32-UART-Central");
+
+  // Bond with tags so they can advertise from resolvable private addresses
+  static BLESecurity security;
+  security.setAuthenticationMode(ESP_LE_AUTH_BOND);
+  security.setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+  security.setRespEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+  BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
+  loadBondedIrks();
+
+  setIMUHandler(onImuFlag);
+  setRssiHandler(onRssi);
+  setLinkHandler(onLinkProgress);
+  if (!bleLinksBegin(TAG_LINKS)) Serial.println("Tag links unavailable.");
+  rssiSchedInit(rssiRead, nullptr, RSSI_READ_BATCH);
+
+  // Configure scanner
+  BLEScan* scan = BLEDevice::getScan();
+  scan->setActiveScan(true);
+
+  Serial.println("Scanning for owned tags...");
+  startScan(scan);
+
+  taskPeriodStart(TASK_BLEScannerTask);
+  while(1){
+    bleLinksTick();
+    busDrain(&scannerSub, onScannerMsg, nullptr);
+    if (scanDone.exchange(false, std::memory_order_acquire)) {
+      handleScanResults(scan);
+      if (!connected.load(std::memory_order_relaxed)) Serial.println("Not found yet. Rescanning...");
     }
-    vTaskDelay(pdMS_TO_TICKS(100));
+    if (!scanning && connManagerReadyCount() < TAG_LINKS) {
+      startScan(scan); // also after a link was lost
+    }
+    int32_t rssiPeriod, rssiFastPeriod;
+    configRead<AppConfig>(&appConfig, [&](const AppConfig& c) {
+      rssiPeriod = c.rssiPeriod;
+      rssiFastPeriod = c.rssiFastPeriod;
+    });
+    rssiSchedSetPeriods(rssiPeriod, rssiFastPeriod);
+    rssiSchedTick(millis());
+    taskPeriodWait(TASK_BLEScannerTask);
   }
 }
 
 /**
- * @brief Button task.
- * - Reads button press with debouncing
- * - Sends state via BLE
+ * @brief Distance estimation task.
+ * - Consumes RSSI samples of all linked tags
+ * - Smooths RSSI per tag
+ * - Converts to distance estimate with the configured path-loss parameters,
+ *   with its variance (the line host/trilatTool reads from each anchor)
+ * - Moves the tag to its RSSI sampling zone (near, alert edge or steady)
+ * - Publishes the estimate with the tag's movement state on the event bus
  */
-void buttonTask(void *pvParameters) {
-  pinMode(BUZZER_PIN, INPUT_PULLUP);
-  bool lastButton = HIGH;
-  vTaskSuspend(NULL);
-  while (1) {
-    bool currentButton = digitalRead(BUZZER_PIN);
-    if (lastButton == HIGH && currentButton == LOW) {
-      Serial.println("pressed");
-      writeBtnState(true); 
+void distanceTask(void *pvParameters) {
+  (void)pvParameters;
+  static RssiAverage averages[HISTORY_MAX_TAGS];
+  RssiSample sample;
+  while(1){
+    if (xQueueReceive(RSSIQ, &sample, portMAX_DELAY) == pdTRUE) {
+      if (sample.tag < 0 || (size_t)sample.tag >= OWNED_COUNT) continue;
+      uint8_t tag = (uint8_t)sample.tag;
+      float txPower, nFactor, alpha, alertDistance;
+      configRead<AppConfig>(&appConfig, [&](const AppConfig& c) {
+        txPower = c.txPower;
+        nFactor = c.nFactor;
+        alpha = c.rssiAlpha;
+        alertDistance = c.alertDistance;
+      });
+      float avg = rssiAverageUpdate(&averages[tag], sample.rssi, alpha);
+      float distance = estimateDistanceMeters(avg, txPower, nFactor);
+      float variance = distanceVariance(distance, nFactor, averages[tag].var, alpha);
+      Serial.printf("Tag %u | Raw RSSI: %d dBm | Smoothed RSSI: %.2f dBm | Distance: %.2f m | Var: %.3f m2\n",
+                    tag, sample.rssi, avg, distance, variance);
+      rssiSchedSetZone(sample.tag, rssiZoneOf(distance, alertDistance));
+      DistanceEvent ev = { distance, avg, variance, tag, tagMoving[tag].load(std::memory_order_relaxed) };
+      busPublish<TOPIC_DISTANCE>(ev);
     }
-    lastButton = currentButton;
-    vTaskDelay(pdMS_TO_TICKS(100));
   }
+  vTaskDelay(pdMS_TO_TICKS(20));
 }
 
 /**
- * @brief Reset button task.
- * - Debounced reset button input
- * - Resets RFID and locks system
- * - Suspends UI and button tasks
+ * @brief History export task.
+ * - Parses export requests arriving on the serial port
+ * - Streams framed history chunks and handles acknowledgements
+ * - Answers configuration requests on the same link
+ * - Records distance events from the bus in the history store
+ * - Polls quickly while a transfer is active, slowly otherwise
  */
-void resetButtonTask(void *pvParameters) {
-  unsigned long lastBtnChange = 0;
-  bool lastBtnState = HIGH;
-  pinMode(RESET_PIN, INPUT_PULLUP);
+void exportTask(void *pvParameters) {
+  (void)pvParameters;
+  historyExportInit(&EXPORT_IO);
+  historyExportOnMessage(onConfigMessage);
   for (;;) {
-    bool now = digitalRead(RESET_PIN);
-    unsigned long time = millis();
-    if(now != lastBtnState && ((time - lastBtnChange) > 40)) {
-      lastBtnChange = time;
-      lastBtnState = now;
-      if(now == LOW){
-        rfid.PCD_Reset();
-        rfid.PCD_Init();
-        Serial.println("RFID reset.");
-        Serial.println("RFID Locked.");
-        lcd.clear();
-        lcd.print("Locked."); 
-        vTaskSuspend(ButtonTaskHandle);
-        vTaskSuspend(UITaskHandle);
-        vTaskResume(RFIDTaskHandle);
-      }
-    }
-    vTaskDelay(pdMS_TO_TICKS(50));
+    busDrain(&historySub, onHistoryMsg, nullptr);
+    historyExportPoll();
+    vTaskDelay(pdMS_TO_TICKS(historyExportActive() ? 1 : 50));
   }
 }
 
@@ -295,23 +714,190 @@ bool isAuthorized() {
   return true;
 }
 
+// ==============================================
+// Application Loop
+// ==============================================
+// The UI refresh is a timer callback on a single event-loop task; button
+// gestures arrive as loop events and the RFID unlock sequence is a coroutine
+// on the same loop. Logging and alerting are bus subscribers whose notify
+// hook posts a BUS_LOOP_EVENT, so they run on the loop as events arrive.
+
+/** @brief RFID lock state; while locked the UI and lost-mode button are inactive */
+static bool locked = true;
+
+static LoopTimer uiTimer;     /**< UI refresh (100 ms) */
+static LoopTimer alertTimer;  /**< Ends the alert beep */
+
 /**
- * @brief RFID task.
- * - Waits for RFID card
- * - Prints UID to Serial
- * - Grants access if authorized
- * - Resumes UI and button tasks on success
+ * @brief Latest values shown on the LCD.
  */
-void RFIDTask(void *pvParameters) {
-  rfid.PCD_Init();
-  ledcAttach(RFID_PIN, 1000, 11);
-  rfid.PCD_DumpVersionToSerial();
-  Serial.println("RFID Locked");
-  while (1) {
-    if (!rfid.PICC_IsNewCardPresent()) {
-      continue;
+struct UiState {
+  float   distance;       /**< Last distance estimate. */
+  uint8_t moving;         /**< Last movement flag. */
+  bool    distanceDirty;  /**< Distance changed since it was drawn. */
+  bool    movingDirty;    /**< Movement changed since it was drawn. */
+};
+
+static UiState ui = { 0.0f, 0, false, false };
+
+/**
+ * @brief UI subscriber: keep the latest values of the tag shown.
+ */
+static void onUiMsg(const BusMsg* msg, void*) {
+  if (const MovingEvent* m = busEvent<TOPIC_MOVING>(msg)) {
+    if (m->tag != currentTag.load(std::memory_order_relaxed)) return;
+    ui.moving = m->moving;
+    ui.movingDirty = true;
+  } else if (const DistanceEvent* d = busEvent<TOPIC_DISTANCE>(msg)) {
+    if (d->tag != currentTag.load(std::memory_order_relaxed)) return;
+    ui.distance = d->meters;
+    ui.distanceDirty = true;
+  }
+}
+
+/**
+ * @brief UI refresh.
+ * - Drains the UI subscriber (also while locked, keeping the latest values)
+ * - Displays distance and movement state on LCD
+ */
+static void uiTick(LoopTimer*, void*) {
+  busDrain(&uiSub, onUiMsg, nullptr);
+  if (locked) return;
+  if (ui.movingDirty) {
+    lcd.setCursor(0, 1);
+    lcd.print(ui.moving ? "moving!     " : "not moving  ");
+    ui.movingDirty = false;
+  }
+  if (ui.distanceDirty) {
+    lcd.setCursor(0, 0);
+    lcd.print("distance: ");
+    lcd.print(ui.distance, 2);
+    lcd.print(" m   ");
+    ui.distanceDirty = false;
+  }
+}
+
+/**
+ * @brief Log subscriber: print movement changes, distances and link progress.
+ */
+static void onLogMsg(const BusMsg* msg, void*) {
+  if (const MovingEvent* m = busEvent<TOPIC_MOVING>(msg)) {
+    Serial.println(m->moving ? "device is moving!" : "Device is not moving");
+  } else if (const DistanceEvent* d = busEvent<TOPIC_DISTANCE>(msg)) {
+    Serial.printf("distance %.2f\n", d->meters);
+  } else if (const LinkEvent* l = busEvent<TOPIC_LINK>(msg)) {
+    if (l->state == LINK_READY) {
+      Serial.printf("Link %u: tag %d ready after %u ms\n", l->link, l->tag, (unsigned)l->readyMs);
+    } else {
+      Serial.printf("Link %u: tag %d %s\n", l->link, l->tag, linkStateName((LinkState)l->state));
     }
-    if (!rfid.PICC_ReadCardSerial()) continue;
+  }
+}
+
+/**
+ * @brief Stop the alert beep.
+ */
+static void alertOff(LoopTimer*, void*) {
+  ledcWriteTone(RFID_PIN, 0);
+}
+
+/**
+ * @brief Alert subscriber: warn once when a tag moves beyond the
+ *        configured distance; re-arm when it comes back within ALERT_REARM
+ *        of it. The beep sounds only while unlocked.
+ */
+static void onAlertMsg(const BusMsg* msg, void*) {
+  static bool alertedTags[HISTORY_MAX_TAGS] = {};
+  const DistanceEvent* d = busEvent<TOPIC_DISTANCE>(msg);
+  if (!d || d->tag >= HISTORY_MAX_TAGS) return;
+  bool& alerted = alertedTags[d->tag];
+  float limit;
+  configRead<AppConfig>(&appConfig, [&](const AppConfig& c) { limit = c.alertDistance; });
+  if (limit <= 0.0f) return;
+
+  if (!alerted && d->meters > limit) {
+    alerted = true;
+    Serial.printf("Alert: tag %u beyond %.1f m (%.2f m)\n", d->tag, limit, d->meters);
+    if (!locked) {
+      ledcWriteTone(RFID_PIN, 2000);
+      loopTimerStart(&alertTimer, 300, 0, alertOff, nullptr);
+    }
+  } else if (alerted && d->meters < limit * ALERT_REARM) {
+    alerted = false;
+  }
+}
+
+/**
+ * @brief Subscribers drained on the loop, indexed by the BUS_LOOP_EVENT arg.
+ */
+struct LoopSubscriber {
+  BusSubscriber* sub;  /**< Subscriber. */
+  BusHandler     fn;   /**< Its handler. */
+};
+
+static const LoopSubscriber LOOP_SUBSCRIBERS[] = {
+  { &logSub,   onLogMsg },
+  { &alertSub, onAlertMsg },
+};
+
+/**
+ * @brief Bus notify hook: ask the loop to drain the subscriber.
+ */
+static void postBusEvent(BusSubscriber*, void* ctx) {
+  LoopEvent e = {};
+  e.type = BUS_LOOP_EVENT;
+  e.arg = (uint8_t)(uintptr_t)ctx;
+  e.timeUs = (uint32_t)micros();
+  eventLoopPost(&e);
+}
+
+/**
+ * @brief Drain the subscriber named by a BUS_LOOP_EVENT.
+ */
+static void onBusEvent(const LoopEvent* e, void*) {
+  const LoopSubscriber& s = LOOP_SUBSCRIBERS[e->arg];
+  busDrain(s.sub, s.fn, nullptr);
+}
+
+/**
+ * @brief Button gesture handler.
+ * - Lost-mode button press: sends state via BLE (while unlocked)
+ * - Reset button press: resets RFID and locks system
+ */
+static void onButton(const LoopEvent* e, void*) {
+  if (e->value != BUTTON_PRESS) return;
+  uint32_t latencyUs = (uint32_t)micros() - e->timeUs;
+
+  if (e->arg == BTN_LOST && !locked) {
+    Serial.printf("pressed (%u us ago)\n", (unsigned)latencyUs);
+    writeBtnState(true);
+  } else if (e->arg == BTN_RESET) {
+    rfid.PCD_Reset();
+    rfid.PCD_Init();
+    Serial.println("RFID reset.");
+    Serial.println("RFID Locked.");
+    lcd.clear();
+    lcd.print("Locked.");
+    locked = true;
+  }
+}
+
+/**
+ * @brief True once a new card has been read while locked.
+ */
+static bool cardPresented(void*) {
+  return locked && rfid.PICC_IsNewCardPresent() && rfid.PICC_ReadCardSerial();
+}
+
+/**
+ * @brief RFID unlock flow.
+ * - Waits for a card while locked (polled every 50 ms)
+ * - Prints UID to Serial
+ * - Grants access if authorized: beeps for 500 ms, then unlocks
+ */
+static CoroTask rfidFlow() {
+  for (;;) {
+    co_await coroPoll(cardPresented, nullptr, 50);
 
     Serial.print("UID:");
     for (byte i = 0; i < rfid.uid.size; i++) {
@@ -321,18 +907,38 @@ void RFIDTask(void *pvParameters) {
     }
     Serial.println();
 
-    if(isAuthorized()){
-      ledcWriteTone(RFID_PIN, 1000);
-      vTaskDelay(pdMS_TO_TICKS(500));
-      ledcWriteTone(RFID_PIN, 0);
-      vTaskResume(UITaskHandle);
-      vTaskResume(ButtonTaskHandle);
-      vTaskSuspend(NULL);
-    }
-    vTaskDelay(pdMS_TO_TICKS(50));
+    if (!isAuthorized()) continue;
+    ledcWriteTone(RFID_PIN, 1000);
+    co_await coroDelay(500);
+    ledcWriteTone(RFID_PIN, 0);
+    locked = false;
+    ui.movingDirty = ui.distanceDirty = true;
   }
 }
 
+/**
+ * @brief Application loop task.
+ * - Initializes LCD, buttons and RFID reader
+ * - Runs the UI, bus subscribers, button gestures and the RFID flow on the event loop
+ */
+void appLoopTask(void *pvParameters) {
+  (void)pvParameters;
+  lcd.init();
+  lcd.backlight();
+  lcd.clear();
+  rfid.PCD_Init();
+  ledcAttach(RFID_PIN, 1000, 11);
+  rfid.PCD_DumpVersionToSerial();
+  Serial.println("RFID Locked");
+
+  loopTimerStart(&uiTimer, 100, 100, uiTick, nullptr);
+  static const uint8_t buttonPins[] = { BUZZER_PIN, RESET_PIN }; // BTN_LOST, BTN_RESET
+  if (!buttonInputBegin(buttonPins, sizeof(buttonPins))) Serial.println("Button input unavailable.");
+  coroInit();
+  rfidFlow();
+  eventLoopRun();
+}
+
 // ==============================================
 // Arduino entry points
 // ==============================================
@@ -343,13 +949,60 @@ void RFIDTask(void *pvParameters) {
  */
 void setup() {
   Serial.begin(115200);
+  heapTelemetryInit(nullptr);
+  configInit(&appConfig, &CONFIG_DEFAULTS);
+  if (configLoad(&appConfig)) Serial.println("Configuration loaded from NVS.");
   svcUUID = BLEUUID(SERVICE_UUID);
   btnUUID = BLEUUID(BUTTON_CHAR_UUID);
   imuUUID = BLEUUID(IMU_CHAR_UUID);
+  clockUUID = BLEUUID(CLOCK_CHAR_UUID);
+
+  RSSIQ = queueCreate(rssiQSlot);
+  if (!busInit(BUS_SUBSCRIBERS, sizeof(BUS_SUBSCRIBERS) / sizeof(BUS_SUBSCRIBERS[0]))) {
+    Serial.println("Event bus: bad subscriber table");
+  }
+  // The loop and its bus hooks exist before any task can publish or post
+  eventLoopInit(millis());
+  eventLoopOn(BUTTON_LOOP_EVENT, onButton, nullptr);
+  eventLoopOn(BUS_LOOP_EVENT, onBusEvent, nullptr);
+  for (size_t i = 0; i < sizeof(LOOP_SUBSCRIBERS) / sizeof(LOOP_SUBSCRIBERS[0]); i++) {
+    busOnNotify(LOOP_SUBSCRIBERS[i].sub, postBusEvent, (void*)(uintptr_t)i);
+  }
+
+  if (!historyInit()) Serial.println("History partition not found; history disabled.");
+  if (!epochClockBegin("clock")) Serial.println("Clock: no saved epoch, starting at 0.");
+  // The saved epoch can trail the newest history by up to a window
+  uint64_t historyMs = historyLatestMs();
+  if (historyMs && epochClockAtLeast((uint32_t)(historyMs / 1000) + 1)) {
+    Serial.printf("Clock: moved to %u s, after the stored history.\n", epochClockNow());
+  }
+  tagIndexInit(OWNED_TAGS, OWNED_COUNT, epochClockNow());
 
-  IMUQ = xQueueCreate(1, sizeof(uint8_t));
-  RSSIQ = xQueueCreate(1, sizeof(int));
-  disQ = xQueueCreate(1, sizeof(float));
+  Wire.begin();
+  SPI.begin(PIN_SCK, PIN_MISO, PIN_MOSI, PIN_SS);
 
-  uiSet = xQueueCreateSet(1 + 1);
-  xQueueAddToSet(IMUQ, uiS
+  // Create tasks from the task table, each pinned to its core
+  taskPlanInit(TASK_PLAN, taskStats, TASK_COUNT);
+#define X(fn, core, prio, stack, period, wcet) taskCreate(fn##Slot, fn, #fn, prio, core);
+  TASK_TABLE(X)
+#undef X
+
+  memBudgetReport(MEM_BUDGET, sizeof(MEM_BUDGET) / sizeof(MEM_BUDGET[0]));
+  taskPlanReport();
+  heapCheckpoint(HEAP_BOOT);
+}
+
+/**
+ * @brief Arduino loop function (tasks handle logic).
+ * Prints the task plan counters and any bus drops every TASK_REPORT_MS,
+ * and saves the epoch counter once per rolling window.
+ */
+void loop() {
+  delay(TASK_REPORT_MS);
+  epochClockSave();
+  taskPlanReport();
+  for (BusSubscriber* s : BUS_SUBSCRIBERS) {
+    uint32_t dropped = s->dropped.load(std::memory_order_relaxed);
+    if (dropped) Serial.printf("Bus: %s dropped %u events\n", s->name, (unsigned)dropped);
+  }
+}
@@ -0,0 +1,173 @@
+/**
+ * @file tagIndex.cpp
+ * @brief Implementation of the rolling identifier lookup index.
+ *
+ * The index keeps three open-addressing hash tables, one per window slot
+ * (previous, current, next). Slot `w % 3` holds the identifiers of window
+ * `w`, so when time advances by one window only the oldest slot has to be
+ * recomputed and the other two are reused as-is.
+ *
+ * Identifiers are already uniformly distributed PRF outputs, so the low bits
+ * of the identifier are used directly as the hash.
+ */
+
+#include "tagIndex.h"
+
+// ============================================================================
+// Table Layout
+// ============================================================================
+
+/**
+ * @brief Smallest power of two holding `n` tags at no more than 50% load.
+ */
+static constexpr size_t capacityFor(size_t n) {
+  size_t cap = 1;
+  while (cap < 2 * n) cap <<= 1;
+  return cap;
+}
+
+/** @brief Slots per window table. */
+static constexpr size_t TAG_INDEX_CAP = capacityFor(TAG_INDEX_MAX_TAGS);
+
+/** @brief Number of windows kept in the index (previous, current, next). */
+#define TAG_INDEX_WINDOWS 3
+
+/**
+ * @brief One hash slot.
+ */
+struct IndexSlot {
+  uint64_t id;   /**< Expected identifier. */
+  int16_t  tag;  /**< Owned tag index, -1 when the slot is empty. */
+};
+
+/**
+ * @brief Hash table for a single rotation window.
+ */
+struct WindowTable {
+  uint32_t  window;                  /**< Window index this table was built for. */
+  bool      valid;                   /**< True once the table has been built. */
+  IndexSlot slots[TAG_INDEX_CAP];    /**< Open-addressing slots. */
+};
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/** @brief Owned tag table supplied by the application. */
+static const OwnedTag* gTags = nullptr;
+
+/** @brief Number of owned tags in use. */
+static size_t gTagCount = 0;
+
+/** @brief Current rotation window. */
+static uint32_t gWindow = 0;
+
+/** @brief Per-window hash tables, indexed by `window % TAG_INDEX_WINDOWS`. */
+static WindowTable gTables[TAG_INDEX_WINDOWS];
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Compute all identifiers of one window into its table.
+ *
+ * @param[in] window Window index to build.
+ */
+static void buildWindow(uint32_t window) {
+  WindowTable& t = gTables[window % TAG_INDEX_WINDOWS];
+  for (size_t i = 0; i < TAG_INDEX_CAP; i++) t.slots[i].tag = -1;
+
+  for (size_t tag = 0; tag < gTagCount; tag++) {
+    uint64_t id = rollingIdFor(gTags[tag].key, window);
+    size_t pos = (size_t)id & (TAG_INDEX_CAP - 1);
+    while (t.slots[pos].tag >= 0) pos = (pos + 1) & (TAG_INDEX_CAP - 1);
+    t.slots[pos].id = id;
+    t.slots[pos].tag = (int16_t)tag;
+  }
+  t.window = window;
+  t.valid = true;
+}
+
+/**
+ * @brief Rebuild all three windows around a centre window.
+ *
+ * Window -1 is skipped at the start of the epoch so that it cannot alias
+ * the slot of window 0.
+ *
+ * @param[in] window Centre (current) window index.
+ */
+static void buildAround(uint32_t window) {
+  for (int i = 0; i < TAG_INDEX_WINDOWS; i++) gTables[i].valid = false;
+  if (window > 0) buildWindow(window - 1);
+  buildWindow(window);
+  buildWindow(window + 1);
+}
+
+/**
+ * @brief Probe one window table for an identifier.
+ *
+ * @param[in] t  Table to search.
+ * @param[in] id Identifier to find.
+ * @return Owned tag index, or -1 if absent.
+ */
+static int16_t probe(const WindowTable& t, uint64_t id) {
+  size_t pos = (size_t)id & (TAG_INDEX_CAP - 1);
+  while (t.slots[pos].tag >= 0) {
+    if (t.slots[pos].id == id) return t.slots[pos].tag;
+    pos = (pos + 1) & (TAG_INDEX_CAP - 1);
+  }
+  return -1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void tagIndexInit(const OwnedTag* tags, size_t count, uint32_t epochSeconds) {
+  gTags = tags;
+  gTagCount = count > TAG_INDEX_MAX_TAGS ? TAG_INDEX_MAX_TAGS : count;
+  gWindow = rollingWindow(epochSeconds);
+  buildAround(gWindow);
+}
+
+void tagIndexRefresh(uint32_t epochSeconds) {
+  uint32_t window = rollingWindow(epochSeconds);
+  if (window == gWindow) return;
+
+  if (window == gWindow + 1) {
+    // Slot of window-2 (the old "previous") becomes the new "next"
+    buildWindow(window + 1);
+  } else {
+    buildAround(window);
+  }
+  gWindow = window;
+}
+
+TagMatch tagIndexLookup(uint64_t id) {
+  TagMatch m = { -1, 0 };
+  for (int i = 0; i < TAG_INDEX_WINDOWS; i++) {
+    const WindowTable& t = gTables[i];
+    if (!t.valid) continue;
+    int16_t tag = probe(t, id);
+    if (tag >= 0) {
+      m.tag = tag;
+      m.skew = (int8_t)((int32_t)(t.window - gWindow));
+      return m;
+    }
+  }
+  return m;
+}
+
+TagMatch tagIndexIdentify(const uint8_t* mfr, size_t len) {
+  uint64_t id;
+  if (!rollingDecodeMfr(mfr, len, &id)) {
+    TagMatch none = { -1, 0 };
+    return none;
+  }
+  return tagIndexLookup(id);
+}
+
+size_t tagIndexCount(void) {
+  return gTagCount;
+}
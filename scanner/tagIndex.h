@@ -0,0 +1,80 @@
+/**
+ * @file tagIndex.h
+ * @brief Precomputed lookup index of expected rolling identifiers for owned tags.
+ *
+ * For every owned tag the tracker precomputes the identifiers for the
+ * previous, current and next rotation window. Identifying a sighting is then
+ * a single hash lookup instead of one PRF evaluation per tag.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "rollingId.h"
+
+/**
+ * @brief Maximum number of owned tags the index can hold.
+ *
+ * Each tag costs three hash slots of 16 bytes at 50% load, i.e. 96 bytes.
+ * Override at compile time for larger deployments or host benchmarks.
+ */
+#ifndef TAG_INDEX_MAX_TAGS
+#define TAG_INDEX_MAX_TAGS 16
+#endif
+
+/**
+ * @brief An owned tag and the key it shares with this tracker.
+ */
+struct OwnedTag {
+  const char* name;                  /**< Human readable label. */
+  uint8_t key[ROLLING_KEY_LEN];      /**< Shared rolling identifier key. */
+};
+
+/**
+ * @brief Result of identifying a sighting.
+ */
+struct TagMatch {
+  int16_t tag;       /**< Index into the owned tag table, or -1 if unknown. */
+  int8_t  skew;      /**< Window offset of the match (-1, 0 or +1). */
+};
+
+/**
+ * @brief Load the owned tag table and build the index for the given time.
+ *
+ * @param[in] tags         Owned tag table (must outlive the index).
+ * @param[in] count        Number of entries (clamped to TAG_INDEX_MAX_TAGS).
+ * @param[in] epochSeconds Current time in seconds since the shared epoch.
+ */
+void tagIndexInit(const OwnedTag* tags, size_t count, uint32_t epochSeconds);
+
+/**
+ * @brief Advance the index to the given time.
+ *
+ * When the rotation window has moved by one, only the identifiers of the new
+ * "next" window are computed; larger jumps rebuild all three windows.
+ *
+ * @param[in] epochSeconds Current time in seconds since the shared epoch.
+ */
+void tagIndexRefresh(uint32_t epochSeconds);
+
+/**
+ * @brief Look up an identifier in the index.
+ *
+ * @param[in] id Identifier decoded from an advertisement.
+ * @return Match result; `tag` is -1 when the identifier is not owned.
+ */
+TagMatch tagIndexLookup(uint64_t id);
+
+/**
+ * @brief Identify a sighting from raw manufacturer data.
+ *
+ * @param[in] mfr Manufacturer data bytes.
+ * @param[in] len Manufacturer data length.
+ * @return Match result; `tag` is -1 when the payload is not an owned tag.
+ */
+TagMatch tagIndexIdentify(const uint8_t* mfr, size_t len);
+
+/**
+ * @brief Number of owned tags loaded in the index.
+ */
+size_t tagIndexCount(void);
@@ -0,0 +1,72 @@
+/**
+ * @file taskPlan.cpp
+ * @brief Deadline-miss counters and report for the task plan.
+ */
+
+#include "taskPlan.h"
+
+// ============================================================================
+// Module Globals
+// ============================================================================
+
+/** @brief Task table attached by `taskPlanInit()`. */
+static const TaskSpec* gSpecs = nullptr;
+
+/** @brief Counters, one per task. */
+static TaskStats* gStats = nullptr;
+
+/** @brief Number of tasks. */
+static size_t gCount = 0;
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void taskPlanInit(const TaskSpec* specs, TaskStats* stats, size_t count) {
+  gSpecs = specs;
+  gStats = stats;
+  gCount = count;
+  for (size_t i = 0; i < count; i++) {
+    stats[i].lastWake = 0;
+    stats[i].startUs = 0;
+    stats[i].activations.store(0, std::memory_order_relaxed);
+    stats[i].misses.store(0, std::memory_order_relaxed);
+    stats[i].maxExecUs.store(0, std::memory_order_relaxed);
+  }
+}
+
+void taskPeriodStart(size_t id) {
+  if (id >= gCount) return;
+  gStats[id].lastWake = xTaskGetTickCount();
+  gStats[id].startUs = micros();
+}
+
+bool taskPeriodWait(size_t id) {
+  if (id >= gCount) return true;
+  TaskStats* st = &gStats[id];
+  uint32_t exec = micros() - st->startUs;
+  if (exec > st->maxExecUs.load(std::memory_order_relaxed)) st->maxExecUs.store(exec, std::memory_order_relaxed);
+  st->activations.fetch_add(1, std::memory_order_relaxed);
+
+  bool met = xTaskDelayUntil(&st->lastWake, pdMS_TO_TICKS(gSpecs[id].periodMs)) == pdTRUE;
+  if (!met) {
+    st->misses.fetch_add(1, std::memory_order_relaxed);
+    st->lastWake = xTaskGetTickCount();
+  }
+  st->startUs = micros();
+  return met;
+}
+
+void taskPlanReport(void) {
+  Serial.println("Task plan:");
+  Serial.println("  task               core prio  stack period   wcet     runs misses maxExec");
+  for (size_t i = 0; i < gCount; i++) {
+    const TaskSpec* s = &gSpecs[i];
+    const TaskStats* st = &gStats[i];
+    Serial.printf("  %-18s %4d %4u %6u %4u ms %4u us %8u %6u %4u us\n", s->name, (int)s->core,
+                  (unsigned)s->prio, (unsigned)s->stackBytes, (unsigned)s->periodMs,
+                  (unsigned)s->wcetUs, (unsigned)st->activations.load(std::memory_order_relaxed),
+                  (unsigned)st->misses.load(std::memory_order_relaxed),
+                  (unsigned)st->maxExecUs.load(std::memory_order_relaxed));
+  }
+}
@@ -0,0 +1,32 @@
+/**
+ * @file taskTable.h
+ * @brief Task plan of the tracker (see taskPlan.h for the column meanings).
+ *
+ * BLE scanning, connecting and RSSI polling stay on the protocol core with
+ * the BLE stack. Distance estimation, the UI loop and history export run on
+ * the application core, in that priority order; the export task is
+ * background work (serial export, history recording from the event bus)
+ * that polls every 1-50 ms and is not analysed. Budgets are
+ * per-release estimates; compare them with the `maxExec` column of the
+ * periodic report.
+ */
+
+#pragma once
+#include "taskPlan.h"
+
+/** @brief Application tasks: X(fn, core, prio, stackBytes, periodMs, wcetUs) */
+#define TASK_TABLE(X) \
+  X(BLEScannerTask, PRO_CORE, 5, 8192,  31, 2000) \
+  X(distanceTask,   APP_CORE, 5, 4096, 200, 3000) \
+  X(appLoopTask,    APP_CORE, 4, 6144,  50, 8000) \
+  X(exportTask,     APP_CORE, 2, 6144,   0,    0)
+
+/**
+ * @brief ESP-IDF tasks competing for the same cores, for schedulability
+ *        analysis only (priorities from the IDF defaults, loads estimated
+ *        for active scanning plus one connection).
+ */
+#define TASK_SYSTEM(X) \
+  X(btController,   PRO_CORE, 23, 0,  10, 1500) \
+  X(btuTask,        PRO_CORE, 20, 0,  10,  800) \
+  X(esp_timer,      PRO_CORE, 22, 0, 100,   50)
@@ -0,0 +1,72 @@
+/**
+ * @file topicTable.h
+ * @brief Event bus topics and subscribers of the tracker (see eventBus.h).
+ *
+ * The BLE notify callback publishes the tag's movement flag, the connection
+ * manager each link state change and the distance task each estimate. The
+ * UI redraws the LCD from them every 100 ms; logging and alerting run on the
+ * event loop as soon as an event arrives; the history recorder drains its
+ * ring from the export task, so flash writes stay off the distance and UI
+ * paths; the scanner task takes heap snapshots and reloads IRKs as links
+ * come and go.
+ */
+
+#pragma once
+#include "eventBus.h"
+
+/**
+ * @brief Movement state reported by the tag.
+ */
+struct MovingEvent {
+  uint8_t tag;       /**< Owned tag index. */
+  uint8_t moving;    /**< 1 while the tag reports movement. */
+};
+
+/**
+ * @brief One distance estimate.
+ */
+struct DistanceEvent {
+  float    meters;   /**< Estimated distance. */
+  float    rssi;     /**< Smoothed RSSI it was computed from (dBm). */
+  float    variance; /**< Variance of the estimate (m^2). */
+  uint8_t  tag;      /**< Owned tag index. */
+  uint8_t  moving;   /**< Movement flag at the time of the estimate. */
+};
+
+/**
+ * @brief Link state change (see connManager.h).
+ */
+struct LinkEvent {
+  int16_t  tag;      /**< Tag of the link, -1 once given up. */
+  uint8_t  link;     /**< Link index. */
+  uint8_t  state;    /**< New LinkState. */
+  uint32_t readyMs;  /**< Request-to-ready time, valid in LINK_READY. */
+};
+
+/** @brief Topics: X(id, eventType) */
+#define TOPIC_TABLE(X) \
+  X(TOPIC_MOVING,   MovingEvent) \
+  X(TOPIC_DISTANCE, DistanceEvent) \
+  X(TOPIC_LINK,     LinkEvent)
+
+/** @brief Subscribers: X(name, ringDepth, topics) */
+#define SUBSCRIBER_TABLE(X) \
+  X(uiSub,      4, BUS_TOPIC(TOPIC_MOVING) | BUS_TOPIC(TOPIC_DISTANCE)) \
+  X(logSub,     16, BUS_TOPIC(TOPIC_MOVING) | BUS_TOPIC(TOPIC_DISTANCE) | BUS_TOPIC(TOPIC_LINK)) \
+  X(alertSub,   4, BUS_TOPIC(TOPIC_DISTANCE)) \
+  X(historySub, 8, BUS_TOPIC(TOPIC_DISTANCE)) \
+  X(scannerSub, 8, BUS_TOPIC(TOPIC_LINK))
+
+/** @brief Topic ids */
+enum TopicId : uint8_t {
+#define X(id, type) id,
+  TOPIC_TABLE(X)
+#undef X
+  TOPIC_COUNT
+};
+
+static_assert(TOPIC_COUNT <= BUS_MAX_TOPICS, "too many topics");
+
+#define X(id, type) template <> struct BusTopic<id> { typedef type Type; };
+TOPIC_TABLE(X)
+#undef X
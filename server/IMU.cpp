@@ -1,18 +1,24 @@
 #include "IMU_STRUCT.h"
 #include "IMU.h"
 #include "IMU_REGISTER_MAP.h"
+#include "energy.h"
 #include <Wire.h>
 
+/** @brief Bus bytes of a 6-byte burst read: address, register, address, data. */
+#define IMU_READ6_BYTES 9
+
 /**
  * @brief Initializes a new IMU structure.
  *
- * Allocates memory for an IMU structure and sets all accelerometer
- * and gyroscope values to zero.
+ * Returns the statically placed IMU structure with all accelerometer
+ * and gyroscope values set to zero. There is a single IMU, so repeated
+ * calls return the same structure.
  *
  * @return Pointer to the initialized imu structure.
  */
 struct imu* imu_init(void) {
-  struct imu* imu = (struct imu*) malloc(sizeof(struct imu));
+  static struct imu imuStorage;
+  struct imu* imu = &imuStorage;
   imu->AccX = imu->AccY = imu->AccZ = 0.0;
   imu->GyroX = imu->GyroY = imu->GyroZ = 0.0;
   return imu;
@@ -36,6 +42,7 @@ void imu_read_accel(float* xAccel, float xErr, float* yAccel, float yErr, float*
     Wire.write(REG_ACCEL_XOUT_H);
     Wire.endTransmission(false);
     Wire.requestFrom(0x68, 6, true);
+    energyNote(ENERGY_I2C_BYTES, IMU_READ6_BYTES);
     *xAccel = (int16_t)(Wire.read() << 8 | Wire.read())/16384.0 - xErr;
     *yAccel = (int16_t)(Wire.read() << 8 | Wire.read())/16384.0 - yErr;
     *zAccel = (int16_t)(Wire.read() << 8 | Wire.read())/16384.0 - zErr;
@@ -59,6 +66,7 @@ void imu_read_gyro(float* xGyro,float xErr, float* yGyro, float yErr, float* zGy
     Wire.write(REG_GYRO_XOUT_H);
     Wire.endTransmission(false);
     Wire.requestFrom(0x68, 6, true);
+    energyNote(ENERGY_I2C_BYTES, IMU_READ6_BYTES);
     *xGyro = (int16_t)(Wire.read() << 8 | Wire.read())/131.0 - xErr;
     *yGyro = (int16_t)(Wire.read() << 8 | Wire.read())/131.0 - yErr;
     *zGyro = (int16_t)(Wire.read() << 8 | Wire.read())/131.0 - zErr;
@@ -121,4 +129,59 @@ void imu_i2c(void) {
   Wire.write(REG_PWR_MGMT_1);
   Wire.write(0x00);
   Wire.endTransmission(true);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Writes one IMU register.
+ *
+ * @param[in] reg   Register address.
+ * @param[in] value Value to write.
+ */
+static void imu_write(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(0x68);
+  Wire.write(reg);
+  Wire.write(value);
+  Wire.endTransmission(true);
+  energyNote(ENERGY_I2C_BYTES, 3);
+}
+
+/**
+ * @brief Puts the IMU into low-power wake-on-motion mode.
+ *
+ * Follows the MPU-6500 wake-on-motion sequence: accelerometer only,
+ * 184 Hz bandwidth, motion interrupt enabled, accelerometer intelligence
+ * in compare-with-previous mode, then cycle mode at 15.63 Hz.
+ *
+ * @param[in] thresholdMg Motion threshold in mg (4 mg resolution).
+ */
+void imu_wake_on_motion(uint16_t thresholdMg) {
+  uint16_t thr = thresholdMg / 4;
+  imu_write(REG_PWR_MGMT_1, 0x00);
+  imu_write(REG_PWR_MGMT_2, 0x07);          /**< Gyro off */
+  imu_write(REG_ACCEL_CONFIG2, 0x09);       /**< 184 Hz accel bandwidth */
+  imu_write(REG_INT_PIN_CFG, 0x30);         /**< Latch, cleared by any read */
+  imu_write(REG_INT_ENABLE, 0x40);          /**< Wake-on-motion interrupt */
+  imu_write(REG_MOT_DETECT_CTRL, 0xC0);     /**< Accel intelligence, compare mode */
+  imu_write(REG_WOM_THR, thr > 255 ? 255 : (uint8_t)thr);
+  imu_write(REG_LP_ACCEL_ODR, 0x06);        /**< 15.63 Hz wake-up rate */
+  imu_write(REG_PWR_MGMT_1, 0x20);          /**< Cycle mode */
+}
+
+/**
+ * @brief Returns the IMU to continuous sampling.
+ *
+ * Disables the motion interrupt, powers the gyroscope back up and reads the
+ * interrupt status to release a latched interrupt.
+ */
+void imu_active_mode(void) {
+  imu_write(REG_PWR_MGMT_1, 0x00);
+  imu_write(REG_INT_ENABLE, 0x00);
+  imu_write(REG_MOT_DETECT_CTRL, 0x00);
+  imu_write(REG_PWR_MGMT_2, 0x00);
+  Wire.beginTransmission(0x68);
+  Wire.write(REG_INT_STATUS);
+  Wire.endTransmission(false);
+  Wire.requestFrom(0x68, 1, true);
+  Wire.read();
+  energyNote(ENERGY_I2C_BYTES, 4);
+}
@@ -6,12 +6,14 @@
  * reading accelerometer and gyroscope data, and performing calibration routines.
  */
 
+#include <stdint.h>
+
 /**
  * @brief Initialize the IMU structure.
  *
- * Allocates memory for the IMU structure and initializes all sensor values to zero.
+ * Resets the statically placed IMU structure, initializing all sensor values to zero.
  *
- * @return Pointer to the allocated and initialized IMU structure.
+ * @return Pointer to the initialized IMU structure.
  */
 struct imu* imu_init(void);
 
@@ -75,3 +77,21 @@ void calibrateAccel(float* xErr, float* yErr, float* zErr);
  * Configures and sets up the I2C interface to enable communication with the IMU sensor.
  */
 void imu_i2c(void);
+
+/**
+ * @brief Put the IMU into low-power wake-on-motion mode.
+ *
+ * Turns the gyroscope off, duty-cycles the accelerometer and raises the
+ * interrupt pin (latched, active high) when any axis changes by more than
+ * the threshold.
+ *
+ * @param[in] thresholdMg Motion threshold in mg (4 mg resolution).
+ */
+void imu_wake_on_motion(uint16_t thresholdMg);
+
+/**
+ * @brief Return the IMU to continuous accelerometer and gyroscope sampling.
+ *
+ * Disables the motion interrupt and clears a pending one.
+ */
+void imu_active_mode(void);
@@ -0,0 +1,187 @@
+/**
+ * @file battery.cpp
+ * @brief Battery filter, discharge curve and the ADC sampling timer.
+ */
+
+#include <string.h>
+#include "battery.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+const BatteryCurvePoint BATTERY_LIPO_CURVE[] = {
+  { 4200, 100 }, { 4100, 90 }, { 4000, 78 }, { 3900, 65 }, { 3800, 50 }, { 3750, 40 },
+  { 3700, 28 },  { 3650, 17 }, { 3600, 10 }, { 3500, 4 },  { 3300, 0 },
+};
+
+const size_t BATTERY_LIPO_CURVE_LEN = sizeof(BATTERY_LIPO_CURVE) / sizeof(BATTERY_LIPO_CURVE[0]);
+
+// ============================================================================
+// Filter and Curve
+// ============================================================================
+
+uint16_t batteryTrimmedMean(const uint16_t* raw, size_t count) {
+  if (count == 0) return 0;
+  uint32_t sum = 0;
+  uint16_t lo = raw[0], hi = raw[0];
+  for (size_t i = 0; i < count; i++) {
+    sum += raw[i];
+    if (raw[i] < lo) lo = raw[i];
+    if (raw[i] > hi) hi = raw[i];
+  }
+  if (count >= 3) {
+    sum -= (uint32_t)lo + hi;
+    count -= 2;
+  }
+  return (uint16_t)((sum + count / 2) / count);
+}
+
+uint8_t batterySocFromMv(uint16_t mv, const BatteryCurvePoint* curve, size_t count) {
+  if (count == 0) return 0;
+  if (mv >= curve[0].mv) return curve[0].percent;
+  for (size_t i = 1; i < count; i++) {
+    if (mv >= curve[i].mv) {
+      const BatteryCurvePoint& hi = curve[i - 1];
+      const BatteryCurvePoint& lo = curve[i];
+      uint32_t span = hi.mv - lo.mv;
+      uint32_t rise = (uint32_t)(hi.percent - lo.percent) * (mv - lo.mv);
+      return (uint8_t)(lo.percent + (rise + span / 2) / span);
+    }
+  }
+  return curve[count - 1].percent;
+}
+
+void batteryStateInit(BatteryState* state) {
+  memset(state, 0, sizeof(*state));
+  state->percent = BATTERY_SOC_UNKNOWN;
+}
+
+bool batteryStateUpdate(BatteryState* state, uint16_t mv, const BatteryCurvePoint* curve,
+                        size_t count) {
+  int32_t sample = (int32_t)mv << 4;
+  if (state->samples == 0) {
+    state->emaMv16 = (uint32_t)sample;
+  } else {
+    int32_t ema = (int32_t)state->emaMv16;
+    state->emaMv16 = (uint32_t)(ema + (sample - ema) / (1 << BATTERY_EMA_SHIFT));
+  }
+  state->lastMv = mv;
+  state->samples++;
+
+  uint8_t soc = batterySocFromMv(batteryStateMv(state), curve, count);
+  if (state->percent != BATTERY_SOC_UNKNOWN) {
+    int diff = (int)soc - (int)state->percent;
+    bool empty = soc == 0 && diff != 0;
+    if (!empty && diff < BATTERY_SOC_RISE && -diff < BATTERY_SOC_HYSTERESIS) return false;
+  }
+  state->percent = soc;
+  return true;
+}
+
+uint16_t batteryStateMv(const BatteryState* state) {
+  return (uint16_t)((state->emaMv16 + 8) >> 4);
+}
+
+size_t batteryEncode(const BatteryState* state, uint8_t* out) {
+  uint16_t mv = batteryStateMv(state);
+  out[0] = (uint8_t)mv;
+  out[1] = (uint8_t)(mv >> 8);
+  out[2] = state->percent;
+  out[3] = 0;
+  return BATTERY_RECORD_LEN;
+}
+
+#ifdef ARDUINO
+
+// ============================================================================
+// Device Sampling
+// ============================================================================
+
+/** @brief Tap voltage at full scale without calibration, 12 dB attenuation (mV). */
+#define BATTERY_ADC_FULL_MV 3100
+
+static BatteryState gState = { 0, 0, BATTERY_SOC_UNKNOWN, 0 }; /**< Latest filtered state. */
+static portMUX_TYPE gMux = portMUX_INITIALIZER_UNLOCKED;    /**< Guards gState. */
+static adc_cali_handle_t gCali = nullptr;                   /**< ADC calibration, if available. */
+static esp_timer_handle_t gTimer = nullptr;                 /**< Sampling timer. */
+static int gPin = -1;                                       /**< Divider tap GPIO. */
+static uint16_t gNum = 1, gDen = 1;                         /**< Divider ratio. */
+
+/**
+ * @brief Timer callback: oversample, calibrate once and filter.
+ */
+static void sampleBattery(void*) {
+  uint16_t raw[BATTERY_OVERSAMPLE];
+  for (int i = 0; i < BATTERY_OVERSAMPLE; i++) raw[i] = (uint16_t)analogRead(gPin);
+  uint16_t mean = batteryTrimmedMean(raw, BATTERY_OVERSAMPLE);
+
+  int tapMv = 0;
+  if (!gCali || adc_cali_raw_to_voltage(gCali, mean, &tapMv) != ESP_OK) {
+    tapMv = (int)((uint32_t)mean * BATTERY_ADC_FULL_MV / 4095);
+  }
+  uint16_t mv = (uint16_t)((uint32_t)tapMv * gNum / gDen);
+
+  portENTER_CRITICAL(&gMux);
+  batteryStateUpdate(&gState, mv, BATTERY_LIPO_CURVE, BATTERY_LIPO_CURVE_LEN);
+  portEXIT_CRITICAL(&gMux);
+}
+
+/**
+ * @brief Create the calibration scheme the chip supports for a channel.
+ */
+static void createCalibration(adc_unit_t unit, adc_channel_t chan) {
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+  adc_cali_curve_fitting_config_t cfg = {};
+  cfg.unit_id = unit;
+  cfg.chan = chan;
+  cfg.atten = ADC_ATTEN_DB_12;
+  cfg.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_curve_fitting(&cfg, &gCali) != ESP_OK) gCali = nullptr;
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+  adc_cali_line_fitting_config_t cfg = {};
+  cfg.unit_id = unit;
+  cfg.atten = ADC_ATTEN_DB_12;
+  cfg.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_line_fitting(&cfg, &gCali) != ESP_OK) gCali = nullptr;
+#endif
+}
+
+bool batteryBegin(int pin, uint16_t dividerNum, uint16_t dividerDen) {
+  adc_unit_t unit;
+  adc_channel_t chan;
+  if (adc_oneshot_io_to_channel(pin, &unit, &chan) != ESP_OK || unit != ADC_UNIT_1) {
+    Serial.println("Battery: pin has no ADC1 channel");
+    return false;
+  }
+  gPin = pin;
+  gNum = dividerNum;
+  gDen = dividerDen ? dividerDen : 1;
+  batteryStateInit(&gState);
+
+  analogReadResolution(12);
+  analogSetPinAttenuation(pin, ADC_11db);
+  createCalibration(unit, chan);
+  if (!gCali) Serial.println("Battery: no ADC calibration, using nominal scale");
+
+  sampleBattery(nullptr);  // first value before anyone reads it
+
+  esp_timer_create_args_t args = {};
+  args.callback = sampleBattery;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "battery";
+  args.skip_unhandled_events = true;
+  if (esp_timer_create(&args, &gTimer) != ESP_OK) return false;
+  return esp_timer_start_periodic(gTimer, (uint64_t)BATTERY_PERIOD_MS * 1000) == ESP_OK;
+}
+
+void batteryRead(BatteryState* out) {
+  portENTER_CRITICAL(&gMux);
+  *out = gState;
+  portEXIT_CRITICAL(&gMux);
+}
+
+#endif
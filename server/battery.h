@@ -0,0 +1,138 @@
+/**
+ * @file battery.h
+ * @brief Battery voltage sampling and state of charge.
+ *
+ * A periodic esp_timer takes BATTERY_OVERSAMPLE raw ADC readings every
+ * BATTERY_PERIOD_MS, drops the lowest and highest (radio bursts pull the
+ * rail down for a moment), averages the rest and converts the mean once
+ * through the ADC calibration. The voltage is smoothed with an exponential
+ * moving average and mapped to a state of charge by a piecewise-linear
+ * discharge curve. The reported percentage falls in steps of at least
+ * BATTERY_SOC_HYSTERESIS and rises only by BATTERY_SOC_RISE or more
+ * (charging, fresh battery), so the advertisement is not rebuilt for noise
+ * or for the cell recovering after a buzzer burst.
+ *
+ * The filter and curve are plain code for host checks; the ADC and timer
+ * glue is device only.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Raw ADC readings per measurement. */
+#ifndef BATTERY_OVERSAMPLE
+#define BATTERY_OVERSAMPLE 16
+#endif
+
+/** @brief Measurement period (ms). */
+#ifndef BATTERY_PERIOD_MS
+#define BATTERY_PERIOD_MS 5000
+#endif
+
+/** @brief EMA weight of a new measurement, as a right shift (1/16). */
+#define BATTERY_EMA_SHIFT 4
+
+/** @brief Smallest fall of the reported percentage. */
+#define BATTERY_SOC_HYSTERESIS 2
+
+/** @brief Smallest rise of the reported percentage. */
+#define BATTERY_SOC_RISE 5
+
+/** @brief Percentage reported before the first measurement. */
+#define BATTERY_SOC_UNKNOWN 0xFF
+
+/** @brief Encoded size of the battery state. */
+#define BATTERY_RECORD_LEN 4
+
+/**
+ * @brief One point of a discharge curve.
+ */
+struct BatteryCurvePoint {
+  uint16_t mv;       /**< Cell voltage. */
+  uint8_t  percent;  /**< State of charge at that voltage. */
+};
+
+/**
+ * @brief Single-cell LiPo discharge curve at light load, by falling voltage.
+ */
+extern const BatteryCurvePoint BATTERY_LIPO_CURVE[];
+
+/** @brief Points in BATTERY_LIPO_CURVE. */
+extern const size_t BATTERY_LIPO_CURVE_LEN;
+
+/**
+ * @brief Filtered battery state.
+ */
+struct BatteryState {
+  uint32_t emaMv16;      /**< Smoothed voltage, 1/16 mV. */
+  uint16_t lastMv;       /**< Latest unfiltered measurement. */
+  uint8_t  percent;      /**< Reported state of charge, or BATTERY_SOC_UNKNOWN. */
+  uint32_t samples;      /**< Measurements taken. */
+};
+
+/**
+ * @brief Mean of raw readings without the lowest and highest one.
+ *
+ * @param[in] raw   Readings.
+ * @param[in] count Number of readings; with fewer than 3 nothing is dropped.
+ * @return Rounded mean.
+ */
+uint16_t batteryTrimmedMean(const uint16_t* raw, size_t count);
+
+/**
+ * @brief State of charge for a voltage, interpolated on a curve.
+ *
+ * @param[in] mv    Cell voltage.
+ * @param[in] curve Curve points by falling voltage.
+ * @param[in] count Number of points.
+ * @return Percentage 0-100, clamped at the ends of the curve.
+ */
+uint8_t batterySocFromMv(uint16_t mv, const BatteryCurvePoint* curve, size_t count);
+
+/**
+ * @brief Reset the state to "no measurement yet".
+ */
+void batteryStateInit(BatteryState* state);
+
+/**
+ * @brief Feed one measurement: update the EMA and the reported percentage.
+ *
+ * @param[in,out] state Battery state.
+ * @param[in]     mv    Cell voltage measured.
+ * @param[in]     curve Discharge curve.
+ * @param[in]     count Number of curve points.
+ * @return True if the reported percentage changed.
+ */
+bool batteryStateUpdate(BatteryState* state, uint16_t mv, const BatteryCurvePoint* curve,
+                        size_t count);
+
+/**
+ * @brief Smoothed voltage (mV), 0 before the first measurement.
+ */
+uint16_t batteryStateMv(const BatteryState* state);
+
+/**
+ * @brief Encode the state as BATTERY_RECORD_LEN little-endian bytes:
+ *        u16 smoothed mV, u8 percent, u8 reserved.
+ */
+size_t batteryEncode(const BatteryState* state, uint8_t* out);
+
+// ============================================================================
+// Device Sampling
+// ============================================================================
+
+/**
+ * @brief Start periodic sampling of a battery divider (device only).
+ *
+ * @param[in] pin        ADC1-capable GPIO at the divider tap.
+ * @param[in] dividerNum Divider ratio numerator (cell = tap * num / den).
+ * @param[in] dividerDen Divider ratio denominator.
+ * @return False if the pin has no ADC1 channel or the timer cannot start.
+ */
+bool batteryBegin(int pin, uint16_t dividerNum, uint16_t dividerDen);
+
+/**
+ * @brief Consistent copy of the latest battery state.
+ */
+void batteryRead(BatteryState* out);
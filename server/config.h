@@ -0,0 +1,186 @@
+/**
+ * @file config.h
+ * @brief Typed runtime configuration with lock-free reads and NVS persistence.
+ *
+ * A sketch declares its parameters in `configTable.h` as
+ * `X(type, name, default, min, max, help)` rows; the rows expand into a
+ * plain struct, its defaults and the field descriptors used to set values
+ * by key (over BLE or serial) and to persist them.
+ *
+ * The store keeps two copies of the struct and a sequence counter. A writer
+ * fills the copy readers are not using, then publishes it by advancing the
+ * counter (odd while a write is in progress). Readers take no lock and make
+ * no copy: `configRead()` hands the published struct to a callback and
+ * re-runs it only if a second write reused that copy meanwhile. Writers are
+ * rare (a user changing a setting) and serialise on a short lock.
+ *
+ * @note This file is shared verbatim between the server (tag) and scanner
+ *       (tracker) sketches. Keep both copies in sync.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/** @brief Largest configuration struct a store can hold (bytes). */
+#define CONFIG_MAX_SIZE 128
+
+/**
+ * @brief Value types a table row may use.
+ */
+enum ConfigType : uint8_t {
+  CONFIG_FLOAT = 0,   /**< float */
+  CONFIG_INT,         /**< int32_t */
+};
+
+/** @brief ConfigType of a C++ type, for expanding table rows. */
+template <typename T> struct ConfigTypeOf;
+template <> struct ConfigTypeOf<float>   { static constexpr ConfigType value = CONFIG_FLOAT; };
+template <> struct ConfigTypeOf<int32_t> { static constexpr ConfigType value = CONFIG_INT; };
+
+/**
+ * @brief Result of setting a value by key.
+ */
+enum ConfigStatus : uint8_t {
+  CONFIG_OK = 0,        /**< Value published. */
+  CONFIG_UNKNOWN_KEY,   /**< No field of that name. */
+  CONFIG_BAD_VALUE,     /**< Not a number, or outside [min, max]. */
+  CONFIG_REJECTED,      /**< The store's cross-field check failed. */
+};
+
+/**
+ * @brief Descriptor of one field.
+ */
+struct ConfigField {
+  const char* key;      /**< Field name. */
+  ConfigType  type;     /**< Value type. */
+  uint16_t    offset;   /**< Offset in the struct. */
+  float       min;      /**< Smallest accepted value. */
+  float       max;      /**< Largest accepted value. */
+  const char* help;     /**< One-line description. */
+};
+
+/**
+ * @brief Checks a candidate struct as a whole (e.g. min below max).
+ */
+typedef bool (*ConfigCheck)(const void* cfg);
+
+/**
+ * @brief Double-buffered configuration store.
+ */
+struct ConfigStore {
+  void*              buf[2];    /**< The two copies, each `size` bytes. */
+  size_t             size;      /**< Struct size. */
+  const ConfigField* fields;    /**< Field descriptors. */
+  size_t             count;     /**< Number of fields. */
+  ConfigCheck        check;     /**< Cross-field check, or nullptr. */
+  const char*        nvsName;   /**< NVS namespace of the persisted copy. */
+  std::atomic<uint32_t> seq;    /**< Write sequence; copy (seq >> 1) & 1 is published. */
+};
+
+/**
+ * @brief Reset a store to its defaults.
+ *
+ * @param[in,out] store    Store.
+ * @param[in]     defaults Default struct (`store->size` bytes).
+ */
+void configInit(ConfigStore* store, const void* defaults);
+
+/**
+ * @brief Start a read: the sequence value to validate against.
+ */
+inline uint32_t configReadBegin(const ConfigStore* store) {
+  return store->seq.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief The copy published at sequence value `seq`.
+ */
+inline const void* configCurrent(const ConfigStore* store, uint32_t seq) {
+  return store->buf[(seq >> 1) & 1];
+}
+
+/**
+ * @brief True if a write may have changed the copy read since `seq`.
+ *
+ * The copy in use is only rewritten by the second write after the one
+ * published at `seq`, so a single concurrent update does not cause a retry.
+ */
+inline bool configReadRetry(const ConfigStore* store, uint32_t seq) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint32_t now = store->seq.load(std::memory_order_relaxed);
+  return now - seq >= ((seq & 1) ? 2u : 3u);
+}
+
+/**
+ * @brief Read a consistent configuration without locking or copying.
+ *
+ * `fn` receives the published struct and must only read from it into
+ * locals; it runs again in the rare case the copy was rewritten meanwhile.
+ *
+ * @tparam T  Configuration struct.
+ * @param[in] store Store holding T.
+ * @param[in] fn    Callable taking `const T&`.
+ */
+template <typename T, typename F>
+inline void configRead(const ConfigStore* store, F&& fn) {
+  uint32_t seq;
+  do {
+    seq = configReadBegin(store);
+    fn(*static_cast<const T*>(configCurrent(store, seq)));
+  } while (configReadRetry(store, seq));
+}
+
+/**
+ * @brief Index of a field by key, -1 if unknown.
+ */
+int configFind(const ConfigStore* store, const char* key);
+
+/**
+ * @brief Parse, check and publish one value.
+ *
+ * @param[in,out] store Store.
+ * @param[in]     key   Field name.
+ * @param[in]     text  Value as text.
+ * @return CONFIG_OK if published.
+ */
+ConfigStatus configSet(ConfigStore* store, const char* key, const char* text);
+
+/**
+ * @brief Check and publish a complete struct (all fields at once).
+ *
+ * @return CONFIG_OK if published, CONFIG_REJECTED if a field is out of
+ *         range or the cross-field check fails.
+ */
+ConfigStatus configReplace(ConfigStore* store, const void* cfg);
+
+/**
+ * @brief Apply a "key=value" assignment (surrounding blanks ignored).
+ */
+ConfigStatus configApply(ConfigStore* store, const char* assignment);
+
+/**
+ * @brief Name of a status.
+ */
+const char* configStatusName(ConfigStatus status);
+
+/**
+ * @brief Format the published values as "key=value" lines.
+ *
+ * @return Characters written (excluding the terminator), truncated to `size`.
+ */
+size_t configFormat(const ConfigStore* store, char* out, size_t size);
+
+/**
+ * @brief Replace the published values from NVS, if a copy with the same
+ *        field layout was saved and passes the checks (device only).
+ *
+ * @return True if values were loaded.
+ */
+bool configLoad(ConfigStore* store);
+
+/**
+ * @brief Persist the published values to NVS (device only).
+ */
+bool configSave(const ConfigStore* store);
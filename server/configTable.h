@@ -0,0 +1,27 @@
+/**
+ * @file configTable.h
+ * @brief Runtime-adjustable parameters of the tag (see config.h).
+ *
+ * Values are changed by writing "key=value" to the configuration
+ * characteristic and persisted in the "server" NVS namespace. IMUTask
+ * picks them up at its next sample.
+ */
+
+#pragma once
+#include "config.h"
+
+/** @brief Parameters: X(type, name, default, min, max, help) */
+#define CONFIG_TABLE(X) \
+  X(float, moveOn,    0.25f, 0.01f, 4.0f, "smoothed acceleration that starts movement (g)") \
+  X(float, moveOff,   0.05f,  0.0f, 4.0f, "smoothed acceleration that ends movement (g, < moveOn)") \
+  X(float, compAlpha, 0.98f,  0.5f, 1.0f, "complementary filter gyro weight")
+
+/** @brief The tag's configuration struct. */
+struct AppConfig {
+#define X(type, name, def, lo, hi, help) type name;
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief The tag's configuration store, defined in server.ino. */
+extern ConfigStore appConfig;
@@ -0,0 +1,208 @@
+/**
+ * @file energy.cpp
+ * @brief Energy ledger arithmetic and the firmware's shared ledger.
+ */
+
+#include <string.h>
+#include "energy.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#else
+#include <chrono>
+#include <mutex>
+#endif
+
+const EnergyProfile ENERGY_PROFILE_DEFAULT = {
+  0.24f,                                  // light sleep floor
+  { 24.0f, 24.0f, 100.0f, 78.0f, 0.1f, 6.5f }, // tx, rx, adv, conn, i2c byte, wake-up
+  { 34.8f, 25.0f, 3.45f, 0.02f },         // cpu at 160 MHz, buzzer, imu, imu wom
+  500.0f,
+};
+
+/** @brief Number of estimate parts: floor, events, activities. */
+#define ENERGY_PART_COUNT (1 + ENERGY_EVENT_COUNT + ENERGY_ACTIVITY_COUNT)
+
+/** @brief Part names, in `EnergyEstimate::partMah` order. */
+static const char* PART_NAMES[ENERGY_PART_COUNT] = {
+  "floor", "tx", "rx", "adv", "conn", "i2c", "wakeups", "cpu", "buzzer", "imu", "imu-wom",
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Link events between `linkSinceUs` and `nowUs`.
+ */
+static uint64_t linkEvents(const EnergyLedger* l, uint64_t nowUs) {
+  if (l->link == ENERGY_LINK_IDLE || l->linkIntervalUs == 0 || nowUs <= l->linkSinceUs) return 0;
+  return (nowUs - l->linkSinceUs) / l->linkIntervalUs;
+}
+
+/**
+ * @brief Count link events up to `nowUs`, keeping the remainder for later.
+ */
+static void accrueLink(EnergyLedger* l, uint64_t nowUs) {
+  uint64_t n = linkEvents(l, nowUs);
+  if (l->link == ENERGY_LINK_ADVERTISING) l->counts[ENERGY_ADV] += n;
+  if (l->link == ENERGY_LINK_CONNECTED) l->counts[ENERGY_CONN] += n;
+  l->linkSinceUs += n * l->linkIntervalUs;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// ============================================================================
+// Ledger
+// ============================================================================
+
+void energyInit(EnergyLedger* ledger, uint64_t nowUs) {
+  memset(ledger, 0, sizeof(*ledger));
+  ledger->startUs = nowUs;
+  ledger->linkSinceUs = nowUs;
+}
+
+void energyCount(EnergyLedger* ledger, EnergyEvent event, uint32_t n) {
+  if (event < ENERGY_EVENT_COUNT) ledger->counts[event] += n;
+}
+
+void energyAddTime(EnergyLedger* ledger, EnergyActivity activity, uint32_t us) {
+  if (activity < ENERGY_ACTIVITY_COUNT) ledger->activeUs[activity] += us;
+}
+
+void energySetActive(EnergyLedger* ledger, EnergyActivity activity, bool on, uint64_t nowUs) {
+  if (activity >= ENERGY_ACTIVITY_COUNT) return;
+  uint8_t bit = (uint8_t)(1u << activity);
+  bool running = ledger->onMask & bit;
+  if (on && !running) {
+    ledger->onMask |= bit;
+    ledger->onSinceUs[activity] = nowUs;
+  } else if (!on && running) {
+    ledger->onMask &= (uint8_t)~bit;
+    ledger->activeUs[activity] += nowUs - ledger->onSinceUs[activity];
+  }
+}
+
+void energySetLink(EnergyLedger* ledger, EnergyLink link, uint32_t intervalUs, uint64_t nowUs) {
+  accrueLink(ledger, nowUs);
+  ledger->link = link;
+  ledger->linkIntervalUs = intervalUs;
+  ledger->linkSinceUs = nowUs;
+}
+
+void energyEstimate(const EnergyLedger* ledger, const EnergyProfile* profile, uint64_t nowUs,
+                    EnergyEstimate* out) {
+  memset(out, 0, sizeof(*out));
+  out->elapsedUs = nowUs > ledger->startUs ? nowUs - ledger->startUs : 0;
+
+  // 1 mAh = 3.6e6 µC; mA * µs = 1e-3 µC
+  const double UC_PER_MAH = 3.6e6;
+  out->partMah[0] = (float)(profile->floorMa * out->elapsedUs * 1e-3 / UC_PER_MAH);
+
+  uint64_t counts[ENERGY_EVENT_COUNT];
+  memcpy(counts, ledger->counts, sizeof(counts));
+  uint64_t link = linkEvents(ledger, nowUs);
+  if (ledger->link == ENERGY_LINK_ADVERTISING) counts[ENERGY_ADV] += link;
+  if (ledger->link == ENERGY_LINK_CONNECTED) counts[ENERGY_CONN] += link;
+  for (int e = 0; e < ENERGY_EVENT_COUNT; e++) {
+    out->partMah[1 + e] = (float)(counts[e] * (double)profile->eventUc[e] / UC_PER_MAH);
+  }
+
+  for (int a = 0; a < ENERGY_ACTIVITY_COUNT; a++) {
+    uint64_t us = ledger->activeUs[a];
+    if (ledger->onMask & (1u << a)) us += nowUs - ledger->onSinceUs[a];
+    out->partMah[1 + ENERGY_EVENT_COUNT + a] = (float)(profile->activeMa[a] * us * 1e-3 / UC_PER_MAH);
+  }
+
+  for (int p = 0; p < ENERGY_PART_COUNT; p++) out->usedMah += out->partMah[p];
+  double hours = out->elapsedUs / 3.6e9;
+  out->avgMa = hours > 0 ? (float)(out->usedMah / hours) : 0;
+  out->remainingMah = profile->batteryMah - out->usedMah;
+  if (out->remainingMah < 0) out->remainingMah = 0;
+  out->remainingHours = out->avgMa > 0 ? out->remainingMah / out->avgMa : 0;
+}
+
+const char* energyPartName(size_t part) {
+  return part < ENERGY_PART_COUNT ? PART_NAMES[part] : "?";
+}
+
+size_t energyEncode(const EnergyEstimate* estimate, const EnergyLedger* ledger, uint8_t* out) {
+  put32(out + 0, (uint32_t)(estimate->elapsedUs / 1000000));
+  put32(out + 4, (uint32_t)(estimate->usedMah * 1000));
+  put32(out + 8, (uint32_t)(estimate->avgMa * 1000));
+  put32(out + 12, (uint32_t)estimate->remainingMah);
+  put32(out + 16, (uint32_t)(estimate->remainingHours * 60));
+  put32(out + 20, (uint32_t)ledger->counts[ENERGY_TX]);
+  put32(out + 24, (uint32_t)ledger->counts[ENERGY_RX]);
+  put32(out + 28, (uint32_t)ledger->counts[ENERGY_WAKEUPS]);
+  return ENERGY_RECORD_LEN;
+}
+
+// ============================================================================
+// Device Ledger
+// ============================================================================
+
+EnergyLedger gEnergy;
+
+#ifdef ARDUINO
+
+/** @brief Guards gEnergy across tasks. */
+static portMUX_TYPE gMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void lock()   { portENTER_CRITICAL(&gMux); }
+static void unlock() { portEXIT_CRITICAL(&gMux); }
+static uint64_t nowUs() { return (uint64_t)esp_timer_get_time(); }
+
+#else
+
+/** @brief Guards gEnergy across threads. */
+static std::mutex gLock;
+
+static void lock()   { gLock.lock(); }
+static void unlock() { gLock.unlock(); }
+static uint64_t nowUs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
+
+void energyNote(EnergyEvent event, uint32_t n) {
+  lock();
+  energyCount(&gEnergy, event, n);
+  unlock();
+}
+
+void energyNoteTime(EnergyActivity activity, uint32_t us) {
+  lock();
+  energyAddTime(&gEnergy, activity, us);
+  unlock();
+}
+
+void energyNoteActive(EnergyActivity activity, bool on) {
+  uint64_t now = nowUs();
+  lock();
+  energySetActive(&gEnergy, activity, on, now);
+  unlock();
+}
+
+void energyNoteLink(EnergyLink link, uint32_t intervalUs) {
+  uint64_t now = nowUs();
+  lock();
+  energySetLink(&gEnergy, link, intervalUs, now);
+  unlock();
+}
+
+void energyNoteEstimate(const EnergyProfile* profile, EnergyEstimate* out) {
+  uint64_t now = nowUs();
+  lock();
+  EnergyLedger snapshot = gEnergy;
+  unlock();
+  energyEstimate(&snapshot, profile, now, out);
+}
@@ -0,0 +1,179 @@
+/**
+ * @file energy.h
+ * @brief Energy ledger and battery-life estimate for the tag.
+ *
+ * Firmware code reports what it does rather than what it costs: GATT
+ * notifications sent and writes received, I2C bytes, sleep wake-ups, CPU
+ * busy time, buzzer and IMU on-time, and the link state (advertising or
+ * connected, with its interval), from which advertising and connection
+ * events are counted. An EnergyProfile turns the ledger into charge:
+ *
+ *     charge = floorMa * elapsed + sum(count * uC per event)
+ *                                + sum(on-time * mA while on)
+ *
+ * and `energyEstimate()` derives the average current and the remaining
+ * battery life. All calls take the time explicitly, so the host model
+ * (host/powerModel.cpp) replays scenarios through exactly the same code.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Encoded size of an estimate for the energy characteristic. */
+#define ENERGY_RECORD_LEN 32
+
+/** @brief Floor current when awake and idle at the lowest clock, without light sleep (mA). */
+#define ENERGY_AWAKE_FLOOR_MA 13.0f
+
+/**
+ * @brief Counted events.
+ */
+enum EnergyEvent : uint8_t {
+  ENERGY_TX = 0,        /**< GATT notification or indication sent. */
+  ENERGY_RX,            /**< GATT write received. */
+  ENERGY_ADV,           /**< Advertising event (all channels). */
+  ENERGY_CONN,          /**< Connection event. */
+  ENERGY_I2C_BYTES,     /**< Bytes on the I2C bus. */
+  ENERGY_WAKEUPS,       /**< Light-sleep exits for task work. */
+  ENERGY_EVENT_COUNT
+};
+
+/**
+ * @brief Timed activities.
+ */
+enum EnergyActivity : uint8_t {
+  ENERGY_CPU = 0,       /**< CPU busy at full clock. */
+  ENERGY_BUZZER,        /**< Buzzer sounding. */
+  ENERGY_IMU,           /**< IMU sampling accelerometer and gyro. */
+  ENERGY_IMU_WOM,       /**< IMU in wake-on-motion. */
+  ENERGY_ACTIVITY_COUNT
+};
+
+/**
+ * @brief Link-layer state, for counting advertising and connection events.
+ */
+enum EnergyLink : uint8_t {
+  ENERGY_LINK_IDLE = 0,
+  ENERGY_LINK_ADVERTISING,
+  ENERGY_LINK_CONNECTED,
+};
+
+/**
+ * @brief Current-draw profile of a board and firmware configuration.
+ */
+struct EnergyProfile {
+  float floorMa;                          /**< Draw when nothing else is accounted (mA). */
+  float eventUc[ENERGY_EVENT_COUNT];      /**< Charge per event (µC). */
+  float activeMa[ENERGY_ACTIVITY_COUNT];  /**< Extra draw while active (mA). */
+  float batteryMah;                       /**< Battery capacity (mAh). */
+};
+
+/**
+ * @brief Default profile: ESP32-S3 with light sleep, MPU-6500, passive buzzer.
+ *
+ * Typical datasheet currents; radio charge per event is estimated. Replace
+ * with measured figures for a specific board.
+ */
+extern const EnergyProfile ENERGY_PROFILE_DEFAULT;
+
+/**
+ * @brief Energy ledger.
+ */
+struct EnergyLedger {
+  uint64_t startUs;                         /**< Start of accounting. */
+  uint64_t counts[ENERGY_EVENT_COUNT];      /**< Event counts. */
+  uint64_t activeUs[ENERGY_ACTIVITY_COUNT]; /**< Completed on-time per activity. */
+  uint64_t onSinceUs[ENERGY_ACTIVITY_COUNT]; /**< Start of a running activity. */
+  uint8_t  onMask;                          /**< Bit per running activity. */
+  uint8_t  link;                            /**< EnergyLink. */
+  uint32_t linkIntervalUs;                  /**< Event interval of the link state. */
+  uint64_t linkSinceUs;                     /**< Last time link events were counted. */
+};
+
+/**
+ * @brief Battery estimate derived from a ledger.
+ */
+struct EnergyEstimate {
+  uint64_t elapsedUs;        /**< Accounted time. */
+  float    usedMah;          /**< Charge drawn. */
+  float    avgMa;            /**< Average current. */
+  float    remainingMah;     /**< Capacity left. */
+  float    remainingHours;   /**< Time left at the average current. */
+  float    partMah[1 + ENERGY_EVENT_COUNT + ENERGY_ACTIVITY_COUNT]; /**< Floor, events, activities. */
+};
+
+/**
+ * @brief Reset a ledger (e.g. after fitting a fresh battery).
+ */
+void energyInit(EnergyLedger* ledger, uint64_t nowUs);
+
+/**
+ * @brief Count `n` events.
+ */
+void energyCount(EnergyLedger* ledger, EnergyEvent event, uint32_t n);
+
+/**
+ * @brief Add a measured on-time to an activity.
+ */
+void energyAddTime(EnergyLedger* ledger, EnergyActivity activity, uint32_t us);
+
+/**
+ * @brief Switch a timed activity on or off.
+ */
+void energySetActive(EnergyLedger* ledger, EnergyActivity activity, bool on, uint64_t nowUs);
+
+/**
+ * @brief Change the link state; advertising or connection events are counted
+ *        at `intervalUs` from now on.
+ */
+void energySetLink(EnergyLedger* ledger, EnergyLink link, uint32_t intervalUs, uint64_t nowUs);
+
+/**
+ * @brief Estimate consumption and remaining life up to `nowUs`.
+ *
+ * Running activities and link events are accounted up to `nowUs` without
+ * changing the ledger.
+ */
+void energyEstimate(const EnergyLedger* ledger, const EnergyProfile* profile, uint64_t nowUs,
+                    EnergyEstimate* out);
+
+/**
+ * @brief Name of an estimate part (index into `EnergyEstimate::partMah`).
+ */
+const char* energyPartName(size_t part);
+
+/**
+ * @brief Encode an estimate as a little-endian ENERGY_RECORD_LEN-byte record.
+ *
+ * Layout: elapsed s (u32), used µAh (u32), average µA (u32), remaining mAh
+ * (u32), remaining minutes (u32), TX, RX and wake-up counts (u32 each).
+ */
+size_t energyEncode(const EnergyEstimate* estimate, const EnergyLedger* ledger, uint8_t* out);
+
+// ============================================================================
+// Device Ledger
+// ============================================================================
+
+/**
+ * @brief The firmware's ledger, shared by all tasks; accounts from boot.
+ *
+ * The wrappers below lock around the ledger and stamp the current time; they
+ * are what firmware code calls.
+ */
+extern EnergyLedger gEnergy;
+
+/** @brief Count events in `gEnergy`. */
+void energyNote(EnergyEvent event, uint32_t n);
+
+/** @brief Add CPU busy time to `gEnergy`. */
+void energyNoteTime(EnergyActivity activity, uint32_t us);
+
+/** @brief Switch an activity in `gEnergy`. */
+void energyNoteActive(EnergyActivity activity, bool on);
+
+/** @brief Change the link state of `gEnergy`. */
+void energyNoteLink(EnergyLink link, uint32_t intervalUs);
+
+/** @brief Estimate from `gEnergy` with `profile` at the current time. */
+void energyNoteEstimate(const EnergyProfile* profile, EnergyEstimate* out);
@@ -0,0 +1,110 @@
+/**
+ * @file heapTelemetry.h
+ * @brief Heap and fragmentation snapshots at lifecycle points, with leak detection.
+ *
+ * The application records a snapshot at each lifecycle point (connect,
+ * disconnect, scan start/stop). For every point the module keeps the last
+ * HEAP_TREND_WINDOW snapshots and flags a suspected leak when the allocated
+ * bytes never decreased across the window, rose between at least half of
+ * the consecutive snapshots and grew by more than HEAP_TREND_SLACK in total.
+ * Comparing like with like (e.g. disconnect with disconnect) cancels out the
+ * memory that is legitimately held while connected.
+ *
+ * On the device snapshots come from `heap_caps_get_info`; host builds
+ * supply their own reader.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Snapshots per lifecycle point considered by the growth check. */
+#define HEAP_TREND_WINDOW 8
+
+/** @brief Net growth across the window tolerated before flagging (bytes). */
+#define HEAP_TREND_SLACK 256
+
+/** @brief Encoded size of one snapshot. */
+#define HEAP_RECORD_LEN 28
+
+/**
+ * @brief Lifecycle points at which snapshots are taken.
+ */
+enum HeapPoint : uint8_t {
+  HEAP_BOOT = 0,       /**< After setup. */
+  HEAP_SCAN_START,     /**< Before a scan. */
+  HEAP_SCAN_STOP,      /**< After a scan. */
+  HEAP_CONNECT,        /**< Link established. */
+  HEAP_DISCONNECT,     /**< Link lost or closed. */
+  HEAP_POINT_COUNT
+};
+
+/**
+ * @brief One heap snapshot.
+ */
+struct HeapSnapshot {
+  uint32_t ms;            /**< Time of the snapshot. */
+  uint32_t freeBytes;     /**< Free heap. */
+  uint32_t largestBlock;  /**< Largest free block. */
+  uint32_t minFree;       /**< Low-water mark of free heap since boot. */
+  uint32_t usedBytes;     /**< Allocated bytes. */
+  uint32_t allocBlocks;   /**< Live allocations. */
+  uint8_t  point;         /**< HeapPoint. */
+  bool     growing;       /**< Monotonic growth detected at this point. */
+};
+
+/**
+ * @brief Fills the heap fields (`ms` through `allocBlocks`) of a snapshot.
+ */
+typedef void (*HeapReader)(HeapSnapshot* out);
+
+/**
+ * @brief Reset all history and select the heap reader.
+ *
+ * @param[in] reader Reader, or nullptr for the platform heap (device only).
+ */
+void heapTelemetryInit(HeapReader reader);
+
+/**
+ * @brief Take a snapshot at a lifecycle point and update its growth check.
+ *
+ * @param[in] point Lifecycle point.
+ * @return The recorded snapshot (valid until the next call for this point).
+ */
+const HeapSnapshot* heapTelemetrySnapshot(HeapPoint point);
+
+/**
+ * @brief Most recent snapshot at a lifecycle point.
+ *
+ * @return Snapshot, or nullptr if none was taken yet.
+ */
+const HeapSnapshot* heapTelemetryLast(HeapPoint point);
+
+/**
+ * @brief Check whether monotonic growth was detected at any point.
+ */
+bool heapTelemetryLeakSuspected(void);
+
+/**
+ * @brief Name of a lifecycle point.
+ */
+const char* heapPointName(uint8_t point);
+
+/**
+ * @brief Format a snapshot as one human readable line (no newline).
+ *
+ * @return Characters written, as snprintf.
+ */
+int heapTelemetryFormat(const HeapSnapshot* s, char* buf, size_t size);
+
+/**
+ * @brief Encode the latest snapshot of every point for a characteristic value.
+ *
+ * Each record is HEAP_RECORD_LEN bytes, little-endian: u8 point, u8 flags
+ * (bit 0 growing), u16 reserved, then u32 ms, free, largest, minFree, used
+ * and allocBlocks. Points without a snapshot are skipped.
+ *
+ * @param[out] out Buffer of at least HEAP_POINT_COUNT * HEAP_RECORD_LEN bytes.
+ * @return Bytes written.
+ */
+size_t heapTelemetryEncode(uint8_t* out);
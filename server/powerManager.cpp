@@ -0,0 +1,147 @@
+/**
+ * @file powerManager.cpp
+ * @brief Power policy and the ESP-IDF power management glue.
+ */
+
+#include "powerManager.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "staticAlloc.h"
+#include "energy.h"
+#endif
+
+// ============================================================================
+// Policy
+// ============================================================================
+
+void powerPolicyInit(PowerPolicy* policy, uint32_t nowMs) {
+  *policy = PowerPolicy{};
+  policy->mode = POWER_ACTIVE;
+  policy->lastActiveMs = nowMs;
+  policy->modeSinceMs = nowMs;
+}
+
+PowerMode powerPolicyUpdate(PowerPolicy* policy, bool active, uint32_t nowMs) {
+  if (policy->mode != POWER_ACTIVE) return policy->mode;
+  if (active) policy->lastActiveMs = nowMs;
+  if (nowMs - policy->lastActiveMs >= POWER_STILL_AFTER_MS) {
+    policy->mode = POWER_STILL;
+    policy->modeSinceMs = nowMs;
+  }
+  return policy->mode;
+}
+
+void powerPolicyWake(PowerPolicy* policy, uint32_t nowMs) {
+  if (policy->mode == POWER_STILL) policy->stillMs += nowMs - policy->modeSinceMs;
+  policy->mode = POWER_ACTIVE;
+  policy->modeSinceMs = nowMs;
+  policy->lastActiveMs = nowMs;
+  policy->wakes++;
+}
+
+#ifdef ARDUINO
+
+// ============================================================================
+// Device Glue
+// ============================================================================
+
+/** @brief Lock holding the CPU at full speed while a sample is processed. */
+static esp_pm_lock_handle_t gBusyLock = nullptr;
+
+/** @brief Given by the IMU interrupt. */
+static SemaphoreHandle_t gMotionSem = nullptr;
+
+/** @brief Storage for gMotionSem. */
+static SemaphoreSlot gMotionSemSlot;
+
+/** @brief GPIO of the IMU interrupt, -1 if none. */
+static int gIntPin = -1;
+
+/** @brief Frequency scaling and light sleep as actually configured. */
+static bool gDfs = false, gLightSleep = false;
+
+/** @brief Start of the current busy period (micros). */
+static uint32_t gBusySinceUs = 0;
+
+/**
+ * @brief IMU interrupt: the pin is level-triggered, so mask it until re-armed.
+ */
+static void ARDUINO_ISR_ATTR onImuInterrupt() {
+  gpio_intr_disable((gpio_num_t)gIntPin);
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(gMotionSem, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+bool powerManagerInit(int imuIntPin) {
+  esp_pm_config_t cfg = {};
+  cfg.max_freq_mhz = POWER_MAX_MHZ;
+  cfg.min_freq_mhz = POWER_MIN_MHZ;
+  cfg.light_sleep_enable = true;
+  esp_err_t err = esp_pm_configure(&cfg);
+  if (err != ESP_OK) {
+    // Light sleep not built in (no tickless idle): keep frequency scaling
+    cfg.light_sleep_enable = false;
+    err = esp_pm_configure(&cfg);
+  }
+  gDfs = err == ESP_OK;
+  gLightSleep = gDfs && cfg.light_sleep_enable;
+  if (gDfs) esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "imu", &gBusyLock);
+
+  gMotionSem = binarySemaphoreCreate(gMotionSemSlot);
+  gIntPin = imuIntPin;
+  if (gIntPin >= 0) {
+    pinMode(gIntPin, INPUT);
+    attachInterrupt(gIntPin, onImuInterrupt, ONHIGH);
+    gpio_intr_disable((gpio_num_t)gIntPin);
+    gpio_wakeup_enable((gpio_num_t)gIntPin, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+  }
+  return gDfs;
+}
+
+bool powerLightSleepEnabled(void) {
+  return gLightSleep;
+}
+
+void powerBusyBegin(void) {
+  if (gBusyLock) esp_pm_lock_acquire(gBusyLock);
+  gBusySinceUs = micros();
+}
+
+void powerBusyEnd(void) {
+  energyNoteTime(ENERGY_CPU, micros() - gBusySinceUs);
+  if (gBusyLock) esp_pm_lock_release(gBusyLock);
+}
+
+void powerWaitForMotion(void) {
+  if (gIntPin < 0) return;
+  xSemaphoreTake(gMotionSem, 0);  // drop a stale wake-up
+  gpio_intr_enable((gpio_num_t)gIntPin);
+  xSemaphoreTake(gMotionSem, portMAX_DELAY);
+}
+
+void powerManagerReport(const PowerPolicy* policy) {
+  Serial.printf("Power: %u-%u MHz scaling %s, light sleep %s", POWER_MIN_MHZ, POWER_MAX_MHZ,
+                gDfs ? "on" : "off", gLightSleep ? "on" : "off");
+#if !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  Serial.print(" (needs CONFIG_FREERTOS_USE_TICKLESS_IDLE)");
+#endif
+#if !CONFIG_BT_CTRL_MODEM_SLEEP
+  Serial.print(" (BLE blocks light sleep without CONFIG_BT_CTRL_MODEM_SLEEP)");
+#endif
+  Serial.println();
+  if (policy) {
+    Serial.printf("Power: %s, still %u s total, %u motion wakes\n",
+                  policy->mode == POWER_STILL ? "still" : "active",
+                  (unsigned)(policy->stillMs / 1000), (unsigned)policy->wakes);
+  }
+}
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @file powerManager.h
+ * @brief Power policy of the tag: frequency scaling, light sleep and
+ *        wake-on-motion.
+ *
+ * Two mechanisms keep the tag's average current down:
+ * - ESP-IDF power management scales the CPU between POWER_MIN_MHZ and
+ *   POWER_MAX_MHZ and, with tickless idle, enters light sleep automatically
+ *   whenever every task is blocked. IMUTask holds a CPU_FREQ_MAX lock only
+ *   while it processes a sample, and the BLE controller keeps the link
+ *   alive through modem sleep, waking for its own connection events.
+ * - The policy below stops the 200 Hz IMU sampling once the tag has been
+ *   still for POWER_STILL_AFTER_MS. The IMU then runs its low-power
+ *   wake-on-motion mode and IMUTask blocks until the IMU interrupt (also a
+ *   light-sleep wake source) reports movement.
+ *
+ * The policy is plain code shared with the host energy model
+ * (host/powerModel.cpp); the ESP-IDF calls are device only.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Highest CPU frequency, used while a task holds the busy lock (MHz). */
+#ifndef POWER_MAX_MHZ
+#define POWER_MAX_MHZ 160
+#endif
+
+/** @brief Lowest CPU frequency when awake and idle (MHz, XTAL). */
+#ifndef POWER_MIN_MHZ
+#define POWER_MIN_MHZ 40
+#endif
+
+/** @brief Time without activity before sampling stops (ms). */
+#ifndef POWER_STILL_AFTER_MS
+#define POWER_STILL_AFTER_MS 30000
+#endif
+
+/** @brief Wake-on-motion threshold (mg, 4 mg resolution). */
+#ifndef POWER_WOM_THRESHOLD_MG
+#define POWER_WOM_THRESHOLD_MG 40
+#endif
+
+/**
+ * @brief Sampling mode chosen by the policy.
+ */
+enum PowerMode : uint8_t {
+  POWER_ACTIVE = 0,   /**< IMU sampled every period. */
+  POWER_STILL,        /**< IMU in wake-on-motion, IMUTask blocked. */
+};
+
+/**
+ * @brief Policy state and counters.
+ */
+struct PowerPolicy {
+  PowerMode mode;          /**< Current mode. */
+  uint32_t  lastActiveMs;  /**< Last time activity was seen. */
+  uint32_t  modeSinceMs;   /**< Time the current mode was entered. */
+  uint32_t  stillMs;       /**< Total time spent still (completed periods). */
+  uint32_t  wakes;         /**< Wake-on-motion wake-ups. */
+};
+
+/**
+ * @brief Start in POWER_ACTIVE.
+ */
+void powerPolicyInit(PowerPolicy* policy, uint32_t nowMs);
+
+/**
+ * @brief Feed one activity sample while active.
+ *
+ * @param[in,out] policy Policy state.
+ * @param[in]     active True if the sample shows movement or unsettled motion.
+ * @param[in]     nowMs  Current time.
+ * @return The mode to run next; POWER_STILL once inactive for long enough.
+ */
+PowerMode powerPolicyUpdate(PowerPolicy* policy, bool active, uint32_t nowMs);
+
+/**
+ * @brief Record a wake-on-motion interrupt and return to POWER_ACTIVE.
+ */
+void powerPolicyWake(PowerPolicy* policy, uint32_t nowMs);
+
+/**
+ * @brief Configure frequency scaling, automatic light sleep and the IMU
+ *        interrupt as a wake source (device only).
+ *
+ * Light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE and, while BLE is
+ * enabled, CONFIG_BT_CTRL_MODEM_SLEEP; without them the manager falls back
+ * to frequency scaling alone and reports what is missing.
+ *
+ * @param[in] imuIntPin GPIO wired to the IMU interrupt output.
+ * @return False if power management is not available at all.
+ */
+bool powerManagerInit(int imuIntPin);
+
+/**
+ * @brief True if automatic light sleep is configured (device only).
+ */
+bool powerLightSleepEnabled(void);
+
+/**
+ * @brief Hold the CPU at POWER_MAX_MHZ (and awake) until `powerBusyEnd`.
+ *
+ * The time between the two calls is booked as CPU time in the energy ledger.
+ */
+void powerBusyBegin(void);
+
+/**
+ * @brief Release the hold taken by `powerBusyBegin`.
+ */
+void powerBusyEnd(void);
+
+/**
+ * @brief Arm the IMU interrupt and block until it fires (device only).
+ *
+ * The IMU must already be in wake-on-motion mode.
+ */
+void powerWaitForMotion(void);
+
+/**
+ * @brief Print the power configuration and policy counters.
+ */
+void powerManagerReport(const PowerPolicy* policy);
@@ -0,0 +1,108 @@
+/**
+ * @file rollingId.cpp
+ * @brief Implementation of the SipHash-2-4 based rolling identifier.
+ *
+ * The identifier for window \f$w\f$ is
+ * \f[
+ *   id_w = \mathrm{SipHash\text{-}2\text{-}4}_{K}(w)
+ * \f]
+ * where \f$K\f$ is the 16-byte key shared between a tag and its owner and
+ * \f$w\f$ is encoded as four little-endian bytes.
+ *
+ * @note This file is shared verbatim between the server (tag) and scanner
+ *       (tracker) sketches. Keep both copies in sync.
+ */
+
+#include "rollingId.h"
+
+// ============================================================================
+// SipHash-2-4
+// ============================================================================
+
+/** @brief Rotate a 64-bit word left. */
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+/** @brief One SipHash round over the four state words. */
+#define SIPROUND                                          \
+  do {                                                    \
+    v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+    v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;              \
+    v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;              \
+    v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+  } while (0)
+
+/**
+ * @brief Load a little-endian 64-bit word.
+ *
+ * @param[in] p Pointer to 8 bytes.
+ * @return Decoded word.
+ */
+static uint64_t load64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+uint64_t siphash24(const uint8_t key[ROLLING_KEY_LEN], const uint8_t* data, size_t len) {
+  const uint64_t k0 = load64(key);
+  const uint64_t k1 = load64(key + 8);
+  uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+  uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+  uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+  uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+  const uint8_t* end = data + (len - (len % 8));
+  for (const uint8_t* p = data; p != end; p += 8) {
+    uint64_t m = load64(p);
+    v3 ^= m;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= m;
+  }
+
+  // Final block: remaining bytes plus the message length in the top byte
+  uint64_t b = ((uint64_t)len) << 56;
+  for (size_t i = 0; i < (len & 7); i++) b |= ((uint64_t)end[i]) << (8 * i);
+
+  v3 ^= b;
+  SIPROUND;
+  SIPROUND;
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// ============================================================================
+// Rolling Identifier
+// ============================================================================
+
+uint32_t rollingWindow(uint32_t epochSeconds) {
+  return epochSeconds / ROLLING_PERIOD_S;
+}
+
+uint64_t rollingIdFor(const uint8_t key[ROLLING_KEY_LEN], uint32_t window) {
+  const uint8_t msg[4] = {
+    (uint8_t)(window), (uint8_t)(window >> 8),
+    (uint8_t)(window >> 16), (uint8_t)(window >> 24)
+  };
+  return siphash24(key, msg, sizeof(msg));
+}
+
+void rollingEncodeMfr(uint64_t id, uint8_t out[ROLLING_MFR_LEN]) {
+  out[0] = (uint8_t)(ROLLING_COMPANY_ID & 0xFF);
+  out[1] = (uint8_t)(ROLLING_COMPANY_ID >> 8);
+  for (int i = 0; i < ROLLING_ID_LEN; i++) out[2 + i] = (uint8_t)(id >> (8 * i));
+}
+
+bool rollingDecodeMfr(const uint8_t* mfr, size_t len, uint64_t* id) {
+  if (len < ROLLING_MFR_LEN) return false;
+  if (mfr[0] != (uint8_t)(ROLLING_COMPANY_ID & 0xFF) ||
+      mfr[1] != (uint8_t)(ROLLING_COMPANY_ID >> 8)) return false;
+  *id = load64(mfr + 2);
+  return true;
+}
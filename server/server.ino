@@ -2,14 +2,23 @@
  * @file server.ino
  * @brief ESP32 BLE Server with IMU integration and buzzer control.
  * @details
- * Implements a BLE GATT server with two characteristics:
+ * Implements a BLE GATT server with six characteristics:
  * - Button characteristic (read/write)
  * - IMU characteristic (notify for movement detection)
+ * - Diagnostics characteristic (read, heap telemetry)
+ * - Energy characteristic (read, consumption and battery-life estimate,
+ *   battery voltage and state of charge)
+ * - Configuration characteristic (read/write "key=value", see configTable.h;
+ *   writes need a bonded link)
+ * - Clock characteristic (read/write epoch counter of the rolling identifier,
+ *   see epochClock.h; set by the tracker over a bonded link)
+ *
+ * The advertisement carries the rolling identifier and the battery level.
  * 
- * The system uses FreeRTOS tasks:
- * - IMUTask: Reads IMU sensor data and detects movement
- * - ButtonRelayTask: Handles BLE write events and signals via semaphore
- * - BuzzerSetTask: Toggles a buzzer based on BLE commands
+ * The system uses FreeRTOS tasks, laid out in taskTable.h:
+ * - IMUTask: Reads IMU sensor data and detects movement (application core)
+ * - BuzzerSetTask: Toggles a buzzer when a BLE write signals the semaphore
+ *   (protocol core)
  * 
  * Includes orientation computation, linear acceleration processing,
  * and movement detection with a smoothing filter.
@@ -20,26 +29,83 @@
  * @date 2025-08-21
  */
 
+#include <atomic>        /**< Flags shared with the BLE callbacks */
 #include <BLEDevice.h>   /**< Initializes BLE general functionality */
 #include <BLEServer.h>   /**< Provides BLE server (peripheral role) functionality */
 #include <BLEUtils.h>    /**< BLE helper utilities such as UUID handling */
 #include <BLE2902.h>     /**< Descriptor class for Client Characteristic Configuration Descriptor (CCCD) */
+#include <BLESecurity.h> /**< Bonding and key distribution */
 #include "IMU.h"         /**< Custom IMU driver */
 #include "IMU_STRUCT.h"  /**< IMU data structure definition */
 #include "IMU_REGISTER_MAP.h" /**< IMU register map */
+#include "rollingId.h"   /**< Rotating ephemeral identifier */
+#include "epochClock.h"  /**< Shared time base of the rolling identifier */
+#include "staticAlloc.h" /**< Static task/queue placement and RAM budget */
+#include "heapTelemetry.h" /**< Heap snapshots and leak detection */
+#include "taskTable.h"   /**< Core, priority and timing of every task */
+#include "powerManager.h" /**< Frequency scaling, light sleep and wake-on-motion */
+#include "energy.h"      /**< Energy ledger and battery-life estimate */
+#include "battery.h"     /**< Battery voltage and state of charge */
+#include "configTable.h" /**< Runtime parameters with lock-free reads */
 #include <Wire.h>        /**< I2C communication library */
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 
 /** @brief GPIO pin for buzzer output */
 #define BUZZER_PIN 2
 
+/** @brief GPIO pin wired to the IMU interrupt output (wake-on-motion) */
+#define IMU_INT_PIN 4
+
+/** @brief ADC1 pin at the battery divider tap */
+#define BATTERY_ADC_PIN 1
+
+/** @brief Battery divider ratio (cell = tap * NUM / DEN), 100k/100k */
+#define BATTERY_DIVIDER_NUM 2
+#define BATTERY_DIVIDER_DEN 1
+
 /** @brief BLE Service UUID */
 #define SERVICE_UUID "275dc6e0-dff5-4b56-9af0-584a5768a02a"
 /** @brief Button characteristic UUID */
 #define BUTTON_CHAR_UUID "b51bd845-2910-4f84-b062-d297ed286b1f"
 /** @brief IMU characteristic UUID */
 #define IMU_CHAR_UUID "0679c389-0d92-4604-aac4-664c43a51934"
+/** @brief Diagnostics characteristic UUID */
+#define DIAG_CHAR_UUID "9a1f4c2e-6b7d-4e38-a5c0-3d2e8f71b604"
+/** @brief Energy characteristic UUID */
+#define ENERGY_CHAR_UUID "9a1f4c2e-6b7d-4e38-a5c0-3d2e8f71b605"
+/** @brief Configuration characteristic UUID */
+#define CONFIG_CHAR_UUID "9a1f4c2e-6b7d-4e38-a5c0-3d2e8f71b606"
+/** @brief Clock characteristic UUID */
+#define CLOCK_CHAR_UUID "9a1f4c2e-6b7d-4e38-a5c0-3d2e8f71b607"
+
+/** @brief How often the advertised identifier is checked for rotation (ms) */
+#define ROLLING_CHECK_MS 10000
+
+/** @brief How often the task plan counters are printed (ms) */
+#define TASK_REPORT_MS 60000
+
+/** @brief Advertising event interval: default 20-40 ms plus 0-10 ms random delay (µs) */
+#define ADV_INTERVAL_US 35000
+
+/** @brief Connection interval assumed until the connection parameters are known (µs) */
+#define CONN_INTERVAL_US 30000
+
+/** @brief Upper bound for statically placed FreeRTOS objects (bytes) */
+#ifndef STATIC_RAM_BUDGET
+#define STATIC_RAM_BUDGET (16 * 1024)
+#endif
+
+/**
+ * @brief Key shared with the owning tracker for rolling identifier derivation.
+ *
+ * Must match the entry for this tag in the tracker's `OWNED_TAGS` table.
+ */
+static const uint8_t TAG_KEY[ROLLING_KEY_LEN] = {
+  0x3a, 0x91, 0x5c, 0x07, 0xe2, 0x4f, 0xb8, 0x16,
+  0xd0, 0x6b, 0x29, 0xf4, 0x83, 0x1e, 0xa5, 0x72
+};
 
 // ---------------------------------------------------------------------------
 // Global Objects
@@ -49,19 +115,40 @@
 BLECharacteristic* buttonChar;
 /** @brief Pointer to IMU characteristic */
 BLECharacteristic* imuChar;
+/** @brief Pointer to diagnostics characteristic */
+BLECharacteristic* diagChar;
+/** @brief Pointer to energy characteristic */
+BLECharacteristic* energyChar;
+/** @brief Pointer to configuration characteristic */
+BLECharacteristic* configChar;
+/** @brief Pointer to clock characteristic */
+BLECharacteristic* clockChar;
 /** @brief Pointer to BLE server object */
 BLEServer* server;
 /** @brief Flag indicating central connection status */
-volatile bool deviceConnected = false;
-/** @brief Flag indicating BLE message received */
-volatile bool bleMessageReceived = false;
+std::atomic<bool> deviceConnected{ false };
+/** @brief Rotation window currently being advertised */
+static uint32_t advertisedWindow = UINT32_MAX;
+/** @brief Battery level currently being advertised */
+static uint8_t advertisedBattery = BATTERY_SOC_UNKNOWN;
+/** @brief Current-draw profile, adjusted to the power configuration at boot */
+static EnergyProfile energyProfile = ENERGY_PROFILE_DEFAULT;
+
+// ---------------------------------------------------------------------------
+// FreeRTOS Synchronization
+// ---------------------------------------------------------------------------
+
+/** @brief Semaphore used to signal button events between tasks */
+SemaphoreHandle_t xButtonSignalSemaphore;
 
 // ---------------------------------------------------------------------------
 // Forward Declarations
 // ---------------------------------------------------------------------------
 void IMUTask(void *pvParameters);
-void ButtonRelayTask(void *pvParameters);
 void BuzzerSetTask(void *pvParameters);
+void updateAdvertisedId(bool force);
+void heapCheckpoint(HeapPoint point);
+void energyReport(void);
 
 // ---------------------------------------------------------------------------
 // BLE Server Callbacks
@@ -73,31 +160,307 @@ void BuzzerSetTask(void *pvParameters);
  */
 class ServerCallbacks : public BLEServerCallbacks { 
   void onConnect(BLEServer* pServer) override { 
-    deviceConnected = true; 
+    deviceConnected.store(true, std::memory_order_relaxed);
     pServer->getAdvertising()->stop(); /**< Stop advertising when connected */
+    energyNoteLink(ENERGY_LINK_CONNECTED, CONN_INTERVAL_US);
+    heapCheckpoint(HEAP_CONNECT);
+  }
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  /** Called right after onConnect(); refines the interval (units of 1.25 ms) */
+  void onConnect(BLEServer*, esp_ble_gatts_cb_param_t* param) override {
+    uint32_t interval = param->connect.conn_params.interval;
+    if (interval) energyNoteLink(ENERGY_LINK_CONNECTED, interval * 1250);
   }
+#endif
   void onDisconnect(BLEServer* pServer) override {
-    deviceConnected = false;
+    deviceConnected.store(false, std::memory_order_relaxed);
     pServer->getAdvertising()->start(); /**< Restart advertising when disconnected */
+    energyNoteLink(ENERGY_LINK_ADVERTISING, ADV_INTERVAL_US);
+    heapCheckpoint(HEAP_DISCONNECT);
   }
 };
 
 /**
  * @class ButtonCallbacks
  * @brief Handles write events to the Button characteristic.
+ * @details
+ * Signals BuzzerSetTask directly from the BLE callback, so no task has to
+ * poll for writes.
  */
 class ButtonCallbacks: public BLECharacteristicCallbacks {
    void onWrite(BLECharacteristic *pCharacteristic) override {
-     bleMessageReceived = true; /**< Set flag when BLE write occurs */
+     (void)pCharacteristic;
+     energyNote(ENERGY_RX, 1);
+     if (xButtonSignalSemaphore) xSemaphoreGive(xButtonSignalSemaphore);
+     Serial.println("write recieved!");
     }
 };
 
+/**
+ * @class DiagCallbacks
+ * @brief Refreshes the diagnostics characteristic before each read.
+ */
+class DiagCallbacks: public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic *pCharacteristic) override {
+    uint8_t value[HEAP_POINT_COUNT * HEAP_RECORD_LEN];
+    pCharacteristic->setValue(value, heapTelemetryEncode(value));
+  }
+};
+
+/**
+ * @class EnergyCallbacks
+ * @brief Refreshes the energy characteristic before each read.
+ * @details
+ * The value is the energy record followed by the battery record.
+ */
+class EnergyCallbacks: public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic *pCharacteristic) override {
+    EnergyEstimate est;
+    BatteryState battery;
+    uint8_t value[ENERGY_RECORD_LEN + BATTERY_RECORD_LEN];
+    energyNoteEstimate(&energyProfile, &est);
+    batteryRead(&battery);
+    size_t len = energyEncode(&est, &gEnergy, value);
+    len += batteryEncode(&battery, value + len);
+    pCharacteristic->setValue(value, len);
+  }
+};
+
 // ---------------------------------------------------------------------------
-// FreeRTOS Synchronization
+// Heap Telemetry
 // ---------------------------------------------------------------------------
 
-/** @brief Semaphore used to signal button events between tasks */
-SemaphoreHandle_t xButtonSignalSemaphore;
+/**
+ * @brief Record a heap snapshot at a lifecycle point and print it.
+ * @details
+ * The latest snapshot of every point is served by the diagnostics
+ * characteristic as HEAP_RECORD_LEN-byte records (see heapTelemetry.h).
+ *
+ * @param point Lifecycle point.
+ */
+void heapCheckpoint(HeapPoint point) {
+  const HeapSnapshot* s = heapTelemetrySnapshot(point);
+  if (!s) return;
+  char line[160];
+  heapTelemetryFormat(s, line, sizeof(line));
+  Serial.println(line);
+}
+
+/**
+ * @class ConfigCallbacks
+ * @brief Applies "key=value" writes and serves the values on read.
+ * @details
+ * Writes are taken only on an encrypted (bonded) link. Accepted values are
+ * persisted to NVS; the outcome is printed on Serial.
+ */
+class ConfigCallbacks: public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic *pCharacteristic) override {
+    energyNote(ENERGY_RX, 1);
+    String text = pCharacteristic->getValue();
+    ConfigStatus status = configApply(&appConfig, text.c_str());
+    Serial.printf("Config %s: %s\n", text.c_str(), configStatusName(status));
+    if (status == CONFIG_OK && !configSave(&appConfig)) Serial.println("Config: NVS save failed");
+  }
+  void onRead(BLECharacteristic *pCharacteristic) override {
+    char text[160];
+    size_t len = configFormat(&appConfig, text, sizeof(text));
+    pCharacteristic->setValue((uint8_t*)text, len);
+  }
+};
+
+// ---------------------------------------------------------------------------
+// Energy Telemetry
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Print the consumption estimate and its largest contributors.
+ * @details
+ * The same estimate is served by the energy characteristic as an
+ * ENERGY_RECORD_LEN-byte record (see energy.h), followed by the battery
+ * record (see battery.h).
+ */
+void energyReport(void) {
+  EnergyEstimate est;
+  BatteryState battery;
+  energyNoteEstimate(&energyProfile, &est);
+  batteryRead(&battery);
+  if (battery.percent != BATTERY_SOC_UNKNOWN) {
+    Serial.printf("Battery: %u mV, %u%%\n", batteryStateMv(&battery), battery.percent);
+  }
+  Serial.printf("Energy: %.3f mA avg, %.2f mAh used, %.0f mAh left, %.1f days left\n",
+                est.avgMa, est.usedMah, est.remainingMah, est.remainingHours / 24);
+  Serial.print("Energy:");
+  for (size_t p = 0; p < sizeof(est.partMah) / sizeof(est.partMah[0]); p++) {
+    if (est.usedMah > 0 && est.partMah[p] >= est.usedMah * 0.01f) {
+      Serial.printf(" %s %.0f%%", energyPartName(p), est.partMah[p] * 100 / est.usedMah);
+    }
+  }
+  Serial.println();
+}
+
+// ---------------------------------------------------------------------------
+// Rolling Identifier
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Advertise the rolling identifier of the current time window.
+ * @details
+ * The advertisement carries only flags and manufacturer data holding the
+ * SipHash-derived identifier followed by the battery level; the fixed
+ * service UUID and device name are no longer broadcast. Advertising is
+ * restarted only when the window or the reported battery level changes.
+ *
+ * @param force Rebuild the advertisement even if nothing changed.
+ */
+void updateAdvertisedId(bool force) {
+  uint32_t window = rollingWindow(epochClockNow());
+  BatteryState battery;
+  batteryRead(&battery);
+  if (!force && window == advertisedWindow && battery.percent == advertisedBattery) return;
+  advertisedWindow = window;
+  advertisedBattery = battery.percent;
+
+  uint8_t mfr[ROLLING_MFR_BATTERY_LEN];
+  rollingEncodeMfr(rollingIdFor(TAG_KEY, window), mfr);
+  mfr[ROLLING_MFR_LEN] = battery.percent;
+
+  BLEAdvertisementData data;
+  data.setFlags(0x06); /**< LE General Discoverable, BR/EDR not supported */
+  data.setManufacturerData(String((const char*)mfr, sizeof(mfr)));
+
+  BLEAdvertising* adv = server->getAdvertising();
+  adv->setAdvertisementData(data);
+  if (!deviceConnected.load(std::memory_order_relaxed)) {
+    adv->stop();
+    adv->start();
+  }
+}
+
+/**
+ * @brief Timer callback that rotates the advertised identifier and battery
+ *        level, and saves the epoch counter once per window.
+ * @param timer FreeRTOS timer handle (unused).
+ */
+static void rollingTimerCallback(TimerHandle_t timer) {
+  (void)timer;
+  updateAdvertisedId(false);
+  epochClockSave();
+}
+
+/**
+ * @class ClockCallbacks
+ * @brief Takes the tracker's epoch counter and serves ours on read.
+ * @details
+ * The tracker writes its counter each time our link becomes ready; the
+ * characteristic only takes writes on an encrypted (bonded) link. The
+ * counter never moves back, so no writer can pin or replay an identifier,
+ * and moves forward by at most one window, except on the first write
+ * since boot, which also covers the time we were switched off. The
+ * identifier is rotated at once if the window changed.
+ */
+class ClockCallbacks: public BLECharacteristicCallbacks {
+  bool synced = false; /**< A write was taken since boot. */
+
+  void onWrite(BLECharacteristic *pCharacteristic) override {
+    energyNote(ENERGY_RX, 1);
+    String value = pCharacteristic->getValue();
+    uint32_t seconds;
+    if (!epochClockDecode((const uint8_t*)value.c_str(), value.length(), &seconds)) return;
+    int32_t step = (int32_t)(seconds - epochClockNow());
+    if (step < 0 || (synced && step > (int32_t)ROLLING_PERIOD_S)) {
+      Serial.printf("Clock write refused (%+d s)\n", (int)step);
+      return;
+    }
+    synced = true;
+    epochClockSet(seconds);
+    if (step > 1) Serial.printf("Clock set to %u s (%+d s)\n", (unsigned)seconds, (int)step);
+    updateAdvertisedId(false);
+  }
+  void onRead(BLECharacteristic *pCharacteristic) override {
+    uint8_t value[EPOCH_CLOCK_LEN];
+    epochClockEncode(epochClockNow(), value);
+    pCharacteristic->setValue(value, sizeof(value));
+  }
+};
+
+// ---------------------------------------------------------------------------
+// Static Storage
+// ---------------------------------------------------------------------------
+
+/** @brief Task stacks and TCBs, one per task table row */
+#define X(fn, core, prio, stack, period, wcet) static TaskSlot<stack> fn##Slot;
+TASK_TABLE(X)
+#undef X
+
+/** @brief Task table rows */
+enum TaskId {
+#define X(fn, core, prio, stack, period, wcet) TASK_##fn,
+  TASK_TABLE(X)
+#undef X
+  TASK_COUNT
+};
+
+/** @brief Task plan, in table order */
+static constexpr TaskSpec TASK_PLAN[] = {
+#define X(fn, core, prio, stack, period, wcet) { #fn, core, prio, stack, period, wcet },
+  TASK_TABLE(X)
+#undef X
+};
+
+static TaskStats taskStats[TASK_COUNT];    /**< Deadline and execution counters */
+static AppConfig configCopies[2];          /**< The two copies of the configuration */
+static PowerPolicy powerPolicy;            /**< Sampling mode and still-time counters */
+static SemaphoreSlot buttonSignalSlot;     /**< xButtonSignalSemaphore storage */
+static TimerSlot rollingTimerSlot;         /**< Rolling identifier timer storage */
+
+static_assert(sizeof(AppConfig) <= CONFIG_MAX_SIZE, "configuration exceeds CONFIG_MAX_SIZE");
+
+/** @brief Factory defaults from the configuration table */
+static const AppConfig CONFIG_DEFAULTS = {
+#define X(type, name, def, lo, hi, help) def,
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief Field descriptors from the configuration table */
+static const ConfigField CONFIG_FIELDS[] = {
+#define X(type, name, def, lo, hi, help) \
+  { #name, ConfigTypeOf<type>::value, offsetof(AppConfig, name), lo, hi, help },
+  CONFIG_TABLE(X)
+#undef X
+};
+
+/** @brief Cross-field check: movement must end below where it starts */
+static bool configCheck(const void* cfg) {
+  const AppConfig* c = static_cast<const AppConfig*>(cfg);
+  return c->moveOff < c->moveOn;
+}
+
+ConfigStore appConfig = {
+  { &configCopies[0], &configCopies[1] }, sizeof(AppConfig),
+  CONFIG_FIELDS, sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]), configCheck, "server", 0
+};
+
+/** @brief Statically placed objects, reported per subsystem at boot */
+static constexpr MemRegion MEM_BUDGET[] = {
+#define X(fn, core, prio, stack, period, wcet) { "tasks", #fn, sizeof(fn##Slot) },
+  TASK_TABLE(X)
+#undef X
+  { "button", "buttonSignal",         sizeof(buttonSignalSlot) },
+  { "ble",    "rollingTimer",         sizeof(rollingTimerSlot) },
+  { "ble",    "ServerCallbacks",      sizeof(ServerCallbacks) },
+  { "ble",    "ButtonCallbacks",      sizeof(ButtonCallbacks) },
+  { "ble",    "DiagCallbacks",        sizeof(DiagCallbacks) },
+  { "ble",    "EnergyCallbacks",      sizeof(EnergyCallbacks) },
+  { "ble",    "ConfigCallbacks",      sizeof(ConfigCallbacks) },
+  { "ble",    "ClockCallbacks",       sizeof(ClockCallbacks) },
+  { "config", "appConfig",            sizeof(configCopies) },
+  { "ble",    "BLE2902",              sizeof(BLE2902) },
+  { "ble",    "BLESecurity",          sizeof(BLESecurity) },
+  { "imu",    "imu",                  sizeof(struct imu) },
+};
+static_assert(memBudgetTotal(MEM_BUDGET, sizeof(MEM_BUDGET) / sizeof(MEM_BUDGET[0])) <= STATIC_RAM_BUDGET,
+              "statically placed objects exceed STATIC_RAM_BUDGET");
 
 // ---------------------------------------------------------------------------
 // Setup
@@ -109,19 +472,43 @@ SemaphoreHandle_t xButtonSignalSemaphore;
  */
 void setup() {
   Serial.begin(115200);
+  heapTelemetryInit(nullptr);
+  configInit(&appConfig, &CONFIG_DEFAULTS);
+  if (configLoad(&appConfig)) Serial.println("Configuration loaded from NVS.");
+  if (!epochClockBegin("clock")) Serial.println("Clock: no saved epoch, starting at 0.");
   delay(2000);
   pinMode(BUZZER_PIN, OUTPUT);
   ledcAttach(BUZZER_PIN, 1000, 11); /**< Configure buzzer PWM */
 
   Wire.begin();
+  if (!batteryBegin(BATTERY_ADC_PIN, BATTERY_DIVIDER_NUM, BATTERY_DIVIDER_DEN)) {
+    Serial.println("Battery monitoring unavailable.");
+  }
+
+  if (!powerManagerInit(IMU_INT_PIN)) Serial.println("Power management unavailable.");
+  if (!powerLightSleepEnabled()) {
+    // Awake between tasks: no light-sleep floor and no wake-up overhead
+    energyProfile.floorMa = ENERGY_AWAKE_FLOOR_MA;
+    energyProfile.eventUc[ENERGY_WAKEUPS] = 0;
+  }
 
   // Initialize BLE Device
   BLEDevice::init("ESP32 Server");
   BLEDevice::setMTU(185); /**< Increase MTU size for better throughput */
 
+  // Bond and hand out our IRK so the tracker can resolve private addresses
+  static BLESecurity security;
+  security.setAuthenticationMode(ESP_LE_AUTH_BOND);
+  security.setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+  security.setRespEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  esp_ble_gap_config_local_privacy(true); /**< Advertise from a resolvable private address */
+#endif
+
   // Create server and attach callbacks
   server = BLEDevice::createServer();
-  server->setCallbacks(new ServerCallbacks());
+  static ServerCallbacks serverCallbacks;
+  server->setCallbacks(&serverCallbacks);
 
   // Create BLE service
   BLEService* service = server->createService(SERVICE_UUID);
@@ -138,53 +525,85 @@ void setup() {
     IMU_CHAR_UUID,
     BLECharacteristic::PROPERTY_NOTIFY
   );
-  imuChar->addDescriptor(new BLE2902());
-  buttonChar->setCallbacks(new ButtonCallbacks());
+  static BLE2902 imuCccd;
+  static ButtonCallbacks buttonCallbacks;
+  imuChar->addDescriptor(&imuCccd);
+  buttonChar->setCallbacks(&buttonCallbacks);
+
+  // Create diagnostics characteristic (read)
+  diagChar = service->createCharacteristic(
+    DIAG_CHAR_UUID,
+    BLECharacteristic::PROPERTY_READ
+  );
+  static DiagCallbacks diagCallbacks;
+  diagChar->setCallbacks(&diagCallbacks);
+
+  // Create energy characteristic (read)
+  energyChar = service->createCharacteristic(
+    ENERGY_CHAR_UUID,
+    BLECharacteristic::PROPERTY_READ
+  );
+  static EnergyCallbacks energyCallbacks;
+  energyChar->setCallbacks(&energyCallbacks);
+
+  // Create configuration characteristic (read/write), written over the bonded link
+  configChar = service->createCharacteristic(
+    CONFIG_CHAR_UUID,
+    BLECharacteristic::PROPERTY_READ |
+    BLECharacteristic::PROPERTY_WRITE
+  );
+  configChar->setAccessPermissions(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED);
+  static ConfigCallbacks configCallbacks;
+  configChar->setCallbacks(&configCallbacks);
+
+  // Create clock characteristic (read/write), set by the tracker over the bonded link
+  clockChar = service->createCharacteristic(
+    CLOCK_CHAR_UUID,
+    BLECharacteristic::PROPERTY_READ |
+    BLECharacteristic::PROPERTY_WRITE
+  );
+  clockChar->setAccessPermissions(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED);
+  static ClockCallbacks clockCallbacks;
+  clockChar->setCallbacks(&clockCallbacks);
 
   // Start service & advertising
   service->start();
   BLEAdvertising* adv = server->getAdvertising();
-  adv->addServiceUUID(SERVICE_UUID);
-  adv->setScanResponse(true);
+  adv->setScanResponse(false); /**< Scan response would expose the fixed name */
+  updateAdvertisedId(true);
   adv->start();
+  energyNoteLink(ENERGY_LINK_ADVERTISING, ADV_INTERVAL_US);
+
+  TimerHandle_t rollingTimer = timerCreate(rollingTimerSlot, "rollingId",
+                                           pdMS_TO_TICKS(ROLLING_CHECK_MS), true, rollingTimerCallback);
+  xTimerStart(rollingTimer, 0);
 
   Serial.println("Peripheral ready. Type here to send to central.");
 
-  // Create tasks
-  xTaskCreate(IMUTask, "IMUTask", 4096, NULL, 5, NULL);
+  xButtonSignalSemaphore = binarySemaphoreCreate(buttonSignalSlot);
 
-  xButtonSignalSemaphore = xSemaphoreCreateBinary();
+  // Create tasks from the task table, each pinned to its core
+  taskPlanInit(TASK_PLAN, taskStats, TASK_COUNT);
+#define X(fn, core, prio, stack, period, wcet) taskCreate(fn##Slot, fn, #fn, prio, core);
+  TASK_TABLE(X)
+#undef X
 
-  if (xButtonSignalSemaphore != NULL) {
-    xTaskCreate(ButtonRelayTask, "ButtonRelayTask", 4096, NULL, 5, NULL);
-    xTaskCreate(BuzzerSetTask, "BuzzerSetTask", 4096, NULL, 5, NULL);
-  }
+  memBudgetReport(MEM_BUDGET, sizeof(MEM_BUDGET) / sizeof(MEM_BUDGET[0]));
+  taskPlanReport();
+  powerManagerReport(nullptr);
+  heapCheckpoint(HEAP_BOOT);
 }
 
 // ---------------------------------------------------------------------------
 // Tasks
 // ---------------------------------------------------------------------------
 
-/**
- * @brief Task that relays button press signals from BLE writes.
- * @param pvParameters FreeRTOS task parameter (unused).
- */
-void ButtonRelayTask(void *pvParameters) {
-  while(1) {
-    if(bleMessageReceived) {
-      bleMessageReceived = false;
-      xSemaphoreGive(xButtonSignalSemaphore);
-      Serial.println("write recieved!");
-    }
-    vTaskDelay(pdMS_TO_TICKS(10));
-  }
-}
-
 /**
  * @brief Task that toggles buzzer on/off when button events occur.
  * @param pvParameters FreeRTOS task parameter (unused).
  */
 void BuzzerSetTask(void *pvParameters) {
+  (void)pvParameters;
   bool buzzerOn = false;
   while(1) {
     if(xSemaphoreTake(xButtonSignalSemaphore, portMAX_DELAY) == pdTRUE) {
@@ -195,6 +614,7 @@ void BuzzerSetTask(void *pvParameters) {
         buzzerOn = false;
         ledcWriteTone(BUZZER_PIN, 0); /**< Turn buzzer off */
       }
+      energyNoteActive(ENERGY_BUZZER, buzzerOn);
     }
   }
 }
@@ -203,15 +623,19 @@ void BuzzerSetTask(void *pvParameters) {
  * @brief Task that reads IMU data, processes orientation, and detects movement.
  * @details
  * - Reads accelerometer and gyroscope data
- * - Applies complementary filter for orientation
+ * - Applies complementary filter for orientation (gyro weight from the
+ *   configuration, like the movement thresholds)
  * - Removes gravitational bias
  * - Computes linear acceleration magnitude
  * - Applies SMA filter to detect sustained movement
  * - Notifies central via BLE when movement starts/stops
+ * - Runs at full clock only while processing a sample
+ * - Pauses sampling while the tag is still, until the IMU reports motion
  * 
  * @param pvParameters FreeRTOS task parameter (unused).
  */
 void IMUTask(void *pvParameters) {
+  (void)pvParameters;
   // Create IMU struct to hold IMU Data
   struct imu* imu_data = imu_init();
 
@@ -219,17 +643,16 @@ void IMUTask(void *pvParameters) {
   float previousTime;
   float currentTime;
   float elapsedTime;
-  float printTime;
 
   // Movement detection
   bool movement = false;
 
   // Error correction
-  float xErrGy, yErrGy, zErrGy;
-  float xErrAc, yErrAc, zErrAc;
+  float xErrGy = 0, yErrGy = 0, zErrGy = 0;
+  float xErrAc = 0, yErrAc = 0, zErrAc = 0;
 
   // Orientation and acceleration variables
-  float accAngleX, accAngleY, gyroAngleX, gyroAngleY, gyroAngleZ;
+  float accAngleX, accAngleY;
   float roll, pitch;
   float roll_rad, pitch_rad;
   float gX, gY, gZ;
@@ -251,11 +674,23 @@ void IMUTask(void *pvParameters) {
   imu_i2c();
   calibrateGyro(&xErrGy, &yErrGy, &zErrGy);
   calibrateAccel(&xErrAc, &yErrAc, &zErrAc);
-  printTime = millis();
   currentTime = millis();
   previousTime = currentTime;
+  powerPolicyInit(&powerPolicy, millis());
+  energyNoteActive(ENERGY_IMU, true);
+  taskPeriodStart(TASK_IMUTask);
 
   for (;;) {
+    powerBusyBegin();
+    if (powerLightSleepEnabled()) energyNote(ENERGY_WAKEUPS, 1);
+
+    float moveOn, moveOff, compAlpha;
+    configRead<AppConfig>(&appConfig, [&](const AppConfig& c) {
+      moveOn = c.moveOn;
+      moveOff = c.moveOff;
+      compAlpha = c.compAlpha;
+    });
+
     // Timing
     currentTime = millis();
     elapsedTime = (currentTime - previousTime) / 1000.0;
@@ -272,8 +707,8 @@ void IMUTask(void *pvParameters) {
     imu_read_gyro(&(imu_data->GyroX), xErrGy, &(imu_data->GyroY), yErrGy, &(imu_data->GyroZ), zErrGy);
 
     // Complementary filter
-    roll  = 0.98*(roll + imu_data->GyroX * elapsedTime) + (1-0.98)*accAngleX;
-    pitch = 0.98*(pitch + imu_data->GyroY * elapsedTime) + (1-0.98)*accAngleY;
+    roll  = compAlpha*(roll + imu_data->GyroX * elapsedTime) + (1-compAlpha)*accAngleX;
+    pitch = compAlpha*(pitch + imu_data->GyroY * elapsedTime) + (1-compAlpha)*accAngleY;
 
     // Convert to radians
     roll_rad = roll * PI / 180.0;
@@ -293,7 +728,7 @@ void IMUTask(void *pvParameters) {
     linMag = sqrt(linAccX*linAccX + linAccY*linAccY + linAccZ*linAccZ);
 
     // SMA smoothing (buffer length = 32)
-    if (buffer[i+1] != 0)
+    if (buffer[i] != 0)
       sum -= buffer[i];
   
     buffer[i] = linMag;
@@ -302,30 +737,57 @@ void IMUTask(void *pvParameters) {
     avg = sum / 32;
 
     // Notify movement start
-    if (avg >= 0.25 && !movement) {
+    if (avg >= moveOn && !movement) {
       moveSignal = 1;
       Serial.println("movement detected!");
       sprintf(str, "%d", moveSignal);
       imuChar->setValue((uint8_t*)&str, strlen(str));
       imuChar->notify();
+      energyNote(ENERGY_TX, 1);
       movement = true;
     }
 
     // Notify movement stop
-    if (avg <= 0.05 && movement) {
+    if (avg <= moveOff && movement) {
       movement = false;
       moveSignal = 0;
       Serial.println("stopped moving!");
       sprintf(str, "%d", moveSignal);
       imuChar->setValue((uint8_t*)&str, strlen(str));
       imuChar->notify();
+      energyNote(ENERGY_TX, 1);
+    }
+    powerBusyEnd();
+
+    // Stop sampling once the tag has been still for a while; the IMU's
+    // wake-on-motion interrupt resumes it
+    if (powerPolicyUpdate(&powerPolicy, avg > moveOff, millis()) == POWER_STILL) {
+      Serial.println("still: sampling paused");
+      imu_wake_on_motion(POWER_WOM_THRESHOLD_MG);
+      energyNoteActive(ENERGY_IMU, false);
+      energyNoteActive(ENERGY_IMU_WOM, true);
+      powerWaitForMotion();
+      imu_active_mode();
+      energyNoteActive(ENERGY_IMU_WOM, false);
+      energyNoteActive(ENERGY_IMU, true);
+      powerPolicyWake(&powerPolicy, millis());
+      Serial.println("motion: sampling resumed");
+      previousTime = millis();
+      taskPeriodStart(TASK_IMUTask);
+      continue;
     }
-    vTaskDelay(pdMS_TO_TICKS(5));
+    taskPeriodWait(TASK_IMUTask);
   }
 }
 
 /**
- * @brief Arduino loop function (unused, tasks handle logic).
+ * @brief Arduino loop function (tasks handle logic).
+ * Prints the task plan, power counters and energy estimate every
+ * TASK_REPORT_MS.
  */
 void loop() {
+  delay(TASK_REPORT_MS);
+  taskPlanReport();
+  powerManagerReport(&powerPolicy);
+  energyReport();
 }
@@ -0,0 +1,32 @@
+/**
+ * @file staticAlloc.cpp
+ * @brief RAM budget report for statically placed objects.
+ */
+
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "staticAlloc.h"
+
+void memBudgetReport(const MemRegion* regions, size_t count) {
+  Serial.printf("Static RAM budget (%s):\n", STATIC_ALLOC ? "static" : "heap fallback");
+  for (size_t i = 0; i < count; i++) {
+    // Print each subsystem once, at its first entry
+    bool seen = false;
+    for (size_t j = 0; j < i && !seen; j++) seen = strcmp(regions[j].subsystem, regions[i].subsystem) == 0;
+    if (seen) continue;
+
+    size_t total = 0;
+    for (size_t j = i; j < count; j++) {
+      if (strcmp(regions[j].subsystem, regions[i].subsystem) == 0) total += regions[j].bytes;
+    }
+    Serial.printf("  %-8s %7u B\n", regions[i].subsystem, (unsigned)total);
+    for (size_t j = i; j < count; j++) {
+      if (strcmp(regions[j].subsystem, regions[i].subsystem) != 0) continue;
+      Serial.printf("    %-24s %7u B\n", regions[j].name, (unsigned)regions[j].bytes);
+    }
+  }
+  Serial.printf("  total    %7u B\n", (unsigned)memBudgetTotal(regions, count));
+  Serial.printf("Heap: %u B free, %u B largest block\n",
+                (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
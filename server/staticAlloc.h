@@ -0,0 +1,154 @@
+/**
+ * @file staticAlloc.h
+ * @brief Static placement of FreeRTOS objects and a RAM budget report.
+ *
+ * With STATIC_ALLOC enabled (the default) every task stack, TCB, queue,
+ * semaphore and timer lives in a slot reserved at link time, so none of them
+ * touches the heap and their RAM shows up in the linker map. With
+ * STATIC_ALLOC set to 0 the same calls fall back to the heap-allocating
+ * FreeRTOS APIs and the slots are empty.
+ *
+ * The sketch lists its slots in a MemRegion table, which is checked against
+ * STATIC_RAM_BUDGET at compile time and printed per subsystem at boot.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+/** @brief Allocate FreeRTOS objects statically (1) or from the heap (0). */
+#ifndef STATIC_ALLOC
+#define STATIC_ALLOC 1
+#endif
+
+// ============================================================================
+// Slots
+// ============================================================================
+
+#if STATIC_ALLOC
+
+/** @brief Storage for one task. ESP-IDF stack depths are given in bytes. */
+template <size_t STACK_BYTES>
+struct TaskSlot {
+  StaticTask_t tcb;                                      /**< Task control block. */
+  StackType_t  stack[STACK_BYTES / sizeof(StackType_t)]; /**< Task stack. */
+};
+
+/** @brief Storage for one queue of LEN items of ITEM bytes. */
+template <size_t LEN, size_t ITEM>
+struct QueueSlot {
+  StaticQueue_t queue;               /**< Queue control block. */
+  uint8_t       storage[LEN * ITEM]; /**< Item storage. */
+};
+
+/** @brief Storage for one semaphore. */
+struct SemaphoreSlot {
+  StaticSemaphore_t sem;  /**< Semaphore control block. */
+};
+
+/** @brief Storage for one software timer. */
+struct TimerSlot {
+  StaticTimer_t timer;    /**< Timer control block. */
+};
+
+#else
+
+template <size_t STACK_BYTES> struct TaskSlot {};
+template <size_t LEN, size_t ITEM> struct QueueSlot {};
+struct SemaphoreSlot {};
+struct TimerSlot {};
+
+#endif
+
+// ============================================================================
+// Creation
+// ============================================================================
+
+/**
+ * @brief Create a task in its slot.
+ *
+ * @param[in,out] slot  Task storage.
+ * @param[in]     fn    Task function.
+ * @param[in]     name  Task name.
+ * @param[in]     prio  Priority.
+ * @param[in]     core  Core to pin the task to, or tskNO_AFFINITY.
+ * @return Task handle, or nullptr on failure.
+ */
+template <size_t STACK_BYTES>
+TaskHandle_t taskCreate(TaskSlot<STACK_BYTES>& slot, TaskFunction_t fn, const char* name,
+                        UBaseType_t prio, BaseType_t core = tskNO_AFFINITY) {
+#if STATIC_ALLOC
+  return xTaskCreateStaticPinnedToCore(fn, name, STACK_BYTES, NULL, prio, slot.stack, &slot.tcb, core);
+#else
+  TaskHandle_t handle = nullptr;
+  xTaskCreatePinnedToCore(fn, name, STACK_BYTES, NULL, prio, &handle, core);
+  return handle;
+#endif
+}
+
+/**
+ * @brief Create a queue in its slot.
+ */
+template <size_t LEN, size_t ITEM>
+QueueHandle_t queueCreate(QueueSlot<LEN, ITEM>& slot) {
+#if STATIC_ALLOC
+  return xQueueCreateStatic(LEN, ITEM, slot.storage, &slot.queue);
+#else
+  return xQueueCreate(LEN, ITEM);
+#endif
+}
+
+/**
+ * @brief Create a binary semaphore in its slot.
+ */
+inline SemaphoreHandle_t binarySemaphoreCreate(SemaphoreSlot& slot) {
+#if STATIC_ALLOC
+  return xSemaphoreCreateBinaryStatic(&slot.sem);
+#else
+  return xSemaphoreCreateBinary();
+#endif
+}
+
+/**
+ * @brief Create a software timer in its slot.
+ */
+inline TimerHandle_t timerCreate(TimerSlot& slot, const char* name, TickType_t period,
+                                 bool autoReload, TimerCallbackFunction_t cb) {
+#if STATIC_ALLOC
+  return xTimerCreateStatic(name, period, autoReload ? pdTRUE : pdFALSE, NULL, cb, &slot.timer);
+#else
+  return xTimerCreate(name, period, autoReload ? pdTRUE : pdFALSE, NULL, cb);
+#endif
+}
+
+// ============================================================================
+// Budget
+// ============================================================================
+
+/**
+ * @brief One statically placed object in the RAM budget.
+ */
+struct MemRegion {
+  const char* subsystem;  /**< Owning subsystem (e.g. "ble", "ui"). */
+  const char* name;       /**< Object name. */
+  size_t      bytes;      /**< Size in bytes. */
+};
+
+/**
+ * @brief Sum of a budget table, usable in `static_assert`.
+ */
+constexpr size_t memBudgetTotal(const MemRegion* regions, size_t count) {
+  return count == 0 ? 0 : regions[0].bytes + memBudgetTotal(regions + 1, count - 1);
+}
+
+/**
+ * @brief Print per-subsystem totals of a budget table and the heap state.
+ *
+ * @param[in] regions Budget table.
+ * @param[in] count   Number of entries.
+ */
+void memBudgetReport(const MemRegion* regions, size_t count);
@@ -0,0 +1,88 @@
+/**
+ * @file taskPlan.h
+ * @brief Declarative task plan: core affinity, priority and timing per task.
+ *
+ * Each sketch lists its tasks once in `taskTable.h` as an X-macro,
+ *
+ *     X(fn, core, prio, stackBytes, periodMs, wcetUs)
+ *
+ * and expands it into task slots, a TaskSpec table and the startup calls.
+ * `periodMs` is the release period of a periodic task or the minimum
+ * inter-arrival time of an event-driven one (0 for background tasks), and
+ * `wcetUs` the execution budget per release. The same header is read by the
+ * host `schedAnalysis` tool to compute worst-case response times.
+ *
+ * Periodic tasks pace themselves with `taskPeriodWait()`, which counts
+ * deadline misses and records the longest execution per release, so the
+ * budgets in the table can be checked against the running device.
+ */
+
+#pragma once
+#include <atomic>
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/** @brief Protocol core: the BLE controller and host stack run here. */
+#define PRO_CORE 0
+
+/** @brief Application core: sensor and UI pipelines run here. */
+#define APP_CORE 1
+
+/**
+ * @brief Static description of one task (one row of the task table).
+ */
+struct TaskSpec {
+  const char* name;       /**< Task name. */
+  BaseType_t  core;       /**< Core the task is pinned to. */
+  UBaseType_t prio;       /**< FreeRTOS priority. */
+  uint32_t    stackBytes; /**< Stack size in bytes. */
+  uint32_t    periodMs;   /**< Period or minimum inter-arrival time, 0 for background. */
+  uint32_t    wcetUs;     /**< Execution budget per release. */
+};
+
+/**
+ * @brief Runtime counters of one task.
+ *
+ * Only the task itself writes them; the counters are atomic because
+ * `taskPlanReport()` reads them from another task.
+ */
+struct TaskStats {
+  TickType_t            lastWake;     /**< Release time of the current period. */
+  uint32_t              startUs;      /**< Start of the current release (micros). */
+  std::atomic<uint32_t> activations;  /**< Completed releases. */
+  std::atomic<uint32_t> misses;       /**< Releases that overran their period. */
+  std::atomic<uint32_t> maxExecUs;    /**< Longest observed release. */
+};
+
+/**
+ * @brief Attach the task table and its counters (call before creating tasks).
+ *
+ * @param[in]     specs Task table.
+ * @param[in,out] stats Counters, one per task; cleared here.
+ * @param[in]     count Number of tasks.
+ */
+void taskPlanInit(const TaskSpec* specs, TaskStats* stats, size_t count);
+
+/**
+ * @brief Start the first period of a periodic task (or restart after a stall).
+ *
+ * @param[in] id Row of the calling task in the table.
+ */
+void taskPeriodStart(size_t id);
+
+/**
+ * @brief End the current release and sleep until the next period.
+ *
+ * A release that ends after its next period was due counts as a deadline
+ * miss; the schedule then restarts from now rather than bursting to catch up.
+ *
+ * @param[in] id Row of the calling task in the table.
+ * @return False if the deadline was missed.
+ */
+bool taskPeriodWait(size_t id);
+
+/**
+ * @brief Print the plan with activations, misses and worst execution per task.
+ */
+void taskPlanReport(void);
@@ -0,0 +1,27 @@
+/**
+ * @file taskTable.h
+ * @brief Task plan of the tag (see taskPlan.h for the column meanings).
+ *
+ * The IMU pipeline owns the application core at the highest application
+ * priority; the buzzer task reacts to BLE writes and stays on the protocol
+ * core next to the stack that wakes it. Budgets are per-release estimates;
+ * compare them with the `maxExec` column of the periodic report.
+ */
+
+#pragma once
+#include "taskPlan.h"
+
+/** @brief Application tasks: X(fn, core, prio, stackBytes, periodMs, wcetUs) */
+#define TASK_TABLE(X) \
+  X(IMUTask,        APP_CORE, 6, 4096,   5, 1200) \
+  X(BuzzerSetTask,  PRO_CORE, 5, 4096, 100,   50)
+
+/**
+ * @brief ESP-IDF tasks competing for the same cores, for schedulability
+ *        analysis only (priorities from the IDF defaults, loads estimated
+ *        for a 7.5-15 ms connection interval).
+ */
+#define TASK_SYSTEM(X) \
+  X(btController,   PRO_CORE, 23, 0,  10,  600) \
+  X(btuTask,        PRO_CORE, 20, 0,  10,  400) \
+  X(esp_timer,      PRO_CORE, 22, 0, 100,   50)